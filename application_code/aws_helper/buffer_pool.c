@@ -0,0 +1,370 @@
+/*
+ * buffer_pool.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file buffer_pool.c
+ *
+ * @brief Size-classed static buffer pool.
+ *
+ * Each class owns a contiguous block of storage, so a buffer's class and
+ * index are found from its address alone and no header is stored in front
+ * of the buffer. A request larger than the largest buffers takes a run of
+ * adjacent ones, claimed together. The free bitmap of a class is claimed
+ * with compare-and-swap;
+ * on this Cortex-M4 port atomic.h implements that with a short critical
+ * section, which keeps the pool usable from any task without a mutex.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdbool.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "atomic.h"
+
+/* Buffer pool configuration. */
+#include "aws_bufferpool_config.h"
+
+#include "buffer_pool.h"
+
+/*-----------------------------------------------------------*/
+
+#if ( ( bufferpoolconfigSMALL_NUM_BUFFERS > 32 ) || \
+    ( bufferpoolconfigMEDIUM_NUM_BUFFERS > 32 ) ||  \
+    ( bufferpoolconfigLARGE_NUM_BUFFERS > 32 ) )
+    #error "A buffer pool class may hold at most 32 buffers."
+#endif
+
+#if ( ( ( bufferpoolconfigSMALL_BUFFER_SIZE % 4 ) != 0 ) || \
+    ( ( bufferpoolconfigMEDIUM_BUFFER_SIZE % 4 ) != 0 ) ||  \
+    ( ( bufferpoolconfigLARGE_BUFFER_SIZE % 4 ) != 0 ) )
+    #error "Buffer pool sizes must be a multiple of 4."
+#endif
+
+/**
+ * @brief Bitmap with the lowest @p n bits set.
+ */
+#define bufferpoolALL_FREE( n )    ( ( ( n ) >= 32 ) ? 0xFFFFFFFFUL : ( ( 1UL << ( n ) ) - 1UL ) )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief One size class of the pool.
+ */
+typedef struct BufferClass
+{
+    uint8_t * pucStorage;
+    size_t xBufferSize;
+    uint32_t ulCount;
+    uint32_t volatile * pulRefCounts;
+
+    /**
+     * @brief Buffers claimed with each buffer that starts a run.
+     */
+    uint8_t * pucRunLengths;
+
+    /**
+     * @brief Bit n is set while buffer n is free.
+     */
+    uint32_t volatile ulFreeMask;
+    uint32_t volatile ulInUse;
+    uint32_t volatile ulHighWater;
+    uint32_t volatile ulFailures;
+    uint32_t volatile ulAcquired;
+} BufferClass_t;
+
+/*-----------------------------------------------------------*/
+
+/* Storage is declared as words to keep every buffer 4-byte aligned. */
+static uint32_t ulSmallStorage[ ( bufferpoolconfigSMALL_NUM_BUFFERS * bufferpoolconfigSMALL_BUFFER_SIZE ) / 4 ];
+static uint32_t ulMediumStorage[ ( bufferpoolconfigMEDIUM_NUM_BUFFERS * bufferpoolconfigMEDIUM_BUFFER_SIZE ) / 4 ];
+static uint32_t ulLargeStorage[ ( bufferpoolconfigLARGE_NUM_BUFFERS * bufferpoolconfigLARGE_BUFFER_SIZE ) / 4 ];
+
+static uint32_t volatile ulSmallRefCounts[ bufferpoolconfigSMALL_NUM_BUFFERS ];
+static uint32_t volatile ulMediumRefCounts[ bufferpoolconfigMEDIUM_NUM_BUFFERS ];
+static uint32_t volatile ulLargeRefCounts[ bufferpoolconfigLARGE_NUM_BUFFERS ];
+
+static uint8_t ucSmallRunLengths[ bufferpoolconfigSMALL_NUM_BUFFERS ];
+static uint8_t ucMediumRunLengths[ bufferpoolconfigMEDIUM_NUM_BUFFERS ];
+static uint8_t ucLargeRunLengths[ bufferpoolconfigLARGE_NUM_BUFFERS ];
+
+/**
+ * @brief The size classes, smallest first.
+ */
+static BufferClass_t xClasses[ bufferpoolNUM_CLASSES ] =
+{
+    {
+        ( uint8_t * ) ulSmallStorage,
+        bufferpoolconfigSMALL_BUFFER_SIZE,
+        bufferpoolconfigSMALL_NUM_BUFFERS,
+        ulSmallRefCounts,
+        ucSmallRunLengths,
+        bufferpoolALL_FREE( bufferpoolconfigSMALL_NUM_BUFFERS ),
+        0UL,
+        0UL,
+        0UL,
+        0UL
+    },
+    {
+        ( uint8_t * ) ulMediumStorage,
+        bufferpoolconfigMEDIUM_BUFFER_SIZE,
+        bufferpoolconfigMEDIUM_NUM_BUFFERS,
+        ulMediumRefCounts,
+        ucMediumRunLengths,
+        bufferpoolALL_FREE( bufferpoolconfigMEDIUM_NUM_BUFFERS ),
+        0UL,
+        0UL,
+        0UL,
+        0UL
+    },
+    {
+        ( uint8_t * ) ulLargeStorage,
+        bufferpoolconfigLARGE_BUFFER_SIZE,
+        bufferpoolconfigLARGE_NUM_BUFFERS,
+        ulLargeRefCounts,
+        ucLargeRunLengths,
+        bufferpoolALL_FREE( bufferpoolconfigLARGE_NUM_BUFFERS ),
+        0UL,
+        0UL,
+        0UL,
+        0UL
+    }
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Claim @p ulBuffers adjacent free buffers of @p pxClass.
+ *
+ * @return The first buffer of the run, or NULL if the class has no such run.
+ */
+static void * prvClaimFromClass( BufferClass_t * pxClass,
+                                 uint32_t ulBuffers );
+
+/**
+ * @brief Find the class and index of a pool buffer.
+ *
+ * @return true if @p pvBuffer is the start of a pool buffer.
+ */
+static bool prvLocate( const void * pvBuffer,
+                       BufferClass_t ** ppxClass,
+                       uint32_t * pulIndex );
+
+/*-----------------------------------------------------------*/
+
+static void * prvClaimFromClass( BufferClass_t * pxClass,
+                                 uint32_t ulBuffers )
+{
+    void * pvBuffer = NULL;
+    uint32_t ulRun = bufferpoolALL_FREE( ulBuffers );
+    uint32_t ulMask = 0UL;
+    uint32_t ulIndex = 0UL;
+    uint32_t ulInUse = 0UL;
+    uint32_t ulHighWater = 0UL;
+
+    for( ; ; )
+    {
+        ulMask = pxClass->ulFreeMask;
+
+        /* Find the lowest run of free buffers. */
+        for( ulIndex = 0UL;
+             ( ( ulIndex + ulBuffers ) <= pxClass->ulCount ) && ( ( ( ulMask >> ulIndex ) & ulRun ) != ulRun );
+             ulIndex++ )
+        {
+        }
+
+        if( ( ulIndex + ulBuffers ) > pxClass->ulCount )
+        {
+            break;
+        }
+
+        if( Atomic_CompareAndSwap_u32( &pxClass->ulFreeMask,
+                                       ulMask & ~( ulRun << ulIndex ),
+                                       ulMask ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS )
+        {
+            pxClass->pulRefCounts[ ulIndex ] = 1UL;
+            pxClass->pucRunLengths[ ulIndex ] = ( uint8_t ) ulBuffers;
+            pvBuffer = &pxClass->pucStorage[ ulIndex * pxClass->xBufferSize ];
+
+            ulInUse = Atomic_Add_u32( &pxClass->ulInUse, ulBuffers ) + ulBuffers;
+            ( void ) Atomic_Increment_u32( &pxClass->ulAcquired );
+
+            do
+            {
+                ulHighWater = pxClass->ulHighWater;
+            } while( ( ulInUse > ulHighWater ) &&
+                     ( Atomic_CompareAndSwap_u32( &pxClass->ulHighWater,
+                                                  ulInUse,
+                                                  ulHighWater ) != ATOMIC_COMPARE_AND_SWAP_SUCCESS ) );
+
+            break;
+        }
+
+        /* Another task claimed a buffer in between; try again. */
+    }
+
+    return pvBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvLocate( const void * pvBuffer,
+                       BufferClass_t ** ppxClass,
+                       uint32_t * pulIndex )
+{
+    const uint8_t * pucBuffer = ( const uint8_t * ) pvBuffer;
+    bool xFound = false;
+    uint32_t ulClass = 0UL;
+    size_t xOffset = 0U;
+
+    for( ulClass = 0UL; ( ulClass < bufferpoolNUM_CLASSES ) && ( xFound == false ); ulClass++ )
+    {
+        BufferClass_t * pxClass = &xClasses[ ulClass ];
+
+        if( ( pucBuffer >= pxClass->pucStorage ) &&
+            ( pucBuffer < &pxClass->pucStorage[ pxClass->ulCount * pxClass->xBufferSize ] ) )
+        {
+            xOffset = ( size_t ) ( pucBuffer - pxClass->pucStorage );
+
+            if( ( xOffset % pxClass->xBufferSize ) == 0U )
+            {
+                *ppxClass = pxClass;
+                *pulIndex = ( uint32_t ) ( xOffset / pxClass->xBufferSize );
+                xFound = true;
+            }
+        }
+    }
+
+    return xFound;
+}
+
+/*-----------------------------------------------------------*/
+
+void * BufferPool_Acquire( size_t xSize )
+{
+    void * pvBuffer = NULL;
+    BufferClass_t * pxBestFit = NULL;
+    BufferClass_t * pxLargest = &xClasses[ bufferpoolNUM_CLASSES - 1U ];
+    uint32_t ulClass = 0UL;
+
+    if( xSize > pxLargest->xBufferSize )
+    {
+        /* Too large for one buffer: a run of the largest ones. */
+        pxBestFit = pxLargest;
+        pvBuffer = prvClaimFromClass( pxLargest,
+                                      ( uint32_t ) ( ( xSize + pxLargest->xBufferSize - 1U ) / pxLargest->xBufferSize ) );
+    }
+    else
+    {
+        for( ulClass = 0UL; ( ulClass < bufferpoolNUM_CLASSES ) && ( pvBuffer == NULL ); ulClass++ )
+        {
+            if( xClasses[ ulClass ].xBufferSize >= xSize )
+            {
+                if( pxBestFit == NULL )
+                {
+                    pxBestFit = &xClasses[ ulClass ];
+                }
+
+                pvBuffer = prvClaimFromClass( &xClasses[ ulClass ], 1UL );
+            }
+        }
+    }
+
+    if( ( pvBuffer == NULL ) && ( pxBestFit != NULL ) )
+    {
+        ( void ) Atomic_Increment_u32( &pxBestFit->ulFailures );
+    }
+
+    return pvBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+void BufferPool_AddRef( void * pvBuffer )
+{
+    BufferClass_t * pxClass = NULL;
+    uint32_t ulIndex = 0UL;
+    bool xFound = prvLocate( pvBuffer, &pxClass, &ulIndex );
+
+    assert( xFound == true );
+
+    if( xFound == true )
+    {
+        assert( pxClass->pulRefCounts[ ulIndex ] > 0UL );
+        ( void ) Atomic_Increment_u32( &pxClass->pulRefCounts[ ulIndex ] );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void BufferPool_Release( void * pvBuffer )
+{
+    BufferClass_t * pxClass = NULL;
+    uint32_t ulIndex = 0UL;
+    uint32_t ulPrevious = 0UL;
+    uint32_t ulBuffers = 0UL;
+
+    if( pvBuffer != NULL )
+    {
+        if( prvLocate( pvBuffer, &pxClass, &ulIndex ) == true )
+        {
+            ulPrevious = Atomic_Decrement_u32( &pxClass->pulRefCounts[ ulIndex ] );
+
+            /* Releasing a free buffer is a caller bug. */
+            assert( ulPrevious > 0UL );
+
+            if( ulPrevious == 1UL )
+            {
+                ulBuffers = pxClass->pucRunLengths[ ulIndex ];
+                ( void ) Atomic_Subtract_u32( &pxClass->ulInUse, ulBuffers );
+                ( void ) Atomic_OR_u32( &pxClass->ulFreeMask, bufferpoolALL_FREE( ulBuffers ) << ulIndex );
+            }
+        }
+        else
+        {
+            assert( false );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+size_t BufferPool_GetSize( const void * pvBuffer )
+{
+    BufferClass_t * pxClass = NULL;
+    uint32_t ulIndex = 0UL;
+    size_t xSize = 0U;
+
+    if( prvLocate( pvBuffer, &pxClass, &ulIndex ) == true )
+    {
+        xSize = pxClass->xBufferSize * pxClass->pucRunLengths[ ulIndex ];
+    }
+
+    return xSize;
+}
+
+/*-----------------------------------------------------------*/
+
+void BufferPool_GetStats( BufferPoolStats_t * pxStats )
+{
+    uint32_t ulClass = 0UL;
+
+    assert( pxStats != NULL );
+
+    for( ulClass = 0UL; ulClass < bufferpoolNUM_CLASSES; ulClass++ )
+    {
+        pxStats[ ulClass ].xBufferSize = xClasses[ ulClass ].xBufferSize;
+        pxStats[ ulClass ].ulCount = xClasses[ ulClass ].ulCount;
+        pxStats[ ulClass ].ulInUse = xClasses[ ulClass ].ulInUse;
+        pxStats[ ulClass ].ulHighWater = xClasses[ ulClass ].ulHighWater;
+        pxStats[ ulClass ].ulFailures = xClasses[ ulClass ].ulFailures;
+        pxStats[ ulClass ].ulAcquired = xClasses[ ulClass ].ulAcquired;
+    }
+}
+
+/*-----------------------------------------------------------*/
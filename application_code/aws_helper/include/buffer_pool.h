@@ -0,0 +1,95 @@
+/*
+ * buffer_pool.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_BUFFER_POOL_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_BUFFER_POOL_H_
+
+/**
+ * @file buffer_pool.h
+ * @brief Shared, size-classed pool of statically allocated buffers.
+ *
+ * Network buffers, documents and payload copies are borrowed from the pool
+ * while they are needed instead of each module holding a worst-case static
+ * array. Acquire and release never block: free buffers are tracked in one
+ * bitmap per size class that is updated with the atomic helpers of
+ * atomic.h, so the pool can be shared between tasks without a mutex.
+ * Buffers are reference counted and only return to the pool when the last
+ * holder releases them. The class sizes live in aws_bufferpool_config.h.
+ */
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Number of size classes in the pool.
+ */
+#define bufferpoolNUM_CLASSES    ( 3U )
+
+/**
+ * @brief Usage counters of one size class.
+ */
+typedef struct BufferPoolStats
+{
+    size_t xBufferSize;   /**< @brief Size of each buffer in the class. */
+    uint32_t ulCount;     /**< @brief Number of buffers in the class. */
+    uint32_t ulInUse;     /**< @brief Buffers currently borrowed, counting each buffer of a run. */
+    uint32_t ulHighWater; /**< @brief Most buffers ever borrowed at once. */
+    uint32_t ulFailures;  /**< @brief Requests that no class could serve. */
+    uint32_t ulAcquired;  /**< @brief Buffers handed out since boot. */
+} BufferPoolStats_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Borrow a buffer of at least @p xSize bytes.
+ *
+ * A request larger than the largest class is served with a run of adjacent
+ * buffers of that class, borrowed and released as one. The buffer starts
+ * with a reference count of one.
+ *
+ * @param[in] xSize Number of bytes needed.
+ *
+ * @return The buffer, or NULL if no class had a free buffer large enough.
+ */
+void * BufferPool_Acquire( size_t xSize );
+
+/**
+ * @brief Add a holder to a borrowed buffer.
+ *
+ * @param[in] pvBuffer A buffer returned by #BufferPool_Acquire.
+ */
+void BufferPool_AddRef( void * pvBuffer );
+
+/**
+ * @brief Drop a holder of a borrowed buffer. The buffer returns to the pool
+ * when the last holder releases it.
+ *
+ * @param[in] pvBuffer A buffer returned by #BufferPool_Acquire, or NULL.
+ */
+void BufferPool_Release( void * pvBuffer );
+
+/**
+ * @brief Usable size of a borrowed buffer, which may be larger than requested.
+ *
+ * @param[in] pvBuffer A buffer returned by #BufferPool_Acquire.
+ *
+ * @return The size in bytes, or 0 if @p pvBuffer is not from the pool.
+ */
+size_t BufferPool_GetSize( const void * pvBuffer );
+
+/**
+ * @brief Take a snapshot of the usage counters of every size class.
+ *
+ * @param[out] pxStats Array of #bufferpoolNUM_CLASSES entries, smallest
+ * class first.
+ */
+void BufferPool_GetStats( BufferPoolStats_t * pxStats );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_BUFFER_POOL_H_ */
@@ -0,0 +1,98 @@
+/*
+ * keep_alive.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_KEEP_ALIVE_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_KEEP_ALIVE_H_
+
+/**
+ * @file keep_alive.h
+ * @brief Adaptive MQTT keep-alive and ping scheduling.
+ *
+ * The CONNECT keep alive is set to a long broker-side safety value and the
+ * manager sends PINGREQ itself, only once the connection has been idle in
+ * both directions for the current interval. Application traffic therefore
+ * defers pings. The interval starts short and is raised after every
+ * answered ping until a ping is lost, which is taken as the NAT timeout of
+ * the path; the manager then settles on the last interval that worked.
+ * Learned intervals are kept across sessions.
+ */
+
+/* Standard includes. */
+#include <stdint.h>
+
+/* FreeRTOS include. */
+#include "FreeRTOS.h"
+
+/* Declared instead of including core_mqtt.h so that clients of the legacy
+ * MQTT library, such as the OTA task, can include this header too. */
+struct MQTTContext;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Counters describing the keep-alive manager.
+ */
+typedef struct KeepAliveStats
+{
+    uint32_t ulIntervalSeconds; /**< @brief Current ping interval. */
+    uint32_t ulLastGoodSeconds; /**< @brief Longest interval answered so far. */
+    uint32_t ulPingsSent;       /**< @brief Pings sent by the manager. */
+    uint32_t ulProbeFailures;   /**< @brief Connections lost while probing. */
+    BaseType_t xLearned;        /**< @brief pdTRUE once the NAT timeout was found. */
+} KeepAliveStats_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Keep alive to put in the MQTT CONNECT packet, in seconds.
+ */
+uint16_t KeepAlive_GetBrokerKeepAliveSeconds( void );
+
+/**
+ * @brief Current learned ping interval, in seconds.
+ *
+ * For clients that cannot defer their own pings, such as the OTA agent's
+ * MQTT connection, this is the longest keep alive known to survive the NAT.
+ */
+uint16_t KeepAlive_GetIntervalSeconds( void );
+
+/**
+ * @brief Start tracking a new MQTT session.
+ */
+void KeepAlive_OnSessionStart( void );
+
+/**
+ * @brief Note that a packet was received from the broker.
+ */
+void KeepAlive_OnPacketReceived( struct MQTTContext * pxMqttContext );
+
+/**
+ * @brief Send a PINGREQ if the connection has been idle for the current
+ * interval, and learn from the answer to the previous one.
+ *
+ * @param[in] pxMqttContext The MQTT context of a connected session.
+ *
+ * @return pdPASS unless a PINGREQ could not be sent.
+ */
+BaseType_t KeepAlive_Process( struct MQTTContext * pxMqttContext );
+
+/**
+ * @brief Note that the connection was lost.
+ *
+ * If a ping was outstanding at an interval longer than the last good one,
+ * the probe failed and the manager settles on the last good interval.
+ */
+void KeepAlive_OnConnectionLost( void );
+
+/**
+ * @brief Take a snapshot of the manager's counters.
+ *
+ * @param[out] pxStats Where to copy the counters.
+ */
+void KeepAlive_GetStats( KeepAliveStats_t * pxStats );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_KEEP_ALIVE_H_ */
@@ -66,6 +66,27 @@
     #define democonfigMQTT_BROKER_PORT    clientcredentialMQTT_BROKER_PORT
 #endif
 
+#ifndef democonfigMAX_OUTGOING_PUBLISHES
+
+/**
+ * @brief Maximum number of QoS1 publishes kept until a PUBACK is received.
+ * Must not be larger than MQTT_STATE_ARRAY_MAX_COUNT.
+ */
+    #define democonfigMAX_OUTGOING_PUBLISHES    ( 4U )
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Called when an outgoing QoS1 publish leaves the outgoing window.
+ *
+ * @param[in] usPacketIdentifier Packet identifier of the publish.
+ * @param[in] xAcknowledged true if a PUBACK was received; false if the
+ * publish was discarded because a clean session was started.
+ */
+typedef void ( * PublishAckCallback_t )( uint16_t usPacketIdentifier,
+                                         bool xAcknowledged );
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -80,7 +101,11 @@
  * @param[in] appCallback The callback function used to receive incoming
  * publishes and incoming acks from MQTT library.
  *
- * @return The status of the final connection attempt.
+ * Connection attempts are repeated through the reconnect engine until the
+ * broker accepts one.
+ *
+ * @return pdPASS once connected; pdFAIL if the MQTT library could not be
+ * initialized or unacknowledged publishes could not be resent.
  */
 BaseType_t EstablishMqttSession( MQTTContext_t * pxContext,
                                  NetworkContext_t * pxNetContext,
@@ -115,13 +140,28 @@ BaseType_t DisconnectMqttSession( MQTTContext_t * pxContext,
  * @param[in] usTopicFilterLength Indicates the length of the shadow
  * topic buffer.
  *
- * @return pdPASS if SUBSCRIBE was successfully sent;
+ * @return pdPASS if the SUBACK was received;
  * pdFAIL otherwise.
  */
 BaseType_t SubscribeToTopic( MQTTContext_t * pxContext,
                              const char * pcTopicFilter,
                              uint16_t usTopicFilterLength );
 
+/**
+ * @brief Subscribe to several MQTT topic filters with a single SUBSCRIBE
+ * packet and wait for its SUBACK.
+ *
+ * @param[in] pxContext The MQTT context for the MQTT connection.
+ * @param[in] pxSubscriptions The topic filters and their QoS.
+ * @param[in] xSubscriptionCount The number of entries in @p pxSubscriptions.
+ *
+ * @return pdPASS if the SUBACK was received;
+ * pdFAIL otherwise.
+ */
+BaseType_t SubscribeToTopics( MQTTContext_t * pxContext,
+                              const MQTTSubscribeInfo_t * pxSubscriptions,
+                              size_t xSubscriptionCount );
+
 /**
  * @brief Sends an MQTT UNSUBSCRIBE to unsubscribe from the shadow
  * topic.
@@ -141,13 +181,17 @@ BaseType_t UnsubscribeFromTopic( MQTTContext_t * pxContext,
 /**
  * @brief Publish a message to a MQTT topic.
  *
+ * A message that cannot be sent now, or that would overtake messages still
+ * held by the store-and-forward queue, is handed to PublishQueue_Enqueue()
+ * and sent once a session is up.
+ *
  * @param[in] pxContext The MQTT context for the MQTT connection.
  * @param[in] pcTopicFilter Points to the topic.
  * @param[in] topicFilterLength The length of the topic.
  * @param[in] pcPayload Points to the payload.
  * @param[in] payloadLength The length of the payload.
  *
- * @return pdPASS if PUBLISH was successfully sent;
+ * @return pdPASS if PUBLISH was successfully sent or queued;
  * pdFAIL otherwise.
  */
 BaseType_t PublishToTopic( MQTTContext_t * pxContext,
@@ -156,6 +200,41 @@ BaseType_t PublishToTopic( MQTTContext_t * pxContext,
                            const char * pcPayload,
                            size_t payloadLength );
 
+/**
+ * @brief Publish a QoS1 message without running the process loop.
+ *
+ * The topic and payload buffers must stay valid until the PUBACK for the
+ * returned packet identifier is reported to the #PublishAckCallback_t.
+ *
+ * @param[in] pxContext The MQTT context for the MQTT connection.
+ * @param[in] pcTopicFilter Points to the topic.
+ * @param[in] topicFilterLength The length of the topic.
+ * @param[in] pcPayload Points to the payload.
+ * @param[in] payloadLength The length of the payload.
+ * @param[out] pusPacketIdentifier The packet identifier used for the PUBLISH.
+ *
+ * @return pdPASS if PUBLISH was successfully sent;
+ * pdFAIL otherwise.
+ */
+BaseType_t PublishToTopicNoWait( MQTTContext_t * pxContext,
+                                 const char * pcTopicFilter,
+                                 int32_t topicFilterLength,
+                                 const char * pcPayload,
+                                 size_t payloadLength,
+                                 uint16_t * pusPacketIdentifier );
+
+/**
+ * @brief Number of free slots in the outgoing publish window.
+ */
+uint8_t GetFreeOutgoingPublishCount( void );
+
+/**
+ * @brief Register the function told about PUBACKs and discarded publishes.
+ *
+ * @param[in] xCallback The callback, or NULL to remove it.
+ */
+void SetPublishAckCallback( PublishAckCallback_t xCallback );
+
 /**
  * @brief Invoke the core MQTT library's process loop function.
  *
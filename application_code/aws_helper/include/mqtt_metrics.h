@@ -0,0 +1,172 @@
+/*
+ * mqtt_metrics.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_MQTT_METRICS_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_MQTT_METRICS_H_
+
+/**
+ * @file mqtt_metrics.h
+ * @brief Latency histograms and counters for the MQTT helpers.
+ *
+ * Durations are taken from the Cortex-M DWT cycle counter, falling back to
+ * the tick count for intervals longer than the counter can span, and are
+ * filed into fixed log2 buckets of microseconds: bucket n counts samples in
+ * [2^n, 2^(n+1)) us. Recording a sample is a handful of compares and
+ * increments with no locking; all recording is done from the task that
+ * owns the MQTT context.
+ */
+
+/* Standard includes. */
+#include <stdint.h>
+
+/* FreeRTOS include. */
+#include "FreeRTOS.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Number of log2 buckets per histogram. The last bucket also holds
+ * everything longer than it.
+ */
+#define mqttmetricsNUM_BUCKETS    ( 24U )
+
+/**
+ * @brief Histograms kept by the helpers.
+ */
+typedef enum MQTTMetricsHistogram
+{
+    eMetricsPublishToPuback = 0, /**< @brief PUBLISH sent to PUBACK received. */
+    eMetricsSubscribeRoundTrip,  /**< @brief SUBSCRIBE sent to SUBACK received. */
+    eMetricsProcessLoop,         /**< @brief One call of MQTT_ProcessLoop. */
+    eMetricsEventCallback,       /**< @brief One call of the application's event callback. */
+    eMetricsShadowUpdate,        /**< @brief Shadow update sent to its accepted or rejected answer received. */
+    eMetricsHistogramMax
+} MQTTMetricsHistogram_t;
+
+/**
+ * @brief Counters kept by the helpers.
+ */
+typedef enum MQTTMetricsCounter
+{
+    eMetricsPublishSent = 0,
+    eMetricsPublishFailed,
+    eMetricsPubackReceived,
+    eMetricsPayloadBytesSent,
+    eMetricsSubscribeSent,
+    eMetricsSubackReceived,
+    eMetricsProcessLoopCalls,
+    eMetricsProcessLoopFailures,
+    eMetricsPacketsReceived,
+    eMetricsShadowSyncs,      /**< @brief Shadow state syncs completed. */
+    eMetricsShadowRoundTrips, /**< @brief Broker round trips those syncs took. */
+    eMetricsShadowCoalesced,  /**< @brief Shadow updates saved by merging changes. */
+    eMetricsShadowBytes,      /**< @brief Bytes of shadow update documents and of their answers. */
+    eMetricsCounterMax
+} MQTTMetricsCounter_t;
+
+/**
+ * @brief Start time of a measured interval.
+ */
+typedef struct MQTTMetricsTimestamp
+{
+    uint32_t ulCycles;
+    TickType_t xTicks;
+} MQTTMetricsTimestamp_t;
+
+/**
+ * @brief Contents of one histogram.
+ */
+typedef struct MQTTMetricsHistogramData
+{
+    uint32_t ulBuckets[ mqttmetricsNUM_BUCKETS ];
+    uint32_t ulCount;
+    uint32_t ulMaxUs;
+    uint64_t ullSumUs;
+} MQTTMetricsHistogramData_t;
+
+/**
+ * @brief A copy of every counter and histogram.
+ */
+typedef struct MQTTMetricsSnapshot
+{
+    uint32_t ulCounters[ eMetricsCounterMax ];
+    MQTTMetricsHistogramData_t xHistograms[ eMetricsHistogramMax ];
+    TickType_t xTakenAt;
+} MQTTMetricsSnapshot_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Enable the cycle counter and start the task that queues the
+ * metrics telemetry. Call once, after PublishQueue_Init(), before the MQTT
+ * connection is established.
+ */
+void MQTTMetrics_Init( void );
+
+/**
+ * @brief Take the start time of an interval.
+ *
+ * @param[out] pxTimestamp Where to store the start time.
+ */
+void MQTTMetrics_Start( MQTTMetricsTimestamp_t * pxTimestamp );
+
+/**
+ * @brief Time elapsed since @p pxStart.
+ *
+ * @param[in] pxStart Start time taken by #MQTTMetrics_Start.
+ *
+ * @return The elapsed time in microseconds.
+ */
+uint32_t MQTTMetrics_ElapsedUs( const MQTTMetricsTimestamp_t * pxStart );
+
+/**
+ * @brief File the time elapsed since @p pxStart into a histogram.
+ *
+ * @param[in] eHistogram The histogram to update.
+ * @param[in] pxStart Start time taken by #MQTTMetrics_Start.
+ */
+void MQTTMetrics_Record( MQTTMetricsHistogram_t eHistogram,
+                         const MQTTMetricsTimestamp_t * pxStart );
+
+/**
+ * @brief Add to a counter.
+ *
+ * @param[in] eCounter The counter to update.
+ * @param[in] ulAmount The amount to add.
+ */
+void MQTTMetrics_Count( MQTTMetricsCounter_t eCounter,
+                        uint32_t ulAmount );
+
+/**
+ * @brief Copy every counter and histogram.
+ *
+ * @param[out] pxSnapshot Where to copy them.
+ */
+void MQTTMetrics_GetSnapshot( MQTTMetricsSnapshot_t * pxSnapshot );
+
+/**
+ * @brief Estimate a percentile from a histogram.
+ *
+ * @param[in] pxHistogram The histogram.
+ * @param[in] ulPermille The percentile in thousandths, e.g. 990 for p99.
+ *
+ * @return The upper bound, in microseconds, of the bucket holding the
+ * percentile; 0 if the histogram is empty.
+ */
+uint32_t MQTTMetrics_Percentile( const MQTTMetricsHistogramData_t * pxHistogram,
+                                 uint32_t ulPermille );
+
+/**
+ * @brief Queue a compact metrics telemetry message if the publish interval
+ * has elapsed since the last one.
+ *
+ * The metrics task calls this every interval, so the message is queued, and
+ * spilled to flash if need be, while the broker is unreachable.
+ */
+void MQTTMetrics_PublishIfDue( void );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_MQTT_METRICS_H_ */
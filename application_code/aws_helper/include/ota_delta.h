@@ -0,0 +1,153 @@
+/*
+ * ota_delta.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_DELTA_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_DELTA_H_
+
+/**
+ * @file ota_delta.h
+ * @brief Streaming application of delta OTA images.
+ *
+ * A delta image is a patch that turns the running image into the new one,
+ * made on the host by ota_delta_generator/ota_delta_gen.py. Like bsdiff, it
+ * is a sequence of records, each of which
+ * - adds a run of difference bytes to the same number of old bytes,
+ * - appends a run of new bytes,
+ * - moves the position in the old image.
+ * Code that only moved leaves differences that are mostly zero, and those
+ * are stored as run lengths, so the patch of a small change is small without
+ * a compressor.
+ *
+ * Layout, little-endian, numbers as LEB128 varints:
+ *
+ *     header   "ODL1", old size (4), new size (4), SHA-1 of the old image (20)
+ *     record   diff length, extra length, seek (zigzag)
+ *              diff: pairs of (zero count, literal count, literals) covering
+ *                    diff length bytes
+ *              extra: extra length bytes
+ *
+ * The patch is read and the new image written through callbacks, a buffer
+ * at a time, and the old image is read in place, so the RAM used is the two
+ * buffers the caller hands in.
+ */
+
+/* Standard includes. */
+#include <stdint.h>
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Bit of the file attributes in the job document that marks a delta
+ * image.
+ */
+#define otadeltaFILE_ATTRIBUTE    ( 0x00000100UL )
+
+/**
+ * @brief "ODL1".
+ */
+#define otadeltaMAGIC             ( 0x314C444FUL )
+
+/**
+ * @brief Size of the patch header.
+ */
+#define otadeltaHEADER_SIZE       ( 32U )
+
+/**
+ * @brief Size of the digest of the old image.
+ */
+#define otadeltaDIGEST_SIZE       ( 20U )
+
+/**
+ * @brief Return codes of the delta applier.
+ */
+typedef enum OtaDeltaStatus
+{
+    eOtaDeltaSuccess = 0,   /**< @brief The new image was written in full. */
+    eOtaDeltaBadParameter,  /**< @brief A pointer or size is invalid. */
+    eOtaDeltaBadPatch,      /**< @brief The patch is malformed or for a larger old image. */
+    eOtaDeltaReadFailed,    /**< @brief The patch could not be read. */
+    eOtaDeltaWriteFailed    /**< @brief The new image could not be written. */
+} OtaDeltaStatus_t;
+
+/**
+ * @brief The patch header.
+ */
+typedef struct OtaDeltaHeader
+{
+    uint32_t ulOldSize;
+    uint32_t ulNewSize;
+    uint8_t ucOldDigest[ otadeltaDIGEST_SIZE ];
+} OtaDeltaHeader_t;
+
+/**
+ * @brief Read part of the patch.
+ *
+ * @return Number of bytes read, which may be fewer than asked for only at
+ * the end of the patch, or a negative error code.
+ */
+typedef int32_t ( * OtaDeltaRead_t )( void * pvContext,
+                                      uint32_t ulOffset,
+                                      uint8_t * pucBuffer,
+                                      uint32_t ulLength );
+
+/**
+ * @brief Write part of the new image. Parts come in order.
+ *
+ * @return @p ulLength, or a negative error code.
+ */
+typedef int32_t ( * OtaDeltaWrite_t )( void * pvContext,
+                                       uint32_t ulOffset,
+                                       const uint8_t * pucData,
+                                       uint32_t ulLength );
+
+/**
+ * @brief What OtaDelta_Apply() works with.
+ */
+typedef struct OtaDeltaParams
+{
+    const uint8_t * pucOld;   /**< @brief The old image, read in place. */
+    uint32_t ulOldSize;       /**< @brief Bytes readable at pucOld. */
+    uint32_t ulPatchSize;     /**< @brief Size of the patch, header included. */
+    OtaDeltaRead_t xRead;     /**< @brief Reads the patch. */
+    OtaDeltaWrite_t xWrite;   /**< @brief Writes the new image. */
+    void * pvContext;         /**< @brief Handed to xRead and xWrite. */
+    uint8_t * pucInput;       /**< @brief Buffer the patch is read into. */
+    uint32_t ulInputSize;
+    uint8_t * pucOutput;      /**< @brief Buffer the new image is built in; each write but the last is this size. */
+    uint32_t ulOutputSize;
+} OtaDeltaParams_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Parse the header at the start of a patch.
+ *
+ * @param[in] pucData The first bytes of the patch.
+ * @param[in] ulLength Number of bytes at @p pucData.
+ * @param[out] pxHeader The header.
+ *
+ * @return #eOtaDeltaSuccess, or #eOtaDeltaBadPatch if it is not a patch.
+ */
+OtaDeltaStatus_t OtaDelta_ParseHeader( const uint8_t * pucData,
+                                       uint32_t ulLength,
+                                       OtaDeltaHeader_t * pxHeader );
+
+/**
+ * @brief Build the new image from the old one and the patch.
+ *
+ * The digest of the old image is not checked here; the caller checks it
+ * against the header first.
+ *
+ * @param[in] pxParams The images, callbacks and buffers.
+ * @param[out] pulNewSize Size of the new image written; may be NULL.
+ *
+ * @return #eOtaDeltaSuccess once the whole patch was applied.
+ */
+OtaDeltaStatus_t OtaDelta_Apply( const OtaDeltaParams_t * pxParams,
+                                 uint32_t * pulNewSize );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_DELTA_H_ */
@@ -0,0 +1,207 @@
+/*
+ * ota_http.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_HTTP_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_HTTP_H_
+
+/**
+ * @file ota_http.h
+ * @brief OTA file download over HTTP range requests.
+ *
+ * The blocks an OTA file still misses are merged into ranges of up to
+ * otahttpconfigRANGE_BLOCKS blocks, which are requested on one keep-alive
+ * connection with up to otahttpconfigMAX_OUTSTANDING requests ahead of
+ * their responses (HTTP/1.1 pipelining). Each body is received straight
+ * into a block buffer and handed to the sink a block at a time, so nothing
+ * is copied between the socket and prvPAL_WriteBlock().
+ *
+ * The connection is the caller's, through a transport interface, so the
+ * same code runs over TLS to S3 and over plain TCP to a local stand-in.
+ *
+ * When the job of a file gives an HTTPS URL, the PAL offers the file as it
+ * creates it. The OTA task then suspends the agent, fetches every block but
+ * the last into the file, and resumes the agent, which receives the last
+ * block itself and closes the file as after any download.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Transport interface, shared with coreMQTT and coreHTTP. */
+#include "transport_interface.h"
+
+/* OTA agent, for the file context. */
+#include "aws_iot_ota_agent.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Return codes of the HTTP data path.
+ */
+typedef enum OtaHttpStatus
+{
+    eOtaHttpSuccess = 0,  /**< @brief Every range was received. */
+    eOtaHttpBadParameter, /**< @brief A pointer or length is invalid. */
+    eOtaHttpNoMemory,     /**< @brief No buffer could be taken from the pool. */
+    eOtaHttpNetworkError, /**< @brief The connection failed, timed out or was closed by the server. */
+    eOtaHttpBadResponse,  /**< @brief A response was not the range asked for. */
+    eOtaHttpSinkFailed    /**< @brief The sink did not take a block. */
+} OtaHttpStatus_t;
+
+/**
+ * @brief A byte range of the file.
+ */
+typedef struct OtaHttpRange
+{
+    uint32_t ulOffset;
+    uint32_t ulLength;
+} OtaHttpRange_t;
+
+/**
+ * @brief Takes the blocks of a range as they are received, with the same
+ * contract as prvPAL_WriteBlock().
+ *
+ * @param[in] pvContext The context given with the sink.
+ * @param[in] ulOffset Offset of the block in the file.
+ * @param[in] pucData The block; valid only during the call.
+ * @param[in] ulSize Size of the block.
+ *
+ * @return @p ulSize if the block was taken; anything else stops the download.
+ */
+typedef int16_t ( * OtaHttpSink_t )( void * pvContext,
+                                     uint32_t ulOffset,
+                                     uint8_t * pucData,
+                                     uint32_t ulSize );
+
+/**
+ * @brief Told when a file is offered for an HTTP fetch.
+ *
+ * Runs in the agent task; it must not block.
+ */
+typedef void ( * OtaHttpOfferCallback_t )( void );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Merge the blocks still missing from a file into ranges.
+ *
+ * @param[in] C The file context; a set bit of its bitmap is a missing block.
+ * @param[out] pxRanges Where to write the ranges.
+ * @param[in] xMaxRanges Number of ranges @p pxRanges holds.
+ *
+ * @return Number of ranges written. More ranges may be missing if it equals
+ * @p xMaxRanges.
+ */
+size_t OtaHttp_RangesFromBitmap( const OTA_FileContext_t * C,
+                                 OtaHttpRange_t * pxRanges,
+                                 size_t xMaxRanges );
+
+/**
+ * @brief Download ranges of a file and hand their blocks to a sink.
+ *
+ * Ranges must start on a block boundary. The connection is unusable after
+ * a failure and must be closed by the caller.
+ *
+ * @param[in] pxTransport The connection to the server.
+ * @param[in] pcHost Host header value.
+ * @param[in] pcPath Path of the file, including any query of a presigned URL.
+ * @param[in] pxRanges The ranges.
+ * @param[in] xRangeCount Number of ranges.
+ * @param[in] xMaxOutstanding Most requests in flight at once, at least 1.
+ * @param[in] xSink Takes the blocks.
+ * @param[in] pvSinkContext Handed to @p xSink.
+ * @param[out] pxRangesDone Number of ranges received in full; may be NULL.
+ *
+ * @return #eOtaHttpSuccess once every range was received.
+ */
+OtaHttpStatus_t OtaHttp_FetchRanges( const TransportInterface_t * pxTransport,
+                                     const char * pcHost,
+                                     const char * pcPath,
+                                     const OtaHttpRange_t * pxRanges,
+                                     size_t xRangeCount,
+                                     size_t xMaxOutstanding,
+                                     OtaHttpSink_t xSink,
+                                     void * pvSinkContext,
+                                     size_t * pxRangesDone );
+
+/**
+ * @brief Download the blocks still missing from an OTA file into it.
+ *
+ * Blocks are written with prvPAL_WriteBlock() and marked as received in the
+ * file context, as the agent does for blocks received over MQTT. Called
+ * again after a failure, only what is still missing is requested.
+ *
+ * @param[in] pxTransport The connection to the server.
+ * @param[in] pcHost Host header value.
+ * @param[in] pcPath Path of the file.
+ * @param[in,out] C The file context, created by prvPAL_CreateFileForRx().
+ * @param[in] xLeaveLastBlock Leave the last missing block for the agent,
+ * which closes the file once it has received it.
+ *
+ * @return #eOtaHttpSuccess once no block is missing, or only the one left.
+ */
+OtaHttpStatus_t OtaHttp_FetchFile( const TransportInterface_t * pxTransport,
+                                   const char * pcHost,
+                                   const char * pcPath,
+                                   OTA_FileContext_t * C,
+                                   bool xLeaveLastBlock );
+
+/**
+ * @brief Split an HTTPS URL into its host and its path.
+ *
+ * @param[in] pcUrl The URL, e.g. the presigned URL of a job.
+ * @param[out] ppcHost Set to the start of the host in @p pcUrl.
+ * @param[out] pxHostLength Set to the length of the host.
+ * @param[out] ppcPath Set to the path, with its query, to the end of @p pcUrl.
+ *
+ * @return true if @p pcUrl is an HTTPS URL with a host and a path.
+ */
+bool OtaHttp_ParseUrl( const char * pcUrl,
+                       const char ** ppcHost,
+                       size_t * pxHostLength,
+                       const char ** ppcPath );
+
+/**
+ * @brief Register the function told when a file is offered.
+ *
+ * @param[in] xCallback The callback, or NULL to remove it.
+ */
+void OtaHttp_SetOfferCallback( OtaHttpOfferCallback_t xCallback );
+
+/**
+ * @brief Offer the file just created for an HTTP fetch, if its job gives an
+ * HTTPS URL and blocks are left to fetch.
+ *
+ * Called by the PAL from prvPAL_CreateFileForRx(). A job is offered once, so
+ * the file the agent creates again when it is resumed is not.
+ *
+ * @param[in] C The file context.
+ */
+void OtaHttp_OfferFile( OTA_FileContext_t * C );
+
+/**
+ * @brief Withdraw the file offered, because the PAL closed or aborted it.
+ */
+void OtaHttp_WithdrawFile( void );
+
+/**
+ * @brief The file offered and not withdrawn, or NULL.
+ *
+ * Only to be used while the agent is suspended, as it owns the context.
+ */
+OTA_FileContext_t * OtaHttp_GetOfferedFile( void );
+
+/**
+ * @brief Download a file from a local HTTP server with one request in flight
+ * and with otahttpconfigMAX_OUTSTANDING, and log the rates. Does nothing
+ * unless otahttpconfigBENCHMARK_FILE_SIZE is set.
+ */
+void OtaHttp_RunBenchmark( void );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_HTTP_H_ */
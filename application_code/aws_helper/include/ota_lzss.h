@@ -0,0 +1,222 @@
+/*
+ * ota_lzss.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_LZSS_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_LZSS_H_
+
+/**
+ * @file ota_lzss.h
+ * @brief Streaming decompression of compressed OTA images.
+ *
+ * A compressed image is an LZSS stream, made on the host by
+ * ota_lzss_generator/ota_lzss_gen.py, laid out like heatshrink's: bits are
+ * read most significant first, and each symbol is either
+ * - 1, then a literal byte, or
+ * - 0, then (distance - 1) in window bits and (length - 1) in lookahead
+ *   bits, copying from the bytes already produced.
+ *
+ * Layout, little-endian:
+ *
+ *     header   "OLZ1", image size (4), window bits (1), lookahead bits (1),
+ *              two zero bytes
+ *     stream   the symbols, padded with zero bits to a whole byte
+ *
+ * The decoder keeps the last 2^window bits bytes produced and nothing
+ * else, so the RAM needed is that window plus the input and output
+ * buffers the caller hands in.
+ *
+ * The file is either read through a callback by OtaLzss_Decompress(), or
+ * fed to a decoder in parts, in order, as it arrives: OtaLzss_Start(), then
+ * OtaLzss_Feed() for each part and OtaLzss_Finish() at the end.
+ */
+
+/* Standard includes. */
+#include <stdint.h>
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Bit of the file attributes in the job document that marks a
+ * compressed image.
+ */
+#define otalzssFILE_ATTRIBUTE      ( 0x00000200UL )
+
+/**
+ * @brief "OLZ1".
+ */
+#define otalzssMAGIC               ( 0x315A4C4FUL )
+
+/**
+ * @brief Size of the header.
+ */
+#define otalzssHEADER_SIZE         ( 12U )
+
+/**
+ * @brief Largest window, in bits, a stream may use.
+ */
+#define otalzssMAX_WINDOW_BITS     ( 12U )
+
+/**
+ * @brief Largest lookahead, in bits, a stream may use.
+ */
+#define otalzssMAX_LOOKAHEAD_BITS  ( 8U )
+
+/**
+ * @brief Return codes of the decoder.
+ */
+typedef enum OtaLzssStatus
+{
+    eOtaLzssSuccess = 0,    /**< @brief The image was written in full. */
+    eOtaLzssBadParameter,   /**< @brief A pointer or size is invalid. */
+    eOtaLzssBadStream,      /**< @brief The stream is malformed or does not match its header. */
+    eOtaLzssReadFailed,     /**< @brief The stream could not be read. */
+    eOtaLzssWriteFailed     /**< @brief The image could not be written. */
+} OtaLzssStatus_t;
+
+/**
+ * @brief The header.
+ */
+typedef struct OtaLzssHeader
+{
+    uint32_t ulImageSize;
+    uint8_t ucWindowBits;
+    uint8_t ucLookaheadBits;
+} OtaLzssHeader_t;
+
+/**
+ * @brief Read part of the compressed file.
+ *
+ * @return Number of bytes read, which may be fewer than asked for only at
+ * the end of the file, or a negative error code.
+ */
+typedef int32_t ( * OtaLzssRead_t )( void * pvContext,
+                                     uint32_t ulOffset,
+                                     uint8_t * pucBuffer,
+                                     uint32_t ulLength );
+
+/**
+ * @brief Write part of the image. Parts come in order.
+ *
+ * @return @p ulLength, or a negative error code.
+ */
+typedef int32_t ( * OtaLzssWrite_t )( void * pvContext,
+                                      uint32_t ulOffset,
+                                      const uint8_t * pucData,
+                                      uint32_t ulLength );
+
+/**
+ * @brief What OtaLzss_Decompress() and a decoder work with.
+ */
+typedef struct OtaLzssParams
+{
+    uint32_t ulPackedSize;    /**< @brief Size of the compressed file, header included. */
+    OtaLzssRead_t xRead;      /**< @brief Reads the compressed file; not used by a decoder. */
+    OtaLzssWrite_t xWrite;    /**< @brief Writes the image. */
+    void * pvContext;         /**< @brief Handed to xRead and xWrite. */
+    uint8_t * pucInput;       /**< @brief Buffer the compressed file is read into; not used by a decoder. */
+    uint32_t ulInputSize;
+    uint8_t * pucOutput;      /**< @brief Buffer the image is built in; each write but the last is this size. */
+    uint32_t ulOutputSize;
+    uint8_t * pucWindow;      /**< @brief 2^window bits bytes of history. */
+    uint32_t ulWindowSize;
+} OtaLzssParams_t;
+
+/**
+ * @brief State of a decompression fed the file in parts.
+ *
+ * Between two parts it holds the window, the bits of the symbol not
+ * complete yet and the image not written out yet, so the parts may be cut
+ * anywhere.
+ */
+typedef struct OtaLzssDecoder
+{
+    OtaLzssParams_t xParams;
+    OtaLzssHeader_t xHeader;
+    uint8_t ucHeader[ otalzssHEADER_SIZE ];
+    uint32_t ulConsumed;      /**< @brief Bytes of the file taken, header included. */
+    uint32_t ulField;         /**< @brief The part of a symbol being read. */
+    uint32_t ulValue;         /**< @brief Its bits read so far. */
+    uint32_t ulBitsWanted;    /**< @brief Its bits still to read. */
+    uint32_t ulDistance;      /**< @brief Distance of the back-reference being read. */
+    uint32_t ulProduced;      /**< @brief Bytes of the image produced. */
+    uint32_t ulWindowHead;    /**< @brief Where the next byte goes in the window. */
+    uint32_t ulWindowMask;
+    uint32_t ulOutputFill;    /**< @brief Bytes in the output buffer. */
+    uint32_t ulWritten;       /**< @brief Bytes of the image written. */
+    OtaLzssStatus_t xStatus;
+} OtaLzssDecoder_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Parse the header at the start of a compressed file.
+ *
+ * @param[in] pucData The first bytes of the file.
+ * @param[in] ulLength Number of bytes at @p pucData.
+ * @param[out] pxHeader The header.
+ *
+ * @return #eOtaLzssSuccess, or #eOtaLzssBadStream if it is not a compressed
+ * image or needs a larger window or lookahead than supported.
+ */
+OtaLzssStatus_t OtaLzss_ParseHeader( const uint8_t * pucData,
+                                     uint32_t ulLength,
+                                     OtaLzssHeader_t * pxHeader );
+
+/**
+ * @brief Start a decoder.
+ *
+ * @param[out] pxDecoder The decoder.
+ * @param[in] pxParams The size of the file, the write callback and the
+ * buffers; they must outlive the decoder. The window must be as large as the
+ * header of the file asks for.
+ *
+ * @return #eOtaLzssSuccess, or #eOtaLzssBadParameter.
+ */
+OtaLzssStatus_t OtaLzss_Start( OtaLzssDecoder_t * pxDecoder,
+                               const OtaLzssParams_t * pxParams );
+
+/**
+ * @brief Decompress the next part of the file.
+ *
+ * The image is written out whenever the output buffer is full.
+ *
+ * @param[in] pxDecoder The decoder.
+ * @param[in] pucData The part, which follows the last one fed.
+ * @param[in] ulLength Number of bytes at @p pucData.
+ *
+ * @return #eOtaLzssSuccess, or the error that stopped the decoder; it stays
+ * stopped.
+ */
+OtaLzssStatus_t OtaLzss_Feed( OtaLzssDecoder_t * pxDecoder,
+                              const uint8_t * pucData,
+                              uint32_t ulLength );
+
+/**
+ * @brief Write out the rest of the image and check the file ended with it.
+ *
+ * @param[in] pxDecoder The decoder.
+ * @param[out] pulImageSize Size of the image written; may be NULL.
+ *
+ * @return #eOtaLzssSuccess once the whole image was written and the whole
+ * file fed.
+ */
+OtaLzssStatus_t OtaLzss_Finish( OtaLzssDecoder_t * pxDecoder,
+                                uint32_t * pulImageSize );
+
+/**
+ * @brief Decompress an image.
+ *
+ * @param[in] pxParams The callbacks and buffers.
+ * @param[out] pulImageSize Size of the image written; may be NULL.
+ *
+ * @return #eOtaLzssSuccess once the whole image was written and the whole
+ * stream consumed.
+ */
+OtaLzssStatus_t OtaLzss_Decompress( const OtaLzssParams_t * pxParams,
+                                    uint32_t * pulImageSize );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_LZSS_H_ */
@@ -0,0 +1,151 @@
+/*
+ * ota_mqtt.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_MQTT_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_MQTT_H_
+
+/**
+ * @file ota_mqtt.h
+ * @brief Carries the MQTT traffic of the OTA agent over the coreMQTT
+ * connection of the shadow task.
+ *
+ * The OTA agent talks to the broker through the legacy MQTT library. The
+ * bridge is the network connection that library is given in place of a TLS
+ * socket: the packets it sends are taken apart and carried out by the shadow
+ * task on its own connection, and the answers and the publishes on OTA
+ * topics are handed back to it as packets.
+ *
+ * - CONNECT, SUBSCRIBE, UNSUBSCRIBE and PUBLISH wait in a message buffer
+ *   until the shadow task calls OtaMqtt_Process(). It accepts the CONNECT,
+ *   sends the others on its connection and answers them with CONNACK,
+ *   SUBACK, UNSUBACK or PUBACK. A CONNECT made while no shadow session is
+ *   up fails to send.
+ * - DISCONNECT closes the bridge; PINGREQ is not needed, the shadow
+ *   connection keeps the broker alive.
+ * - Publishes the shadow task receives on an OTA filter are given to
+ *   OtaMqtt_Dispatch() and handed to the agent at QoS0.
+ *
+ * coreMQTT is not thread safe, so only the shadow task touches it. When its
+ * session ends the bridge is closed and the disconnect callback is called;
+ * the agent is suspended and connects again once the next session is up.
+ *
+ * Publishes of the agent go out at QoS0 and are acknowledged once written to
+ * the connection. The agent repeats its job and block requests on its own
+ * timers, so nothing has to be kept in the outgoing window the shadow and
+ * the publish queue already share.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* FreeRTOS include. */
+#include "FreeRTOS.h"
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/* Legacy network interface. */
+#include "platform/iot_network.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Called when the shadow session under an open bridge ended.
+ *
+ * Runs in the shadow task; it must not block.
+ */
+typedef void ( * OtaMqttDisconnectCallback_t )( void );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Create the buffer and locks of the bridge.
+ *
+ * Called once at startup, before the shadow and OTA tasks run.
+ *
+ * @return pdPASS on success; pdFAIL otherwise.
+ */
+BaseType_t OtaMqtt_Init( void );
+
+/**
+ * @brief The legacy network interface of the bridge.
+ *
+ * Given to IotMqtt_Connect() with the connection of OtaMqtt_GetConnection()
+ * and createNetworkConnection set to false.
+ */
+const IotNetworkInterface_t * OtaMqtt_GetNetworkInterface( void );
+
+/**
+ * @brief The connection to give with OtaMqtt_GetNetworkInterface().
+ */
+void * OtaMqtt_GetConnection( void );
+
+/**
+ * @brief Register the function told when the bridge loses its session.
+ *
+ * @param[in] xCallback The callback, or NULL to remove it.
+ */
+void OtaMqtt_SetDisconnectCallback( OtaMqttDisconnectCallback_t xCallback );
+
+/**
+ * @brief Wait until the shadow task has a session up.
+ *
+ * @param[in] xTicksToWait The longest to wait.
+ *
+ * @return true if a session is up.
+ */
+bool OtaMqtt_WaitForSession( TickType_t xTicksToWait );
+
+/*-----------------------------------------------------------*/
+
+/* The functions below are called by the task that owns the connection. */
+
+/**
+ * @brief Accept connections from the agent on the new session.
+ *
+ * The session is clean, so nothing of an earlier one is restored; the agent
+ * subscribes again when it is resumed.
+ */
+void OtaMqtt_StartSession( void );
+
+/**
+ * @brief Close the bridge, drop the packets still waiting and forget the
+ * filters, because the session ended.
+ */
+void OtaMqtt_EndSession( void );
+
+/**
+ * @brief Send the packets the agent is waiting on and answer them.
+ *
+ * @param[in] pxMqttContext The connected MQTT context.
+ *
+ * @return pdFAIL if a publish could not be written to the connection;
+ * pdPASS otherwise.
+ */
+BaseType_t OtaMqtt_Process( MQTTContext_t * pxMqttContext );
+
+/**
+ * @brief Whether the agent is connected through the bridge.
+ *
+ * The owner polls faster while it is, so block requests are not held up by
+ * a long process loop.
+ */
+bool OtaMqtt_IsOpen( void );
+
+/**
+ * @brief Hand an incoming publish to the agent if it is on an OTA filter.
+ *
+ * Called from the event callback of the owner.
+ *
+ * @param[in] pxPublishInfo The incoming publish.
+ *
+ * @return true if the topic matched an OTA filter.
+ */
+bool OtaMqtt_Dispatch( const MQTTPublishInfo_t * pxPublishInfo );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_MQTT_H_ */
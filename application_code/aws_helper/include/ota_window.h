@@ -0,0 +1,96 @@
+/*
+ * ota_window.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_WINDOW_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_WINDOW_H_
+
+/**
+ * @file ota_window.h
+ * @brief Adaptive number of blocks per OTA data request.
+ *
+ * The window grows by one block after each request that was answered at a
+ * better block rate than the one before it, and is halved when a block is
+ * dropped for want of a data buffer or a request goes unanswered, the way
+ * TCP sizes its congestion window. On a good link the round trip between
+ * requests is spread over more blocks; on a poor one the agent never asks
+ * for more than its buffers and the link can take.
+ *
+ * otaconfigMAX_NUM_BLOCKS_REQUEST is defined as OtaWindow_GetBlocks(). The
+ * agent expands it more than once for a request, for the request itself and
+ * for the blocks it counts down to the next one, so the window is taken once
+ * per request and every read until the next block returns that value. The
+ * PAL reports every block it writes, which starts a new request. Both run in
+ * the OTA agent task; the statistics may be read from any task.
+ *
+ * This header is included by the OTA agent configuration, so it must not
+ * include any OTA header itself.
+ */
+
+/* Standard includes. */
+#include <stdint.h>
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Statistics of the file being received, or of the last one.
+ */
+typedef struct OtaWindowStats
+{
+    uint32_t ulWindowBlocks;    /**< @brief Blocks asked for per request now. */
+    uint32_t ulBlocks;          /**< @brief Blocks written. */
+    uint32_t ulBytes;           /**< @brief Bytes written. */
+    uint32_t ulBytesPerSecond;  /**< @brief Bytes written per second since the file was created. */
+    uint32_t ulDuplicates;      /**< @brief Packets processed that were not written, mostly blocks received twice. */
+    uint32_t ulDropped;         /**< @brief Packets dropped for want of a data buffer. */
+    uint32_t ulCuts;            /**< @brief Times the window was halved. */
+} OtaWindowStats_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Start over for a file just created or reopened.
+ */
+void OtaWindow_Start( void );
+
+/**
+ * @brief Account for a block written to the file.
+ *
+ * @param[in] ulBytes Size of the block.
+ */
+void OtaWindow_BlockReceived( uint32_t ulBytes );
+
+/**
+ * @brief Blocks to ask for in the next request.
+ *
+ * The first call after a block was written takes the window, a drop since
+ * then included; the calls after it return the same value.
+ */
+uint32_t OtaWindow_GetBlocks( void );
+
+/**
+ * @brief Copy the statistics.
+ *
+ * @param[out] pxStats Where to copy them.
+ */
+void OtaWindow_GetStats( OtaWindowStats_t * pxStats );
+
+/**
+ * @brief Bytes written per second since the file was created.
+ *
+ * Completes the agent's OTA_GetPackets* counters.
+ */
+uint32_t OTA_GetPacketsThroughput( void );
+
+/**
+ * @brief Packets processed for the file that were not written, mostly blocks
+ * received twice.
+ *
+ * Completes the agent's OTA_GetPackets* counters.
+ */
+uint32_t OTA_GetPacketsDuplicated( void );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_OTA_WINDOW_H_ */
@@ -0,0 +1,129 @@
+/*
+ * publish_queue.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_PUBLISH_QUEUE_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_PUBLISH_QUEUE_H_
+
+/**
+ * @file publish_queue.h
+ * @brief Bounded store-and-forward queue in front of the MQTT publish path.
+ *
+ * Messages are copied into a RAM ring. When the ring fills up the oldest
+ * records are spilled to a ring of segment files on the SimpleLink file
+ * system, so telemetry produced during a Wi-Fi outage survives until the
+ * broker is reachable again. Once a session is up the queue drains oldest
+ * first, rate limited, through the QoS1 outgoing publish window of
+ * mqtt_demo_helpers.c. A record is only released once its PUBACK arrives.
+ *
+ * The metrics telemetry is queued by a task of its own, so it is kept while
+ * no session is up, and PublishToTopic() queues what it cannot send. Shadow
+ * requests are not queued: they are sent with PublishToTopicNoWait() and the
+ * shadow task fetches and reports its whole state again at the start of
+ * every session instead.
+ */
+
+/* Standard includes. */
+#include <stdint.h>
+#include <stddef.h>
+
+/* FreeRTOS include. */
+#include "FreeRTOS.h"
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Counters describing the state of the queue.
+ */
+typedef struct PublishQueueStats
+{
+    uint32_t ulRamDepth;               /**< @brief Records waiting in RAM. */
+    uint32_t ulFlashDepth;             /**< @brief Records waiting in flash segments. */
+    uint32_t ulInFlight;               /**< @brief Records sent and waiting for a PUBACK. */
+    uint32_t ulEnqueued;               /**< @brief Records accepted since boot. */
+    uint32_t ulPublished;              /**< @brief Records acknowledged by the broker since boot. */
+    uint32_t ulSpilled;                /**< @brief Records written to flash since boot. */
+    uint32_t ulDroppedOverflow;        /**< @brief Records discarded because RAM and flash were full. */
+    uint32_t ulDroppedTooLarge;        /**< @brief Records rejected because the topic or payload did not fit. */
+    uint32_t ulDroppedFlashError;      /**< @brief Records lost to file system errors. */
+    uint32_t ulDrainMessagesPerSecond; /**< @brief Throughput of the last completed drain. */
+    uint32_t ulDrainBytesPerSecond;    /**< @brief Payload throughput of the last completed drain. */
+} PublishQueueStats_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Initialize the queue and recover any segments left in flash by a
+ * previous boot.
+ *
+ * Must be called once, after the network processor was started by
+ * WIFI_On(), before any other function of this module. Records
+ * recovered from flash are delivered at least once; a segment that was only
+ * partly acknowledged before a reset is sent again from its start.
+ *
+ * @return pdPASS if the queue is ready; pdFAIL otherwise.
+ */
+BaseType_t PublishQueue_Init( void );
+
+/**
+ * @brief Copy a QoS1 message into the queue.
+ *
+ * This never touches the network, so it can be called while the broker is
+ * unreachable.
+ *
+ * @param[in] pcTopic The topic to publish to.
+ * @param[in] usTopicLength The length of @p pcTopic.
+ * @param[in] pcPayload The payload to publish.
+ * @param[in] xPayloadLength The length of @p pcPayload.
+ *
+ * @return pdPASS if the message was queued; pdFAIL if it was rejected.
+ */
+BaseType_t PublishQueue_Enqueue( const char * pcTopic,
+                                 uint16_t usTopicLength,
+                                 const char * pcPayload,
+                                 size_t xPayloadLength );
+
+/**
+ * @brief Send as many queued records as the rate limit and the in-flight
+ * window allow.
+ *
+ * Does not wait for acknowledgements; the caller's process loop delivers the
+ * PUBACKs that release records.
+ *
+ * @param[in] pxMqttContext The MQTT context of a connected session.
+ *
+ * @return pdPASS if nothing failed; pdFAIL if a PUBLISH could not be sent.
+ */
+BaseType_t PublishQueue_Drain( MQTTContext_t * pxMqttContext );
+
+/**
+ * @brief Drain and run the process loop until the queue is empty or
+ * @p ulTimeoutMs has elapsed.
+ *
+ * @param[in] pxMqttContext The MQTT context of a connected session.
+ * @param[in] ulTimeoutMs The maximum time to spend flushing.
+ *
+ * @return pdPASS if the connection stayed healthy; pdFAIL otherwise.
+ */
+BaseType_t PublishQueue_Flush( MQTTContext_t * pxMqttContext,
+                               uint32_t ulTimeoutMs );
+
+/**
+ * @brief Number of records not yet acknowledged, wherever they are held.
+ */
+uint32_t PublishQueue_GetDepth( void );
+
+/**
+ * @brief Take a snapshot of the queue counters.
+ *
+ * @param[out] pxStats Where to copy the counters.
+ */
+void PublishQueue_GetStats( PublishQueueStats_t * pxStats );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_PUBLISH_QUEUE_H_ */
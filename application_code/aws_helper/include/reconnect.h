@@ -0,0 +1,124 @@
+/*
+ * reconnect.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_RECONNECT_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_RECONNECT_H_
+
+/**
+ * @file reconnect.h
+ * @brief Reconnect engine for the MQTT broker connection.
+ *
+ * Connection attempts are retried forever with decorrelated jitter
+ * backoff. Every attempt is split into DNS, TCP, TLS and CONNACK phases,
+ * each timed and each guarded by a circuit breaker: a phase that keeps
+ * failing is not attempted again until its cooldown has passed, and a
+ * failing DNS lookup is skipped in favour of the last address that
+ * resolved.
+ */
+
+/* Standard includes. */
+#include <stdint.h>
+
+/* FreeRTOS include. */
+#include "FreeRTOS.h"
+
+/* Include the secure sockets implementation of the transport interface. */
+#include "transport_secure_sockets.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Phases of a connection attempt.
+ */
+typedef enum ReconnectPhase
+{
+    eReconnectPhaseDns = 0,
+    eReconnectPhaseTcp,
+    eReconnectPhaseTls,
+    eReconnectPhaseConnack,
+    eReconnectPhaseMax
+} ReconnectPhase_t;
+
+/**
+ * @brief Counters for one phase.
+ */
+typedef struct ReconnectPhaseStats
+{
+    uint32_t ulAttempts;
+    uint32_t ulFailures;
+    uint32_t ulLastMs;      /**< @brief Duration of the last attempt. */
+    uint32_t ulTotalMs;     /**< @brief Duration of all attempts. */
+    uint32_t ulBreakerTrips;
+    BaseType_t xBreakerOpen;
+} ReconnectPhaseStats_t;
+
+/**
+ * @brief Counters describing the reconnect engine.
+ */
+typedef struct ReconnectStats
+{
+    ReconnectPhaseStats_t xPhases[ eReconnectPhaseMax ];
+    uint32_t ulAttempts;         /**< @brief Connection attempts started. */
+    uint32_t ulConnects;         /**< @brief Attempts that reached CONNACK. */
+    uint32_t ulDnsCacheHits;     /**< @brief Attempts that used the cached address. */
+    uint32_t ulLastBackoffMs;    /**< @brief Delay before the last attempt. */
+    uint32_t ulLastWarmUpMs;     /**< @brief DNS to CONNACK time of the last connect. */
+    uint32_t ulLastOutageMs;     /**< @brief Time from the first attempt to the last connect. */
+    uint32_t ulBudgetOverruns;   /**< @brief Connects slower than the warm-up budget. */
+} ReconnectStats_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Wait until the next connection attempt is due.
+ *
+ * The first attempt after a connect waits a random time of up to the
+ * base delay; later ones follow decorrelated jitter, and no attempt starts
+ * while the breaker of a phase it needs is open.
+ */
+void Reconnect_WaitBeforeAttempt( void );
+
+/**
+ * @brief Resolve the broker and open the TLS connection to it, timing the
+ * DNS, TCP and TLS phases.
+ *
+ * @param[out] pxParams Transport parameters that receive the socket.
+ * @param[in] pxServerInfo Broker host name and port.
+ * @param[in] pxSocketsConfig TLS and socket options.
+ *
+ * @return TRANSPORT_SOCKET_STATUS_SUCCESS if the connection is up.
+ */
+TransportSocketStatus_t Reconnect_ConnectTransport( SecureSocketsTransportParams_t * pxParams,
+                                                    const ServerInfo_t * pxServerInfo,
+                                                    const SocketsConfig_t * pxSocketsConfig );
+
+/**
+ * @brief Note that MQTT CONNECT is about to be sent.
+ */
+void Reconnect_OnConnackStart( void );
+
+/**
+ * @brief Note the outcome of MQTT CONNECT.
+ *
+ * @param[in] xSuccess pdPASS if CONNACK accepted the connection.
+ */
+void Reconnect_OnConnackResult( BaseType_t xSuccess );
+
+/**
+ * @brief Note that the TCP connection is up; called by SOCKETS_Connect
+ * through securesocketsTCP_CONNECTED_HOOK.
+ */
+void Reconnect_OnTcpConnected( void );
+
+/**
+ * @brief Take a snapshot of the engine's counters.
+ *
+ * @param[out] pxStats Where to copy the counters.
+ */
+void Reconnect_GetStats( ReconnectStats_t * pxStats );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_RECONNECT_H_ */
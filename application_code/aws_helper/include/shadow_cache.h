@@ -0,0 +1,59 @@
+/*
+ * shadow_cache.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_CACHE_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_CACHE_H_
+
+/**
+ * @file shadow_cache.h
+ * @brief Copy of a shadow state model kept on the SimpleLink file system.
+ *
+ * The values of the model and the shadow version they were accepted at are
+ * saved to a file, so after a reset the device can act on its last known
+ * state before the network is up, and reconcile with the service later.
+ * Properties are stored by name, so a file written before a property was
+ * added or removed still restores the others.
+ */
+
+/* FreeRTOS include. */
+#include "FreeRTOS.h"
+
+/* Shadow state model. */
+#include "shadow_state.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Restore the values and version of a model from a file.
+ *
+ * Restored properties are taken as already reported and are no longer
+ * dirty; properties missing from the file keep their value and stay dirty.
+ *
+ * @param[in,out] pxModel An initialized model.
+ * @param[in] pcFileName The cache file.
+ *
+ * @return pdPASS if the file was read; pdFAIL if it is missing, damaged or
+ * too large, in which case the model is unchanged.
+ */
+BaseType_t ShadowCache_Load( ShadowStateModel_t * pxModel,
+                             const char * pcFileName );
+
+/**
+ * @brief Save the values and version of a model to a file.
+ *
+ * The file is rewritten only if a value differs from the saved ones, so a
+ * report that changes nothing but the version costs no flash write.
+ *
+ * @param[in] pxModel The model.
+ * @param[in] pcFileName The cache file.
+ *
+ * @return pdPASS if the file holds the values; pdFAIL otherwise.
+ */
+BaseType_t ShadowCache_Save( const ShadowStateModel_t * pxModel,
+                             const char * pcFileName );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_CACHE_H_ */
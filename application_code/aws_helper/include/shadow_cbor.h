@@ -0,0 +1,134 @@
+/*
+ * shadow_cbor.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_CBOR_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_CBOR_H_
+
+/**
+ * @file shadow_cbor.h
+ * @brief CBOR (RFC 8949) encoding of the reported and desired sections of a
+ * shadow.
+ *
+ * A section is a flat map from property names to values, which is all a
+ * state model holds, so only that subset of CBOR is supported: one map,
+ * text keys, and integers that fit in 32 bits, text strings, true, false
+ * and null as values. A section written from a model
+ * is about half the size of the same section as JSON and is read back
+ * without any number parsing, which suits links billed by the byte and a
+ * compact copy of the state on the device. The service itself only speaks
+ * JSON, so a section can be converted to and from JSON wherever it meets it.
+ */
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Shadow state model. */
+#include "shadow_state.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Return codes of the codec.
+ */
+typedef enum ShadowCborStatus
+{
+    eShadowCborSuccess = 0,     /**< @brief The operation succeeded. */
+    eShadowCborBadParameter,    /**< @brief A pointer or length is invalid. */
+    eShadowCborBufferTooSmall,  /**< @brief The output does not fit in the buffer. */
+    eShadowCborIllegalDocument  /**< @brief The input is not a section in the supported subset. */
+} ShadowCborStatus_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write properties of a model as a CBOR section.
+ *
+ * The model is not changed; its dirty bits are left to the caller.
+ *
+ * @param[in] pxModel The model.
+ * @param[in] ulMask The properties to write, e.g. the dirty ones.
+ * @param[out] pucBuffer Where to write the section.
+ * @param[in] xBufferSize Size of @p pucBuffer.
+ * @param[out] pxLength Length of the section.
+ *
+ * @return #eShadowCborSuccess or #eShadowCborBufferTooSmall.
+ */
+ShadowCborStatus_t ShadowCbor_EncodeSection( const ShadowStateModel_t * pxModel,
+                                             uint32_t ulMask,
+                                             uint8_t * pucBuffer,
+                                             size_t xBufferSize,
+                                             size_t * pxLength );
+
+/**
+ * @brief Apply a CBOR section, e.g. a desired state, to a model.
+ *
+ * Values are applied through the setters of the model, so a property whose
+ * value changes becomes dirty. Keys the model does not have, values of the
+ * wrong type and nulls are skipped.
+ *
+ * @param[in,out] pxModel The model.
+ * @param[in] pucSection The section.
+ * @param[in] xLength Length of the section.
+ * @param[out] pulApplied The properties a value was applied to; may be NULL.
+ *
+ * @return #eShadowCborSuccess; #eShadowCborIllegalDocument if the section
+ * is malformed, in which case the values before the fault are applied.
+ */
+ShadowCborStatus_t ShadowCbor_DecodeSection( ShadowStateModel_t * pxModel,
+                                             const uint8_t * pucSection,
+                                             size_t xLength,
+                                             uint32_t * pulApplied );
+
+/**
+ * @brief Convert a CBOR section to a JSON object.
+ *
+ * @param[in] pucSection The section.
+ * @param[in] xLength Length of the section.
+ * @param[out] pcBuffer Where to write the object; it is not terminated.
+ * @param[in] xBufferSize Size of @p pcBuffer.
+ * @param[out] pxLength Length of the object.
+ *
+ * @return #eShadowCborSuccess; #eShadowCborIllegalDocument or
+ * #eShadowCborBufferTooSmall otherwise.
+ */
+ShadowCborStatus_t ShadowCbor_ToJson( const uint8_t * pucSection,
+                                      size_t xLength,
+                                      char * pcBuffer,
+                                      size_t xBufferSize,
+                                      size_t * pxLength );
+
+/**
+ * @brief Convert a flat JSON object, e.g. the desired slice of a shadow
+ * event, to a CBOR section.
+ *
+ * Numbers must be integers that fit in 32 bits. Nested objects, arrays and
+ * \\u escapes are not supported.
+ *
+ * @param[in] pcSection The object; it need not be terminated.
+ * @param[in] xLength Length of the object.
+ * @param[out] pucBuffer Where to write the section.
+ * @param[in] xBufferSize Size of @p pucBuffer.
+ * @param[out] pxLength Length of the section.
+ *
+ * @return #eShadowCborSuccess; #eShadowCborIllegalDocument or
+ * #eShadowCborBufferTooSmall otherwise.
+ */
+ShadowCborStatus_t ShadowCbor_FromJson( const char * pcSection,
+                                        size_t xLength,
+                                        uint8_t * pucBuffer,
+                                        size_t xBufferSize,
+                                        size_t * pxLength );
+
+/**
+ * @brief Time the CBOR encoding against the JSON path on a recorded section
+ * and log the sizes and times. Does nothing unless
+ * shadowcborconfigBENCHMARK_ITERATIONS is set.
+ */
+void ShadowCbor_RunBenchmark( void );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_CBOR_H_ */
@@ -0,0 +1,173 @@
+/*
+ * shadow_client.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_CLIENT_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_CLIENT_H_
+
+/**
+ * @file shadow_client.h
+ * @brief Classic and named device shadows of one thing, multiplexed over a
+ * single MQTT connection.
+ *
+ * Each shadow is registered once with a callback. Its topic prefix is built
+ * at registration, and the get and update topics it publishes to are kept
+ * in a shared cache, so topics are never assembled on the publish path and
+ * stay valid while the MQTT helpers may resend them. Incoming publishes are
+ * matched against the cached prefixes and handed to the callback of the
+ * shadow they belong to. Another shadow costs one registry entry and its
+ * two cached topics; it needs no connection of its own.
+ *
+ * A publish is handed over as an event: the payload as it lies in the MQTT
+ * receive buffer, already validated, with the fields every shadow handler
+ * needs located in one pass as slices of it. Nothing is copied, so large
+ * desired documents cost no memory, and nothing in the event may be kept
+ * once the callback returns, as the buffer then receives the next packet.
+ *
+ * The client is owned by the task running the MQTT connection and takes no
+ * locks.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* FreeRTOS include. */
+#include "FreeRTOS.h"
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/* Shadow library header, for the message types. */
+#include "shadow.h"
+
+/* Single-pass JSON extractor, for the slices. */
+#include "shadow_json.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Longest shadow name accepted by AWS IoT.
+ */
+#define shadowclientMAX_NAME_LENGTH    ( 64U )
+
+/**
+ * @brief A registered shadow.
+ */
+typedef struct ShadowClientShadow * ShadowClientHandle_t;
+
+/**
+ * @brief A publish received on a topic of a shadow.
+ *
+ * The slices are offsets into @p pcPayload; a field the document does not
+ * carry has type #eShadowJsonNotFound.
+ */
+typedef struct ShadowClientEvent
+{
+    ShadowClientHandle_t xShadow;     /**< @brief The shadow the publish belongs to. */
+    ShadowMessageType_t xMessageType; /**< @brief Which of the shadow's topics it arrived on. */
+    const char * pcPayload;           /**< @brief The payload in the receive buffer; not terminated. */
+    size_t xPayloadLength;            /**< @brief Length of the payload. */
+    bool xValid;                      /**< @brief Whether the payload is valid JSON; if not, every slice is empty. */
+    ShadowJsonSlice_t xVersion;       /**< @brief "version". */
+    ShadowJsonSlice_t xClientToken;   /**< @brief "clientToken", without its quotes. */
+    ShadowJsonSlice_t xCode;          /**< @brief "code" of an error document. */
+    ShadowJsonSlice_t xDesired;       /**< @brief The desired state: "state" of a delta, "state.desired" otherwise. */
+} ShadowClientEvent_t;
+
+/**
+ * @brief Called from the MQTT event callback for every publish received on
+ * a topic of the shadow.
+ *
+ * @param[in] pxEvent The publish. It and the payload it points into are
+ * only valid until the callback returns.
+ * @param[in] pvContext The context given at registration.
+ */
+typedef void ( * ShadowClientCallback_t )( const ShadowClientEvent_t * pxEvent,
+                                           void * pvContext );
+
+/**
+ * @brief The topics a shadow publishes to.
+ */
+typedef enum ShadowClientTopic
+{
+    eShadowClientTopicGet = 0,
+    eShadowClientTopicUpdate
+} ShadowClientTopic_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Forget every registered shadow and empty the topic cache.
+ *
+ * @param[in] pcThingName Name of the thing owning the shadows. It is not
+ * copied and must outlive the client.
+ * @param[in] usThingNameLength Length of @p pcThingName.
+ *
+ * @return pdPASS; pdFAIL if the thing name is empty or the paths of the
+ * event fields cannot be compiled.
+ */
+BaseType_t ShadowClient_Init( const char * pcThingName,
+                              uint16_t usThingNameLength );
+
+/**
+ * @brief Register a shadow and cache its topics.
+ *
+ * @param[in] pcShadowName Name of a named shadow, or NULL or "" for the
+ * classic shadow. It is not copied and must outlive the client.
+ * @param[in] xCallback Receives the publishes of the shadow.
+ * @param[in] pvContext Passed to @p xCallback.
+ *
+ * @return The shadow; NULL if the name is invalid or already registered,
+ * or if the registry or the topic cache is full.
+ */
+ShadowClientHandle_t ShadowClient_Register( const char * pcShadowName,
+                                            ShadowClientCallback_t xCallback,
+                                            void * pvContext );
+
+/**
+ * @brief Name of a shadow, for logging.
+ *
+ * @return The name; "" for the classic shadow.
+ */
+const char * ShadowClient_GetName( ShadowClientHandle_t xShadow );
+
+/**
+ * @brief Cached topic a shadow publishes to.
+ *
+ * @param[in] xShadow The shadow.
+ * @param[in] xTopic Which topic.
+ * @param[out] pusLength Length of the topic.
+ *
+ * @return The terminated topic, valid until ShadowClient_Init() is called
+ * again.
+ */
+const char * ShadowClient_GetTopic( ShadowClientHandle_t xShadow,
+                                    ShadowClientTopic_t xTopic,
+                                    uint16_t * pusLength );
+
+/**
+ * @brief Subscribe to the get and update responses and the deltas of every
+ * registered shadow, with one SUBSCRIBE per shadow.
+ *
+ * @param[in] pxMqttContext The connection.
+ *
+ * @return pdPASS if every SUBACK was received; pdFAIL otherwise.
+ */
+BaseType_t ShadowClient_Subscribe( MQTTContext_t * pxMqttContext );
+
+/**
+ * @brief Hand a received publish to the shadow its topic belongs to, as an
+ * event over its payload.
+ *
+ * @param[in] pxPublishInfo The publish.
+ *
+ * @return true if the topic is one of a registered shadow's; false
+ * otherwise, in which case no callback ran.
+ */
+bool ShadowClient_Dispatch( MQTTPublishInfo_t * pxPublishInfo );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_CLIENT_H_ */
@@ -0,0 +1,168 @@
+/*
+ * shadow_json.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_JSON_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_JSON_H_
+
+/**
+ * @file shadow_json.h
+ * @brief Single-pass extractor for shadow documents.
+ *
+ * The caller describes the values it wants as a table of dotted key paths,
+ * e.g. "state.powerOn", which is compiled once into per-segment offsets.
+ * ShadowJson_Parse() then validates the whole document and fills in every
+ * path of the table in the same scan, where JSON_Validate followed by one
+ * JSON_Search per key reads the document once plus once per key. Key
+ * matching is a bitmask of the paths still possible at each nesting level,
+ * so keys that no path wants cost one length compare.
+ *
+ * Values are returned as slices, an offset and a length into the document,
+ * so nothing is copied out of the receive buffer and a slice can be handed
+ * on, or parsed again as a document of its own, without pointers into the
+ * buffer outliving it.
+ */
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Most paths in one table; each path is one bit of a mask.
+ */
+#define shadowjsonMAX_FIELDS           ( 32U )
+
+/**
+ * @brief Most keys in one path.
+ */
+#define shadowjsonMAX_PATH_SEGMENTS    ( 6U )
+
+/**
+ * @brief Initializer for a table entry looking up the string literal
+ * @p pcPath.
+ */
+#define shadowjsonFIELD( pcPath )    { ( pcPath ), sizeof( pcPath ) - 1U }
+
+/**
+ * @brief Return codes of the extractor.
+ */
+typedef enum ShadowJsonStatus
+{
+    eShadowJsonSuccess = 0,      /**< @brief The document is valid JSON. */
+    eShadowJsonBadParameter,     /**< @brief A pointer, count or path is invalid. */
+    eShadowJsonIllegalDocument,  /**< @brief The document is not valid JSON. */
+    eShadowJsonMaxDepthExceeded, /**< @brief The document nests deeper than shadowjsonconfigMAX_DEPTH. */
+    eShadowJsonBadValue          /**< @brief A value is missing or cannot be converted. */
+} ShadowJsonStatus_t;
+
+/**
+ * @brief Type of an extracted value.
+ */
+typedef enum ShadowJsonType
+{
+    eShadowJsonNotFound = 0,
+    eShadowJsonString,
+    eShadowJsonNumber,
+    eShadowJsonTrue,
+    eShadowJsonFalse,
+    eShadowJsonNull,
+    eShadowJsonObject,
+    eShadowJsonArray
+} ShadowJsonType_t;
+
+/**
+ * @brief Where a value lies in its document.
+ */
+typedef struct ShadowJsonSlice
+{
+    size_t xOffset;         /**< @brief Start of the value; strings without their quotes. */
+    size_t xLength;         /**< @brief Length of the value. */
+    ShadowJsonType_t eType; /**< @brief #eShadowJsonNotFound if the value is not in the document. */
+} ShadowJsonSlice_t;
+
+/**
+ * @brief One path of a table, with its compiled segments and its result.
+ *
+ * Only @p pcPath and @p xPathLength are set by the caller, usually with
+ * #shadowjsonFIELD. The segments are filled in by ShadowJson_Compile() and
+ * the value by ShadowJson_Parse().
+ */
+typedef struct ShadowJsonField
+{
+    const char * pcPath;  /**< @brief Dotted key path, e.g. "state.powerOn". */
+    size_t xPathLength;   /**< @brief Length of the path. */
+
+    uint8_t ucSegmentCount;
+    uint8_t ucSegmentStart[ shadowjsonMAX_PATH_SEGMENTS ];
+    uint8_t ucSegmentLength[ shadowjsonMAX_PATH_SEGMENTS ];
+
+    ShadowJsonSlice_t xValue; /**< @brief The value, relative to the document parsed. */
+} ShadowJsonField_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Split the paths of a table into key segments. Call once per table
+ * before it is passed to ShadowJson_Parse().
+ *
+ * @param[in,out] pxFields The table.
+ * @param[in] xFieldCount Number of paths in the table, at most
+ * #shadowjsonMAX_FIELDS.
+ *
+ * @return #eShadowJsonSuccess, or #eShadowJsonBadParameter if a path is
+ * empty, has an empty key, is longer than 255 characters or has more than
+ * #shadowjsonMAX_PATH_SEGMENTS keys.
+ */
+ShadowJsonStatus_t ShadowJson_Compile( ShadowJsonField_t * pxFields,
+                                       size_t xFieldCount );
+
+/**
+ * @brief Validate a document and extract every path of a compiled table.
+ *
+ * Keys are compared as they appear in the document, without unescaping,
+ * and the first occurrence of a duplicated key wins, as with JSON_Search.
+ * Keys inside arrays are never matched.
+ *
+ * @param[in] pcDocument The document; it need not be terminated.
+ * @param[in] xLength Length of the document.
+ * @param[in,out] pxFields The compiled table that receives the values.
+ * @param[in] xFieldCount Number of paths in the table.
+ *
+ * @return #eShadowJsonSuccess if the document is valid, whether or not
+ * every path was found; otherwise the reason it was rejected, in which case
+ * no value should be used.
+ */
+ShadowJsonStatus_t ShadowJson_Parse( const char * pcDocument,
+                                     size_t xLength,
+                                     ShadowJsonField_t * pxFields,
+                                     size_t xFieldCount );
+
+/**
+ * @brief Convert a value to an unsigned integer without reading past it.
+ *
+ * Numbers and strings of digits, such as a clientToken, are accepted.
+ *
+ * @param[in] pcDocument The document the slice belongs to.
+ * @param[in] pxSlice The value.
+ * @param[out] pulValue The integer.
+ *
+ * @return #eShadowJsonSuccess; #eShadowJsonBadValue if the value is missing,
+ * is not made of decimal digits only or does not fit in 32 bits.
+ */
+ShadowJsonStatus_t ShadowJson_GetUInt32( const char * pcDocument,
+                                         const ShadowJsonSlice_t * pxSlice,
+                                         uint32_t * pulValue );
+
+/**
+ * @brief Time the extractor against JSON_Validate and JSON_Search on a set
+ * of recorded shadow payloads and log the results. Does nothing unless
+ * shadowjsonconfigBENCHMARK_ITERATIONS is set.
+ */
+void ShadowJson_RunBenchmark( void );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_JSON_H_ */
@@ -0,0 +1,137 @@
+/*
+ * shadow_request.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_REQUEST_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_REQUEST_H_
+
+/**
+ * @file shadow_request.h
+ * @brief Correlation table for shadow requests in flight.
+ *
+ * Every request published to the shadow service gets a slot keyed by a
+ * clientToken that is unique among the requests in flight. The accepted or
+ * rejected response carrying that token completes the slot, and a slot not
+ * answered within the table's timeout is handed back as expired, so the
+ * caller never has to block on one response and several requests can be
+ * outstanding at once. The table is owned by one task and takes no locks.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* FreeRTOS include. */
+#include "FreeRTOS.h"
+
+/* Latency histograms and counters. */
+#include "mqtt_metrics.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Largest clientToken; tokens are sent as six digit strings.
+ */
+#define shadowrequestMAX_TOKEN    ( 999999UL )
+
+/**
+ * @brief Initializer for a table over a slot array, with a response timeout
+ * in milliseconds.
+ */
+#define shadowrequestTABLE( pxSlots, ulTimeoutMs )    { ( pxSlots ), sizeof( pxSlots ) / sizeof( ( pxSlots )[ 0 ] ), pdMS_TO_TICKS( ulTimeoutMs ), 0UL }
+
+/**
+ * @brief One request in flight.
+ */
+typedef struct ShadowRequest
+{
+    uint32_t ulClientToken;            /**< @brief Token of the request; 0 if the slot is free. */
+    uint32_t ulMask;                   /**< @brief Caller data, e.g. the properties an update carries. */
+    void * pvContext;                  /**< @brief Caller data, e.g. the shadow the request went to. */
+    char * pcDocument;                 /**< @brief Caller data, e.g. the published document kept for a resend. */
+    TickType_t xSentAt;                /**< @brief When the slot was taken. */
+    MQTTMetricsTimestamp_t xStartedAt; /**< @brief The same, for the round trip histogram. */
+} ShadowRequest_t;
+
+/**
+ * @brief A set of slots with a common response timeout.
+ */
+typedef struct ShadowRequestTable
+{
+    ShadowRequest_t * pxSlots;
+    size_t xSlotCount;
+    TickType_t xTimeoutTicks;
+    uint32_t ulLastToken; /**< @brief Token handed out last. */
+} ShadowRequestTable_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Free every slot and pick a starting token from the tick count, so
+ * tokens of a previous boot are unlikely to be reused at once.
+ *
+ * @param[in,out] pxTable The table.
+ */
+void ShadowRequest_Init( ShadowRequestTable_t * pxTable );
+
+/**
+ * @brief Take a slot for a request about to be published.
+ *
+ * The slot's clientToken is the one to send with the request, and the
+ * caller data fields are cleared for the caller to fill. If the request is
+ * not published after all, free the slot with ShadowRequest_Complete().
+ *
+ * @param[in,out] pxTable The table.
+ *
+ * @return The slot, or NULL if every slot is in use.
+ */
+ShadowRequest_t * ShadowRequest_Add( ShadowRequestTable_t * pxTable );
+
+/**
+ * @brief Find and free the slot of a response's clientToken.
+ *
+ * @param[in,out] pxTable The table.
+ * @param[in] ulClientToken Token carried by the response.
+ * @param[out] pxRequest Receives a copy of the request; may be NULL.
+ *
+ * @return true if a request with the token was in flight.
+ */
+bool ShadowRequest_Complete( ShadowRequestTable_t * pxTable,
+                             uint32_t ulClientToken,
+                             ShadowRequest_t * pxRequest );
+
+/**
+ * @brief Free one request that has waited longer than the table's timeout.
+ *
+ * Call until it returns false to collect every expired request.
+ *
+ * @param[in,out] pxTable The table.
+ * @param[out] pxRequest Receives a copy of the expired request.
+ *
+ * @return true if an expired request was found.
+ */
+bool ShadowRequest_TakeExpired( ShadowRequestTable_t * pxTable,
+                                ShadowRequest_t * pxRequest );
+
+/**
+ * @brief Free one request in flight, expired or not, e.g. when the
+ * connection is lost and no response can arrive.
+ *
+ * @param[in,out] pxTable The table.
+ * @param[out] pxRequest Receives a copy of the request.
+ *
+ * @return true if a request was in flight.
+ */
+bool ShadowRequest_TakeAny( ShadowRequestTable_t * pxTable,
+                            ShadowRequest_t * pxRequest );
+
+/**
+ * @brief Number of requests in flight.
+ */
+size_t ShadowRequest_InFlight( const ShadowRequestTable_t * pxTable );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_REQUEST_H_ */
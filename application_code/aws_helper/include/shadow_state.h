@@ -0,0 +1,215 @@
+/*
+ * shadow_state.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_STATE_H_
+#define APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_STATE_H_
+
+/**
+ * @file shadow_state.h
+ * @brief Local model of the reported section of a device shadow.
+ *
+ * The device's properties are described by a table of typed entries. Each
+ * property has a dirty bit that is set when its value changes, and a report
+ * carries only the dirty properties. Writing a report clears their bits and
+ * hands them to the caller as a mask; once the report is answered the caller
+ * hands the mask back, and a failed report makes its properties dirty again,
+ * so a change is never lost however many reports are in flight. The model
+ * also keeps the last shadow version seen, which can be sent with a report
+ * so that a stale update is rejected by the service.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Most properties in one model; each property is one bit of a mask.
+ */
+#define shadowstateMAX_PROPERTIES    ( 32U )
+
+/**
+ * @brief Initializers for the entries of a property table. Names are written
+ * into documents as they are, so they must not need JSON escaping.
+ */
+#define shadowstateBOOL( pcName )                { ( pcName ), sizeof( pcName ) - 1U, eShadowStateBool, 0, NULL, 0U }
+#define shadowstateINT( pcName )                 { ( pcName ), sizeof( pcName ) - 1U, eShadowStateInt, 0, NULL, 0U }
+#define shadowstateSTRING( pcName, pcBuffer )    { ( pcName ), sizeof( pcName ) - 1U, eShadowStateString, 0, ( pcBuffer ), sizeof( pcBuffer ) }
+
+/**
+ * @brief Initializer for a model over a property table array.
+ */
+#define shadowstateMODEL( pxTable )              { ( pxTable ), sizeof( pxTable ) / sizeof( ( pxTable )[ 0 ] ), 0UL, 0UL, 0UL }
+
+/**
+ * @brief Return codes of the state model.
+ */
+typedef enum ShadowStateStatus
+{
+    eShadowStateSuccess = 0,     /**< @brief The operation succeeded. */
+    eShadowStateBadParameter,    /**< @brief Unknown property, wrong type or invalid value. */
+    eShadowStateNothingToReport, /**< @brief No property is dirty. */
+    eShadowStateBufferTooSmall   /**< @brief The report does not fit in the buffer. */
+} ShadowStateStatus_t;
+
+/**
+ * @brief Type of a property.
+ */
+typedef enum ShadowStateType
+{
+    eShadowStateBool = 0,
+    eShadowStateInt,
+    eShadowStateString
+} ShadowStateType_t;
+
+/**
+ * @brief One property of the model.
+ */
+typedef struct ShadowStateProperty
+{
+    const char * pcName;     /**< @brief Key in the reported section. */
+    size_t xNameLength;      /**< @brief Length of the key. */
+    ShadowStateType_t eType; /**< @brief Type of the value. */
+    int32_t lValue;          /**< @brief Value of a bool or int property. */
+    char * pcString;         /**< @brief Terminated value of a string property. */
+    size_t xStringSize;      /**< @brief Size of @p pcString, including the terminator. */
+} ShadowStateProperty_t;
+
+/**
+ * @brief A property table with its dirty tracking and version.
+ */
+typedef struct ShadowStateModel
+{
+    ShadowStateProperty_t * pxProperties;
+    size_t xPropertyCount;
+    uint32_t ulDirty;   /**< @brief Properties changed since they were last reported. */
+    uint32_t ulVersion; /**< @brief Newest shadow version seen; 0 if none yet. */
+    uint32_t ulChanges; /**< @brief Value changes since the last report was written. */
+} ShadowStateModel_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Check the table and mark every property dirty, so the first report
+ * carries the whole state.
+ *
+ * @param[in,out] pxModel The model.
+ *
+ * @return #eShadowStateSuccess, or #eShadowStateBadParameter if the table
+ * has more than #shadowstateMAX_PROPERTIES entries or a string property has
+ * no buffer.
+ */
+ShadowStateStatus_t ShadowState_Init( ShadowStateModel_t * pxModel );
+
+/**
+ * @brief Set a bool property, marking it dirty if the value changes.
+ */
+ShadowStateStatus_t ShadowState_SetBool( ShadowStateModel_t * pxModel,
+                                         size_t xIndex,
+                                         bool xValue );
+
+/**
+ * @brief Set an int property, marking it dirty if the value changes.
+ */
+ShadowStateStatus_t ShadowState_SetInt( ShadowStateModel_t * pxModel,
+                                        size_t xIndex,
+                                        int32_t lValue );
+
+/**
+ * @brief Set a string property, marking it dirty if the value changes.
+ *
+ * @return #eShadowStateBadParameter if the string does not fit in the
+ * property's buffer or contains control characters.
+ */
+ShadowStateStatus_t ShadowState_SetString( ShadowStateModel_t * pxModel,
+                                           size_t xIndex,
+                                           const char * pcValue );
+
+/**
+ * @brief Read a bool or int property.
+ *
+ * @return The value; 0 for an unknown property or a string property.
+ */
+int32_t ShadowState_GetInt( const ShadowStateModel_t * pxModel,
+                            size_t xIndex );
+
+/**
+ * @brief Read a string property.
+ *
+ * @return The terminated value, or NULL for an unknown or non-string
+ * property.
+ */
+const char * ShadowState_GetString( const ShadowStateModel_t * pxModel,
+                                    size_t xIndex );
+
+/**
+ * @brief Whether any property is waiting to be reported.
+ */
+bool ShadowState_IsDirty( const ShadowStateModel_t * pxModel );
+
+/**
+ * @brief Mark every property dirty, e.g. after the reported section was
+ * deleted in the cloud.
+ */
+void ShadowState_MarkAllDirty( ShadowStateModel_t * pxModel );
+
+/**
+ * @brief Record a shadow version received from the service.
+ *
+ * @param[in,out] pxModel The model.
+ * @param[in] ulVersion The version of a received document.
+ *
+ * @return true if @p ulVersion is newer than the one recorded, which it then
+ * replaces; false if the document is stale.
+ */
+bool ShadowState_UpdateVersion( ShadowStateModel_t * pxModel,
+                                uint32_t ulVersion );
+
+/**
+ * @brief Write an update document carrying the dirty properties in its
+ * reported section and a client token, and clear their dirty bits. The
+ * count of changes starts again from 0.
+ *
+ * @param[in,out] pxModel The model.
+ * @param[out] pcBuffer Where to write the document.
+ * @param[in] xBufferSize Size of @p pcBuffer.
+ * @param[in] ulClientToken Token sent as a six digit string.
+ * @param[in] xConditional Whether to send the recorded version, so the
+ * update is rejected if the shadow has moved on. Only one conditional
+ * update can be in flight, as the first one accepted changes the version.
+ * @param[out] pxLength Length of the document, without a terminator.
+ * @param[out] pulMask The properties the report carries, to be handed back
+ * once it is answered.
+ *
+ * @return #eShadowStateSuccess; #eShadowStateNothingToReport if no property
+ * is dirty; #eShadowStateBufferTooSmall if the document does not fit, in
+ * which case the dirty bits are kept.
+ */
+ShadowStateStatus_t ShadowState_SerializeReported( ShadowStateModel_t * pxModel,
+                                                   char * pcBuffer,
+                                                   size_t xBufferSize,
+                                                   uint32_t ulClientToken,
+                                                   bool xConditional,
+                                                   size_t * pxLength,
+                                                   uint32_t * pulMask );
+
+/**
+ * @brief A report was rejected or not answered; the properties it carried
+ * are dirty again.
+ *
+ * An accepted report needs no call, as its properties were cleared when it
+ * was written.
+ *
+ * @param[in,out] pxModel The model.
+ * @param[in] ulMask The mask returned when the report was written.
+ */
+void ShadowState_OnReportFailed( ShadowStateModel_t * pxModel,
+                                 uint32_t ulMask );
+
+#endif /* APPLICATION_CODE_AWS_HELPER_INCLUDE_SHADOW_STATE_H_ */
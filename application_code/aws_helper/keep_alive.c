@@ -0,0 +1,257 @@
+/*
+ * keep_alive.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file keep_alive.c
+ *
+ * @brief Adaptive keep-alive manager.
+ *
+ * A NAT drops an idle TCP mapping after a timeout that differs per router
+ * and is not advertised. The manager finds it by probing: every answered
+ * ping raises the interval by keepaliveconfigPROBE_STEP_PERCENT, and the
+ * first ping that goes unanswered marks the previous interval as the
+ * longest the path supports.
+ *
+ * Pings are sent from the process loop, so they go out when the owning task
+ * runs. The Wi-Fi power policy is left to the application.
+ *
+ * All functions are called from the task that owns the MQTT context, so
+ * the state is not locked.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdbool.h>
+
+/* Keep-alive configuration. */
+#include "keep_alive_config.h"
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+#include "keep_alive.h"
+
+/*-----------------------------------------------------------*/
+
+#if ( keepaliveconfigMAX_INTERVAL_SECONDS >= keepaliveconfigBROKER_KEEP_ALIVE_SECONDS )
+    #error "keepaliveconfigMAX_INTERVAL_SECONDS must be below the broker keep alive."
+#endif
+
+#if ( ( keepaliveconfigINITIAL_INTERVAL_SECONDS < keepaliveconfigMIN_INTERVAL_SECONDS ) || \
+    ( keepaliveconfigINITIAL_INTERVAL_SECONDS > keepaliveconfigMAX_INTERVAL_SECONDS ) )
+    #error "keepaliveconfigINITIAL_INTERVAL_SECONDS must lie between the minimum and maximum intervals."
+#endif
+
+/**
+ * @brief Milliseconds per second.
+ */
+#define keepaliveMS_PER_SECOND    ( 1000UL )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Current ping interval in milliseconds.
+ */
+static uint32_t ulIntervalMs = keepaliveconfigINITIAL_INTERVAL_SECONDS * keepaliveMS_PER_SECOND;
+
+/**
+ * @brief Longest idle gap, in milliseconds, that a ping was answered after.
+ */
+static uint32_t ulLastGoodMs = 0UL;
+
+/**
+ * @brief Set once a probe failed; the interval stops growing from then on.
+ */
+static bool xLearned = false;
+
+/**
+ * @brief A PINGREQ sent by the manager is waiting for its PINGRESP.
+ */
+static bool xPingOutstanding = false;
+
+/**
+ * @brief Idle gap, in milliseconds, at the time the outstanding ping was sent.
+ */
+static uint32_t ulPingGapMs = 0UL;
+
+/**
+ * @brief Time of the last packet received from the broker.
+ */
+static uint32_t ulLastReceiveMs = 0UL;
+
+static uint32_t ulPingsSent = 0UL;
+static uint32_t ulProbeFailures = 0UL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Clamp an interval to the configured range.
+ */
+static uint32_t prvClamp( uint32_t ulMs );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvClamp( uint32_t ulMs )
+{
+    if( ulMs < ( keepaliveconfigMIN_INTERVAL_SECONDS * keepaliveMS_PER_SECOND ) )
+    {
+        ulMs = keepaliveconfigMIN_INTERVAL_SECONDS * keepaliveMS_PER_SECOND;
+    }
+    else if( ulMs > ( keepaliveconfigMAX_INTERVAL_SECONDS * keepaliveMS_PER_SECOND ) )
+    {
+        ulMs = keepaliveconfigMAX_INTERVAL_SECONDS * keepaliveMS_PER_SECOND;
+    }
+
+    return ulMs;
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t KeepAlive_GetBrokerKeepAliveSeconds( void )
+{
+    return ( uint16_t ) keepaliveconfigBROKER_KEEP_ALIVE_SECONDS;
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t KeepAlive_GetIntervalSeconds( void )
+{
+    return ( uint16_t ) ( ulIntervalMs / keepaliveMS_PER_SECOND );
+}
+
+/*-----------------------------------------------------------*/
+
+void KeepAlive_OnSessionStart( void )
+{
+    xPingOutstanding = false;
+    ulLastReceiveMs = 0UL;
+}
+
+/*-----------------------------------------------------------*/
+
+void KeepAlive_OnPacketReceived( MQTTContext_t * pxMqttContext )
+{
+    assert( pxMqttContext != NULL );
+
+    ulLastReceiveMs = pxMqttContext->getTime();
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t KeepAlive_Process( MQTTContext_t * pxMqttContext )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    MQTTStatus_t eMqttStatus = MQTTSuccess;
+    uint32_t ulNowMs = 0UL;
+    uint32_t ulIdleMs = 0UL;
+    uint32_t ulReceiveIdleMs = 0UL;
+
+    assert( pxMqttContext != NULL );
+
+    ulNowMs = pxMqttContext->getTime();
+
+    if( xPingOutstanding == true )
+    {
+        /* coreMQTT clears the flag when the PINGRESP arrives, and reports a
+         * keep-alive timeout from the process loop if it does not. */
+        if( pxMqttContext->waitingForPingResp == false )
+        {
+            xPingOutstanding = false;
+
+            if( ulPingGapMs > ulLastGoodMs )
+            {
+                ulLastGoodMs = ulPingGapMs;
+            }
+
+            if( xLearned == false )
+            {
+                ulIntervalMs = prvClamp( ulIntervalMs + ( ( ulIntervalMs / 100UL ) * keepaliveconfigPROBE_STEP_PERCENT ) );
+                LogInfo( ( "Ping answered after %lu s idle, probing %lu s next.",
+                           ( unsigned long ) ( ulPingGapMs / keepaliveMS_PER_SECOND ),
+                           ( unsigned long ) ( ulIntervalMs / keepaliveMS_PER_SECOND ) ) );
+            }
+        }
+    }
+    else
+    {
+        /* The NAT mapping is refreshed by traffic in either direction. */
+        ulIdleMs = ulNowMs - pxMqttContext->lastPacketTime;
+        ulReceiveIdleMs = ulNowMs - ulLastReceiveMs;
+
+        if( ulReceiveIdleMs < ulIdleMs )
+        {
+            ulIdleMs = ulReceiveIdleMs;
+        }
+
+        if( ulIdleMs >= ulIntervalMs )
+        {
+            eMqttStatus = MQTT_Ping( pxMqttContext );
+
+            if( eMqttStatus == MQTTSuccess )
+            {
+                xPingOutstanding = true;
+                ulPingGapMs = ulIdleMs;
+                ulPingsSent++;
+            }
+            else
+            {
+                LogError( ( "Failed to send PINGREQ with status %s.",
+                            MQTT_Status_strerror( eMqttStatus ) ) );
+                xReturnStatus = pdFAIL;
+            }
+        }
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void KeepAlive_OnConnectionLost( void )
+{
+    if( xPingOutstanding == true )
+    {
+        if( ulPingGapMs > ulLastGoodMs )
+        {
+            /* The probe went past the NAT timeout. */
+            ulProbeFailures++;
+            xLearned = true;
+            ulIntervalMs = prvClamp( ulLastGoodMs );
+            LogInfo( ( "Ping lost after %lu s idle, settling on %lu s.",
+                       ( unsigned long ) ( ulPingGapMs / keepaliveMS_PER_SECOND ),
+                       ( unsigned long ) ( ulIntervalMs / keepaliveMS_PER_SECOND ) ) );
+        }
+        else
+        {
+            /* An interval that used to work failed; the path changed. */
+            ulIntervalMs = prvClamp( ( ulIntervalMs / 100UL ) * keepaliveconfigBACKOFF_PERCENT );
+            ulLastGoodMs = ulIntervalMs;
+            LogWarn( ( "Confirmed ping interval failed, backing off to %lu s.",
+                       ( unsigned long ) ( ulIntervalMs / keepaliveMS_PER_SECOND ) ) );
+        }
+    }
+
+    xPingOutstanding = false;
+}
+
+/*-----------------------------------------------------------*/
+
+void KeepAlive_GetStats( KeepAliveStats_t * pxStats )
+{
+    assert( pxStats != NULL );
+
+    pxStats->ulIntervalSeconds = ulIntervalMs / keepaliveMS_PER_SECOND;
+    pxStats->ulLastGoodSeconds = ulLastGoodMs / keepaliveMS_PER_SECOND;
+    pxStats->ulPingsSent = ulPingsSent;
+    pxStats->ulProbeFailures = ulProbeFailures;
+    pxStats->xLearned = ( xLearned == true ) ? pdTRUE : pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
@@ -47,11 +47,17 @@
 /* Include AWS IoT metrics macros header. */
 #include "aws_iot_metrics.h"
 
-/* Retry utilities include. */
-#include "backoff_algorithm.h"
+/* Adaptive keep-alive manager. */
+#include "keep_alive.h"
 
-/* Include PKCS11 helpers header. */
-#include "pkcs11_helpers.h"
+/* Latency histograms and counters. */
+#include "mqtt_metrics.h"
+
+/* Store-and-forward publish queue. */
+#include "publish_queue.h"
+
+/* Reconnect engine. */
+#include "reconnect.h"
 
 /* Include header for client credentials. */
 #include "aws_clientcredential.h"
@@ -64,30 +70,15 @@
 
 /*-----------------------------------------------------------*/
 
-/**
- * @brief The maximum number of retries for connecting to server.
- */
-#define CONNECTION_RETRY_MAX_ATTEMPTS                ( 5U )
-
-/**
- * @brief The maximum back-off delay (in milliseconds) for retrying connection to server.
- */
-#define CONNECTION_RETRY_MAX_BACKOFF_DELAY_MS        ( 5000U )
-
-/**
- * @brief The base back-off delay (in milliseconds) to use for connection retry attempts.
- */
-#define CONNECTION_RETRY_BACKOFF_BASE_MS             ( 500U )
-
 /**
  * @brief Timeout for receiving CONNACK packet in milliseconds.
  */
 #define mqttexampleCONNACK_RECV_TIMEOUT_MS           ( 1000U )
 
 /**
- * @brief The number of topic filters to subscribe.
+ * @brief The maximum number of process loop iterations to wait for a SUBACK.
  */
-#define mqttexampleTOPIC_COUNT                       ( 1 )
+#define mqttexampleSUBACK_WAIT_LOOPS                 ( 10U )
 
 /**
  * @brief Time to wait between each cycle of the demo implemented by prvMQTTDemoTask().
@@ -99,16 +90,6 @@
  */
 #define mqttexamplePROCESS_LOOP_TIMEOUT_MS           ( 500U )
 
-/**
- * @brief Keep alive time reported to the broker while establishing an MQTT connection.
- *
- * It is the responsibility of the Client to ensure that the interval between
- * Control Packets being sent does not exceed the this Keep Alive value. In the
- * absence of sending any other Control Packets, the Client MUST send a
- * PINGREQ Packet.
- */
-#define mqttexampleKEEP_ALIVE_TIMEOUT_SECONDS        ( 60U )
-
 /**
  * @brief Delay between MQTT publishes. Note that the process loop also has a
  * timeout, so the total time between publishes is the sum of the two delays.
@@ -124,7 +105,7 @@
  * @brief Maximum number of outgoing publishes maintained in the application
  * until an ack is received from the broker.
  */
-#define MAX_OUTGOING_PUBLISHES                       ( 1U )
+#define MAX_OUTGOING_PUBLISHES                       democonfigMAX_OUTGOING_PUBLISHES
 
 /**
  * @brief Milliseconds per second.
@@ -167,6 +148,11 @@ typedef struct PublishPackets
      * @brief Publish info of the publish packet.
      */
     MQTTPublishInfo_t pubInfo;
+
+    /**
+     * @brief When the publish was sent, for the PUBACK latency histogram.
+     */
+    MQTTMetricsTimestamp_t xSentAt;
 } PublishPackets_t;
 
 /**
@@ -185,6 +171,16 @@ static uint32_t ulGlobalEntryTimeMs;
  */
 static uint16_t globalSubscribePacketIdentifier = 0U;
 
+/**
+ * @brief When the last SUBSCRIBE was sent, for the SUBACK round trip histogram.
+ */
+static MQTTMetricsTimestamp_t xSubscribeSentAt;
+
+/**
+ * @brief Set when the SUBACK for #globalSubscribePacketIdentifier arrives.
+ */
+static bool xSubackReceived = false;
+
 /**
  * @brief Packet Identifier generated when Unsubscribe request was sent to the broker;
  * it is used to match received Unsubscribe ACK to the transmitted unsubscribe
@@ -200,52 +196,26 @@ static uint16_t globalUnsubscribePacketIdentifier = 0U;
 static PublishPackets_t outgoingPublishPackets[ MAX_OUTGOING_PUBLISHES ] = { 0 };
 
 /**
- * @brief The flag to indicate the mqtt session changed.
+ * @brief Callback told when an outgoing publish is acknowledged or discarded.
  */
-static bool mqttSessionEstablished = false;
+static PublishAckCallback_t xPublishAckCallback = NULL;
 
 /**
- * @brief The parameters for the network context using a TLS channel.
+ * @brief The application's event callback, called from #prvEventCallback.
  */
-static SecureSocketsTransportParams_t xSecureSocketsTransportParams;
-
-/*-----------------------------------------------------------*/
+static MQTTEventCallback_t xAppEventCallback = NULL;
 
 /**
- * @brief Calculate and perform an exponential backoff with jitter delay for
- * the next retry attempt of a failed network operation with the server.
- *
- * The function generates a random number, calculates the next backoff period
- * with the generated random number, and performs the backoff delay operation if the
- * number of retries have not exhausted.
- *
- * @note The PKCS11 module is used to generate the random number as it allows access
- * to a True Random Number Generator (TRNG) if the vendor platform supports it.
- * It is recommended to seed the random number generator with a device-specific entropy
- * source so that probability of collisions from devices in connection retries is mitigated.
- *
- * @note The backoff period is calculated using the backoffAlgorithm library.
- *
- * @param[in, out] pxRetryAttempts The context to use for backoff period calculation
- * with the backoffAlgorithm library.
- *
- * @return pdPASS if calculating the backoff period was successful; otherwise pdFAIL
- * if there was failure in random number generation OR all retry attempts had exhausted.
+ * @brief The flag to indicate the mqtt session changed.
  */
-static BaseType_t prvBackoffForRetry( BackoffAlgorithmContext_t * pxRetryParams );
+static bool mqttSessionEstablished = false;
 
 /**
- * @brief Connect to MQTT broker with reconnection retries.
- *
- * If connection fails, retry is attempted after a timeout.
- * Timeout value will exponentially increase until maximum
- * timeout value is reached or the number of attempts are exhausted.
- *
- * @param[out] pxNetworkContext The output parameter to return the created network context.
- *
- * @return The status of the final connection attempt.
+ * @brief The parameters for the network context using a TLS channel.
  */
-static TransportSocketStatus_t prvConnectToServerWithBackoffRetries( NetworkContext_t * pxNetworkContext );
+static SecureSocketsTransportParams_t xSecureSocketsTransportParams;
+
+/*-----------------------------------------------------------*/
 
 /**
  * @brief Function to get the free index at which an outgoing publish
@@ -290,6 +260,37 @@ static void vCleanupOutgoingPublishWithPacketID( uint16_t usPacketId );
  */
 static BaseType_t handlePublishResend( MQTTContext_t * pxMqttContext );
 
+/**
+ * @brief Store a QoS1 publish in the outgoing window and send it.
+ *
+ * @param[in] pxMqttContext MQTT context pointer.
+ * @param[in] pcTopicFilter Points to the topic.
+ * @param[in] topicFilterLength The length of the topic.
+ * @param[in] pcPayload Points to the payload.
+ * @param[in] payloadLength The length of the payload.
+ * @param[out] pusPacketIdentifier The packet identifier used for the PUBLISH.
+ *
+ * @return pdPASS if PUBLISH was successfully sent;
+ * pdFAIL otherwise.
+ */
+static BaseType_t prvSendPublish( MQTTContext_t * pxMqttContext,
+                                  const char * pcTopicFilter,
+                                  int32_t topicFilterLength,
+                                  const char * pcPayload,
+                                  size_t payloadLength,
+                                  uint16_t * pusPacketIdentifier );
+
+/**
+ * @brief Run MQTT_ProcessLoop and record how long it took.
+ *
+ * @param[in] pxMqttContext MQTT context pointer.
+ * @param[in] ulTimeoutMs Timeout passed on to MQTT_ProcessLoop.
+ *
+ * @return The status returned by MQTT_ProcessLoop.
+ */
+static MQTTStatus_t prvTimedProcessLoop( MQTTContext_t * pxMqttContext,
+                                         uint32_t ulTimeoutMs );
+
 /**
  * @brief The timer query function provided to the MQTT context.
  *
@@ -297,115 +298,18 @@ static BaseType_t handlePublishResend( MQTTContext_t * pxMqttContext );
  */
 static uint32_t prvGetTimeMs( void );
 
-/*-----------------------------------------------------------*/
-
-static BaseType_t prvBackoffForRetry( BackoffAlgorithmContext_t * pxRetryParams )
-{
-    BaseType_t xReturnStatus = pdFAIL;
-    uint16_t usNextRetryBackOff = 0U;
-    BackoffAlgorithmStatus_t xBackoffAlgStatus = BackoffAlgorithmSuccess;
-
-    /**
-     * To calculate the backoff period for the next retry attempt, we will
-     * generate a random number to provide to the backoffAlgorithm library.
-     *
-     * Note: The PKCS11 module is used to generate the random number as it allows access
-     * to a True Random Number Generator (TRNG) if the vendor platform supports it.
-     * It is recommended to use a random number generator seeded with a device-specific
-     * entropy source so that probability of collisions from devices in connection retries
-     * is mitigated.
-     */
-    uint32_t ulRandomNum = 0;
-
-    if( xPkcs11GenerateRandomNumber( ( uint8_t * ) &ulRandomNum,
-                                     sizeof( ulRandomNum ) ) == pdPASS )
-    {
-        /* Get back-off value (in milliseconds) for the next retry attempt. */
-        xBackoffAlgStatus = BackoffAlgorithm_GetNextBackoff( pxRetryParams, ulRandomNum, &usNextRetryBackOff );
-
-        if( xBackoffAlgStatus == BackoffAlgorithmRetriesExhausted )
-        {
-            LogError( ( "All retry attempts have exhausted. Operation will not be retried" ) );
-        }
-        else if( xBackoffAlgStatus == BackoffAlgorithmSuccess )
-        {
-            /* Perform the backoff delay. */
-            vTaskDelay( pdMS_TO_TICKS( usNextRetryBackOff ) );
-
-            xReturnStatus = pdPASS;
-
-            LogInfo( ( "Retry attempt %lu out of maximum retry attempts %lu.",
-                       ( pxRetryParams->attemptsDone + 1 ),
-                       pxRetryParams->maxRetryAttempts ) );
-        }
-    }
-    else
-    {
-        LogError( ( "Unable to retry operation with broker: Random number generation failed" ) );
-    }
-
-    return xReturnStatus;
-}
-
-static TransportSocketStatus_t prvConnectToServerWithBackoffRetries( NetworkContext_t * pxNetworkContext )
-{
-    TransportSocketStatus_t xNetworkStatus = TRANSPORT_SOCKET_STATUS_SUCCESS;
-    BackoffAlgorithmContext_t xReconnectParams = { 0 };
-    BaseType_t xBackoffStatus = pdPASS;
-    ServerInfo_t xServerInfo = { 0 };
-    SocketsConfig_t xSocketConfig = { 0 };
-
-    /* Initialize information to connect to the MQTT broker. */
-    xServerInfo.pHostName = democonfigMQTT_BROKER_ENDPOINT;
-    xServerInfo.hostNameLength = sizeof( democonfigMQTT_BROKER_ENDPOINT ) - 1U;
-    xServerInfo.port = democonfigMQTT_BROKER_PORT;
-
-    /* Configure credentials for TLS mutual authenticated session. */
-    xSocketConfig.enableTls = true;
-    xSocketConfig.pAlpnProtos = NULL;
-    xSocketConfig.maxFragmentLength = 0;
-    xSocketConfig.disableSni = false;
-    xSocketConfig.pRootCa = tlsSTARFIELD_ROOT_CERTIFICATE_PEM;
-    xSocketConfig.rootCaSize = sizeof( tlsSTARFIELD_ROOT_CERTIFICATE_PEM );
-    xSocketConfig.sendTimeoutMs = mqttexampleTRANSPORT_SEND_RECV_TIMEOUT_MS;
-    xSocketConfig.recvTimeoutMs = mqttexampleTRANSPORT_SEND_RECV_TIMEOUT_MS;
-
-    /* Initialize reconnect attempts and interval. */
-    BackoffAlgorithm_InitializeParams( &xReconnectParams,
-                                       CONNECTION_RETRY_BACKOFF_BASE_MS,
-                                       CONNECTION_RETRY_MAX_BACKOFF_DELAY_MS,
-                                       CONNECTION_RETRY_MAX_ATTEMPTS );
-
-    /* Attempt to connect to MQTT broker. If connection fails, retry after
-     * a timeout. Timeout value will exponentially increase until maximum
-     * attempts are reached.
-     */
-    do
-    {
-        /* Establish a TCP connection with the MQTT broker. This example connects to
-         * the MQTT broker as specified in democonfigMQTT_BROKER_ENDPOINT and
-         * democonfigMQTT_BROKER_PORT at the top of this file. */
-        LogInfo( ( "Create a TCP connection to %s:%d.",
-                   democonfigMQTT_BROKER_ENDPOINT,
-                   democonfigMQTT_BROKER_PORT ) );
-        xNetworkStatus = SecureSocketsTransport_Connect( pxNetworkContext,
-                                                         &xServerInfo,
-                                                         &xSocketConfig );
-
-        if( xNetworkStatus != TRANSPORT_SOCKET_STATUS_SUCCESS )
-        {
-            LogWarn( ( "Connection to the broker failed. Attempting connection retry after backoff delay." ) );
-
-            /* As the connection attempt failed, we will retry the connection after an
-             * exponential backoff with jitter delay. */
-
-            /* Calculate the backoff period for the next retry attempt and perform the wait operation. */
-            xBackoffStatus = prvBackoffForRetry( &xReconnectParams );
-        }
-    } while( ( xNetworkStatus != TRANSPORT_SOCKET_STATUS_SUCCESS ) && ( xBackoffStatus == pdPASS ) );
-
-    return xNetworkStatus;
-}
+/**
+ * @brief The event callback given to the MQTT library. It tells the
+ * keep-alive manager about the received packet before passing it on to the
+ * application's callback, whose duration it records.
+ *
+ * @param[in] pxMqttContext MQTT context pointer.
+ * @param[in] pxPacketInfo Packet Info pointer for the incoming packet.
+ * @param[in] pxDeserializedInfo Deserialized information from the incoming packet.
+ */
+static void prvEventCallback( MQTTContext_t * pxMqttContext,
+                              MQTTPacketInfo_t * pxPacketInfo,
+                              MQTTDeserializedInfo_t * pxDeserializedInfo );
 
 /*-----------------------------------------------------------*/
 
@@ -450,8 +354,23 @@ static void vCleanupOutgoingPublishAt( uint8_t ucIndex )
 
 static void vCleanupOutgoingPublishes( void )
 {
+    uint8_t ucIndex = 0;
+
     assert( outgoingPublishPackets != NULL );
 
+    /* Tell the owner of every pending publish that it will never be
+     * acknowledged, so it can be sent again on the new session. */
+    if( xPublishAckCallback != NULL )
+    {
+        for( ; ucIndex < MAX_OUTGOING_PUBLISHES; ucIndex++ )
+        {
+            if( outgoingPublishPackets[ ucIndex ].packetId != MQTT_PACKET_ID_INVALID )
+            {
+                xPublishAckCallback( outgoingPublishPackets[ ucIndex ].packetId, false );
+            }
+        }
+    }
+
     /* Clean up all the outgoing publish packets. */
     ( void ) memset( outgoingPublishPackets, 0x00, sizeof( outgoingPublishPackets ) );
 }
@@ -470,6 +389,7 @@ static void vCleanupOutgoingPublishWithPacketID( uint16_t usPacketId )
     {
         if( outgoingPublishPackets[ ucIndex ].packetId == usPacketId )
         {
+            MQTTMetrics_Record( eMetricsPublishToPuback, &outgoingPublishPackets[ ucIndex ].xSentAt );
             vCleanupOutgoingPublishAt( ucIndex );
             LogInfo( ( "Cleaned up outgoing publish packet with packet id %u.\n\n",
                        usPacketId ) );
@@ -490,6 +410,9 @@ void vHandleOtherIncomingPacket( MQTTPacketInfo_t * pxPacketInfo,
             LogInfo( ( "MQTT_PACKET_TYPE_SUBACK.\n\n" ) );
             /* Make sure ACK packet identifier matches with Request packet identifier. */
             assert( globalSubscribePacketIdentifier == usPacketIdentifier );
+            MQTTMetrics_Record( eMetricsSubscribeRoundTrip, &xSubscribeSentAt );
+            MQTTMetrics_Count( eMetricsSubackReceived, 1UL );
+            xSubackReceived = true;
             break;
 
         case MQTT_PACKET_TYPE_UNSUBACK:
@@ -510,7 +433,13 @@ void vHandleOtherIncomingPacket( MQTTPacketInfo_t * pxPacketInfo,
             LogInfo( ( "PUBACK received for packet id %u.\n\n",
                        usPacketIdentifier ) );
             /* Cleanup publish packet when a PUBACK is received. */
+            MQTTMetrics_Count( eMetricsPubackReceived, 1UL );
             vCleanupOutgoingPublishWithPacketID( usPacketIdentifier );
+
+            if( xPublishAckCallback != NULL )
+            {
+                xPublishAckCallback( usPacketIdentifier, true );
+            }
             break;
 
         /* Any other packet type is invalid. */
@@ -538,6 +467,7 @@ static BaseType_t handlePublishResend( MQTTContext_t * pxMqttContext )
         if( outgoingPublishPackets[ ucIndex ].packetId != MQTT_PACKET_ID_INVALID )
         {
             outgoingPublishPackets[ ucIndex ].pubInfo.dup = true;
+            MQTTMetrics_Start( &outgoingPublishPackets[ ucIndex ].xSentAt );
 
             LogInfo( ( "Sending duplicate PUBLISH with packet id %u.",
                        outgoingPublishPackets[ ucIndex ].packetId ) );
@@ -572,11 +502,14 @@ BaseType_t EstablishMqttSession( MQTTContext_t * pxMqttContext,
                                  MQTTFixedBuffer_t * pxNetworkBuffer,
                                  MQTTEventCallback_t eventCallback )
 {
-    BaseType_t xReturnStatus = pdPASS;
+    BaseType_t xReturnStatus = pdFAIL;
     MQTTStatus_t eMqttStatus = MQTTSuccess;
     MQTTConnectInfo_t xConnectInfo = { 0 };
     TransportInterface_t xTransport = { 0 };
+    ServerInfo_t xServerInfo = { 0 };
+    SocketsConfig_t xSocketConfig = { 0 };
     bool sessionPresent = false;
+    bool xInitFailed = false;
 
     assert( pxMqttContext != NULL );
     assert( pxNetworkContext != NULL );
@@ -588,119 +521,144 @@ BaseType_t EstablishMqttSession( MQTTContext_t * pxMqttContext,
 
     pxNetworkContext->pParams = &xSecureSocketsTransportParams;
 
-    if( prvConnectToServerWithBackoffRetries( pxNetworkContext ) != TRANSPORT_SOCKET_STATUS_SUCCESS )
-    {
-        /* Log error to indicate connection failure after all
-         * reconnect attempts are over. */
-        LogError( ( "Failed to connect to MQTT broker %.*s.",
-                    strlen( democonfigMQTT_BROKER_ENDPOINT ),
-                    democonfigMQTT_BROKER_ENDPOINT ) );
-        xReturnStatus = pdFAIL;
-    }
-    else
+    /* Initialize information to connect to the MQTT broker. */
+    xServerInfo.pHostName = democonfigMQTT_BROKER_ENDPOINT;
+    xServerInfo.hostNameLength = sizeof( democonfigMQTT_BROKER_ENDPOINT ) - 1U;
+    xServerInfo.port = democonfigMQTT_BROKER_PORT;
+
+    /* Configure credentials for TLS mutual authenticated session. */
+    xSocketConfig.enableTls = true;
+    xSocketConfig.pAlpnProtos = NULL;
+    xSocketConfig.maxFragmentLength = 0;
+    xSocketConfig.disableSni = false;
+    xSocketConfig.pRootCa = tlsSTARFIELD_ROOT_CERTIFICATE_PEM;
+    xSocketConfig.rootCaSize = sizeof( tlsSTARFIELD_ROOT_CERTIFICATE_PEM );
+    xSocketConfig.sendTimeoutMs = mqttexampleTRANSPORT_SEND_RECV_TIMEOUT_MS;
+    xSocketConfig.recvTimeoutMs = mqttexampleTRANSPORT_SEND_RECV_TIMEOUT_MS;
+
+    /* Fill in Transport Interface send and receive function pointers. */
+    xTransport.pNetworkContext = pxNetworkContext;
+    xTransport.send = SecureSocketsTransport_Send;
+    xTransport.recv = SecureSocketsTransport_Recv;
+
+    /* Establish MQTT session by sending a CONNECT packet. */
+
+    /* Many fields not used in this demo so start with everything at 0. */
+    ( void ) memset( ( void * ) &xConnectInfo, 0x00, sizeof( xConnectInfo ) );
+
+    /* Start with a clean session i.e. direct the MQTT broker to discard any
+     * previous session data. Also, establishing a connection with clean session
+     * will ensure that the broker does not store any data when this client
+     * gets disconnected. */
+    xConnectInfo.cleanSession = true;
+
+    /* The client identifier is used to uniquely identify this MQTT client to
+     * the MQTT broker. In a production device the identifier can be something
+     * unique, such as a device serial number. */
+    xConnectInfo.pClientIdentifier = democonfigCLIENT_IDENTIFIER;
+    xConnectInfo.clientIdentifierLength = ( uint16_t ) strlen( democonfigCLIENT_IDENTIFIER );
+
+    /* Use the metrics string as username to report the OS and MQTT client version
+     * metrics to AWS IoT. */
+    xConnectInfo.pUserName = AWS_IOT_METRICS_STRING;
+    xConnectInfo.userNameLength = AWS_IOT_METRICS_STRING_LENGTH;
+    /* Password for authentication is not used. */
+    xConnectInfo.pPassword = NULL;
+    xConnectInfo.passwordLength = 0U;
+
+    /* The maximum time interval in seconds which is allowed to elapse
+     * between two Control Packets. This is only the broker's safety net:
+     * the keep-alive manager pings much earlier, at the interval it has
+     * learned keeps the NAT mapping of this path open. */
+    xConnectInfo.keepAliveSeconds = KeepAlive_GetBrokerKeepAliveSeconds();
+
+    /* Retry until the broker accepts the connection. The reconnect engine
+     * spaces the attempts out with jitter and holds off phases that keep
+     * failing. */
+    while( ( xReturnStatus == pdFAIL ) && ( xInitFailed == false ) )
     {
-        /* Fill in Transport Interface send and receive function pointers. */
-        xTransport.pNetworkContext = pxNetworkContext;
-        xTransport.send = SecureSocketsTransport_Send;
-        xTransport.recv = SecureSocketsTransport_Recv;
-
-        /* Initialize MQTT library. */
-        eMqttStatus = MQTT_Init( pxMqttContext,
-                                 &xTransport,
-                                 prvGetTimeMs,
-                                 eventCallback,
-                                 pxNetworkBuffer );
+        Reconnect_WaitBeforeAttempt();
 
-        if( eMqttStatus != MQTTSuccess )
+        if( Reconnect_ConnectTransport( &xSecureSocketsTransportParams,
+                                        &xServerInfo,
+                                        &xSocketConfig ) != TRANSPORT_SOCKET_STATUS_SUCCESS )
         {
-            xReturnStatus = pdFAIL;
-            LogError( ( "MQTT init failed with status %s.",
-                        MQTT_Status_strerror( eMqttStatus ) ) );
+            LogWarn( ( "Connection to the broker failed. Attempting connection retry after backoff delay." ) );
         }
         else
         {
-            /* Establish MQTT session by sending a CONNECT packet. */
-
-            /* Many fields not used in this demo so start with everything at 0. */
-            ( void ) memset( ( void * ) &xConnectInfo, 0x00, sizeof( xConnectInfo ) );
-
-            /* Start with a clean session i.e. direct the MQTT broker to discard any
-             * previous session data. Also, establishing a connection with clean session
-             * will ensure that the broker does not store any data when this client
-             * gets disconnected. */
-            xConnectInfo.cleanSession = true;
-
-            /* The client identifier is used to uniquely identify this MQTT client to
-             * the MQTT broker. In a production device the identifier can be something
-             * unique, such as a device serial number. */
-            xConnectInfo.pClientIdentifier = democonfigCLIENT_IDENTIFIER;
-            xConnectInfo.clientIdentifierLength = ( uint16_t ) strlen( democonfigCLIENT_IDENTIFIER );
-
-            /* Use the metrics string as username to report the OS and MQTT client version
-             * metrics to AWS IoT. */
-            xConnectInfo.pUserName = AWS_IOT_METRICS_STRING;
-            xConnectInfo.userNameLength = AWS_IOT_METRICS_STRING_LENGTH;
-            /* Password for authentication is not used. */
-            xConnectInfo.pPassword = NULL;
-            xConnectInfo.passwordLength = 0U;
-
-            /* The maximum time interval in seconds which is allowed to elapse
-             * between two Control Packets.
-             * It is the responsibility of the Client to ensure that the interval between
-             * Control Packets being sent does not exceed the this Keep Alive value. In the
-             * absence of sending any other Control Packets, the Client MUST send a
-             * PINGREQ Packet. */
-            xConnectInfo.keepAliveSeconds = mqttexampleKEEP_ALIVE_TIMEOUT_SECONDS;
-
-            /* Send MQTT CONNECT packet to broker. */
-            eMqttStatus = MQTT_Connect( pxMqttContext,
-                                        &xConnectInfo,
-                                        NULL,
-                                        mqttexampleCONNACK_RECV_TIMEOUT_MS,
-                                        &sessionPresent );
+            /* Initialize MQTT library. */
+            xAppEventCallback = eventCallback;
+            eMqttStatus = MQTT_Init( pxMqttContext,
+                                     &xTransport,
+                                     prvGetTimeMs,
+                                     prvEventCallback,
+                                     pxNetworkBuffer );
 
             if( eMqttStatus != MQTTSuccess )
             {
-                xReturnStatus = pdFAIL;
-                LogError( ( "Connection with MQTT broker failed with status %s.",
+                xInitFailed = true;
+                LogError( ( "MQTT init failed with status %s.",
                             MQTT_Status_strerror( eMqttStatus ) ) );
             }
             else
             {
-                LogInfo( ( "MQTT connection successfully established with broker.\n\n" ) );
+                /* Send MQTT CONNECT packet to broker. */
+                Reconnect_OnConnackStart();
+                eMqttStatus = MQTT_Connect( pxMqttContext,
+                                            &xConnectInfo,
+                                            NULL,
+                                            mqttexampleCONNACK_RECV_TIMEOUT_MS,
+                                            &sessionPresent );
+
+                if( eMqttStatus != MQTTSuccess )
+                {
+                    Reconnect_OnConnackResult( pdFAIL );
+                    LogError( ( "Connection with MQTT broker failed with status %s.",
+                                MQTT_Status_strerror( eMqttStatus ) ) );
+                }
+                else
+                {
+                    Reconnect_OnConnackResult( pdPASS );
+                    xReturnStatus = pdPASS;
+                    LogInfo( ( "MQTT connection successfully established with broker.\n\n" ) );
+                }
             }
-        }
 
-        if( xReturnStatus == pdPASS )
-        {
-            /* Keep a flag for indicating if MQTT session is established. This
-             * flag will mark that an MQTT DISCONNECT has to be sent at the end
-             * of the demo even if there are intermediate failures. */
-            mqttSessionEstablished = true;
+            if( xReturnStatus == pdFAIL )
+            {
+                ( void ) SecureSocketsTransport_Disconnect( pxNetworkContext );
+            }
         }
+    }
 
-        if( xReturnStatus == pdPASS )
+    if( xReturnStatus == pdPASS )
+    {
+        /* Keep a flag for indicating if MQTT session is established. This
+         * flag will mark that an MQTT DISCONNECT has to be sent at the end
+         * of the demo even if there are intermediate failures. */
+        mqttSessionEstablished = true;
+        KeepAlive_OnSessionStart();
+
+        /* Check if session is present and if there are any outgoing publishes
+         * that need to resend. This is only valid if the broker is
+         * re-establishing a session which was already present. */
+        if( sessionPresent == true )
         {
-            /* Check if session is present and if there are any outgoing publishes
-             * that need to resend. This is only valid if the broker is
-             * re-establishing a session which was already present. */
-            if( sessionPresent == true )
-            {
-                LogInfo( ( "An MQTT session with broker is re-established. "
-                           "Resending unacked publishes." ) );
+            LogInfo( ( "An MQTT session with broker is re-established. "
+                       "Resending unacked publishes." ) );
 
-                /* Handle all the resend of publish messages. */
-                xReturnStatus = handlePublishResend( pxMqttContext );
-            }
-            else
-            {
-                LogInfo( ( "A clean MQTT connection is established."
-                           " Cleaning up all the stored outgoing publishes.\n\n" ) );
+            /* Handle all the resend of publish messages. */
+            xReturnStatus = handlePublishResend( pxMqttContext );
+        }
+        else
+        {
+            LogInfo( ( "A clean MQTT connection is established."
+                       " Cleaning up all the stored outgoing publishes.\n\n" ) );
 
-                /* Clean up the outgoing publishes waiting for ack as this new
-                 * connection doesn't re-establish an existing session. */
-                vCleanupOutgoingPublishes();
-            }
+            /* Clean up the outgoing publishes waiting for ack as this new
+             * connection doesn't re-establish an existing session. */
+            vCleanupOutgoingPublishes();
         }
     }
 
@@ -751,29 +709,46 @@ BaseType_t SubscribeToTopic( MQTTContext_t * pxMqttContext,
                              const char * pcTopicFilter,
                              uint16_t usTopicFilterLength )
 {
-    BaseType_t xReturnStatus = pdPASS;
-    MQTTStatus_t eMqttStatus;
-    MQTTSubscribeInfo_t pSubscriptionList[ mqttexampleTOPIC_COUNT ];
+    MQTTSubscribeInfo_t xSubscription;
 
-    assert( pxMqttContext != NULL );
     assert( pcTopicFilter != NULL );
     assert( usTopicFilterLength > 0 );
 
     /* Start with everything at 0. */
-    ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
+    ( void ) memset( ( void * ) &xSubscription, 0x00, sizeof( xSubscription ) );
 
     /* This example subscribes to only one topic and uses QOS1. */
-    pSubscriptionList[ 0 ].qos = MQTTQoS1;
-    pSubscriptionList[ 0 ].pTopicFilter = pcTopicFilter;
-    pSubscriptionList[ 0 ].topicFilterLength = usTopicFilterLength;
+    xSubscription.qos = MQTTQoS1;
+    xSubscription.pTopicFilter = pcTopicFilter;
+    xSubscription.topicFilterLength = usTopicFilterLength;
+
+    return SubscribeToTopics( pxMqttContext, &xSubscription, 1U );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t SubscribeToTopics( MQTTContext_t * pxMqttContext,
+                              const MQTTSubscribeInfo_t * pxSubscriptions,
+                              size_t xSubscriptionCount )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    MQTTStatus_t eMqttStatus;
+    uint32_t ulLoopCount = 0U;
+
+    assert( pxMqttContext != NULL );
+    assert( pxSubscriptions != NULL );
+    assert( xSubscriptionCount > 0U );
 
     /* Generate packet identifier for the SUBSCRIBE packet. */
     globalSubscribePacketIdentifier = MQTT_GetPacketId( pxMqttContext );
+    xSubackReceived = false;
+    MQTTMetrics_Start( &xSubscribeSentAt );
 
-    /* Send SUBSCRIBE packet. */
+    /* Send one SUBSCRIBE packet carrying every topic filter, so the broker
+     * answers all of them in a single SUBACK. */
     eMqttStatus = MQTT_Subscribe( pxMqttContext,
-                                  pSubscriptionList,
-                                  sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
+                                  pxSubscriptions,
+                                  xSubscriptionCount,
                                   globalSubscribePacketIdentifier );
 
     if( eMqttStatus != MQTTSuccess )
@@ -784,18 +759,22 @@ BaseType_t SubscribeToTopic( MQTTContext_t * pxMqttContext,
     }
     else
     {
-        LogInfo( ( "SUBSCRIBE topic %.*s to broker.\n\n",
-                   usTopicFilterLength,
-                   pcTopicFilter ) );
-
-        /* Process incoming packet from the broker. Acknowledgment for subscription
-         * ( SUBACK ) will be received here. However after sending the subscribe, the
-         * client may receive a publish before it receives a subscribe ack. Since this
-         * demo is subscribing to the topic to which no one is publishing, probability
-         * of receiving publish message before subscribe ack is zero; but application
-         * must be ready to receive any packet. This demo uses MQTT_ProcessLoop to
-         * receive packet from network. */
-        eMqttStatus = MQTT_ProcessLoop( pxMqttContext, mqttexamplePROCESS_LOOP_TIMEOUT_MS );
+        LogInfo( ( "SUBSCRIBE to %u topic filter(s), first %.*s, sent to broker.\n\n",
+                   ( unsigned ) xSubscriptionCount,
+                   pxSubscriptions[ 0 ].topicFilterLength,
+                   pxSubscriptions[ 0 ].pTopicFilter ) );
+        MQTTMetrics_Count( eMetricsSubscribeSent, 1UL );
+
+        /* Process incoming packets from the broker until the SUBACK arrives.
+         * A publish on one of the topics may arrive before it, and is handed
+         * to the event callback as usual. */
+        do
+        {
+            eMqttStatus = prvTimedProcessLoop( pxMqttContext, mqttexamplePROCESS_LOOP_TIMEOUT_MS );
+            ulLoopCount++;
+        } while( ( xSubackReceived == false ) &&
+                 ( eMqttStatus == MQTTSuccess ) &&
+                 ( ulLoopCount < mqttexampleSUBACK_WAIT_LOOPS ) );
 
         if( eMqttStatus != MQTTSuccess )
         {
@@ -803,6 +782,16 @@ BaseType_t SubscribeToTopic( MQTTContext_t * pxMqttContext,
             LogError( ( "MQTT_ProcessLoop returned with status = %s.",
                         MQTT_Status_strerror( eMqttStatus ) ) );
         }
+        else if( xSubackReceived == false )
+        {
+            xReturnStatus = pdFAIL;
+            LogError( ( "No SUBACK received for packet id %u.",
+                        globalSubscribePacketIdentifier ) );
+        }
+        else
+        {
+            /* SUBACK received. */
+        }
     }
 
     return xReturnStatus;
@@ -858,7 +847,7 @@ BaseType_t UnsubscribeFromTopic( MQTTContext_t * pxMqttContext,
          * of receiving publish message before subscribe ack is zero; but application
          * must be ready to receive any packet. This demo uses MQTT_ProcessLoop to
          * receive packet from network. */
-        eMqttStatus = MQTT_ProcessLoop( pxMqttContext, mqttexamplePROCESS_LOOP_TIMEOUT_MS );
+        eMqttStatus = prvTimedProcessLoop( pxMqttContext, mqttexamplePROCESS_LOOP_TIMEOUT_MS );
 
         if( eMqttStatus != MQTTSuccess )
         {
@@ -873,11 +862,12 @@ BaseType_t UnsubscribeFromTopic( MQTTContext_t * pxMqttContext,
 
 /*-----------------------------------------------------------*/
 
-BaseType_t PublishToTopic( MQTTContext_t * pxMqttContext,
-                           const char * pcTopicFilter,
-                           int32_t topicFilterLength,
-                           const char * pcPayload,
-                           size_t payloadLength )
+static BaseType_t prvSendPublish( MQTTContext_t * pxMqttContext,
+                                  const char * pcTopicFilter,
+                                  int32_t topicFilterLength,
+                                  const char * pcPayload,
+                                  size_t payloadLength,
+                                  uint16_t * pusPacketIdentifier )
 {
     BaseType_t xReturnStatus = pdPASS;
     MQTTStatus_t eMqttStatus = MQTTSuccess;
@@ -911,6 +901,7 @@ BaseType_t PublishToTopic( MQTTContext_t * pxMqttContext,
         outgoingPublishPackets[ ucPublishIndex ].packetId = MQTT_GetPacketId( pxMqttContext );
 
         /* Send PUBLISH packet. */
+        MQTTMetrics_Start( &outgoingPublishPackets[ ucPublishIndex ].xSentAt );
         eMqttStatus = MQTT_Publish( pxMqttContext,
                                     &outgoingPublishPackets[ ucPublishIndex ].pubInfo,
                                     outgoingPublishPackets[ ucPublishIndex ].packetId );
@@ -919,34 +910,131 @@ BaseType_t PublishToTopic( MQTTContext_t * pxMqttContext,
         {
             LogError( ( "Failed to send PUBLISH packet to broker with error = %s.",
                         MQTT_Status_strerror( eMqttStatus ) ) );
+            MQTTMetrics_Count( eMetricsPublishFailed, 1UL );
             vCleanupOutgoingPublishAt( ucPublishIndex );
             xReturnStatus = pdFAIL;
         }
         else
         {
+            MQTTMetrics_Count( eMetricsPublishSent, 1UL );
+            MQTTMetrics_Count( eMetricsPayloadBytesSent, ( uint32_t ) payloadLength );
+
             LogInfo( ( "PUBLISH sent for topic %.*s to broker with packet ID %u.\n\n",
                        topicFilterLength,
                        pcTopicFilter,
                        outgoingPublishPackets[ ucPublishIndex ].packetId ) );
 
-            /* Calling MQTT_ProcessLoop to process incoming publish echo, since
-             * application subscribed to the same topic the broker will send
-             * publish message back to the application. This function also
-             * sends ping request to broker if MQTT_KEEP_ALIVE_INTERVAL_SECONDS
-             * has expired since the last MQTT packet sent and receive
-             * ping responses. */
-            eMqttStatus = MQTT_ProcessLoop( pxMqttContext, mqttexamplePROCESS_LOOP_TIMEOUT_MS );
-
-            if( eMqttStatus != MQTTSuccess )
+            if( pusPacketIdentifier != NULL )
             {
-                LogWarn( ( "MQTT_ProcessLoop returned with status = %s.",
-                           MQTT_Status_strerror( eMqttStatus ) ) );
+                *pusPacketIdentifier = outgoingPublishPackets[ ucPublishIndex ].packetId;
             }
         }
     }
 
     return xReturnStatus;
 }
+
+/*-----------------------------------------------------------*/
+
+BaseType_t PublishToTopic( MQTTContext_t * pxMqttContext,
+                           const char * pcTopicFilter,
+                           int32_t topicFilterLength,
+                           const char * pcPayload,
+                           size_t payloadLength )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    BaseType_t xSent = pdFAIL;
+    MQTTStatus_t eMqttStatus = MQTTSuccess;
+
+    /* Behind messages still queued, a message is queued too, so the broker
+     * gets them in order. */
+    if( PublishQueue_GetDepth() == 0UL )
+    {
+        xSent = prvSendPublish( pxMqttContext,
+                                pcTopicFilter,
+                                topicFilterLength,
+                                pcPayload,
+                                payloadLength,
+                                NULL );
+    }
+
+    if( xSent == pdFAIL )
+    {
+        /* Delivered once a session is up again. */
+        xReturnStatus = PublishQueue_Enqueue( pcTopicFilter,
+                                              ( uint16_t ) topicFilterLength,
+                                              pcPayload,
+                                              payloadLength );
+
+        if( xReturnStatus == pdPASS )
+        {
+            LogInfo( ( "Queued the publish to %.*s.", ( int ) topicFilterLength, pcTopicFilter ) );
+        }
+    }
+    else
+    {
+        /* Calling MQTT_ProcessLoop to process incoming publish echo, since
+         * application subscribed to the same topic the broker will send
+         * publish message back to the application. This function also
+         * sends ping request to broker if MQTT_KEEP_ALIVE_INTERVAL_SECONDS
+         * has expired since the last MQTT packet sent and receive
+         * ping responses. */
+        eMqttStatus = prvTimedProcessLoop( pxMqttContext, mqttexamplePROCESS_LOOP_TIMEOUT_MS );
+
+        if( eMqttStatus != MQTTSuccess )
+        {
+            LogWarn( ( "MQTT_ProcessLoop returned with status = %s.",
+                       MQTT_Status_strerror( eMqttStatus ) ) );
+        }
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t PublishToTopicNoWait( MQTTContext_t * pxMqttContext,
+                                 const char * pcTopicFilter,
+                                 int32_t topicFilterLength,
+                                 const char * pcPayload,
+                                 size_t payloadLength,
+                                 uint16_t * pusPacketIdentifier )
+{
+    assert( pusPacketIdentifier != NULL );
+
+    return prvSendPublish( pxMqttContext,
+                           pcTopicFilter,
+                           topicFilterLength,
+                           pcPayload,
+                           payloadLength,
+                           pusPacketIdentifier );
+}
+
+/*-----------------------------------------------------------*/
+
+uint8_t GetFreeOutgoingPublishCount( void )
+{
+    uint8_t ucIndex = 0;
+    uint8_t ucFree = 0;
+
+    for( ; ucIndex < MAX_OUTGOING_PUBLISHES; ucIndex++ )
+    {
+        if( outgoingPublishPackets[ ucIndex ].packetId == MQTT_PACKET_ID_INVALID )
+        {
+            ucFree++;
+        }
+    }
+
+    return ucFree;
+}
+
+/*-----------------------------------------------------------*/
+
+void SetPublishAckCallback( PublishAckCallback_t xCallback )
+{
+    xPublishAckCallback = xCallback;
+}
+
 /*-----------------------------------------------------------*/
 
 BaseType_t ProcessLoop( MQTTContext_t * pxMqttContext,
@@ -955,12 +1043,28 @@ BaseType_t ProcessLoop( MQTTContext_t * pxMqttContext,
     BaseType_t xReturnStatus = pdFAIL;
     MQTTStatus_t eMqttStatus = MQTTSuccess;
 
-    eMqttStatus = MQTT_ProcessLoop( pxMqttContext, ulTimeoutMs );
+    /* Send a PINGREQ if the connection has been idle for the learned
+     * interval; the process loop below receives the PINGRESP. */
+    if( KeepAlive_Process( pxMqttContext ) == pdFAIL )
+    {
+        eMqttStatus = MQTTSendFailed;
+    }
+    else
+    {
+        eMqttStatus = prvTimedProcessLoop( pxMqttContext, ulTimeoutMs );
+    }
 
     if( eMqttStatus != MQTTSuccess )
     {
         LogWarn( ( "MQTT_ProcessLoop returned with status = %s.",
                    MQTT_Status_strerror( eMqttStatus ) ) );
+
+        if( ( eMqttStatus == MQTTKeepAliveTimeout ) ||
+            ( eMqttStatus == MQTTRecvFailed ) ||
+            ( eMqttStatus == MQTTSendFailed ) )
+        {
+            KeepAlive_OnConnectionLost();
+        }
     }
     else
     {
@@ -973,6 +1077,28 @@ BaseType_t ProcessLoop( MQTTContext_t * pxMqttContext,
 
 /*-----------------------------------------------------------*/
 
+static MQTTStatus_t prvTimedProcessLoop( MQTTContext_t * pxMqttContext,
+                                         uint32_t ulTimeoutMs )
+{
+    MQTTStatus_t eMqttStatus = MQTTSuccess;
+    MQTTMetricsTimestamp_t xStart;
+
+    MQTTMetrics_Start( &xStart );
+    eMqttStatus = MQTT_ProcessLoop( pxMqttContext, ulTimeoutMs );
+    MQTTMetrics_Record( eMetricsProcessLoop, &xStart );
+
+    MQTTMetrics_Count( eMetricsProcessLoopCalls, 1UL );
+
+    if( eMqttStatus != MQTTSuccess )
+    {
+        MQTTMetrics_Count( eMetricsProcessLoopFailures, 1UL );
+    }
+
+    return eMqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
 static uint32_t prvGetTimeMs( void )
 {
     TickType_t xTickCount = 0;
@@ -992,3 +1118,22 @@ static uint32_t prvGetTimeMs( void )
 }
 
 /*-----------------------------------------------------------*/
+
+static void prvEventCallback( MQTTContext_t * pxMqttContext,
+                              MQTTPacketInfo_t * pxPacketInfo,
+                              MQTTDeserializedInfo_t * pxDeserializedInfo )
+{
+    MQTTMetricsTimestamp_t xStart;
+
+    KeepAlive_OnPacketReceived( pxMqttContext );
+    MQTTMetrics_Count( eMetricsPacketsReceived, 1UL );
+
+    if( xAppEventCallback != NULL )
+    {
+        MQTTMetrics_Start( &xStart );
+        xAppEventCallback( pxMqttContext, pxPacketInfo, pxDeserializedInfo );
+        MQTTMetrics_Record( eMetricsEventCallback, &xStart );
+    }
+}
+
+/*-----------------------------------------------------------*/
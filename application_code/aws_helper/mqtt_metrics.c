@@ -0,0 +1,435 @@
+/*
+ * mqtt_metrics.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file mqtt_metrics.c
+ *
+ * @brief Latency histograms and counters for the MQTT helpers.
+ *
+ * The DWT cycle counter wraps after 2^32 cycles, about 53 seconds at
+ * 80 MHz, so intervals that the tick count shows to be longer than
+ * metricsCYCLE_SPAN_MS are measured in ticks instead. Both clocks are read
+ * when an interval starts; only the tick path costs a multiply.
+ *
+ * The telemetry message is queued by a task of its own rather than from the
+ * process loop, which only runs while a session is up.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+/* MQTT metrics configuration. */
+#include "mqtt_metrics_config.h"
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Include header for client credentials. */
+#include "aws_clientcredential.h"
+
+/* Store-and-forward publish queue. */
+#include "publish_queue.h"
+
+/* Shared buffer pool. */
+#include "buffer_pool.h"
+
+#include "mqtt_metrics.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Cortex-M debug registers used to run the cycle counter.
+ */
+#define metricsDEMCR               ( *( ( volatile uint32_t * ) 0xE000EDFCUL ) )
+#define metricsDWT_CTRL            ( *( ( volatile uint32_t * ) 0xE0001000UL ) )
+#define metricsDWT_CYCCNT          ( *( ( volatile uint32_t * ) 0xE0001004UL ) )
+#define metricsDEMCR_TRCENA        ( 1UL << 24 )
+#define metricsDWT_CTRL_CYCCNTENA  ( 1UL << 0 )
+
+/**
+ * @brief CPU cycles per microsecond.
+ */
+#define metricsCYCLES_PER_US       ( configCPU_CLOCK_HZ / 1000000UL )
+
+/**
+ * @brief Intervals at least this long are measured with the tick count.
+ */
+#define metricsCYCLE_SPAN_MS       ( 30000UL )
+
+/**
+ * @brief Microseconds per FreeRTOS tick.
+ */
+#define metricsUS_PER_TICK         ( 1000000UL / configTICK_RATE_HZ )
+
+/**
+ * @brief Size of the buffer the telemetry message is formatted in.
+ */
+#define metricsMESSAGE_BUFFER_SIZE ( 512U )
+
+/**
+ * @brief Longest telemetry topic, including the thing name.
+ */
+#define metricsMAX_TOPIC_LENGTH    ( 64U )
+
+/*-----------------------------------------------------------*/
+
+static uint32_t ulCounters[ eMetricsCounterMax ];
+static MQTTMetricsHistogramData_t xHistograms[ eMetricsHistogramMax ];
+
+/**
+ * @brief Time the last telemetry message was queued.
+ */
+static TickType_t xLastPublishTicks = 0;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Index of the log2 bucket for a duration.
+ *
+ * Five compares, instead of a count-leading-zeros intrinsic, so the code
+ * does not depend on the compiler.
+ */
+static uint32_t prvBucketIndex( uint32_t ulUs );
+
+/**
+ * @brief Add one histogram to the telemetry message as
+ * "name":[count,p50,p99,max].
+ */
+static int prvFormatHistogram( char * pcBuffer,
+                               size_t xBufferLength,
+                               const char * pcName,
+                               const MQTTMetricsHistogramData_t * pxHistogram );
+
+#if ( mqttmetricsconfigPUBLISH_INTERVAL_MS > 0 )
+
+/**
+ * @brief Queue the telemetry message every interval.
+ *
+ * @param[in] pvParameters Unused.
+ */
+    static void prvMetricsTask( void * pvParameters );
+#endif
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvBucketIndex( uint32_t ulUs )
+{
+    uint32_t ulIndex = 0UL;
+
+    if( ulUs >= ( 1UL << 16 ) )
+    {
+        ulUs >>= 16;
+        ulIndex += 16UL;
+    }
+
+    if( ulUs >= ( 1UL << 8 ) )
+    {
+        ulUs >>= 8;
+        ulIndex += 8UL;
+    }
+
+    if( ulUs >= ( 1UL << 4 ) )
+    {
+        ulUs >>= 4;
+        ulIndex += 4UL;
+    }
+
+    if( ulUs >= ( 1UL << 2 ) )
+    {
+        ulUs >>= 2;
+        ulIndex += 2UL;
+    }
+
+    if( ulUs >= ( 1UL << 1 ) )
+    {
+        ulIndex += 1UL;
+    }
+
+    if( ulIndex >= mqttmetricsNUM_BUCKETS )
+    {
+        ulIndex = mqttmetricsNUM_BUCKETS - 1UL;
+    }
+
+    return ulIndex;
+}
+
+/*-----------------------------------------------------------*/
+
+void MQTTMetrics_Init( void )
+{
+    metricsDEMCR |= metricsDEMCR_TRCENA;
+    metricsDWT_CYCCNT = 0UL;
+    metricsDWT_CTRL |= metricsDWT_CTRL_CYCCNTENA;
+
+    xLastPublishTicks = xTaskGetTickCount();
+
+    #if ( mqttmetricsconfigPUBLISH_INTERVAL_MS > 0 )
+        if( xTaskCreate( prvMetricsTask,
+                         "Metrics",
+                         mqttmetricsconfigTASK_STACK_SIZE,
+                         NULL,
+                         mqttmetricsconfigTASK_PRIORITY,
+                         NULL ) != pdPASS )
+        {
+            LogError( ( "Failed to create the metrics task." ) );
+        }
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( mqttmetricsconfigPUBLISH_INTERVAL_MS > 0 )
+    static void prvMetricsTask( void * pvParameters )
+    {
+        TickType_t xWakeTime = xTaskGetTickCount();
+
+        ( void ) pvParameters;
+
+        for( ; ; )
+        {
+            vTaskDelayUntil( &xWakeTime, pdMS_TO_TICKS( mqttmetricsconfigPUBLISH_INTERVAL_MS ) );
+            MQTTMetrics_PublishIfDue();
+        }
+    }
+#endif /* if ( mqttmetricsconfigPUBLISH_INTERVAL_MS > 0 ) */
+
+/*-----------------------------------------------------------*/
+
+void MQTTMetrics_Start( MQTTMetricsTimestamp_t * pxTimestamp )
+{
+    assert( pxTimestamp != NULL );
+
+    pxTimestamp->xTicks = xTaskGetTickCount();
+    pxTimestamp->ulCycles = metricsDWT_CYCCNT;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t MQTTMetrics_ElapsedUs( const MQTTMetricsTimestamp_t * pxStart )
+{
+    uint32_t ulCycles = metricsDWT_CYCCNT;
+    TickType_t xTicks = xTaskGetTickCount() - pxStart->xTicks;
+    uint32_t ulUs = 0UL;
+
+    if( xTicks >= pdMS_TO_TICKS( metricsCYCLE_SPAN_MS ) )
+    {
+        ulUs = ( uint32_t ) xTicks * metricsUS_PER_TICK;
+    }
+    else
+    {
+        ulUs = ( ulCycles - pxStart->ulCycles ) / metricsCYCLES_PER_US;
+    }
+
+    return ulUs;
+}
+
+/*-----------------------------------------------------------*/
+
+void MQTTMetrics_Record( MQTTMetricsHistogram_t eHistogram,
+                         const MQTTMetricsTimestamp_t * pxStart )
+{
+    uint32_t ulUs = MQTTMetrics_ElapsedUs( pxStart );
+    MQTTMetricsHistogramData_t * pxHistogram = NULL;
+
+    assert( eHistogram < eMetricsHistogramMax );
+
+    pxHistogram = &xHistograms[ eHistogram ];
+    pxHistogram->ulBuckets[ prvBucketIndex( ulUs ) ]++;
+    pxHistogram->ulCount++;
+    pxHistogram->ullSumUs += ulUs;
+
+    if( ulUs > pxHistogram->ulMaxUs )
+    {
+        pxHistogram->ulMaxUs = ulUs;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void MQTTMetrics_Count( MQTTMetricsCounter_t eCounter,
+                        uint32_t ulAmount )
+{
+    assert( eCounter < eMetricsCounterMax );
+
+    ulCounters[ eCounter ] += ulAmount;
+}
+
+/*-----------------------------------------------------------*/
+
+void MQTTMetrics_GetSnapshot( MQTTMetricsSnapshot_t * pxSnapshot )
+{
+    assert( pxSnapshot != NULL );
+
+    /* The sums are 64 bits wide, so copy without being preempted by the
+     * task that records them. */
+    taskENTER_CRITICAL();
+    {
+        ( void ) memcpy( pxSnapshot->ulCounters, ulCounters, sizeof( ulCounters ) );
+        ( void ) memcpy( pxSnapshot->xHistograms, xHistograms, sizeof( xHistograms ) );
+    }
+    taskEXIT_CRITICAL();
+
+    pxSnapshot->xTakenAt = xTaskGetTickCount();
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t MQTTMetrics_Percentile( const MQTTMetricsHistogramData_t * pxHistogram,
+                                 uint32_t ulPermille )
+{
+    uint32_t ulResult = 0UL;
+    uint64_t ullRank = 0ULL;
+    uint64_t ullSeen = 0ULL;
+    uint32_t ulIndex = 0UL;
+
+    assert( pxHistogram != NULL );
+
+    if( pxHistogram->ulCount > 0UL )
+    {
+        /* Rank of the sample at the percentile, rounded up. */
+        ullRank = ( ( ( uint64_t ) pxHistogram->ulCount * ulPermille ) + 999ULL ) / 1000ULL;
+
+        if( ullRank == 0ULL )
+        {
+            ullRank = 1ULL;
+        }
+
+        for( ulIndex = 0UL; ulIndex < mqttmetricsNUM_BUCKETS; ulIndex++ )
+        {
+            ullSeen += pxHistogram->ulBuckets[ ulIndex ];
+
+            if( ullSeen >= ullRank )
+            {
+                break;
+            }
+        }
+
+        /* The top of the bucket, but never more than the largest sample. */
+        if( ulIndex < ( mqttmetricsNUM_BUCKETS - 1UL ) )
+        {
+            ulResult = ( 2UL << ulIndex ) - 1UL;
+        }
+        else
+        {
+            ulResult = pxHistogram->ulMaxUs;
+        }
+
+        if( ulResult > pxHistogram->ulMaxUs )
+        {
+            ulResult = pxHistogram->ulMaxUs;
+        }
+    }
+
+    return ulResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvFormatHistogram( char * pcBuffer,
+                               size_t xBufferLength,
+                               const char * pcName,
+                               const MQTTMetricsHistogramData_t * pxHistogram )
+{
+    return snprintf( pcBuffer,
+                     xBufferLength,
+                     ",\"%s\":[%lu,%lu,%lu,%lu]",
+                     pcName,
+                     ( unsigned long ) pxHistogram->ulCount,
+                     ( unsigned long ) MQTTMetrics_Percentile( pxHistogram, 500UL ),
+                     ( unsigned long ) MQTTMetrics_Percentile( pxHistogram, 990UL ),
+                     ( unsigned long ) pxHistogram->ulMaxUs );
+}
+
+/*-----------------------------------------------------------*/
+
+void MQTTMetrics_PublishIfDue( void )
+{
+    #if ( mqttmetricsconfigPUBLISH_INTERVAL_MS > 0 )
+        static const char * const pcHistogramNames[ eMetricsHistogramMax ] = { "pa", "sr", "pl", "cb", "su" };
+        static MQTTMetricsSnapshot_t xSnapshot;
+        char cTopic[ metricsMAX_TOPIC_LENGTH ];
+        char * pcMessage = NULL;
+        int lTopicLength = 0;
+        int lLength = 0;
+        int lWritten = 0;
+        uint32_t ulIndex = 0UL;
+
+        if( ( xTaskGetTickCount() - xLastPublishTicks ) < pdMS_TO_TICKS( mqttmetricsconfigPUBLISH_INTERVAL_MS ) )
+        {
+            return;
+        }
+
+        xLastPublishTicks = xTaskGetTickCount();
+
+        pcMessage = ( char * ) BufferPool_Acquire( metricsMESSAGE_BUFFER_SIZE );
+
+        if( pcMessage == NULL )
+        {
+            LogWarn( ( "No buffer for the metrics message." ) );
+            return;
+        }
+
+        MQTTMetrics_GetSnapshot( &xSnapshot );
+
+        lTopicLength = snprintf( cTopic, sizeof( cTopic ), mqttmetricsconfigTOPIC_FORMAT, clientcredentialIOT_THING_NAME );
+
+        lLength = snprintf( pcMessage,
+                            metricsMESSAGE_BUFFER_SIZE,
+                            "{\"pub\":[%lu,%lu,%lu,%lu],\"sub\":[%lu,%lu],\"loop\":[%lu,%lu],\"rx\":%lu,\"sync\":[%lu,%lu,%lu,%lu]",
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsPublishSent ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsPublishFailed ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsPubackReceived ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsPayloadBytesSent ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsSubscribeSent ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsSubackReceived ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsProcessLoopCalls ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsProcessLoopFailures ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsPacketsReceived ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsShadowSyncs ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsShadowRoundTrips ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsShadowCoalesced ],
+                            ( unsigned long ) xSnapshot.ulCounters[ eMetricsShadowBytes ] );
+
+        for( ulIndex = 0UL; ( ulIndex < eMetricsHistogramMax ) && ( lLength > 0 ) && ( lLength < ( int ) metricsMESSAGE_BUFFER_SIZE ); ulIndex++ )
+        {
+            lWritten = prvFormatHistogram( &pcMessage[ lLength ],
+                                           metricsMESSAGE_BUFFER_SIZE - ( size_t ) lLength,
+                                           pcHistogramNames[ ulIndex ],
+                                           &xSnapshot.xHistograms[ ulIndex ] );
+            lLength = ( lWritten < 0 ) ? -1 : ( lLength + lWritten );
+        }
+
+        if( ( lLength > 0 ) && ( lLength < ( int ) metricsMESSAGE_BUFFER_SIZE - 1 ) )
+        {
+            pcMessage[ lLength++ ] = '}';
+        }
+        else
+        {
+            lLength = -1;
+        }
+
+        if( ( lTopicLength <= 0 ) || ( lTopicLength >= ( int ) sizeof( cTopic ) ) || ( lLength < 0 ) )
+        {
+            LogError( ( "Metrics message does not fit its buffers." ) );
+        }
+        else if( PublishQueue_Enqueue( cTopic, ( uint16_t ) lTopicLength, pcMessage, ( size_t ) lLength ) != pdPASS )
+        {
+            LogWarn( ( "Failed to queue the metrics message." ) );
+        }
+        else
+        {
+            LogDebug( ( "Queued %d byte metrics message.", lLength ) );
+        }
+
+        BufferPool_Release( pcMessage );
+    #endif /* if ( mqttmetricsconfigPUBLISH_INTERVAL_MS > 0 ) */
+}
+
+/*-----------------------------------------------------------*/
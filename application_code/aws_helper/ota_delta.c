@@ -0,0 +1,454 @@
+/*
+ * ota_delta.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file ota_delta.c
+ *
+ * @brief Streaming application of delta OTA images.
+ *
+ * The patch is consumed from the input buffer, which is refilled through
+ * the read callback whenever it runs dry, and the new image is built in the
+ * output buffer, which is written out whenever it is full. Runs of old
+ * bytes and of extra bytes are copied a buffer at a time; only difference
+ * literals are handled byte by byte. Every length in the patch is checked
+ * against the images before it is used, so a corrupt patch is rejected
+ * instead of reading or writing out of bounds.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "ota_delta.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Longest LEB128 encoding of a 32-bit number.
+ */
+#define otadeltaMAX_VARINT_BYTES    ( 5U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief State of one application of a patch.
+ */
+typedef struct OtaDeltaStream
+{
+    const OtaDeltaParams_t * pxParams;
+    uint32_t ulReadOffset;  /**< @brief Patch offset of the byte after those in the input buffer. */
+    uint32_t ulInputPos;    /**< @brief Next byte of the input buffer. */
+    uint32_t ulInputFill;   /**< @brief Bytes in the input buffer. */
+    uint32_t ulOutputFill;  /**< @brief Bytes in the output buffer. */
+    uint32_t ulWritten;     /**< @brief Bytes of the new image written. */
+    OtaDeltaStatus_t xStatus;
+} OtaDeltaStream_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read the next part of the patch into the input buffer.
+ *
+ * @return Whether there are bytes to take.
+ */
+static bool prvFill( OtaDeltaStream_t * pxStream );
+
+/**
+ * @brief Take the next byte of the patch.
+ */
+static bool prvGetByte( OtaDeltaStream_t * pxStream,
+                        uint8_t * pucByte );
+
+/**
+ * @brief Take the next varint of the patch.
+ */
+static bool prvGetVarint( OtaDeltaStream_t * pxStream,
+                          uint32_t * pulValue );
+
+/**
+ * @brief Write out the output buffer.
+ */
+static void prvFlush( OtaDeltaStream_t * pxStream );
+
+/**
+ * @brief Append a byte to the new image.
+ */
+static void prvPutByte( OtaDeltaStream_t * pxStream,
+                        uint8_t ucByte );
+
+/**
+ * @brief Append a run of the old image to the new one.
+ */
+static void prvPutOld( OtaDeltaStream_t * pxStream,
+                       uint32_t ulOldPos,
+                       uint32_t ulLength );
+
+/**
+ * @brief Append a run of the patch to the new image.
+ */
+static void prvPutExtra( OtaDeltaStream_t * pxStream,
+                         uint32_t ulLength );
+
+/*-----------------------------------------------------------*/
+
+static bool prvFill( OtaDeltaStream_t * pxStream )
+{
+    const OtaDeltaParams_t * pxParams = pxStream->pxParams;
+    uint32_t ulLength = pxParams->ulPatchSize - pxStream->ulReadOffset;
+    int32_t lRead = 0;
+
+    if( ulLength > pxParams->ulInputSize )
+    {
+        ulLength = pxParams->ulInputSize;
+    }
+
+    if( pxStream->xStatus != eOtaDeltaSuccess )
+    {
+        /* Stopped already. */
+    }
+    else if( ulLength == 0UL )
+    {
+        /* The patch ends in the middle of a record. */
+        pxStream->xStatus = eOtaDeltaBadPatch;
+    }
+    else
+    {
+        lRead = pxParams->xRead( pxParams->pvContext, pxStream->ulReadOffset, pxParams->pucInput, ulLength );
+
+        if( ( lRead <= 0 ) || ( ( uint32_t ) lRead > ulLength ) )
+        {
+            pxStream->xStatus = eOtaDeltaReadFailed;
+        }
+        else
+        {
+            pxStream->ulReadOffset += ( uint32_t ) lRead;
+            pxStream->ulInputPos = 0UL;
+            pxStream->ulInputFill = ( uint32_t ) lRead;
+        }
+    }
+
+    return pxStream->xStatus == eOtaDeltaSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvGetByte( OtaDeltaStream_t * pxStream,
+                        uint8_t * pucByte )
+{
+    bool xTaken = false;
+
+    if( ( pxStream->ulInputPos < pxStream->ulInputFill ) || prvFill( pxStream ) )
+    {
+        *pucByte = pxStream->pxParams->pucInput[ pxStream->ulInputPos ];
+        pxStream->ulInputPos++;
+        xTaken = true;
+    }
+
+    return xTaken;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvGetVarint( OtaDeltaStream_t * pxStream,
+                          uint32_t * pulValue )
+{
+    uint32_t ulValue = 0UL;
+    uint32_t ulBytes = 0UL;
+    uint8_t ucByte = 0x80U;
+
+    while( ( ( ucByte & 0x80U ) != 0U ) && prvGetByte( pxStream, &ucByte ) )
+    {
+        /* The fifth byte only has four bits left for a 32-bit number. */
+        if( ( ulBytes == ( otadeltaMAX_VARINT_BYTES - 1U ) ) && ( ucByte > 0x0FU ) )
+        {
+            pxStream->xStatus = eOtaDeltaBadPatch;
+            break;
+        }
+
+        ulValue |= ( uint32_t ) ( ucByte & 0x7FU ) << ( 7UL * ulBytes );
+        ulBytes++;
+    }
+
+    *pulValue = ulValue;
+
+    return pxStream->xStatus == eOtaDeltaSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvFlush( OtaDeltaStream_t * pxStream )
+{
+    const OtaDeltaParams_t * pxParams = pxStream->pxParams;
+
+    if( ( pxStream->xStatus == eOtaDeltaSuccess ) && ( pxStream->ulOutputFill > 0UL ) )
+    {
+        if( pxParams->xWrite( pxParams->pvContext,
+                              pxStream->ulWritten,
+                              pxParams->pucOutput,
+                              pxStream->ulOutputFill ) != ( int32_t ) pxStream->ulOutputFill )
+        {
+            pxStream->xStatus = eOtaDeltaWriteFailed;
+        }
+
+        pxStream->ulWritten += pxStream->ulOutputFill;
+        pxStream->ulOutputFill = 0UL;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPutByte( OtaDeltaStream_t * pxStream,
+                        uint8_t ucByte )
+{
+    pxStream->pxParams->pucOutput[ pxStream->ulOutputFill ] = ucByte;
+    pxStream->ulOutputFill++;
+
+    if( pxStream->ulOutputFill == pxStream->pxParams->ulOutputSize )
+    {
+        prvFlush( pxStream );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPutOld( OtaDeltaStream_t * pxStream,
+                       uint32_t ulOldPos,
+                       uint32_t ulLength )
+{
+    const OtaDeltaParams_t * pxParams = pxStream->pxParams;
+    uint32_t ulDone = 0UL;
+    uint32_t ulChunk = 0UL;
+
+    while( ( pxStream->xStatus == eOtaDeltaSuccess ) && ( ulDone < ulLength ) )
+    {
+        ulChunk = pxParams->ulOutputSize - pxStream->ulOutputFill;
+
+        if( ulChunk > ( ulLength - ulDone ) )
+        {
+            ulChunk = ulLength - ulDone;
+        }
+
+        ( void ) memcpy( &pxParams->pucOutput[ pxStream->ulOutputFill ], &pxParams->pucOld[ ulOldPos + ulDone ], ulChunk );
+        pxStream->ulOutputFill += ulChunk;
+        ulDone += ulChunk;
+
+        if( pxStream->ulOutputFill == pxParams->ulOutputSize )
+        {
+            prvFlush( pxStream );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPutExtra( OtaDeltaStream_t * pxStream,
+                         uint32_t ulLength )
+{
+    const OtaDeltaParams_t * pxParams = pxStream->pxParams;
+    uint32_t ulDone = 0UL;
+    uint32_t ulChunk = 0UL;
+
+    while( ( pxStream->xStatus == eOtaDeltaSuccess ) && ( ulDone < ulLength ) )
+    {
+        if( ( pxStream->ulInputPos < pxStream->ulInputFill ) || prvFill( pxStream ) )
+        {
+            ulChunk = pxParams->ulOutputSize - pxStream->ulOutputFill;
+
+            if( ulChunk > ( pxStream->ulInputFill - pxStream->ulInputPos ) )
+            {
+                ulChunk = pxStream->ulInputFill - pxStream->ulInputPos;
+            }
+
+            if( ulChunk > ( ulLength - ulDone ) )
+            {
+                ulChunk = ulLength - ulDone;
+            }
+
+            ( void ) memcpy( &pxParams->pucOutput[ pxStream->ulOutputFill ], &pxParams->pucInput[ pxStream->ulInputPos ], ulChunk );
+            pxStream->ulOutputFill += ulChunk;
+            pxStream->ulInputPos += ulChunk;
+            ulDone += ulChunk;
+
+            if( pxStream->ulOutputFill == pxParams->ulOutputSize )
+            {
+                prvFlush( pxStream );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+OtaDeltaStatus_t OtaDelta_ParseHeader( const uint8_t * pucData,
+                                       uint32_t ulLength,
+                                       OtaDeltaHeader_t * pxHeader )
+{
+    OtaDeltaStatus_t xStatus = eOtaDeltaSuccess;
+    uint32_t ulMagic = 0UL;
+
+    if( ( pucData == NULL ) || ( pxHeader == NULL ) )
+    {
+        xStatus = eOtaDeltaBadParameter;
+    }
+    else if( ulLength < otadeltaHEADER_SIZE )
+    {
+        xStatus = eOtaDeltaBadPatch;
+    }
+    else
+    {
+        ulMagic = ( uint32_t ) pucData[ 0 ] | ( ( uint32_t ) pucData[ 1 ] << 8 ) |
+                  ( ( uint32_t ) pucData[ 2 ] << 16 ) | ( ( uint32_t ) pucData[ 3 ] << 24 );
+        pxHeader->ulOldSize = ( uint32_t ) pucData[ 4 ] | ( ( uint32_t ) pucData[ 5 ] << 8 ) |
+                              ( ( uint32_t ) pucData[ 6 ] << 16 ) | ( ( uint32_t ) pucData[ 7 ] << 24 );
+        pxHeader->ulNewSize = ( uint32_t ) pucData[ 8 ] | ( ( uint32_t ) pucData[ 9 ] << 8 ) |
+                              ( ( uint32_t ) pucData[ 10 ] << 16 ) | ( ( uint32_t ) pucData[ 11 ] << 24 );
+        ( void ) memcpy( pxHeader->ucOldDigest, &pucData[ 12 ], otadeltaDIGEST_SIZE );
+
+        if( ulMagic != otadeltaMAGIC )
+        {
+            xStatus = eOtaDeltaBadPatch;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaDeltaStatus_t OtaDelta_Apply( const OtaDeltaParams_t * pxParams,
+                                 uint32_t * pulNewSize )
+{
+    OtaDeltaStream_t xStream = { 0 };
+    OtaDeltaHeader_t xHeader = { 0 };
+    uint8_t ucHeader[ otadeltaHEADER_SIZE ];
+    uint32_t ulOldPos = 0UL;
+    uint32_t ulProduced = 0UL;
+    uint32_t ulDiffLength = 0UL;
+    uint32_t ulExtraLength = 0UL;
+    uint32_t ulSeek = 0UL;
+    uint32_t ulZeros = 0UL;
+    uint32_t ulLiterals = 0UL;
+    uint32_t i = 0UL;
+    int64_t llOldPos = 0;
+    uint8_t ucByte = 0U;
+
+    xStream.pxParams = pxParams;
+    xStream.xStatus = eOtaDeltaSuccess;
+
+    if( ( pxParams == NULL ) || ( pxParams->pucOld == NULL ) ||
+        ( pxParams->xRead == NULL ) || ( pxParams->xWrite == NULL ) ||
+        ( pxParams->pucInput == NULL ) || ( pxParams->ulInputSize == 0UL ) ||
+        ( pxParams->pucOutput == NULL ) || ( pxParams->ulOutputSize == 0UL ) )
+    {
+        xStream.xStatus = eOtaDeltaBadParameter;
+    }
+
+    for( i = 0UL; ( xStream.xStatus == eOtaDeltaSuccess ) && ( i < otadeltaHEADER_SIZE ); i++ )
+    {
+        ( void ) prvGetByte( &xStream, &ucHeader[ i ] );
+    }
+
+    if( xStream.xStatus == eOtaDeltaSuccess )
+    {
+        xStream.xStatus = OtaDelta_ParseHeader( ucHeader, otadeltaHEADER_SIZE, &xHeader );
+
+        if( ( xStream.xStatus == eOtaDeltaSuccess ) && ( xHeader.ulOldSize > pxParams->ulOldSize ) )
+        {
+            xStream.xStatus = eOtaDeltaBadPatch;
+        }
+    }
+
+    while( ( xStream.xStatus == eOtaDeltaSuccess ) && ( ulProduced < xHeader.ulNewSize ) )
+    {
+        if( prvGetVarint( &xStream, &ulDiffLength ) &&
+            prvGetVarint( &xStream, &ulExtraLength ) &&
+            prvGetVarint( &xStream, &ulSeek ) )
+        {
+            if( ( ulDiffLength > ( xHeader.ulNewSize - ulProduced ) ) ||
+                ( ulExtraLength > ( xHeader.ulNewSize - ulProduced - ulDiffLength ) ) ||
+                ( ulDiffLength > ( xHeader.ulOldSize - ulOldPos ) ) )
+            {
+                xStream.xStatus = eOtaDeltaBadPatch;
+            }
+        }
+
+        /* Differences: unchanged runs are copied, changed bytes added. */
+        ulProduced += ulDiffLength;
+
+        while( ( xStream.xStatus == eOtaDeltaSuccess ) && ( ulDiffLength > 0UL ) )
+        {
+            if( prvGetVarint( &xStream, &ulZeros ) && prvGetVarint( &xStream, &ulLiterals ) )
+            {
+                if( ( ( ulZeros == 0UL ) && ( ulLiterals == 0UL ) ) ||
+                    ( ulZeros > ulDiffLength ) ||
+                    ( ulLiterals > ( ulDiffLength - ulZeros ) ) )
+                {
+                    xStream.xStatus = eOtaDeltaBadPatch;
+                }
+            }
+
+            if( xStream.xStatus == eOtaDeltaSuccess )
+            {
+                prvPutOld( &xStream, ulOldPos, ulZeros );
+                ulOldPos += ulZeros;
+                ulDiffLength -= ulZeros + ulLiterals;
+            }
+
+            for( i = 0UL; ( xStream.xStatus == eOtaDeltaSuccess ) && ( i < ulLiterals ); i++ )
+            {
+                if( prvGetByte( &xStream, &ucByte ) )
+                {
+                    prvPutByte( &xStream, ( uint8_t ) ( pxParams->pucOld[ ulOldPos ] + ucByte ) );
+                    ulOldPos++;
+                }
+            }
+        }
+
+        /* New bytes. */
+        ulProduced += ulExtraLength;
+        prvPutExtra( &xStream, ulExtraLength );
+
+        /* Seek, zigzag-encoded so small moves back stay small. */
+        if( xStream.xStatus == eOtaDeltaSuccess )
+        {
+            if( ( ulSeek & 1UL ) != 0UL )
+            {
+                llOldPos = ( int64_t ) ulOldPos - ( int64_t ) ( ulSeek >> 1 ) - 1;
+            }
+            else
+            {
+                llOldPos = ( int64_t ) ulOldPos + ( int64_t ) ( ulSeek >> 1 );
+            }
+
+            if( ( llOldPos < 0 ) || ( llOldPos > ( int64_t ) xHeader.ulOldSize ) )
+            {
+                xStream.xStatus = eOtaDeltaBadPatch;
+            }
+            else
+            {
+                ulOldPos = ( uint32_t ) llOldPos;
+            }
+        }
+    }
+
+    prvFlush( &xStream );
+
+    /* Anything after the last record means the patch is not what it claims. */
+    if( ( xStream.xStatus == eOtaDeltaSuccess ) &&
+        ( ( xStream.ulReadOffset - xStream.ulInputFill + xStream.ulInputPos ) != pxParams->ulPatchSize ) )
+    {
+        xStream.xStatus = eOtaDeltaBadPatch;
+    }
+
+    if( pulNewSize != NULL )
+    {
+        *pulNewSize = xStream.ulWritten;
+    }
+
+    return xStream.xStatus;
+}
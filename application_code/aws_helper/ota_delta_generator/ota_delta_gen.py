@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+
+import argparse
+import hashlib
+import struct
+
+MAGIC = 0x314C444F  # "ODL1"
+KEY_LENGTH = 8
+# A match is extended while this many more bytes match than differ.
+GIVE_UP_SCORE = 64
+# Zero runs shorter than this are cheaper inside a literal run.
+MIN_ZERO_RUN = 3
+
+
+def varint(value) -> bytes:
+    """
+    Encode an unsigned number as a LEB128 varint.
+    """
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def zigzag(value) -> int:
+    """
+    Map a signed number to an unsigned one, small magnitudes first.
+    """
+    return (value << 1) if value >= 0 else ((-value - 1) << 1) | 1
+
+
+def index_old(old) -> dict:
+    """
+    Map every KEY_LENGTH-byte string of the old image to its first position.
+    """
+    index = {}
+    for pos in range(len(old) - KEY_LENGTH + 1):
+        index.setdefault(old[pos : pos + KEY_LENGTH], pos)
+    return index
+
+
+def extend(old, new, old_pos, new_pos) -> int:
+    """
+    Length of the best approximate match at old_pos/new_pos: the one that
+    maximises matching bytes minus differing bytes, as bsdiff does.
+    """
+    score = best_score = best_length = 0
+    length = 0
+    limit = min(len(old) - old_pos, len(new) - new_pos)
+    while length < limit and score > best_score - GIVE_UP_SCORE:
+        score += 1 if old[old_pos + length] == new[new_pos + length] else -1
+        length += 1
+        if score > best_score:
+            best_score = score
+            best_length = length
+    return best_length
+
+
+def find_anchor(old, new, index, new_pos, predicted):
+    """
+    First position at or after new_pos where the new image matches the old
+    one, trying the position that continues the last match first.
+    """
+    for pos in range(new_pos, len(new) - KEY_LENGTH + 1):
+        key = new[pos : pos + KEY_LENGTH]
+        guess = predicted + (pos - new_pos)
+        if 0 <= guess <= len(old) - KEY_LENGTH and old[guess : guess + KEY_LENGTH] == key:
+            return pos, guess
+        if key in index:
+            return pos, index[key]
+    return len(new), None
+
+
+def encode_diff(old, new, old_pos, new_pos, length) -> bytes:
+    """
+    Encode length difference bytes as (zero count, literal count, literals).
+    """
+    diff = bytes((new[new_pos + i] - old[old_pos + i]) & 0xFF for i in range(length))
+    out = bytearray()
+    pos = 0
+    while pos < length:
+        zeros = 0
+        while pos + zeros < length and diff[pos + zeros] == 0:
+            zeros += 1
+        start = pos + zeros
+        end = start
+        while end < length:
+            if diff[end] != 0:
+                end += 1
+                continue
+            run = 0
+            while end + run < length and diff[end + run] == 0 and run < MIN_ZERO_RUN:
+                run += 1
+            if run >= MIN_ZERO_RUN or end + run == length:
+                break
+            end += run
+        out += varint(zeros) + varint(end - start) + diff[start:end]
+        pos = end
+    return bytes(out)
+
+
+def make_patch(old, new) -> bytes:
+    """
+    Make a patch that turns old into new, in the format ota_delta.h describes.
+    """
+    index = index_old(old)
+    out = bytearray(struct.pack("<III", MAGIC, len(old), len(new)) + hashlib.sha1(old).digest())
+
+    # The first record has no difference run: only bytes before the first match.
+    new_pos = 0
+    old_pos = 0
+    diff_length = 0
+    while True:
+        anchor_new, anchor_old = find_anchor(old, new, index, new_pos + diff_length, old_pos + diff_length)
+        extra = new[new_pos + diff_length : anchor_new]
+        next_old = anchor_old if anchor_old is not None else old_pos + diff_length
+        out += varint(diff_length) + varint(len(extra)) + varint(zigzag(next_old - (old_pos + diff_length)))
+        out += encode_diff(old, new, old_pos, new_pos, diff_length) + extra
+        if anchor_old is None:
+            return bytes(out)
+        new_pos = anchor_new
+        old_pos = anchor_old
+        diff_length = extend(old, new, old_pos, new_pos)
+
+
+def main():
+    """
+    Write the patch that turns the running image into the new one.
+    """
+    parser = argparse.ArgumentParser(description="OTA delta image generator. See README.md")
+    parser.add_argument("--old", action="store", required=True, dest="old", help="Image running on the devices.")
+    parser.add_argument("--new", action="store", required=True, dest="new", help="Image to update them to.")
+    parser.add_argument("--out", action="store", required=True, dest="out", help="Patch to upload as the OTA file.")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    patch = make_patch(old, new)
+
+    with open(args.out, "wb") as f:
+        f.write(patch)
+
+    print("{} bytes, {:.1%} of the new image.".format(len(patch), len(patch) / max(len(new), 1)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,1114 @@
+/*
+ * ota_http.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file ota_http.c
+ *
+ * @brief OTA file download over pipelined HTTP range requests.
+ *
+ * coreHTTP sends a request and waits for its whole response before it
+ * returns, so it cannot keep a second request in flight; this is a minimal
+ * HTTP/1.1 client on the transport interface that can. Requests go out
+ * ahead of their responses up to the window given, and every response
+ * received makes room for the next request.
+ *
+ * Response headers are read into the header buffer. Whatever the server
+ * sent after them in the same segment stays there and is the first thing
+ * read for the body; the rest of the body is received straight into the
+ * block buffer, which is what the sink is handed.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* OTA HTTP configuration. */
+#include "ota_http_config.h"
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Transport over secure sockets, for the benchmark connection. */
+#include "transport_secure_sockets.h"
+
+/* OTA PAL, for writing blocks to the file. */
+#include "aws_iot_ota_pal.h"
+
+/* Shared buffers. */
+#include "buffer_pool.h"
+
+#include "ota_http.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Size of an OTA file block.
+ */
+#define otahttpBLOCK_SIZE         ( 1UL << otaconfigLOG2_FILE_BLOCK_SIZE )
+
+/**
+ * @brief Most bytes asked for in one range request.
+ */
+#define otahttpRANGE_BYTES        ( otahttpconfigRANGE_BLOCKS * otahttpBLOCK_SIZE )
+
+/**
+ * @brief Ranges taken from the bitmap per call of OtaHttp_FetchRanges().
+ */
+#define otahttpRANGES_PER_PASS    ( 8U )
+
+/**
+ * @brief Request line and headers before the path, between the path and the
+ * host, and after the host, up to the start of the range.
+ */
+#define otahttpREQUEST_METHOD     "GET "
+#define otahttpREQUEST_VERSION    " HTTP/1.1\r\nHost: "
+#define otahttpREQUEST_HEADERS    "\r\nConnection: keep-alive\r\nRange: bytes="
+
+/**
+ * @brief Longest end of a request: "<first>-<last>\r\n\r\n".
+ */
+#define otahttpREQUEST_TAIL_LENGTH    ( 26U )
+
+/**
+ * @brief End of the response headers.
+ */
+#define otahttpHEADERS_END        "\r\n\r\n"
+
+/**
+ * @brief Scheme an offered file's URL must have; the fetch is over TLS.
+ */
+#define otahttpURL_SCHEME         "https://"
+
+/**
+ * @brief Longest job name remembered, with its terminator; job IDs have up
+ * to 64 characters.
+ */
+#define otahttpJOB_NAME_LENGTH    ( 65U )
+
+#if ( otahttpconfigMAX_OUTSTANDING < 1U )
+    #error "otahttpconfigMAX_OUTSTANDING must be at least 1."
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief State of the connection while ranges are fetched.
+ */
+typedef struct OtaHttpConnection
+{
+    const TransportInterface_t * pxTransport;
+    uint8_t * pucHeaders;     /**< @brief Header buffer, also holding bytes read past the headers. */
+    size_t xStart;            /**< @brief First byte of pucHeaders not used yet. */
+    size_t xEnd;              /**< @brief End of the bytes received into pucHeaders. */
+    char * pcRequest;         /**< @brief Request up to the range, with room for the range. */
+    size_t xRequestPrefix;    /**< @brief Length of the request up to the range. */
+    TickType_t xLastProgress; /**< @brief Time the last byte was sent or received. */
+    bool xServerClosing;      /**< @brief The server closes the connection after this response. */
+} OtaHttpConnection_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The file offered by the PAL, and the job it was offered for, which
+ * is not offered again.
+ */
+static OTA_FileContext_t * pxOfferedFile = NULL;
+static char cOfferedJob[ otahttpJOB_NAME_LENGTH ];
+
+/**
+ * @brief Told when a file is offered.
+ */
+static OtaHttpOfferCallback_t xOfferCallback = NULL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Whether the connection has been idle for longer than the timeout.
+ */
+static bool prvTimedOut( const OtaHttpConnection_t * pxConnection );
+
+/**
+ * @brief Send a buffer in full.
+ */
+static OtaHttpStatus_t prvSendAll( OtaHttpConnection_t * pxConnection,
+                                   const uint8_t * pucData,
+                                   size_t xLength );
+
+/**
+ * @brief Receive at least one byte into a buffer.
+ *
+ * @return Number of bytes received, or 0 on a failure or timeout.
+ */
+static size_t prvRecvSome( OtaHttpConnection_t * pxConnection,
+                           uint8_t * pucBuffer,
+                           size_t xLength );
+
+/**
+ * @brief Receive exactly @p xLength bytes of a body, taking the bytes read
+ * past the headers first.
+ */
+static OtaHttpStatus_t prvRecvBody( OtaHttpConnection_t * pxConnection,
+                                    uint8_t * pucBuffer,
+                                    size_t xLength );
+
+/**
+ * @brief Receive the headers of a response into the header buffer.
+ *
+ * @param[out] pxLength Length of the headers, including the blank line.
+ */
+static OtaHttpStatus_t prvRecvHeaders( OtaHttpConnection_t * pxConnection,
+                                       size_t * pxLength );
+
+/**
+ * @brief Find a header in a block of headers.
+ *
+ * @param[out] pxValueLength Length of the value.
+ *
+ * @return The value, or NULL if the header is absent.
+ */
+static const char * prvFindHeader( const char * pcHeaders,
+                                   size_t xLength,
+                                   const char * pcName,
+                                   size_t * pxValueLength );
+
+/**
+ * @brief Parse a decimal number at the start of a string.
+ *
+ * @return Number of characters parsed; 0 if there was no number.
+ */
+static size_t prvParseNumber( const char * pcText,
+                              size_t xLength,
+                              uint32_t * pulValue );
+
+/**
+ * @brief Compare two strings, ignoring case.
+ */
+static bool prvMatchNoCase( const char * pcText,
+                            const char * pcPattern,
+                            size_t xLength );
+
+/**
+ * @brief Send the request for a range.
+ */
+static OtaHttpStatus_t prvSendRequest( OtaHttpConnection_t * pxConnection,
+                                       const OtaHttpRange_t * pxRange );
+
+/**
+ * @brief Receive the response to the oldest request and hand its blocks to
+ * the sink.
+ */
+static OtaHttpStatus_t prvRecvResponse( OtaHttpConnection_t * pxConnection,
+                                        const OtaHttpRange_t * pxRange,
+                                        uint8_t * pucBlock,
+                                        OtaHttpSink_t xSink,
+                                        void * pvSinkContext );
+
+/**
+ * @brief Sink that writes to the OTA file and marks the block as received.
+ */
+static int16_t prvWriteToFile( void * pvContext,
+                               uint32_t ulOffset,
+                               uint8_t * pucData,
+                               uint32_t ulSize );
+
+/*-----------------------------------------------------------*/
+
+static bool prvTimedOut( const OtaHttpConnection_t * pxConnection )
+{
+    return ( xTaskGetTickCount() - pxConnection->xLastProgress ) >
+           pdMS_TO_TICKS( otahttpconfigRECV_TIMEOUT_MS );
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaHttpStatus_t prvSendAll( OtaHttpConnection_t * pxConnection,
+                                   const uint8_t * pucData,
+                                   size_t xLength )
+{
+    const TransportInterface_t * pxTransport = pxConnection->pxTransport;
+    OtaHttpStatus_t xStatus = eOtaHttpSuccess;
+    size_t xSent = 0U;
+    int32_t lBytes = 0;
+
+    pxConnection->xLastProgress = xTaskGetTickCount();
+
+    while( ( xStatus == eOtaHttpSuccess ) && ( xSent < xLength ) )
+    {
+        lBytes = pxTransport->send( pxTransport->pNetworkContext, &pucData[ xSent ], xLength - xSent );
+
+        if( lBytes > 0 )
+        {
+            xSent += ( size_t ) lBytes;
+            pxConnection->xLastProgress = xTaskGetTickCount();
+        }
+        else if( ( lBytes < 0 ) || prvTimedOut( pxConnection ) )
+        {
+            LogError( ( "Sending a request failed: %ld.", ( long ) lBytes ) );
+            xStatus = eOtaHttpNetworkError;
+        }
+        else
+        {
+            /* Send buffer full; try again. */
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvRecvSome( OtaHttpConnection_t * pxConnection,
+                           uint8_t * pucBuffer,
+                           size_t xLength )
+{
+    const TransportInterface_t * pxTransport = pxConnection->pxTransport;
+    size_t xReceived = 0U;
+    int32_t lBytes = 0;
+
+    /* The transport returns 0 when its own receive timeout expires, which is
+     * shorter than ours, so keep asking until our timeout expires. */
+    while( xReceived == 0U )
+    {
+        lBytes = pxTransport->recv( pxTransport->pNetworkContext, pucBuffer, xLength );
+
+        if( lBytes > 0 )
+        {
+            xReceived = ( size_t ) lBytes;
+            pxConnection->xLastProgress = xTaskGetTickCount();
+        }
+        else if( lBytes < 0 )
+        {
+            LogError( ( "Receiving a response failed: %ld.", ( long ) lBytes ) );
+            break;
+        }
+        else if( prvTimedOut( pxConnection ) )
+        {
+            LogError( ( "No data from the server for %u ms.", otahttpconfigRECV_TIMEOUT_MS ) );
+            break;
+        }
+        else
+        {
+            /* Nothing yet; try again. */
+        }
+    }
+
+    return xReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaHttpStatus_t prvRecvBody( OtaHttpConnection_t * pxConnection,
+                                    uint8_t * pucBuffer,
+                                    size_t xLength )
+{
+    OtaHttpStatus_t xStatus = eOtaHttpSuccess;
+    size_t xFilled = pxConnection->xEnd - pxConnection->xStart;
+    size_t xBytes = 0U;
+
+    if( xFilled > xLength )
+    {
+        xFilled = xLength;
+    }
+
+    if( xFilled > 0U )
+    {
+        ( void ) memcpy( pucBuffer, &pxConnection->pucHeaders[ pxConnection->xStart ], xFilled );
+        pxConnection->xStart += xFilled;
+    }
+
+    while( ( xStatus == eOtaHttpSuccess ) && ( xFilled < xLength ) )
+    {
+        xBytes = prvRecvSome( pxConnection, &pucBuffer[ xFilled ], xLength - xFilled );
+
+        if( xBytes == 0U )
+        {
+            xStatus = eOtaHttpNetworkError;
+        }
+
+        xFilled += xBytes;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaHttpStatus_t prvRecvHeaders( OtaHttpConnection_t * pxConnection,
+                                       size_t * pxLength )
+{
+    OtaHttpStatus_t xStatus = eOtaHttpSuccess;
+    size_t xSearched = 0U;
+    size_t xBytes = 0U;
+    bool xFound = false;
+
+    /* Move what is left of the last response's segment to the front. */
+    pxConnection->xEnd -= pxConnection->xStart;
+    ( void ) memmove( pxConnection->pucHeaders,
+                      &pxConnection->pucHeaders[ pxConnection->xStart ],
+                      pxConnection->xEnd );
+    pxConnection->xStart = 0U;
+
+    while( ( xStatus == eOtaHttpSuccess ) && ( xFound == false ) )
+    {
+        while( ( xFound == false ) && ( ( xSearched + sizeof( otahttpHEADERS_END ) - 1U ) <= pxConnection->xEnd ) )
+        {
+            if( memcmp( &pxConnection->pucHeaders[ xSearched ], otahttpHEADERS_END, sizeof( otahttpHEADERS_END ) - 1U ) == 0 )
+            {
+                xFound = true;
+            }
+            else
+            {
+                xSearched++;
+            }
+        }
+
+        if( xFound == true )
+        {
+            *pxLength = xSearched + sizeof( otahttpHEADERS_END ) - 1U;
+        }
+        else if( pxConnection->xEnd == otahttpconfigHEADER_BUFFER_LENGTH )
+        {
+            LogError( ( "Response headers longer than %u bytes.", otahttpconfigHEADER_BUFFER_LENGTH ) );
+            xStatus = eOtaHttpBadResponse;
+        }
+        else
+        {
+            xBytes = prvRecvSome( pxConnection,
+                                  &pxConnection->pucHeaders[ pxConnection->xEnd ],
+                                  otahttpconfigHEADER_BUFFER_LENGTH - pxConnection->xEnd );
+
+            if( xBytes == 0U )
+            {
+                xStatus = eOtaHttpNetworkError;
+            }
+
+            pxConnection->xEnd += xBytes;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvMatchNoCase( const char * pcText,
+                            const char * pcPattern,
+                            size_t xLength )
+{
+    bool xMatch = true;
+    size_t i = 0U;
+    char cText = '\0';
+    char cPattern = '\0';
+
+    for( i = 0U; ( xMatch == true ) && ( i < xLength ); i++ )
+    {
+        cText = pcText[ i ];
+        cPattern = pcPattern[ i ];
+
+        if( ( cText >= 'A' ) && ( cText <= 'Z' ) )
+        {
+            cText = ( char ) ( cText - 'A' + 'a' );
+        }
+
+        if( ( cPattern >= 'A' ) && ( cPattern <= 'Z' ) )
+        {
+            cPattern = ( char ) ( cPattern - 'A' + 'a' );
+        }
+
+        xMatch = ( cText == cPattern );
+    }
+
+    return xMatch;
+}
+
+/*-----------------------------------------------------------*/
+
+static const char * prvFindHeader( const char * pcHeaders,
+                                   size_t xLength,
+                                   const char * pcName,
+                                   size_t * pxValueLength )
+{
+    const char * pcValue = NULL;
+    size_t xNameLength = strlen( pcName );
+    size_t xLine = 0U;
+    size_t xEnd = 0U;
+    size_t xValue = 0U;
+
+    /* Skip the status line. */
+    while( ( xLine < xLength ) && ( pcHeaders[ xLine ] != '\n' ) )
+    {
+        xLine++;
+    }
+
+    xLine++;
+
+    while( ( pcValue == NULL ) && ( xLine < xLength ) )
+    {
+        xEnd = xLine;
+
+        while( ( xEnd < xLength ) && ( pcHeaders[ xEnd ] != '\r' ) && ( pcHeaders[ xEnd ] != '\n' ) )
+        {
+            xEnd++;
+        }
+
+        if( ( ( xEnd - xLine ) > xNameLength ) &&
+            ( pcHeaders[ xLine + xNameLength ] == ':' ) &&
+            prvMatchNoCase( &pcHeaders[ xLine ], pcName, xNameLength ) )
+        {
+            xValue = xLine + xNameLength + 1U;
+
+            while( ( xValue < xEnd ) && ( pcHeaders[ xValue ] == ' ' ) )
+            {
+                xValue++;
+            }
+
+            pcValue = &pcHeaders[ xValue ];
+            *pxValueLength = xEnd - xValue;
+        }
+
+        /* Skip the line end. */
+        xLine = xEnd + 2U;
+    }
+
+    return pcValue;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvParseNumber( const char * pcText,
+                              size_t xLength,
+                              uint32_t * pulValue )
+{
+    size_t xDigits = 0U;
+    uint32_t ulValue = 0UL;
+
+    while( ( xDigits < xLength ) && ( xDigits < 10U ) &&
+           ( pcText[ xDigits ] >= '0' ) && ( pcText[ xDigits ] <= '9' ) )
+    {
+        ulValue = ( ulValue * 10UL ) + ( uint32_t ) ( pcText[ xDigits ] - '0' );
+        xDigits++;
+    }
+
+    *pulValue = ulValue;
+
+    return xDigits;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaHttpStatus_t prvSendRequest( OtaHttpConnection_t * pxConnection,
+                                       const OtaHttpRange_t * pxRange )
+{
+    int lTail = 0;
+
+    /* Only the range differs between requests; it is written over the end of
+     * the last one. */
+    lTail = snprintf( &pxConnection->pcRequest[ pxConnection->xRequestPrefix ],
+                      otahttpREQUEST_TAIL_LENGTH,
+                      "%lu-%lu\r\n\r\n",
+                      ( unsigned long ) pxRange->ulOffset,
+                      ( unsigned long ) ( pxRange->ulOffset + pxRange->ulLength - 1UL ) );
+
+    configASSERT( ( lTail > 0 ) && ( lTail < ( int ) otahttpREQUEST_TAIL_LENGTH ) );
+
+    LogDebug( ( "Requesting %lu bytes at %lu.",
+                ( unsigned long ) pxRange->ulLength,
+                ( unsigned long ) pxRange->ulOffset ) );
+
+    return prvSendAll( pxConnection,
+                       ( const uint8_t * ) pxConnection->pcRequest,
+                       pxConnection->xRequestPrefix + ( size_t ) lTail );
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaHttpStatus_t prvRecvResponse( OtaHttpConnection_t * pxConnection,
+                                        const OtaHttpRange_t * pxRange,
+                                        uint8_t * pucBlock,
+                                        OtaHttpSink_t xSink,
+                                        void * pvSinkContext )
+{
+    OtaHttpStatus_t xStatus = eOtaHttpSuccess;
+    const char * pcHeaders = ( const char * ) pxConnection->pucHeaders;
+    const char * pcValue = NULL;
+    size_t xHeaderLength = 0U;
+    size_t xValueLength = 0U;
+    size_t xParsed = 0U;
+    uint32_t ulStatusCode = 0UL;
+    uint32_t ulContentLength = 0UL;
+    uint32_t ulFirst = 0UL;
+    uint32_t ulLast = 0UL;
+    uint32_t ulDone = 0UL;
+    uint32_t ulSize = 0UL;
+
+    xStatus = prvRecvHeaders( pxConnection, &xHeaderLength );
+
+    if( xStatus == eOtaHttpSuccess )
+    {
+        /* "HTTP/1.1 206 Partial Content". */
+        if( ( xHeaderLength > 12U ) && ( memcmp( pcHeaders, "HTTP/1.", 7U ) == 0 ) )
+        {
+            ( void ) prvParseNumber( &pcHeaders[ 9 ], 3U, &ulStatusCode );
+        }
+
+        if( ulStatusCode != 206UL )
+        {
+            LogError( ( "Range request answered with status %lu.", ( unsigned long ) ulStatusCode ) );
+            xStatus = eOtaHttpBadResponse;
+        }
+    }
+
+    if( xStatus == eOtaHttpSuccess )
+    {
+        pcValue = prvFindHeader( pcHeaders, xHeaderLength, "Content-Length", &xValueLength );
+
+        if( ( pcValue == NULL ) || ( prvParseNumber( pcValue, xValueLength, &ulContentLength ) == 0U ) )
+        {
+            ulContentLength = 0UL;
+        }
+
+        /* "bytes <first>-<last>/<size>". */
+        pcValue = prvFindHeader( pcHeaders, xHeaderLength, "Content-Range", &xValueLength );
+
+        if( ( pcValue != NULL ) && ( xValueLength > 6U ) && prvMatchNoCase( pcValue, "bytes ", 6U ) )
+        {
+            xParsed = 6U + prvParseNumber( &pcValue[ 6 ], xValueLength - 6U, &ulFirst );
+
+            if( ( xParsed < xValueLength ) && ( pcValue[ xParsed ] == '-' ) )
+            {
+                ( void ) prvParseNumber( &pcValue[ xParsed + 1U ], xValueLength - xParsed - 1U, &ulLast );
+            }
+        }
+
+        if( ( ulContentLength != pxRange->ulLength ) ||
+            ( ulFirst != pxRange->ulOffset ) ||
+            ( ulLast != ( pxRange->ulOffset + pxRange->ulLength - 1UL ) ) )
+        {
+            LogError( ( "Asked for %lu bytes at %lu, got %lu bytes of %lu-%lu.",
+                        ( unsigned long ) pxRange->ulLength,
+                        ( unsigned long ) pxRange->ulOffset,
+                        ( unsigned long ) ulContentLength,
+                        ( unsigned long ) ulFirst,
+                        ( unsigned long ) ulLast ) );
+            xStatus = eOtaHttpBadResponse;
+        }
+    }
+
+    if( xStatus == eOtaHttpSuccess )
+    {
+        pcValue = prvFindHeader( pcHeaders, xHeaderLength, "Connection", &xValueLength );
+        pxConnection->xServerClosing = ( pcValue != NULL ) &&
+                                       ( xValueLength >= 5U ) &&
+                                       prvMatchNoCase( pcValue, "close", 5U );
+
+        pxConnection->xStart = xHeaderLength;
+    }
+
+    while( ( xStatus == eOtaHttpSuccess ) && ( ulDone < pxRange->ulLength ) )
+    {
+        ulSize = pxRange->ulLength - ulDone;
+
+        if( ulSize > otahttpBLOCK_SIZE )
+        {
+            ulSize = otahttpBLOCK_SIZE;
+        }
+
+        xStatus = prvRecvBody( pxConnection, pucBlock, ulSize );
+
+        if( ( xStatus == eOtaHttpSuccess ) &&
+            ( xSink( pvSinkContext, pxRange->ulOffset + ulDone, pucBlock, ulSize ) != ( int16_t ) ulSize ) )
+        {
+            LogError( ( "The block at %lu was not taken.", ( unsigned long ) ( pxRange->ulOffset + ulDone ) ) );
+            xStatus = eOtaHttpSinkFailed;
+        }
+
+        ulDone += ulSize;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static int16_t prvWriteToFile( void * pvContext,
+                               uint32_t ulOffset,
+                               uint8_t * pucData,
+                               uint32_t ulSize )
+{
+    OTA_FileContext_t * C = ( OTA_FileContext_t * ) pvContext;
+    uint32_t ulBlock = ulOffset >> otaconfigLOG2_FILE_BLOCK_SIZE;
+    uint8_t ucMask = ( uint8_t ) ( 1U << ( ulBlock % 8UL ) );
+    int16_t sResult = ( int16_t ) ulSize;
+
+    /* A block already written, e.g. by the agent, is not written twice. */
+    if( ( C->pucRxBlockBitmap[ ulBlock / 8UL ] & ucMask ) != 0U )
+    {
+        sResult = prvPAL_WriteBlock( C, ulOffset, pucData, ulSize );
+
+        if( sResult == ( int16_t ) ulSize )
+        {
+            C->pucRxBlockBitmap[ ulBlock / 8UL ] &= ( uint8_t ) ~ucMask;
+
+            if( C->ulBlocksRemaining > 0UL )
+            {
+                C->ulBlocksRemaining--;
+            }
+        }
+    }
+
+    return sResult;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t OtaHttp_RangesFromBitmap( const OTA_FileContext_t * C,
+                                 OtaHttpRange_t * pxRanges,
+                                 size_t xMaxRanges )
+{
+    size_t xCount = 0U;
+    uint32_t ulBlocks = 0UL;
+    uint32_t ulBlock = 0UL;
+    uint32_t ulOffset = 0UL;
+    uint32_t ulSize = 0UL;
+    OtaHttpRange_t * pxLast = NULL;
+
+    if( ( C != NULL ) && ( C->pucRxBlockBitmap != NULL ) && ( pxRanges != NULL ) )
+    {
+        ulBlocks = ( C->ulFileSize + otahttpBLOCK_SIZE - 1UL ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+
+        for( ulBlock = 0UL; ulBlock < ulBlocks; ulBlock++ )
+        {
+            if( ( C->pucRxBlockBitmap[ ulBlock / 8UL ] & ( 1U << ( ulBlock % 8UL ) ) ) == 0U )
+            {
+                continue;
+            }
+
+            ulOffset = ulBlock << otaconfigLOG2_FILE_BLOCK_SIZE;
+            ulSize = C->ulFileSize - ulOffset;
+
+            if( ulSize > otahttpBLOCK_SIZE )
+            {
+                ulSize = otahttpBLOCK_SIZE;
+            }
+
+            if( ( pxLast != NULL ) &&
+                ( ( pxLast->ulOffset + pxLast->ulLength ) == ulOffset ) &&
+                ( pxLast->ulLength < otahttpRANGE_BYTES ) )
+            {
+                pxLast->ulLength += ulSize;
+            }
+            else if( xCount < xMaxRanges )
+            {
+                pxLast = &pxRanges[ xCount ];
+                pxLast->ulOffset = ulOffset;
+                pxLast->ulLength = ulSize;
+                xCount++;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    return xCount;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaHttpStatus_t OtaHttp_FetchRanges( const TransportInterface_t * pxTransport,
+                                     const char * pcHost,
+                                     const char * pcPath,
+                                     const OtaHttpRange_t * pxRanges,
+                                     size_t xRangeCount,
+                                     size_t xMaxOutstanding,
+                                     OtaHttpSink_t xSink,
+                                     void * pvSinkContext,
+                                     size_t * pxRangesDone )
+{
+    OtaHttpStatus_t xStatus = eOtaHttpSuccess;
+    OtaHttpConnection_t xConnection = { 0 };
+    uint8_t * pucBlock = NULL;
+    size_t xRequestSize = 0U;
+    size_t xSent = 0U;
+    size_t xDone = 0U;
+    size_t i = 0U;
+
+    if( ( pxTransport == NULL ) || ( pcHost == NULL ) || ( pcPath == NULL ) ||
+        ( pxRanges == NULL ) || ( xMaxOutstanding == 0U ) || ( xSink == NULL ) )
+    {
+        xStatus = eOtaHttpBadParameter;
+    }
+
+    for( i = 0U; ( xStatus == eOtaHttpSuccess ) && ( i < xRangeCount ); i++ )
+    {
+        if( ( pxRanges[ i ].ulLength == 0UL ) || ( ( pxRanges[ i ].ulOffset % otahttpBLOCK_SIZE ) != 0UL ) )
+        {
+            LogError( ( "Range %u does not start on a block.", ( unsigned ) i ) );
+            xStatus = eOtaHttpBadParameter;
+        }
+    }
+
+    if( xStatus == eOtaHttpSuccess )
+    {
+        xRequestSize = sizeof( otahttpREQUEST_METHOD ) + strlen( pcPath ) +
+                       sizeof( otahttpREQUEST_VERSION ) + strlen( pcHost ) +
+                       sizeof( otahttpREQUEST_HEADERS ) + otahttpREQUEST_TAIL_LENGTH;
+
+        xConnection.pxTransport = pxTransport;
+        xConnection.pucHeaders = BufferPool_Acquire( otahttpconfigHEADER_BUFFER_LENGTH );
+        xConnection.pcRequest = BufferPool_Acquire( xRequestSize );
+        pucBlock = BufferPool_Acquire( otahttpBLOCK_SIZE );
+
+        if( ( xConnection.pucHeaders == NULL ) || ( xConnection.pcRequest == NULL ) || ( pucBlock == NULL ) )
+        {
+            LogError( ( "No buffers for the HTTP data path." ) );
+            xStatus = eOtaHttpNoMemory;
+        }
+    }
+
+    if( xStatus == eOtaHttpSuccess )
+    {
+        xConnection.xRequestPrefix = ( size_t ) snprintf( xConnection.pcRequest,
+                                                          xRequestSize,
+                                                          otahttpREQUEST_METHOD "%s" otahttpREQUEST_VERSION "%s" otahttpREQUEST_HEADERS,
+                                                          pcPath,
+                                                          pcHost );
+    }
+
+    while( ( xStatus == eOtaHttpSuccess ) && ( xDone < xRangeCount ) )
+    {
+        /* Keep the window full, unless the server said it is closing. */
+        while( ( xStatus == eOtaHttpSuccess ) &&
+               ( xSent < xRangeCount ) &&
+               ( ( xSent - xDone ) < xMaxOutstanding ) &&
+               ( xConnection.xServerClosing == false ) )
+        {
+            xStatus = prvSendRequest( &xConnection, &pxRanges[ xSent ] );
+            xSent++;
+        }
+
+        if( xStatus == eOtaHttpSuccess )
+        {
+            xStatus = prvRecvResponse( &xConnection, &pxRanges[ xDone ], pucBlock, xSink, pvSinkContext );
+        }
+
+        if( xStatus == eOtaHttpSuccess )
+        {
+            xDone++;
+
+            if( ( xConnection.xServerClosing == true ) && ( xDone < xRangeCount ) )
+            {
+                LogWarn( ( "Server closed the connection after %u of %u ranges.",
+                           ( unsigned ) xDone, ( unsigned ) xRangeCount ) );
+                xStatus = eOtaHttpNetworkError;
+            }
+        }
+    }
+
+    BufferPool_Release( pucBlock );
+    BufferPool_Release( xConnection.pcRequest );
+    BufferPool_Release( xConnection.pucHeaders );
+
+    if( pxRangesDone != NULL )
+    {
+        *pxRangesDone = xDone;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaHttpStatus_t OtaHttp_FetchFile( const TransportInterface_t * pxTransport,
+                                   const char * pcHost,
+                                   const char * pcPath,
+                                   OTA_FileContext_t * C,
+                                   bool xLeaveLastBlock )
+{
+    OtaHttpStatus_t xStatus = eOtaHttpSuccess;
+    OtaHttpRange_t xRanges[ otahttpRANGES_PER_PASS ];
+    OtaHttpRange_t * pxLast = NULL;
+    uint32_t ulLastBlock = 0UL;
+    size_t xCount = 0U;
+
+    if( ( C == NULL ) || ( C->pucRxBlockBitmap == NULL ) )
+    {
+        xStatus = eOtaHttpBadParameter;
+    }
+    else if( xLeaveLastBlock == true )
+    {
+        /* The block left is the last one missing now; the ranges come in
+         * order, so only the last range of a pass can end with it. */
+        ulLastBlock = ( C->ulFileSize + otahttpBLOCK_SIZE - 1UL ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+
+        while( ( ulLastBlock > 0UL ) &&
+               ( ( C->pucRxBlockBitmap[ ( ulLastBlock - 1UL ) / 8UL ] & ( 1U << ( ( ulLastBlock - 1UL ) % 8UL ) ) ) == 0U ) )
+        {
+            ulLastBlock--;
+        }
+
+        xLeaveLastBlock = ( ulLastBlock > 0UL );
+        ulLastBlock = ( ulLastBlock > 0UL ) ? ( ulLastBlock - 1UL ) : 0UL;
+    }
+
+    while( xStatus == eOtaHttpSuccess )
+    {
+        xCount = OtaHttp_RangesFromBitmap( C, xRanges, otahttpRANGES_PER_PASS );
+
+        if( ( xLeaveLastBlock == true ) && ( xCount > 0U ) )
+        {
+            pxLast = &xRanges[ xCount - 1U ];
+
+            if( ( ( pxLast->ulOffset + pxLast->ulLength - 1UL ) >> otaconfigLOG2_FILE_BLOCK_SIZE ) == ulLastBlock )
+            {
+                pxLast->ulLength = ( ulLastBlock << otaconfigLOG2_FILE_BLOCK_SIZE ) - pxLast->ulOffset;
+
+                if( pxLast->ulLength == 0UL )
+                {
+                    xCount--;
+                }
+            }
+        }
+
+        if( xCount == 0U )
+        {
+            break;
+        }
+
+        xStatus = OtaHttp_FetchRanges( pxTransport,
+                                       pcHost,
+                                       pcPath,
+                                       xRanges,
+                                       xCount,
+                                       otahttpconfigMAX_OUTSTANDING,
+                                       prvWriteToFile,
+                                       C,
+                                       NULL );
+    }
+
+    LogInfo( ( "HTTP download finished with %lu blocks missing, status %d.",
+               ( unsigned long ) ( ( C != NULL ) ? C->ulBlocksRemaining : 0UL ), ( int ) xStatus ) );
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+bool OtaHttp_ParseUrl( const char * pcUrl,
+                       const char ** ppcHost,
+                       size_t * pxHostLength,
+                       const char ** ppcPath )
+{
+    const size_t xSchemeLength = sizeof( otahttpURL_SCHEME ) - 1U;
+    const char * pcPath = NULL;
+    bool xParsed = false;
+
+    if( ( pcUrl != NULL ) && ( ppcHost != NULL ) && ( pxHostLength != NULL ) && ( ppcPath != NULL ) &&
+        ( strlen( pcUrl ) > xSchemeLength ) && ( prvMatchNoCase( pcUrl, otahttpURL_SCHEME, xSchemeLength ) == true ) )
+    {
+        pcPath = strchr( &pcUrl[ xSchemeLength ], '/' );
+
+        if( ( pcPath != NULL ) && ( pcPath > &pcUrl[ xSchemeLength ] ) )
+        {
+            *ppcHost = &pcUrl[ xSchemeLength ];
+            *pxHostLength = ( size_t ) ( pcPath - *ppcHost );
+            *ppcPath = pcPath;
+            xParsed = true;
+        }
+    }
+
+    return xParsed;
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaHttp_SetOfferCallback( OtaHttpOfferCallback_t xCallback )
+{
+    xOfferCallback = xCallback;
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaHttp_OfferFile( OTA_FileContext_t * C )
+{
+    const char * pcHost = NULL;
+    const char * pcPath = NULL;
+    size_t xHostLength = 0U;
+    bool xOffered = false;
+
+    if( ( C != NULL ) && ( C->pucJobName != NULL ) && ( C->ulBlocksRemaining > 1UL ) &&
+        ( OtaHttp_ParseUrl( ( const char * ) C->pucUpdateUrlPath, &pcHost, &xHostLength, &pcPath ) == true ) &&
+        ( strncmp( cOfferedJob, ( const char * ) C->pucJobName, sizeof( cOfferedJob ) ) != 0 ) )
+    {
+        taskENTER_CRITICAL();
+        pxOfferedFile = C;
+        taskEXIT_CRITICAL();
+
+        ( void ) strncpy( cOfferedJob, ( const char * ) C->pucJobName, sizeof( cOfferedJob ) - 1U );
+        xOffered = true;
+        LogInfo( ( "File of job %s offered for a fetch from %.*s.",
+                   cOfferedJob, ( int ) xHostLength, pcHost ) );
+    }
+
+    if( ( xOffered == true ) && ( xOfferCallback != NULL ) )
+    {
+        xOfferCallback();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaHttp_WithdrawFile( void )
+{
+    taskENTER_CRITICAL();
+    pxOfferedFile = NULL;
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+OTA_FileContext_t * OtaHttp_GetOfferedFile( void )
+{
+    OTA_FileContext_t * C = NULL;
+
+    taskENTER_CRITICAL();
+    C = pxOfferedFile;
+    taskEXIT_CRITICAL();
+
+    return C;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( otahttpconfigBENCHMARK_FILE_SIZE > 0U )
+
+/**
+ * @brief Ranges of the benchmark file.
+ */
+    #define otahttpBENCHMARK_RANGES    ( ( otahttpconfigBENCHMARK_FILE_SIZE + otahttpRANGE_BYTES - 1UL ) / otahttpRANGE_BYTES )
+
+/**
+ * @brief Each compilation unit that consumes the NetworkContext must define it.
+ */
+    struct NetworkContext
+    {
+        SecureSocketsTransportParams_t * pParams;
+    };
+
+/**
+ * @brief Sink that only counts the bytes.
+ */
+    static int16_t prvCountBytes( void * pvContext,
+                                  uint32_t ulOffset,
+                                  uint8_t * pucData,
+                                  uint32_t ulSize )
+    {
+        ( void ) ulOffset;
+        ( void ) pucData;
+
+        *( ( uint32_t * ) pvContext ) += ulSize;
+
+        return ( int16_t ) ulSize;
+    }
+
+/**
+ * @brief Download the benchmark file once on a fresh connection.
+ */
+    static void prvBenchmarkPass( const OtaHttpRange_t * pxRanges,
+                                  size_t xMaxOutstanding )
+    {
+        NetworkContext_t xNetworkContext = { 0 };
+        SecureSocketsTransportParams_t xParams = { 0 };
+        ServerInfo_t xServerInfo = { 0 };
+        SocketsConfig_t xSocketsConfig = { 0 };
+        TransportInterface_t xTransport = { 0 };
+        OtaHttpStatus_t xStatus = eOtaHttpSuccess;
+        TickType_t xStart = 0;
+        uint32_t ulBytes = 0UL;
+        uint32_t ulElapsedMs = 0UL;
+
+        xNetworkContext.pParams = &xParams;
+
+        xServerInfo.pHostName = otahttpconfigBENCHMARK_HOST;
+        xServerInfo.hostNameLength = strlen( otahttpconfigBENCHMARK_HOST );
+        xServerInfo.port = otahttpconfigBENCHMARK_PORT;
+
+        /* Plain TCP to the stand-in server. */
+        xSocketsConfig.enableTls = false;
+        xSocketsConfig.sendTimeoutMs = otahttpconfigRECV_TIMEOUT_MS;
+        xSocketsConfig.recvTimeoutMs = otahttpconfigRECV_TIMEOUT_MS;
+
+        if( SecureSocketsTransport_Connect( &xNetworkContext, &xServerInfo, &xSocketsConfig ) != TRANSPORT_SOCKET_STATUS_SUCCESS )
+        {
+            LogError( ( "Benchmark could not connect to %s:%u.", otahttpconfigBENCHMARK_HOST, otahttpconfigBENCHMARK_PORT ) );
+        }
+        else
+        {
+            xTransport.pNetworkContext = &xNetworkContext;
+            xTransport.send = SecureSocketsTransport_Send;
+            xTransport.recv = SecureSocketsTransport_Recv;
+
+            xStart = xTaskGetTickCount();
+            xStatus = OtaHttp_FetchRanges( &xTransport,
+                                           otahttpconfigBENCHMARK_HOST,
+                                           otahttpconfigBENCHMARK_PATH,
+                                           pxRanges,
+                                           otahttpBENCHMARK_RANGES,
+                                           xMaxOutstanding,
+                                           prvCountBytes,
+                                           &ulBytes,
+                                           NULL );
+            ulElapsedMs = ( uint32_t ) ( xTaskGetTickCount() - xStart ) * ( uint32_t ) portTICK_PERIOD_MS;
+
+            ( void ) SecureSocketsTransport_Disconnect( &xNetworkContext );
+
+            if( ulElapsedMs == 0UL )
+            {
+                ulElapsedMs = 1UL;
+            }
+
+            LogInfo( ( "%u outstanding: %lu bytes in %lu ms, %lu KB/s, status %d.",
+                       ( unsigned ) xMaxOutstanding,
+                       ( unsigned long ) ulBytes,
+                       ( unsigned long ) ulElapsedMs,
+                       ( unsigned long ) ( ( ( uint64_t ) ulBytes * 1000ULL ) / ( ( uint64_t ) ulElapsedMs * 1024ULL ) ),
+                       ( int ) xStatus ) );
+        }
+    }
+
+    void OtaHttp_RunBenchmark( void )
+    {
+        static OtaHttpRange_t xRanges[ otahttpBENCHMARK_RANGES ];
+        uint32_t ulOffset = 0UL;
+        size_t i = 0U;
+
+        for( i = 0U; i < otahttpBENCHMARK_RANGES; i++ )
+        {
+            ulOffset = ( uint32_t ) i * otahttpRANGE_BYTES;
+            xRanges[ i ].ulOffset = ulOffset;
+            xRanges[ i ].ulLength = otahttpconfigBENCHMARK_FILE_SIZE - ulOffset;
+
+            if( xRanges[ i ].ulLength > otahttpRANGE_BYTES )
+            {
+                xRanges[ i ].ulLength = otahttpRANGE_BYTES;
+            }
+        }
+
+        prvBenchmarkPass( xRanges, 1U );
+        prvBenchmarkPass( xRanges, otahttpconfigMAX_OUTSTANDING );
+    }
+
+#else /* if ( otahttpconfigBENCHMARK_FILE_SIZE > 0U ) */
+
+    void OtaHttp_RunBenchmark( void )
+    {
+    }
+
+#endif /* if ( otahttpconfigBENCHMARK_FILE_SIZE > 0U ) */
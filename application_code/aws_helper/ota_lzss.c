@@ -0,0 +1,422 @@
+/*
+ * ota_lzss.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file ota_lzss.c
+ *
+ * @brief Streaming decompression of compressed OTA images.
+ *
+ * The decoder takes the file a byte at a time and each byte a few bits at
+ * a time, into the field of the symbol being read: the tag, then a literal,
+ * or a distance and a length. Every byte produced goes both into the
+ * window, a ring of the last 2^window bits bytes that back-references copy
+ * from, and into the output buffer, which is written out whenever it is
+ * full. Lengths are checked against the size in the header before they are
+ * used, so a corrupt stream is rejected instead of writing past the image.
+ * OtaLzss_Decompress() reads the file through its callback and feeds it to
+ * a decoder.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "ota_lzss.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The fields of a symbol.
+ */
+#define otalzssFIELD_TAG          ( 0UL )
+#define otalzssFIELD_LITERAL      ( 1UL )
+#define otalzssFIELD_DISTANCE     ( 2UL )
+#define otalzssFIELD_LENGTH       ( 3UL )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take a byte of the header, and start the stream once it is whole.
+ */
+static void prvTakeHeaderByte( OtaLzssDecoder_t * pxDecoder,
+                               uint8_t ucByte );
+
+/**
+ * @brief Take the bits of a byte of the stream, most significant first.
+ */
+static void prvTakeStreamByte( OtaLzssDecoder_t * pxDecoder,
+                               uint8_t ucByte );
+
+/**
+ * @brief Act on a field just read and choose the next one.
+ */
+static void prvEndField( OtaLzssDecoder_t * pxDecoder );
+
+/**
+ * @brief Write out the output buffer.
+ */
+static void prvFlush( OtaLzssDecoder_t * pxDecoder );
+
+/**
+ * @brief Append a byte to the image and the window.
+ */
+static void prvPutByte( OtaLzssDecoder_t * pxDecoder,
+                        uint8_t ucByte );
+
+/*-----------------------------------------------------------*/
+
+static void prvTakeHeaderByte( OtaLzssDecoder_t * pxDecoder,
+                               uint8_t ucByte )
+{
+    pxDecoder->ucHeader[ pxDecoder->ulConsumed ] = ucByte;
+
+    if( ( pxDecoder->ulConsumed + 1UL ) == otalzssHEADER_SIZE )
+    {
+        pxDecoder->xStatus = OtaLzss_ParseHeader( pxDecoder->ucHeader, otalzssHEADER_SIZE, &pxDecoder->xHeader );
+
+        if( ( pxDecoder->xStatus == eOtaLzssSuccess ) &&
+            ( pxDecoder->xParams.ulWindowSize < ( 1UL << pxDecoder->xHeader.ucWindowBits ) ) )
+        {
+            pxDecoder->xStatus = eOtaLzssBadParameter;
+        }
+
+        if( pxDecoder->xStatus == eOtaLzssSuccess )
+        {
+            /* Back-references before the start read zeros, as in heatshrink. */
+            pxDecoder->ulWindowMask = ( 1UL << pxDecoder->xHeader.ucWindowBits ) - 1UL;
+            ( void ) memset( pxDecoder->xParams.pucWindow, 0, pxDecoder->ulWindowMask + 1UL );
+            pxDecoder->ulField = otalzssFIELD_TAG;
+            pxDecoder->ulBitsWanted = 1UL;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTakeStreamByte( OtaLzssDecoder_t * pxDecoder,
+                               uint8_t ucByte )
+{
+    uint32_t ulBitsLeft = 8UL;
+    uint32_t ulTake = 0UL;
+
+    while( ( ulBitsLeft > 0UL ) && ( pxDecoder->xStatus == eOtaLzssSuccess ) )
+    {
+        if( pxDecoder->ulProduced == pxDecoder->xHeader.ulImageSize )
+        {
+            /* Only the padding of the last byte may follow the last symbol. */
+            if( ( ( uint32_t ) ucByte & ( ( 1UL << ulBitsLeft ) - 1UL ) ) != 0UL )
+            {
+                pxDecoder->xStatus = eOtaLzssBadStream;
+            }
+
+            ulBitsLeft = 0UL;
+        }
+        else
+        {
+            ulTake = ( pxDecoder->ulBitsWanted < ulBitsLeft ) ? pxDecoder->ulBitsWanted : ulBitsLeft;
+            ulBitsLeft -= ulTake;
+            pxDecoder->ulValue = ( pxDecoder->ulValue << ulTake ) |
+                                 ( ( ( uint32_t ) ucByte >> ulBitsLeft ) & ( ( 1UL << ulTake ) - 1UL ) );
+            pxDecoder->ulBitsWanted -= ulTake;
+
+            if( pxDecoder->ulBitsWanted == 0UL )
+            {
+                prvEndField( pxDecoder );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvEndField( OtaLzssDecoder_t * pxDecoder )
+{
+    uint32_t ulValue = pxDecoder->ulValue;
+    uint32_t i = 0UL;
+
+    pxDecoder->ulValue = 0UL;
+
+    switch( pxDecoder->ulField )
+    {
+        case otalzssFIELD_TAG:
+
+            if( ulValue != 0UL )
+            {
+                pxDecoder->ulField = otalzssFIELD_LITERAL;
+                pxDecoder->ulBitsWanted = 8UL;
+            }
+            else
+            {
+                pxDecoder->ulField = otalzssFIELD_DISTANCE;
+                pxDecoder->ulBitsWanted = pxDecoder->xHeader.ucWindowBits;
+            }
+
+            break;
+
+        case otalzssFIELD_LITERAL:
+            prvPutByte( pxDecoder, ( uint8_t ) ulValue );
+            pxDecoder->ulProduced++;
+            pxDecoder->ulField = otalzssFIELD_TAG;
+            pxDecoder->ulBitsWanted = 1UL;
+            break;
+
+        case otalzssFIELD_DISTANCE:
+            pxDecoder->ulDistance = ulValue + 1UL;
+            pxDecoder->ulField = otalzssFIELD_LENGTH;
+            pxDecoder->ulBitsWanted = pxDecoder->xHeader.ucLookaheadBits;
+            break;
+
+        default:
+            ulValue++;
+
+            if( ulValue > ( pxDecoder->xHeader.ulImageSize - pxDecoder->ulProduced ) )
+            {
+                pxDecoder->xStatus = eOtaLzssBadStream;
+            }
+
+            for( i = 0UL; ( pxDecoder->xStatus == eOtaLzssSuccess ) && ( i < ulValue ); i++ )
+            {
+                prvPutByte( pxDecoder,
+                            pxDecoder->xParams.pucWindow[ ( pxDecoder->ulWindowHead - pxDecoder->ulDistance ) & pxDecoder->ulWindowMask ] );
+            }
+
+            pxDecoder->ulProduced += ulValue;
+            pxDecoder->ulField = otalzssFIELD_TAG;
+            pxDecoder->ulBitsWanted = 1UL;
+            break;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvFlush( OtaLzssDecoder_t * pxDecoder )
+{
+    const OtaLzssParams_t * pxParams = &pxDecoder->xParams;
+
+    if( ( pxDecoder->xStatus == eOtaLzssSuccess ) && ( pxDecoder->ulOutputFill > 0UL ) )
+    {
+        if( pxParams->xWrite( pxParams->pvContext,
+                              pxDecoder->ulWritten,
+                              pxParams->pucOutput,
+                              pxDecoder->ulOutputFill ) != ( int32_t ) pxDecoder->ulOutputFill )
+        {
+            pxDecoder->xStatus = eOtaLzssWriteFailed;
+        }
+
+        pxDecoder->ulWritten += pxDecoder->ulOutputFill;
+        pxDecoder->ulOutputFill = 0UL;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPutByte( OtaLzssDecoder_t * pxDecoder,
+                        uint8_t ucByte )
+{
+    const OtaLzssParams_t * pxParams = &pxDecoder->xParams;
+
+    pxParams->pucWindow[ pxDecoder->ulWindowHead ] = ucByte;
+    pxDecoder->ulWindowHead = ( pxDecoder->ulWindowHead + 1UL ) & pxDecoder->ulWindowMask;
+
+    pxParams->pucOutput[ pxDecoder->ulOutputFill ] = ucByte;
+    pxDecoder->ulOutputFill++;
+
+    if( pxDecoder->ulOutputFill == pxParams->ulOutputSize )
+    {
+        prvFlush( pxDecoder );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+OtaLzssStatus_t OtaLzss_ParseHeader( const uint8_t * pucData,
+                                     uint32_t ulLength,
+                                     OtaLzssHeader_t * pxHeader )
+{
+    OtaLzssStatus_t xStatus = eOtaLzssSuccess;
+    uint32_t ulMagic = 0UL;
+
+    if( ( pucData == NULL ) || ( pxHeader == NULL ) )
+    {
+        xStatus = eOtaLzssBadParameter;
+    }
+    else if( ulLength < otalzssHEADER_SIZE )
+    {
+        xStatus = eOtaLzssBadStream;
+    }
+    else
+    {
+        ulMagic = ( uint32_t ) pucData[ 0 ] | ( ( uint32_t ) pucData[ 1 ] << 8 ) |
+                  ( ( uint32_t ) pucData[ 2 ] << 16 ) | ( ( uint32_t ) pucData[ 3 ] << 24 );
+        pxHeader->ulImageSize = ( uint32_t ) pucData[ 4 ] | ( ( uint32_t ) pucData[ 5 ] << 8 ) |
+                                ( ( uint32_t ) pucData[ 6 ] << 16 ) | ( ( uint32_t ) pucData[ 7 ] << 24 );
+        pxHeader->ucWindowBits = pucData[ 8 ];
+        pxHeader->ucLookaheadBits = pucData[ 9 ];
+
+        if( ( ulMagic != otalzssMAGIC ) ||
+            ( pxHeader->ucWindowBits < 4U ) || ( pxHeader->ucWindowBits > otalzssMAX_WINDOW_BITS ) ||
+            ( pxHeader->ucLookaheadBits < 1U ) || ( pxHeader->ucLookaheadBits > otalzssMAX_LOOKAHEAD_BITS ) )
+        {
+            xStatus = eOtaLzssBadStream;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaLzssStatus_t OtaLzss_Start( OtaLzssDecoder_t * pxDecoder,
+                               const OtaLzssParams_t * pxParams )
+{
+    OtaLzssStatus_t xStatus = eOtaLzssSuccess;
+
+    if( ( pxDecoder == NULL ) || ( pxParams == NULL ) || ( pxParams->xWrite == NULL ) ||
+        ( pxParams->pucOutput == NULL ) || ( pxParams->ulOutputSize == 0UL ) ||
+        ( pxParams->pucWindow == NULL ) )
+    {
+        xStatus = eOtaLzssBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pxDecoder, 0, sizeof( *pxDecoder ) );
+        pxDecoder->xParams = *pxParams;
+        pxDecoder->xStatus = eOtaLzssSuccess;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaLzssStatus_t OtaLzss_Feed( OtaLzssDecoder_t * pxDecoder,
+                              const uint8_t * pucData,
+                              uint32_t ulLength )
+{
+    uint32_t i = 0UL;
+
+    if( pxDecoder->xStatus != eOtaLzssSuccess )
+    {
+        /* Stopped already. */
+    }
+    else if( ( pucData == NULL ) && ( ulLength > 0UL ) )
+    {
+        pxDecoder->xStatus = eOtaLzssBadParameter;
+    }
+    else if( ulLength > ( pxDecoder->xParams.ulPackedSize - pxDecoder->ulConsumed ) )
+    {
+        /* More than the file holds. */
+        pxDecoder->xStatus = eOtaLzssBadStream;
+    }
+    else
+    {
+        /* Checked above. */
+    }
+
+    for( i = 0UL; ( pxDecoder->xStatus == eOtaLzssSuccess ) && ( i < ulLength ); i++ )
+    {
+        if( pxDecoder->ulConsumed < otalzssHEADER_SIZE )
+        {
+            prvTakeHeaderByte( pxDecoder, pucData[ i ] );
+        }
+        else if( pxDecoder->ulProduced == pxDecoder->xHeader.ulImageSize )
+        {
+            /* A whole byte after the one that ended the last symbol. */
+            pxDecoder->xStatus = eOtaLzssBadStream;
+        }
+        else
+        {
+            prvTakeStreamByte( pxDecoder, pucData[ i ] );
+        }
+
+        pxDecoder->ulConsumed++;
+    }
+
+    return pxDecoder->xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaLzssStatus_t OtaLzss_Finish( OtaLzssDecoder_t * pxDecoder,
+                                uint32_t * pulImageSize )
+{
+    prvFlush( pxDecoder );
+
+    if( ( pxDecoder->xStatus == eOtaLzssSuccess ) &&
+        ( ( pxDecoder->ulConsumed < otalzssHEADER_SIZE ) ||
+          ( pxDecoder->ulConsumed != pxDecoder->xParams.ulPackedSize ) ||
+          ( pxDecoder->ulProduced != pxDecoder->xHeader.ulImageSize ) ) )
+    {
+        /* The stream ends before the image does. */
+        pxDecoder->xStatus = eOtaLzssBadStream;
+    }
+
+    if( pulImageSize != NULL )
+    {
+        *pulImageSize = pxDecoder->ulWritten;
+    }
+
+    return pxDecoder->xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaLzssStatus_t OtaLzss_Decompress( const OtaLzssParams_t * pxParams,
+                                    uint32_t * pulImageSize )
+{
+    OtaLzssDecoder_t xDecoder;
+    OtaLzssStatus_t xStatus = eOtaLzssSuccess;
+    uint32_t ulLength = 0UL;
+    int32_t lRead = 0;
+
+    if( ( pxParams == NULL ) || ( pxParams->xRead == NULL ) ||
+        ( pxParams->pucInput == NULL ) || ( pxParams->ulInputSize == 0UL ) )
+    {
+        xStatus = eOtaLzssBadParameter;
+    }
+    else
+    {
+        xStatus = OtaLzss_Start( &xDecoder, pxParams );
+    }
+
+    while( ( xStatus == eOtaLzssSuccess ) && ( xDecoder.ulConsumed < pxParams->ulPackedSize ) )
+    {
+        ulLength = pxParams->ulPackedSize - xDecoder.ulConsumed;
+
+        if( ulLength > pxParams->ulInputSize )
+        {
+            ulLength = pxParams->ulInputSize;
+        }
+
+        lRead = pxParams->xRead( pxParams->pvContext, xDecoder.ulConsumed, pxParams->pucInput, ulLength );
+
+        if( ( lRead <= 0 ) || ( ( uint32_t ) lRead > ulLength ) )
+        {
+            xStatus = eOtaLzssReadFailed;
+        }
+        else
+        {
+            xStatus = OtaLzss_Feed( &xDecoder, pxParams->pucInput, ( uint32_t ) lRead );
+        }
+    }
+
+    if( xStatus == eOtaLzssSuccess )
+    {
+        xStatus = OtaLzss_Finish( &xDecoder, pulImageSize );
+    }
+    else if( pulImageSize != NULL )
+    {
+        *pulImageSize = ( xStatus == eOtaLzssBadParameter ) ? 0UL : xDecoder.ulWritten;
+    }
+    else
+    {
+        /* No size asked for. */
+    }
+
+    return xStatus;
+}
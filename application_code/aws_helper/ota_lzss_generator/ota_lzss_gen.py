@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+
+import argparse
+import struct
+
+MAGIC = 0x315A4C4F  # "OLZ1"
+# Largest window and lookahead the device accepts; see ota_lzss.h.
+MAX_WINDOW_BITS = 12
+MAX_LOOKAHEAD_BITS = 8
+# Earlier positions with the same two bytes tried for each match.
+MAX_CANDIDATES = 64
+
+
+class BitWriter:
+    """
+    Collect bits most significant first, padding the last byte with zeros.
+    """
+
+    def __init__(self):
+        self.out = bytearray()
+        self.bits = 0
+        self.count = 0
+
+    def put(self, value, count):
+        self.bits = (self.bits << count) | value
+        self.count += count
+        while self.count >= 8:
+            self.count -= 8
+            self.out.append((self.bits >> self.count) & 0xFF)
+        self.bits &= (1 << self.count) - 1
+
+    def finish(self) -> bytes:
+        if self.count:
+            self.out.append((self.bits << (8 - self.count)) & 0xFF)
+        return bytes(self.out)
+
+
+def longest_match(image, pos, chain, window, max_length):
+    """
+    Longest earlier run within the window matching the bytes at pos, as
+    (distance, length).
+    """
+    best_length = 0
+    best_distance = 0
+    limit = min(max_length, len(image) - pos)
+    for cand in reversed(chain[-MAX_CANDIDATES:]):
+        if pos - cand > window:
+            break
+        # Only a match longer than the best so far matters.
+        if image[cand + best_length] != image[pos + best_length]:
+            continue
+        length = 0
+        while length < limit and image[cand + length] == image[pos + length]:
+            length += 1
+        if length > best_length:
+            best_length = length
+            best_distance = pos - cand
+            if length == limit:
+                break
+    return best_distance, best_length
+
+
+def compress(image, window_bits, lookahead_bits) -> bytes:
+    """
+    Compress an image into the format ota_lzss.h describes.
+    """
+    window = 1 << window_bits
+    max_length = 1 << lookahead_bits
+    # A back-reference pays off once it replaces more literal bits than it costs.
+    min_length = (1 + window_bits + lookahead_bits) // 9 + 1
+    chains = {}
+    writer = BitWriter()
+
+    pos = 0
+    while pos < len(image):
+        key = image[pos : pos + 2]
+        chain = chains.setdefault(key, [])
+        distance, length = longest_match(image, pos, chain, window, max_length) if len(key) == 2 else (0, 0)
+        if length >= min_length:
+            writer.put(0, 1)
+            writer.put(distance - 1, window_bits)
+            writer.put(length - 1, lookahead_bits)
+        else:
+            length = 1
+            writer.put(1, 1)
+            writer.put(image[pos], 8)
+        for p in range(pos, pos + length):
+            chains.setdefault(image[p : p + 2], []).append(p)
+        pos += length
+
+    return struct.pack("<IIBBxx", MAGIC, len(image), window_bits, lookahead_bits) + writer.finish()
+
+
+def main():
+    """
+    Write the compressed image.
+    """
+    parser = argparse.ArgumentParser(description="OTA compressed image generator. See README.md")
+    parser.add_argument("--image", action="store", required=True, dest="image", help="Image to compress.")
+    parser.add_argument("--out", action="store", required=True, dest="out", help="File to upload as the OTA file.")
+    parser.add_argument(
+        "--window-bits",
+        action="store",
+        type=int,
+        default=11,
+        dest="window_bits",
+        help="Log2 of the window; the device needs this many bytes of RAM. Default 11.",
+    )
+    parser.add_argument(
+        "--lookahead-bits",
+        action="store",
+        type=int,
+        default=4,
+        dest="lookahead_bits",
+        help="Log2 of the longest match. Default 4.",
+    )
+    args = parser.parse_args()
+
+    if not 4 <= args.window_bits <= MAX_WINDOW_BITS or not 1 <= args.lookahead_bits <= MAX_LOOKAHEAD_BITS:
+        parser.error("window bits must be 4 to {}, lookahead bits 1 to {}".format(MAX_WINDOW_BITS, MAX_LOOKAHEAD_BITS))
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    packed = compress(image, args.window_bits, args.lookahead_bits)
+
+    with open(args.out, "wb") as f:
+        f.write(packed)
+
+    print("{} bytes, {:.1%} of the image.".format(len(packed), len(packed) / max(len(image), 1)))
+
+
+if __name__ == "__main__":
+    main()
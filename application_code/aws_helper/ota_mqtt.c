@@ -0,0 +1,1013 @@
+/*
+ * ota_mqtt.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file ota_mqtt.c
+ *
+ * @brief A legacy network connection for the OTA agent, carried over the
+ * coreMQTT connection of the shadow task.
+ *
+ * Packets of the agent go into a message buffer, a whole packet per message,
+ * and are taken out by the shadow task. Packets for the agent are handed to
+ * the receive callback of its MQTT library right away, from the shadow task,
+ * and read from where they already are: the received publish or a small ack
+ * on the stack. There is no receive task and no receive buffer.
+ *
+ * xSessionUp and xOpen change in critical sections, so a CONNECT is never
+ * accepted on a session that already ended. The subscription table is only
+ * used by the shadow task.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* OTA MQTT configuration. */
+#include "ota_mqtt_config.h"
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "event_groups.h"
+#include "message_buffer.h"
+
+/* MQTT helpers. */
+#include "mqtt_demo_helpers.h"
+
+/* Latency histograms and counters. */
+#include "mqtt_metrics.h"
+
+#include "ota_mqtt.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Event bit set while the shadow task has a session up.
+ */
+#define otamqttSESSION_UP           ( 1U << 0 )
+
+/**
+ * @brief SUBACK return code of a filter that was not subscribed.
+ */
+#define otamqttSUBACK_FAILURE       ( 0x80U )
+
+/**
+ * @brief Longest fixed header: the type and a four byte remaining length.
+ */
+#define otamqttMAX_FIXED_HEADER     ( 5U )
+
+/**
+ * @brief Pieces a packet for the agent is read from: its head, the topic and
+ * the payload of a publish.
+ */
+#define otamqttDELIVERY_PIECES      ( 3U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A topic filter of OTA; free while usTopicFilterLength is 0.
+ */
+typedef struct OtaMqttSubscription
+{
+    char cTopicFilter[ otamqttconfigMAX_TOPIC_LENGTH ];
+    uint16_t usTopicFilterLength;
+} OtaMqttSubscription_t;
+
+/**
+ * @brief The packet the receive callback is reading.
+ */
+typedef struct OtaMqttDelivery
+{
+    const uint8_t * pucPiece[ otamqttDELIVERY_PIECES ];
+    size_t xPieceLength[ otamqttDELIVERY_PIECES ];
+    size_t xPiece;  /**< @brief The piece being read. */
+    size_t xOffset; /**< @brief Bytes of it already read. */
+} OtaMqttDelivery_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Packets of the agent, for the shadow task, and the lock of their
+ * writers.
+ */
+static MessageBufferHandle_t xOutbound = NULL;
+static StaticMessageBuffer_t xOutboundBuffer;
+static uint8_t ucOutboundStorage[ otamqttconfigSEND_BUFFER_SIZE + 1U ];
+static SemaphoreHandle_t xOutboundMutex = NULL;
+static StaticSemaphore_t xOutboundMutexBuffer;
+
+/**
+ * @brief Held while the receive callback runs, so the connection is not
+ * closed under it. Recursive, because the callback closes the connection
+ * when it finds a bad packet.
+ */
+static SemaphoreHandle_t xCallbackMutex = NULL;
+static StaticSemaphore_t xCallbackMutexBuffer;
+
+/**
+ * @brief Holds otamqttSESSION_UP.
+ */
+static EventGroupHandle_t xSessionEvents = NULL;
+static StaticEventGroup_t xSessionEventsBuffer;
+
+/**
+ * @brief Whether the shadow task has a session up, and whether the agent
+ * is connected on it.
+ */
+static volatile bool xSessionUp = false;
+static volatile bool xOpen = false;
+
+/**
+ * @brief The receive callback of the agent's MQTT library and its context.
+ */
+static IotNetworkReceiveCallback_t xReceiveCallback = NULL;
+static void * pvReceiveContext = NULL;
+
+/**
+ * @brief Told when the session under an open bridge ends.
+ */
+static OtaMqttDisconnectCallback_t xDisconnectCallback = NULL;
+
+/**
+ * @brief The packet being carried out by the shadow task.
+ */
+static uint8_t ucPacket[ otamqttconfigMAX_PACKET_SIZE ];
+
+/**
+ * @brief The packet being handed to the agent.
+ */
+static OtaMqttDelivery_t xDelivery;
+
+/**
+ * @brief The topic filters of OTA on the current session.
+ */
+static OtaMqttSubscription_t xSubscriptions[ otamqttconfigMAX_SUBSCRIPTIONS ];
+
+/**
+ * @brief The handle given to the agent's MQTT library. There is one bridge,
+ * so it only has to be a valid pointer.
+ */
+static uint8_t ucConnection;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read the remaining length of a packet.
+ *
+ * @param[in] pucPacket The packet.
+ * @param[in] xPacketLength Bytes in @p pucPacket.
+ * @param[out] pxBodyOffset Where the variable header starts.
+ *
+ * @return The remaining length, or 0 with @p pxBodyOffset set to 0 if the
+ * packet is incomplete.
+ */
+static size_t prvGetRemainingLength( const uint8_t * pucPacket,
+                                     size_t xPacketLength,
+                                     size_t * pxBodyOffset );
+
+/**
+ * @brief Write a fixed header.
+ *
+ * @return Bytes written, at most #otamqttMAX_FIXED_HEADER.
+ */
+static size_t prvPutFixedHeader( uint8_t * pucHeader,
+                                 uint8_t ucType,
+                                 size_t xRemainingLength );
+
+/**
+ * @brief Hand a packet, in up to three pieces, to the receive callback.
+ *
+ * @return true if a callback was set and read the whole packet.
+ */
+static bool prvDeliver( const uint8_t * pucHead,
+                        size_t xHeadLength,
+                        const uint8_t * pucTopic,
+                        size_t xTopicLength,
+                        const uint8_t * pucPayload,
+                        size_t xPayloadLength );
+
+/**
+ * @brief Hand a two byte ack carrying a packet identifier to the agent.
+ */
+static void prvDeliverAck( uint8_t ucType,
+                           uint16_t usPacketIdentifier );
+
+/**
+ * @brief Accept a CONNECT of the agent.
+ */
+static void prvConnect( void );
+
+/**
+ * @brief Find the slot of a topic filter.
+ *
+ * @return The slot, or NULL if the filter is unknown.
+ */
+static OtaMqttSubscription_t * prvFindSubscription( const char * pcTopicFilter,
+                                                    uint16_t usTopicFilterLength );
+
+/**
+ * @brief Carry out a SUBSCRIBE of the agent and answer it.
+ */
+static void prvSubscribe( MQTTContext_t * pxMqttContext,
+                          const uint8_t * pucBody,
+                          size_t xBodyLength );
+
+/**
+ * @brief Carry out an UNSUBSCRIBE of the agent and answer it.
+ */
+static void prvUnsubscribe( MQTTContext_t * pxMqttContext,
+                            const uint8_t * pucBody,
+                            size_t xBodyLength );
+
+/**
+ * @brief Carry out a PUBLISH of the agent at QoS0 and answer it.
+ *
+ * @return pdFAIL if it could not be written to the connection.
+ */
+static BaseType_t prvPublish( MQTTContext_t * pxMqttContext,
+                              uint8_t ucFlags,
+                              const uint8_t * pucBody,
+                              size_t xBodyLength );
+
+/* The legacy network interface. */
+static size_t prvSend( void * pvConnection,
+                       const uint8_t * pucMessage,
+                       size_t xMessageLength );
+static size_t prvReceive( void * pvConnection,
+                          uint8_t * pucBuffer,
+                          size_t xBytesRequested );
+static IotNetworkError_t prvSetReceiveCallback( void * pvConnection,
+                                                IotNetworkReceiveCallback_t xCallback,
+                                                void * pvContext );
+static IotNetworkError_t prvClose( void * pvConnection );
+static IotNetworkError_t prvDestroy( void * pvConnection );
+
+/*-----------------------------------------------------------*/
+
+static const IotNetworkInterface_t xNetworkInterface =
+{
+    .create             = NULL,
+    .send               = prvSend,
+    .receive            = prvReceive,
+    .setReceiveCallback = prvSetReceiveCallback,
+    .close              = prvClose,
+    .destroy            = prvDestroy
+};
+
+/*-----------------------------------------------------------*/
+
+static size_t prvGetRemainingLength( const uint8_t * pucPacket,
+                                     size_t xPacketLength,
+                                     size_t * pxBodyOffset )
+{
+    size_t xRemainingLength = 0U;
+    size_t xMultiplier = 1U;
+    size_t xIndex = 1U;
+    bool xDone = false;
+
+    *pxBodyOffset = 0U;
+
+    while( ( xDone == false ) && ( xIndex < xPacketLength ) && ( xIndex < otamqttMAX_FIXED_HEADER ) )
+    {
+        xRemainingLength += ( size_t ) ( pucPacket[ xIndex ] & 0x7FU ) * xMultiplier;
+        xMultiplier *= 128U;
+        xDone = ( ( pucPacket[ xIndex ] & 0x80U ) == 0U );
+        xIndex++;
+    }
+
+    if( ( xDone == true ) && ( ( xIndex + xRemainingLength ) <= xPacketLength ) )
+    {
+        *pxBodyOffset = xIndex;
+    }
+    else
+    {
+        xRemainingLength = 0U;
+    }
+
+    return xRemainingLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvPutFixedHeader( uint8_t * pucHeader,
+                                 uint8_t ucType,
+                                 size_t xRemainingLength )
+{
+    size_t xIndex = 0U;
+    uint8_t ucByte = 0U;
+
+    pucHeader[ xIndex++ ] = ucType;
+
+    do
+    {
+        ucByte = ( uint8_t ) ( xRemainingLength % 128U );
+        xRemainingLength /= 128U;
+
+        if( xRemainingLength > 0U )
+        {
+            ucByte |= 0x80U;
+        }
+
+        pucHeader[ xIndex++ ] = ucByte;
+    } while( ( xRemainingLength > 0U ) && ( xIndex < otamqttMAX_FIXED_HEADER ) );
+
+    return xIndex;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvDeliver( const uint8_t * pucHead,
+                        size_t xHeadLength,
+                        const uint8_t * pucTopic,
+                        size_t xTopicLength,
+                        const uint8_t * pucPayload,
+                        size_t xPayloadLength )
+{
+    bool xDelivered = false;
+    size_t x = 0U;
+
+    ( void ) xSemaphoreTakeRecursive( xCallbackMutex, portMAX_DELAY );
+
+    if( xReceiveCallback != NULL )
+    {
+        xDelivery.pucPiece[ 0 ] = pucHead;
+        xDelivery.xPieceLength[ 0 ] = xHeadLength;
+        xDelivery.pucPiece[ 1 ] = pucTopic;
+        xDelivery.xPieceLength[ 1 ] = xTopicLength;
+        xDelivery.pucPiece[ 2 ] = pucPayload;
+        xDelivery.xPieceLength[ 2 ] = xPayloadLength;
+        xDelivery.xPiece = 0U;
+        xDelivery.xOffset = 0U;
+
+        /* The library reads the whole packet in this call. */
+        xReceiveCallback( &ucConnection, pvReceiveContext );
+
+        xDelivered = ( xDelivery.xPiece == otamqttDELIVERY_PIECES );
+
+        for( x = 0U; x < otamqttDELIVERY_PIECES; x++ )
+        {
+            xDelivery.xPieceLength[ x ] = 0U;
+        }
+
+        xDelivery.xPiece = otamqttDELIVERY_PIECES;
+    }
+
+    ( void ) xSemaphoreGiveRecursive( xCallbackMutex );
+
+    return xDelivered;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDeliverAck( uint8_t ucType,
+                           uint16_t usPacketIdentifier )
+{
+    uint8_t ucAck[ 4 ];
+
+    ucAck[ 0 ] = ucType;
+    ucAck[ 1 ] = 2U;
+    ucAck[ 2 ] = ( uint8_t ) ( usPacketIdentifier >> 8 );
+    ucAck[ 3 ] = ( uint8_t ) ( usPacketIdentifier & 0xFFU );
+
+    if( prvDeliver( ucAck, sizeof( ucAck ), NULL, 0U, NULL, 0U ) == false )
+    {
+        LogWarn( ( "The ack of OTA packet %u was not taken.", ( unsigned ) usPacketIdentifier ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvConnect( void )
+{
+    const uint8_t ucConnack[ 4 ] = { MQTT_PACKET_TYPE_CONNACK, 2U, 0U, 0U };
+
+    taskENTER_CRITICAL();
+    xOpen = xSessionUp;
+    taskEXIT_CRITICAL();
+
+    /* A CONNECT whose connect call already timed out finds no callback. */
+    if( prvDeliver( ucConnack, sizeof( ucConnack ), NULL, 0U, NULL, 0U ) == true )
+    {
+        LogInfo( ( "OTA connected over the shadow session." ) );
+    }
+    else
+    {
+        xOpen = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaMqttSubscription_t * prvFindSubscription( const char * pcTopicFilter,
+                                                    uint16_t usTopicFilterLength )
+{
+    OtaMqttSubscription_t * pxFound = NULL;
+    size_t x = 0U;
+
+    for( x = 0U; ( pxFound == NULL ) && ( x < otamqttconfigMAX_SUBSCRIPTIONS ); x++ )
+    {
+        if( ( xSubscriptions[ x ].usTopicFilterLength == usTopicFilterLength ) &&
+            ( memcmp( xSubscriptions[ x ].cTopicFilter, pcTopicFilter, usTopicFilterLength ) == 0 ) )
+        {
+            pxFound = &xSubscriptions[ x ];
+        }
+    }
+
+    return pxFound;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSubscribe( MQTTContext_t * pxMqttContext,
+                          const uint8_t * pucBody,
+                          size_t xBodyLength )
+{
+    MQTTSubscribeInfo_t xFilters[ otamqttconfigMAX_SUBSCRIPTIONS ];
+    uint8_t ucSuback[ otamqttMAX_FIXED_HEADER + 2U + otamqttconfigMAX_SUBSCRIPTIONS ];
+    size_t xFilterCount = 0U;
+    size_t xFreeSlots = 0U;
+    size_t xOffset = 2U;
+    size_t xHeaderLength = 0U;
+    size_t x = 0U;
+    uint16_t usLength = 0U;
+    uint16_t usPacketIdentifier = 0U;
+    bool xValid = ( xBodyLength > 2U );
+    OtaMqttSubscription_t * pxSlot = NULL;
+
+    ( void ) memset( xFilters, 0x00, sizeof( xFilters ) );
+
+    if( xValid == true )
+    {
+        usPacketIdentifier = ( uint16_t ) ( ( ( uint16_t ) pucBody[ 0 ] << 8 ) | pucBody[ 1 ] );
+    }
+
+    /* Each filter is its length, the filter and the requested QoS. */
+    while( ( xValid == true ) && ( xOffset < xBodyLength ) )
+    {
+        if( ( xFilterCount == otamqttconfigMAX_SUBSCRIPTIONS ) || ( ( xOffset + 2U ) > xBodyLength ) )
+        {
+            xValid = false;
+        }
+        else
+        {
+            usLength = ( uint16_t ) ( ( ( uint16_t ) pucBody[ xOffset ] << 8 ) | pucBody[ xOffset + 1U ] );
+            xOffset += 2U;
+
+            if( ( usLength == 0U ) || ( usLength > otamqttconfigMAX_TOPIC_LENGTH ) ||
+                ( ( xOffset + usLength + 1U ) > xBodyLength ) )
+            {
+                xValid = false;
+            }
+            else
+            {
+                xFilters[ xFilterCount ].pTopicFilter = ( const char * ) &pucBody[ xOffset ];
+                xFilters[ xFilterCount ].topicFilterLength = usLength;
+                xFilters[ xFilterCount ].qos = ( pucBody[ xOffset + usLength ] == 0U ) ? MQTTQoS0 : MQTTQoS1;
+                xOffset += ( size_t ) usLength + 1U;
+                xFilterCount++;
+            }
+        }
+    }
+
+    if( ( xValid == false ) || ( xFilterCount == 0U ) )
+    {
+        /* No SUBACK; the agent's subscribe times out. */
+        LogError( ( "Dropped a SUBSCRIBE of OTA that could not be read." ) );
+    }
+    else
+    {
+        /* Known filters keep their slot. */
+        for( x = 0U; x < otamqttconfigMAX_SUBSCRIPTIONS; x++ )
+        {
+            if( xSubscriptions[ x ].usTopicFilterLength == 0U )
+            {
+                xFreeSlots++;
+            }
+        }
+
+        for( x = 0U; x < xFilterCount; x++ )
+        {
+            if( prvFindSubscription( xFilters[ x ].pTopicFilter, xFilters[ x ].topicFilterLength ) != NULL )
+            {
+                xFreeSlots++;
+            }
+        }
+
+        if( xFreeSlots < xFilterCount )
+        {
+            LogError( ( "No subscription slot left for %.*s.",
+                        ( int ) xFilters[ 0 ].topicFilterLength,
+                        xFilters[ 0 ].pTopicFilter ) );
+            xValid = false;
+        }
+        else if( SubscribeToTopics( pxMqttContext, xFilters, xFilterCount ) == pdFAIL )
+        {
+            xValid = false;
+        }
+        else
+        {
+            for( x = 0U; x < xFilterCount; x++ )
+            {
+                pxSlot = prvFindSubscription( xFilters[ x ].pTopicFilter, xFilters[ x ].topicFilterLength );
+
+                /* A free slot has a length of 0, which no filter has. */
+                if( pxSlot == NULL )
+                {
+                    pxSlot = prvFindSubscription( "", 0U );
+                }
+
+                ( void ) memcpy( pxSlot->cTopicFilter, xFilters[ x ].pTopicFilter, xFilters[ x ].topicFilterLength );
+                pxSlot->usTopicFilterLength = xFilters[ x ].topicFilterLength;
+            }
+        }
+
+        /* The agent is told which filters failed, so it gives up on them. */
+        xHeaderLength = prvPutFixedHeader( ucSuback, MQTT_PACKET_TYPE_SUBACK, 2U + xFilterCount );
+        ucSuback[ xHeaderLength++ ] = ( uint8_t ) ( usPacketIdentifier >> 8 );
+        ucSuback[ xHeaderLength++ ] = ( uint8_t ) ( usPacketIdentifier & 0xFFU );
+
+        for( x = 0U; x < xFilterCount; x++ )
+        {
+            ucSuback[ xHeaderLength++ ] = ( xValid == true ) ? ( uint8_t ) xFilters[ x ].qos : otamqttSUBACK_FAILURE;
+        }
+
+        if( prvDeliver( ucSuback, xHeaderLength, NULL, 0U, NULL, 0U ) == false )
+        {
+            LogWarn( ( "The SUBACK of OTA packet %u was not taken.", ( unsigned ) usPacketIdentifier ) );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvUnsubscribe( MQTTContext_t * pxMqttContext,
+                            const uint8_t * pucBody,
+                            size_t xBodyLength )
+{
+    size_t xOffset = 2U;
+    uint16_t usLength = 0U;
+    uint16_t usPacketIdentifier = 0U;
+    OtaMqttSubscription_t * pxSlot = NULL;
+
+    if( xBodyLength <= 2U )
+    {
+        LogError( ( "Dropped an UNSUBSCRIBE of OTA that could not be read." ) );
+    }
+    else
+    {
+        usPacketIdentifier = ( uint16_t ) ( ( ( uint16_t ) pucBody[ 0 ] << 8 ) | pucBody[ 1 ] );
+
+        while( ( xOffset + 2U ) <= xBodyLength )
+        {
+            usLength = ( uint16_t ) ( ( ( uint16_t ) pucBody[ xOffset ] << 8 ) | pucBody[ xOffset + 1U ] );
+            xOffset += 2U;
+
+            if( ( xOffset + usLength ) > xBodyLength )
+            {
+                break;
+            }
+
+            /* Forgotten either way; a filter left on the broker ends with the
+             * clean session. */
+            pxSlot = prvFindSubscription( ( const char * ) &pucBody[ xOffset ], usLength );
+
+            if( pxSlot != NULL )
+            {
+                pxSlot->usTopicFilterLength = 0U;
+            }
+
+            ( void ) UnsubscribeFromTopic( pxMqttContext, ( const char * ) &pucBody[ xOffset ], usLength );
+            xOffset += usLength;
+        }
+
+        prvDeliverAck( MQTT_PACKET_TYPE_UNSUBACK, usPacketIdentifier );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvPublish( MQTTContext_t * pxMqttContext,
+                              uint8_t ucFlags,
+                              const uint8_t * pucBody,
+                              size_t xBodyLength )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    MQTTPublishInfo_t xPublishInfo = { 0 };
+    MQTTStatus_t eMqttStatus = MQTTSuccess;
+    uint8_t ucQoS = ( uint8_t ) ( ( ucFlags >> 1 ) & 0x03U );
+    uint16_t usTopicLength = 0U;
+    uint16_t usPacketIdentifier = 0U;
+    size_t xOffset = 0U;
+
+    if( xBodyLength >= 2U )
+    {
+        usTopicLength = ( uint16_t ) ( ( ( uint16_t ) pucBody[ 0 ] << 8 ) | pucBody[ 1 ] );
+        xOffset = 2U + ( size_t ) usTopicLength + ( ( ucQoS > 0U ) ? 2U : 0U );
+    }
+
+    if( ( usTopicLength == 0U ) || ( xOffset > xBodyLength ) )
+    {
+        LogError( ( "Dropped a PUBLISH of OTA that could not be read." ) );
+    }
+    else
+    {
+        if( ucQoS > 0U )
+        {
+            usPacketIdentifier = ( uint16_t ) ( ( ( uint16_t ) pucBody[ xOffset - 2U ] << 8 ) | pucBody[ xOffset - 1U ] );
+        }
+
+        xPublishInfo.qos = MQTTQoS0;
+        xPublishInfo.pTopicName = ( const char * ) &pucBody[ 2 ];
+        xPublishInfo.topicNameLength = usTopicLength;
+        xPublishInfo.pPayload = &pucBody[ xOffset ];
+        xPublishInfo.payloadLength = xBodyLength - xOffset;
+
+        eMqttStatus = MQTT_Publish( pxMqttContext, &xPublishInfo, MQTT_PACKET_ID_INVALID );
+
+        if( eMqttStatus != MQTTSuccess )
+        {
+            LogError( ( "Failed to send OTA PUBLISH to %.*s with error = %s.",
+                        ( int ) usTopicLength,
+                        xPublishInfo.pTopicName,
+                        MQTT_Status_strerror( eMqttStatus ) ) );
+            MQTTMetrics_Count( eMetricsPublishFailed, 1UL );
+
+            /* A PUBLISH that cannot be written means the connection is
+             * gone; the agent learns it from the disconnect callback. */
+            xReturnStatus = pdFAIL;
+        }
+        else
+        {
+            MQTTMetrics_Count( eMetricsPublishSent, 1UL );
+            MQTTMetrics_Count( eMetricsPayloadBytesSent, xPublishInfo.payloadLength );
+
+            if( ucQoS > 0U )
+            {
+                prvDeliverAck( MQTT_PACKET_TYPE_PUBACK, usPacketIdentifier );
+            }
+        }
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvSend( void * pvConnection,
+                       const uint8_t * pucMessage,
+                       size_t xMessageLength )
+{
+    size_t xSent = 0U;
+    size_t xBodyOffset = 0U;
+    uint8_t ucType = 0U;
+
+    ( void ) pvConnection;
+
+    if( ( pucMessage != NULL ) && ( xMessageLength >= 2U ) )
+    {
+        ( void ) prvGetRemainingLength( pucMessage, xMessageLength, &xBodyOffset );
+    }
+
+    if( xBodyOffset == 0U )
+    {
+        LogError( ( "The OTA MQTT library sent an incomplete packet." ) );
+    }
+    else
+    {
+        ucType = pucMessage[ 0 ] & 0xF0U;
+
+        if( ucType == MQTT_PACKET_TYPE_DISCONNECT )
+        {
+            xOpen = false;
+            xSent = xMessageLength;
+        }
+        else if( ( ucType == MQTT_PACKET_TYPE_PUBACK ) || ( ucType == MQTT_PACKET_TYPE_PINGREQ ) )
+        {
+            /* Publishes are handed to the agent at QoS0, and the shadow
+             * connection keeps the broker alive. */
+            xSent = xMessageLength;
+        }
+        else if( ( ucType == MQTT_PACKET_TYPE_CONNECT ) ? ( xSessionUp == false ) : ( xOpen == false ) )
+        {
+            LogWarn( ( "OTA packet 0x%02x not sent, no shadow session is up.", ( unsigned ) pucMessage[ 0 ] ) );
+        }
+        else if( xMessageLength > otamqttconfigMAX_PACKET_SIZE )
+        {
+            LogError( ( "OTA packet of %u bytes is larger than otamqttconfigMAX_PACKET_SIZE.",
+                        ( unsigned ) xMessageLength ) );
+        }
+        else
+        {
+            ( void ) xSemaphoreTake( xOutboundMutex, portMAX_DELAY );
+            xSent = xMessageBufferSend( xOutbound,
+                                        pucMessage,
+                                        xMessageLength,
+                                        pdMS_TO_TICKS( otamqttconfigSEND_TIMEOUT_MS ) );
+            ( void ) xSemaphoreGive( xOutboundMutex );
+
+            if( xSent == 0U )
+            {
+                LogWarn( ( "OTA packet not sent, the shadow task did not take the last ones." ) );
+            }
+        }
+    }
+
+    return xSent;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvReceive( void * pvConnection,
+                          uint8_t * pucBuffer,
+                          size_t xBytesRequested )
+{
+    size_t xReceived = 0U;
+    size_t xCopy = 0U;
+
+    ( void ) pvConnection;
+
+    /* Only called from the receive callback, inside prvDeliver(). */
+    while( ( xReceived < xBytesRequested ) && ( xDelivery.xPiece < otamqttDELIVERY_PIECES ) )
+    {
+        xCopy = xDelivery.xPieceLength[ xDelivery.xPiece ] - xDelivery.xOffset;
+
+        if( xCopy > ( xBytesRequested - xReceived ) )
+        {
+            xCopy = xBytesRequested - xReceived;
+        }
+
+        if( xCopy > 0U )
+        {
+            ( void ) memcpy( &pucBuffer[ xReceived ],
+                             &xDelivery.pucPiece[ xDelivery.xPiece ][ xDelivery.xOffset ],
+                             xCopy );
+            xReceived += xCopy;
+            xDelivery.xOffset += xCopy;
+        }
+
+        /* Empty pieces are passed over too, so a packet read to its end
+         * leaves xPiece at otamqttDELIVERY_PIECES. */
+        while( ( xDelivery.xPiece < otamqttDELIVERY_PIECES ) &&
+               ( xDelivery.xOffset == xDelivery.xPieceLength[ xDelivery.xPiece ] ) )
+        {
+            xDelivery.xPiece++;
+            xDelivery.xOffset = 0U;
+        }
+    }
+
+    return xReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+static IotNetworkError_t prvSetReceiveCallback( void * pvConnection,
+                                                IotNetworkReceiveCallback_t xCallback,
+                                                void * pvContext )
+{
+    ( void ) pvConnection;
+
+    ( void ) xSemaphoreTakeRecursive( xCallbackMutex, portMAX_DELAY );
+    xReceiveCallback = xCallback;
+    pvReceiveContext = pvContext;
+    ( void ) xSemaphoreGiveRecursive( xCallbackMutex );
+
+    return IOT_NETWORK_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+static IotNetworkError_t prvClose( void * pvConnection )
+{
+    ( void ) pvConnection;
+
+    /* Waits for a callback in progress, unless the callback is closing. */
+    ( void ) xSemaphoreTakeRecursive( xCallbackMutex, portMAX_DELAY );
+    xReceiveCallback = NULL;
+    pvReceiveContext = NULL;
+    xOpen = false;
+    ( void ) xSemaphoreGiveRecursive( xCallbackMutex );
+
+    return IOT_NETWORK_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+static IotNetworkError_t prvDestroy( void * pvConnection )
+{
+    /* The bridge is static; there is nothing to free. */
+    ( void ) pvConnection;
+
+    return IOT_NETWORK_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t OtaMqtt_Init( void )
+{
+    BaseType_t xReturnStatus = pdPASS;
+
+    if( xOutbound == NULL )
+    {
+        xOutbound = xMessageBufferCreateStatic( sizeof( ucOutboundStorage ), ucOutboundStorage, &xOutboundBuffer );
+        xOutboundMutex = xSemaphoreCreateMutexStatic( &xOutboundMutexBuffer );
+        xCallbackMutex = xSemaphoreCreateRecursiveMutexStatic( &xCallbackMutexBuffer );
+        xSessionEvents = xEventGroupCreateStatic( &xSessionEventsBuffer );
+        xDelivery.xPiece = otamqttDELIVERY_PIECES;
+    }
+
+    if( ( xOutbound == NULL ) || ( xOutboundMutex == NULL ) ||
+        ( xCallbackMutex == NULL ) || ( xSessionEvents == NULL ) )
+    {
+        LogError( ( "Failed to create the OTA MQTT bridge." ) );
+        xReturnStatus = pdFAIL;
+    }
+    else
+    {
+        /* All the RAM OTA needs for MQTT; the connection, its network buffer
+         * and its keep-alive are the shadow's. */
+        LogInfo( ( "OTA shares the shadow connection with %u bytes of state.",
+                   ( unsigned ) ( sizeof( ucOutboundStorage ) + sizeof( xOutboundBuffer ) +
+                                  sizeof( ucPacket ) + sizeof( xSubscriptions ) + sizeof( xDelivery ) +
+                                  sizeof( xOutboundMutexBuffer ) + sizeof( xCallbackMutexBuffer ) +
+                                  sizeof( xSessionEventsBuffer ) ) ) );
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+const IotNetworkInterface_t * OtaMqtt_GetNetworkInterface( void )
+{
+    return &xNetworkInterface;
+}
+
+/*-----------------------------------------------------------*/
+
+void * OtaMqtt_GetConnection( void )
+{
+    return &ucConnection;
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaMqtt_SetDisconnectCallback( OtaMqttDisconnectCallback_t xCallback )
+{
+    xDisconnectCallback = xCallback;
+}
+
+/*-----------------------------------------------------------*/
+
+bool OtaMqtt_WaitForSession( TickType_t xTicksToWait )
+{
+    assert( xSessionEvents != NULL );
+
+    return ( ( xEventGroupWaitBits( xSessionEvents,
+                                    otamqttSESSION_UP,
+                                    pdFALSE,
+                                    pdTRUE,
+                                    xTicksToWait ) & otamqttSESSION_UP ) != 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaMqtt_StartSession( void )
+{
+    taskENTER_CRITICAL();
+    xSessionUp = true;
+    taskEXIT_CRITICAL();
+
+    ( void ) xEventGroupSetBits( xSessionEvents, otamqttSESSION_UP );
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaMqtt_EndSession( void )
+{
+    bool xWasOpen = false;
+
+    ( void ) xEventGroupClearBits( xSessionEvents, otamqttSESSION_UP );
+
+    taskENTER_CRITICAL();
+    xWasOpen = xOpen;
+    xSessionUp = false;
+    xOpen = false;
+    taskEXIT_CRITICAL();
+
+    /* Packets for the session that ended are not sent on the next one. A
+     * sender may be blocked on the buffer, so it is drained, not reset. */
+    while( xMessageBufferReceive( xOutbound, ucPacket, sizeof( ucPacket ), 0U ) > 0U )
+    {
+    }
+
+    ( void ) memset( xSubscriptions, 0x00, sizeof( xSubscriptions ) );
+
+    if( ( xWasOpen == true ) && ( xDisconnectCallback != NULL ) )
+    {
+        LogWarn( ( "Shadow session ended under the OTA connection." ) );
+        xDisconnectCallback();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t OtaMqtt_Process( MQTTContext_t * pxMqttContext )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    size_t xLength = 0U;
+    size_t xBodyOffset = 0U;
+    size_t xBodyLength = 0U;
+
+    assert( pxMqttContext != NULL );
+
+    while( ( xReturnStatus == pdPASS ) &&
+           ( ( xLength = xMessageBufferReceive( xOutbound, ucPacket, sizeof( ucPacket ), 0U ) ) > 0U ) )
+    {
+        xBodyLength = prvGetRemainingLength( ucPacket, xLength, &xBodyOffset );
+
+        switch( ucPacket[ 0 ] & 0xF0U )
+        {
+            case MQTT_PACKET_TYPE_CONNECT:
+                prvConnect();
+                break;
+
+            case MQTT_PACKET_TYPE_PUBLISH:
+                xReturnStatus = prvPublish( pxMqttContext, ucPacket[ 0 ], &ucPacket[ xBodyOffset ], xBodyLength );
+                break;
+
+            case ( MQTT_PACKET_TYPE_SUBSCRIBE & 0xF0U ):
+                prvSubscribe( pxMqttContext, &ucPacket[ xBodyOffset ], xBodyLength );
+                break;
+
+            default:
+                prvUnsubscribe( pxMqttContext, &ucPacket[ xBodyOffset ], xBodyLength );
+                break;
+        }
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+bool OtaMqtt_IsOpen( void )
+{
+    return xOpen;
+}
+
+/*-----------------------------------------------------------*/
+
+bool OtaMqtt_Dispatch( const MQTTPublishInfo_t * pxPublishInfo )
+{
+    uint8_t ucHead[ otamqttMAX_FIXED_HEADER + 2U ];
+    size_t xHeadLength = 0U;
+    bool xMatched = false;
+    size_t x = 0U;
+
+    assert( pxPublishInfo != NULL );
+
+    for( x = 0U; ( xMatched == false ) && ( x < otamqttconfigMAX_SUBSCRIPTIONS ); x++ )
+    {
+        if( ( xSubscriptions[ x ].usTopicFilterLength > 0U ) &&
+            ( MQTT_MatchTopic( pxPublishInfo->pTopicName,
+                               pxPublishInfo->topicNameLength,
+                               xSubscriptions[ x ].cTopicFilter,
+                               xSubscriptions[ x ].usTopicFilterLength,
+                               &xMatched ) != MQTTSuccess ) )
+        {
+            xMatched = false;
+        }
+    }
+
+    if( ( xMatched == true ) && ( xOpen == true ) )
+    {
+        /* Handed on at QoS0, straight from the network buffer; the shadow
+         * connection acks it to the broker. */
+        xHeadLength = prvPutFixedHeader( ucHead,
+                                         MQTT_PACKET_TYPE_PUBLISH,
+                                         2U + pxPublishInfo->topicNameLength + pxPublishInfo->payloadLength );
+        ucHead[ xHeadLength++ ] = ( uint8_t ) ( pxPublishInfo->topicNameLength >> 8 );
+        ucHead[ xHeadLength++ ] = ( uint8_t ) ( pxPublishInfo->topicNameLength & 0xFFU );
+
+        if( prvDeliver( ucHead,
+                        xHeadLength,
+                        ( const uint8_t * ) pxPublishInfo->pTopicName,
+                        pxPublishInfo->topicNameLength,
+                        ( const uint8_t * ) pxPublishInfo->pPayload,
+                        pxPublishInfo->payloadLength ) == false )
+        {
+            /* The agent requests a lost block again. */
+            LogWarn( ( "An OTA publish of %u bytes was not taken.",
+                       ( unsigned ) pxPublishInfo->payloadLength ) );
+        }
+    }
+
+    return xMatched;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,354 @@
+/*
+ * ota_window.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file ota_window.c
+ *
+ * @brief Adaptive OTA block-request window.
+ *
+ * A round is one request's worth of blocks, ending with the block that
+ * makes the agent ask again. Its rate is taken from the end of the round
+ * before, so it includes the round trip of the request, which is what a
+ * larger window amortizes. The window grows additively while that rate
+ * improves by otawindowconfigGAIN_PERCENT, and stays put once it levels
+ * off. It is halved when the agent's dropped-packet counter moves, which
+ * means blocks arrived faster than the agent could take them, and when the
+ * gap between two blocks exceeds otawindowconfigSTALL_MS, which means a
+ * request was not answered in full and the agent had to time out.
+ *
+ * The agent reads the window more than once per request, so it is taken
+ * once, on the first read after a block, and held until the next block.
+ *
+ * A drop also caps the window below the size that overran the buffers for
+ * the rest of the file. Every drop costs an agent timeout, so probing for
+ * the same limit again would cost more than the blocks it could win. That
+ * timeout is the drop's own and does not cut the window a second time.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <string.h>
+
+/* OTA window configuration. */
+#include "ota_window_config.h"
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* OTA agent, for its packet counters. */
+#include "aws_iot_ota_agent.h"
+
+#include "ota_window.h"
+
+/*-----------------------------------------------------------*/
+
+#if ( otawindowconfigMIN_BLOCKS < 1U ) || ( otawindowconfigMAX_BLOCKS < otawindowconfigMIN_BLOCKS )
+    #error "The OTA window needs 1 <= otawindowconfigMIN_BLOCKS <= otawindowconfigMAX_BLOCKS."
+#endif
+
+#if ( otawindowconfigMAX_BLOCKS > otaconfigMAX_NUM_OTA_DATA_BUFFERS )
+    #error "otawindowconfigMAX_BLOCKS may be no more than otaconfigMAX_NUM_OTA_DATA_BUFFERS."
+#endif
+
+#if ( otawindowconfigINITIAL_BLOCKS < otawindowconfigMIN_BLOCKS ) || ( otawindowconfigINITIAL_BLOCKS > otawindowconfigMAX_BLOCKS )
+    #error "otawindowconfigINITIAL_BLOCKS must be within the OTA window."
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Blocks asked for per request.
+ */
+static uint32_t ulWindow = otawindowconfigINITIAL_BLOCKS;
+
+/**
+ * @brief The window taken for the current request.
+ */
+static uint32_t ulRequestBlocks = otawindowconfigINITIAL_BLOCKS;
+
+/**
+ * @brief Set when a block was written since the window was last taken.
+ */
+static bool xNewRequest = true;
+
+/**
+ * @brief Largest window that has not overrun the agent's data buffers.
+ */
+static uint32_t ulCeiling = otawindowconfigMAX_BLOCKS;
+
+/**
+ * @brief Blocks received in the current round.
+ */
+static uint32_t ulRoundBlocks = 0UL;
+
+/**
+ * @brief Bytes received in the current round.
+ */
+static uint32_t ulRoundBytes = 0UL;
+
+/**
+ * @brief End of the last round, or the start of the file.
+ */
+static TickType_t xRoundStart = 0;
+
+/**
+ * @brief Time of the last block.
+ */
+static TickType_t xLastBlock = 0;
+
+/**
+ * @brief Bytes per second of the last round; 0 after a cut.
+ */
+static uint32_t ulLastRate = 0UL;
+
+/**
+ * @brief Time the file was created.
+ */
+static TickType_t xFileStart = 0;
+
+/**
+ * @brief Agent counters at the start of the file and the last round.
+ */
+static uint32_t ulDroppedAtStart = 0UL;
+static uint32_t ulProcessedAtStart = 0UL;
+static uint32_t ulLastDropped = 0UL;
+
+/**
+ * @brief Set by a drop until the timeout it causes has passed.
+ */
+static bool xDropPending = false;
+
+static uint32_t ulBlocks = 0UL;
+static uint32_t ulBytes = 0UL;
+static uint32_t ulCuts = 0UL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Halve the window and start a new round.
+ *
+ * @param[in] pcReason What the cut is for, for the log.
+ */
+static void prvCut( const char * pcReason );
+
+/**
+ * @brief Cut the window if the agent dropped a block since the last check.
+ */
+static void prvCheckDrops( void );
+
+/**
+ * @brief Milliseconds between two tick counts.
+ */
+static uint32_t prvElapsedMs( TickType_t xFrom,
+                              TickType_t xTo );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvElapsedMs( TickType_t xFrom,
+                              TickType_t xTo )
+{
+    return ( uint32_t ) ( xTo - xFrom ) * ( uint32_t ) portTICK_PERIOD_MS;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCut( const char * pcReason )
+{
+    ulWindow = ulWindow / 2UL;
+
+    if( ulWindow < otawindowconfigMIN_BLOCKS )
+    {
+        ulWindow = otawindowconfigMIN_BLOCKS;
+    }
+
+    ulCuts++;
+    ulLastRate = 0UL;
+    ulRoundBlocks = 0UL;
+    ulRoundBytes = 0UL;
+
+    LogInfo( ( "%s; asking for %lu blocks per request.", pcReason, ( unsigned long ) ulWindow ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCheckDrops( void )
+{
+    uint32_t ulDropped = OTA_GetPacketsDropped();
+
+    if( ulDropped != ulLastDropped )
+    {
+        ulLastDropped = ulDropped;
+
+        if( ulWindow > otawindowconfigMIN_BLOCKS )
+        {
+            ulCeiling = ulWindow - 1UL;
+        }
+
+        xDropPending = true;
+        xRoundStart = xTaskGetTickCount();
+        prvCut( "Blocks dropped" );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaWindow_Start( void )
+{
+    xFileStart = xTaskGetTickCount();
+    xRoundStart = xFileStart;
+    xLastBlock = xFileStart;
+
+    ulWindow = otawindowconfigINITIAL_BLOCKS;
+    ulCeiling = otawindowconfigMAX_BLOCKS;
+    ulRoundBlocks = 0UL;
+    ulRoundBytes = 0UL;
+    ulLastRate = 0UL;
+    ulBlocks = 0UL;
+    ulBytes = 0UL;
+    ulCuts = 0UL;
+
+    ulDroppedAtStart = OTA_GetPacketsDropped();
+    ulProcessedAtStart = OTA_GetPacketsProcessed();
+    ulLastDropped = ulDroppedAtStart;
+    xDropPending = false;
+
+    ulRequestBlocks = ulWindow;
+    xNewRequest = true;
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaWindow_BlockReceived( uint32_t ulBlockBytes )
+{
+    TickType_t xNow = xTaskGetTickCount();
+    uint32_t ulElapsedMs = 0UL;
+    uint32_t ulRate = 0UL;
+
+    prvCheckDrops();
+
+    /* A block after a long silence is the answer to a request made again
+     * after a timeout; the round it started is measured from here. */
+    if( prvElapsedMs( xLastBlock, xNow ) > otawindowconfigSTALL_MS )
+    {
+        if( ( ulBlocks > 0UL ) && ( xDropPending == false ) )
+        {
+            prvCut( "Request timed out" );
+        }
+
+        xDropPending = false;
+        xRoundStart = xNow;
+    }
+
+    xLastBlock = xNow;
+    ulBlocks++;
+    ulBytes += ulBlockBytes;
+    ulRoundBlocks++;
+    ulRoundBytes += ulBlockBytes;
+
+    if( ulRoundBlocks >= ulWindow )
+    {
+        ulElapsedMs = prvElapsedMs( xRoundStart, xNow );
+
+        if( ulElapsedMs == 0UL )
+        {
+            ulElapsedMs = 1UL;
+        }
+
+        ulRate = ( uint32_t ) ( ( ( uint64_t ) ulRoundBytes * 1000ULL ) / ulElapsedMs );
+
+        if( ( ulWindow < ulCeiling ) &&
+            ( ( ( uint64_t ) ulRate * 100ULL ) >= ( ( uint64_t ) ulLastRate * ( 100ULL + otawindowconfigGAIN_PERCENT ) ) ) )
+        {
+            ulWindow++;
+            LogDebug( ( "%lu B/s; asking for %lu blocks per request.",
+                        ( unsigned long ) ulRate, ( unsigned long ) ulWindow ) );
+        }
+
+        ulLastRate = ulRate;
+        ulRoundBlocks = 0UL;
+        ulRoundBytes = 0UL;
+        xRoundStart = xNow;
+    }
+
+    xNewRequest = true;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t OtaWindow_GetBlocks( void )
+{
+    if( xNewRequest == true )
+    {
+        /* The round a block was dropped from never completes, and the agent
+         * asks again once it times out, before the next block shows; the drop
+         * is acted on here so that request is already smaller. */
+        prvCheckDrops();
+
+        ulRequestBlocks = ulWindow;
+        xNewRequest = false;
+    }
+
+    return ulRequestBlocks;
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaWindow_GetStats( OtaWindowStats_t * pxStats )
+{
+    uint32_t ulProcessed = 0UL;
+    uint32_t ulElapsedMs = 0UL;
+
+    if( pxStats != NULL )
+    {
+        ( void ) memset( pxStats, 0, sizeof( *pxStats ) );
+
+        pxStats->ulWindowBlocks = ulWindow;
+        pxStats->ulBlocks = ulBlocks;
+        pxStats->ulBytes = ulBytes;
+        pxStats->ulDropped = OTA_GetPacketsDropped() - ulDroppedAtStart;
+        pxStats->ulCuts = ulCuts;
+
+        /* Every packet the agent processed that did not end up in the file:
+         * blocks it already had, and the odd job document. */
+        ulProcessed = OTA_GetPacketsProcessed() - ulProcessedAtStart;
+
+        if( ulProcessed > ulBlocks )
+        {
+            pxStats->ulDuplicates = ulProcessed - ulBlocks;
+        }
+
+        ulElapsedMs = prvElapsedMs( xFileStart, xLastBlock );
+
+        if( ulElapsedMs > 0UL )
+        {
+            pxStats->ulBytesPerSecond = ( uint32_t ) ( ( ( uint64_t ) ulBytes * 1000ULL ) / ulElapsedMs );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t OTA_GetPacketsThroughput( void )
+{
+    OtaWindowStats_t xStats;
+
+    OtaWindow_GetStats( &xStats );
+
+    return xStats.ulBytesPerSecond;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t OTA_GetPacketsDuplicated( void )
+{
+    OtaWindowStats_t xStats;
+
+    OtaWindow_GetStats( &xStats );
+
+    return xStats.ulDuplicates;
+}
@@ -0,0 +1,949 @@
+/*
+ * publish_queue.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file publish_queue.c
+ *
+ * @brief Store-and-forward queue for QoS1 telemetry.
+ *
+ * Records live in one of three places, oldest first:
+ * 1. Segment files on the SimpleLink file system. A SimpleLink file that is
+ * opened for writing is rewritten as a whole, so each segment is written once
+ * with publishqueueconfigSPILL_BATCH records. It is deleted once every record
+ * in it was acknowledged, so a reset before that sends them again.
+ * 2. A RAM ring holding the most recent records.
+ * 3. The in-flight slots, holding records sent and waiting for a PUBACK.
+ * Their records are borrowed from the shared buffer pool.
+ *
+ * Only the in-flight slots are handed to the MQTT helpers, so their memory
+ * stays valid until the broker acknowledges them. A clean session discards the
+ * helper's outgoing window; those records are sent again on the next drain.
+ *
+ * The mutex is not held while a record is sent, so producers are not held up
+ * by the network. The slot is marked as sending meanwhile. Drain and the
+ * process loop that delivers PUBACKs run on the task owning the connection, so
+ * a PUBACK is never handled before the slot has its packet identifier.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Publish queue configuration. */
+#include "publish_queue_config.h"
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* SimpleLink file system. */
+#include <ti/drivers/net/wifi/simplelink.h>
+
+/* MQTT helpers. */
+#include "mqtt_demo_helpers.h"
+
+/* Shared buffer pool. */
+#include "buffer_pool.h"
+
+#include "publish_queue.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Magic number at the start of every segment file.
+ */
+#define publishqueueSEGMENT_MAGIC               ( 0x50425131UL ) /* "PBQ1" */
+
+/**
+ * @brief Process loop timeout used while flushing.
+ */
+#define publishqueuePROCESS_LOOP_TIMEOUT_MS     ( 100U )
+
+/**
+ * @brief The drain rate limiter counts in thousandths of a message.
+ */
+#define publishqueueTOKEN_SCALE                 ( 1000UL )
+
+/**
+ * @brief Longest segment file name, including the index and terminator.
+ */
+#define publishqueueMAX_FILE_NAME_LENGTH        ( 32U )
+
+#if ( publishqueueconfigSPILL_BATCH > publishqueueconfigRAM_RECORDS )
+    #error "publishqueueconfigSPILL_BATCH must not exceed publishqueueconfigRAM_RECORDS."
+#endif
+
+#if ( publishqueueconfigMAX_IN_FLIGHT >= democonfigMAX_OUTGOING_PUBLISHES )
+    #error "publishqueueconfigMAX_IN_FLIGHT must leave room in the outgoing publish window."
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief One queued message. The same layout is used in RAM and in flash.
+ */
+typedef struct PublishRecord
+{
+    uint16_t usTopicLength;
+    uint16_t usPayloadLength;
+    char cTopic[ publishqueueconfigMAX_TOPIC_LENGTH ];
+    char cPayload[ publishqueueconfigMAX_PAYLOAD_LENGTH ];
+} PublishRecord_t;
+
+/**
+ * @brief A record handed to the MQTT helpers.
+ */
+typedef struct InFlightSlot
+{
+    PublishRecord_t * pxRecord;
+
+    /**
+     * @brief Packet identifier of the PUBLISH, or MQTT_PACKET_ID_INVALID if
+     * the record still has to be (re)sent.
+     */
+    uint16_t usPacketId;
+    bool xUsed;
+    bool xSending;           /**< @brief Being sent by a drain, without the mutex. */
+    bool xFromSegment;       /**< @brief Read from the segment ulSequence. */
+    uint32_t ulSequence;
+} InFlightSlot_t;
+
+/**
+ * @brief Header written at the start of every segment file.
+ */
+typedef struct SegmentHeader
+{
+    uint32_t ulMagic;
+    uint32_t ulSequence;
+    uint16_t usCount;
+    uint16_t usRecordSize;
+} SegmentHeader_t;
+
+/**
+ * @brief RAM view of a segment file.
+ */
+typedef struct Segment
+{
+    uint32_t ulSequence;
+    uint16_t usCount;
+
+    /**
+     * @brief Index of the next record to drain from this segment.
+     */
+    uint16_t usReadIndex;
+
+    /**
+     * @brief Records acknowledged or lost to a read error. The file is kept
+     * until this reaches usCount.
+     */
+    uint16_t usDone;
+} Segment_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Guards every piece of queue state below.
+ */
+static SemaphoreHandle_t xQueueMutex = NULL;
+static StaticSemaphore_t xQueueMutexBuffer;
+
+/**
+ * @brief Ring of the most recent records.
+ */
+static PublishRecord_t xRamRecords[ publishqueueconfigRAM_RECORDS ];
+static uint8_t ucRamHead = 0U;
+static uint8_t ucRamCount = 0U;
+
+/**
+ * @brief Ring of segment files. The segment at ucSegmentHead is the oldest.
+ */
+static Segment_t xSegments[ publishqueueconfigFLASH_SEGMENTS ];
+static uint8_t ucSegmentHead = 0U;
+static uint8_t ucSegmentCount = 0U;
+static uint32_t ulNextSequence = 0UL;
+
+/**
+ * @brief Records waiting for a PUBACK.
+ */
+static InFlightSlot_t xInFlight[ publishqueueconfigMAX_IN_FLIGHT ];
+
+/**
+ * @brief Drain rate limiter state.
+ */
+static uint32_t ulTokens = publishqueueconfigDRAIN_BURST * publishqueueTOKEN_SCALE;
+static TickType_t xLastRefill = 0U;
+
+/**
+ * @brief Accounting for the drain in progress.
+ */
+static bool xDraining = false;
+static TickType_t xDrainStart = 0U;
+static uint32_t ulDrainMessages = 0UL;
+static uint32_t ulDrainBytes = 0UL;
+
+static PublishQueueStats_t xStats = { 0 };
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Build the file name of the segment at @p ucIndex.
+ */
+static void prvSegmentFileName( uint8_t ucIndex,
+                                char * pcName );
+
+/**
+ * @brief Delete the oldest segment file and forget it.
+ */
+static void prvReleaseOldestSegment( void );
+
+/**
+ * @brief Write the oldest publishqueueconfigSPILL_BATCH RAM records to a new
+ * segment file. Discards the oldest segment first if the flash ring is full.
+ */
+static void prvSpillOldest( void );
+
+/**
+ * @brief Read record @p usIndex of the segment at @p ucSegment.
+ */
+static BaseType_t prvReadSegmentRecord( uint8_t ucSegment,
+                                        uint16_t usIndex,
+                                        PublishRecord_t * pxRecord );
+
+/**
+ * @brief Count one record of the segment @p ulSequence as done, and delete
+ * the segments at the head of the ring that are done.
+ */
+static void prvSegmentRecordDone( uint32_t ulSequence );
+
+/**
+ * @brief Move the oldest record, from flash or RAM, into the record of
+ * @p pxSlot, and note where it came from.
+ *
+ * @return pdPASS if a record was taken; pdFAIL if the queue is empty.
+ */
+static BaseType_t prvTakeOldest( InFlightSlot_t * pxSlot );
+
+/**
+ * @brief Rebuild the segment ring from the files left by a previous boot.
+ */
+static void prvRecoverSegments( void );
+
+/**
+ * @brief Add tokens to the rate limiter for the time since the last refill.
+ */
+static void prvRefillTokens( void );
+
+/**
+ * @brief Records not yet acknowledged. Must be called with the mutex held.
+ */
+static uint32_t prvGetDepth( void );
+
+/**
+ * @brief Told by the MQTT helpers when a publish is acknowledged or discarded.
+ */
+static void prvOnPublishAck( uint16_t usPacketIdentifier,
+                             bool xAcknowledged );
+
+/*-----------------------------------------------------------*/
+
+static void prvSegmentFileName( uint8_t ucIndex,
+                                char * pcName )
+{
+    ( void ) snprintf( pcName,
+                       publishqueueMAX_FILE_NAME_LENGTH,
+                       "%s%u",
+                       publishqueueconfigSEGMENT_FILE_PREFIX,
+                       ( unsigned ) ucIndex );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReleaseOldestSegment( void )
+{
+    char cName[ publishqueueMAX_FILE_NAME_LENGTH ];
+
+    assert( ucSegmentCount > 0U );
+
+    prvSegmentFileName( ucSegmentHead, cName );
+    ( void ) sl_FsDel( ( const unsigned char * ) cName, 0 );
+
+    ucSegmentHead = ( uint8_t ) ( ( ucSegmentHead + 1U ) % publishqueueconfigFLASH_SEGMENTS );
+    ucSegmentCount--;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSpillOldest( void )
+{
+    char cName[ publishqueueMAX_FILE_NAME_LENGTH ];
+    SegmentHeader_t xHeader;
+    Segment_t * pxSegment = NULL;
+    uint8_t ucIndex = 0U;
+    uint8_t ucRecord = 0U;
+    uint32_t ulFileSize = sizeof( SegmentHeader_t ) +
+                          ( publishqueueconfigSPILL_BATCH * sizeof( PublishRecord_t ) );
+    uint32_t ulOffset = 0UL;
+    int32_t lFile = -1;
+    int32_t lResult = 0;
+
+    if( ucSegmentCount == publishqueueconfigFLASH_SEGMENTS )
+    {
+        pxSegment = &xSegments[ ucSegmentHead ];
+        xStats.ulDroppedOverflow += ( uint32_t ) ( pxSegment->usCount - pxSegment->usReadIndex );
+        LogWarn( ( "Flash ring full, dropping %u queued records.",
+                   ( unsigned ) ( pxSegment->usCount - pxSegment->usReadIndex ) ) );
+        prvReleaseOldestSegment();
+    }
+
+    ucIndex = ( uint8_t ) ( ( ucSegmentHead + ucSegmentCount ) % publishqueueconfigFLASH_SEGMENTS );
+    prvSegmentFileName( ucIndex, cName );
+
+    xHeader.ulMagic = publishqueueSEGMENT_MAGIC;
+    xHeader.ulSequence = ulNextSequence;
+    xHeader.usCount = publishqueueconfigSPILL_BATCH;
+    xHeader.usRecordSize = sizeof( PublishRecord_t );
+
+    lFile = sl_FsOpen( ( const unsigned char * ) cName,
+                       SL_FS_CREATE | SL_FS_CREATE_NOSIGNATURE |
+                       SL_FS_OVERWRITE | SL_FS_CREATE_MAX_SIZE( ulFileSize ),
+                       NULL );
+
+    if( lFile >= 0 )
+    {
+        lResult = sl_FsWrite( lFile, ulOffset, ( unsigned char * ) &xHeader, sizeof( xHeader ) );
+        ulOffset += sizeof( xHeader );
+
+        for( ucRecord = 0U; ( ucRecord < publishqueueconfigSPILL_BATCH ) && ( lResult >= 0 ); ucRecord++ )
+        {
+            lResult = sl_FsWrite( lFile,
+                                  ulOffset,
+                                  ( unsigned char * ) &xRamRecords[ ( ucRamHead + ucRecord ) % publishqueueconfigRAM_RECORDS ],
+                                  sizeof( PublishRecord_t ) );
+            ulOffset += sizeof( PublishRecord_t );
+        }
+
+        if( sl_FsClose( lFile, NULL, NULL, 0 ) < 0 )
+        {
+            lResult = -1;
+        }
+    }
+    else
+    {
+        lResult = lFile;
+    }
+
+    if( lResult >= 0 )
+    {
+        pxSegment = &xSegments[ ucIndex ];
+        pxSegment->ulSequence = ulNextSequence++;
+        pxSegment->usCount = publishqueueconfigSPILL_BATCH;
+        pxSegment->usReadIndex = 0U;
+        pxSegment->usDone = 0U;
+        ucSegmentCount++;
+        xStats.ulSpilled += publishqueueconfigSPILL_BATCH;
+    }
+    else
+    {
+        LogError( ( "Failed to spill %u records to %s, error %d.",
+                    ( unsigned ) publishqueueconfigSPILL_BATCH,
+                    cName,
+                    ( int ) lResult ) );
+        ( void ) sl_FsDel( ( const unsigned char * ) cName, 0 );
+        xStats.ulDroppedFlashError += publishqueueconfigSPILL_BATCH;
+    }
+
+    /* The RAM records are released either way so new telemetry keeps flowing. */
+    ucRamHead = ( uint8_t ) ( ( ucRamHead + publishqueueconfigSPILL_BATCH ) % publishqueueconfigRAM_RECORDS );
+    ucRamCount -= publishqueueconfigSPILL_BATCH;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvReadSegmentRecord( uint8_t ucSegment,
+                                        uint16_t usIndex,
+                                        PublishRecord_t * pxRecord )
+{
+    char cName[ publishqueueMAX_FILE_NAME_LENGTH ];
+    BaseType_t xReturnStatus = pdFAIL;
+    int32_t lFile = -1;
+    int32_t lRead = 0;
+
+    prvSegmentFileName( ucSegment, cName );
+    lFile = sl_FsOpen( ( const unsigned char * ) cName, SL_FS_READ, NULL );
+
+    if( lFile >= 0 )
+    {
+        lRead = sl_FsRead( lFile,
+                           sizeof( SegmentHeader_t ) + ( ( uint32_t ) usIndex * sizeof( PublishRecord_t ) ),
+                           ( unsigned char * ) pxRecord,
+                           sizeof( PublishRecord_t ) );
+        ( void ) sl_FsClose( lFile, NULL, NULL, 0 );
+
+        if( ( lRead == ( int32_t ) sizeof( PublishRecord_t ) ) &&
+            ( pxRecord->usTopicLength > 0U ) &&
+            ( pxRecord->usTopicLength <= publishqueueconfigMAX_TOPIC_LENGTH ) &&
+            ( pxRecord->usPayloadLength <= publishqueueconfigMAX_PAYLOAD_LENGTH ) )
+        {
+            xReturnStatus = pdPASS;
+        }
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSegmentRecordDone( uint32_t ulSequence )
+{
+    Segment_t * pxSegment = NULL;
+    uint8_t ucIndex = 0U;
+
+    /* A segment dropped because the ring was full is no longer found. */
+    for( ucIndex = 0U; ucIndex < ucSegmentCount; ucIndex++ )
+    {
+        pxSegment = &xSegments[ ( ucSegmentHead + ucIndex ) % publishqueueconfigFLASH_SEGMENTS ];
+
+        if( pxSegment->ulSequence == ulSequence )
+        {
+            pxSegment->usDone++;
+            break;
+        }
+    }
+
+    /* Records are acknowledged out of order, so a later segment may be done
+     * first; it is deleted once those before it are. */
+    while( ( ucSegmentCount > 0U ) &&
+           ( xSegments[ ucSegmentHead ].usDone >= xSegments[ ucSegmentHead ].usCount ) )
+    {
+        prvReleaseOldestSegment();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvTakeOldest( InFlightSlot_t * pxSlot )
+{
+    BaseType_t xReturnStatus = pdFAIL;
+    Segment_t * pxSegment = NULL;
+    uint8_t ucIndex = 0U;
+    uint8_t ucSegment = 0U;
+
+    /* Segments read in full stay in the ring until acknowledged. */
+    while( ( xReturnStatus == pdFAIL ) && ( ucIndex < ucSegmentCount ) )
+    {
+        ucSegment = ( uint8_t ) ( ( ucSegmentHead + ucIndex ) % publishqueueconfigFLASH_SEGMENTS );
+        pxSegment = &xSegments[ ucSegment ];
+
+        if( pxSegment->usReadIndex >= pxSegment->usCount )
+        {
+            ucIndex++;
+        }
+        else
+        {
+            xReturnStatus = prvReadSegmentRecord( ucSegment, pxSegment->usReadIndex, pxSlot->pxRecord );
+            pxSegment->usReadIndex++;
+
+            if( xReturnStatus == pdPASS )
+            {
+                pxSlot->xFromSegment = true;
+                pxSlot->ulSequence = pxSegment->ulSequence;
+            }
+            else
+            {
+                /* Segments at the head may be deleted, so look again from it. */
+                xStats.ulDroppedFlashError++;
+                prvSegmentRecordDone( pxSegment->ulSequence );
+                ucIndex = 0U;
+            }
+        }
+    }
+
+    if( ( xReturnStatus == pdFAIL ) && ( ucRamCount > 0U ) )
+    {
+        ( void ) memcpy( pxSlot->pxRecord, &xRamRecords[ ucRamHead ], sizeof( PublishRecord_t ) );
+        ucRamHead = ( uint8_t ) ( ( ucRamHead + 1U ) % publishqueueconfigRAM_RECORDS );
+        ucRamCount--;
+        pxSlot->xFromSegment = false;
+        xReturnStatus = pdPASS;
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRecoverSegments( void )
+{
+    char cName[ publishqueueMAX_FILE_NAME_LENGTH ];
+    SegmentHeader_t xHeader;
+    bool xValid[ publishqueueconfigFLASH_SEGMENTS ] = { false };
+    uint8_t ucIndex = 0U;
+    uint8_t ucOldest = 0U;
+    bool xFound = false;
+    int32_t lFile = -1;
+    int32_t lRead = 0;
+
+    for( ucIndex = 0U; ucIndex < publishqueueconfigFLASH_SEGMENTS; ucIndex++ )
+    {
+        prvSegmentFileName( ucIndex, cName );
+        lFile = sl_FsOpen( ( const unsigned char * ) cName, SL_FS_READ, NULL );
+
+        if( lFile < 0 )
+        {
+            continue;
+        }
+
+        lRead = sl_FsRead( lFile, 0, ( unsigned char * ) &xHeader, sizeof( xHeader ) );
+        ( void ) sl_FsClose( lFile, NULL, NULL, 0 );
+
+        if( ( lRead == ( int32_t ) sizeof( xHeader ) ) &&
+            ( xHeader.ulMagic == publishqueueSEGMENT_MAGIC ) &&
+            ( xHeader.usRecordSize == sizeof( PublishRecord_t ) ) &&
+            ( xHeader.usCount > 0U ) &&
+            ( xHeader.usCount <= publishqueueconfigSPILL_BATCH ) )
+        {
+            xValid[ ucIndex ] = true;
+            xSegments[ ucIndex ].ulSequence = xHeader.ulSequence;
+            xSegments[ ucIndex ].usCount = xHeader.usCount;
+            xSegments[ ucIndex ].usReadIndex = 0U;
+            xSegments[ ucIndex ].usDone = 0U;
+
+            if( ( xFound == false ) ||
+                ( ( int32_t ) ( xHeader.ulSequence - xSegments[ ucOldest ].ulSequence ) < 0 ) )
+            {
+                ucOldest = ucIndex;
+            }
+
+            xFound = true;
+        }
+        else
+        {
+            /* Left over from an interrupted spill or from an older layout. */
+            ( void ) sl_FsDel( ( const unsigned char * ) cName, 0 );
+        }
+    }
+
+    if( xFound == true )
+    {
+        /* Segments are written at the tail of the ring, so the valid ones form
+         * a contiguous run of increasing sequence numbers from the oldest. */
+        ucSegmentHead = ucOldest;
+        ulNextSequence = xSegments[ ucOldest ].ulSequence;
+
+        for( ucIndex = 0U; ucIndex < publishqueueconfigFLASH_SEGMENTS; ucIndex++ )
+        {
+            uint8_t ucSlot = ( uint8_t ) ( ( ucOldest + ucIndex ) % publishqueueconfigFLASH_SEGMENTS );
+
+            if( ( xValid[ ucSlot ] == false ) || ( xSegments[ ucSlot ].ulSequence != ulNextSequence ) )
+            {
+                break;
+            }
+
+            ulNextSequence++;
+            ucSegmentCount++;
+        }
+
+        /* Anything outside the run cannot be ordered, so it is discarded. */
+        for( ; ucIndex < publishqueueconfigFLASH_SEGMENTS; ucIndex++ )
+        {
+            uint8_t ucSlot = ( uint8_t ) ( ( ucOldest + ucIndex ) % publishqueueconfigFLASH_SEGMENTS );
+
+            if( xValid[ ucSlot ] == true )
+            {
+                prvSegmentFileName( ucSlot, cName );
+                ( void ) sl_FsDel( ( const unsigned char * ) cName, 0 );
+                xStats.ulDroppedFlashError += xSegments[ ucSlot ].usCount;
+            }
+        }
+
+        LogInfo( ( "Recovered %u queued segments from flash.", ( unsigned ) ucSegmentCount ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRefillTokens( void )
+{
+    TickType_t xNow = xTaskGetTickCount();
+    uint32_t ulElapsedMs = ( uint32_t ) ( xNow - xLastRefill ) * portTICK_PERIOD_MS;
+    uint32_t ulMaxTokens = publishqueueconfigDRAIN_BURST * publishqueueTOKEN_SCALE;
+
+    xLastRefill = xNow;
+
+    /* Rate is per second and tokens are thousandths, so one token per ms per
+     * message/s. Clamp before multiplying to keep the product in range. */
+    if( ulElapsedMs >= ( ulMaxTokens / publishqueueconfigDRAIN_RATE_PER_SECOND ) )
+    {
+        ulTokens = ulMaxTokens;
+    }
+    else
+    {
+        ulTokens += ulElapsedMs * publishqueueconfigDRAIN_RATE_PER_SECOND;
+
+        if( ulTokens > ulMaxTokens )
+        {
+            ulTokens = ulMaxTokens;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvGetDepth( void )
+{
+    uint32_t ulDepth = ucRamCount;
+    uint8_t ucIndex = 0U;
+
+    for( ucIndex = 0U; ucIndex < ucSegmentCount; ucIndex++ )
+    {
+        Segment_t * pxSegment = &xSegments[ ( ucSegmentHead + ucIndex ) % publishqueueconfigFLASH_SEGMENTS ];
+        ulDepth += ( uint32_t ) ( pxSegment->usCount - pxSegment->usReadIndex );
+    }
+
+    for( ucIndex = 0U; ucIndex < publishqueueconfigMAX_IN_FLIGHT; ucIndex++ )
+    {
+        if( xInFlight[ ucIndex ].xUsed == true )
+        {
+            ulDepth++;
+        }
+    }
+
+    return ulDepth;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvOnPublishAck( uint16_t usPacketIdentifier,
+                             bool xAcknowledged )
+{
+    uint8_t ucIndex = 0U;
+    uint32_t ulElapsedMs = 0UL;
+
+    ( void ) xSemaphoreTake( xQueueMutex, portMAX_DELAY );
+
+    for( ucIndex = 0U; ucIndex < publishqueueconfigMAX_IN_FLIGHT; ucIndex++ )
+    {
+        if( ( xInFlight[ ucIndex ].xUsed == true ) &&
+            ( xInFlight[ ucIndex ].usPacketId == usPacketIdentifier ) )
+        {
+            break;
+        }
+    }
+
+    /* Publishes that did not come from the queue are not ours to track. */
+    if( ucIndex < publishqueueconfigMAX_IN_FLIGHT )
+    {
+        if( xAcknowledged == true )
+        {
+            ulDrainMessages++;
+            ulDrainBytes += xInFlight[ ucIndex ].pxRecord->usPayloadLength;
+            xStats.ulPublished++;
+
+            if( xInFlight[ ucIndex ].xFromSegment == true )
+            {
+                prvSegmentRecordDone( xInFlight[ ucIndex ].ulSequence );
+            }
+
+            BufferPool_Release( xInFlight[ ucIndex ].pxRecord );
+            xInFlight[ ucIndex ].pxRecord = NULL;
+            xInFlight[ ucIndex ].xUsed = false;
+            xInFlight[ ucIndex ].usPacketId = MQTT_PACKET_ID_INVALID;
+
+            if( ( xDraining == true ) && ( prvGetDepth() == 0UL ) )
+            {
+                ulElapsedMs = ( uint32_t ) ( xTaskGetTickCount() - xDrainStart ) * portTICK_PERIOD_MS;
+
+                if( ulElapsedMs == 0UL )
+                {
+                    ulElapsedMs = 1UL;
+                }
+
+                xStats.ulDrainMessagesPerSecond = ( ulDrainMessages * 1000UL ) / ulElapsedMs;
+                xStats.ulDrainBytesPerSecond = ( uint32_t ) ( ( ( uint64_t ) ulDrainBytes * 1000ULL ) / ulElapsedMs );
+                xDraining = false;
+
+                LogInfo( ( "Publish queue drained: %lu messages, %lu bytes in %lu ms "
+                           "(%lu msg/s, %lu B/s).",
+                           ( unsigned long ) ulDrainMessages,
+                           ( unsigned long ) ulDrainBytes,
+                           ( unsigned long ) ulElapsedMs,
+                           ( unsigned long ) xStats.ulDrainMessagesPerSecond,
+                           ( unsigned long ) xStats.ulDrainBytesPerSecond ) );
+            }
+        }
+        else
+        {
+            /* The session was discarded; send the record again. */
+            xInFlight[ ucIndex ].usPacketId = MQTT_PACKET_ID_INVALID;
+        }
+    }
+
+    ( void ) xSemaphoreGive( xQueueMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t PublishQueue_Init( void )
+{
+    BaseType_t xReturnStatus = pdPASS;
+
+    if( xQueueMutex == NULL )
+    {
+        xQueueMutex = xSemaphoreCreateMutexStatic( &xQueueMutexBuffer );
+
+        prvRecoverSegments();
+        xLastRefill = xTaskGetTickCount();
+
+        SetPublishAckCallback( prvOnPublishAck );
+    }
+
+    if( xQueueMutex == NULL )
+    {
+        LogError( ( "Failed to create the publish queue mutex." ) );
+        xReturnStatus = pdFAIL;
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t PublishQueue_Enqueue( const char * pcTopic,
+                                 uint16_t usTopicLength,
+                                 const char * pcPayload,
+                                 size_t xPayloadLength )
+{
+    BaseType_t xReturnStatus = pdFAIL;
+    PublishRecord_t * pxRecord = NULL;
+
+    assert( xQueueMutex != NULL );
+    assert( pcTopic != NULL );
+
+    ( void ) xSemaphoreTake( xQueueMutex, portMAX_DELAY );
+
+    if( ( usTopicLength == 0U ) ||
+        ( usTopicLength > publishqueueconfigMAX_TOPIC_LENGTH ) ||
+        ( xPayloadLength > publishqueueconfigMAX_PAYLOAD_LENGTH ) ||
+        ( ( xPayloadLength > 0U ) && ( pcPayload == NULL ) ) )
+    {
+        xStats.ulDroppedTooLarge++;
+        LogWarn( ( "Rejected publish to %.*s: topic %u or payload %u bytes too large.",
+                   ( int ) usTopicLength,
+                   pcTopic,
+                   ( unsigned ) usTopicLength,
+                   ( unsigned ) xPayloadLength ) );
+    }
+    else
+    {
+        if( ucRamCount == publishqueueconfigRAM_RECORDS )
+        {
+            prvSpillOldest();
+        }
+
+        pxRecord = &xRamRecords[ ( ucRamHead + ucRamCount ) % publishqueueconfigRAM_RECORDS ];
+        pxRecord->usTopicLength = usTopicLength;
+        pxRecord->usPayloadLength = ( uint16_t ) xPayloadLength;
+        ( void ) memcpy( pxRecord->cTopic, pcTopic, usTopicLength );
+
+        if( xPayloadLength > 0U )
+        {
+            ( void ) memcpy( pxRecord->cPayload, pcPayload, xPayloadLength );
+        }
+
+        ucRamCount++;
+        xStats.ulEnqueued++;
+        xReturnStatus = pdPASS;
+    }
+
+    ( void ) xSemaphoreGive( xQueueMutex );
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t PublishQueue_Drain( MQTTContext_t * pxMqttContext )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    InFlightSlot_t * pxSlot = NULL;
+    uint8_t ucIndex = 0U;
+    uint16_t usPacketId = MQTT_PACKET_ID_INVALID;
+
+    assert( xQueueMutex != NULL );
+    assert( pxMqttContext != NULL );
+
+    ( void ) xSemaphoreTake( xQueueMutex, portMAX_DELAY );
+
+    prvRefillTokens();
+
+    while( ( ulTokens >= publishqueueTOKEN_SCALE ) &&
+           ( GetFreeOutgoingPublishCount() > 0U ) )
+    {
+        pxSlot = NULL;
+
+        /* Records discarded with an old session go first to keep the order. */
+        for( ucIndex = 0U; ucIndex < publishqueueconfigMAX_IN_FLIGHT; ucIndex++ )
+        {
+            if( ( xInFlight[ ucIndex ].xUsed == true ) &&
+                ( xInFlight[ ucIndex ].xSending == false ) &&
+                ( xInFlight[ ucIndex ].usPacketId == MQTT_PACKET_ID_INVALID ) )
+            {
+                pxSlot = &xInFlight[ ucIndex ];
+                break;
+            }
+        }
+
+        if( pxSlot == NULL )
+        {
+            for( ucIndex = 0U; ucIndex < publishqueueconfigMAX_IN_FLIGHT; ucIndex++ )
+            {
+                if( xInFlight[ ucIndex ].xUsed == false )
+                {
+                    xInFlight[ ucIndex ].pxRecord = BufferPool_Acquire( sizeof( PublishRecord_t ) );
+
+                    if( xInFlight[ ucIndex ].pxRecord == NULL )
+                    {
+                        /* The pool is busy; try again on the next drain. */
+                    }
+                    else if( prvTakeOldest( &xInFlight[ ucIndex ] ) == pdPASS )
+                    {
+                        pxSlot = &xInFlight[ ucIndex ];
+                        pxSlot->xUsed = true;
+                        pxSlot->usPacketId = MQTT_PACKET_ID_INVALID;
+                    }
+                    else
+                    {
+                        BufferPool_Release( xInFlight[ ucIndex ].pxRecord );
+                        xInFlight[ ucIndex ].pxRecord = NULL;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        if( pxSlot == NULL )
+        {
+            /* Either empty or every slot is waiting for a PUBACK. */
+            break;
+        }
+
+        if( xDraining == false )
+        {
+            xDraining = true;
+            xDrainStart = xTaskGetTickCount();
+            ulDrainMessages = 0UL;
+            ulDrainBytes = 0UL;
+        }
+
+        /* The record is only read while it is sent, and the slot is not
+         * handed to anyone else meanwhile. */
+        pxSlot->xSending = true;
+        ulTokens -= publishqueueTOKEN_SCALE;
+        ( void ) xSemaphoreGive( xQueueMutex );
+
+        xReturnStatus = PublishToTopicNoWait( pxMqttContext,
+                                              pxSlot->pxRecord->cTopic,
+                                              pxSlot->pxRecord->usTopicLength,
+                                              pxSlot->pxRecord->cPayload,
+                                              pxSlot->pxRecord->usPayloadLength,
+                                              &usPacketId );
+
+        ( void ) xSemaphoreTake( xQueueMutex, portMAX_DELAY );
+        pxSlot->xSending = false;
+
+        if( xReturnStatus == pdFAIL )
+        {
+            /* The record stays in its slot and is retried on the next drain. */
+            ulTokens += publishqueueTOKEN_SCALE;
+            break;
+        }
+
+        pxSlot->usPacketId = usPacketId;
+    }
+
+    ( void ) xSemaphoreGive( xQueueMutex );
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t PublishQueue_Flush( MQTTContext_t * pxMqttContext,
+                               uint32_t ulTimeoutMs )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    TickType_t xStart = xTaskGetTickCount();
+
+    while( ( xReturnStatus == pdPASS ) &&
+           ( PublishQueue_GetDepth() > 0UL ) &&
+           ( ( ( uint32_t ) ( xTaskGetTickCount() - xStart ) * portTICK_PERIOD_MS ) < ulTimeoutMs ) )
+    {
+        xReturnStatus = PublishQueue_Drain( pxMqttContext );
+
+        if( xReturnStatus == pdPASS )
+        {
+            xReturnStatus = ProcessLoop( pxMqttContext, publishqueuePROCESS_LOOP_TIMEOUT_MS );
+        }
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t PublishQueue_GetDepth( void )
+{
+    uint32_t ulDepth = 0UL;
+
+    assert( xQueueMutex != NULL );
+
+    ( void ) xSemaphoreTake( xQueueMutex, portMAX_DELAY );
+    ulDepth = prvGetDepth();
+    ( void ) xSemaphoreGive( xQueueMutex );
+
+    return ulDepth;
+}
+
+/*-----------------------------------------------------------*/
+
+void PublishQueue_GetStats( PublishQueueStats_t * pxStats )
+{
+    uint8_t ucIndex = 0U;
+
+    assert( xQueueMutex != NULL );
+    assert( pxStats != NULL );
+
+    ( void ) xSemaphoreTake( xQueueMutex, portMAX_DELAY );
+
+    xStats.ulRamDepth = ucRamCount;
+    xStats.ulFlashDepth = 0UL;
+    xStats.ulInFlight = 0UL;
+
+    for( ucIndex = 0U; ucIndex < ucSegmentCount; ucIndex++ )
+    {
+        Segment_t * pxSegment = &xSegments[ ( ucSegmentHead + ucIndex ) % publishqueueconfigFLASH_SEGMENTS ];
+        xStats.ulFlashDepth += ( uint32_t ) ( pxSegment->usCount - pxSegment->usReadIndex );
+    }
+
+    for( ucIndex = 0U; ucIndex < publishqueueconfigMAX_IN_FLIGHT; ucIndex++ )
+    {
+        if( xInFlight[ ucIndex ].xUsed == true )
+        {
+            xStats.ulInFlight++;
+        }
+    }
+
+    ( void ) memcpy( pxStats, &xStats, sizeof( xStats ) );
+
+    ( void ) xSemaphoreGive( xQueueMutex );
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,541 @@
+/*
+ * reconnect.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file reconnect.c
+ *
+ * @brief Reconnect engine for the MQTT broker connection.
+ *
+ * Backoff follows decorrelated jitter: each delay is drawn uniformly from
+ * [base, 3 * previous delay] and capped, which spreads a fleet out faster
+ * than exponential backoff with full jitter while keeping single devices
+ * responsive.
+ *
+ * The transport is opened here rather than with SecureSocketsTransport_Connect
+ * so the phases can be timed: the address is resolved first, and the
+ * secure sockets port reports through securesocketsTCP_CONNECTED_HOOK when
+ * the TCP connection is up and the TLS handshake begins. The socket ends up
+ * in the transport parameters exactly as the transport would have left it,
+ * so sending, receiving and disconnecting are unchanged.
+ *
+ * Everything except Reconnect_OnTcpConnected runs in the task that owns the
+ * MQTT connection.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Reconnect configuration. */
+#include "reconnect_config.h"
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Secure sockets. */
+#include "iot_secure_sockets.h"
+
+/* Include PKCS11 helpers header. */
+#include "pkcs11_helpers.h"
+
+#include "reconnect.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Milliseconds per FreeRTOS tick.
+ */
+#define reconnectMS_PER_TICK    ( 1000U / configTICK_RATE_HZ )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Circuit breaker and timing of one phase.
+ */
+typedef struct PhaseState
+{
+    ReconnectPhaseStats_t xStats;
+    uint32_t ulConsecutiveFailures;
+    uint32_t ulCooldownMs;
+    TickType_t xOpenedAt;
+} PhaseState_t;
+
+/*-----------------------------------------------------------*/
+
+static PhaseState_t xPhases[ eReconnectPhaseMax ];
+
+static const char * const pcPhaseNames[ eReconnectPhaseMax ] = { "DNS", "TCP", "TLS", "CONNACK" };
+
+/**
+ * @brief Last address the broker resolved to, in network byte order.
+ */
+static uint32_t ulCachedAddress = 0UL;
+
+/**
+ * @brief Set from the first attempt after a connect until the next connect.
+ */
+static bool xInOutage = false;
+static TickType_t xOutageStart = 0;
+
+/**
+ * @brief Start of the current attempt, after its backoff delay.
+ */
+static TickType_t xAttemptStart = 0;
+
+/**
+ * @brief Delay before the previous attempt, the input to the next jitter.
+ */
+static uint32_t ulPreviousBackoffMs = 0UL;
+
+/**
+ * @brief Time CONNECT was sent.
+ */
+static TickType_t xConnackStart = 0;
+
+/**
+ * @brief Set by #Reconnect_OnTcpConnected while Reconnect_ConnectTransport
+ * is waiting in SOCKETS_Connect.
+ */
+static volatile bool xConnectInProgress = false;
+static volatile bool xTcpConnected = false;
+static volatile TickType_t xTcpConnectedAt = 0;
+
+static uint32_t ulRandomState = 0UL;
+
+static ReconnectStats_t xStats;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get a random number, from the PKCS #11 TRNG where it works.
+ */
+static uint32_t prvRandom( void );
+
+/**
+ * @brief Milliseconds until a phase's breaker lets an attempt through;
+ * 0 if it is closed or half-open.
+ */
+static uint32_t prvBreakerRemainingMs( ReconnectPhase_t ePhase );
+
+/**
+ * @brief Record the duration and outcome of a phase and update its breaker.
+ */
+static void prvPhaseDone( ReconnectPhase_t ePhase,
+                          TickType_t xStart,
+                          TickType_t xEnd,
+                          bool xSuccess );
+
+/**
+ * @brief Create a TLS socket with the options the transport would set.
+ */
+static Socket_t prvCreateSocket( const ServerInfo_t * pxServerInfo,
+                                 const SocketsConfig_t * pxSocketsConfig );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRandom( void )
+{
+    uint32_t ulRandom = 0UL;
+
+    if( xPkcs11GenerateRandomNumber( ( uint8_t * ) &ulRandom, sizeof( ulRandom ) ) != pdPASS )
+    {
+        /* Still spread the fleet out if the TRNG is unavailable. */
+        ulRandomState = ( ulRandomState * 1103515245UL ) + 12345UL + ( uint32_t ) xTaskGetTickCount();
+        ulRandom = ulRandomState;
+    }
+
+    return ulRandom;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvBreakerRemainingMs( ReconnectPhase_t ePhase )
+{
+    uint32_t ulRemainingMs = 0UL;
+    uint32_t ulElapsedMs = 0UL;
+
+    if( xPhases[ ePhase ].xStats.xBreakerOpen == pdTRUE )
+    {
+        ulElapsedMs = ( uint32_t ) ( xTaskGetTickCount() - xPhases[ ePhase ].xOpenedAt ) * reconnectMS_PER_TICK;
+
+        if( ulElapsedMs < xPhases[ ePhase ].ulCooldownMs )
+        {
+            ulRemainingMs = xPhases[ ePhase ].ulCooldownMs - ulElapsedMs;
+        }
+    }
+
+    return ulRemainingMs;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPhaseDone( ReconnectPhase_t ePhase,
+                          TickType_t xStart,
+                          TickType_t xEnd,
+                          bool xSuccess )
+{
+    PhaseState_t * pxPhase = &xPhases[ ePhase ];
+
+    pxPhase->xStats.ulAttempts++;
+    pxPhase->xStats.ulLastMs = ( uint32_t ) ( xEnd - xStart ) * reconnectMS_PER_TICK;
+    pxPhase->xStats.ulTotalMs += pxPhase->xStats.ulLastMs;
+
+    if( xSuccess == true )
+    {
+        pxPhase->ulConsecutiveFailures = 0UL;
+
+        if( pxPhase->xStats.xBreakerOpen == pdTRUE )
+        {
+            LogInfo( ( "%s breaker closed.", pcPhaseNames[ ePhase ] ) );
+            pxPhase->xStats.xBreakerOpen = pdFALSE;
+            pxPhase->ulCooldownMs = 0UL;
+        }
+    }
+    else
+    {
+        pxPhase->xStats.ulFailures++;
+        pxPhase->ulConsecutiveFailures++;
+
+        if( pxPhase->xStats.xBreakerOpen == pdTRUE )
+        {
+            /* The half-open trial failed; stay away for longer. */
+            pxPhase->ulCooldownMs *= 2UL;
+
+            if( pxPhase->ulCooldownMs > reconnectconfigBREAKER_MAX_COOLDOWN_MS )
+            {
+                pxPhase->ulCooldownMs = reconnectconfigBREAKER_MAX_COOLDOWN_MS;
+            }
+        }
+        else if( pxPhase->ulConsecutiveFailures >= reconnectconfigBREAKER_THRESHOLD )
+        {
+            pxPhase->xStats.xBreakerOpen = pdTRUE;
+            pxPhase->ulCooldownMs = reconnectconfigBREAKER_COOLDOWN_MS;
+        }
+        else
+        {
+            /* Below the threshold; ordinary backoff applies. */
+        }
+
+        if( pxPhase->xStats.xBreakerOpen == pdTRUE )
+        {
+            pxPhase->xOpenedAt = xEnd;
+            pxPhase->xStats.ulBreakerTrips++;
+            LogWarn( ( "%s breaker open for %lu s after %lu consecutive failures.",
+                       pcPhaseNames[ ePhase ],
+                       ( unsigned long ) ( pxPhase->ulCooldownMs / 1000UL ),
+                       ( unsigned long ) pxPhase->ulConsecutiveFailures ) );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static Socket_t prvCreateSocket( const ServerInfo_t * pxServerInfo,
+                                 const SocketsConfig_t * pxSocketsConfig )
+{
+    Socket_t xSocket = SOCKETS_INVALID_SOCKET;
+    int32_t lResult = SOCKETS_ERROR_NONE;
+
+    /* The CC3220 port does not implement the ALPN option. */
+    assert( pxSocketsConfig->pAlpnProtos == NULL );
+
+    xSocket = SOCKETS_Socket( SOCKETS_AF_INET, SOCKETS_SOCK_STREAM, SOCKETS_IPPROTO_TCP );
+
+    if( xSocket != SOCKETS_INVALID_SOCKET )
+    {
+        lResult = SOCKETS_SetSockOpt( xSocket,
+                                      0,
+                                      SOCKETS_SO_SNDTIMEO,
+                                      &pxSocketsConfig->sendTimeoutMs,
+                                      sizeof( pxSocketsConfig->sendTimeoutMs ) );
+
+        if( lResult == SOCKETS_ERROR_NONE )
+        {
+            lResult = SOCKETS_SetSockOpt( xSocket,
+                                          0,
+                                          SOCKETS_SO_RCVTIMEO,
+                                          &pxSocketsConfig->recvTimeoutMs,
+                                          sizeof( pxSocketsConfig->recvTimeoutMs ) );
+        }
+
+        if( ( lResult == SOCKETS_ERROR_NONE ) && ( pxSocketsConfig->enableTls == true ) )
+        {
+            lResult = SOCKETS_SetSockOpt( xSocket, 0, SOCKETS_SO_REQUIRE_TLS, NULL, 0 );
+
+            if( ( lResult == SOCKETS_ERROR_NONE ) && ( pxSocketsConfig->disableSni == false ) )
+            {
+                lResult = SOCKETS_SetSockOpt( xSocket,
+                                              0,
+                                              SOCKETS_SO_SERVER_NAME_INDICATION,
+                                              pxServerInfo->pHostName,
+                                              pxServerInfo->hostNameLength + 1U );
+            }
+
+            if( ( lResult == SOCKETS_ERROR_NONE ) && ( pxSocketsConfig->pRootCa != NULL ) )
+            {
+                lResult = SOCKETS_SetSockOpt( xSocket,
+                                              0,
+                                              SOCKETS_SO_TRUSTED_SERVER_CERTIFICATE,
+                                              pxSocketsConfig->pRootCa,
+                                              pxSocketsConfig->rootCaSize );
+            }
+        }
+
+        if( lResult != SOCKETS_ERROR_NONE )
+        {
+            LogError( ( "Failed to set socket option with error %ld.", ( long ) lResult ) );
+            ( void ) SOCKETS_Close( xSocket );
+            xSocket = SOCKETS_INVALID_SOCKET;
+        }
+    }
+
+    return xSocket;
+}
+
+/*-----------------------------------------------------------*/
+
+void Reconnect_WaitBeforeAttempt( void )
+{
+    uint32_t ulDelayMs = 0UL;
+    uint32_t ulUpperMs = 0UL;
+    uint32_t ulBreakerMs = 0UL;
+    uint32_t ulRemainingMs = 0UL;
+    ReconnectPhase_t ePhase = eReconnectPhaseDns;
+
+    if( xInOutage == false )
+    {
+        xInOutage = true;
+        xOutageStart = xTaskGetTickCount();
+        ulDelayMs = prvRandom() % ( reconnectconfigBACKOFF_BASE_MS + 1U );
+        ulPreviousBackoffMs = reconnectconfigBACKOFF_BASE_MS;
+    }
+    else
+    {
+        ulUpperMs = ulPreviousBackoffMs * 3UL;
+
+        if( ulUpperMs > reconnectconfigBACKOFF_MAX_MS )
+        {
+            ulUpperMs = reconnectconfigBACKOFF_MAX_MS;
+        }
+
+        ulDelayMs = reconnectconfigBACKOFF_BASE_MS +
+                    ( prvRandom() % ( ulUpperMs - reconnectconfigBACKOFF_BASE_MS + 1UL ) );
+        ulPreviousBackoffMs = ulDelayMs;
+    }
+
+    /* An attempt is pointless while a phase it cannot skip is blocked. DNS
+     * can be skipped once an address has been cached. */
+    for( ePhase = eReconnectPhaseDns; ePhase < eReconnectPhaseMax; ePhase++ )
+    {
+        if( ( ePhase == eReconnectPhaseDns ) && ( ulCachedAddress != 0UL ) )
+        {
+            continue;
+        }
+
+        ulRemainingMs = prvBreakerRemainingMs( ePhase );
+
+        if( ulRemainingMs > ulBreakerMs )
+        {
+            ulBreakerMs = ulRemainingMs;
+        }
+    }
+
+    if( ulBreakerMs > ulDelayMs )
+    {
+        LogInfo( ( "Open breaker delays the next attempt to %lu ms.", ( unsigned long ) ulBreakerMs ) );
+        ulDelayMs = ulBreakerMs;
+    }
+
+    xStats.ulLastBackoffMs = ulDelayMs;
+    xStats.ulAttempts++;
+
+    LogInfo( ( "Connection attempt %lu in %lu ms.",
+               ( unsigned long ) xStats.ulAttempts,
+               ( unsigned long ) ulDelayMs ) );
+
+    vTaskDelay( pdMS_TO_TICKS( ulDelayMs ) );
+
+    xAttemptStart = xTaskGetTickCount();
+}
+
+/*-----------------------------------------------------------*/
+
+TransportSocketStatus_t Reconnect_ConnectTransport( SecureSocketsTransportParams_t * pxParams,
+                                                    const ServerInfo_t * pxServerInfo,
+                                                    const SocketsConfig_t * pxSocketsConfig )
+{
+    TransportSocketStatus_t xStatus = TRANSPORT_SOCKET_STATUS_SUCCESS;
+    Socket_t xSocket = SOCKETS_INVALID_SOCKET;
+    SocketsSockaddr_t xAddress = { 0 };
+    uint32_t ulAddress = 0UL;
+    int32_t lResult = SOCKETS_ERROR_NONE;
+    TickType_t xStart = 0;
+    TickType_t xSetupTicks = 0;
+    TickType_t xEnd = 0;
+
+    assert( pxParams != NULL );
+    assert( pxServerInfo != NULL );
+    assert( pxSocketsConfig != NULL );
+
+    /* DNS. */
+    if( ( prvBreakerRemainingMs( eReconnectPhaseDns ) > 0UL ) && ( ulCachedAddress != 0UL ) )
+    {
+        ulAddress = ulCachedAddress;
+        xStats.ulDnsCacheHits++;
+        LogInfo( ( "DNS breaker open, using the cached broker address." ) );
+    }
+    else
+    {
+        xStart = xTaskGetTickCount();
+        ulAddress = SOCKETS_GetHostByName( pxServerInfo->pHostName );
+        prvPhaseDone( eReconnectPhaseDns, xStart, xTaskGetTickCount(), ( ulAddress != 0UL ) );
+
+        if( ulAddress != 0UL )
+        {
+            ulCachedAddress = ulAddress;
+        }
+        else if( ulCachedAddress != 0UL )
+        {
+            ulAddress = ulCachedAddress;
+            xStats.ulDnsCacheHits++;
+            LogWarn( ( "Failed to resolve %s, using the cached broker address.", pxServerInfo->pHostName ) );
+        }
+        else
+        {
+            LogError( ( "Failed to resolve %s.", pxServerInfo->pHostName ) );
+            xStatus = TRANSPORT_SOCKET_STATUS_DNS_FAILURE;
+        }
+    }
+
+    if( xStatus == TRANSPORT_SOCKET_STATUS_SUCCESS )
+    {
+        /* Setting up the socket is local work, but it belongs to the cost
+         * of TLS. */
+        xStart = xTaskGetTickCount();
+        xSocket = prvCreateSocket( pxServerInfo, pxSocketsConfig );
+        xSetupTicks = xTaskGetTickCount() - xStart;
+
+        if( xSocket == SOCKETS_INVALID_SOCKET )
+        {
+            xStatus = TRANSPORT_SOCKET_STATUS_INTERNAL_ERROR;
+        }
+    }
+
+    if( xStatus == TRANSPORT_SOCKET_STATUS_SUCCESS )
+    {
+        xAddress.ucLength = sizeof( SocketsSockaddr_t );
+        xAddress.ucSocketDomain = SOCKETS_AF_INET;
+        xAddress.usPort = SOCKETS_htons( pxServerInfo->port );
+        xAddress.ulAddress = ulAddress;
+
+        LogInfo( ( "Create a TCP connection to %s:%d.",
+                   pxServerInfo->pHostName,
+                   pxServerInfo->port ) );
+
+        xTcpConnected = false;
+        xConnectInProgress = true;
+        xStart = xTaskGetTickCount();
+        lResult = SOCKETS_Connect( xSocket, &xAddress, sizeof( xAddress ) );
+        xEnd = xTaskGetTickCount();
+        xConnectInProgress = false;
+
+        if( xTcpConnected == true )
+        {
+            prvPhaseDone( eReconnectPhaseTcp, xStart, xTcpConnectedAt, true );
+            prvPhaseDone( eReconnectPhaseTls, xTcpConnectedAt - xSetupTicks, xEnd, ( lResult == SOCKETS_ERROR_NONE ) );
+        }
+        else
+        {
+            prvPhaseDone( eReconnectPhaseTcp, xStart, xEnd, ( lResult == SOCKETS_ERROR_NONE ) );
+        }
+
+        if( lResult != SOCKETS_ERROR_NONE )
+        {
+            LogError( ( "Failed to connect to %s with error %ld.",
+                        pxServerInfo->pHostName,
+                        ( long ) lResult ) );
+            ( void ) SOCKETS_Close( xSocket );
+            xStatus = TRANSPORT_SOCKET_STATUS_CONNECT_FAILURE;
+        }
+        else
+        {
+            pxParams->tcpSocket = xSocket;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void Reconnect_OnTcpConnected( void )
+{
+    if( xConnectInProgress == true )
+    {
+        xTcpConnectedAt = xTaskGetTickCount();
+        xTcpConnected = true;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void Reconnect_OnConnackStart( void )
+{
+    xConnackStart = xTaskGetTickCount();
+}
+
+/*-----------------------------------------------------------*/
+
+void Reconnect_OnConnackResult( BaseType_t xSuccess )
+{
+    TickType_t xNow = xTaskGetTickCount();
+
+    prvPhaseDone( eReconnectPhaseConnack, xConnackStart, xNow, ( xSuccess == pdPASS ) );
+
+    if( xSuccess == pdPASS )
+    {
+        xStats.ulConnects++;
+        xStats.ulLastWarmUpMs = ( uint32_t ) ( xNow - xAttemptStart ) * reconnectMS_PER_TICK;
+        xStats.ulLastOutageMs = ( uint32_t ) ( xNow - xOutageStart ) * reconnectMS_PER_TICK;
+        xInOutage = false;
+
+        LogInfo( ( "Connected in %lu ms (DNS %lu, TCP %lu, TLS %lu, CONNACK %lu) after %lu ms.",
+                   ( unsigned long ) xStats.ulLastWarmUpMs,
+                   ( unsigned long ) xPhases[ eReconnectPhaseDns ].xStats.ulLastMs,
+                   ( unsigned long ) xPhases[ eReconnectPhaseTcp ].xStats.ulLastMs,
+                   ( unsigned long ) xPhases[ eReconnectPhaseTls ].xStats.ulLastMs,
+                   ( unsigned long ) xPhases[ eReconnectPhaseConnack ].xStats.ulLastMs,
+                   ( unsigned long ) xStats.ulLastOutageMs ) );
+
+        if( xStats.ulLastWarmUpMs > reconnectconfigWARM_UP_BUDGET_MS )
+        {
+            xStats.ulBudgetOverruns++;
+            LogWarn( ( "Connection warm-up exceeded its %u ms budget.",
+                       ( unsigned ) reconnectconfigWARM_UP_BUDGET_MS ) );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void Reconnect_GetStats( ReconnectStats_t * pxStats )
+{
+    ReconnectPhase_t ePhase = eReconnectPhaseDns;
+
+    assert( pxStats != NULL );
+
+    *pxStats = xStats;
+
+    for( ePhase = eReconnectPhaseDns; ePhase < eReconnectPhaseMax; ePhase++ )
+    {
+        pxStats->xPhases[ ePhase ] = xPhases[ ePhase ].xStats;
+    }
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,466 @@
+/*
+ * shadow_cache.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file shadow_cache.c
+ *
+ * @brief SimpleLink file holding the last accepted shadow state.
+ *
+ * The file is a header followed by one record per property: a 4 byte record
+ * header, the name, and the value, which is an int32_t for bool and int
+ * properties and the bytes of the string, without terminator, otherwise. A
+ * SimpleLink file opened for writing is rewritten as a whole, so the file is
+ * built in RAM and written with a single call.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Shadow state cache configuration. */
+#include "shadow_cache_config.h"
+
+/* SimpleLink file system. */
+#include <ti/drivers/net/wifi/simplelink.h>
+
+/* Shared buffer pool. */
+#include "buffer_pool.h"
+
+#include "shadow_cache.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Magic number at the start of the file.
+ */
+#define shadowcacheMAGIC                ( 0x53484331UL ) /* "SHC1" */
+
+/**
+ * @brief FNV-1a parameters, used for the checksum and the value hash.
+ */
+#define shadowcacheFNV_OFFSET_BASIS     ( 2166136261UL )
+#define shadowcacheFNV_PRIME            ( 16777619UL )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Start of the file.
+ */
+typedef struct ShadowCacheHeader
+{
+    uint32_t ulMagic;
+    uint32_t ulShadowVersion; /**< @brief Version the values were accepted at. */
+    uint32_t ulValuesHash;    /**< @brief Hash of the records, to skip saving unchanged values. */
+    uint32_t ulChecksum;      /**< @brief Hash of the records and the version. */
+    uint16_t usLength;        /**< @brief Bytes of records after the header. */
+    uint16_t usCount;         /**< @brief Number of records. */
+} ShadowCacheHeader_t;
+
+/**
+ * @brief Start of a property record.
+ */
+typedef struct ShadowCacheRecord
+{
+    uint8_t ucNameLength;
+    uint8_t ucType;         /**< @brief A #ShadowStateType_t. */
+    uint16_t usValueLength;
+} ShadowCacheRecord_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Continue an FNV-1a hash over @p xLength bytes.
+ */
+static uint32_t prvHash( uint32_t ulHash,
+                         const void * pvData,
+                         size_t xLength );
+
+/**
+ * @brief Write the records of every property after the header in
+ * @p pucBuffer and fill in the header.
+ *
+ * @return pdPASS; pdFAIL if the records do not fit in @p xBufferSize bytes.
+ */
+static BaseType_t prvBuildFile( const ShadowStateModel_t * pxModel,
+                                uint8_t * pucBuffer,
+                                size_t xBufferSize );
+
+/**
+ * @brief Read the header of the file, if there is a valid one.
+ */
+static BaseType_t prvReadHeader( const char * pcFileName,
+                                 ShadowCacheHeader_t * pxHeader );
+
+/**
+ * @brief Apply the value of one record to the property of the same name and
+ * type, if the model has one.
+ *
+ * @return Mask of the property restored; 0 if there is none.
+ */
+static uint32_t prvRestoreRecord( ShadowStateModel_t * pxModel,
+                                  const ShadowCacheRecord_t * pxRecord,
+                                  const uint8_t * pucName,
+                                  const uint8_t * pucValue );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHash( uint32_t ulHash,
+                         const void * pvData,
+                         size_t xLength )
+{
+    const uint8_t * pucData = ( const uint8_t * ) pvData;
+    size_t x = 0U;
+
+    for( x = 0U; x < xLength; x++ )
+    {
+        ulHash ^= pucData[ x ];
+        ulHash *= shadowcacheFNV_PRIME;
+    }
+
+    return ulHash;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvBuildFile( const ShadowStateModel_t * pxModel,
+                                uint8_t * pucBuffer,
+                                size_t xBufferSize )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    ShadowCacheHeader_t xHeader;
+    ShadowCacheRecord_t xRecord;
+    const ShadowStateProperty_t * pxProperty = NULL;
+    const void * pvValue = NULL;
+    size_t xOffset = sizeof( ShadowCacheHeader_t );
+    size_t x = 0U;
+
+    for( x = 0U; ( xReturnStatus == pdPASS ) && ( x < pxModel->xPropertyCount ); x++ )
+    {
+        pxProperty = &pxModel->pxProperties[ x ];
+
+        if( pxProperty->eType == eShadowStateString )
+        {
+            pvValue = pxProperty->pcString;
+            xRecord.usValueLength = ( uint16_t ) strlen( pxProperty->pcString );
+        }
+        else
+        {
+            pvValue = &pxProperty->lValue;
+            xRecord.usValueLength = sizeof( pxProperty->lValue );
+        }
+
+        xRecord.ucNameLength = ( uint8_t ) pxProperty->xNameLength;
+        xRecord.ucType = ( uint8_t ) pxProperty->eType;
+
+        if( ( pxProperty->xNameLength > UINT8_MAX ) ||
+            ( ( xBufferSize - xOffset ) < ( sizeof( xRecord ) + xRecord.ucNameLength + xRecord.usValueLength ) ) )
+        {
+            LogError( ( "Property %s does not fit in the cache file.", pxProperty->pcName ) );
+            xReturnStatus = pdFAIL;
+        }
+        else
+        {
+            ( void ) memcpy( &pucBuffer[ xOffset ], &xRecord, sizeof( xRecord ) );
+            xOffset += sizeof( xRecord );
+            ( void ) memcpy( &pucBuffer[ xOffset ], pxProperty->pcName, xRecord.ucNameLength );
+            xOffset += xRecord.ucNameLength;
+            ( void ) memcpy( &pucBuffer[ xOffset ], pvValue, xRecord.usValueLength );
+            xOffset += xRecord.usValueLength;
+        }
+    }
+
+    if( xReturnStatus == pdPASS )
+    {
+        xHeader.ulMagic = shadowcacheMAGIC;
+        xHeader.ulShadowVersion = pxModel->ulVersion;
+        xHeader.usLength = ( uint16_t ) ( xOffset - sizeof( ShadowCacheHeader_t ) );
+        xHeader.usCount = ( uint16_t ) pxModel->xPropertyCount;
+        xHeader.ulValuesHash = prvHash( shadowcacheFNV_OFFSET_BASIS,
+                                        &pucBuffer[ sizeof( ShadowCacheHeader_t ) ],
+                                        xHeader.usLength );
+        xHeader.ulChecksum = prvHash( xHeader.ulValuesHash,
+                                      &xHeader.ulShadowVersion,
+                                      sizeof( xHeader.ulShadowVersion ) );
+
+        ( void ) memcpy( pucBuffer, &xHeader, sizeof( xHeader ) );
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvReadHeader( const char * pcFileName,
+                                 ShadowCacheHeader_t * pxHeader )
+{
+    BaseType_t xReturnStatus = pdFAIL;
+    int32_t lFile = -1;
+    int32_t lRead = 0;
+
+    lFile = sl_FsOpen( ( const unsigned char * ) pcFileName, SL_FS_READ, NULL );
+
+    if( lFile >= 0 )
+    {
+        lRead = sl_FsRead( lFile, 0, ( unsigned char * ) pxHeader, sizeof( ShadowCacheHeader_t ) );
+        ( void ) sl_FsClose( lFile, NULL, NULL, 0 );
+
+        if( ( lRead == ( int32_t ) sizeof( ShadowCacheHeader_t ) ) &&
+            ( pxHeader->ulMagic == shadowcacheMAGIC ) &&
+            ( ( sizeof( ShadowCacheHeader_t ) + pxHeader->usLength ) <= shadowcacheconfigMAX_FILE_SIZE ) )
+        {
+            xReturnStatus = pdPASS;
+        }
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRestoreRecord( ShadowStateModel_t * pxModel,
+                                  const ShadowCacheRecord_t * pxRecord,
+                                  const uint8_t * pucName,
+                                  const uint8_t * pucValue )
+{
+    ShadowStateProperty_t * pxProperty = NULL;
+    uint32_t ulRestored = 0UL;
+    size_t x = 0U;
+
+    for( x = 0U; ( ulRestored == 0UL ) && ( x < pxModel->xPropertyCount ); x++ )
+    {
+        pxProperty = &pxModel->pxProperties[ x ];
+
+        if( ( pxProperty->xNameLength != pxRecord->ucNameLength ) ||
+            ( ( uint8_t ) pxProperty->eType != pxRecord->ucType ) ||
+            ( memcmp( pxProperty->pcName, pucName, pxRecord->ucNameLength ) != 0 ) )
+        {
+            /* Not this property. */
+        }
+        else if( pxProperty->eType == eShadowStateString )
+        {
+            /* A string that no longer fits the property is left out. */
+            if( pxRecord->usValueLength < pxProperty->xStringSize )
+            {
+                ( void ) memcpy( pxProperty->pcString, pucValue, pxRecord->usValueLength );
+                pxProperty->pcString[ pxRecord->usValueLength ] = '\0';
+                ulRestored = 1UL << x;
+            }
+        }
+        else if( pxRecord->usValueLength == sizeof( pxProperty->lValue ) )
+        {
+            ( void ) memcpy( &pxProperty->lValue, pucValue, sizeof( pxProperty->lValue ) );
+            ulRestored = 1UL << x;
+        }
+        else
+        {
+            /* Wrong size for a number. */
+        }
+    }
+
+    return ulRestored;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t ShadowCache_Load( ShadowStateModel_t * pxModel,
+                             const char * pcFileName )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    ShadowCacheHeader_t xHeader;
+    ShadowCacheRecord_t xRecord;
+    uint8_t * pucBuffer = NULL;
+    uint32_t ulRestored = 0UL;
+    uint32_t ulMask = 0UL;
+    uint16_t usRestoredCount = 0U;
+    size_t xOffset = 0U;
+    int32_t lFile = -1;
+    int32_t lRead = 0;
+    uint16_t x = 0U;
+
+    assert( pxModel != NULL );
+    assert( pcFileName != NULL );
+
+    xReturnStatus = prvReadHeader( pcFileName, &xHeader );
+
+    if( xReturnStatus == pdFAIL )
+    {
+        LogInfo( ( "No shadow state cached in %s.", pcFileName ) );
+    }
+    else
+    {
+        pucBuffer = BufferPool_Acquire( shadowcacheconfigMAX_FILE_SIZE );
+
+        if( pucBuffer == NULL )
+        {
+            LogError( ( "No buffer available to read %s.", pcFileName ) );
+            xReturnStatus = pdFAIL;
+        }
+    }
+
+    if( xReturnStatus == pdPASS )
+    {
+        lFile = sl_FsOpen( ( const unsigned char * ) pcFileName, SL_FS_READ, NULL );
+
+        if( lFile >= 0 )
+        {
+            lRead = sl_FsRead( lFile, sizeof( ShadowCacheHeader_t ), pucBuffer, xHeader.usLength );
+            ( void ) sl_FsClose( lFile, NULL, NULL, 0 );
+        }
+
+        if( ( lFile < 0 ) ||
+            ( lRead != ( int32_t ) xHeader.usLength ) ||
+            ( prvHash( prvHash( shadowcacheFNV_OFFSET_BASIS, pucBuffer, xHeader.usLength ),
+                       &xHeader.ulShadowVersion,
+                       sizeof( xHeader.ulShadowVersion ) ) != xHeader.ulChecksum ) )
+        {
+            LogWarn( ( "Cached shadow state in %s is damaged.", pcFileName ) );
+            xReturnStatus = pdFAIL;
+        }
+    }
+
+    /* The checksum matched, but the records are still bounds checked before
+     * anything is applied. */
+    for( x = 0U; ( xReturnStatus == pdPASS ) && ( x < xHeader.usCount ); x++ )
+    {
+        if( ( xHeader.usLength - xOffset ) < sizeof( xRecord ) )
+        {
+            xReturnStatus = pdFAIL;
+        }
+        else
+        {
+            ( void ) memcpy( &xRecord, &pucBuffer[ xOffset ], sizeof( xRecord ) );
+            xOffset += sizeof( xRecord );
+
+            if( ( xHeader.usLength - xOffset ) < ( ( size_t ) xRecord.ucNameLength + xRecord.usValueLength ) )
+            {
+                xReturnStatus = pdFAIL;
+            }
+        }
+
+        if( xReturnStatus == pdPASS )
+        {
+            ulMask = prvRestoreRecord( pxModel,
+                                       &xRecord,
+                                       &pucBuffer[ xOffset ],
+                                       &pucBuffer[ xOffset + xRecord.ucNameLength ] );
+
+            if( ulMask != 0UL )
+            {
+                ulRestored |= ulMask;
+                usRestoredCount++;
+            }
+
+            xOffset += ( size_t ) xRecord.ucNameLength + xRecord.usValueLength;
+        }
+        else
+        {
+            LogWarn( ( "Cached shadow state in %s is malformed.", pcFileName ) );
+        }
+    }
+
+    if( xReturnStatus == pdPASS )
+    {
+        /* The restored values are what the shadow last accepted. */
+        pxModel->ulDirty &= ~ulRestored;
+        pxModel->ulVersion = xHeader.ulShadowVersion;
+
+        LogInfo( ( "Restored %u of %u properties at shadow version %lu from %s.",
+                   ( unsigned ) usRestoredCount,
+                   ( unsigned ) pxModel->xPropertyCount,
+                   ( unsigned long ) xHeader.ulShadowVersion,
+                   pcFileName ) );
+    }
+
+    BufferPool_Release( pucBuffer );
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t ShadowCache_Save( const ShadowStateModel_t * pxModel,
+                             const char * pcFileName )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    ShadowCacheHeader_t xSaved;
+    ShadowCacheHeader_t xHeader;
+    uint8_t * pucBuffer = NULL;
+    size_t xFileSize = 0U;
+    int32_t lFile = -1;
+    int32_t lResult = 0;
+
+    assert( pxModel != NULL );
+    assert( pcFileName != NULL );
+
+    pucBuffer = BufferPool_Acquire( shadowcacheconfigMAX_FILE_SIZE );
+
+    if( pucBuffer == NULL )
+    {
+        LogError( ( "No buffer available to write %s.", pcFileName ) );
+        xReturnStatus = pdFAIL;
+    }
+    else
+    {
+        xReturnStatus = prvBuildFile( pxModel, pucBuffer, shadowcacheconfigMAX_FILE_SIZE );
+    }
+
+    if( xReturnStatus == pdPASS )
+    {
+        ( void ) memcpy( &xHeader, pucBuffer, sizeof( xHeader ) );
+        xFileSize = sizeof( xHeader ) + xHeader.usLength;
+
+        /* Flash is only worn when a value changed; the version alone is
+         * refreshed by the GET of the next session anyway. */
+        if( ( prvReadHeader( pcFileName, &xSaved ) == pdPASS ) &&
+            ( xSaved.ulValuesHash == xHeader.ulValuesHash ) &&
+            ( xSaved.usLength == xHeader.usLength ) )
+        {
+            LogDebug( ( "Cached shadow state in %s is current.", pcFileName ) );
+        }
+        else
+        {
+            lFile = sl_FsOpen( ( const unsigned char * ) pcFileName,
+                               SL_FS_CREATE | SL_FS_CREATE_NOSIGNATURE |
+                               SL_FS_OVERWRITE | SL_FS_CREATE_MAX_SIZE( shadowcacheconfigMAX_FILE_SIZE ),
+                               NULL );
+
+            if( lFile >= 0 )
+            {
+                lResult = sl_FsWrite( lFile, 0, pucBuffer, xFileSize );
+
+                if( sl_FsClose( lFile, NULL, NULL, 0 ) < 0 )
+                {
+                    lResult = -1;
+                }
+            }
+            else
+            {
+                lResult = lFile;
+            }
+
+            if( lResult == ( int32_t ) xFileSize )
+            {
+                LogInfo( ( "Cached shadow state version %lu in %s.",
+                           ( unsigned long ) pxModel->ulVersion,
+                           pcFileName ) );
+            }
+            else
+            {
+                LogError( ( "Failed to write %s, error %d.", pcFileName, ( int ) lResult ) );
+                ( void ) sl_FsDel( ( const unsigned char * ) pcFileName, 0 );
+                xReturnStatus = pdFAIL;
+            }
+        }
+    }
+
+    BufferPool_Release( pucBuffer );
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,1236 @@
+/*
+ * shadow_cbor.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file shadow_cbor.c
+ *
+ * @brief CBOR encoding of the reported and desired sections of a shadow.
+ *
+ * Sections are written and read with tinycbor, which the OTA agent links
+ * already. This file only maps them to and from the state model and JSON.
+ * A JSON object is converted in two passes: one that validates it and
+ * counts its members for the map head, and one that encodes them.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Shadow CBOR configuration. */
+#include "shadow_cbor_config.h"
+
+/* Shared buffer pool. */
+#include "buffer_pool.h"
+
+/* CBOR encoder and parser. */
+#include "cbor.h"
+
+#if ( shadowcborconfigBENCHMARK_ITERATIONS > 0U )
+    /* The benchmark compares against the JSON path and times with the cycle
+     * counter. */
+    #include "shadow_json.h"
+    #include "mqtt_metrics.h"
+#endif
+
+#include "shadow_cbor.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Largest magnitude of a positive integer that fits in an int32_t.
+ */
+#define shadowcborMAX_INT_MAGNITUDE    ( 0x7FFFFFFFUL )
+
+/**
+ * @brief Longest decimal rendering of a 32-bit value, with its sign.
+ */
+#define shadowcborMAX_NUMBER_LENGTH    ( 11U )
+
+/**
+ * @brief Length of the \\u00XX escape of a control character.
+ */
+#define shadowcborCONTROL_ESCAPE_LENGTH    ( 6U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Map a tinycbor error to the status of the codec.
+ */
+static ShadowCborStatus_t prvGetStatus( CborError xError );
+
+/**
+ * @brief Parse a section and enter its map.
+ *
+ * @param[out] pxSection Iterator over the section itself.
+ * @param[out] pxMember Iterator over the members of the map.
+ *
+ * @return true if the section is a map.
+ */
+static bool prvOpenSection( const uint8_t * pucSection,
+                            size_t xLength,
+                            CborParser * pxParser,
+                            CborValue * pxSection,
+                            CborValue * pxMember );
+
+/**
+ * @brief Leave the map of a section once every member was read.
+ *
+ * @return true if nothing follows the map.
+ */
+static bool prvCloseSection( const uint8_t * pucSection,
+                             size_t xLength,
+                             CborValue * pxSection,
+                             CborValue * pxMember );
+
+/**
+ * @brief Read one member of a section and move past it.
+ *
+ * @param[in,out] pxMember At the key of the member; left after its value.
+ * @param[out] pxKey The key.
+ * @param[out] pxValue The value.
+ *
+ * @return true if the member has a text key and an integer, text, true,
+ * false or null value.
+ */
+static bool prvGetMember( CborValue * pxMember,
+                          CborValue * pxKey,
+                          CborValue * pxValue );
+
+/**
+ * @brief Read the value of an integer item.
+ *
+ * @return true if the item is an integer that fits in an int32_t.
+ */
+static bool prvGetInt( const CborValue * pxValue,
+                       int32_t * plValue );
+
+/**
+ * @brief Apply one member to the property of the same name and type.
+ *
+ * @return The bit of the property the value was applied to; 0 if none.
+ */
+static uint32_t prvApplyMember( ShadowStateModel_t * pxModel,
+                                const CborValue * pxKey,
+                                const CborValue * pxValue );
+
+/**
+ * @brief Append bytes to the output.
+ *
+ * @return true if the bytes fit.
+ */
+static bool prvPutBytes( char * pcBuffer,
+                         size_t xBufferSize,
+                         size_t * pxOffset,
+                         const char * pcBytes,
+                         size_t xLength );
+
+/**
+ * @brief Append a text item as a JSON string, quotes included.
+ *
+ * @return true if the string fits.
+ */
+static bool prvPutJsonString( const CborValue * pxText,
+                              char * pcBuffer,
+                              size_t xBufferSize,
+                              size_t * pxOffset );
+
+/**
+ * @brief Advance past spaces, tabs, carriage returns and line feeds.
+ */
+static void prvSkipSpace( const char * pcSection,
+                          size_t xLength,
+                          size_t * pxIndex );
+
+/**
+ * @brief The character a JSON escape stands for.
+ *
+ * @return The character; '\0' for a \\u escape or an invalid one.
+ */
+static char prvUnescape( char cEscape );
+
+/**
+ * @brief Convert the JSON string at @p pxIndex to a CBOR text string.
+ *
+ * @param[in] pxMap Where to encode the string; NULL to only validate it.
+ *
+ * @return #eShadowCborSuccess with @p pxIndex just past the closing quote.
+ */
+static ShadowCborStatus_t prvConvertString( const char * pcSection,
+                                            size_t xLength,
+                                            size_t * pxIndex,
+                                            CborEncoder * pxMap );
+
+/**
+ * @brief Convert the JSON value at @p pxIndex: a string, an integer, true,
+ * false or null.
+ *
+ * @param[in] pxMap Where to encode the value; NULL to only validate it.
+ *
+ * @return #eShadowCborSuccess with @p pxIndex just past the value.
+ */
+static ShadowCborStatus_t prvConvertValue( const char * pcSection,
+                                           size_t xLength,
+                                           size_t * pxIndex,
+                                           CborEncoder * pxMap );
+
+/**
+ * @brief Convert the members of a JSON object into an open map.
+ *
+ * @param[in] pxMap Where to encode the members; NULL to only count them.
+ * @param[out] pulCount Number of members.
+ */
+static ShadowCborStatus_t prvConvertMembers( const char * pcSection,
+                                             size_t xLength,
+                                             CborEncoder * pxMap,
+                                             uint32_t * pulCount );
+
+/*-----------------------------------------------------------*/
+
+static ShadowCborStatus_t prvGetStatus( CborError xError )
+{
+    ShadowCborStatus_t xStatus = eShadowCborSuccess;
+
+    if( xError == CborNoError )
+    {
+        /* Done. */
+    }
+    else if( xError == CborErrorOutOfMemory )
+    {
+        /* The encoder ran out of buffer. */
+        xStatus = eShadowCborBufferTooSmall;
+    }
+    else
+    {
+        xStatus = eShadowCborIllegalDocument;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvOpenSection( const uint8_t * pucSection,
+                            size_t xLength,
+                            CborParser * pxParser,
+                            CborValue * pxSection,
+                            CborValue * pxMember )
+{
+    return ( cbor_parser_init( pucSection, xLength, 0, pxParser, pxSection ) == CborNoError ) &&
+           ( cbor_value_is_map( pxSection ) == true ) &&
+           ( cbor_value_enter_container( pxSection, pxMember ) == CborNoError );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvCloseSection( const uint8_t * pucSection,
+                             size_t xLength,
+                             CborValue * pxSection,
+                             CborValue * pxMember )
+{
+    return ( cbor_value_leave_container( pxSection, pxMember ) == CborNoError ) &&
+           ( cbor_value_get_next_byte( pxSection ) == &pucSection[ xLength ] );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvGetMember( CborValue * pxMember,
+                          CborValue * pxKey,
+                          CborValue * pxValue )
+{
+    bool xValid = false;
+
+    *pxKey = *pxMember;
+
+    if( ( cbor_value_is_text_string( pxKey ) == true ) &&
+        ( cbor_value_advance( pxMember ) == CborNoError ) )
+    {
+        /* Sections are flat, so a value is never a map or an array. Floats
+         * are not supported either. */
+        *pxValue = *pxMember;
+        xValid = ( ( cbor_value_is_integer( pxValue ) == true ) ||
+                   ( cbor_value_is_text_string( pxValue ) == true ) ||
+                   ( cbor_value_is_boolean( pxValue ) == true ) ||
+                   ( cbor_value_is_null( pxValue ) == true ) ) &&
+                 ( cbor_value_advance( pxMember ) == CborNoError );
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvGetInt( const CborValue * pxValue,
+                       int32_t * plValue )
+{
+    int64_t llValue = 0;
+    bool xValid = ( cbor_value_is_integer( pxValue ) == true ) &&
+                  ( cbor_value_get_int64_checked( pxValue, &llValue ) == CborNoError ) &&
+                  ( llValue >= INT32_MIN ) && ( llValue <= INT32_MAX );
+
+    if( xValid == true )
+    {
+        *plValue = ( int32_t ) llValue;
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvApplyMember( ShadowStateModel_t * pxModel,
+                                const CborValue * pxKey,
+                                const CborValue * pxValue )
+{
+    const ShadowStateProperty_t * pxProperty = NULL;
+    ShadowStateStatus_t xStatus = eShadowStateBadParameter;
+    char * pcString = NULL;
+    size_t xStringLength = 0U;
+    int32_t lValue = 0;
+    bool xBoolean = false;
+    bool xEqual = false;
+    size_t x = 0U;
+
+    for( x = 0U; x < pxModel->xPropertyCount; x++ )
+    {
+        pxProperty = &pxModel->pxProperties[ x ];
+
+        if( ( cbor_value_text_string_equals( pxKey, pxProperty->pcName, &xEqual ) == CborNoError ) &&
+            ( xEqual == true ) )
+        {
+            break;
+        }
+    }
+
+    if( x == pxModel->xPropertyCount )
+    {
+        /* Not a property of the model. */
+    }
+    else if( pxProperty->eType == eShadowStateBool )
+    {
+        if( ( cbor_value_is_boolean( pxValue ) == true ) &&
+            ( cbor_value_get_boolean( pxValue, &xBoolean ) == CborNoError ) )
+        {
+            xStatus = ShadowState_SetBool( pxModel, x, xBoolean );
+        }
+    }
+    else if( pxProperty->eType == eShadowStateInt )
+    {
+        if( prvGetInt( pxValue, &lValue ) == true )
+        {
+            xStatus = ShadowState_SetInt( pxModel, x, lValue );
+        }
+    }
+    else if( ( cbor_value_is_text_string( pxValue ) == true ) &&
+             ( cbor_value_calculate_string_length( pxValue, &xStringLength ) == CborNoError ) &&
+             ( xStringLength < pxProperty->xStringSize ) )
+    {
+        /* The setter takes a terminated string, which the section does not
+         * hold. tinycbor terminates the copy as there is room for it. */
+        pcString = BufferPool_Acquire( xStringLength + 1U );
+
+        if( pcString == NULL )
+        {
+            LogWarn( ( "No buffer to apply property \"%s\".", pxProperty->pcName ) );
+        }
+        else
+        {
+            xStringLength++;
+
+            if( cbor_value_copy_text_string( pxValue, pcString, &xStringLength, NULL ) == CborNoError )
+            {
+                xStatus = ShadowState_SetString( pxModel, x, pcString );
+            }
+
+            BufferPool_Release( pcString );
+        }
+    }
+    else
+    {
+        /* Wrong type, or too long for the property. */
+    }
+
+    return ( xStatus == eShadowStateSuccess ) ? ( 1UL << x ) : 0UL;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvPutBytes( char * pcBuffer,
+                         size_t xBufferSize,
+                         size_t * pxOffset,
+                         const char * pcBytes,
+                         size_t xLength )
+{
+    bool xFits = ( xLength <= ( xBufferSize - *pxOffset ) );
+
+    if( xFits == true )
+    {
+        ( void ) memcpy( &pcBuffer[ *pxOffset ], pcBytes, xLength );
+        *pxOffset += xLength;
+    }
+
+    return xFits;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvPutJsonString( const CborValue * pxText,
+                              char * pcBuffer,
+                              size_t xBufferSize,
+                              size_t * pxOffset )
+{
+    static const char cHex[] = "0123456789abcdef";
+    size_t xStart = *pxOffset + 1U;
+    size_t xLength = 0U;
+    size_t xEscapedLength = 0U;
+    size_t xOut = 0U;
+    size_t x = 0U;
+    uint8_t ucChar = 0U;
+    bool xFits = ( xStart < xBufferSize );
+
+    /* The text is copied after the opening quote and escaped in place from
+     * its end, which never overtakes what is still to be escaped. */
+    if( xFits == true )
+    {
+        xLength = xBufferSize - xStart;
+        xFits = ( cbor_value_copy_text_string( pxText, &pcBuffer[ xStart ], &xLength, NULL ) == CborNoError );
+    }
+
+    for( x = 0U; ( xFits == true ) && ( x < xLength ); x++ )
+    {
+        ucChar = ( uint8_t ) pcBuffer[ xStart + x ];
+
+        if( ( ucChar == ( uint8_t ) '"' ) || ( ucChar == ( uint8_t ) '\\' ) )
+        {
+            xEscapedLength += 2U;
+        }
+        else if( ucChar < 0x20U )
+        {
+            xEscapedLength += shadowcborCONTROL_ESCAPE_LENGTH;
+        }
+        else
+        {
+            xEscapedLength++;
+        }
+    }
+
+    /* The closing quote must fit as well. */
+    xFits = ( xFits == true ) && ( xEscapedLength < ( xBufferSize - xStart ) );
+
+    if( xFits == true )
+    {
+        xOut = xStart + xEscapedLength;
+        pcBuffer[ xStart - 1U ] = '"';
+        pcBuffer[ xOut ] = '"';
+
+        for( x = xLength; x > 0U; x-- )
+        {
+            ucChar = ( uint8_t ) pcBuffer[ xStart + x - 1U ];
+
+            if( ( ucChar == ( uint8_t ) '"' ) || ( ucChar == ( uint8_t ) '\\' ) )
+            {
+                xOut -= 2U;
+                pcBuffer[ xOut ] = '\\';
+                pcBuffer[ xOut + 1U ] = ( char ) ucChar;
+            }
+            else if( ucChar < 0x20U )
+            {
+                xOut -= shadowcborCONTROL_ESCAPE_LENGTH;
+                ( void ) memcpy( &pcBuffer[ xOut ], "\\u00", 4U );
+                pcBuffer[ xOut + 4U ] = cHex[ ucChar >> 4 ];
+                pcBuffer[ xOut + 5U ] = cHex[ ucChar & 0x0FU ];
+            }
+            else
+            {
+                xOut--;
+                pcBuffer[ xOut ] = ( char ) ucChar;
+            }
+        }
+
+        *pxOffset = xStart + xEscapedLength + 1U;
+    }
+
+    return xFits;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSkipSpace( const char * pcSection,
+                          size_t xLength,
+                          size_t * pxIndex )
+{
+    size_t i = *pxIndex;
+
+    while( ( i < xLength ) &&
+           ( ( pcSection[ i ] == ' ' ) || ( pcSection[ i ] == '\t' ) ||
+             ( pcSection[ i ] == '\r' ) || ( pcSection[ i ] == '\n' ) ) )
+    {
+        i++;
+    }
+
+    *pxIndex = i;
+}
+
+/*-----------------------------------------------------------*/
+
+static char prvUnescape( char cEscape )
+{
+    char c = '\0';
+
+    switch( cEscape )
+    {
+        case '"':
+        case '\\':
+        case '/':
+            c = cEscape;
+            break;
+
+        case 'b':
+            c = '\b';
+            break;
+
+        case 'f':
+            c = '\f';
+            break;
+
+        case 'n':
+            c = '\n';
+            break;
+
+        case 'r':
+            c = '\r';
+            break;
+
+        case 't':
+            c = '\t';
+            break;
+
+        default:
+            /* \u escapes are not supported. */
+            break;
+    }
+
+    return c;
+}
+
+/*-----------------------------------------------------------*/
+
+static ShadowCborStatus_t prvConvertString( const char * pcSection,
+                                            size_t xLength,
+                                            size_t * pxIndex,
+                                            CborEncoder * pxMap )
+{
+    ShadowCborStatus_t xStatus = eShadowCborSuccess;
+    size_t xStart = *pxIndex + 1U;
+    size_t xDecodedLength = 0U;
+    size_t i = xStart;
+    bool xEscaped = false;
+    char * pcDecoded = NULL;
+
+    /* Find the closing quote, checking the escapes on the way. */
+    while( ( xStatus == eShadowCborSuccess ) && ( i < xLength ) && ( pcSection[ i ] != '"' ) )
+    {
+        if( ( uint8_t ) pcSection[ i ] < 0x20U )
+        {
+            xStatus = eShadowCborIllegalDocument;
+        }
+        else if( pcSection[ i ] == '\\' )
+        {
+            xEscaped = true;
+            i++;
+
+            if( ( i >= xLength ) || ( prvUnescape( pcSection[ i ] ) == '\0' ) )
+            {
+                xStatus = eShadowCborIllegalDocument;
+            }
+        }
+        else
+        {
+            /* Copied as it is. */
+        }
+
+        i++;
+    }
+
+    if( ( xStatus == eShadowCborSuccess ) && ( i >= xLength ) )
+    {
+        xStatus = eShadowCborIllegalDocument;
+    }
+
+    if( ( xStatus != eShadowCborSuccess ) || ( pxMap == NULL ) )
+    {
+        /* Invalid, or only validated. */
+    }
+    else if( xEscaped == false )
+    {
+        xStatus = prvGetStatus( cbor_encode_text_string( pxMap, &pcSection[ xStart ], i - xStart ) );
+    }
+    else
+    {
+        /* tinycbor takes a string whole, so the escapes are resolved in a
+         * borrowed buffer first. */
+        pcDecoded = BufferPool_Acquire( i - xStart );
+
+        if( pcDecoded == NULL )
+        {
+            LogWarn( ( "No buffer to convert a string of %u bytes.", ( unsigned ) ( i - xStart ) ) );
+            xStatus = eShadowCborBufferTooSmall;
+        }
+        else
+        {
+            for( i = xStart; pcSection[ i ] != '"'; i++ )
+            {
+                if( pcSection[ i ] == '\\' )
+                {
+                    i++;
+                    pcDecoded[ xDecodedLength ] = prvUnescape( pcSection[ i ] );
+                }
+                else
+                {
+                    pcDecoded[ xDecodedLength ] = pcSection[ i ];
+                }
+
+                xDecodedLength++;
+            }
+
+            xStatus = prvGetStatus( cbor_encode_text_string( pxMap, pcDecoded, xDecodedLength ) );
+            BufferPool_Release( pcDecoded );
+        }
+    }
+
+    if( xStatus == eShadowCborSuccess )
+    {
+        *pxIndex = i + 1U;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static ShadowCborStatus_t prvConvertValue( const char * pcSection,
+                                           size_t xLength,
+                                           size_t * pxIndex,
+                                           CborEncoder * pxMap )
+{
+    ShadowCborStatus_t xStatus = eShadowCborSuccess;
+    CborError xError = CborNoError;
+    size_t i = *pxIndex;
+    size_t xRemaining = xLength - i;
+    uint32_t ulValue = 0UL;
+    uint32_t ulDigit = 0UL;
+    uint32_t ulLimit = shadowcborMAX_INT_MAGNITUDE;
+    bool xNegative = false;
+
+    if( xRemaining == 0U )
+    {
+        xStatus = eShadowCborIllegalDocument;
+    }
+    else if( pcSection[ i ] == '"' )
+    {
+        xStatus = prvConvertString( pcSection, xLength, &i, pxMap );
+    }
+    else if( ( xRemaining >= 4U ) && ( memcmp( &pcSection[ i ], "true", 4U ) == 0 ) )
+    {
+        xError = ( pxMap != NULL ) ? cbor_encode_boolean( pxMap, true ) : CborNoError;
+        i += 4U;
+    }
+    else if( ( xRemaining >= 5U ) && ( memcmp( &pcSection[ i ], "false", 5U ) == 0 ) )
+    {
+        xError = ( pxMap != NULL ) ? cbor_encode_boolean( pxMap, false ) : CborNoError;
+        i += 5U;
+    }
+    else if( ( xRemaining >= 4U ) && ( memcmp( &pcSection[ i ], "null", 4U ) == 0 ) )
+    {
+        xError = ( pxMap != NULL ) ? cbor_encode_null( pxMap ) : CborNoError;
+        i += 4U;
+    }
+    else
+    {
+        /* An integer; -2^31 is one further from 0 than 2^31 - 1. */
+        if( pcSection[ i ] == '-' )
+        {
+            xNegative = true;
+            ulLimit++;
+            i++;
+        }
+
+        xStatus = ( ( i < xLength ) && ( pcSection[ i ] >= '0' ) && ( pcSection[ i ] <= '9' ) ) ?
+                  eShadowCborSuccess : eShadowCborIllegalDocument;
+
+        while( ( xStatus == eShadowCborSuccess ) && ( i < xLength ) &&
+               ( pcSection[ i ] >= '0' ) && ( pcSection[ i ] <= '9' ) )
+        {
+            ulDigit = ( uint32_t ) ( pcSection[ i ] - '0' );
+
+            if( ulValue > ( ( ulLimit - ulDigit ) / 10UL ) )
+            {
+                xStatus = eShadowCborIllegalDocument;
+            }
+
+            ulValue = ( ulValue * 10UL ) + ulDigit;
+            i++;
+        }
+
+        /* Fractions and exponents are not integers. */
+        if( ( xStatus == eShadowCborSuccess ) && ( i < xLength ) &&
+            ( ( pcSection[ i ] == '.' ) || ( pcSection[ i ] == 'e' ) || ( pcSection[ i ] == 'E' ) ) )
+        {
+            xStatus = eShadowCborIllegalDocument;
+        }
+
+        if( ( xStatus == eShadowCborSuccess ) && ( pxMap != NULL ) )
+        {
+            xError = cbor_encode_int( pxMap, ( xNegative == true ) ? -( int64_t ) ulValue : ( int64_t ) ulValue );
+        }
+    }
+
+    if( xStatus == eShadowCborSuccess )
+    {
+        xStatus = prvGetStatus( xError );
+    }
+
+    if( xStatus == eShadowCborSuccess )
+    {
+        *pxIndex = i;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static ShadowCborStatus_t prvConvertMembers( const char * pcSection,
+                                             size_t xLength,
+                                             CborEncoder * pxMap,
+                                             uint32_t * pulCount )
+{
+    ShadowCborStatus_t xStatus = eShadowCborSuccess;
+    bool xDone = false;
+    size_t i = 0U;
+
+    *pulCount = 0UL;
+
+    prvSkipSpace( pcSection, xLength, &i );
+
+    if( ( i >= xLength ) || ( pcSection[ i ] != '{' ) )
+    {
+        xStatus = eShadowCborIllegalDocument;
+    }
+    else
+    {
+        i++;
+        prvSkipSpace( pcSection, xLength, &i );
+
+        if( ( i < xLength ) && ( pcSection[ i ] == '}' ) )
+        {
+            i++;
+            xDone = true;
+        }
+    }
+
+    while( ( xStatus == eShadowCborSuccess ) && ( xDone == false ) )
+    {
+        if( ( i >= xLength ) || ( pcSection[ i ] != '"' ) )
+        {
+            xStatus = eShadowCborIllegalDocument;
+        }
+        else
+        {
+            xStatus = prvConvertString( pcSection, xLength, &i, pxMap );
+        }
+
+        if( xStatus == eShadowCborSuccess )
+        {
+            prvSkipSpace( pcSection, xLength, &i );
+
+            if( ( i < xLength ) && ( pcSection[ i ] == ':' ) )
+            {
+                i++;
+                prvSkipSpace( pcSection, xLength, &i );
+                xStatus = prvConvertValue( pcSection, xLength, &i, pxMap );
+            }
+            else
+            {
+                xStatus = eShadowCborIllegalDocument;
+            }
+        }
+
+        if( xStatus == eShadowCborSuccess )
+        {
+            ( *pulCount )++;
+            prvSkipSpace( pcSection, xLength, &i );
+
+            if( ( i < xLength ) && ( pcSection[ i ] == ',' ) )
+            {
+                i++;
+                prvSkipSpace( pcSection, xLength, &i );
+            }
+            else if( ( i < xLength ) && ( pcSection[ i ] == '}' ) )
+            {
+                i++;
+                xDone = true;
+            }
+            else
+            {
+                /* A nested object or array ends up here as well. */
+                xStatus = eShadowCborIllegalDocument;
+            }
+        }
+    }
+
+    if( xStatus == eShadowCborSuccess )
+    {
+        prvSkipSpace( pcSection, xLength, &i );
+
+        if( i != xLength )
+        {
+            xStatus = eShadowCborIllegalDocument;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCborStatus_t ShadowCbor_EncodeSection( const ShadowStateModel_t * pxModel,
+                                             uint32_t ulMask,
+                                             uint8_t * pucBuffer,
+                                             size_t xBufferSize,
+                                             size_t * pxLength )
+{
+    const ShadowStateProperty_t * pxProperty = NULL;
+    CborEncoder xEncoder;
+    CborEncoder xMap;
+    CborError xError = CborNoError;
+    size_t xCount = 0U;
+    size_t x = 0U;
+
+    assert( pxModel != NULL );
+    assert( pucBuffer != NULL );
+    assert( pxLength != NULL );
+
+    for( x = 0U; x < pxModel->xPropertyCount; x++ )
+    {
+        if( ( ulMask & ( 1UL << x ) ) != 0UL )
+        {
+            xCount++;
+        }
+    }
+
+    cbor_encoder_init( &xEncoder, pucBuffer, xBufferSize, 0 );
+    xError = cbor_encoder_create_map( &xEncoder, &xMap, xCount );
+
+    for( x = 0U; ( xError == CborNoError ) && ( x < pxModel->xPropertyCount ); x++ )
+    {
+        pxProperty = &pxModel->pxProperties[ x ];
+
+        if( ( ulMask & ( 1UL << x ) ) != 0UL )
+        {
+            xError = cbor_encode_text_string( &xMap, pxProperty->pcName, pxProperty->xNameLength );
+
+            if( xError != CborNoError )
+            {
+                /* Leave the loop. */
+            }
+            else if( pxProperty->eType == eShadowStateBool )
+            {
+                xError = cbor_encode_boolean( &xMap, ( pxProperty->lValue != 0 ) );
+            }
+            else if( pxProperty->eType == eShadowStateInt )
+            {
+                xError = cbor_encode_int( &xMap, pxProperty->lValue );
+            }
+            else
+            {
+                xError = cbor_encode_text_stringz( &xMap, pxProperty->pcString );
+            }
+        }
+    }
+
+    if( xError == CborNoError )
+    {
+        xError = cbor_encoder_close_container( &xEncoder, &xMap );
+    }
+
+    *pxLength = ( xError == CborNoError ) ? cbor_encoder_get_buffer_size( &xEncoder, pucBuffer ) : 0U;
+
+    return prvGetStatus( xError );
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCborStatus_t ShadowCbor_DecodeSection( ShadowStateModel_t * pxModel,
+                                             const uint8_t * pucSection,
+                                             size_t xLength,
+                                             uint32_t * pulApplied )
+{
+    ShadowCborStatus_t xStatus = eShadowCborSuccess;
+    CborParser xParser;
+    CborValue xSection;
+    CborValue xMember;
+    CborValue xKey;
+    CborValue xValue;
+    uint32_t ulApplied = 0UL;
+
+    if( ( pxModel == NULL ) || ( pucSection == NULL ) )
+    {
+        xStatus = eShadowCborBadParameter;
+    }
+    else if( prvOpenSection( pucSection, xLength, &xParser, &xSection, &xMember ) == false )
+    {
+        xStatus = eShadowCborIllegalDocument;
+    }
+    else
+    {
+        while( ( xStatus == eShadowCborSuccess ) && ( cbor_value_at_end( &xMember ) == false ) )
+        {
+            if( prvGetMember( &xMember, &xKey, &xValue ) == true )
+            {
+                ulApplied |= prvApplyMember( pxModel, &xKey, &xValue );
+            }
+            else
+            {
+                xStatus = eShadowCborIllegalDocument;
+            }
+        }
+
+        if( ( xStatus == eShadowCborSuccess ) &&
+            ( prvCloseSection( pucSection, xLength, &xSection, &xMember ) == false ) )
+        {
+            xStatus = eShadowCborIllegalDocument;
+        }
+    }
+
+    if( pulApplied != NULL )
+    {
+        *pulApplied = ulApplied;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCborStatus_t ShadowCbor_ToJson( const uint8_t * pucSection,
+                                      size_t xLength,
+                                      char * pcBuffer,
+                                      size_t xBufferSize,
+                                      size_t * pxLength )
+{
+    ShadowCborStatus_t xStatus = eShadowCborSuccess;
+    CborParser xParser;
+    CborValue xSection;
+    CborValue xMember;
+    CborValue xKey;
+    CborValue xValue;
+    char cNumber[ shadowcborMAX_NUMBER_LENGTH + 1U ];
+    int32_t lValue = 0;
+    bool xBoolean = false;
+    bool xFirst = true;
+    size_t xOffset = 0U;
+    bool xFits = true;
+
+    assert( pxLength != NULL );
+
+    if( ( pucSection == NULL ) || ( pcBuffer == NULL ) )
+    {
+        xStatus = eShadowCborBadParameter;
+    }
+    else if( prvOpenSection( pucSection, xLength, &xParser, &xSection, &xMember ) == false )
+    {
+        xStatus = eShadowCborIllegalDocument;
+    }
+    else
+    {
+        xFits = prvPutBytes( pcBuffer, xBufferSize, &xOffset, "{", 1U );
+    }
+
+    while( ( xStatus == eShadowCborSuccess ) && ( xFits == true ) && ( cbor_value_at_end( &xMember ) == false ) )
+    {
+        if( prvGetMember( &xMember, &xKey, &xValue ) == false )
+        {
+            xStatus = eShadowCborIllegalDocument;
+        }
+        else
+        {
+            xFits = ( ( xFirst == true ) || prvPutBytes( pcBuffer, xBufferSize, &xOffset, ",", 1U ) ) &&
+                    prvPutJsonString( &xKey, pcBuffer, xBufferSize, &xOffset ) &&
+                    prvPutBytes( pcBuffer, xBufferSize, &xOffset, ":", 1U );
+            xFirst = false;
+        }
+
+        if( ( xStatus != eShadowCborSuccess ) || ( xFits == false ) )
+        {
+            /* Leave the loop. */
+        }
+        else if( cbor_value_is_text_string( &xValue ) == true )
+        {
+            xFits = prvPutJsonString( &xValue, pcBuffer, xBufferSize, &xOffset );
+        }
+        else if( cbor_value_is_boolean( &xValue ) == true )
+        {
+            ( void ) cbor_value_get_boolean( &xValue, &xBoolean );
+            xFits = ( xBoolean == true ) ? prvPutBytes( pcBuffer, xBufferSize, &xOffset, "true", 4U ) :
+                    prvPutBytes( pcBuffer, xBufferSize, &xOffset, "false", 5U );
+        }
+        else if( cbor_value_is_null( &xValue ) == true )
+        {
+            xFits = prvPutBytes( pcBuffer, xBufferSize, &xOffset, "null", 4U );
+        }
+        else if( prvGetInt( &xValue, &lValue ) == true )
+        {
+            ( void ) snprintf( cNumber, sizeof( cNumber ), "%ld", ( long ) lValue );
+            xFits = prvPutBytes( pcBuffer, xBufferSize, &xOffset, cNumber, strlen( cNumber ) );
+        }
+        else
+        {
+            /* An integer out of range. */
+            xStatus = eShadowCborIllegalDocument;
+        }
+    }
+
+    if( ( xStatus == eShadowCborSuccess ) && ( xFits == true ) )
+    {
+        xFits = prvPutBytes( pcBuffer, xBufferSize, &xOffset, "}", 1U );
+
+        if( prvCloseSection( pucSection, xLength, &xSection, &xMember ) == false )
+        {
+            xStatus = eShadowCborIllegalDocument;
+        }
+    }
+
+    if( ( xStatus == eShadowCborSuccess ) && ( xFits == false ) )
+    {
+        xStatus = eShadowCborBufferTooSmall;
+    }
+
+    *pxLength = xOffset;
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCborStatus_t ShadowCbor_FromJson( const char * pcSection,
+                                        size_t xLength,
+                                        uint8_t * pucBuffer,
+                                        size_t xBufferSize,
+                                        size_t * pxLength )
+{
+    ShadowCborStatus_t xStatus = eShadowCborSuccess;
+    CborEncoder xEncoder;
+    CborEncoder xMap;
+    uint32_t ulCount = 0UL;
+
+    assert( pxLength != NULL );
+
+    *pxLength = 0U;
+
+    if( ( pcSection == NULL ) || ( pucBuffer == NULL ) )
+    {
+        xStatus = eShadowCborBadParameter;
+    }
+    else
+    {
+        /* Count the members for the map head without encoding anything. */
+        xStatus = prvConvertMembers( pcSection, xLength, NULL, &ulCount );
+    }
+
+    if( xStatus == eShadowCborSuccess )
+    {
+        cbor_encoder_init( &xEncoder, pucBuffer, xBufferSize, 0 );
+        xStatus = prvGetStatus( cbor_encoder_create_map( &xEncoder, &xMap, ulCount ) );
+    }
+
+    if( xStatus == eShadowCborSuccess )
+    {
+        xStatus = prvConvertMembers( pcSection, xLength, &xMap, &ulCount );
+    }
+
+    if( xStatus == eShadowCborSuccess )
+    {
+        xStatus = prvGetStatus( cbor_encoder_close_container( &xEncoder, &xMap ) );
+    }
+
+    if( xStatus == eShadowCborSuccess )
+    {
+        *pxLength = cbor_encoder_get_buffer_size( &xEncoder, pucBuffer );
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( shadowcborconfigBENCHMARK_ITERATIONS > 0U )
+
+/**
+ * @brief Size of the buffers the benchmark encodes into.
+ */
+    #define shadowcborBENCHMARK_BUFFER_SIZE    ( 256U )
+
+/**
+ * @brief Number of properties of the benchmark model.
+ */
+    #define shadowcborBENCHMARK_PROPERTIES     ( 4U )
+
+/**
+ * @brief A desired section as the service sends it for a typical device.
+ */
+    static const char pcBenchmarkSection[] =
+        "{\"powerOn\":true,\"brightness\":80,\"colorTemperature\":4000,\"mode\":\"night\"}";
+
+/**
+ * @brief Model the section is applied to and encoded from.
+ */
+    static char cBenchmarkMode[ 16 ];
+    static ShadowStateProperty_t xBenchmarkProperties[ shadowcborBENCHMARK_PROPERTIES ] =
+    {
+        shadowstateBOOL( "powerOn" ),
+        shadowstateINT( "brightness" ),
+        shadowstateINT( "colorTemperature" ),
+        shadowstateSTRING( "mode", cBenchmarkMode )
+    };
+    static ShadowStateModel_t xBenchmarkModel = shadowstateMODEL( xBenchmarkProperties );
+
+#endif /* if ( shadowcborconfigBENCHMARK_ITERATIONS > 0U ) */
+
+void ShadowCbor_RunBenchmark( void )
+{
+    #if ( shadowcborconfigBENCHMARK_ITERATIONS > 0U )
+        ShadowJsonField_t xFields[ shadowcborBENCHMARK_PROPERTIES ] =
+        {
+            shadowjsonFIELD( "powerOn" ),
+            shadowjsonFIELD( "brightness" ),
+            shadowjsonFIELD( "colorTemperature" ),
+            shadowjsonFIELD( "mode" )
+        };
+        MQTTMetricsTimestamp_t xStart;
+        char cMode[ sizeof( cBenchmarkMode ) ];
+        uint8_t * pucCbor = NULL;
+        char * pcJson = NULL;
+        size_t xCborLength = 0U;
+        size_t xDocumentLength = 0U;
+        size_t xLength = 0U;
+        uint32_t ulMask = 0UL;
+        uint32_t ulValue = 0UL;
+        uint32_t ulIteration = 0UL;
+        uint32_t ulJsonDecodeUs = 0UL;
+        uint32_t ulCborDecodeUs = 0UL;
+        uint32_t ulJsonEncodeUs = 0UL;
+        uint32_t ulCborEncodeUs = 0UL;
+
+        pucCbor = BufferPool_Acquire( shadowcborBENCHMARK_BUFFER_SIZE );
+        pcJson = BufferPool_Acquire( shadowcborBENCHMARK_BUFFER_SIZE );
+
+        if( ( pucCbor == NULL ) || ( pcJson == NULL ) ||
+            ( ShadowState_Init( &xBenchmarkModel ) != eShadowStateSuccess ) ||
+            ( ShadowJson_Compile( xFields, shadowcborBENCHMARK_PROPERTIES ) != eShadowJsonSuccess ) ||
+            ( ShadowCbor_FromJson( pcBenchmarkSection,
+                                   sizeof( pcBenchmarkSection ) - 1U,
+                                   pucCbor,
+                                   shadowcborBENCHMARK_BUFFER_SIZE,
+                                   &xCborLength ) != eShadowCborSuccess ) )
+        {
+            LogError( ( "The CBOR benchmark could not be set up." ) );
+        }
+        else
+        {
+            /* Decoding as the shadow task does it: one pass for the paths,
+             * then a conversion per value. */
+            MQTTMetrics_Start( &xStart );
+
+            for( ulIteration = 0UL; ulIteration < shadowcborconfigBENCHMARK_ITERATIONS; ulIteration++ )
+            {
+                if( ShadowJson_Parse( pcBenchmarkSection,
+                                      sizeof( pcBenchmarkSection ) - 1U,
+                                      xFields,
+                                      shadowcborBENCHMARK_PROPERTIES ) == eShadowJsonSuccess )
+                {
+                    ( void ) ShadowState_SetBool( &xBenchmarkModel, 0U, ( xFields[ 0 ].xValue.eType == eShadowJsonTrue ) );
+
+                    if( ShadowJson_GetUInt32( pcBenchmarkSection, &xFields[ 1 ].xValue, &ulValue ) == eShadowJsonSuccess )
+                    {
+                        ( void ) ShadowState_SetInt( &xBenchmarkModel, 1U, ( int32_t ) ulValue );
+                    }
+
+                    if( ShadowJson_GetUInt32( pcBenchmarkSection, &xFields[ 2 ].xValue, &ulValue ) == eShadowJsonSuccess )
+                    {
+                        ( void ) ShadowState_SetInt( &xBenchmarkModel, 2U, ( int32_t ) ulValue );
+                    }
+
+                    if( ( xFields[ 3 ].xValue.eType == eShadowJsonString ) && ( xFields[ 3 ].xValue.xLength < sizeof( cMode ) ) )
+                    {
+                        ( void ) memcpy( cMode, &pcBenchmarkSection[ xFields[ 3 ].xValue.xOffset ], xFields[ 3 ].xValue.xLength );
+                        cMode[ xFields[ 3 ].xValue.xLength ] = '\0';
+                        ( void ) ShadowState_SetString( &xBenchmarkModel, 3U, cMode );
+                    }
+                }
+            }
+
+            ulJsonDecodeUs = MQTTMetrics_ElapsedUs( &xStart );
+
+            MQTTMetrics_Start( &xStart );
+
+            for( ulIteration = 0UL; ulIteration < shadowcborconfigBENCHMARK_ITERATIONS; ulIteration++ )
+            {
+                ( void ) ShadowCbor_DecodeSection( &xBenchmarkModel, pucCbor, xCborLength, NULL );
+            }
+
+            ulCborDecodeUs = MQTTMetrics_ElapsedUs( &xStart );
+
+            /* Encoding every property: the whole update document as JSON
+             * against the reported section as CBOR. */
+            MQTTMetrics_Start( &xStart );
+
+            for( ulIteration = 0UL; ulIteration < shadowcborconfigBENCHMARK_ITERATIONS; ulIteration++ )
+            {
+                ShadowState_MarkAllDirty( &xBenchmarkModel );
+                ( void ) ShadowState_SerializeReported( &xBenchmarkModel,
+                                                        pcJson,
+                                                        shadowcborBENCHMARK_BUFFER_SIZE,
+                                                        1UL,
+                                                        false,
+                                                        &xDocumentLength,
+                                                        &ulMask );
+            }
+
+            ulJsonEncodeUs = MQTTMetrics_ElapsedUs( &xStart );
+
+            MQTTMetrics_Start( &xStart );
+
+            for( ulIteration = 0UL; ulIteration < shadowcborconfigBENCHMARK_ITERATIONS; ulIteration++ )
+            {
+                ( void ) ShadowCbor_EncodeSection( &xBenchmarkModel,
+                                                   ( 1UL << shadowcborBENCHMARK_PROPERTIES ) - 1UL,
+                                                   pucCbor,
+                                                   shadowcborBENCHMARK_BUFFER_SIZE,
+                                                   &xLength );
+            }
+
+            ulCborEncodeUs = MQTTMetrics_ElapsedUs( &xStart );
+
+            LogInfo( ( "Section: JSON %u bytes (%u as an update document), CBOR %u bytes.",
+                       ( unsigned ) ( sizeof( pcBenchmarkSection ) - 1U ),
+                       ( unsigned ) xDocumentLength,
+                       ( unsigned ) xLength ) );
+            LogInfo( ( "Decode: JSON %lu ns, CBOR %lu ns; encode: JSON %lu ns, CBOR %lu ns per section.",
+                       ( unsigned long ) ( ( ( uint64_t ) ulJsonDecodeUs * 1000ULL ) / shadowcborconfigBENCHMARK_ITERATIONS ),
+                       ( unsigned long ) ( ( ( uint64_t ) ulCborDecodeUs * 1000ULL ) / shadowcborconfigBENCHMARK_ITERATIONS ),
+                       ( unsigned long ) ( ( ( uint64_t ) ulJsonEncodeUs * 1000ULL ) / shadowcborconfigBENCHMARK_ITERATIONS ),
+                       ( unsigned long ) ( ( ( uint64_t ) ulCborEncodeUs * 1000ULL ) / shadowcborconfigBENCHMARK_ITERATIONS ) ) );
+        }
+
+        BufferPool_Release( pucCbor );
+        BufferPool_Release( pcJson );
+    #endif /* if ( shadowcborconfigBENCHMARK_ITERATIONS > 0U ) */
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,560 @@
+/*
+ * shadow_client.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file shadow_client.c
+ *
+ * @brief Registry of the device shadows sharing one MQTT connection.
+ *
+ * A shadow's topics all start with the same prefix, so the cache holds only
+ * the two topics published to, which start with that prefix. An incoming
+ * topic is matched by comparing the prefix of each shadow and then looking
+ * the rest of the topic up in a short table of suffixes. The subscription
+ * filters are only needed while a SUBSCRIBE is serialized, so they are built
+ * in a buffer borrowed from the pool and never cached.
+ *
+ * Every payload is validated and searched for the common fields with one
+ * table of paths, compiled once, before the callback runs. The client is
+ * only used from the task running the MQTT connection, so the table is
+ * shared by all shadows.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* Shadow client configuration. */
+#include "shadow_client_config.h"
+
+/* MQTT helpers. */
+#include "mqtt_demo_helpers.h"
+
+/* Shared buffer pool. */
+#include "buffer_pool.h"
+
+#include "shadow_client.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Pieces of the shadow topics.
+ */
+#define shadowclientTHINGS_PREFIX           "$aws/things/"
+#define shadowclientSHADOW_INFIX            "/shadow/"
+#define shadowclientNAMED_INFIX             "/shadow/name/"
+#define shadowclientGET_SUFFIX              "get"
+#define shadowclientUPDATE_SUFFIX           "update"
+
+/**
+ * @brief Length of a string literal.
+ */
+#define shadowclientLENGTH( pcLiteral )     ( sizeof( pcLiteral ) - 1U )
+
+/**
+ * @brief Initializer for an entry of #xSuffixes.
+ */
+#define shadowclientSUFFIX( pcSuffix, xMessageType )    { ( pcSuffix ), shadowclientLENGTH( pcSuffix ), ( xMessageType ) }
+
+/**
+ * @brief The first entries of #xSuffixes, which are subscribed for every
+ * shadow.
+ */
+#define shadowclientSUBSCRIBED_SUFFIXES     ( 5U )
+
+/**
+ * @brief Positions of the paths in #xEventFields.
+ */
+#define shadowclientFIELD_VERSION           ( 0U )
+#define shadowclientFIELD_CLIENT_TOKEN      ( 1U )
+#define shadowclientFIELD_CODE              ( 2U )
+#define shadowclientFIELD_STATE             ( 3U )
+#define shadowclientFIELD_DESIRED           ( 4U )
+#define shadowclientFIELD_COUNT             ( 5U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The part of a shadow topic after the prefix.
+ */
+typedef struct ShadowClientSuffix
+{
+    const char * pcSuffix;
+    uint16_t usLength;
+    ShadowMessageType_t xMessageType;
+} ShadowClientSuffix_t;
+
+/**
+ * @brief A registered shadow.
+ */
+struct ShadowClientShadow
+{
+    const char * pcName;              /**< @brief Name of the shadow; "" for the classic one. */
+    ShadowClientCallback_t xCallback; /**< @brief Receives the shadow's publishes. */
+    void * pvContext;                 /**< @brief Passed to #xCallback. */
+    const char * pcGetTopic;          /**< @brief Cached get topic; its prefix is the shadow's. */
+    const char * pcUpdateTopic;       /**< @brief Cached update topic. */
+    uint16_t usPrefixLength;          /**< @brief Length of the prefix, up to and including the last '/'. */
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Topic suffixes of the messages the service sends, subscribed ones
+ * first.
+ */
+static const ShadowClientSuffix_t xSuffixes[] =
+{
+    shadowclientSUFFIX( "update/delta", ShadowMessageTypeUpdateDelta ),
+    shadowclientSUFFIX( "update/accepted", ShadowMessageTypeUpdateAccepted ),
+    shadowclientSUFFIX( "update/rejected", ShadowMessageTypeUpdateRejected ),
+    shadowclientSUFFIX( "get/accepted", ShadowMessageTypeGetAccepted ),
+    shadowclientSUFFIX( "get/rejected", ShadowMessageTypeGetRejected ),
+    shadowclientSUFFIX( "update/documents", ShadowMessageTypeUpdateDocuments ),
+    shadowclientSUFFIX( "delete/accepted", ShadowMessageTypeDeleteAccepted ),
+    shadowclientSUFFIX( "delete/rejected", ShadowMessageTypeDeleteRejected )
+};
+
+/**
+ * @brief Name of the thing owning the shadows.
+ */
+static const char * pcThing = NULL;
+static uint16_t usThingLength = 0U;
+
+/**
+ * @brief The registered shadows.
+ */
+static struct ShadowClientShadow xShadows[ shadowclientconfigMAX_SHADOWS ];
+static size_t xShadowCount = 0U;
+
+/**
+ * @brief Cached get and update topics of every registered shadow, back to
+ * back.
+ */
+static char cTopicCache[ shadowclientconfigTOPIC_CACHE_SIZE ];
+static size_t xTopicCacheUsed = 0U;
+
+/**
+ * @brief Paths located in every payload before it is handed over. A delta
+ * carries the desired state as "state"; the other documents nest it under
+ * "state.desired".
+ */
+static ShadowJsonField_t xEventFields[ shadowclientFIELD_COUNT ] =
+{
+    shadowjsonFIELD( "version" ),
+    shadowjsonFIELD( "clientToken" ),
+    shadowjsonFIELD( "code" ),
+    shadowjsonFIELD( "state" ),
+    shadowjsonFIELD( "state.desired" )
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Whether @p pcName is a valid shadow name: letters, digits, ':',
+ * '_' and '-', at most #shadowclientMAX_NAME_LENGTH characters.
+ */
+static bool prvIsValidName( const char * pcName,
+                            size_t xNameLength );
+
+/**
+ * @brief Write the prefix of shadow @p pcName into @p pcBuffer.
+ *
+ * @return Length of the prefix.
+ */
+static size_t prvWritePrefix( char * pcBuffer,
+                              const char * pcName,
+                              size_t xNameLength );
+
+/**
+ * @brief Length of the prefix of shadow @p pcName.
+ */
+static size_t prvPrefixLength( size_t xNameLength );
+
+/**
+ * @brief Subscribe to the topics of one shadow.
+ */
+static BaseType_t prvSubscribeShadow( MQTTContext_t * pxMqttContext,
+                                      const struct ShadowClientShadow * pxShadow );
+
+/**
+ * @brief Locate the common fields of a publish and hand it to the callback
+ * of @p pxShadow.
+ */
+static void prvDeliver( struct ShadowClientShadow * pxShadow,
+                        ShadowMessageType_t xMessageType,
+                        const MQTTPublishInfo_t * pxPublishInfo );
+
+/*-----------------------------------------------------------*/
+
+static bool prvIsValidName( const char * pcName,
+                            size_t xNameLength )
+{
+    bool xValid = ( xNameLength <= shadowclientMAX_NAME_LENGTH );
+    size_t x = 0U;
+    char c = '\0';
+
+    for( x = 0U; ( xValid == true ) && ( x < xNameLength ); x++ )
+    {
+        c = pcName[ x ];
+
+        xValid = ( ( c >= 'a' ) && ( c <= 'z' ) ) ||
+                 ( ( c >= 'A' ) && ( c <= 'Z' ) ) ||
+                 ( ( c >= '0' ) && ( c <= '9' ) ) ||
+                 ( c == ':' ) || ( c == '_' ) || ( c == '-' );
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvPrefixLength( size_t xNameLength )
+{
+    size_t xLength = shadowclientLENGTH( shadowclientTHINGS_PREFIX ) + usThingLength;
+
+    if( xNameLength == 0U )
+    {
+        xLength += shadowclientLENGTH( shadowclientSHADOW_INFIX );
+    }
+    else
+    {
+        xLength += shadowclientLENGTH( shadowclientNAMED_INFIX ) + xNameLength + 1U;
+    }
+
+    return xLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvWritePrefix( char * pcBuffer,
+                              const char * pcName,
+                              size_t xNameLength )
+{
+    size_t xLength = 0U;
+
+    ( void ) memcpy( pcBuffer, shadowclientTHINGS_PREFIX, shadowclientLENGTH( shadowclientTHINGS_PREFIX ) );
+    xLength += shadowclientLENGTH( shadowclientTHINGS_PREFIX );
+
+    ( void ) memcpy( &pcBuffer[ xLength ], pcThing, usThingLength );
+    xLength += usThingLength;
+
+    if( xNameLength == 0U )
+    {
+        ( void ) memcpy( &pcBuffer[ xLength ], shadowclientSHADOW_INFIX, shadowclientLENGTH( shadowclientSHADOW_INFIX ) );
+        xLength += shadowclientLENGTH( shadowclientSHADOW_INFIX );
+    }
+    else
+    {
+        ( void ) memcpy( &pcBuffer[ xLength ], shadowclientNAMED_INFIX, shadowclientLENGTH( shadowclientNAMED_INFIX ) );
+        xLength += shadowclientLENGTH( shadowclientNAMED_INFIX );
+
+        ( void ) memcpy( &pcBuffer[ xLength ], pcName, xNameLength );
+        xLength += xNameLength;
+
+        pcBuffer[ xLength ] = '/';
+        xLength++;
+    }
+
+    return xLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSubscribeShadow( MQTTContext_t * pxMqttContext,
+                                      const struct ShadowClientShadow * pxShadow )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    MQTTSubscribeInfo_t xSubscriptions[ shadowclientSUBSCRIBED_SUFFIXES ];
+    char * pcFilters = NULL;
+    size_t xFiltersSize = 0U;
+    size_t xUsed = 0U;
+    size_t x = 0U;
+
+    for( x = 0U; x < shadowclientSUBSCRIBED_SUFFIXES; x++ )
+    {
+        xFiltersSize += pxShadow->usPrefixLength + xSuffixes[ x ].usLength;
+    }
+
+    pcFilters = BufferPool_Acquire( xFiltersSize );
+
+    if( pcFilters == NULL )
+    {
+        LogError( ( "No buffer available for the %u bytes of topic filters of shadow \"%s\".",
+                    ( unsigned int ) xFiltersSize,
+                    pxShadow->pcName ) );
+        xReturnStatus = pdFAIL;
+    }
+    else
+    {
+        /* The filters are copied into the SUBSCRIBE packet, so they only
+         * need to live until it is sent. They are not terminated. */
+        for( x = 0U; x < shadowclientSUBSCRIBED_SUFFIXES; x++ )
+        {
+            ( void ) memcpy( &pcFilters[ xUsed ], pxShadow->pcGetTopic, pxShadow->usPrefixLength );
+            ( void ) memcpy( &pcFilters[ xUsed + pxShadow->usPrefixLength ], xSuffixes[ x ].pcSuffix, xSuffixes[ x ].usLength );
+
+            xSubscriptions[ x ].qos = MQTTQoS1;
+            xSubscriptions[ x ].pTopicFilter = &pcFilters[ xUsed ];
+            xSubscriptions[ x ].topicFilterLength = ( uint16_t ) ( pxShadow->usPrefixLength + xSuffixes[ x ].usLength );
+
+            xUsed += xSubscriptions[ x ].topicFilterLength;
+        }
+
+        xReturnStatus = SubscribeToTopics( pxMqttContext,
+                                           xSubscriptions,
+                                           shadowclientSUBSCRIBED_SUFFIXES );
+
+        BufferPool_Release( pcFilters );
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDeliver( struct ShadowClientShadow * pxShadow,
+                        ShadowMessageType_t xMessageType,
+                        const MQTTPublishInfo_t * pxPublishInfo )
+{
+    ShadowClientEvent_t xEvent = { 0 };
+
+    xEvent.xShadow = pxShadow;
+    xEvent.xMessageType = xMessageType;
+    xEvent.pcPayload = ( const char * ) pxPublishInfo->pPayload;
+    xEvent.xPayloadLength = pxPublishInfo->payloadLength;
+
+    if( ShadowJson_Parse( xEvent.pcPayload,
+                          xEvent.xPayloadLength,
+                          xEventFields,
+                          shadowclientFIELD_COUNT ) == eShadowJsonSuccess )
+    {
+        xEvent.xValid = true;
+        xEvent.xVersion = xEventFields[ shadowclientFIELD_VERSION ].xValue;
+        xEvent.xClientToken = xEventFields[ shadowclientFIELD_CLIENT_TOKEN ].xValue;
+        xEvent.xCode = xEventFields[ shadowclientFIELD_CODE ].xValue;
+        xEvent.xDesired = ( xMessageType == ShadowMessageTypeUpdateDelta ) ?
+                          xEventFields[ shadowclientFIELD_STATE ].xValue :
+                          xEventFields[ shadowclientFIELD_DESIRED ].xValue;
+    }
+    else
+    {
+        LogError( ( "Invalid json document of %u bytes for shadow \"%s\".",
+                    ( unsigned int ) xEvent.xPayloadLength,
+                    pxShadow->pcName ) );
+    }
+
+    pxShadow->xCallback( &xEvent, pxShadow->pvContext );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t ShadowClient_Init( const char * pcThingName,
+                              uint16_t usThingNameLength )
+{
+    BaseType_t xReturnStatus = pdPASS;
+
+    if( ( pcThingName == NULL ) || ( usThingNameLength == 0U ) )
+    {
+        LogError( ( "A thing name is needed for the shadow topics." ) );
+        xReturnStatus = pdFAIL;
+    }
+    else if( ShadowJson_Compile( xEventFields, shadowclientFIELD_COUNT ) != eShadowJsonSuccess )
+    {
+        LogError( ( "Invalid shadow event field table." ) );
+        xReturnStatus = pdFAIL;
+    }
+    else
+    {
+        pcThing = pcThingName;
+        usThingLength = usThingNameLength;
+        ( void ) memset( xShadows, 0, sizeof( xShadows ) );
+        xShadowCount = 0U;
+        xTopicCacheUsed = 0U;
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowClientHandle_t ShadowClient_Register( const char * pcShadowName,
+                                            ShadowClientCallback_t xCallback,
+                                            void * pvContext )
+{
+    struct ShadowClientShadow * pxShadow = NULL;
+    size_t xNameLength = 0U;
+    size_t xPrefixLength = 0U;
+    size_t xCacheNeeded = 0U;
+    char * pcCache = NULL;
+    bool xRegistered = false;
+    size_t x = 0U;
+
+    assert( pcThing != NULL );
+    assert( xCallback != NULL );
+
+    if( pcShadowName == NULL )
+    {
+        pcShadowName = "";
+    }
+
+    xNameLength = strlen( pcShadowName );
+    xPrefixLength = prvPrefixLength( xNameLength );
+
+    /* Both topics are cached with their terminators. */
+    xCacheNeeded = ( 2U * xPrefixLength ) +
+                   shadowclientLENGTH( shadowclientGET_SUFFIX ) +
+                   shadowclientLENGTH( shadowclientUPDATE_SUFFIX ) + 2U;
+
+    for( x = 0U; ( xRegistered == false ) && ( x < xShadowCount ); x++ )
+    {
+        xRegistered = ( strcmp( xShadows[ x ].pcName, pcShadowName ) == 0 );
+    }
+
+    if( xRegistered == true )
+    {
+        LogError( ( "Shadow \"%s\" is already registered.", pcShadowName ) );
+    }
+    else if( prvIsValidName( pcShadowName, xNameLength ) == false )
+    {
+        LogError( ( "Invalid shadow name \"%s\".", pcShadowName ) );
+    }
+    else if( xShadowCount >= shadowclientconfigMAX_SHADOWS )
+    {
+        LogError( ( "No room for shadow \"%s\"; raise shadowclientconfigMAX_SHADOWS.", pcShadowName ) );
+    }
+    else if( ( sizeof( cTopicCache ) - xTopicCacheUsed ) < xCacheNeeded )
+    {
+        LogError( ( "Topics of shadow \"%s\" need %u bytes of cache; raise shadowclientconfigTOPIC_CACHE_SIZE.",
+                    pcShadowName,
+                    ( unsigned int ) xCacheNeeded ) );
+    }
+    else
+    {
+        pxShadow = &xShadows[ xShadowCount ];
+        pcCache = &cTopicCache[ xTopicCacheUsed ];
+
+        /* The prefix is written once and copied to start the update topic. */
+        ( void ) prvWritePrefix( pcCache, pcShadowName, xNameLength );
+        ( void ) memcpy( &pcCache[ xPrefixLength ], shadowclientGET_SUFFIX, sizeof( shadowclientGET_SUFFIX ) );
+        pxShadow->pcGetTopic = pcCache;
+        pcCache += xPrefixLength + sizeof( shadowclientGET_SUFFIX );
+
+        ( void ) memcpy( pcCache, pxShadow->pcGetTopic, xPrefixLength );
+        ( void ) memcpy( &pcCache[ xPrefixLength ], shadowclientUPDATE_SUFFIX, sizeof( shadowclientUPDATE_SUFFIX ) );
+        pxShadow->pcUpdateTopic = pcCache;
+
+        pxShadow->pcName = pcShadowName;
+        pxShadow->xCallback = xCallback;
+        pxShadow->pvContext = pvContext;
+        pxShadow->usPrefixLength = ( uint16_t ) xPrefixLength;
+
+        xTopicCacheUsed += xCacheNeeded;
+        xShadowCount++;
+
+        LogInfo( ( "Registered shadow \"%s\" at %.*s, %u of %u cache bytes used.",
+                   pcShadowName,
+                   ( int ) xPrefixLength,
+                   pxShadow->pcGetTopic,
+                   ( unsigned int ) xTopicCacheUsed,
+                   ( unsigned int ) sizeof( cTopicCache ) ) );
+    }
+
+    return pxShadow;
+}
+
+/*-----------------------------------------------------------*/
+
+const char * ShadowClient_GetName( ShadowClientHandle_t xShadow )
+{
+    assert( xShadow != NULL );
+
+    return xShadow->pcName;
+}
+
+/*-----------------------------------------------------------*/
+
+const char * ShadowClient_GetTopic( ShadowClientHandle_t xShadow,
+                                    ShadowClientTopic_t xTopic,
+                                    uint16_t * pusLength )
+{
+    const char * pcTopic = NULL;
+
+    assert( xShadow != NULL );
+    assert( pusLength != NULL );
+
+    if( xTopic == eShadowClientTopicGet )
+    {
+        pcTopic = xShadow->pcGetTopic;
+        *pusLength = xShadow->usPrefixLength + shadowclientLENGTH( shadowclientGET_SUFFIX );
+    }
+    else
+    {
+        pcTopic = xShadow->pcUpdateTopic;
+        *pusLength = xShadow->usPrefixLength + shadowclientLENGTH( shadowclientUPDATE_SUFFIX );
+    }
+
+    return pcTopic;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t ShadowClient_Subscribe( MQTTContext_t * pxMqttContext )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    size_t x = 0U;
+
+    assert( pxMqttContext != NULL );
+
+    for( x = 0U; ( xReturnStatus == pdPASS ) && ( x < xShadowCount ); x++ )
+    {
+        xReturnStatus = prvSubscribeShadow( pxMqttContext, &xShadows[ x ] );
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+bool ShadowClient_Dispatch( MQTTPublishInfo_t * pxPublishInfo )
+{
+    struct ShadowClientShadow * pxShadow = NULL;
+    const char * pcSuffix = NULL;
+    uint16_t usSuffixLength = 0U;
+    bool xDispatched = false;
+    size_t x = 0U;
+    size_t y = 0U;
+
+    assert( pxPublishInfo != NULL );
+
+    /* The classic prefix is also the start of every named shadow's, so a
+     * shadow only matches if the rest of the topic is a known suffix. */
+    for( x = 0U; ( xDispatched == false ) && ( x < xShadowCount ); x++ )
+    {
+        pxShadow = &xShadows[ x ];
+
+        if( ( pxPublishInfo->topicNameLength > pxShadow->usPrefixLength ) &&
+            ( memcmp( pxPublishInfo->pTopicName, pxShadow->pcGetTopic, pxShadow->usPrefixLength ) == 0 ) )
+        {
+            pcSuffix = &pxPublishInfo->pTopicName[ pxShadow->usPrefixLength ];
+            usSuffixLength = pxPublishInfo->topicNameLength - pxShadow->usPrefixLength;
+
+            for( y = 0U; ( xDispatched == false ) && ( y < ( sizeof( xSuffixes ) / sizeof( xSuffixes[ 0 ] ) ) ); y++ )
+            {
+                if( ( usSuffixLength == xSuffixes[ y ].usLength ) &&
+                    ( memcmp( pcSuffix, xSuffixes[ y ].pcSuffix, usSuffixLength ) == 0 ) )
+                {
+                    prvDeliver( pxShadow, xSuffixes[ y ].xMessageType, pxPublishInfo );
+                    xDispatched = true;
+                }
+            }
+        }
+    }
+
+    return xDispatched;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,867 @@
+/*
+ * shadow_json.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file shadow_json.c
+ *
+ * @brief Single-pass extractor for shadow documents.
+ *
+ * The scanner is iterative: every open object or array is one entry of a
+ * fixed stack holding the mask of paths whose next key may appear in it and
+ * the mask of paths whose value it is. A value is recorded when it ends, so
+ * a path that names an object or array gets the whole container.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Shadow JSON configuration. */
+#include "shadow_json_config.h"
+
+#if ( shadowjsonconfigBENCHMARK_ITERATIONS > 0U )
+    /* The benchmark compares against coreJSON and times with the cycle
+     * counter. */
+    #include "core_json.h"
+    #include "mqtt_metrics.h"
+#endif
+
+#include "shadow_json.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief One open object or array.
+ */
+typedef struct ShadowJsonLevel
+{
+    uint32_t ulChildMask; /**< @brief Paths whose next key may be a member of this object. */
+    uint32_t ulValueMask; /**< @brief Paths whose value is this container. */
+    size_t xStart;        /**< @brief Offset of the opening bracket. */
+    char cClose;          /**< @brief The closing bracket expected. */
+} ShadowJsonLevel_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Advance past spaces, tabs, carriage returns and line feeds.
+ */
+static void prvSkipSpace( const char * pcDocument,
+                          size_t xLength,
+                          size_t * pxIndex );
+
+/**
+ * @brief Advance past a string starting at the opening quote, validating
+ * its escapes and UTF-8 encoding.
+ *
+ * @return true if the string is valid; @p pxIndex is then just past the
+ * closing quote.
+ */
+static bool prvSkipString( const char * pcDocument,
+                           size_t xLength,
+                           size_t * pxIndex );
+
+/**
+ * @brief Advance past a number.
+ *
+ * @return true if the number is valid.
+ */
+static bool prvSkipNumber( const char * pcDocument,
+                           size_t xLength,
+                           size_t * pxIndex );
+
+/**
+ * @brief Advance past a scalar value and report its type.
+ *
+ * @return true if the value is valid.
+ */
+static bool prvSkipScalar( const char * pcDocument,
+                           size_t xLength,
+                           size_t * pxIndex,
+                           ShadowJsonType_t * peType );
+
+/**
+ * @brief Parse the key of an object member and the colon after it, and
+ * work out which paths the member's value continues or ends.
+ *
+ * @param[in] ulCandidates Paths whose key at @p xLevel may be this one.
+ * @param[out] pulChildMask Paths that continue into the value.
+ * @param[out] pulValueMask Paths whose value this is.
+ *
+ * @return true if the key and colon are valid.
+ */
+static bool prvParseKey( const char * pcDocument,
+                         size_t xLength,
+                         size_t * pxIndex,
+                         const ShadowJsonField_t * pxFields,
+                         size_t xLevel,
+                         uint32_t ulCandidates,
+                         uint32_t * pulChildMask,
+                         uint32_t * pulValueMask );
+
+/**
+ * @brief Store a value for every path in @p ulMask that has none yet.
+ */
+static void prvRecordValue( ShadowJsonField_t * pxFields,
+                            uint32_t ulMask,
+                            ShadowJsonType_t eType,
+                            size_t xValueOffset,
+                            size_t xValueLength );
+
+/*-----------------------------------------------------------*/
+
+static void prvSkipSpace( const char * pcDocument,
+                          size_t xLength,
+                          size_t * pxIndex )
+{
+    size_t i = *pxIndex;
+
+    while( ( i < xLength ) &&
+           ( ( pcDocument[ i ] == ' ' ) || ( pcDocument[ i ] == '\t' ) ||
+             ( pcDocument[ i ] == '\r' ) || ( pcDocument[ i ] == '\n' ) ) )
+    {
+        i++;
+    }
+
+    *pxIndex = i;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvSkipString( const char * pcDocument,
+                           size_t xLength,
+                           size_t * pxIndex )
+{
+    size_t i = *pxIndex + 1U;
+    size_t xFollowing = 0U;
+    size_t j = 0U;
+    uint8_t ucChar = 0U;
+    bool xValid = true;
+    bool xClosed = false;
+
+    while( ( xValid == true ) && ( xClosed == false ) && ( i < xLength ) )
+    {
+        ucChar = ( uint8_t ) pcDocument[ i ];
+
+        if( ucChar == ( uint8_t ) '"' )
+        {
+            xClosed = true;
+        }
+        else if( ucChar == ( uint8_t ) '\\' )
+        {
+            i++;
+
+            if( i >= xLength )
+            {
+                xValid = false;
+            }
+            else if( pcDocument[ i ] == 'u' )
+            {
+                /* \uXXXX with four hex digits. */
+                for( j = 1U; ( j <= 4U ) && ( xValid == true ); j++ )
+                {
+                    if( ( ( i + j ) >= xLength ) ||
+                        ( ( ( pcDocument[ i + j ] < '0' ) || ( pcDocument[ i + j ] > '9' ) ) &&
+                          ( ( pcDocument[ i + j ] < 'a' ) || ( pcDocument[ i + j ] > 'f' ) ) &&
+                          ( ( pcDocument[ i + j ] < 'A' ) || ( pcDocument[ i + j ] > 'F' ) ) ) )
+                    {
+                        xValid = false;
+                    }
+                }
+
+                i += 4U;
+            }
+            else if( ( pcDocument[ i ] == '\0' ) || ( strchr( "\"\\/bfnrt", pcDocument[ i ] ) == NULL ) )
+            {
+                xValid = false;
+            }
+            else
+            {
+                /* A one-character escape. */
+            }
+        }
+        else if( ucChar < 0x20U )
+        {
+            /* Control characters must be escaped. */
+            xValid = false;
+        }
+        else if( ucChar >= 0x80U )
+        {
+            /* A UTF-8 lead byte followed by its continuation bytes. */
+            if( ( ucChar >= 0xC2U ) && ( ucChar <= 0xDFU ) )
+            {
+                xFollowing = 1U;
+            }
+            else if( ( ucChar & 0xF0U ) == 0xE0U )
+            {
+                xFollowing = 2U;
+            }
+            else if( ( ucChar >= 0xF0U ) && ( ucChar <= 0xF4U ) )
+            {
+                xFollowing = 3U;
+            }
+            else
+            {
+                xValid = false;
+            }
+
+            for( j = 1U; ( j <= xFollowing ) && ( xValid == true ); j++ )
+            {
+                if( ( ( i + j ) >= xLength ) ||
+                    ( ( ( uint8_t ) pcDocument[ i + j ] & 0xC0U ) != 0x80U ) )
+                {
+                    xValid = false;
+                }
+            }
+
+            i += xFollowing;
+        }
+        else
+        {
+            /* A printable ASCII character. */
+        }
+
+        i++;
+    }
+
+    if( xClosed == false )
+    {
+        xValid = false;
+    }
+
+    if( xValid == true )
+    {
+        *pxIndex = i;
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvSkipNumber( const char * pcDocument,
+                           size_t xLength,
+                           size_t * pxIndex )
+{
+    size_t i = *pxIndex;
+    size_t xDigitsStart = 0U;
+    bool xValid = true;
+
+    if( ( i < xLength ) && ( pcDocument[ i ] == '-' ) )
+    {
+        i++;
+    }
+
+    /* Integer part: a single 0 or digits without a leading zero. */
+    xDigitsStart = i;
+
+    while( ( i < xLength ) && ( pcDocument[ i ] >= '0' ) && ( pcDocument[ i ] <= '9' ) )
+    {
+        i++;
+    }
+
+    if( ( i == xDigitsStart ) ||
+        ( ( pcDocument[ xDigitsStart ] == '0' ) && ( i > ( xDigitsStart + 1U ) ) ) )
+    {
+        xValid = false;
+    }
+
+    /* Fraction. */
+    if( ( xValid == true ) && ( i < xLength ) && ( pcDocument[ i ] == '.' ) )
+    {
+        i++;
+        xDigitsStart = i;
+
+        while( ( i < xLength ) && ( pcDocument[ i ] >= '0' ) && ( pcDocument[ i ] <= '9' ) )
+        {
+            i++;
+        }
+
+        xValid = ( i > xDigitsStart );
+    }
+
+    /* Exponent. */
+    if( ( xValid == true ) && ( i < xLength ) && ( ( pcDocument[ i ] == 'e' ) || ( pcDocument[ i ] == 'E' ) ) )
+    {
+        i++;
+
+        if( ( i < xLength ) && ( ( pcDocument[ i ] == '+' ) || ( pcDocument[ i ] == '-' ) ) )
+        {
+            i++;
+        }
+
+        xDigitsStart = i;
+
+        while( ( i < xLength ) && ( pcDocument[ i ] >= '0' ) && ( pcDocument[ i ] <= '9' ) )
+        {
+            i++;
+        }
+
+        xValid = ( i > xDigitsStart );
+    }
+
+    if( xValid == true )
+    {
+        *pxIndex = i;
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvSkipScalar( const char * pcDocument,
+                           size_t xLength,
+                           size_t * pxIndex,
+                           ShadowJsonType_t * peType )
+{
+    size_t i = *pxIndex;
+    size_t xRemaining = xLength - i;
+    bool xValid = true;
+
+    if( pcDocument[ i ] == '"' )
+    {
+        *peType = eShadowJsonString;
+        xValid = prvSkipString( pcDocument, xLength, pxIndex );
+    }
+    else if( ( pcDocument[ i ] == '-' ) || ( ( pcDocument[ i ] >= '0' ) && ( pcDocument[ i ] <= '9' ) ) )
+    {
+        *peType = eShadowJsonNumber;
+        xValid = prvSkipNumber( pcDocument, xLength, pxIndex );
+    }
+    else if( ( xRemaining >= 4U ) && ( memcmp( &pcDocument[ i ], "true", 4U ) == 0 ) )
+    {
+        *peType = eShadowJsonTrue;
+        *pxIndex = i + 4U;
+    }
+    else if( ( xRemaining >= 5U ) && ( memcmp( &pcDocument[ i ], "false", 5U ) == 0 ) )
+    {
+        *peType = eShadowJsonFalse;
+        *pxIndex = i + 5U;
+    }
+    else if( ( xRemaining >= 4U ) && ( memcmp( &pcDocument[ i ], "null", 4U ) == 0 ) )
+    {
+        *peType = eShadowJsonNull;
+        *pxIndex = i + 4U;
+    }
+    else
+    {
+        xValid = false;
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvParseKey( const char * pcDocument,
+                         size_t xLength,
+                         size_t * pxIndex,
+                         const ShadowJsonField_t * pxFields,
+                         size_t xLevel,
+                         uint32_t ulCandidates,
+                         uint32_t * pulChildMask,
+                         uint32_t * pulValueMask )
+{
+    size_t xKeyStart = *pxIndex + 1U;
+    size_t xKeyLength = 0U;
+    const ShadowJsonField_t * pxField = NULL;
+    uint32_t ulBit = 0UL;
+    size_t x = 0U;
+    bool xValid = false;
+
+    *pulChildMask = 0UL;
+    *pulValueMask = 0UL;
+
+    if( ( *pxIndex < xLength ) && ( pcDocument[ *pxIndex ] == '"' ) )
+    {
+        xValid = prvSkipString( pcDocument, xLength, pxIndex );
+    }
+
+    if( xValid == true )
+    {
+        xKeyLength = *pxIndex - xKeyStart - 1U;
+
+        prvSkipSpace( pcDocument, xLength, pxIndex );
+
+        if( ( *pxIndex < xLength ) && ( pcDocument[ *pxIndex ] == ':' ) )
+        {
+            ( *pxIndex )++;
+            prvSkipSpace( pcDocument, xLength, pxIndex );
+        }
+        else
+        {
+            xValid = false;
+        }
+    }
+
+    /* Only paths still matching at this level are compared. */
+    for( x = 0U; ( xValid == true ) && ( ulCandidates != 0UL ); x++ )
+    {
+        ulBit = 1UL << x;
+
+        if( ( ulCandidates & ulBit ) != 0UL )
+        {
+            ulCandidates &= ~ulBit;
+            pxField = &pxFields[ x ];
+
+            if( ( pxField->ucSegmentLength[ xLevel ] == xKeyLength ) &&
+                ( memcmp( &pxField->pcPath[ pxField->ucSegmentStart[ xLevel ] ],
+                          &pcDocument[ xKeyStart ],
+                          xKeyLength ) == 0 ) )
+            {
+                if( ( xLevel + 1U ) == pxField->ucSegmentCount )
+                {
+                    *pulValueMask |= ulBit;
+                }
+                else
+                {
+                    *pulChildMask |= ulBit;
+                }
+            }
+        }
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRecordValue( ShadowJsonField_t * pxFields,
+                            uint32_t ulMask,
+                            ShadowJsonType_t eType,
+                            size_t xValueOffset,
+                            size_t xValueLength )
+{
+    uint32_t ulBit = 0UL;
+    size_t x = 0U;
+
+    for( x = 0U; ulMask != 0UL; x++ )
+    {
+        ulBit = 1UL << x;
+
+        if( ( ulMask & ulBit ) != 0UL )
+        {
+            ulMask &= ~ulBit;
+
+            /* The first occurrence of a duplicated key wins. */
+            if( pxFields[ x ].xValue.eType == eShadowJsonNotFound )
+            {
+                pxFields[ x ].xValue.eType = eType;
+                pxFields[ x ].xValue.xOffset = xValueOffset;
+                pxFields[ x ].xValue.xLength = xValueLength;
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowJsonStatus_t ShadowJson_Compile( ShadowJsonField_t * pxFields,
+                                       size_t xFieldCount )
+{
+    ShadowJsonStatus_t xStatus = eShadowJsonSuccess;
+    ShadowJsonField_t * pxField = NULL;
+    size_t xSegmentStart = 0U;
+    size_t x = 0U;
+    size_t i = 0U;
+
+    if( ( pxFields == NULL ) || ( xFieldCount > shadowjsonMAX_FIELDS ) )
+    {
+        xStatus = eShadowJsonBadParameter;
+    }
+
+    for( x = 0U; ( xStatus == eShadowJsonSuccess ) && ( x < xFieldCount ); x++ )
+    {
+        pxField = &pxFields[ x ];
+        pxField->ucSegmentCount = 0U;
+
+        if( ( pxField->pcPath == NULL ) || ( pxField->xPathLength == 0U ) || ( pxField->xPathLength > UINT8_MAX ) )
+        {
+            xStatus = eShadowJsonBadParameter;
+        }
+
+        xSegmentStart = 0U;
+
+        /* The end of the path closes the last segment like a dot. */
+        for( i = 0U; ( xStatus == eShadowJsonSuccess ) && ( i <= pxField->xPathLength ); i++ )
+        {
+            if( ( i == pxField->xPathLength ) || ( pxField->pcPath[ i ] == '.' ) )
+            {
+                if( ( i == xSegmentStart ) || ( pxField->ucSegmentCount == shadowjsonMAX_PATH_SEGMENTS ) )
+                {
+                    xStatus = eShadowJsonBadParameter;
+                }
+                else
+                {
+                    pxField->ucSegmentStart[ pxField->ucSegmentCount ] = ( uint8_t ) xSegmentStart;
+                    pxField->ucSegmentLength[ pxField->ucSegmentCount ] = ( uint8_t ) ( i - xSegmentStart );
+                    pxField->ucSegmentCount++;
+                    xSegmentStart = i + 1U;
+                }
+            }
+        }
+
+        if( xStatus != eShadowJsonSuccess )
+        {
+            LogError( ( "Invalid shadow JSON path: %.*s",
+                        ( pxField->pcPath != NULL ) ? ( int ) pxField->xPathLength : 0,
+                        ( pxField->pcPath != NULL ) ? pxField->pcPath : "" ) );
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowJsonStatus_t ShadowJson_Parse( const char * pcDocument,
+                                     size_t xLength,
+                                     ShadowJsonField_t * pxFields,
+                                     size_t xFieldCount )
+{
+    ShadowJsonStatus_t xStatus = eShadowJsonSuccess;
+    ShadowJsonLevel_t xStack[ shadowjsonconfigMAX_DEPTH ];
+    ShadowJsonLevel_t * pxTop = NULL;
+    ShadowJsonType_t eType = eShadowJsonNotFound;
+    size_t xDepth = 0U;
+    size_t xStart = 0U;
+    size_t i = 0U;
+    size_t x = 0U;
+    uint32_t ulChildMask = 0UL;
+    uint32_t ulValueMask = 0UL;
+    bool xValueDone = false;
+    bool xDocumentDone = false;
+
+    if( ( pcDocument == NULL ) || ( xLength == 0U ) ||
+        ( ( pxFields == NULL ) && ( xFieldCount > 0U ) ) ||
+        ( xFieldCount > shadowjsonMAX_FIELDS ) )
+    {
+        xStatus = eShadowJsonBadParameter;
+    }
+
+    /* Every compiled path starts as a candidate for the keys of the root
+     * object. */
+    for( x = 0U; ( xStatus == eShadowJsonSuccess ) && ( x < xFieldCount ); x++ )
+    {
+        pxFields[ x ].xValue.xOffset = 0U;
+        pxFields[ x ].xValue.xLength = 0U;
+        pxFields[ x ].xValue.eType = eShadowJsonNotFound;
+
+        if( pxFields[ x ].ucSegmentCount > 0U )
+        {
+            ulChildMask |= 1UL << x;
+        }
+    }
+
+    if( xStatus == eShadowJsonSuccess )
+    {
+        prvSkipSpace( pcDocument, xLength, &i );
+    }
+
+    while( ( xStatus == eShadowJsonSuccess ) && ( xDocumentDone == false ) )
+    {
+        /* A value starts at i. ulChildMask and ulValueMask describe the key
+         * it belongs to. */
+        xValueDone = false;
+
+        if( i >= xLength )
+        {
+            xStatus = eShadowJsonIllegalDocument;
+        }
+        else if( ( pcDocument[ i ] == '{' ) || ( pcDocument[ i ] == '[' ) )
+        {
+            if( xDepth == shadowjsonconfigMAX_DEPTH )
+            {
+                xStatus = eShadowJsonMaxDepthExceeded;
+            }
+            else
+            {
+                pxTop = &xStack[ xDepth ];
+                xDepth++;
+
+                /* Keys inside arrays never match a path. */
+                pxTop->ulChildMask = ( pcDocument[ i ] == '{' ) ? ulChildMask : 0UL;
+                pxTop->ulValueMask = ulValueMask;
+                pxTop->xStart = i;
+                pxTop->cClose = ( pcDocument[ i ] == '{' ) ? '}' : ']';
+
+                i++;
+                prvSkipSpace( pcDocument, xLength, &i );
+
+                if( ( i < xLength ) && ( pcDocument[ i ] == pxTop->cClose ) )
+                {
+                    /* Empty; closed below. */
+                    xValueDone = true;
+                }
+                else if( pxTop->cClose == '}' )
+                {
+                    if( prvParseKey( pcDocument, xLength, &i, pxFields, xDepth - 1U,
+                                     pxTop->ulChildMask, &ulChildMask, &ulValueMask ) == false )
+                    {
+                        xStatus = eShadowJsonIllegalDocument;
+                    }
+                }
+                else
+                {
+                    ulChildMask = 0UL;
+                    ulValueMask = 0UL;
+                }
+            }
+        }
+        else
+        {
+            xStart = i;
+
+            if( prvSkipScalar( pcDocument, xLength, &i, &eType ) == false )
+            {
+                xStatus = eShadowJsonIllegalDocument;
+            }
+            else if( ulValueMask != 0UL )
+            {
+                if( eType == eShadowJsonString )
+                {
+                    prvRecordValue( pxFields, ulValueMask, eType, xStart + 1U, i - xStart - 2U );
+                }
+                else
+                {
+                    prvRecordValue( pxFields, ulValueMask, eType, xStart, i - xStart );
+                }
+            }
+            else
+            {
+                /* Nobody asked for this value. */
+            }
+
+            xValueDone = true;
+        }
+
+        /* Close containers and move to the next member or element until a
+         * new value is due or the document ends. */
+        while( ( xStatus == eShadowJsonSuccess ) && ( xValueDone == true ) )
+        {
+            prvSkipSpace( pcDocument, xLength, &i );
+
+            if( xDepth == 0U )
+            {
+                /* Only trailing whitespace may follow the root value. */
+                if( i != xLength )
+                {
+                    xStatus = eShadowJsonIllegalDocument;
+                }
+
+                xValueDone = false;
+                xDocumentDone = true;
+            }
+            else if( i >= xLength )
+            {
+                xStatus = eShadowJsonIllegalDocument;
+            }
+            else if( pcDocument[ i ] == pxTop->cClose )
+            {
+                i++;
+
+                if( pxTop->ulValueMask != 0UL )
+                {
+                    prvRecordValue( pxFields,
+                                    pxTop->ulValueMask,
+                                    ( pxTop->cClose == '}' ) ? eShadowJsonObject : eShadowJsonArray,
+                                    pxTop->xStart,
+                                    i - pxTop->xStart );
+                }
+
+                xDepth--;
+                pxTop = ( xDepth > 0U ) ? &xStack[ xDepth - 1U ] : NULL;
+            }
+            else if( pcDocument[ i ] == ',' )
+            {
+                i++;
+                prvSkipSpace( pcDocument, xLength, &i );
+                xValueDone = false;
+
+                if( pxTop->cClose == '}' )
+                {
+                    if( prvParseKey( pcDocument, xLength, &i, pxFields, xDepth - 1U,
+                                     pxTop->ulChildMask, &ulChildMask, &ulValueMask ) == false )
+                    {
+                        xStatus = eShadowJsonIllegalDocument;
+                    }
+                }
+                else
+                {
+                    ulChildMask = 0UL;
+                    ulValueMask = 0UL;
+                }
+            }
+            else
+            {
+                xStatus = eShadowJsonIllegalDocument;
+            }
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowJsonStatus_t ShadowJson_GetUInt32( const char * pcDocument,
+                                         const ShadowJsonSlice_t * pxSlice,
+                                         uint32_t * pulValue )
+{
+    ShadowJsonStatus_t xStatus = eShadowJsonSuccess;
+    uint32_t ulValue = 0UL;
+    uint32_t ulDigit = 0UL;
+    size_t x = 0U;
+
+    if( ( pcDocument == NULL ) || ( pxSlice == NULL ) || ( pulValue == NULL ) )
+    {
+        xStatus = eShadowJsonBadParameter;
+    }
+    else if( ( ( pxSlice->eType != eShadowJsonNumber ) && ( pxSlice->eType != eShadowJsonString ) ) ||
+             ( pxSlice->xLength == 0U ) )
+    {
+        xStatus = eShadowJsonBadValue;
+    }
+    else
+    {
+        /* Only the slice is read, as the document is a receive buffer with
+         * no terminator; a sign, fraction or exponent ends the number. */
+        for( x = 0U; ( xStatus == eShadowJsonSuccess ) && ( x < pxSlice->xLength ); x++ )
+        {
+            ulDigit = ( uint32_t ) ( pcDocument[ pxSlice->xOffset + x ] - '0' );
+
+            if( ( ulDigit > 9UL ) || ( ulValue > ( ( UINT32_MAX - ulDigit ) / 10UL ) ) )
+            {
+                xStatus = eShadowJsonBadValue;
+            }
+            else
+            {
+                ulValue = ( ulValue * 10UL ) + ulDigit;
+            }
+        }
+    }
+
+    if( xStatus == eShadowJsonSuccess )
+    {
+        *pulValue = ulValue;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( shadowjsonconfigBENCHMARK_ITERATIONS > 0U )
+
+/**
+ * @brief Payloads recorded from the shadow topics of a test thing.
+ */
+    static const char * const pcBenchmarkPayloads[] =
+    {
+        /* /update/delta */
+        "{\"version\":14703,\"timestamp\":1596573660,\"state\":{\"powerOn\":1},"
+        "\"metadata\":{\"powerOn\":{\"timestamp\":1596573660}}}",
+
+        /* /update/accepted */
+        "{\"state\":{\"reported\":{\"powerOn\":1}},\"metadata\":{\"reported\":"
+        "{\"powerOn\":{\"timestamp\":1596573661}}},\"version\":14704,"
+        "\"timestamp\":1596573661,\"clientToken\":\"022485\"}",
+
+        /* /get/accepted */
+        "{\"state\":{\"desired\":{\"powerOn\":1},\"reported\":{\"powerOn\":0}},"
+        "\"metadata\":{\"desired\":{\"powerOn\":{\"timestamp\":1596573660}},"
+        "\"reported\":{\"powerOn\":{\"timestamp\":1596573647}}},"
+        "\"version\":14703,\"timestamp\":1596573702,\"clientToken\":\"022491\"}"
+    };
+
+/**
+ * @brief The keys the shadow task looks up in every payload.
+ */
+    static const char * const pcBenchmarkKeys[] =
+    {
+        "version",
+        "state.powerOn",
+        "clientToken"
+    };
+
+    #define shadowjsonBENCHMARK_PAYLOADS    ( sizeof( pcBenchmarkPayloads ) / sizeof( pcBenchmarkPayloads[ 0 ] ) )
+    #define shadowjsonBENCHMARK_KEYS        ( sizeof( pcBenchmarkKeys ) / sizeof( pcBenchmarkKeys[ 0 ] ) )
+
+#endif /* if ( shadowjsonconfigBENCHMARK_ITERATIONS > 0U ) */
+
+void ShadowJson_RunBenchmark( void )
+{
+    #if ( shadowjsonconfigBENCHMARK_ITERATIONS > 0U )
+        ShadowJsonField_t xFields[ shadowjsonBENCHMARK_KEYS ];
+        MQTTMetricsTimestamp_t xStart;
+        size_t xPayloadLength = 0U;
+        size_t xOutLength = 0U;
+        char * pcOut = NULL;
+        uint32_t ulSearchUs = 0UL;
+        uint32_t ulParseUs = 0UL;
+        uint32_t ulIteration = 0UL;
+        size_t xPayload = 0U;
+        size_t xKey = 0U;
+
+        for( xKey = 0U; xKey < shadowjsonBENCHMARK_KEYS; xKey++ )
+        {
+            xFields[ xKey ].pcPath = pcBenchmarkKeys[ xKey ];
+            xFields[ xKey ].xPathLength = strlen( pcBenchmarkKeys[ xKey ] );
+        }
+
+        ( void ) ShadowJson_Compile( xFields, shadowjsonBENCHMARK_KEYS );
+
+        for( xPayload = 0U; xPayload < shadowjsonBENCHMARK_PAYLOADS; xPayload++ )
+        {
+            xPayloadLength = strlen( pcBenchmarkPayloads[ xPayload ] );
+
+            /* The approach the shadow handlers used: validate, then one
+             * search per key, each starting from the top of the document. */
+            MQTTMetrics_Start( &xStart );
+
+            for( ulIteration = 0UL; ulIteration < shadowjsonconfigBENCHMARK_ITERATIONS; ulIteration++ )
+            {
+                if( JSON_Validate( pcBenchmarkPayloads[ xPayload ], xPayloadLength ) == JSONSuccess )
+                {
+                    for( xKey = 0U; xKey < shadowjsonBENCHMARK_KEYS; xKey++ )
+                    {
+                        ( void ) JSON_Search( ( char * ) pcBenchmarkPayloads[ xPayload ],
+                                              xPayloadLength,
+                                              pcBenchmarkKeys[ xKey ],
+                                              xFields[ xKey ].xPathLength,
+                                              &pcOut,
+                                              &xOutLength );
+                    }
+                }
+            }
+
+            ulSearchUs = MQTTMetrics_ElapsedUs( &xStart );
+
+            MQTTMetrics_Start( &xStart );
+
+            for( ulIteration = 0UL; ulIteration < shadowjsonconfigBENCHMARK_ITERATIONS; ulIteration++ )
+            {
+                ( void ) ShadowJson_Parse( pcBenchmarkPayloads[ xPayload ],
+                                           xPayloadLength,
+                                           xFields,
+                                           shadowjsonBENCHMARK_KEYS );
+            }
+
+            ulParseUs = MQTTMetrics_ElapsedUs( &xStart );
+
+            LogInfo( ( "Payload %u (%u bytes): validate+search %lu ns, single pass %lu ns per document.",
+                       ( unsigned ) xPayload,
+                       ( unsigned ) xPayloadLength,
+                       ( unsigned long ) ( ( ( uint64_t ) ulSearchUs * 1000ULL ) / shadowjsonconfigBENCHMARK_ITERATIONS ),
+                       ( unsigned long ) ( ( ( uint64_t ) ulParseUs * 1000ULL ) / shadowjsonconfigBENCHMARK_ITERATIONS ) ) );
+        }
+    #endif /* if ( shadowjsonconfigBENCHMARK_ITERATIONS > 0U ) */
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,209 @@
+/*
+ * shadow_request.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file shadow_request.c
+ *
+ * @brief Correlation table for shadow requests in flight.
+ *
+ * The table holds a handful of slots, so lookups are linear scans.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "shadow_request.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Free slot @p xIndex, copying it to @p pxRequest first.
+ */
+static void prvTakeSlot( ShadowRequestTable_t * pxTable,
+                         size_t xIndex,
+                         ShadowRequest_t * pxRequest );
+
+/**
+ * @brief Whether @p ulClientToken belongs to a request in flight.
+ */
+static bool prvTokenInUse( const ShadowRequestTable_t * pxTable,
+                           uint32_t ulClientToken );
+
+/*-----------------------------------------------------------*/
+
+static void prvTakeSlot( ShadowRequestTable_t * pxTable,
+                         size_t xIndex,
+                         ShadowRequest_t * pxRequest )
+{
+    if( pxRequest != NULL )
+    {
+        *pxRequest = pxTable->pxSlots[ xIndex ];
+    }
+
+    ( void ) memset( &pxTable->pxSlots[ xIndex ], 0, sizeof( ShadowRequest_t ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvTokenInUse( const ShadowRequestTable_t * pxTable,
+                           uint32_t ulClientToken )
+{
+    bool xInUse = false;
+    size_t x = 0U;
+
+    for( x = 0U; ( xInUse == false ) && ( x < pxTable->xSlotCount ); x++ )
+    {
+        xInUse = ( pxTable->pxSlots[ x ].ulClientToken == ulClientToken );
+    }
+
+    return xInUse;
+}
+
+/*-----------------------------------------------------------*/
+
+void ShadowRequest_Init( ShadowRequestTable_t * pxTable )
+{
+    assert( pxTable != NULL );
+
+    ( void ) memset( pxTable->pxSlots, 0, pxTable->xSlotCount * sizeof( ShadowRequest_t ) );
+    pxTable->ulLastToken = ( uint32_t ) ( xTaskGetTickCount() % shadowrequestMAX_TOKEN );
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowRequest_t * ShadowRequest_Add( ShadowRequestTable_t * pxTable )
+{
+    ShadowRequest_t * pxSlot = NULL;
+    uint32_t ulToken = 0UL;
+    size_t x = 0U;
+
+    assert( pxTable != NULL );
+
+    for( x = 0U; ( pxSlot == NULL ) && ( x < pxTable->xSlotCount ); x++ )
+    {
+        if( pxTable->pxSlots[ x ].ulClientToken == 0UL )
+        {
+            pxSlot = &pxTable->pxSlots[ x ];
+        }
+    }
+
+    if( pxSlot != NULL )
+    {
+        /* Tokens count up and wrap, skipping 0 and any still in flight. A
+         * late response to an expired request therefore matches nothing. */
+        ulToken = pxTable->ulLastToken;
+
+        do
+        {
+            ulToken = ( ulToken >= shadowrequestMAX_TOKEN ) ? 1UL : ( ulToken + 1UL );
+        } while( prvTokenInUse( pxTable, ulToken ) == true );
+
+        pxTable->ulLastToken = ulToken;
+
+        pxSlot->ulClientToken = ulToken;
+        pxSlot->xSentAt = xTaskGetTickCount();
+        MQTTMetrics_Start( &pxSlot->xStartedAt );
+    }
+
+    return pxSlot;
+}
+
+/*-----------------------------------------------------------*/
+
+bool ShadowRequest_Complete( ShadowRequestTable_t * pxTable,
+                             uint32_t ulClientToken,
+                             ShadowRequest_t * pxRequest )
+{
+    bool xFound = false;
+    size_t x = 0U;
+
+    assert( pxTable != NULL );
+
+    for( x = 0U; ( ulClientToken != 0UL ) && ( xFound == false ) && ( x < pxTable->xSlotCount ); x++ )
+    {
+        if( pxTable->pxSlots[ x ].ulClientToken == ulClientToken )
+        {
+            prvTakeSlot( pxTable, x, pxRequest );
+            xFound = true;
+        }
+    }
+
+    return xFound;
+}
+
+/*-----------------------------------------------------------*/
+
+bool ShadowRequest_TakeExpired( ShadowRequestTable_t * pxTable,
+                                ShadowRequest_t * pxRequest )
+{
+    TickType_t xNow = xTaskGetTickCount();
+    bool xFound = false;
+    size_t x = 0U;
+
+    assert( pxTable != NULL );
+
+    for( x = 0U; ( xFound == false ) && ( x < pxTable->xSlotCount ); x++ )
+    {
+        if( ( pxTable->pxSlots[ x ].ulClientToken != 0UL ) &&
+            ( ( xNow - pxTable->pxSlots[ x ].xSentAt ) >= pxTable->xTimeoutTicks ) )
+        {
+            prvTakeSlot( pxTable, x, pxRequest );
+            xFound = true;
+        }
+    }
+
+    return xFound;
+}
+
+/*-----------------------------------------------------------*/
+
+bool ShadowRequest_TakeAny( ShadowRequestTable_t * pxTable,
+                            ShadowRequest_t * pxRequest )
+{
+    bool xFound = false;
+    size_t x = 0U;
+
+    assert( pxTable != NULL );
+
+    for( x = 0U; ( xFound == false ) && ( x < pxTable->xSlotCount ); x++ )
+    {
+        if( pxTable->pxSlots[ x ].ulClientToken != 0UL )
+        {
+            prvTakeSlot( pxTable, x, pxRequest );
+            xFound = true;
+        }
+    }
+
+    return xFound;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t ShadowRequest_InFlight( const ShadowRequestTable_t * pxTable )
+{
+    size_t xInFlight = 0U;
+    size_t x = 0U;
+
+    assert( pxTable != NULL );
+
+    for( x = 0U; x < pxTable->xSlotCount; x++ )
+    {
+        if( pxTable->pxSlots[ x ].ulClientToken != 0UL )
+        {
+            xInFlight++;
+        }
+    }
+
+    return xInFlight;
+}
+
+/*-----------------------------------------------------------*/
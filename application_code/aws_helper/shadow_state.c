@@ -0,0 +1,455 @@
+/*
+ * shadow_state.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file shadow_state.c
+ *
+ * @brief Local model of the reported section of a device shadow.
+ *
+ * A report is written straight into the caller's buffer, property by
+ * property, so its cost grows with the number of dirty properties rather
+ * than with the size of the table.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+#include "shadow_state.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Longest decimal rendering of a 32-bit value, with its sign.
+ */
+#define shadowstateMAX_NUMBER_LENGTH    ( 11U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Look up a property of the given type.
+ *
+ * @return The property, or NULL if @p xIndex is out of range or the property
+ * has another type.
+ */
+static ShadowStateProperty_t * prvGetProperty( const ShadowStateModel_t * pxModel,
+                                               size_t xIndex,
+                                               ShadowStateType_t eType );
+
+/**
+ * @brief Append @p xTextLength bytes to the document, keeping room for a
+ * terminator.
+ *
+ * @return true if the text fits.
+ */
+static bool prvAppend( char * pcBuffer,
+                       size_t xBufferSize,
+                       size_t * pxOffset,
+                       const char * pcText,
+                       size_t xTextLength );
+
+/**
+ * @brief Append one property as "name":value.
+ *
+ * @return true if the property fits.
+ */
+static bool prvAppendProperty( char * pcBuffer,
+                               size_t xBufferSize,
+                               size_t * pxOffset,
+                               const ShadowStateProperty_t * pxProperty );
+
+/*-----------------------------------------------------------*/
+
+static ShadowStateProperty_t * prvGetProperty( const ShadowStateModel_t * pxModel,
+                                               size_t xIndex,
+                                               ShadowStateType_t eType )
+{
+    ShadowStateProperty_t * pxProperty = NULL;
+
+    if( ( pxModel != NULL ) &&
+        ( xIndex < pxModel->xPropertyCount ) &&
+        ( pxModel->pxProperties[ xIndex ].eType == eType ) )
+    {
+        pxProperty = &pxModel->pxProperties[ xIndex ];
+    }
+
+    return pxProperty;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvAppend( char * pcBuffer,
+                       size_t xBufferSize,
+                       size_t * pxOffset,
+                       const char * pcText,
+                       size_t xTextLength )
+{
+    bool xFits = ( ( *pxOffset + xTextLength ) < xBufferSize );
+
+    if( xFits == true )
+    {
+        ( void ) memcpy( &pcBuffer[ *pxOffset ], pcText, xTextLength );
+        *pxOffset += xTextLength;
+    }
+
+    return xFits;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvAppendProperty( char * pcBuffer,
+                               size_t xBufferSize,
+                               size_t * pxOffset,
+                               const ShadowStateProperty_t * pxProperty )
+{
+    char cNumber[ shadowstateMAX_NUMBER_LENGTH + 1U ];
+    const char * pcChar = NULL;
+    bool xFits = true;
+
+    xFits = prvAppend( pcBuffer, xBufferSize, pxOffset, "\"", 1U ) &&
+            prvAppend( pcBuffer, xBufferSize, pxOffset, pxProperty->pcName, pxProperty->xNameLength ) &&
+            prvAppend( pcBuffer, xBufferSize, pxOffset, "\":", 2U );
+
+    if( xFits == true )
+    {
+        if( pxProperty->eType == eShadowStateBool )
+        {
+            xFits = ( pxProperty->lValue != 0 ) ?
+                    prvAppend( pcBuffer, xBufferSize, pxOffset, "true", 4U ) :
+                    prvAppend( pcBuffer, xBufferSize, pxOffset, "false", 5U );
+        }
+        else if( pxProperty->eType == eShadowStateInt )
+        {
+            ( void ) snprintf( cNumber, sizeof( cNumber ), "%ld", ( long ) pxProperty->lValue );
+            xFits = prvAppend( pcBuffer, xBufferSize, pxOffset, cNumber, strlen( cNumber ) );
+        }
+        else
+        {
+            /* Strings hold no control characters, so only quotes and
+             * backslashes need escaping. */
+            xFits = prvAppend( pcBuffer, xBufferSize, pxOffset, "\"", 1U );
+
+            for( pcChar = pxProperty->pcString; ( xFits == true ) && ( *pcChar != '\0' ); pcChar++ )
+            {
+                if( ( *pcChar == '"' ) || ( *pcChar == '\\' ) )
+                {
+                    xFits = prvAppend( pcBuffer, xBufferSize, pxOffset, "\\", 1U );
+                }
+
+                if( xFits == true )
+                {
+                    xFits = prvAppend( pcBuffer, xBufferSize, pxOffset, pcChar, 1U );
+                }
+            }
+
+            if( xFits == true )
+            {
+                xFits = prvAppend( pcBuffer, xBufferSize, pxOffset, "\"", 1U );
+            }
+        }
+    }
+
+    return xFits;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowStateStatus_t ShadowState_Init( ShadowStateModel_t * pxModel )
+{
+    ShadowStateStatus_t xStatus = eShadowStateSuccess;
+    size_t x = 0U;
+
+    if( ( pxModel == NULL ) || ( pxModel->pxProperties == NULL ) ||
+        ( pxModel->xPropertyCount == 0U ) || ( pxModel->xPropertyCount > shadowstateMAX_PROPERTIES ) )
+    {
+        xStatus = eShadowStateBadParameter;
+    }
+
+    for( x = 0U; ( xStatus == eShadowStateSuccess ) && ( x < pxModel->xPropertyCount ); x++ )
+    {
+        if( pxModel->pxProperties[ x ].eType == eShadowStateString )
+        {
+            if( ( pxModel->pxProperties[ x ].pcString == NULL ) || ( pxModel->pxProperties[ x ].xStringSize == 0U ) )
+            {
+                xStatus = eShadowStateBadParameter;
+            }
+            else
+            {
+                pxModel->pxProperties[ x ].pcString[ 0 ] = '\0';
+            }
+        }
+    }
+
+    if( xStatus == eShadowStateSuccess )
+    {
+        pxModel->ulVersion = 0UL;
+        pxModel->ulChanges = 0UL;
+        ShadowState_MarkAllDirty( pxModel );
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowStateStatus_t ShadowState_SetBool( ShadowStateModel_t * pxModel,
+                                         size_t xIndex,
+                                         bool xValue )
+{
+    ShadowStateStatus_t xStatus = eShadowStateSuccess;
+    ShadowStateProperty_t * pxProperty = prvGetProperty( pxModel, xIndex, eShadowStateBool );
+    int32_t lValue = ( xValue == true ) ? 1 : 0;
+
+    if( pxProperty == NULL )
+    {
+        xStatus = eShadowStateBadParameter;
+    }
+    else if( pxProperty->lValue != lValue )
+    {
+        pxProperty->lValue = lValue;
+        pxModel->ulDirty |= 1UL << xIndex;
+        pxModel->ulChanges++;
+    }
+    else
+    {
+        /* Unchanged; nothing to report. */
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowStateStatus_t ShadowState_SetInt( ShadowStateModel_t * pxModel,
+                                        size_t xIndex,
+                                        int32_t lValue )
+{
+    ShadowStateStatus_t xStatus = eShadowStateSuccess;
+    ShadowStateProperty_t * pxProperty = prvGetProperty( pxModel, xIndex, eShadowStateInt );
+
+    if( pxProperty == NULL )
+    {
+        xStatus = eShadowStateBadParameter;
+    }
+    else if( pxProperty->lValue != lValue )
+    {
+        pxProperty->lValue = lValue;
+        pxModel->ulDirty |= 1UL << xIndex;
+        pxModel->ulChanges++;
+    }
+    else
+    {
+        /* Unchanged; nothing to report. */
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowStateStatus_t ShadowState_SetString( ShadowStateModel_t * pxModel,
+                                           size_t xIndex,
+                                           const char * pcValue )
+{
+    ShadowStateStatus_t xStatus = eShadowStateSuccess;
+    ShadowStateProperty_t * pxProperty = prvGetProperty( pxModel, xIndex, eShadowStateString );
+    size_t xLength = 0U;
+    size_t x = 0U;
+
+    if( ( pxProperty == NULL ) || ( pcValue == NULL ) )
+    {
+        xStatus = eShadowStateBadParameter;
+    }
+    else
+    {
+        xLength = strlen( pcValue );
+
+        if( xLength >= pxProperty->xStringSize )
+        {
+            xStatus = eShadowStateBadParameter;
+        }
+
+        for( x = 0U; ( xStatus == eShadowStateSuccess ) && ( x < xLength ); x++ )
+        {
+            if( ( uint8_t ) pcValue[ x ] < 0x20U )
+            {
+                xStatus = eShadowStateBadParameter;
+            }
+        }
+    }
+
+    if( ( xStatus == eShadowStateSuccess ) && ( strcmp( pxProperty->pcString, pcValue ) != 0 ) )
+    {
+        ( void ) memcpy( pxProperty->pcString, pcValue, xLength + 1U );
+        pxModel->ulDirty |= 1UL << xIndex;
+        pxModel->ulChanges++;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t ShadowState_GetInt( const ShadowStateModel_t * pxModel,
+                            size_t xIndex )
+{
+    const ShadowStateProperty_t * pxProperty = prvGetProperty( pxModel, xIndex, eShadowStateInt );
+
+    if( pxProperty == NULL )
+    {
+        pxProperty = prvGetProperty( pxModel, xIndex, eShadowStateBool );
+    }
+
+    return ( pxProperty != NULL ) ? pxProperty->lValue : 0;
+}
+
+/*-----------------------------------------------------------*/
+
+const char * ShadowState_GetString( const ShadowStateModel_t * pxModel,
+                                    size_t xIndex )
+{
+    const ShadowStateProperty_t * pxProperty = prvGetProperty( pxModel, xIndex, eShadowStateString );
+
+    return ( pxProperty != NULL ) ? pxProperty->pcString : NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+bool ShadowState_IsDirty( const ShadowStateModel_t * pxModel )
+{
+    return( pxModel->ulDirty != 0UL );
+}
+
+/*-----------------------------------------------------------*/
+
+void ShadowState_MarkAllDirty( ShadowStateModel_t * pxModel )
+{
+    if( pxModel->xPropertyCount == shadowstateMAX_PROPERTIES )
+    {
+        pxModel->ulDirty = UINT32_MAX;
+    }
+    else
+    {
+        pxModel->ulDirty = ( 1UL << pxModel->xPropertyCount ) - 1UL;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool ShadowState_UpdateVersion( ShadowStateModel_t * pxModel,
+                                uint32_t ulVersion )
+{
+    bool xNewer = ( ulVersion > pxModel->ulVersion );
+
+    if( xNewer == true )
+    {
+        pxModel->ulVersion = ulVersion;
+    }
+
+    return xNewer;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowStateStatus_t ShadowState_SerializeReported( ShadowStateModel_t * pxModel,
+                                                   char * pcBuffer,
+                                                   size_t xBufferSize,
+                                                   uint32_t ulClientToken,
+                                                   bool xConditional,
+                                                   size_t * pxLength,
+                                                   uint32_t * pulMask )
+{
+    ShadowStateStatus_t xStatus = eShadowStateSuccess;
+    char cTrailer[ sizeof( "}},\"version\":,\"clientToken\":\"\"}" ) + ( 2U * shadowstateMAX_NUMBER_LENGTH ) ];
+    size_t xOffset = 0U;
+    size_t x = 0U;
+    uint32_t ulDirty = 0UL;
+    bool xFits = true;
+    bool xFirst = true;
+    int lTrailerLength = 0;
+
+    if( ( pxModel == NULL ) || ( pcBuffer == NULL ) || ( pxLength == NULL ) || ( pulMask == NULL ) )
+    {
+        xStatus = eShadowStateBadParameter;
+    }
+    else
+    {
+        ulDirty = pxModel->ulDirty;
+
+        if( ulDirty == 0UL )
+        {
+            xStatus = eShadowStateNothingToReport;
+        }
+    }
+
+    if( xStatus == eShadowStateSuccess )
+    {
+        xFits = prvAppend( pcBuffer, xBufferSize, &xOffset, "{\"state\":{\"reported\":{", 22U );
+
+        for( x = 0U; ( xFits == true ) && ( x < pxModel->xPropertyCount ); x++ )
+        {
+            if( ( ulDirty & ( 1UL << x ) ) != 0UL )
+            {
+                if( xFirst == false )
+                {
+                    xFits = prvAppend( pcBuffer, xBufferSize, &xOffset, ",", 1U );
+                }
+
+                xFirst = false;
+
+                if( xFits == true )
+                {
+                    xFits = prvAppendProperty( pcBuffer, xBufferSize, &xOffset, &pxModel->pxProperties[ x ] );
+                }
+            }
+        }
+
+        /* Without a known version the update cannot be conditional. */
+        if( ( xConditional == true ) && ( pxModel->ulVersion != 0UL ) )
+        {
+            lTrailerLength = snprintf( cTrailer, sizeof( cTrailer ), "}},\"version\":%lu,\"clientToken\":\"%06lu\"}",
+                                       ( unsigned long ) pxModel->ulVersion,
+                                       ( unsigned long ) ulClientToken );
+        }
+        else
+        {
+            lTrailerLength = snprintf( cTrailer, sizeof( cTrailer ), "}},\"clientToken\":\"%06lu\"}",
+                                       ( unsigned long ) ulClientToken );
+        }
+
+        if( xFits == true )
+        {
+            xFits = prvAppend( pcBuffer, xBufferSize, &xOffset, cTrailer, ( size_t ) lTrailerLength );
+        }
+
+        if( xFits == true )
+        {
+            pcBuffer[ xOffset ] = '\0';
+            *pxLength = xOffset;
+
+            *pulMask = ulDirty;
+            pxModel->ulDirty = 0UL;
+            pxModel->ulChanges = 0UL;
+        }
+        else
+        {
+            xStatus = eShadowStateBufferTooSmall;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void ShadowState_OnReportFailed( ShadowStateModel_t * pxModel,
+                                 uint32_t ulMask )
+{
+    pxModel->ulDirty |= ulMask;
+}
+
+/*-----------------------------------------------------------*/
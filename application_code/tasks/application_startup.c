@@ -12,6 +12,13 @@
 #include "mqtt_auth.h"
 #include "mqtt_shadow.h"
 #include "ota.h"
+#include "publish_queue.h"
+#include "mqtt_metrics.h"
+#include "ota_mqtt.h"
+
+/* Demo task priority and stack size. */
+#include "aws_demo_config.h"
+#include "platform/iot_threads.h"
 
 /* Wi-Fi Interface files. */
 #include "iot_wifi.h"
@@ -25,16 +32,29 @@ void startup(void * params){
 
     WIFI_On();
 
+    /* The file system needs the network processor, which WIFI_On() starts.
+     * Act on the last known shadow state before connecting; it is checked
+     * against the cloud once the session is up. */
+    RestoreDeviceShadowState();
+
+    /* Bring the queue up before connecting so telemetry can be stored while
+     * offline and segments left in flash are recovered. */
+    PublishQueue_Init();
+    MQTTMetrics_Init();
+
+    /* OTA reaches the broker through the shadow connection. */
+    OtaMqtt_Init();
+
     xWifiStatus = WIFI_ConnectAP( NULL );
     if(xWifiStatus == eWiFiSuccess)
     {
-        //vStartOTAUpdateDemoTask(NULL);
-        //RunCoreMqttMutualAuthDemo();
-        RunDeviceShadowDemo();
-        /*Iot_CreateDetachedThread( vStartOTAUpdateDemoTask,
+        /* The OTA task connects once the shadow session is up. */
+        Iot_CreateDetachedThread( vStartOTAUpdateDemoTask,
                                   NULL,
                                   democonfigDEMO_PRIORITY,
-                                  democonfigDEMO_STACKSIZE );*/
+                                  democonfigDEMO_STACKSIZE );
+        //RunCoreMqttMutualAuthDemo();
+        RunDeviceShadowDemo();
     }else{
         WIFI_Off();
         AP_Task(NULL);
@@ -8,6 +8,19 @@
 #ifndef APPLICATION_CODE_TASKS_INCLUDE_MQTT_SHADOW_H_
 #define APPLICATION_CODE_TASKS_INCLUDE_MQTT_SHADOW_H_
 
+#include "FreeRTOS.h"
+
+/**
+ * @brief Initialize the device's shadow state and apply the state cached in
+ * flash by the last session, if any, so the device acts on it before it is
+ * connected. The cache is read from the file system, so call it at startup
+ * after WIFI_On() started the network processor; RunDeviceShadowDemo()
+ * calls it if it was not.
+ *
+ * @return pdPASS; pdFAIL if the state model is invalid.
+ */
+BaseType_t RestoreDeviceShadowState( void );
+
 int RunDeviceShadowDemo();
 
 
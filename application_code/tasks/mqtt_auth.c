@@ -69,6 +69,9 @@
 /* Transport interface implementation include header for TLS. */
 #include "transport_secure_sockets.h"
 
+/* Shared buffer pool. */
+#include "buffer_pool.h"
+
 /* Include header for connection configurations. */
 #include "aws_clientcredential.h"
 #include "aws_clientcredential_keys.h"
@@ -379,11 +382,6 @@ static MQTTStatus_t prvWaitForPacket( MQTTContext_t * pxMQTTContext,
 
 /*-----------------------------------------------------------*/
 
-/**
- * @brief Static buffer used to hold MQTT messages being sent and received.
- */
-static uint8_t ucSharedBuffer[ democonfigNETWORK_BUFFER_SIZE ];
-
 /**
  * @brief Global entry time into the application to use as a reference timestamp
  * in the #prvGetTimeMs function. #prvGetTimeMs will always return the difference
@@ -444,11 +442,12 @@ static topicFilterContext_t xTopicFilterContext[ mqttexampleTOPIC_COUNT ] =
 };
 
 
-/** @brief Static buffer used to hold MQTT messages being sent and received. */
+/** @brief Buffer used to hold MQTT messages being sent and received. It is
+ * borrowed from the shared buffer pool while the demo runs. */
 static MQTTFixedBuffer_t xBuffer =
 {
-    ucSharedBuffer,
-    democonfigNETWORK_BUFFER_SIZE
+    NULL,
+    0U
 };
 
 /*-----------------------------------------------------------*/
@@ -493,6 +492,16 @@ int RunCoreMqttMutualAuthDemo()
     ulGlobalEntryTimeMs = prvGetTimeMs();
     xNetworkContext.pParams = &secureSocketsTransportParams;
 
+    xBuffer.pBuffer = BufferPool_Acquire( democonfigNETWORK_BUFFER_SIZE );
+
+    if( xBuffer.pBuffer == NULL )
+    {
+        LogError( ( "No buffer available for the MQTT network buffer." ) );
+        return EXIT_FAILURE;
+    }
+
+    xBuffer.size = democonfigNETWORK_BUFFER_SIZE;
+
     for( ulDemoRunCount = 0UL; ( ulDemoRunCount < democonfigMQTT_MAX_DEMO_COUNT ); ulDemoRunCount++ )
     {
         /****************************** Connect. ******************************/
@@ -630,6 +639,10 @@ int RunCoreMqttMutualAuthDemo()
         vTaskDelay( mqttexampleDELAY_BETWEEN_DEMO_ITERATIONS_TICKS );
     }
 
+    BufferPool_Release( xBuffer.pBuffer );
+    xBuffer.pBuffer = NULL;
+    xBuffer.size = 0U;
+
     /* Demo run is considered successful if more than half of
      * #democonfigMQTT_MAX_DEMO_COUNT is successful. */
     if( ulDemoSuccessCount > ( democonfigMQTT_MAX_DEMO_COUNT / 2 ) )
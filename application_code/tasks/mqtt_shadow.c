@@ -42,24 +42,23 @@
  * This example assumes there is a powerOn state in the device shadow. It does the
  * following operations:
  * 1. Establish a MQTT connection by using the helper functions in shadow_demo_helpers.c.
- * 2. Assemble strings for the MQTT topics of device shadow, by using macros defined by the Device Shadow library.
- * 3. Subscribe to those MQTT topics by using helper functions in shadow_demo_helpers.c.
+ * 2. Register the shadow with the shadow client (shadow_client.c), which builds its MQTT topics once. The
+ * shadow is the classic one unless democonfigSHADOW_NAME names a named shadow.
+ * 3. Subscribe to those MQTT topics through the shadow client.
  * 4. Publish a desired state of powerOn by using helper functions in shadow_demo_helpers.c.  That will cause
  * a delta message to be sent to device.
- * 5. Handle incoming MQTT messages in prvEventCallback, determine whether the message is related to the device
- * shadow by using a function defined by the Device Shadow library (Shadow_MatchTopic). If the message is a
+ * 5. Handle incoming MQTT messages in prvEventCallback, and let the shadow client determine which registered
+ * shadow the message belongs to and hand it to prvShadowCallback. If the message is a
  * device shadow delta message, set a flag for the main function to know, then the main function will publish
  * a second message to update the reported state of powerOn.
  * 6. Handle incoming message again in prvEventCallback. If the message is from update/accepted, verify that it
- * has the same clientToken as previously published in the update message. That will mark the end of the demo.
+ * has the same clientToken as previously published in the update message. That completes a state sync.
+ * 7. Keep the session open and report the new state each time a delta arrives, reusing the subscriptions.
  *
- * @note This demo uses retry logic to connect to AWS IoT broker if connection attempts fail.
- * The FreeRTOS/backoffAlgorithm library is used to calculate the retry interval with an exponential
- * backoff and jitter algorithm. For generating random number required by the algorithm, the PKCS11
- * module is used as it allows access to a True Random Number Generator (TRNG) if the vendor platform
- * supports it.
- * It is RECOMMENDED to seed the random number generator with a device-specific entropy source so that
- * probability of collisions from devices in connection retries is mitigated.
+ * @note Connection attempts are retried by the reconnect engine used by the helpers in
+ * mqtt_demo_helpers.c, with decorrelated jitter backoff. For generating the random numbers it
+ * needs, the PKCS11 module is used as it allows access to a True Random Number Generator (TRNG)
+ * if the vendor platform supports it.
  *
  */
 
@@ -76,101 +75,64 @@
 /* Kernel includes. */
 #include "FreeRTOS.h"
 #include "task.h"
-#include "semphr.h"
 #include "event_groups.h"
 
 /* SHADOW API header. */
 #include "shadow.h"
 
-/* JSON library includes. */
-#include "core_json.h"
+/* Single-pass JSON extractor. */
+#include "shadow_json.h"
+
+/* Local shadow state model. */
+#include "shadow_state.h"
+
+/* Shadow request correlation include. */
+#include "shadow_request.h"
+
+/* Shadow client include. */
+#include "shadow_client.h"
+
+/* Shadow state cache include. */
+#include "shadow_cache.h"
+
+/* Binary shadow section codec. */
+#include "shadow_cbor.h"
+
+/* OTA traffic carried over this connection. */
+#include "ota_mqtt.h"
 
 /* shadow demo helpers header. */
 #include "mqtt_demo_helpers.h"
 
-/* Transport interface implementation include header for TLS. */
-#include "transport_secure_sockets.h"
+/* Store-and-forward publish queue. */
+#include "publish_queue.h"
 
-/**
- * @brief Format string representing a Shadow document with a "desired" state.
- *
- * The real json document will look like this:
- * {
- *   "state": {
- *     "desired": {
- *       "powerOn": 1
- *     }
- *   },
- *   "clientToken": "021909"
- * }
- *
- * Note the client token, which is optional for all Shadow updates. The client
- * token must be unique at any given time, but may be reused once the update is
- * completed. For this demo, a timestamp is used for a client token.
- */
-#define SHADOW_DESIRED_JSON     \
-    "{"                         \
-    "\"state\":{"               \
-    "\"desired\":{"             \
-    "\"powerOn\":%01d"          \
-    "}"                         \
-    "},"                        \
-    "\"version\":%lu,"      \
-    "\"clientToken\":\"%06lu\"" \
-    "}"
+/* Shared buffer pool. */
+#include "buffer_pool.h"
 
-/**
- * @brief The expected size of #SHADOW_DESIRED_JSON.
- *
- * Because all the format specifiers in #SHADOW_DESIRED_JSON include a length,
- * its full actual size is known by pre-calculation, here's the formula why
- * the length need to minus 3:
- * 1. The length of "%01d" is 4.
- * 2. The length of %06lu is 5.
- * 3. The actual length we will use in case 1. is 1 ( for the state of powerOn ).
- * 4. The actual length we will use in case 2. is 6 ( for the clientToken length ).
- * 5. Thus the additional size 3 = 4 + 5 - 1 - 6 + 1 (termination character).
- *
- * In your own application, you could calculate the size of the json doc in this way.
- */
-#define SHADOW_DESIRED_JSON_LENGTH    ( sizeof( SHADOW_DESIRED_JSON ) - 3 )
+/* Latency histograms and counters. */
+#include "mqtt_metrics.h"
+
+/* Transport interface implementation include header for TLS. */
+#include "transport_secure_sockets.h"
 
 /**
- * @brief Format string representing a Shadow document with a "reported" state.
+ * @brief Size of the buffer an update document is written in. It must hold
+ * a report of every property, which is sent after boot.
  *
- * The real json document will look like this:
+ * The real json document will look like this, carrying only the properties
+ * that changed since the last accepted report:
  * {
  *   "state": {
  *     "reported": {
  *       "powerOn": 1
  *     }
  *   },
+ *   "version": 14703,
  *   "clientToken": "021909"
  * }
- *
- * Note the client token, which is required for all Shadow updates. The client
- * token must be unique at any given time, but may be reused once the update is
- * completed. For this demo, a timestamp is used for a client token.
- */
-#define SHADOW_REPORTED_JSON    \
-    "{"                         \
-    "\"state\":{"               \
-    "\"reported\":{"            \
-    "\"powerOn\":%01d"          \
-    "}"                         \
-    "},"                        \
-    "\"version\":%lu,"      \
-    "\"clientToken\":\"%06lu\"" \
-    "}"
-
-/**
- * @brief The expected size of #SHADOW_REPORTED_JSON.
- *
- * Because all the format specifiers in #SHADOW_REPORTED_JSON include a length,
- * its full size is known at compile-time by pre-calculation. Users could refer to
- * the way how to calculate the actual length in #SHADOW_DESIRED_JSON_LENGTH.
  */
-#define SHADOW_REPORTED_JSON_LENGTH    ( sizeof( SHADOW_REPORTED_JSON ) - 3 )
+#define SHADOW_REPORT_BUFFER_SIZE    ( 128U )
 
 #ifndef THING_NAME
 
@@ -188,17 +150,32 @@
 #define THING_NAME_LENGTH    ( ( uint16_t ) ( sizeof( THING_NAME ) - 1 ) )
 
 /**
- * @brief The maximum number of times to run the loop in this demo.
+ * @brief The number of reports in a row that may be rejected or go
+ * unanswered before the session is given up.
  */
-#ifndef SHADOW_MAX_DEMO_COUNT
-    #define SHADOW_MAX_DEMO_COUNT    ( 3 )
+#ifndef SHADOW_MAX_SYNC_ATTEMPTS
+    #define SHADOW_MAX_SYNC_ATTEMPTS    ( 3 )
 #endif
 
 /**
- * @brief Time in ticks to wait between each cycle of the demo implemented
- * by RunDeviceShadowDemo().
+ * @brief The maximum time to wait for the answer to a shadow request, in
+ * milliseconds.
  */
-#define DELAY_BETWEEN_DEMO_ITERATIONS_TICKS             ( pdMS_TO_TICKS( 5000U ) )
+#define SHADOW_RESPONSE_TIMEOUT_MS                      ( 5000U )
+
+/**
+ * @brief Timeout for the process loop run between state syncs, in
+ * milliseconds.
+ */
+#define SHADOW_IDLE_PROCESS_LOOP_TIMEOUT_MS             ( 1000U )
+
+/**
+ * @brief Timeout for the process loop run while changes wait to be
+ * reported or while OTA is connected, in milliseconds. It sets how closely
+ * the coalescing window and rate limit are kept, and how long a block
+ * request of the OTA agent can wait to be sent.
+ */
+#define SHADOW_DIRTY_PROCESS_LOOP_TIMEOUT_MS            ( 100U )
 
 /**
  * @brief The maximum number of times to call MQTT_ProcessLoop() when waiting
@@ -212,15 +189,15 @@
 #define MQTT_PROCESS_LOOP_TIMEOUT_MS                    ( 700U )
 
 /**
- * @brief JSON key for response code that indicates the type of error in
- * the error document received on topic `delete/rejected`.
+ * @brief Positions of the paths in #xDesiredFields.
  */
-#define SHADOW_DELETE_REJECTED_ERROR_CODE_KEY           "code"
+#define SHADOW_FIELD_POWER_ON                           ( 0U )
+#define SHADOW_DESIRED_FIELD_COUNT                      ( 1U )
 
 /**
- * @brief Length of #SHADOW_DELETE_REJECTED_ERROR_CODE_KEY
+ * @brief Positions of the properties in #xShadowProperties.
  */
-#define SHADOW_DELETE_REJECTED_ERROR_CODE_KEY_LENGTH    ( ( uint16_t ) ( sizeof( SHADOW_DELETE_REJECTED_ERROR_CODE_KEY ) - 1 ) )
+#define SHADOW_PROPERTY_POWER_ON                        ( 0U )
 
 /*-----------------------------------------------------------*/
 
@@ -255,36 +232,65 @@ static NetworkContext_t xNetworkContext;
 static BaseType_t mqttSessionEstablished = pdTRUE;
 
 /**
- * @brief Static buffer used to hold MQTT messages being sent and received.
+ * @brief Buffer used to hold MQTT messages being sent and received. It is
+ * borrowed from the shared buffer pool for the lifetime of the demo.
  */
-static uint8_t ucSharedBuffer[ democonfigNETWORK_BUFFER_SIZE ];
+static MQTTFixedBuffer_t xBuffer =
+{
+    .pBuffer = NULL,
+    .size    = 0U
+};
 
 /**
- * @brief Static buffer used to hold MQTT messages being sent and received.
+ * @brief The properties of the simulated device.
  */
-static MQTTFixedBuffer_t xBuffer =
+static ShadowStateProperty_t xShadowProperties[] =
 {
-    .pBuffer = ucSharedBuffer,
-    .size    = democonfigNETWORK_BUFFER_SIZE
+    shadowstateINT( "powerOn" )
 };
 
 /**
- * @brief The simulated device current power on state.
+ * @brief The device's local copy of its reported state, with the properties
+ * still to be reported and the newest shadow version seen.
+ */
+static ShadowStateModel_t xShadowState = shadowstateMODEL( xShadowProperties );
+
+/**
+ * @brief The reports in flight, keyed by the clientToken each was sent
+ * with, so that an accepted or rejected response is matched to the
+ * properties it covers however many reports are outstanding.
  */
-static uint32_t ulCurrentPowerOnState = 0U;
+static ShadowRequest_t xRequestSlots[ democonfigSHADOW_MAX_UPDATES_IN_FLIGHT ];
+static ShadowRequestTable_t xRequests = shadowrequestTABLE( xRequestSlots, SHADOW_RESPONSE_TIMEOUT_MS );
 
 /**
- * @brief The flag to indicate the device current power on state changed.
+ * @brief Set once the state model is initialized and, if a cache file was
+ * found, holds the cached state.
  */
-static bool stateChanged = false;
+static BaseType_t xStateRestored = pdFALSE;
 
 /**
- * @brief When we send an update to the device shadow, and if we care about
- * the response from cloud (accepted/rejected), remember the clientToken and
- * use it to match with the response.
+ * @brief Set while the state comes from the cache and has not been checked
+ * against the shadow yet.
  */
-static uint32_t ulClientToken = 0U;
-static uint32_t ulCurrentVersion = 0U;
+static BaseType_t xStateFromCache = pdFALSE;
+
+/**
+ * @brief Set when a report was accepted, so the state is cached once no
+ * other report is outstanding.
+ */
+static BaseType_t xSaveStatePending = pdFALSE;
+
+/**
+ * @brief Reports rejected or unanswered since the last accepted one.
+ */
+static uint32_t ulFailedReports = 0U;
+
+/**
+ * @brief Set when an update was rejected for a version conflict, so the
+ * document is fetched again before the next report.
+ */
+static BaseType_t xFetchBeforeReport = pdFALSE;
 
 /**
  * @brief The return status of prvUpdateDeltaHandler callback function.
@@ -314,13 +320,42 @@ static BaseType_t xDeleteResponseReceived = pdFALSE;
  */
 static BaseType_t xShadowDeleted = pdFALSE;
 
-static SemaphoreHandle_t s_getAcceptedResponse;
+/**
+ * @brief Broker round trips taken since the last accepted report.
+ */
+static uint32_t ulSyncRoundTrips = 0U;
+
+/**
+ * @brief Coalescing state of the reporter: the value changes seen since the
+ * last report, when the first and the last of them were seen, and when the
+ * last report was sent.
+ */
+static uint32_t ulSeenChanges = 0U;
+static TickType_t xFirstChangeTicks = 0;
+static TickType_t xLastChangeTicks = 0;
+static TickType_t xLastReportTicks = 0;
 
 static EventGroupHandle_t s_shadow_update_event_group;
 
-#define SHADOW_UPDATE_RESPONSE 0
-#define SHADOW_UPDATE_ACCEPTED 1 << 0
-#define SHADOW_UPDATE_REJECTED 1 << 1
+#define SHADOW_GET_ACCEPTED    1 << 2
+#define SHADOW_GET_REJECTED    1 << 3
+
+/**
+ * @brief Paths read from the desired state of a delta or a /get/accepted
+ * document. The shadow client hands the desired state over as a slice of
+ * the payload, and only that slice is parsed, so the paths are relative to
+ * it.
+ */
+static ShadowJsonField_t xDesiredFields[ SHADOW_DESIRED_FIELD_COUNT ] =
+{
+    shadowjsonFIELD( "powerOn" )
+};
+
+/**
+ * @brief The shadow this demo keeps in sync, registered with the shadow
+ * client.
+ */
+static ShadowClientHandle_t xShadow = NULL;
 
 /*-----------------------------------------------------------*/
 
@@ -338,16 +373,38 @@ static void prvEventCallback( MQTTContext_t * pxMqttContext,
                               MQTTPacketInfo_t * pxPacketInfo,
                               MQTTDeserializedInfo_t * pxDeserializedInfo );
 
+/**
+ * @brief Receives the publishes of the registered shadow from the shadow
+ * client, and hands them to the handler of their message type.
+ *
+ * @param[in] pxEvent The publish, with its common fields located. It points
+ * into the receive buffer, so nothing of it is kept after the handler
+ * returns.
+ * @param[in] pvContext Unused.
+ */
+static void prvShadowCallback( const ShadowClientEvent_t * pxEvent,
+                               void * pvContext );
+
+/**
+ * @brief Apply the desired powerOn state of a delta or a /get/accepted
+ * document to the state model.
+ *
+ * @param[in] pxEvent The publish.
+ *
+ * @return pdPASS if the desired state has a valid powerOn; pdFAIL
+ * otherwise.
+ */
+static BaseType_t prvApplyDesiredState( const ShadowClientEvent_t * pxEvent );
+
 /**
  * @brief Process payload from /update/delta topic.
  *
  * This handler examines the version number and the powerOn state. If powerOn
  * state has changed, it sets a flag for the main function to take further actions.
  *
- * @param[in] pPublishInfo Deserialized publish info pointer for the incoming
- * packet.
+ * @param[in] pxEvent The publish.
  */
-static void prvUpdateDeltaHandler( MQTTPublishInfo_t * pxPublishInfo );
+static void prvUpdateDeltaHandler( const ShadowClientEvent_t * pxEvent );
 
 /**
  * @brief Process payload from /update/accepted topic.
@@ -355,10 +412,9 @@ static void prvUpdateDeltaHandler( MQTTPublishInfo_t * pxPublishInfo );
  * This handler examines the accepted message that carries the same clientToken
  * as sent before.
  *
- * @param[in] pxPublishInfo Deserialized publish info pointer for the incoming
- * packet.
+ * @param[in] pxEvent The publish.
  */
-static void prvUpdateAcceptedHandler( MQTTPublishInfo_t * pxPublishInfo );
+static void prvUpdateAcceptedHandler( const ShadowClientEvent_t * pxEvent );
 
 
 /**
@@ -369,10 +425,37 @@ static void prvUpdateAcceptedHandler( MQTTPublishInfo_t * pxPublishInfo );
  * document which was not present yet. This is considered to be success for this
  * demo application.
  *
- * @param[in] pxPublishInfo Deserialized publish info pointer for the incoming
- * packet.
+ * @param[in] pxEvent The publish.
  */
-static void prvDeleteRejectedHandler( MQTTPublishInfo_t * pxPublishInfo );
+static void prvDeleteRejectedHandler( const ShadowClientEvent_t * pxEvent );
+
+/**
+ * @brief Find the report an /update/accepted or /update/rejected document
+ * answers, and free its slot and document.
+ *
+ * @param[in] pxEvent The publish.
+ * @param[out] pxRequest Receives the report that was in flight.
+ *
+ * @return pdTRUE if the document carries the clientToken of a report in
+ * flight; pdFALSE otherwise.
+ */
+static BaseType_t prvTakeReportResponse( const ShadowClientEvent_t * pxEvent,
+                                         ShadowRequest_t * pxRequest );
+
+/**
+ * @brief A report was rejected or not answered: its properties are dirty
+ * again and its document goes back to the pool.
+ *
+ * @param[in] pxRequest The report.
+ */
+static void prvFailReport( const ShadowRequest_t * pxRequest );
+
+/**
+ * @brief Split the paths of the JSON field tables into keys.
+ *
+ * @return pdPASS if every path is valid; pdFAIL otherwise.
+ */
+static BaseType_t prvCompileFieldTables( void );
 
 /**
  * @brief Helper function to wait for a response for Shadow delete operation.
@@ -384,6 +467,58 @@ static void prvDeleteRejectedHandler( MQTTPublishInfo_t * pxPublishInfo );
  */
 static BaseType_t prvWaitForDeleteResponse( MQTTContext_t * pxMQTTContext );
 
+/**
+ * @brief Run the process loop until one of @p xBitsToWaitFor is set by the
+ * event callback, then clear them.
+ *
+ * @param[in] xBitsToWaitFor The response bits to wait for.
+ * @param[out] pxBitsReceived The bits that were set.
+ *
+ * @return pdPASS if a response arrived; pdFAIL on timeout or if the
+ * connection failed.
+ */
+static BaseType_t prvWaitForShadowResponse( EventBits_t xBitsToWaitFor,
+                                            EventBits_t * pxBitsReceived );
+
+/**
+ * @brief Request the whole shadow document and wait for get/accepted or
+ * get/rejected.
+ *
+ * @return pdPASS if the broker answered; pdFAIL otherwise.
+ */
+static BaseType_t prvGetShadow( void );
+
+/**
+ * @brief Publish the dirty properties as a new report without waiting for
+ * the answer, which is matched to it by its clientToken later.
+ *
+ * Nothing is sent while every report slot or every outgoing publish slot
+ * is in use, or no buffer is free for the document; the changes wait for
+ * the next call.
+ *
+ * @return pdPASS if the report was sent or can wait; pdFAIL if the
+ * connection failed.
+ */
+static BaseType_t prvPublishReport( void );
+
+/**
+ * @brief Take every report that has waited longer than
+ * SHADOW_RESPONSE_TIMEOUT_MS as failed.
+ */
+static void prvExpireReports( void );
+
+/**
+ * @brief Decide whether the pending changes should be reported now.
+ *
+ * Changes are held until none has been made for
+ * democonfigSHADOW_COALESCE_WINDOW_MS, or until the oldest has waited
+ * democonfigSHADOW_MAX_STALENESS_MS, and never sooner than
+ * democonfigSHADOW_MIN_REPORT_INTERVAL_MS after the previous report.
+ *
+ * @return pdTRUE if a report is due.
+ */
+static BaseType_t prvIsReportDue( void );
+
 /*-----------------------------------------------------------*/
 
 static BaseType_t prvWaitForDeleteResponse( MQTTContext_t * pxMQTTContext )
@@ -418,17 +553,15 @@ static BaseType_t prvWaitForDeleteResponse( MQTTContext_t * pxMQTTContext )
 
 /*-----------------------------------------------------------*/
 
-static void prvDeleteRejectedHandler( MQTTPublishInfo_t * pxPublishInfo )
+static void prvDeleteRejectedHandler( const ShadowClientEvent_t * pxEvent )
 {
-    JSONStatus_t result = JSONSuccess;
-    char * pcOutValue = NULL;
-    uint32_t ulOutValueLength = 0UL;
     uint32_t ulErrorCode = 0UL;
 
-    assert( pxPublishInfo != NULL );
-    assert( pxPublishInfo->pPayload != NULL );
+    assert( pxEvent != NULL );
 
-    LogInfo( ( "/delete/rejected json payload:%s.", ( const char * ) pxPublishInfo->pPayload ) );
+    LogInfo( ( "/delete/rejected json payload:%.*s.",
+               ( int ) pxEvent->xPayloadLength,
+               pxEvent->pcPayload ) );
 
     /* The payload will look similar to this:
      * {
@@ -439,33 +572,16 @@ static void prvDeleteRejectedHandler( MQTTPublishInfo_t * pxPublishInfo )
      * }
      */
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pxPublishInfo->pPayload,
-                            pxPublishInfo->payloadLength );
-
-    if( result == JSONSuccess )
-    {
-        /* Then we start to get the version value by JSON keyword "version". */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              SHADOW_DELETE_REJECTED_ERROR_CODE_KEY,
-                              SHADOW_DELETE_REJECTED_ERROR_CODE_KEY_LENGTH,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
-    }
-    else
+    /* The shadow client validated the document and located the error code. */
+    if( pxEvent->xValid == false )
     {
         LogError( ( "The json document is invalid!!" ) );
     }
-
-    if( result == JSONSuccess )
+    else if( ShadowJson_GetUInt32( pxEvent->pcPayload, &pxEvent->xCode, &ulErrorCode ) == eShadowJsonSuccess )
     {
         LogInfo( ( "Error code is: %.*s.",
-                   ulOutValueLength,
-                   pcOutValue ) );
-
-        /* Convert the extracted value to an unsigned integer value. */
-        ulErrorCode = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
+                   ( int ) pxEvent->xCode.xLength,
+                   &pxEvent->pcPayload[ pxEvent->xCode.xOffset ] ) );
     }
     else
     {
@@ -483,19 +599,50 @@ static void prvDeleteRejectedHandler( MQTTPublishInfo_t * pxPublishInfo )
 
 /*-----------------------------------------------------------*/
 
-static void prvUpdateDeltaHandler( MQTTPublishInfo_t * pxPublishInfo )
+static BaseType_t prvApplyDesiredState( const ShadowClientEvent_t * pxEvent )
 {
-    //static uint32_t ulCurrentVersion = 0; /* Remember the latestVersion # we've ever received */
-    uint32_t ulVersion = 0U;
+    const ShadowJsonField_t * pxPowerOn = &xDesiredFields[ SHADOW_FIELD_POWER_ON ];
+    BaseType_t xReturnStatus = pdFAIL;
     uint32_t ulNewState = 0U;
-    char * pcOutValue = NULL;
-    uint32_t ulOutValueLength = 0U;
-    JSONStatus_t result = JSONSuccess;
 
-    assert( pxPublishInfo != NULL );
-    assert( pxPublishInfo->pPayload != NULL );
+    /* Only the desired state is scanned, in place; the offsets found are
+     * relative to it. */
+    if( ( pxEvent->xDesired.eType == eShadowJsonObject ) &&
+        ( ShadowJson_Parse( &pxEvent->pcPayload[ pxEvent->xDesired.xOffset ],
+                            pxEvent->xDesired.xLength,
+                            xDesiredFields,
+                            SHADOW_DESIRED_FIELD_COUNT ) == eShadowJsonSuccess ) &&
+        ( pxPowerOn->xValue.eType == eShadowJsonNumber ) &&
+        ( ShadowJson_GetUInt32( &pxEvent->pcPayload[ pxEvent->xDesired.xOffset ],
+                                &pxPowerOn->xValue,
+                                &ulNewState ) == eShadowJsonSuccess ) )
+    {
+        LogInfo( ( "The new power on state newState:%d, current power on state:%d \r\n",
+                   ulNewState, ShadowState_GetInt( &xShadowState, SHADOW_PROPERTY_POWER_ON ) ) );
+
+        /* Apply the desired state. If it differs from the one we retained
+         * before, the model marks it dirty, and the report is published
+         * from the main loop. We do not do it here because we are inside
+         * of a callback from the MQTT library, so that we don't re-enter
+         * the MQTT library. */
+        ( void ) ShadowState_SetInt( &xShadowState, SHADOW_PROPERTY_POWER_ON, ( int32_t ) ulNewState );
+        xReturnStatus = pdPASS;
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvUpdateDeltaHandler( const ShadowClientEvent_t * pxEvent )
+{
+    uint32_t ulVersion = 0U;
 
-    LogInfo( ( "/update/delta json payload:%s.", ( const char * ) pxPublishInfo->pPayload ) );
+    assert( pxEvent != NULL );
+
+    LogInfo( ( "/update/delta json payload:%.*s.",
+               ( int ) pxEvent->xPayloadLength,
+               pxEvent->pcPayload ) );
 
     /* The payload will look similar to this:
      * {
@@ -513,55 +660,35 @@ static void prvUpdateDeltaHandler( MQTTPublishInfo_t * pxPublishInfo )
      *  }
      */
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pxPublishInfo->pPayload,
-                            pxPublishInfo->payloadLength );
-
-    if( result == JSONSuccess )
-    {
-        /* Then we start to get the version value by JSON keyword "version". */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "version",
-                              sizeof( "version" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
-    }
-    else
+    /* The shadow client validated the document and located the version and
+     * the desired state in one pass. */
+    if( pxEvent->xValid == false )
     {
         LogError( ( "The json document is invalid!!" ) );
+        xUpdateDeltaReturn = pdFAIL;
     }
-
-    if( result == JSONSuccess )
+    else if( ShadowJson_GetUInt32( pxEvent->pcPayload, &pxEvent->xVersion, &ulVersion ) == eShadowJsonSuccess )
     {
         LogInfo( ( "version: %.*s",
-                   ulOutValueLength,
-                   pcOutValue ) );
-
-        /* Convert the extracted value to an unsigned integer value. */
-        ulVersion = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
+                   ( int ) pxEvent->xVersion.xLength,
+                   &pxEvent->pcPayload[ pxEvent->xVersion.xOffset ] ) );
     }
     else
     {
         LogError( ( "No version in json document!!" ) );
     }
 
-    LogInfo( ( "version:%d, ulCurrentVersion:%d \r\n", ulVersion, ulCurrentVersion ) );
+    LogInfo( ( "version:%u, current version:%u \r\n", ulVersion, xShadowState.ulVersion ) );
 
     /* When the version is much newer than the on we retained, that means the powerOn
-     * state is valid for us. */
-    if( ulVersion > ulCurrentVersion )
+     * state is valid for us. The model keeps it as the current version. */
+    if( ShadowState_UpdateVersion( &xShadowState, ulVersion ) == true )
     {
-        /* Set to received version as the current version. */
-        ulCurrentVersion = ulVersion;
-
-        /* Get powerOn state from json documents. */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "state.powerOn",
-                              sizeof( "state.powerOn" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
+        if( prvApplyDesiredState( pxEvent ) == pdFAIL )
+        {
+            LogError( ( "No powerOn in json document!!" ) );
+            xUpdateDeltaReturn = pdFAIL;
+        }
     }
     else
     {
@@ -572,116 +699,44 @@ static void prvUpdateDeltaHandler( MQTTPublishInfo_t * pxPublishInfo )
          */
         LogWarn( ( "The received version is smaller than current one!!" ) );
     }
-
-    if( result == JSONSuccess )
-    {
-        /* Convert the powerOn state value to an unsigned integer value. */
-        ulNewState = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
-
-        LogInfo( ( "The new power on state newState:%d, ulCurrentPowerOnState:%d \r\n",
-                   ulNewState, ulCurrentPowerOnState ) );
-
-        if( ulNewState != ulCurrentPowerOnState )
-        {
-            /* The received powerOn state is different from the one we retained before, so we switch them
-             * and set the flag. */
-            ulCurrentPowerOnState = ulNewState;
-
-            /* State change will be handled in main(), where we will publish a "reported"
-             * state to the device shadow. We do not do it here because we are inside of
-             * a callback from the MQTT library, so that we don't re-enter
-             * the MQTT library. */
-            stateChanged = true;
-        }
-    }
-    else
-    {
-        LogError( ( "No powerOn in json document!!" ) );
-        xUpdateDeltaReturn = pdFAIL;
-    }
 }
 
 /*-----------------------------------------------------------*/
 
-static void prvUpdateAcceptedHandler( MQTTPublishInfo_t * pxPublishInfo )
+static BaseType_t prvTakeReportResponse( const ShadowClientEvent_t * pxEvent,
+                                         ShadowRequest_t * pxRequest )
 {
-    char * pcOutValue = NULL;
-    uint32_t ulOutValueLength = 0U;
     uint32_t ulReceivedToken = 0U;
-    JSONStatus_t result = JSONSuccess;
-
-    assert( pxPublishInfo != NULL );
-    assert( pxPublishInfo->pPayload != NULL );
+    BaseType_t xIsResponse = pdFALSE;
 
-    LogInfo( ( "/update/accepted json payload:%s.", ( const char * ) pxPublishInfo->pPayload ) );
-
-    /* Handle the reported state with state change in /update/accepted topic.
-     * Thus we will retrieve the client token from the json document to see if
-     * it's the same one we sent with reported state on the /update topic.
-     * The payload will look similar to this:
-     *  {
-     *      "state": {
-     *          "reported": {
-     *          "powerOn": 1
-     *          }
-     *      },
-     *      "metadata": {
-     *          "reported": {
-     *          "powerOn": {
-     *              "timestamp": 1596573647
-     *          }
-     *          }
-     *      },
-     *      "version": 14698,
-     *      "timestamp": 1596573647,
-     *      "clientToken": "022485"
-     *  }
-     */
-
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pxPublishInfo->pPayload,
-                            pxPublishInfo->payloadLength );
-
-    if( result == JSONSuccess )
-    {
-        /* Get clientToken from json documents. */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "clientToken",
-                              sizeof( "clientToken" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
-    }
-    else
+    /* The shadow client validated the document and located the clientToken,
+     * and the error code of a rejection, in one pass. */
+    if( pxEvent->xValid == false )
     {
         LogError( ( "Invalid json documents !!" ) );
+        xUpdateAcceptedReturn = pdFAIL;
     }
-
-    if( result == JSONSuccess )
+    else if( ( pxEvent->xClientToken.eType == eShadowJsonString ) &&
+             ( ShadowJson_GetUInt32( pxEvent->pcPayload, &pxEvent->xClientToken, &ulReceivedToken ) == eShadowJsonSuccess ) )
     {
-        LogInfo( ( "clientToken: %.*s", ulOutValueLength,
-                   pcOutValue ) );
-
-        /* Convert the code to an unsigned integer value. */
-        ulReceivedToken = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
-
-        LogInfo( ( "receivedToken:%d, clientToken:%u \r\n", ulReceivedToken, ulClientToken ) );
-
-        /* If the clientToken in this update/accepted message matches the one we
-         * published before, it means the device shadow has accepted our latest
-         * reported state. We are done. */
-        if( ulReceivedToken == ulClientToken )
+        LogInfo( ( "clientToken: %.*s",
+                   ( int ) pxEvent->xClientToken.xLength,
+                   &pxEvent->pcPayload[ pxEvent->xClientToken.xOffset ] ) );
+
+        /* The token identifies which of the reports in flight this answers.
+         * A report that already timed out is no longer in the table; its
+         * properties were marked dirty again and will be reported anew. */
+        if( ShadowRequest_Complete( &xRequests, ulReceivedToken, pxRequest ) == true )
         {
-            LogInfo( ( "Received response from the device shadow. Previously published "
-                       "update with clientToken=%u has been accepted. ", ulClientToken ) );
-
-            xEventGroupClearBits(s_shadow_update_event_group, SHADOW_UPDATE_REJECTED);
-            xEventGroupSetBits(s_shadow_update_event_group, SHADOW_UPDATE_ACCEPTED);
+            MQTTMetrics_Record( eMetricsShadowUpdate, &pxRequest->xStartedAt );
+            MQTTMetrics_Count( eMetricsShadowBytes, ( uint32_t ) pxEvent->xPayloadLength );
+            BufferPool_Release( pxRequest->pcDocument );
+            xIsResponse = pdTRUE;
         }
         else
         {
-            LogWarn( ( "The received clientToken=%u is not identical with the one=%u we sent ",
-                       ulReceivedToken, ulClientToken ) );
+            LogWarn( ( "The received clientToken=%u matches no update in flight.",
+                       ulReceivedToken ) );
         }
     }
     else
@@ -689,21 +744,30 @@ static void prvUpdateAcceptedHandler( MQTTPublishInfo_t * pxPublishInfo )
         LogError( ( "No clientToken in json document!!" ) );
         xUpdateAcceptedReturn = pdFAIL;
     }
+
+    return xIsResponse;
 }
 
 /*-----------------------------------------------------------*/
 
-static void prvUpdateRejectedHandler( MQTTPublishInfo_t * pxPublishInfo )
+static void prvFailReport( const ShadowRequest_t * pxRequest )
 {
-    char * pcOutValue = NULL;
-    uint32_t ulOutValueLength = 0U;
-    uint32_t ulReceivedToken = 0U;
-    JSONStatus_t result = JSONSuccess;
+    ShadowState_OnReportFailed( &xShadowState, pxRequest->ulMask );
+    ulFailedReports++;
+}
 
-    assert( pxPublishInfo != NULL );
-    assert( pxPublishInfo->pPayload != NULL );
+/*-----------------------------------------------------------*/
+
+static void prvUpdateAcceptedHandler( const ShadowClientEvent_t * pxEvent )
+{
+    ShadowRequest_t xRequest = { 0 };
+    uint32_t ulVersion = 0U;
 
-    LogInfo( ( "/update/rejected json payload:%s.", ( const char * ) pxPublishInfo->pPayload ) );
+    assert( pxEvent != NULL );
+
+    LogInfo( ( "/update/accepted json payload:%.*s.",
+               ( int ) pxEvent->xPayloadLength,
+               pxEvent->pcPayload ) );
 
     /* Handle the reported state with state change in /update/accepted topic.
      * Thus we will retrieve the client token from the json document to see if
@@ -727,150 +791,131 @@ static void prvUpdateRejectedHandler( MQTTPublishInfo_t * pxPublishInfo )
      *      "clientToken": "022485"
      *  }
      */
+    if( prvTakeReportResponse( pxEvent, &xRequest ) == pdTRUE )
+    {
+        LogInfo( ( "Received response from the device shadow. Previously published "
+                   "update with clientToken=%u has been accepted. ", xRequest.ulClientToken ) );
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pxPublishInfo->pPayload,
-                            pxPublishInfo->payloadLength );
+        /* The update created a new version; the next report must carry it. */
+        if( ShadowJson_GetUInt32( pxEvent->pcPayload, &pxEvent->xVersion, &ulVersion ) == eShadowJsonSuccess )
+        {
+            ( void ) ShadowState_UpdateVersion( &xShadowState, ulVersion );
+        }
 
-    if( result == JSONSuccess )
-    {
-        /* Get clientToken from json documents. */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "clientToken",
-                              sizeof( "clientToken" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
-    }
-    else
-    {
-        LogError( ( "Invalid json documents !!" ) );
+        /* The shadow holds these properties now; they were cleared when the
+         * report was written, so the model needs no call. */
+        LogInfo( ( "Shadow state sync took %lu broker round trips.", ( unsigned long ) ulSyncRoundTrips ) );
+        MQTTMetrics_Count( eMetricsShadowSyncs, 1UL );
+        MQTTMetrics_Count( eMetricsShadowRoundTrips, ulSyncRoundTrips );
+        ulSyncRoundTrips = 0U;
+        ulFailedReports = 0U;
+        xSaveStatePending = pdTRUE;
     }
+}
 
-    if( result == JSONSuccess )
-    {
-        LogInfo( ( "clientToken: %.*s", ulOutValueLength,
-                   pcOutValue ) );
+/*-----------------------------------------------------------*/
 
-        /* Convert the code to an unsigned integer value. */
-        ulReceivedToken = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
+static void prvUpdateRejectedHandler( const ShadowClientEvent_t * pxEvent )
+{
+    ShadowRequest_t xRequest = { 0 };
+    uint32_t ulErrorCode = 0U;
 
-        LogInfo( ( "receivedToken:%d, clientToken:%u \r\n", ulReceivedToken, ulClientToken ) );
+    assert( pxEvent != NULL );
 
-        /* If the clientToken in this update/accepted message matches the one we
-         * published before, it means the device shadow has accepted our latest
-         * reported state. We are done. */
-        if( ulReceivedToken == ulClientToken )
-        {
-            LogInfo( ( "Received response from the device shadow. Previously published "
-                       "update with clientToken=%u has been accepted. ", ulClientToken ) );
+    LogInfo( ( "/update/rejected json payload:%.*s.",
+               ( int ) pxEvent->xPayloadLength,
+               pxEvent->pcPayload ) );
 
-            xEventGroupClearBits(s_shadow_update_event_group, SHADOW_UPDATE_ACCEPTED);
-            xEventGroupSetBits(s_shadow_update_event_group, SHADOW_UPDATE_REJECTED);
-        }
-        else
+    /* The payload will look similar to this:
+     * {
+     *    "code": 409,
+     *    "message": "Version conflict",
+     *    "timestamp": 1596573647,
+     *    "clientToken": "022485"
+     * }
+     */
+    if( prvTakeReportResponse( pxEvent, &xRequest ) == pdTRUE )
+    {
+        ( void ) ShadowJson_GetUInt32( pxEvent->pcPayload, &pxEvent->xCode, &ulErrorCode );
+
+        LogWarn( ( "Previously published update with clientToken=%u has been rejected, code %u.",
+                   xRequest.ulClientToken,
+                   ulErrorCode ) );
+
+        prvFailReport( &xRequest );
+
+        /* A version conflict means the shadow moved on; fetch it again
+         * before the properties are reported anew. */
+        if( ulErrorCode == 409UL )
         {
-            LogWarn( ( "The received clientToken=%u is not identical with the one=%u we sent ",
-                       ulReceivedToken, ulClientToken ) );
+            xFetchBeforeReport = pdTRUE;
         }
     }
-    else
-    {
-        LogError( ( "No clientToken in json document!!" ) );
-        xUpdateAcceptedReturn = pdFAIL;
-    }
 }
 
-static void prvGetAcceptedHandler( MQTTPublishInfo_t * pxPublishInfo )
+/*-----------------------------------------------------------*/
+
+static void prvGetAcceptedHandler( const ShadowClientEvent_t * pxEvent )
 {
-    //static uint32_t ulCurrentVersion = 0; /* Remember the latestVersion # we've ever received */
     uint32_t ulVersion = 0U;
-    uint32_t ulNewState = 0U;
-    char * pcOutValue = NULL;
-    uint32_t ulOutValueLength = 0U;
-    JSONStatus_t result = JSONSuccess;
-
-    assert( pxPublishInfo != NULL );
-    assert( pxPublishInfo->pPayload != NULL );
+    bool xNewer = false;
 
-    LogInfo( ( "/get/accepted json payload:%s.", ( const char * ) pxPublishInfo->pPayload ) );
+    assert( pxEvent != NULL );
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pxPublishInfo->pPayload,
-                            pxPublishInfo->payloadLength );
+    LogInfo( ( "/get/accepted json payload:%.*s.",
+               ( int ) pxEvent->xPayloadLength,
+               pxEvent->pcPayload ) );
 
-    if( result == JSONSuccess )
-    {
-        /* Then we start to get the version value by JSON keyword "version". */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "version",
-                              sizeof( "version" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
-    }
-    else
+    /* The shadow client validated the document and located the version and
+     * the desired state in one pass. */
+    if( pxEvent->xValid == false )
     {
         LogError( ( "The json document is invalid!!" ) );
     }
-
-    if( result == JSONSuccess )
+    else if( ShadowJson_GetUInt32( pxEvent->pcPayload, &pxEvent->xVersion, &ulVersion ) == eShadowJsonSuccess )
     {
         LogInfo( ( "version: %.*s",
-                   ulOutValueLength,
-                   pcOutValue ) );
-
-        /* Convert the extracted value to an unsigned integer value. */
-        ulVersion = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
+                   ( int ) pxEvent->xVersion.xLength,
+                   &pxEvent->pcPayload[ pxEvent->xVersion.xOffset ] ) );
     }
     else
     {
         LogError( ( "No version in json document!!" ) );
     }
 
-    LogInfo( ( "version:%d, ulCurrentVersion:%d \r\n", ulVersion, ulCurrentVersion ) );
+    LogInfo( ( "version:%u, current version:%u \r\n", ulVersion, xShadowState.ulVersion ) );
 
     /* When the version is much newer than the on we retained, that means the powerOn
-     * state is valid for us. */
-    if( ulVersion > ulCurrentVersion )
+     * state is valid for us. The model keeps it as the current version. */
+    xNewer = ShadowState_UpdateVersion( &xShadowState, ulVersion );
+
+    if( xStateFromCache == pdTRUE )
     {
-        /* Set to received version as the current version. */
-        ulCurrentVersion = ulVersion;
-
-        //process state of get accepted
-        /* Get powerOn state from json documents. */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "state.powerOn",
-                              sizeof( "state.powerOn" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
-
-        if( result == JSONSuccess )
+        /* The first document after boot is the one the cached state is
+         * checked against. An older version than the cached one means the
+         * shadow was deleted and created again, so it wins and is sent the
+         * whole state. */
+        if( ( xNewer == false ) && ( ulVersion != 0U ) && ( ulVersion < xShadowState.ulVersion ) )
         {
-            /* Convert the powerOn state value to an unsigned integer value. */
-            ulNewState = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
+            LogWarn( ( "Shadow version %u is older than the cached %u; the shadow was recreated.",
+                       ulVersion, xShadowState.ulVersion ) );
+            xShadowState.ulVersion = 0UL;
+            xNewer = ShadowState_UpdateVersion( &xShadowState, ulVersion );
+            ShadowState_MarkAllDirty( &xShadowState );
+        }
 
-            LogInfo( ( "The new power on state newState:%d, ulCurrentPowerOnState:%d \r\n",
-                       ulNewState, ulCurrentPowerOnState ) );
+        LogInfo( ( "Cached state checked against shadow version %u %lu ms after boot.",
+                   ulVersion,
+                   ( unsigned long ) ( xTaskGetTickCount() * portTICK_PERIOD_MS ) ) );
+        xStateFromCache = pdFALSE;
+    }
 
-            if( ulNewState != ulCurrentPowerOnState )
-            {
-                /* The received powerOn state is different from the one we retained before, so we switch them
-                 * and set the flag. */
-                ulCurrentPowerOnState = ulNewState;
-
-                /* State change will be handled in main(), where we will publish a "reported"
-                 * state to the device shadow. We do not do it here because we are inside of
-                 * a callback from the MQTT library, so that we don't re-enter
-                 * the MQTT library. */
-                stateChanged = true;
-            }
-        }
-        else
+    if( xNewer == true )
+    {
+        /* A document with nothing desired has no powerOn to apply. */
+        if( prvApplyDesiredState( pxEvent ) == pdFAIL )
         {
-            LogError( ( "No powerOn in json document!!" ) );
-            xUpdateDeltaReturn = pdFAIL;
+            LogInfo( ( "No desired powerOn in json document." ) );
         }
     }
     else
@@ -883,92 +928,136 @@ static void prvGetAcceptedHandler( MQTTPublishInfo_t * pxPublishInfo )
         LogWarn( ( "The received version is smaller than current one!!" ) );
     }
 
-    xSemaphoreGive(s_getAcceptedResponse);
+    xEventGroupSetBits( s_shadow_update_event_group, SHADOW_GET_ACCEPTED );
 }
 
-static void prvGetRejectedHandler( MQTTPublishInfo_t * pxPublishInfo )
-{
-    //static uint32_t ulCurrentVersion = 0; /* Remember the latestVersion # we've ever received */
-    uint32_t ulVersion = 0U;
-    uint32_t ulNewState = 0U;
-    char * pcOutValue = NULL;
-    uint32_t ulOutValueLength = 0U;
-    JSONStatus_t result = JSONSuccess;
+/*-----------------------------------------------------------*/
 
-    assert( pxPublishInfo != NULL );
-    assert( pxPublishInfo->pPayload != NULL );
+static void prvGetRejectedHandler( const ShadowClientEvent_t * pxEvent )
+{
+    uint32_t ulErrorCode = 0U;
 
-    LogInfo( ( "/get/rejected json payload:%s.", ( const char * ) pxPublishInfo->pPayload ) );
+    assert( pxEvent != NULL );
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pxPublishInfo->pPayload,
-                            pxPublishInfo->payloadLength );
+    LogInfo( ( "/get/rejected json payload:%.*s.",
+               ( int ) pxEvent->xPayloadLength,
+               pxEvent->pcPayload ) );
 
-    if( result == JSONSuccess )
-    {
-        /* Then we start to get the version value by JSON keyword "version". */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "version",
-                              sizeof( "version" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
-    }
-    else
+    /* The error document carries no version; only the code is of interest. */
+    if( pxEvent->xValid == false )
     {
         LogError( ( "The json document is invalid!!" ) );
     }
-
-    if( result == JSONSuccess )
+    else if( ShadowJson_GetUInt32( pxEvent->pcPayload, &pxEvent->xCode, &ulErrorCode ) == eShadowJsonSuccess )
     {
-        LogInfo( ( "version: %.*s",
-                   ulOutValueLength,
-                   pcOutValue ) );
+        LogInfo( ( "Error code is: %u.", ulErrorCode ) );
 
-        /* Convert the extracted value to an unsigned integer value. */
-        ulVersion = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
+        /* There is no shadow, so a version cached or seen before is gone
+         * with it, and the report that creates it must carry every
+         * property. */
+        if( ( ulErrorCode == 404UL ) && ( xShadowState.ulVersion != 0UL ) )
+        {
+            LogWarn( ( "Shadow not found; dropping version %u.", xShadowState.ulVersion ) );
+            xShadowState.ulVersion = 0UL;
+            ShadowState_MarkAllDirty( &xShadowState );
+        }
     }
     else
     {
-        LogError( ( "No version in json document!!" ) );
+        LogError( ( "No error code in json document!!" ) );
     }
 
-    LogInfo( ( "version:%d, ulCurrentVersion:%d \r\n", ulVersion, ulCurrentVersion ) );
+    xStateFromCache = pdFALSE;
 
-    /* When the version is much newer than the on we retained, that means the powerOn
-     * state is valid for us. */
-    if( ulVersion > ulCurrentVersion )
+    /* A rejected GET, typically 404 for a thing without a shadow yet, is
+     * still an answer; the report that follows creates the document. */
+    xEventGroupSetBits( s_shadow_update_event_group, SHADOW_GET_REJECTED );
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvCompileFieldTables( void )
+{
+    BaseType_t xReturnStatus = pdPASS;
+
+    if( ShadowJson_Compile( xDesiredFields, SHADOW_DESIRED_FIELD_COUNT ) != eShadowJsonSuccess )
+    {
+        xReturnStatus = pdFAIL;
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvShadowCallback( const ShadowClientEvent_t * pxEvent,
+                               void * pvContext )
+{
+    ShadowMessageType_t xMessageType = pxEvent->xMessageType;
+
+    ( void ) pvContext;
+
+    /* Only one shadow is registered, so every message is about the device
+     * state model. */
+    LogInfo( ( "Message type %d for shadow \"%s\".", xMessageType, ShadowClient_GetName( pxEvent->xShadow ) ) );
+
+    if( xMessageType == ShadowMessageTypeGetAccepted )
+    {
+        prvGetAcceptedHandler( pxEvent );
+    }
+    else if( xMessageType == ShadowMessageTypeGetRejected )
+    {
+        prvGetRejectedHandler( pxEvent );
+    }
+    else if( xMessageType == ShadowMessageTypeUpdateDelta )
+    {
+        /* Handler function to process payload. */
+        prvUpdateDeltaHandler( pxEvent );
+    }
+    else if( xMessageType == ShadowMessageTypeUpdateAccepted )
     {
-        /* Set to received version as the current version. */
-        ulCurrentVersion = ulVersion;
+        /* Handler function to process payload. */
+        prvUpdateAcceptedHandler( pxEvent );
+    }
+    else if( xMessageType == ShadowMessageTypeUpdateRejected )
+    {
+        prvUpdateRejectedHandler( pxEvent );
+    }
+    else if( xMessageType == ShadowMessageTypeUpdateDocuments )
+    {
+        LogInfo( ( "/update/documents json payload:%.*s.",
+                   ( int ) pxEvent->xPayloadLength,
+                   pxEvent->pcPayload ) );
+    }
+    else if( xMessageType == ShadowMessageTypeDeleteAccepted )
+    {
+        LogInfo( ( "Received an MQTT incoming publish on /delete/accepted topic." ) );
+        xShadowDeleted = pdTRUE;
+        xDeleteResponseReceived = pdTRUE;
+    }
+    else if( xMessageType == ShadowMessageTypeDeleteRejected )
+    {
+        /* Handler function to process payload. */
+        prvDeleteRejectedHandler( pxEvent );
+        xDeleteResponseReceived = pdTRUE;
     }
     else
     {
-        /* In this demo, we discard the incoming message
-         * if the version number is not newer than the latest
-         * that we've received before. Your application may use a
-         * different approach.
-         */
-        LogWarn( ( "The received version is smaller than current one!!" ) );
+        LogInfo( ( "Other message type:%d !!", xMessageType ) );
     }
 }
 
-
 /*-----------------------------------------------------------*/
 
 /* This is the callback function invoked by the MQTT stack when it receives
- * incoming messages. This function demonstrates how to use the Shadow_MatchTopic
- * function to determine whether the incoming message is a device shadow message
- * or not. If it is, it handles the message depending on the message type.
+ * incoming messages. The shadow client determines whether the incoming
+ * message belongs to a registered shadow, and if it does, hands it to the
+ * callback of that shadow.
  */
 static void prvEventCallback( MQTTContext_t * pxMqttContext,
                               MQTTPacketInfo_t * pxPacketInfo,
                               MQTTDeserializedInfo_t * pxDeserializedInfo )
 {
-
-    ShadowMessageType_t messageType = ShadowMessageTypeMaxNum;
-    const char * pcThingName = NULL;
-    uint16_t usThingNameLength = 0U;
     uint16_t usPacketIdentifier;
 
     ( void ) pxMqttContext;
@@ -985,68 +1074,298 @@ static void prvEventCallback( MQTTContext_t * pxMqttContext,
     if( ( pxPacketInfo->type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH )
     {
         assert( pxDeserializedInfo->pPublishInfo != NULL );
-        LogInfo( ( "pPublishInfo->pTopicName:%s.", pxDeserializedInfo->pPublishInfo->pTopicName ) );
-
-        /* Let the Device Shadow library tell us whether this is a device shadow message. */
-        if( SHADOW_SUCCESS == Shadow_MatchTopic( pxDeserializedInfo->pPublishInfo->pTopicName,
-                                                 pxDeserializedInfo->pPublishInfo->topicNameLength,
-                                                 &messageType,
-                                                 &pcThingName,
-                                                 &usThingNameLength ) )
+        LogInfo( ( "pPublishInfo->pTopicName:%.*s.",
+                   pxDeserializedInfo->pPublishInfo->topicNameLength,
+                   pxDeserializedInfo->pPublishInfo->pTopicName ) );
+
+        if( ( ShadowClient_Dispatch( pxDeserializedInfo->pPublishInfo ) == false ) &&
+            ( OtaMqtt_Dispatch( pxDeserializedInfo->pPublishInfo ) == false ) )
         {
-            /* Upon successful return, the messageType has been filled in. */
-            if( messageType == ShadowMessageTypeGetAccepted )
-            {
-                prvGetAcceptedHandler( pxDeserializedInfo->pPublishInfo );
-            }
-            else if( messageType == ShadowMessageTypeGetRejected )
-            {
-                prvGetRejectedHandler( pxDeserializedInfo->pPublishInfo );
-            }
-            else if( messageType == ShadowMessageTypeUpdateDelta )
-            {
-                /* Handler function to process payload. */
-                prvUpdateDeltaHandler( pxDeserializedInfo->pPublishInfo );
-            }
-            else if( messageType == ShadowMessageTypeUpdateAccepted )
-            {
-                /* Handler function to process payload. */
-                prvUpdateAcceptedHandler( pxDeserializedInfo->pPublishInfo );
-            }
-            else if( messageType == ShadowMessageTypeUpdateRejected )
-            {
-                prvUpdateRejectedHandler( pxDeserializedInfo->pPublishInfo );
-            }
-            else if( messageType == ShadowMessageTypeUpdateDocuments )
-            {
-                LogInfo( ( "/update/documents json payload:%s.", ( const char * ) pxDeserializedInfo->pPublishInfo->pPayload ) );
-            }
-            else if( messageType == ShadowMessageTypeDeleteAccepted )
-            {
-                LogInfo( ( "Received an MQTT incoming publish on /delete/accepted topic." ) );
-                xShadowDeleted = pdTRUE;
-                xDeleteResponseReceived = pdTRUE;
-            }
-            else if( messageType == ShadowMessageTypeDeleteRejected )
-            {
-                /* Handler function to process payload. */
-                prvDeleteRejectedHandler( pxDeserializedInfo->pPublishInfo );
-                xDeleteResponseReceived = pdTRUE;
-            }
-            else
+            LogError( ( "Not a topic of a registered shadow or of OTA:%.*s !!",
+                        pxDeserializedInfo->pPublishInfo->topicNameLength,
+                        pxDeserializedInfo->pPublishInfo->pTopicName ) );
+        }
+    }
+    else
+    {
+        vHandleOtherIncomingPacket( pxPacketInfo, usPacketIdentifier );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvWaitForShadowResponse( EventBits_t xBitsToWaitFor,
+                                            EventBits_t * pxBitsReceived )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    EventBits_t xBits = 0;
+    uint32_t ulWaitedMs = 0U;
+
+    /* The response is delivered by the event callback, which only runs
+     * inside the process loop of this task, so keep the loop running while
+     * waiting instead of blocking on the event group. */
+    xBits = xEventGroupGetBits( s_shadow_update_event_group ) & xBitsToWaitFor;
+
+    while( ( xBits == 0 ) && ( xReturnStatus == pdPASS ) && ( ulWaitedMs < SHADOW_RESPONSE_TIMEOUT_MS ) )
+    {
+        xReturnStatus = ProcessLoop( &xMqttContext, MQTT_PROCESS_LOOP_TIMEOUT_MS );
+        ulWaitedMs += MQTT_PROCESS_LOOP_TIMEOUT_MS;
+        xBits = xEventGroupGetBits( s_shadow_update_event_group ) & xBitsToWaitFor;
+    }
+
+    ( void ) xEventGroupClearBits( s_shadow_update_event_group, xBitsToWaitFor );
+
+    if( ( xReturnStatus == pdPASS ) && ( xBits == 0 ) )
+    {
+        LogError( ( "No shadow response within %u ms.", SHADOW_RESPONSE_TIMEOUT_MS ) );
+        xReturnStatus = pdFAIL;
+    }
+
+    *pxBitsReceived = xBits;
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvGetShadow( void )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    EventBits_t xBits = 0;
+    const char * pcTopic = NULL;
+    uint16_t usTopicLength = 0U;
+    uint16_t usPacketIdentifier = 0U;
+
+    LogInfo( ( "get latest state" ) );
+
+    pcTopic = ShadowClient_GetTopic( xShadow, eShadowClientTopicGet, &usTopicLength );
+
+    ( void ) xEventGroupClearBits( s_shadow_update_event_group, SHADOW_GET_ACCEPTED | SHADOW_GET_REJECTED );
+
+    /* Not PublishToTopic(), which would queue a request that is only
+     * worth sending in this session. */
+    xReturnStatus = PublishToTopicNoWait( &xMqttContext,
+                                          pcTopic,
+                                          usTopicLength,
+                                          "",
+                                          ( 0 ),
+                                          &usPacketIdentifier );
+
+    if( xReturnStatus == pdPASS )
+    {
+        ulSyncRoundTrips++;
+        xReturnStatus = prvWaitForShadowResponse( SHADOW_GET_ACCEPTED | SHADOW_GET_REJECTED, &xBits );
+    }
+
+    if( xReturnStatus == pdPASS )
+    {
+        LogInfo( ( "get %s latest state and version",
+                   ( ( xBits & SHADOW_GET_ACCEPTED ) != 0 ) ? "accepted" : "rejected" ) );
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvPublishReport( void )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    ShadowStateStatus_t xStateStatus = eShadowStateSuccess;
+    ShadowRequest_t * pxRequest = NULL;
+    bool xConditional = false;
+    size_t xUpdateDocumentLength = 0U;
+    uint16_t usPacketIdentifier = 0U;
+    const char * pcTopic = NULL;
+    uint16_t usTopicLength = 0U;
+
+    /* Only one conditional update can be in flight: once it is accepted the
+     * version moves on, and any other update carrying the old version
+     * would be rejected. Reports sent behind it go unconditionally. */
+    xConditional = ( ShadowRequest_InFlight( &xRequests ) == 0U );
+
+    if( GetFreeOutgoingPublishCount() == 0U )
+    {
+        /* The changes wait for a PUBACK to free an outgoing slot. */
+        return pdPASS;
+    }
+
+    pxRequest = ShadowRequest_Add( &xRequests );
+
+    if( pxRequest == NULL )
+    {
+        /* The changes wait for an answer to free a report slot. */
+        return pdPASS;
+    }
+
+    /* The answer names the shadow the report went to by its topic. */
+    pxRequest->pvContext = xShadow;
+
+    /* A buffer containing the update document. It is borrowed from the buffer
+     * pool until the update is answered, as the MQTT helper may resend it. */
+    pxRequest->pcDocument = BufferPool_Acquire( SHADOW_REPORT_BUFFER_SIZE );
+
+    if( pxRequest->pcDocument == NULL )
+    {
+        /* The changes wait for a buffer to be released; the session goes
+         * on and the report is tried again on the next loop. */
+        LogWarn( ( "No buffer available for the update document." ) );
+        ( void ) ShadowRequest_Complete( &xRequests, pxRequest->ulClientToken, NULL );
+        return pdPASS;
+    }
+
+    if( xReturnStatus == pdPASS )
+    {
+        /* Every change after the first that goes out in this update is an
+         * update saved. */
+        if( xShadowState.ulChanges > 1U )
+        {
+            LogInfo( ( "Coalesced %lu state changes into one update.", ( unsigned long ) xShadowState.ulChanges ) );
+            MQTTMetrics_Count( eMetricsShadowCoalesced, xShadowState.ulChanges - 1U );
+        }
+
+        /* Only the properties changed since they were last reported are
+         * written. */
+        xStateStatus = ShadowState_SerializeReported( &xShadowState,
+                                                      pxRequest->pcDocument,
+                                                      BufferPool_GetSize( pxRequest->pcDocument ),
+                                                      pxRequest->ulClientToken,
+                                                      xConditional,
+                                                      &xUpdateDocumentLength,
+                                                      &pxRequest->ulMask );
+
+        if( xStateStatus != eShadowStateSuccess )
+        {
+            LogError( ( "Failed to write the update document: status=%d.", ( int ) xStateStatus ) );
+            xReturnStatus = pdFAIL;
+        }
+
+        ulSeenChanges = 0U;
+        xLastReportTicks = xTaskGetTickCount();
+    }
+
+    if( xReturnStatus == pdPASS )
+    {
+        LogInfo( ( "Report the state change: %.*s", ( int ) xUpdateDocumentLength, pxRequest->pcDocument ) );
+
+        /* Do not wait for the answer; it is matched by the clientToken. The
+         * cached topic stays valid for a resend. */
+        pcTopic = ShadowClient_GetTopic( xShadow, eShadowClientTopicUpdate, &usTopicLength );
+        xReturnStatus = PublishToTopicNoWait( &xMqttContext,
+                                              pcTopic,
+                                              usTopicLength,
+                                              pxRequest->pcDocument,
+                                              xUpdateDocumentLength,
+                                              &usPacketIdentifier );
+    }
+
+    if( xReturnStatus == pdPASS )
+    {
+        LogInfo( ( "Update with clientToken=%u sent, %u in flight.",
+                   pxRequest->ulClientToken,
+                   ( unsigned int ) ShadowRequest_InFlight( &xRequests ) ) );
+        MQTTMetrics_Count( eMetricsShadowBytes, ( uint32_t ) xUpdateDocumentLength );
+        ulSyncRoundTrips++;
+    }
+    else
+    {
+        /* The report never left; its properties are dirty again. */
+        ShadowState_OnReportFailed( &xShadowState, pxRequest->ulMask );
+        BufferPool_Release( pxRequest->pcDocument );
+        ( void ) ShadowRequest_Complete( &xRequests, pxRequest->ulClientToken, NULL );
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvExpireReports( void )
+{
+    ShadowRequest_t xRequest = { 0 };
+
+    while( ShadowRequest_TakeExpired( &xRequests, &xRequest ) == true )
+    {
+        LogWarn( ( "No answer to the update with clientToken=%u within %u ms.",
+                   xRequest.ulClientToken,
+                   SHADOW_RESPONSE_TIMEOUT_MS ) );
+
+        BufferPool_Release( xRequest.pcDocument );
+        prvFailReport( &xRequest );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvIsReportDue( void )
+{
+    TickType_t xNow = xTaskGetTickCount();
+    BaseType_t xDue = pdFALSE;
+
+    if( ShadowState_IsDirty( &xShadowState ) == true )
+    {
+        /* Changes are made by the handlers inside the process loop, so they
+         * are timed to the loop that delivered them. */
+        if( xShadowState.ulChanges != ulSeenChanges )
+        {
+            if( ulSeenChanges == 0U )
             {
-                LogInfo( ( "Other message type:%d !!", messageType ) );
+                xFirstChangeTicks = xNow;
             }
+
+            xLastChangeTicks = xNow;
+            ulSeenChanges = xShadowState.ulChanges;
         }
-        else
+
+        if( ( ( xNow - xLastChangeTicks ) >= pdMS_TO_TICKS( democonfigSHADOW_COALESCE_WINDOW_MS ) ) ||
+            ( ( xNow - xFirstChangeTicks ) >= pdMS_TO_TICKS( democonfigSHADOW_MAX_STALENESS_MS ) ) )
         {
-            LogError( ( "Shadow_MatchTopic parse failed:%s !!", ( const char * ) pxDeserializedInfo->pPublishInfo->pTopicName ) );
+            xDue = pdTRUE;
+        }
+
+        /* The rate limit holds even for stale changes; they are merged into
+         * the next update. */
+        if( ( xNow - xLastReportTicks ) < pdMS_TO_TICKS( democonfigSHADOW_MIN_REPORT_INTERVAL_MS ) )
+        {
+            xDue = pdFALSE;
         }
     }
-    else
+
+    return xDue;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t RestoreDeviceShadowState( void )
+{
+    BaseType_t xReturnStatus = pdPASS;
+
+    if( xStateRestored == pdFALSE )
     {
-        vHandleOtherIncomingPacket( pxPacketInfo, usPacketIdentifier );
+        /* Every property is reported after boot; later reports carry changes. */
+        if( ShadowState_Init( &xShadowState ) != eShadowStateSuccess )
+        {
+            LogError( ( "Invalid shadow property table." ) );
+            xReturnStatus = pdFAIL;
+        }
+        else
+        {
+            /* Properties restored from the cache were accepted before the
+             * reset, so they are only reported again if the shadow moved
+             * on meanwhile. */
+            if( ShadowCache_Load( &xShadowState, democonfigSHADOW_CACHE_FILE ) == pdPASS )
+            {
+                LogInfo( ( "Applied cached power on state %d %lu ms after boot.",
+                           ShadowState_GetInt( &xShadowState, SHADOW_PROPERTY_POWER_ON ),
+                           ( unsigned long ) ( xTaskGetTickCount() * portTICK_PERIOD_MS ) ) );
+                xStateFromCache = pdTRUE;
+            }
+
+            xStateRestored = pdTRUE;
+        }
     }
+
+    return xReturnStatus;
 }
 
 /*-----------------------------------------------------------*/
@@ -1054,39 +1373,85 @@ static void prvEventCallback( MQTTContext_t * pxMqttContext,
 /**
  * @brief Entry point of shadow demo.
  *
- * This main function demonstrates how to use the macros provided by the
- * Device Shadow library to assemble strings for the MQTT topics defined
- * by AWS IoT Device Shadow. It uses these macros for topics to subscribe
+ * This main function registers one shadow with the shadow client, which
+ * builds its topics once at startup. For the classic shadow, it subscribes
  * to:
- * - SHADOW_TOPIC_STRING_UPDATE_DELTA for "$aws/things/thingName/shadow/update/delta"
- * - SHADOW_TOPIC_STRING_UPDATE_ACCEPTED for "$aws/things/thingName/shadow/update/accepted"
- * - SHADOW_TOPIC_STRING_UPDATE_REJECTED for "$aws/things/thingName/shadow/update/rejected"
+ * - "$aws/things/thingName/shadow/update/delta"
+ * - "$aws/things/thingName/shadow/update/accepted"
+ * - "$aws/things/thingName/shadow/update/rejected"
+ * - "$aws/things/thingName/shadow/get/accepted"
+ * - "$aws/things/thingName/shadow/get/rejected"
  *
- * It also uses these macros for topics to publish to:
- * - SHADOW_TOPIC_STIRNG_DELETE for "$aws/things/thingName/shadow/delete"
- * - SHADOW_TOPIC_STRING_UPDATE for "$aws/things/thingName/shadow/update"
+ * and publishes to:
+ * - "$aws/things/thingName/shadow/get"
+ * - "$aws/things/thingName/shadow/update"
  *
- * The helper functions this demo uses for MQTT operations have internal
- * loops to process incoming messages. Those are not the focus of this demo
- * and therefor, are placed in a separate file shadow_demo_helpers.c.
+ * A named shadow uses the same topics under
+ * "$aws/things/thingName/shadow/name/shadowName/". More shadows can be
+ * registered on the same connection.
+ *
+ * All five topics are subscribed with one SUBSCRIBE when a session starts
+ * and kept for the life of the session. The document is fetched once at the
+ * start of the session, and after that only a change of state triggers a
+ * report. Reports do not wait for their answer: up to
+ * democonfigSHADOW_MAX_UPDATES_IN_FLIGHT are outstanding at once, each
+ * matched to its answer by its clientToken, and one that is rejected or not
+ * answered in time is sent again with whatever changed since. The function
+ * returns only if the MQTT library cannot be initialized.
  */
 int RunDeviceShadowDemo()
 {
-
-    s_getAcceptedResponse = xSemaphoreCreateBinary();
     s_shadow_update_event_group = xEventGroupCreate();
 
     BaseType_t xDemoStatus = pdPASS;
-    BaseType_t xDemoRunCount = 0UL;
-    BaseType_t xDeleteResponseLoopCount = 0UL;
+    ShadowRequest_t xRequest = { 0 };
+
+    if( prvCompileFieldTables() == pdFAIL )
+    {
+        LogError( ( "Invalid shadow JSON field table." ) );
+        return EXIT_FAILURE;
+    }
+
+    /* Normally done at startup, once WIFI_On() started the network
+     * processor and before the AP is joined. */
+    if( RestoreDeviceShadowState() == pdFAIL )
+    {
+        return EXIT_FAILURE;
+    }
+
+    ShadowRequest_Init( &xRequests );
+
+    /* The topics of the shadow are built once, here. */
+    if( ShadowClient_Init( THING_NAME, THING_NAME_LENGTH ) == pdPASS )
+    {
+        xShadow = ShadowClient_Register( democonfigSHADOW_NAME, prvShadowCallback, NULL );
+    }
+
+    if( xShadow == NULL )
+    {
+        LogError( ( "Failed to register the shadow." ) );
+        return EXIT_FAILURE;
+    }
+
+    /* Compare the extractor with coreJSON, if enabled. */
+    ShadowJson_RunBenchmark();
 
-    /* A buffer containing the update document. It has static duration to prevent
-     * it from being placed on the call stack. */
-    static char pcUpdateDocument[ SHADOW_REPORTED_JSON_LENGTH + 1 ] = { 0 };
+    /* Compare the CBOR sections with JSON, if enabled. */
+    ShadowCbor_RunBenchmark();
 
+    xBuffer.pBuffer = BufferPool_Acquire( democonfigNETWORK_BUFFER_SIZE );
 
-    do
+    if( xBuffer.pBuffer == NULL )
     {
+        LogError( ( "No buffer available for the MQTT network buffer." ) );
+        return EXIT_FAILURE;
+    }
+
+    xBuffer.size = democonfigNETWORK_BUFFER_SIZE;
+
+    for( ; ; )
+    {
+        /* Retries until connected; fails only if MQTT cannot be initialized. */
         xDemoStatus = EstablishMqttSession( &xMqttContext,
                                             &xNetworkContext,
                                             &xBuffer,
@@ -1096,275 +1461,124 @@ int RunDeviceShadowDemo()
         {
             /* Log error to indicate connection failure. */
             LogError( ( "Failed to connect to MQTT broker." ) );
+            break;
         }
-        else
+
+        /* The subscription is the first round trip of the session's sync. */
+        ulSyncRoundTrips = 1U;
+
+        xDemoStatus = ShadowClient_Subscribe( &xMqttContext );
+
+        /* OTA has no connection of its own; it may connect from now on. */
+        if( xDemoStatus == pdPASS )
         {
-//            /* Reset the shadow delete status flags. */
-//            xDeleteResponseReceived = pdFALSE;
-//            xShadowDeleted = pdFALSE;
-//
-//            /* First of all, try to delete any Shadow document in the cloud.
-//             * Try to subscribe to `delete/accepted` and `delete/rejected` topics. */
-//            xDemoStatus = SubscribeToTopic( &xMqttContext,
-//                                            SHADOW_TOPIC_STRING_DELETE_ACCEPTED( THING_NAME ),
-//                                            SHADOW_TOPIC_LENGTH_DELETE_ACCEPTED( THING_NAME_LENGTH ) );
-//
-//            if( xDemoStatus == pdPASS )
-//            {
-//                /* Try to subscribe to `delete/rejected` topic. */
-//                xDemoStatus = SubscribeToTopic( &xMqttContext,
-//                                                SHADOW_TOPIC_STRING_DELETE_REJECTED( THING_NAME ),
-//                                                SHADOW_TOPIC_LENGTH_DELETE_REJECTED( THING_NAME_LENGTH ) );
-//            }
-//
-//            if( xDemoStatus == pdPASS )
-//            {
-//                /* Publish to Shadow `delete` topic to attempt to delete the
-//                 * Shadow document if exists. */
-//                xDemoStatus = PublishToTopic( &xMqttContext,
-//                                              SHADOW_TOPIC_STRING_DELETE( THING_NAME ),
-//                                              SHADOW_TOPIC_LENGTH_DELETE( THING_NAME_LENGTH ),
-//                                              pcUpdateDocument,
-//                                              0U );
-//            }
-//
-//            /* Wait for an incoming publish on `delete/accepted` or `delete/rejected`
-//             * topics, if not already received a publish. */
-//            if( ( xDemoStatus == pdPASS ) && ( xDeleteResponseReceived != pdTRUE ) )
-//            {
-//                xDemoStatus = prvWaitForDeleteResponse( &xMqttContext );
-//            }
-//
-//            /* Unsubscribe from the `delete/accepted` and 'defdddlete/rejected` topics.*/
-//            if( xDemoStatus == pdPASS )
-//            {
-//                xDemoStatus = UnsubscribeFromTopic( &xMqttContext,
-//                                                    SHADOW_TOPIC_STRING_DELETE_ACCEPTED( THING_NAME ),
-//                                                    SHADOW_TOPIC_LENGTH_DELETE_ACCEPTED( THING_NAME_LENGTH ) );
-//            }
-//
-//            if( xDemoStatus == pdPASS )
-//            {
-//                xDemoStatus = UnsubscribeFromTopic( &xMqttContext,
-//                                                    SHADOW_TOPIC_STRING_DELETE_REJECTED( THING_NAME ),
-//                                                    SHADOW_TOPIC_LENGTH_DELETE_REJECTED( THING_NAME_LENGTH ) );
-//            }
-//
-//            /* Check if Shadow document delete was successful. A delete can be
-//             * successful in cases listed below.
-//             *  1. If an incoming publish is received on `delete/accepted` topic.
-//             *  2. If an incoming publish is received on `delete/rejected` topic
-//             *     with error code 404. This indicates that a Shadow document was
-//             *     not present for the Thing. */
-//            if( xShadowDeleted == pdFALSE )
-//            {
-//                LogError( ( "Shadow delete operation failed." ) );
-//                xDemoStatus = pdFAIL;
-//            }
-
-
-
-
-            /* Then try to subscribe Shadow delta and Shadow updated topics. */
-            if( xDemoStatus == pdPASS )
-            {
-                xDemoStatus = SubscribeToTopic( &xMqttContext,
-                                                SHADOW_TOPIC_STRING_UPDATE_DELTA( THING_NAME ),
-                                                SHADOW_TOPIC_LENGTH_UPDATE_DELTA( THING_NAME_LENGTH ) );
-            }
+            OtaMqtt_StartSession();
+        }
+
+        /* Forward the telemetry queued while the broker was unreachable. */
+        if( xDemoStatus == pdPASS )
+        {
+            xDemoStatus = PublishQueue_Flush( &xMqttContext,
+                                              democonfigPUBLISH_QUEUE_FLUSH_TIMEOUT_MS );
+        }
+
+        /* Deltas sent while the device was offline are not replayed, so
+         * fetch the whole document before reporting. */
+        if( xDemoStatus == pdPASS )
+        {
+            xDemoStatus = prvGetShadow();
+        }
+
+        while( xDemoStatus == pdPASS )
+        {
+            /* Poll faster while changes wait, so the window is kept, and
+             * while OTA is connected, so its block requests go out soon. */
+            xDemoStatus = ProcessLoop( &xMqttContext,
+                                       ( ( ShadowState_IsDirty( &xShadowState ) == true ) ||
+                                         ( OtaMqtt_IsOpen() == true ) ) ?
+                                       SHADOW_DIRTY_PROCESS_LOOP_TIMEOUT_MS :
+                                       SHADOW_IDLE_PROCESS_LOOP_TIMEOUT_MS );
 
             if( xDemoStatus == pdPASS )
             {
-                xDemoStatus = SubscribeToTopic( &xMqttContext,
-                                                SHADOW_TOPIC_STRING_UPDATE_ACCEPTED( THING_NAME ),
-                                                SHADOW_TOPIC_LENGTH_UPDATE_ACCEPTED( THING_NAME_LENGTH ) );
+                xDemoStatus = PublishQueue_Drain( &xMqttContext );
             }
 
+            /* Send what the OTA agent is waiting on. */
             if( xDemoStatus == pdPASS )
             {
-                xDemoStatus = SubscribeToTopic( &xMqttContext,
-                                                SHADOW_TOPIC_STRING_UPDATE_REJECTED( THING_NAME ),
-                                                SHADOW_TOPIC_LENGTH_UPDATE_REJECTED( THING_NAME_LENGTH ) );
+                xDemoStatus = OtaMqtt_Process( &xMqttContext );
             }
 
-            bool getUpdate = true;
-            while(getUpdate)
-            {
-                if( xDemoStatus == pdPASS )
-                {
-                    xDemoStatus = SubscribeToTopic( &xMqttContext,
-                                                    SHADOW_TOPIC_STRING_GET_ACCEPTED( THING_NAME ),
-                                                    SHADOW_TOPIC_LENGTH_GET_ACCEPTED( THING_NAME_LENGTH ) );
-                }
-
-                if( xDemoStatus == pdPASS )
-                {
-                    xDemoStatus = SubscribeToTopic( &xMqttContext,
-                                                    SHADOW_TOPIC_STRING_GET_REJECTED( THING_NAME ),
-                                                    SHADOW_TOPIC_LENGTH_GET_REJECTED( THING_NAME_LENGTH ) );
-                }
-
-                if( xDemoStatus == pdPASS )
-                {
-                    /* Report the latest power state back to device shadow. */
-                    LogInfo( ( "get latest state" ) );
-
-                    xDemoStatus = PublishToTopic( &xMqttContext,
-                                                  SHADOW_TOPIC_STRING_GET( THING_NAME ),
-                                                  SHADOW_TOPIC_LENGTH_GET( THING_NAME_LENGTH ),
-                                                  "",
-                                                  ( 0 ) );
-
-                    //wait for get accepted or rejected, just need a version number
-                    if(xSemaphoreTake(s_getAcceptedResponse, portMAX_DELAY))
-                    {
-                        LogInfo( ( "get accepted latest state and version" ) );
-                    }
-                }
-
-                if( xDemoStatus == pdPASS )
-                {
-                   LogInfo( ( "Start to unsubscribe shadow topics and disconnect from MQTT. \r\n" ) );
-
-                   xDemoStatus = UnsubscribeFromTopic( &xMqttContext,
-                                                       SHADOW_TOPIC_STRING_GET_ACCEPTED( THING_NAME ),
-                                                       SHADOW_TOPIC_LENGTH_GET_ACCEPTED( THING_NAME_LENGTH ) );
-
-                   if( xDemoStatus != pdPASS )
-                   {
-                       LogError( ( "Failed to unsubscribe the topic %s",
-                               SHADOW_TOPIC_STRING_GET_ACCEPTED( THING_NAME ) ) );
-                   }
-                }
-
-                if( xDemoStatus == pdPASS )
-                {
-                   xDemoStatus = UnsubscribeFromTopic( &xMqttContext,
-                                                       SHADOW_TOPIC_STRING_GET_REJECTED( THING_NAME ),
-                                                       SHADOW_TOPIC_LENGTH_GET_REJECTED( THING_NAME_LENGTH ) );
-
-                   if( xDemoStatus != pdPASS )
-                   {
-                       LogError( ( "Failed to unsubscribe the topic %s",
-                               SHADOW_TOPIC_STRING_GET_REJECTED( THING_NAME ) ) );
-                   }
-                }
-
-                if( xDemoStatus == pdPASS )
-                {
-
-                    /* Report the latest power state back to device shadow. */
-                    LogInfo( ( "Report to the state change: %d", ulCurrentPowerOnState ) );
-                    ( void ) memset( pcUpdateDocument,
-                                    0x00,
-                                    sizeof( pcUpdateDocument ) );
-
-                    /* Keep the client token in global variable used to compare if
-                    * the same token in /update/accepted. */
-                    ulClientToken = ( xTaskGetTickCount() % 1000000 );
-
-                    snprintf( pcUpdateDocument,
-                             SHADOW_REPORTED_JSON_LENGTH + 1,
-                             SHADOW_REPORTED_JSON,
-                             ( int ) ulCurrentPowerOnState,
-                             ( long unsigned ) ulCurrentVersion,
-                             ( long unsigned ) ulClientToken );
-
-                    xDemoStatus = PublishToTopic( &xMqttContext,
-                                                 SHADOW_TOPIC_STRING_UPDATE( THING_NAME ),
-                                                 SHADOW_TOPIC_LENGTH_UPDATE( THING_NAME_LENGTH ),
-                                                 pcUpdateDocument,
-                                                 ( SHADOW_DESIRED_JSON_LENGTH + 1 ) );
-
-                    //wait for either update accepted or rejected and then clear them after
-                    EventBits_t bits = xEventGroupWaitBits(s_shadow_update_event_group, SHADOW_UPDATE_ACCEPTED | SHADOW_UPDATE_REJECTED , pdTRUE, pdFALSE, portMAX_DELAY);
-                    if(bits & SHADOW_UPDATE_REJECTED)
-                    {
-                        //rejected try again
-                    }else if(bits & SHADOW_UPDATE_ACCEPTED)
-                    {
-                        getUpdate = false;
-                    }
-                }
-            }
+            /* Reports not answered in time are sent again with the next. */
+            prvExpireReports();
 
-            if( xDemoStatus == pdPASS )
+            if( ulFailedReports >= SHADOW_MAX_SYNC_ATTEMPTS )
             {
-                LogInfo( ( "Start to unsubscribe shadow topics and disconnect from MQTT. \r\n" ) );
-
-                xDemoStatus = UnsubscribeFromTopic( &xMqttContext,
-                                                    SHADOW_TOPIC_STRING_UPDATE_DELTA( THING_NAME ),
-                                                    SHADOW_TOPIC_LENGTH_UPDATE_DELTA( THING_NAME_LENGTH ) );
-
-                if( xDemoStatus != pdPASS )
-                {
-                    LogError( ( "Failed to unsubscribe the topic %s",
-                                SHADOW_TOPIC_STRING_UPDATE_DELTA( THING_NAME ) ) );
-                }
+                LogError( ( "Shadow update failed %d times in a row.", SHADOW_MAX_SYNC_ATTEMPTS ) );
+                xDemoStatus = pdFAIL;
             }
 
-            if( xDemoStatus == pdPASS )
+            /* A conflicting version was seen; catch up before reporting. */
+            if( ( xDemoStatus == pdPASS ) && ( xFetchBeforeReport == pdTRUE ) )
             {
-                xDemoStatus = UnsubscribeFromTopic( &xMqttContext,
-                                                    SHADOW_TOPIC_STRING_UPDATE_ACCEPTED( THING_NAME ),
-                                                    SHADOW_TOPIC_LENGTH_UPDATE_ACCEPTED( THING_NAME_LENGTH ) );
-
-                if( xDemoStatus != pdPASS )
-                {
-                    LogError( ( "Failed to unsubscribe the topic %s",
-                                SHADOW_TOPIC_STRING_UPDATE_ACCEPTED( THING_NAME ) ) );
-                }
+                xFetchBeforeReport = pdFALSE;
+                xDemoStatus = prvGetShadow();
             }
 
-            if( xDemoStatus == pdPASS )
+            /* The state changed; once the burst of changes is over, report
+             * it on the topics already subscribed. */
+            if( ( xDemoStatus == pdPASS ) && ( prvIsReportDue() == pdTRUE ) )
             {
-                xDemoStatus = UnsubscribeFromTopic( &xMqttContext,
-                                                    SHADOW_TOPIC_STRING_UPDATE_REJECTED( THING_NAME ),
-                                                    SHADOW_TOPIC_LENGTH_UPDATE_REJECTED( THING_NAME_LENGTH ) );
-
-                if( xDemoStatus != pdPASS )
-                {
-                    LogError( ( "Failed to unsubscribe the topic %s",
-                                SHADOW_TOPIC_STRING_UPDATE_REJECTED( THING_NAME ) ) );
-                }
+                xDemoStatus = prvPublishReport();
             }
 
-            /* The MQTT session is always disconnected, even if there were prior failures. */
-            xDemoStatus = DisconnectMqttSession( &xMqttContext, &xNetworkContext );
-
-            /* This demo performs only Device Shadow operations. If matching the Shadow
-             * MQTT topic fails or there are failure in parsing the received JSON document,
-             * then this demo was not successful. */
-            if( ( xUpdateAcceptedReturn != pdPASS ) || ( xUpdateDeltaReturn != pdPASS ) )
+            /* Cache the state once the shadow holds all of it, so the next
+             * boot starts from it. */
+            if( ( xSaveStatePending == pdTRUE ) &&
+                ( ShadowState_IsDirty( &xShadowState ) == false ) &&
+                ( ShadowRequest_InFlight( &xRequests ) == 0U ) )
             {
-                LogError( ( "Callback function failed." ) );
-                xDemoStatus = pdFAIL;
+                xSaveStatePending = pdFALSE;
+                ( void ) ShadowCache_Save( &xShadowState, democonfigSHADOW_CACHE_FILE );
             }
         }
 
-        /* Increment the demo run count. */
-        xDemoRunCount++;
-
-        if( xDemoStatus == pdPASS )
-        {
-            LogInfo( ( "Demo iteration %lu is successful.", xDemoRunCount ) );
-        }
-        /* Attempt to retry a failed iteration of demo for up to #SHADOW_MAX_DEMO_COUNT times. */
-        else if( xDemoRunCount < SHADOW_MAX_DEMO_COUNT )
+        /* No answer can arrive for the reports still in flight; their
+         * properties are reported again on the next session. */
+        while( ShadowRequest_TakeAny( &xRequests, &xRequest ) == true )
         {
-            LogWarn( ( "Demo iteration %lu failed. Retrying...", xDemoRunCount ) );
-            vTaskDelay( DELAY_BETWEEN_DEMO_ITERATIONS_TICKS );
+            ShadowState_OnReportFailed( &xShadowState, xRequest.ulMask );
+            BufferPool_Release( xRequest.pcDocument );
         }
-        /* Failed all #SHADOW_MAX_DEMO_COUNT demo iterations. */
-        else
+
+        ulFailedReports = 0U;
+        xFetchBeforeReport = pdFALSE;
+        ulSyncRoundTrips = 0U;
+
+        /* This demo performs only Device Shadow operations. If matching the Shadow
+         * MQTT topic fails or there are failure in parsing the received JSON document,
+         * then this session was not successful. */
+        if( ( xUpdateAcceptedReturn != pdPASS ) || ( xUpdateDeltaReturn != pdPASS ) )
         {
-            LogError( ( "All %d demo iterations failed.", SHADOW_MAX_DEMO_COUNT ) );
-            break;
+            LogError( ( "Callback function failed." ) );
+            xUpdateAcceptedReturn = pdPASS;
+            xUpdateDeltaReturn = pdPASS;
         }
-    } while( xDemoStatus != pdPASS );
 
-    return( ( xDemoStatus == pdPASS ) ? EXIT_SUCCESS : EXIT_FAILURE );
+        /* The MQTT session is always disconnected, even if there were prior
+         * failures. The session is clean, so the broker drops the
+         * subscriptions with it and no UNSUBSCRIBE is needed. */
+        LogWarn( ( "Shadow session ended, reconnecting." ) );
+        OtaMqtt_EndSession();
+        ( void ) DisconnectMqttSession( &xMqttContext, &xNetworkContext );
+    }
+
+    BufferPool_Release( xBuffer.pBuffer );
+    xBuffer.pBuffer = NULL;
+    xBuffer.size = 0U;
+
+    return EXIT_FAILURE;
 }
 
 /*-----------------------------------------------------------*/
-
@@ -48,6 +48,10 @@
 /* Platform includes for demo. */
 #include "platform/iot_clock.h"
 
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "event_groups.h"
+
 /* Set up logging for this demo. */
 #include "iot_demo_logging.h"
 
@@ -63,26 +67,74 @@
 
 #include "iot_init.h"
 
+/* Connection shared with the shadow task. */
+#include "ota_mqtt.h"
+
+/* Adaptive OTA block window. */
+#include "ota_window.h"
+
+/* HTTP data path, for files whose job gives a URL, and its benchmark. */
+#include "ota_http.h"
+
 /**
  * @brief Timeout for MQTT connection, if the MQTT connection is not established within
  * this time, the connect function returns #IOT_MQTT_TIMEOUT
  */
 #define OTA_DEMO_CONNECTION_TIMEOUT_MS               ( 2000UL )
 
+
+/**
+ * @brief The longest the main OTA Demo task sleeps without an event. It wakes at
+ * least this often to output the OTA statistics like number of packets received,
+ * dropped, processed and queued per connection.
+ */
+#define OTA_DEMO_TASK_DELAY_SECONDS                  ( 30UL )
+
+/**
+ * @brief The longest to wait for the OTA Agent to take a suspend request.
+ */
+#define OTA_DEMO_SUSPEND_TIMEOUT_MS                  ( 5000UL )
+
+/**
+ * @brief The step used while waiting for the OTA Agent to take a suspend request.
+ * The agent does not report its state changes, so this one is polled, briefly.
+ */
+#define OTA_DEMO_SUSPEND_POLL_MS                     ( 20UL )
+
 /**
- * @brief The maximum time interval that is permitted to elapse between the point at
- * which the MQTT client finishes transmitting one control Packet and the point it starts
- * sending the next.In the absence of control packet a PINGREQ  is sent. The broker must
- * disconnect a client that does not send a message or a PINGREQ packet in one and a
- * half times the keep alive interval.
+ * @brief The longest to wait for the OTA Agent to shut down.
  */
-#define OTA_DEMO_KEEP_ALIVE_SECONDS                  ( 120UL )
+#define OTA_DEMO_SHUTDOWN_TIMEOUT_MS                 ( 10000UL )
 
 /**
- * @brief The delay used in the main OTA Demo task loop to periodically output the OTA
- * statistics like number of packets received, dropped, processed and queued per connection.
+ * @brief Events that wake the main OTA Demo task.
  */
-#define OTA_DEMO_TASK_DELAY_SECONDS                  ( 2UL )
+#define OTA_DEMO_EVENT_DISCONNECTED                  ( 1 << 0 )
+#define OTA_DEMO_EVENT_JOB                           ( 1 << 1 )
+#define OTA_DEMO_EVENT_HTTP_FILE                     ( 1 << 2 )
+#define OTA_DEMO_EVENT_ALL                           ( OTA_DEMO_EVENT_DISCONNECTED | OTA_DEMO_EVENT_JOB | OTA_DEMO_EVENT_HTTP_FILE )
+
+/**
+ * @brief Port of the HTTPS server a job URL points to.
+ */
+#define OTA_DEMO_HTTPS_PORT                          ( 443U )
+
+/**
+ * @brief Longest host name of a job URL, with its terminator.
+ */
+#define OTA_DEMO_HTTP_HOST_MAX_LENGTH                ( 128U )
+
+/**
+ * @brief Connections tried for a fetch over HTTP before the rest of the file
+ * is left to the agent.
+ */
+#define OTA_DEMO_HTTP_TRIES                          ( 3U )
+
+/**
+ * @brief Longest time, in milliseconds, a send or receive of the HTTP
+ * connection blocks.
+ */
+#define OTA_DEMO_HTTP_TIMEOUT_MS                     ( 5000U )
 
 /**
  * @brief The base interval in seconds for retrying network connection.
@@ -117,6 +169,12 @@ volatile static bool _networkConnected = false;
  */
 static int _retryInterval = OTA_DEMO_CONN_RETRY_BASE_INTERVAL_SECONDS;
 
+/**
+ * @brief Events for the main OTA Demo task, set from the MQTT disconnect and the
+ * OTA job callbacks.
+ */
+static EventGroupHandle_t _otaDemoEvents = NULL;
+
 static const char * _pStateStr[ eOTA_AgentState_All ] =
 {
     "Init",
@@ -166,6 +224,19 @@ static int _initializeOtaDemo( void )
         }
     }
 
+    /* Create the events the demo task waits on. */
+    if( status == EXIT_SUCCESS )
+    {
+        _otaDemoEvents = xEventGroupCreate();
+
+        if( _otaDemoEvents == NULL )
+        {
+            IotLogError( "Failed to create the OTA demo event group." );
+            IotMqtt_Cleanup();
+            status = EXIT_FAILURE;
+        }
+    }
+
     if(status == EXIT_FAILURE)
     {
         if( commonLibrariesInitialized == true )
@@ -177,11 +248,54 @@ static int _initializeOtaDemo( void )
     return status;
 }
 
+/**
+ * @brief Wake the main OTA Demo task, unless the demo is being cleaned up.
+ *
+ * @param[in] bits The events to set.
+ */
+static void _setDemoEvents( EventBits_t bits )
+{
+    EventGroupHandle_t events = NULL;
+
+    taskENTER_CRITICAL();
+    events = _otaDemoEvents;
+    taskEXIT_CRITICAL();
+
+    if( events != NULL )
+    {
+        ( void ) xEventGroupSetBits( events, bits );
+    }
+}
+
 /**
  * @brief Clean up libraries initialized for OTA demo.
  */
 static void _cleanupOtaDemo( void )
 {
+    EventGroupHandle_t events = NULL;
+
+    /* The agent calls back into the demo until it has stopped. */
+    if( OTA_GetAgentState() != eOTA_AgentState_Stopped )
+    {
+        ( void ) OTA_AgentShutdown( pdMS_TO_TICKS( OTA_DEMO_SHUTDOWN_TIMEOUT_MS ) );
+    }
+
+    taskENTER_CRITICAL();
+    events = _otaDemoEvents;
+    _otaDemoEvents = NULL;
+    taskEXIT_CRITICAL();
+
+    /* A callback of an agent that did not stop may still hold the handle, so
+     * the event group is only deleted once nothing can set its bits. */
+    if( OTA_GetAgentState() == eOTA_AgentState_Stopped )
+    {
+        vEventGroupDelete( events );
+    }
+    else
+    {
+        IotLogError( "OTA Agent did not stop; its event group is left allocated.\r\n" );
+    }
+
     /* Cleanup MQTT library.*/
     IotMqtt_Cleanup();
 }
@@ -245,30 +359,43 @@ static void prvNetworkDisconnectCallback( void * param,
             break;
     }
 
-    /* Clear the flag for network connection status.*/
+    /* Clear the flag for network connection status and wake the demo task.*/
     _networkConnected = false;
+    _setDemoEvents( OTA_DEMO_EVENT_DISCONNECTED );
 }
 
 /**
- * @brief Establish a new connection to the MQTT server.
+ * @brief Called from the shadow task when its session ended under the bridge.
+ */
+static void prvSessionEndedCallback( void )
+{
+    _networkConnected = false;
+    _setDemoEvents( OTA_DEMO_EVENT_DISCONNECTED );
+}
+
+/**
+ * @brief Called from the OTA Agent task when the PAL offers a file to fetch
+ * over HTTP.
+ */
+static void prvHttpFileOfferedCallback( void )
+{
+    _setDemoEvents( OTA_DEMO_EVENT_HTTP_FILE );
+}
+
+/**
+ * @brief Establish a new MQTT connection over an open network connection.
  *
- * @param[in] awsIotMqttMode Specify if this demo is running with the AWS IoT
- * MQTT server. Set this to `false` if using another MQTT server.
  * @param[in] pIdentifier NULL-terminated MQTT client identifier.
- * @param[in] pNetworkServerInfo Passed to the MQTT connect function when
- * establishing the MQTT connection.
- * @param[in] pNetworkCredentialInfo Passed to the MQTT connect function when
- * establishing the MQTT connection.
- * @param[in] pNetworkInterface The network interface to use for this demo.
+ * @param[in] pNetworkInterface The network interface of the connection.
+ * @param[in] pNetworkConnection The open network connection.
  * @param[out] pMqttConnection Set to the handle to the new MQTT connection.
  *
  * @return `EXIT_SUCCESS` if the connection is successfully established; `EXIT_FAILURE`
  * otherwise.
  */
 static int _establishMqttConnection( const char * pIdentifier,
-                                     void * pNetworkServerInfo,
-                                     void * pNetworkCredentialInfo,
                                      const IotNetworkInterface_t * pNetworkInterface,
+                                     void * pNetworkConnection,
                                      IotMqttConnection_t * pMqttConnection )
 {
     int status = EXIT_SUCCESS;
@@ -280,9 +407,8 @@ static int _establishMqttConnection( const char * pIdentifier,
 
     /* Set the members of the network info not set by the initializer. This
      * struct provided information on the transport layer to the MQTT connection. */
-    networkInfo.createNetworkConnection = true;
-    networkInfo.u.setup.pNetworkServerInfo = pNetworkServerInfo;
-    networkInfo.u.setup.pNetworkCredentialInfo = pNetworkCredentialInfo;
+    networkInfo.createNetworkConnection = false;
+    networkInfo.u.pNetworkConnection = pNetworkConnection;
     networkInfo.pNetworkInterface = pNetworkInterface;
     networkInfo.disconnectCallback.function = prvNetworkDisconnectCallback;
 
@@ -290,7 +416,9 @@ static int _establishMqttConnection( const char * pIdentifier,
     connectInfo.awsIotMqttMode = true;//using an aws mqtt server
     connectInfo.cleanSession = true;
     connectInfo.awsIotMqttMode = true;
-    connectInfo.keepAliveSeconds = OTA_DEMO_KEEP_ALIVE_SECONDS;
+    /* The shadow task keeps the shared connection alive, so the legacy
+     * MQTT library does not ping on its own timer. */
+    connectInfo.keepAliveSeconds = 0;
     connectInfo.clientIdentifierLength = ( uint16_t ) strlen( clientcredentialIOT_THING_NAME );
     connectInfo.pClientIdentifier = clientcredentialIOT_THING_NAME;
 
@@ -343,6 +471,9 @@ static void App_OTACompleteCallback( OTA_JobEvent_t eEvent )
 
     DEFINE_OTA_METHOD_NAME( "App_OTACompleteCallback" );
 
+    /* Let the demo task check the agent and image state again. */
+    _setDemoEvents( OTA_DEMO_EVENT_JOB );
+
     /* OTA job is completed. so delete the MQTT and network connection. */
     if( eEvent == eOTA_JobEvent_Activate )
     {
@@ -414,14 +545,144 @@ static void App_OTACompleteCallback( OTA_JobEvent_t eEvent )
 /*root ca certificates*/
 #include "iot_root_certificates.h"
 
+/* Transport over secure sockets, for the HTTP data path. */
+#include "transport_secure_sockets.h"
+
+/**
+ * @brief Each compilation unit that consumes the NetworkContext must define it.
+ */
+struct NetworkContext
+{
+    SecureSocketsTransportParams_t * pParams;
+};
+
 IotNetworkCredentials_t tcpIPCredentials;
-IotNetworkServerInfo_t tcpIPConnectionParams;
 const IotNetworkInterface_t * pNetworkInterface;
 
+/**
+ * @brief Suspend the OTA Agent and wait for it to take the request.
+ *
+ * @return The state of the agent, eOTA_AgentState_Suspended once it took it.
+ */
+static OTA_State_t _suspendAgent( void )
+{
+    OTA_State_t eState;
+    uint32_t ulWaitedMs = 0U;
+
+    if( OTA_Suspend() == kOTA_Err_None )
+    {
+        while( ( ( eState = OTA_GetAgentState() ) != eOTA_AgentState_Suspended ) &&
+               ( ulWaitedMs < OTA_DEMO_SUSPEND_TIMEOUT_MS ) )
+        {
+            /* Wait for OTA Agent to process the suspend event. */
+            IotClock_SleepMs( OTA_DEMO_SUSPEND_POLL_MS );
+            ulWaitedMs += OTA_DEMO_SUSPEND_POLL_MS;
+        }
+    }
+
+    eState = OTA_GetAgentState();
+
+    if( eState != eOTA_AgentState_Suspended )
+    {
+        IotLogError( "OTA Agent not suspended after %u ms; state: %s.\r\n",
+                     ( unsigned int ) ulWaitedMs, _pStateStr[ eState ] );
+    }
+
+    return eState;
+}
+
+/**
+ * @brief Fetch the file the PAL offered over HTTP, all but its last block,
+ * then resume the agent.
+ *
+ * The agent is suspended meanwhile, so only this task writes to the file.
+ * Once resumed, the agent receives the last block, and whatever the fetch
+ * did not get, on its own data path and closes the file; the signature is
+ * checked and the job status reported as after any download.
+ *
+ * @param[in] pConnectionCtx The connection context the agent resumes with.
+ */
+static void _fetchFileOverHttp( OTA_ConnectionContext_t * pConnectionCtx )
+{
+    NetworkContext_t networkContext = { 0 };
+    SecureSocketsTransportParams_t transportParams = { 0 };
+    ServerInfo_t serverInfo = { 0 };
+    SocketsConfig_t socketsConfig = { 0 };
+    TransportInterface_t transport = { 0 };
+    OtaHttpStatus_t httpStatus = eOtaHttpNetworkError;
+    OTA_FileContext_t * pFile = NULL;
+    const char * pHost = NULL;
+    const char * pPath = NULL;
+    size_t hostLength = 0U;
+    char host[ OTA_DEMO_HTTP_HOST_MAX_LENGTH ];
+    uint32_t tries = 0U;
+
+    if( _suspendAgent() == eOTA_AgentState_Suspended )
+    {
+        /* The file is gone if the agent closed or aborted it first. */
+        pFile = OtaHttp_GetOfferedFile();
+
+        if( ( pFile != NULL ) &&
+            ( OtaHttp_ParseUrl( ( const char * ) pFile->pucUpdateUrlPath, &pHost, &hostLength, &pPath ) == true ) &&
+            ( hostLength < sizeof( host ) ) )
+        {
+            memcpy( host, pHost, hostLength );
+            host[ hostLength ] = '\0';
+
+            networkContext.pParams = &transportParams;
+            serverInfo.pHostName = host;
+            serverInfo.hostNameLength = hostLength;
+            serverInfo.port = OTA_DEMO_HTTPS_PORT;
+
+            /* The URL is presigned, so TLS with the server checked is all
+             * the authentication there is. */
+            socketsConfig.enableTls = true;
+            socketsConfig.pAlpnProtos = NULL;
+            socketsConfig.maxFragmentLength = 0;
+            socketsConfig.disableSni = false;
+            socketsConfig.pRootCa = democonfigROOT_CA_PEM;
+            socketsConfig.rootCaSize = sizeof( democonfigROOT_CA_PEM );
+            socketsConfig.sendTimeoutMs = OTA_DEMO_HTTP_TIMEOUT_MS;
+            socketsConfig.recvTimeoutMs = OTA_DEMO_HTTP_TIMEOUT_MS;
+
+            transport.pNetworkContext = &networkContext;
+            transport.send = SecureSocketsTransport_Send;
+            transport.recv = SecureSocketsTransport_Recv;
+
+            /* A broken connection is tried again for what is still missing. */
+            for( tries = 0U; ( httpStatus == eOtaHttpNetworkError ) && ( tries < OTA_DEMO_HTTP_TRIES ); tries++ )
+            {
+                IotLogInfo( "Fetching the OTA file from %s.\r\n", host );
+
+                if( SecureSocketsTransport_Connect( &networkContext, &serverInfo, &socketsConfig ) != TRANSPORT_SOCKET_STATUS_SUCCESS )
+                {
+                    IotLogError( "Failed to connect to %s.\r\n", host );
+                }
+                else
+                {
+                    httpStatus = OtaHttp_FetchFile( &transport, host, pPath, pFile, true );
+                    ( void ) SecureSocketsTransport_Disconnect( &networkContext );
+                }
+            }
+
+            IotLogInfo( "HTTP fetch ended with status %d; %u blocks left to the agent.\r\n",
+                        ( int ) httpStatus, ( unsigned int ) pFile->ulBlocksRemaining );
+        }
+
+        /* Without a session the agent is resumed once the next one is up. */
+        if( _networkConnected == true )
+        {
+            OTA_Resume( pConnectionCtx );
+        }
+    }
+}
+
 void vRunOTAUpdateDemo( const char * pIdentifier)
 {
     OTA_State_t eState;
     OTA_ImageState_t eImageState;
+    EventBits_t xEvents;
+    OtaWindowStats_t xWindowStats;
     static OTA_ConnectionContext_t xOTAConnectionCtx;
 
     IotLogInfo( "OTA demo version %u.%u.%u\r\n",
@@ -429,24 +690,19 @@ void vRunOTAUpdateDemo( const char * pIdentifier)
                 xAppFirmwareVersion.u.x.ucMinor,
                 xAppFirmwareVersion.u.x.usBuild );
 
+    OtaMqtt_SetDisconnectCallback( prvSessionEndedCallback );
+    OtaHttp_SetOfferCallback( prvHttpFileOfferedCallback );
+
     for( ; ; )
     {
-        IotLogInfo( "Connecting to broker...\r\n" );
+        /* Control and MQTT data go over the shadow connection, so there is
+         * nothing to connect until its session is up. */
+        ( void ) OtaMqtt_WaitForSession( portMAX_DELAY );
+        IotLogInfo( "Connecting through the shadow connection...\r\n" );
 
+        /* The agent opens its own socket only for the HTTP data path. */
         pNetworkInterface = IOT_NETWORK_INTERFACE_AFR;
-
-        tcpIPConnectionParams.pHostName = clientcredentialMQTT_BROKER_ENDPOINT;
-        tcpIPConnectionParams.port = clientcredentialMQTT_BROKER_PORT;
-
-        if( tcpIPConnectionParams.port == 443 )
-        {
-            tcpIPCredentials.pAlpnProtos = socketsAWS_IOT_ALPN_MQTT;
-        }
-        else
-        {
-            tcpIPCredentials.pAlpnProtos = NULL;
-        }
-
+        tcpIPCredentials.pAlpnProtos = NULL;
         tcpIPCredentials.maxFragmentLength = 0;
         tcpIPCredentials.disableSni = false;
         tcpIPCredentials.pRootCa = democonfigROOT_CA_PEM;
@@ -458,9 +714,8 @@ void vRunOTAUpdateDemo( const char * pIdentifier)
 
         /* Establish a new MQTT connection. */
         if( _establishMqttConnection( pIdentifier,
-                                      (void *)&tcpIPConnectionParams,
-                                      (void *)&tcpIPCredentials,
-                                      pNetworkInterface,
+                                      OtaMqtt_GetNetworkInterface(),
+                                      OtaMqtt_GetConnection(),
                                       &_mqttConnection ) == EXIT_SUCCESS )
         {
             /* Update the connection context shared with OTA Agent.*/
@@ -471,7 +726,9 @@ void vRunOTAUpdateDemo( const char * pIdentifier)
             /* Set the base interval for connection retry.*/
             _retryInterval = OTA_DEMO_CONN_RETRY_BASE_INTERVAL_SECONDS;
 
-            /* Update the connection available flag.*/
+            /* Update the connection available flag. An event left from the last
+             * connection is stale. */
+            ( void ) xEventGroupClearBits( _otaDemoEvents, OTA_DEMO_EVENT_ALL );
             _networkConnected = true;
 
             /* Check if OTA Agent is suspended and resume.*/
@@ -491,32 +748,57 @@ void vRunOTAUpdateDemo( const char * pIdentifier)
             //OTA_GetImageState == eOTA_ImageState_Aborted
             while( ( ( eState = OTA_GetAgentState() ) != eOTA_AgentState_Stopped ) && ( ( eImageState = OTA_GetImageState() ) != eOTA_ImageState_Aborted ) && _networkConnected )
             {
-                /* Wait forever for OTA traffic but allow other tasks to run and output statistics only once per second. */
-                IotClock_SleepMs( OTA_DEMO_TASK_DELAY_SECONDS * 1000 );
+                /* Sleep until a disconnect, a job event or a file to fetch over HTTP,
+                 * waking now and then only to output statistics. */
+                xEvents = xEventGroupWaitBits( _otaDemoEvents,
+                                               OTA_DEMO_EVENT_ALL,
+                                               pdTRUE,
+                                               pdFALSE,
+                                               pdMS_TO_TICKS( OTA_DEMO_TASK_DELAY_SECONDS * 1000 ) );
+
+                if( ( ( xEvents & OTA_DEMO_EVENT_HTTP_FILE ) != 0 ) && ( _networkConnected == true ) )
+                {
+                    _fetchFileOverHttp( &xOTAConnectionCtx );
+                }
 
-                IotLogInfo( "State: %s  Received: %u   Queued: %u   Processed: %u   Dropped: %u\r\n", _pStateStr[ eState ],
-                            OTA_GetPacketsReceived(), OTA_GetPacketsQueued(), OTA_GetPacketsProcessed(), OTA_GetPacketsDropped() );
+                IotLogInfo( "State: %s  Received: %u   Queued: %u   Processed: %u   Dropped: %u   Duplicated: %u   Rate: %u B/s\r\n", _pStateStr[ eState ],
+                            OTA_GetPacketsReceived(), OTA_GetPacketsQueued(), OTA_GetPacketsProcessed(), OTA_GetPacketsDropped(),
+                            OTA_GetPacketsDuplicated(), OTA_GetPacketsThroughput() );
+
+                OtaWindow_GetStats( &xWindowStats );
+                IotLogInfo( "Window: %u blocks   Blocks: %u   Cuts: %u\r\n",
+                            xWindowStats.ulWindowBlocks, xWindowStats.ulBlocks, xWindowStats.ulCuts );
             }
             IotLogInfo( "State: %s" , _pStateStr[ eState ]);
 
             /* Check if we got network disconnect callback and suspend OTA Agent.*/
             if( _networkConnected == false )
             {
-                /* Suspend OTA agent.*/
-                if( OTA_Suspend() == kOTA_Err_None )
+                /* Suspend OTA agent. One that did not suspend still runs on the
+                 * lost connection; it is shut down and initialized afresh on the
+                 * next one. */
+                if( _suspendAgent() != eOTA_AgentState_Suspended )
                 {
-                    while( ( eState = OTA_GetAgentState() ) != eOTA_AgentState_Suspended )
+                    IotLogError( "Shutting the OTA Agent down.\r\n" );
+
+                    if( OTA_AgentShutdown( pdMS_TO_TICKS( OTA_DEMO_SHUTDOWN_TIMEOUT_MS ) ) != eOTA_AgentState_Stopped )
                     {
-                        /* Wait for OTA Agent to process the suspend event. */
-                        IotClock_SleepMs( OTA_DEMO_TASK_DELAY_SECONDS * 1000 );
+                        IotLogError( "OTA Agent did not shut down.\r\n" );
+                        /*exit this loop, will attempt to OTA after a restart*/
+                        break;
                     }
                 }
+
+                /* The session under the bridge is gone, so only free the
+                 * connection; there is nobody to send DISCONNECT to. */
+                IotMqtt_Disconnect( _mqttConnection, IOT_MQTT_FLAG_CLEANUP_ONLY );
+                _mqttConnection = IOT_MQTT_CONNECTION_INITIALIZER;
             }
             /*ota stopped because OTA image abort or OTA agent state is stopped*/
             else
             {
 
-                OTA_AgentShutdown(pdMS_TO_TICKS( 10 * 1000 ));
+                OTA_AgentShutdown( pdMS_TO_TICKS( OTA_DEMO_SHUTDOWN_TIMEOUT_MS ) );
                 /* Try to close the MQTT connection. */
                 if( _mqttConnection != NULL )
                 {
@@ -529,10 +811,11 @@ void vRunOTAUpdateDemo( const char * pIdentifier)
         else
         {
             IotLogError( "ERROR:  MQTT_AGENT_Connect() Failed.\r\n" );
-        }
 
-        /* After failure to connect or a disconnect, delay for retrying connection. */
-        _connectionRetryDelay();
+            /* A session that just went down is waited for above; a connect
+             * refused on a live one is retried later. */
+            _connectionRetryDelay();
+        }
     }
 }
 
@@ -565,6 +848,10 @@ void vStartOTAUpdateDemoTask(void * params)
     {
         otademoInitialized = true;
 
+        /* Compare pipelined HTTP range requests against one at a time, if
+         * a local server is configured. */
+        OtaHttp_RunBenchmark();
+
         /* Start OTA Agent.*/
         vRunOTAUpdateDemo( clientcredentialIOT_THING_NAME );
     }
@@ -33,13 +33,61 @@
 #define _AWS_BUFFER_POOL_CONFIG_H_
 
 /**
- * @brief The number of buffers in the static buffer pool.
+ * @brief Size classes of the shared buffer pool (buffer_pool.c).
+ *
+ * A request is served from the smallest class whose buffers are large
+ * enough, falling back to the larger classes when it is exhausted; a request
+ * larger than the large buffers takes a run of adjacent large buffers. Each
+ * class may hold up to 32 buffers and buffer sizes must be a multiple of 4.
+ *
+ * The pool is 5 KB. Its users are listed with each class; they borrow a
+ * buffer for one operation, except the MQTT network buffer, which is held
+ * for a session. The ulHighWater and ulFailures counters of
+ * BufferPool_GetStats() show what a build actually used.
+ */
+
+/**
+ * @brief Small buffers, for shadow documents and short payloads.
+ *
+ * - Shadow reports, held until answered: democonfigSHADOW_MAX_UPDATES_IN_FLIGHT (3).
+ * - A string property being applied from a CBOR section: 1.
  */
-#define bufferpoolconfigNUM_BUFFERS    ( 8 )
+#define bufferpoolconfigSMALL_BUFFER_SIZE     ( 128 )
+#define bufferpoolconfigSMALL_NUM_BUFFERS     ( 4 )
 
 /**
- * @brief The size of each buffer in the static buffer pool.
+ * @brief Medium buffers, for queued telemetry records and other buffers
+ * up to 512 bytes.
+ *
+ * - Publish queue records, held until acknowledged:
+ *   publishqueueconfigMAX_IN_FLIGHT (2).
+ * - One at a time: the metrics message being formatted, the shadow cache
+ *   file, or the topic filters of a subscribe: 1.
+ * - OTA, one file at a time: 2. While the file is received they hold the
+ *   HTTP block, or the response headers and the request of an HTTP fetch,
+ *   and the chunk file reads of a compressed image catching up on blocks
+ *   that came ahead of their turn; without a buffer those wait for the
+ *   close. When it is closed they hold the chunk file reads of a delta or
+ *   compressed image being built. These borrow from the large class when
+ *   the queue holds its records.
+ */
+#define bufferpoolconfigMEDIUM_BUFFER_SIZE    ( 512 )
+#define bufferpoolconfigMEDIUM_NUM_BUFFERS    ( 3 )
+
+/**
+ * @brief Large buffers, for MQTT network buffers and OTA buffers that do
+ * not fit a medium one.
+ *
+ * - The network buffer of the shadow or the mutual auth demo, whichever
+ *   runs, held for the session: 1. OTA traffic shares it.
+ * - OTA, one file at a time: 2. While the file is received they hold the
+ *   write-behind run of the chunk file being written, or the output of a
+ *   compressed image decompressed as it comes (two buffers), and the
+ *   file blocks the medium class cannot take while the queue holds its
+ *   records. When it is closed they hold the signer certificate (two
+ *   buffers), then the output of an image being built (two buffers).
  */
-#define bufferpoolconfigBUFFER_SIZE    ( 2048 + 128 )
+#define bufferpoolconfigLARGE_BUFFER_SIZE     ( 1024 )
+#define bufferpoolconfigLARGE_NUM_BUFFERS     ( 3 )
 
 #endif /* _AWS_BUFFER_POOL_CONFIG_H_ */
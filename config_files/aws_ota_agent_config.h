@@ -31,6 +31,9 @@
 #ifndef _AWS_OTA_AGENT_CONFIG_H_
 #define _AWS_OTA_AGENT_CONFIG_H_
 
+/* Adaptive block-request window. */
+#include "ota_window.h"
+
 /**
  * @brief The number of words allocated to the stack for the OTA agent.
  */
@@ -39,9 +42,11 @@
 /**
  * @brief Log base 2 of the size of the file data block message (excluding the header).
  *
- * 10 bits yields a data block size of 1KB.
+ * 9 bits yields a data block size of 512 B. The blocks arrive on the shadow
+ * connection, so a block with its topic and CBOR header must fit the 1 KB
+ * network buffer of the shadow task.
  */
-#define otaconfigLOG2_FILE_BLOCK_SIZE           10UL
+#define otaconfigLOG2_FILE_BLOCK_SIZE           9UL
 
 /**
  * @brief Milliseconds to wait for the self test phase to succeed before we force reset.
@@ -102,8 +107,13 @@
  * data blocks response is expected for each data requests.
  *
  * @note This must be set to a value larger than zero.
+ *
+ * @note This is taken from the adaptive window in ota_window.c, which stays
+ * between otawindowconfigMIN_BLOCKS and otawindowconfigMAX_BLOCKS. The window
+ * is latched once per request, so every expansion for a request has the same
+ * value and OtaWindow_GetBlocks() may be called any number of times.
  */
-#define otaconfigMAX_NUM_BLOCKS_REQUEST         4U
+#define otaconfigMAX_NUM_BLOCKS_REQUEST         ( OtaWindow_GetBlocks() )
 
 /**
  * @brief The maximum number of requests allowed to send without a response before we abort.
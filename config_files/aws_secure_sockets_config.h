@@ -74,4 +74,11 @@
  */
 #define socketsconfigSECURE_FILE_NAME_PRIVATEKEY        "/certs/PrivateKey.key"
 
+/**
+ * @brief Let the reconnect engine time the TCP connect and the TLS
+ * handshake of SOCKETS_Connect separately.
+ */
+extern void Reconnect_OnTcpConnected( void );
+#define securesocketsTCP_CONNECTED_HOOK()    Reconnect_OnTcpConnected()
+
 #endif /* AWS_INC_SOCKETS_CONFIG_H_ */
@@ -0,0 +1,72 @@
+/*
+ * keep_alive_config.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef KEEP_ALIVE_CONFIG_H_
+#define KEEP_ALIVE_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the keep-alive manager.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * keep-alive manager.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the keep-alive manager. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "KeepAlive"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Keep alive reported to the broker in CONNECT, in seconds.
+ *
+ * This is only the broker's safety net; the manager pings well before it
+ * expires. AWS IoT accepts at most 1200 seconds.
+ */
+#define keepaliveconfigBROKER_KEEP_ALIVE_SECONDS    ( 1200U )
+
+/**
+ * @brief Idle time, in seconds, before the first ping of a fresh boot.
+ */
+#define keepaliveconfigINITIAL_INTERVAL_SECONDS     ( 60U )
+
+/**
+ * @brief Shortest ping interval the manager backs off to, in seconds.
+ */
+#define keepaliveconfigMIN_INTERVAL_SECONDS         ( 30U )
+
+/**
+ * @brief Longest ping interval the manager probes up to, in seconds. Must
+ * leave margin below keepaliveconfigBROKER_KEEP_ALIVE_SECONDS.
+ */
+#define keepaliveconfigMAX_INTERVAL_SECONDS         ( 900U )
+
+/**
+ * @brief Percentage added to the interval after each successful probe.
+ */
+#define keepaliveconfigPROBE_STEP_PERCENT           ( 50U )
+
+/**
+ * @brief Percentage of the last good interval used after the connection
+ * fails at an interval that had already been confirmed.
+ */
+#define keepaliveconfigBACKOFF_PERCENT              ( 75U )
+
+#endif /* KEEP_ALIVE_CONFIG_H_ */
@@ -0,0 +1,58 @@
+/*
+ * mqtt_metrics_config.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef MQTT_METRICS_CONFIG_H_
+#define MQTT_METRICS_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the MQTT metrics.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * MQTT metrics.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the MQTT metrics. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "MQTTMetrics"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Interval, in milliseconds, between metrics telemetry messages.
+ *
+ * The message is handed to the store-and-forward publish queue, so it is
+ * kept while the broker is unreachable. 0 disables the telemetry.
+ */
+#define mqttmetricsconfigPUBLISH_INTERVAL_MS    ( 300000U )
+
+/**
+ * @brief Stack size, in words, and priority of the task that queues the
+ * metrics telemetry. It runs whether or not a session is up.
+ */
+#define mqttmetricsconfigTASK_STACK_SIZE        ( configMINIMAL_STACK_SIZE * 4 )
+#define mqttmetricsconfigTASK_PRIORITY          ( tskIDLE_PRIORITY + 1 )
+
+/**
+ * @brief Topic the metrics telemetry is published to. The thing name is
+ * inserted at %s.
+ */
+#define mqttmetricsconfigTOPIC_FORMAT           "dt/%s/mqtt-metrics"
+
+#endif /* MQTT_METRICS_CONFIG_H_ */
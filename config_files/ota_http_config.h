@@ -0,0 +1,77 @@
+/*
+ * ota_http_config.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HTTP_CONFIG_H_
+#define OTA_HTTP_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the OTA HTTP data path.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * OTA HTTP data path.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the OTA HTTP data path. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "OtaHttp"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Most range requests sent ahead of their responses on the
+ * connection.
+ *
+ * Responses come back in order on one connection, so this hides the round
+ * trip between a response and the next request; the server queues the rest.
+ */
+#define otahttpconfigMAX_OUTSTANDING         ( 4U )
+
+/**
+ * @brief Most blocks of the OTA file asked for in one range request.
+ */
+#define otahttpconfigRANGE_BLOCKS            ( 32U )
+
+/**
+ * @brief Size of the buffer the response headers are read into, in bytes.
+ * Bytes read past the headers are kept there for the body and the next
+ * response.
+ */
+#define otahttpconfigHEADER_BUFFER_LENGTH    ( 512U )
+
+/**
+ * @brief Longest time, in milliseconds, without a byte from the server.
+ */
+#define otahttpconfigRECV_TIMEOUT_MS         ( 5000U )
+
+/**
+ * @brief Plain HTTP server OtaHttp_RunBenchmark() downloads from, e.g. a
+ * stand-in on the development machine.
+ */
+#define otahttpconfigBENCHMARK_HOST          "192.168.1.10"
+#define otahttpconfigBENCHMARK_PORT          ( 8080U )
+#define otahttpconfigBENCHMARK_PATH          "/image.bin"
+
+/**
+ * @brief Size, in bytes, of the file OtaHttp_RunBenchmark() downloads. 0
+ * disables the benchmark.
+ */
+#define otahttpconfigBENCHMARK_FILE_SIZE     ( 0U )
+
+#endif /* OTA_HTTP_CONFIG_H_ */
@@ -0,0 +1,78 @@
+/*
+ * ota_mqtt_config.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_MQTT_CONFIG_H_
+#define OTA_MQTT_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the OTA MQTT bridge.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * OTA MQTT bridge.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the OTA MQTT bridge. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "OtaMqtt"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Number of topic filters OTA can hold at once.
+ *
+ * The agent subscribes to the job notifications, the answer to its job
+ * request and the data topic of the stream it downloads.
+ */
+#define otamqttconfigMAX_SUBSCRIPTIONS       ( 4U )
+
+/**
+ * @brief Longest topic filter, in bytes.
+ *
+ * The longest OTA filter is the stream data topic:
+ * "$aws/things/<thing name>/streams/<stream name>/data/cbor".
+ */
+#define otamqttconfigMAX_TOPIC_LENGTH        ( 160U )
+
+/**
+ * @brief Largest packet, in bytes, the MQTT library of the agent can send
+ * through the bridge.
+ *
+ * The largest is a job status update with its status details. The shadow
+ * task copies one packet at a time into a buffer of this size.
+ */
+#define otamqttconfigMAX_PACKET_SIZE         ( 512U )
+
+/**
+ * @brief Bytes of packets from the agent waiting for the shadow task.
+ *
+ * The agent sends one block request at a time and waits for the answers
+ * to its subscribes and status publishes, so this holds a few packets. It
+ * must hold one packet of otamqttconfigMAX_PACKET_SIZE and its 4 byte
+ * length.
+ */
+#define otamqttconfigSEND_BUFFER_SIZE        ( 768U )
+
+/**
+ * @brief Longest time, in milliseconds, a send from the agent waits for
+ * room in the send buffer.
+ */
+#define otamqttconfigSEND_TIMEOUT_MS         ( 1000U )
+
+#endif /* OTA_MQTT_CONFIG_H_ */
@@ -0,0 +1,70 @@
+/*
+ * ota_window_config.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_WINDOW_CONFIG_H_
+#define OTA_WINDOW_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the OTA block window.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * OTA block window.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the OTA block window. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "OtaWindow"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Blocks asked for in the first request of a file.
+ */
+#define otawindowconfigINITIAL_BLOCKS    ( 2U )
+
+/**
+ * @brief Fewest blocks asked for in one request.
+ */
+#define otawindowconfigMIN_BLOCKS        ( 1U )
+
+/**
+ * @brief Most blocks asked for in one request.
+ *
+ * Each block comes in a publish of its own, so the TLS receive buffer does
+ * not bound this, but a block that finds all otaconfigMAX_NUM_OTA_DATA_BUFFERS
+ * taken is dropped. It may be no more than that number.
+ */
+#define otawindowconfigMAX_BLOCKS        ( 4U )
+
+/**
+ * @brief Percentage the block rate of a request must beat the one before
+ * it by for the window to grow by one block.
+ */
+#define otawindowconfigGAIN_PERCENT      ( 5U )
+
+/**
+ * @brief Gap between two blocks, in milliseconds, taken as a lost block.
+ *
+ * The agent asks again only after otaconfigFILE_REQUEST_WAIT_MS without a
+ * block, so a gap this long means a request was not answered in full.
+ */
+#define otawindowconfigSTALL_MS          ( 3000U )
+
+#endif /* OTA_WINDOW_CONFIG_H_ */
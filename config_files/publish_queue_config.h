@@ -0,0 +1,104 @@
+/*
+ * publish_queue_config.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef PUBLISH_QUEUE_CONFIG_H_
+#define PUBLISH_QUEUE_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the publish queue.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * publish queue.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the publish queue. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "PubQueue"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Longest topic name, in bytes, that can be queued.
+ *
+ * Topics are copied into the queue record so the caller's buffer can be
+ * reused as soon as #PublishQueue_Enqueue returns.
+ */
+#define publishqueueconfigMAX_TOPIC_LENGTH          ( 64U )
+
+/**
+ * @brief Largest payload, in bytes, that can be queued.
+ *
+ * Larger payloads are rejected and counted in ulDroppedTooLarge.
+ */
+#define publishqueueconfigMAX_PAYLOAD_LENGTH        ( 256U )
+
+/**
+ * @brief Number of records held in RAM.
+ *
+ * These are the most recent messages. When the RAM ring is full the oldest
+ * publishqueueconfigSPILL_BATCH records are written out to flash.
+ */
+#define publishqueueconfigRAM_RECORDS               ( 8U )
+
+/**
+ * @brief Number of records moved to flash in one spill.
+ *
+ * Each spill writes one segment file, so this is also the record count of a
+ * segment. Must not be larger than publishqueueconfigRAM_RECORDS.
+ */
+#define publishqueueconfigSPILL_BATCH               ( 4U )
+
+/**
+ * @brief Number of segment files in the flash ring.
+ *
+ * Flash capacity is publishqueueconfigFLASH_SEGMENTS * publishqueueconfigSPILL_BATCH
+ * records. Once every segment is used the oldest one is discarded and its
+ * records are counted as dropped.
+ */
+#define publishqueueconfigFLASH_SEGMENTS            ( 32U )
+
+/**
+ * @brief File name prefix of the flash segments. The segment index is
+ * appended to it.
+ */
+#define publishqueueconfigSEGMENT_FILE_PREFIX       "pubq_seg"
+
+/**
+ * @brief Number of queued publishes allowed to wait for a PUBACK at once.
+ *
+ * This has to leave room in the helper's outgoing publish window
+ * (democonfigMAX_OUTGOING_PUBLISHES) for the shadow traffic. Each in-flight
+ * record is borrowed from the medium class of the shared buffer pool.
+ */
+#define publishqueueconfigMAX_IN_FLIGHT             ( 2U )
+
+/**
+ * @brief Sustained drain rate, in messages per second, once the connection
+ * comes back.
+ */
+#define publishqueueconfigDRAIN_RATE_PER_SECOND     ( 10U )
+
+/**
+ * @brief Largest burst, in messages, the drain may send at once after being
+ * idle.
+ */
+#define publishqueueconfigDRAIN_BURST               ( 4U )
+
+#endif /* PUBLISH_QUEUE_CONFIG_H_ */
@@ -0,0 +1,76 @@
+/*
+ * reconnect_config.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef RECONNECT_CONFIG_H_
+#define RECONNECT_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the reconnect engine.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * reconnect engine.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the reconnect engine. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "Reconnect"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Smallest delay, in milliseconds, between connection attempts.
+ *
+ * The first attempt after a connection is lost waits a random time up to
+ * this value, so a fleet dropped by the same broker event does not come
+ * back in one burst.
+ */
+#define reconnectconfigBACKOFF_BASE_MS             ( 1000U )
+
+/**
+ * @brief Largest delay, in milliseconds, between connection attempts.
+ *
+ * Attempts never stop; this only caps the decorrelated jitter.
+ */
+#define reconnectconfigBACKOFF_MAX_MS              ( 120000U )
+
+/**
+ * @brief Consecutive failures of one phase (DNS, TCP, TLS or CONNACK)
+ * that open its circuit breaker.
+ */
+#define reconnectconfigBREAKER_THRESHOLD           ( 3U )
+
+/**
+ * @brief Time, in milliseconds, a breaker stays open after it first trips.
+ * It doubles each time the half-open trial attempt fails again.
+ */
+#define reconnectconfigBREAKER_COOLDOWN_MS         ( 60000U )
+
+/**
+ * @brief Longest time, in milliseconds, a breaker stays open.
+ */
+#define reconnectconfigBREAKER_MAX_COOLDOWN_MS     ( 900000U )
+
+/**
+ * @brief Expected time, in milliseconds, from the start of an attempt to
+ * CONNACK. Successful attempts that take longer are counted and logged.
+ */
+#define reconnectconfigWARM_UP_BUDGET_MS           ( 8000U )
+
+#endif /* RECONNECT_CONFIG_H_ */
@@ -0,0 +1,46 @@
+/*
+ * shadow_cache_config.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef SHADOW_CACHE_CONFIG_H_
+#define SHADOW_CACHE_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the shadow state cache.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * shadow state cache.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the shadow state cache. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "ShadowCache"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Largest cache file, header included.
+ *
+ * The file is built in, and read back into, a buffer borrowed from the
+ * shared buffer pool, so this must not exceed its largest class. Each
+ * property takes 4 bytes plus its name and value.
+ */
+#define shadowcacheconfigMAX_FILE_SIZE    ( 512U )
+
+#endif /* SHADOW_CACHE_CONFIG_H_ */
@@ -0,0 +1,44 @@
+/*
+ * shadow_cbor_config.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef SHADOW_CBOR_CONFIG_H_
+#define SHADOW_CBOR_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the shadow CBOR codec.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * shadow CBOR codec.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the shadow CBOR codec. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "ShadowCbor"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Number of times ShadowCbor_RunBenchmark() encodes and decodes a
+ * recorded section, once as JSON and once as CBOR. 0 disables the
+ * benchmark.
+ */
+#define shadowcborconfigBENCHMARK_ITERATIONS    ( 0U )
+
+#endif /* SHADOW_CBOR_CONFIG_H_ */
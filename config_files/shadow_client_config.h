@@ -0,0 +1,52 @@
+/*
+ * shadow_client_config.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef SHADOW_CLIENT_CONFIG_H_
+#define SHADOW_CLIENT_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the shadow client.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * shadow client.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the shadow client. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "ShadowClient"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Most shadows, classic and named, registered on one connection.
+ */
+#define shadowclientconfigMAX_SHADOWS         ( 4U )
+
+/**
+ * @brief Bytes set aside for the cached get and update topics of every
+ * shadow.
+ *
+ * Each shadow takes twice its topic prefix plus 11 bytes, where the prefix
+ * is "$aws/things/<thing>/shadow/" for the classic shadow and
+ * "$aws/things/<thing>/shadow/name/<name>/" for a named one.
+ */
+#define shadowclientconfigTOPIC_CACHE_SIZE    ( 384U )
+
+#endif /* SHADOW_CLIENT_CONFIG_H_ */
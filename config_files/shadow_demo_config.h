@@ -118,4 +118,47 @@
  */
 #define democonfigNETWORK_BUFFER_SIZE    ( 1024U )
 
+/**
+ * @brief Time, in milliseconds, spent forwarding the store-and-forward backlog
+ * after each connect before the shadow sync starts.
+ */
+#define democonfigPUBLISH_QUEUE_FLUSH_TIMEOUT_MS    ( 5000U )
+
+/**
+ * @brief Quiet time, in milliseconds, after the last change to the reported
+ * state before it is published, so a burst of changes goes out as one
+ * update.
+ */
+#define democonfigSHADOW_COALESCE_WINDOW_MS         ( 500U )
+
+/**
+ * @brief Longest time, in milliseconds, a change waits for the burst it is
+ * part of to end before it is published anyway.
+ */
+#define democonfigSHADOW_MAX_STALENESS_MS           ( 5000U )
+
+/**
+ * @brief Shortest time, in milliseconds, between two reported state
+ * updates. Changes made in between are merged into the next update.
+ */
+#define democonfigSHADOW_MIN_REPORT_INTERVAL_MS     ( 2000U )
+
+/**
+ * @brief Reported state updates that may wait for their answer at once.
+ * Changes made while every one is in flight wait for the next free slot.
+ */
+#define democonfigSHADOW_MAX_UPDATES_IN_FLIGHT      ( 3U )
+
+/**
+ * @brief Name of the shadow the demo keeps in sync; "" for the classic
+ * shadow of the thing.
+ */
+#define democonfigSHADOW_NAME                       ""
+
+/**
+ * @brief SimpleLink file holding the last state accepted by the shadow,
+ * applied at boot before the network is up.
+ */
+#define democonfigSHADOW_CACHE_FILE                 "shadow_state"
+
 #endif /* SHADOW_DEMO_CONFIG_H */
@@ -0,0 +1,53 @@
+/*
+ * shadow_json_config.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Brandon
+ */
+
+#ifndef SHADOW_JSON_CONFIG_H_
+#define SHADOW_JSON_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the shadow JSON extractor.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * shadow JSON extractor.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the shadow JSON extractor. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "ShadowJson"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Deepest nesting of objects and arrays accepted in a document.
+ *
+ * Each level costs 16 bytes of the calling task's stack while a document
+ * is parsed. Shadow documents with metadata nest five levels deep.
+ */
+#define shadowjsonconfigMAX_DEPTH                 ( 10U )
+
+/**
+ * @brief Number of times each recorded payload is parsed by
+ * ShadowJson_RunBenchmark(), once with the extractor and once with
+ * JSON_Validate followed by one JSON_Search per key. 0 disables the
+ * benchmark.
+ */
+#define shadowjsonconfigBENCHMARK_ITERATIONS      ( 0U )
+
+#endif /* SHADOW_JSON_CONFIG_H_ */
@@ -0,0 +1,50 @@
+/*
+ * FreeRTOS.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_FREERTOS_H_
+#define OTA_HOST_BENCH_FREERTOS_H_
+
+/**
+ * @file FreeRTOS.h
+ * @brief The part of the kernel the OTA and shadow code use, on the host.
+ *
+ * Ticks are milliseconds of CLOCK_MONOTONIC. pvPortMalloc() counts what is
+ * in use and its peak, which is what the bench reports as heap.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define pdFALSE                 ( ( BaseType_t ) 0 )
+#define pdTRUE                  ( ( BaseType_t ) 1 )
+#define pdPASS                  ( pdTRUE )
+#define pdFAIL                  ( pdFALSE )
+#define portTICK_PERIOD_MS      ( ( TickType_t ) 1 )
+#define pdMS_TO_TICKS( xMs )    ( ( TickType_t ) ( xMs ) )
+#define tskIDLE_PRIORITY        ( ( UBaseType_t ) 0U )
+#define configASSERT( x )       assert( x )
+
+void * pvPortMalloc( size_t xSize );
+void vPortFree( void * pv );
+
+/**
+ * @brief Bytes allocated with pvPortMalloc() and not freed.
+ */
+size_t xHostHeapInUse( void );
+
+/**
+ * @brief Most bytes in use at once since the last call.
+ */
+size_t xHostHeapResetPeak( void );
+
+#endif /* OTA_HOST_BENCH_FREERTOS_H_ */
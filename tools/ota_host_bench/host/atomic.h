@@ -0,0 +1,58 @@
+/*
+ * atomic.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_ATOMIC_H_
+#define OTA_HOST_BENCH_ATOMIC_H_
+
+/**
+ * @file atomic.h
+ * @brief The FreeRTOS atomic helpers buffer_pool.c uses, on GCC builtins.
+ */
+
+#include <stdint.h>
+
+#define ATOMIC_COMPARE_AND_SWAP_SUCCESS    0x1U
+#define ATOMIC_COMPARE_AND_SWAP_FAILURE    0x0U
+
+static inline uint32_t Atomic_CompareAndSwap_u32( uint32_t volatile * pulDestination,
+                                                  uint32_t ulExchange,
+                                                  uint32_t ulComparand )
+{
+    return __atomic_compare_exchange_n( pulDestination, &ulComparand, ulExchange, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) ?
+           ATOMIC_COMPARE_AND_SWAP_SUCCESS : ATOMIC_COMPARE_AND_SWAP_FAILURE;
+}
+
+static inline uint32_t Atomic_Add_u32( uint32_t volatile * pulAddend,
+                                      uint32_t ulCount )
+{
+    return __atomic_fetch_add( pulAddend, ulCount, __ATOMIC_SEQ_CST );
+}
+
+static inline uint32_t Atomic_Subtract_u32( uint32_t volatile * pulAddend,
+                                           uint32_t ulCount )
+{
+    return __atomic_fetch_sub( pulAddend, ulCount, __ATOMIC_SEQ_CST );
+}
+
+static inline uint32_t Atomic_Increment_u32( uint32_t volatile * pulAddend )
+{
+    return __atomic_fetch_add( pulAddend, 1U, __ATOMIC_SEQ_CST );
+}
+
+static inline uint32_t Atomic_Decrement_u32( uint32_t volatile * pulAddend )
+{
+    return __atomic_fetch_sub( pulAddend, 1U, __ATOMIC_SEQ_CST );
+}
+
+static inline uint32_t Atomic_OR_u32( uint32_t volatile * pulDestination,
+                                      uint32_t ulValue )
+{
+    return __atomic_fetch_or( pulDestination, ulValue, __ATOMIC_SEQ_CST );
+}
+
+#endif /* OTA_HOST_BENCH_ATOMIC_H_ */
@@ -0,0 +1,103 @@
+/*
+ * aws_iot_ota_agent.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_AWS_IOT_OTA_AGENT_H_
+#define OTA_HOST_BENCH_AWS_IOT_OTA_AGENT_H_
+
+/**
+ * @file aws_iot_ota_agent.h
+ * @brief The part of the OTA agent (v1) header the PAL and the OTA helpers
+ * use. The bench plays the agent itself, so only the types, error codes and
+ * packet counters are here.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Kernel. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* The project's agent configuration, so block size and timeouts match. */
+#include "aws_ota_agent_config.h"
+
+#define OTA_FILE_SIG_KEY_STR_MAX_LENGTH    32
+#define kOTA_MaxSignatureSize              384
+
+#define CONST_STRLEN( s )                  ( ( ( uint32_t ) sizeof( s ) ) - 1UL )
+#define DEFINE_OTA_METHOD_NAME( name )     static const char OTA_METHOD_NAME[] = name;
+#define OTA_LOG_L1( ... )                  ( void ) fprintf( stderr, __VA_ARGS__ )
+
+typedef uint32_t OTA_Err_t;
+
+#define kOTA_PAL_ErrMask                   0xffffffUL
+#define kOTA_Err_Uninitialized             0xff000000UL
+#define kOTA_Err_None                      0x00000000UL
+#define kOTA_Err_SignatureCheckFailed      0x01000000UL
+#define kOTA_Err_CommitFailed              0x05000000UL
+#define kOTA_Err_RejectFailed              0x06000000UL
+#define kOTA_Err_AbortFailed               0x07000000UL
+#define kOTA_Err_BadImageState             0x09000000UL
+#define kOTA_Err_FileAbort                 0x10000000UL
+#define kOTA_Err_FileClose                 0x11000000UL
+#define kOTA_Err_RxFileCreateFailed        0x12000000UL
+#define kOTA_Err_BootInfoCreateFailed      0x13000000UL
+#define kOTA_Err_RxFileTooLarge            0x14000000UL
+#define kOTA_Err_ResetNotSupported         0x29000000UL
+
+typedef enum
+{
+    eOTA_ImageState_Unknown = 0,
+    eOTA_ImageState_Testing,
+    eOTA_ImageState_Accepted,
+    eOTA_ImageState_Rejected,
+    eOTA_ImageState_Aborted
+} OTA_ImageState_t;
+
+typedef enum
+{
+    eOTA_PAL_ImageState_Unknown = 0,
+    eOTA_PAL_ImageState_PendingCommit,
+    eOTA_PAL_ImageState_Valid,
+    eOTA_PAL_ImageState_Invalid
+} OTA_PAL_ImageState_t;
+
+typedef struct
+{
+    uint16_t usSize;
+    uint8_t ucData[ kOTA_MaxSignatureSize ];
+} Sig_t;
+
+typedef struct OTA_FileContext
+{
+    uint8_t * pucFilePath;
+    int32_t lFileHandle;
+    uint32_t ulFileSize;
+    uint32_t ulBlocksRemaining;
+    uint32_t ulFileAttributes;
+    uint32_t ulServerFileID;
+    uint8_t * pucJobName;
+    uint8_t * pucStreamName;
+    Sig_t * pxSignature;
+    uint8_t * pucRxBlockBitmap;
+    uint8_t * pucCertFilepath;
+    uint8_t * pucUpdateUrlPath;
+} OTA_FileContext_t;
+
+/**
+ * @brief Data packets the agent dropped for want of a buffer; kept by the bench.
+ */
+uint32_t OTA_GetPacketsDropped( void );
+
+/**
+ * @brief Data packets the agent processed; kept by the bench.
+ */
+uint32_t OTA_GetPacketsProcessed( void );
+
+#endif /* OTA_HOST_BENCH_AWS_IOT_OTA_AGENT_H_ */
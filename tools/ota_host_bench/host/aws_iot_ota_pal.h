@@ -0,0 +1,25 @@
+/*
+ * aws_iot_ota_pal.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_AWS_IOT_OTA_PAL_H_
+#define OTA_HOST_BENCH_AWS_IOT_OTA_PAL_H_
+
+#include "aws_iot_ota_agent.h"
+
+OTA_Err_t prvPAL_Abort( OTA_FileContext_t * const C );
+OTA_Err_t prvPAL_CreateFileForRx( OTA_FileContext_t * const C );
+OTA_Err_t prvPAL_CloseFile( OTA_FileContext_t * const C );
+int16_t prvPAL_WriteBlock( OTA_FileContext_t * const C,
+                           uint32_t ulOffset,
+                           uint8_t * const pcData,
+                           uint32_t ulBlockSize );
+OTA_Err_t prvPAL_ActivateNewImage( void );
+OTA_Err_t prvPAL_ResetDevice( void );
+OTA_Err_t prvPAL_SetPlatformImageState( OTA_ImageState_t eState );
+OTA_PAL_ImageState_t prvPAL_GetPlatformImageState( void );
+
+#endif /* OTA_HOST_BENCH_AWS_IOT_OTA_PAL_H_ */
@@ -0,0 +1,17 @@
+/*
+ * logging_levels.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_LOGGING_LEVELS_H_
+#define OTA_HOST_BENCH_LOGGING_LEVELS_H_
+
+#define LOG_NONE     0
+#define LOG_ERROR    1
+#define LOG_WARN     2
+#define LOG_INFO     3
+#define LOG_DEBUG    4
+
+#endif /* OTA_HOST_BENCH_LOGGING_LEVELS_H_ */
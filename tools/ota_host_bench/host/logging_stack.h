@@ -0,0 +1,59 @@
+/*
+ * logging_stack.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+/* Included once per library configuration, like the FreeRTOS logging stack,
+ * so there is no include guard. Logs go to stderr and the report to stdout. */
+
+#include <stdio.h>
+
+#include "logging_levels.h"
+
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "Bench"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+#undef LogError
+#undef LogWarn
+#undef LogInfo
+#undef LogDebug
+
+#define HOST_LOG( message )                                    \
+    do {                                                       \
+        ( void ) fprintf( stderr, "[%s] ", LIBRARY_LOG_NAME ); \
+        ( void ) fprintf message;                              \
+        ( void ) fprintf( stderr, "\n" );                      \
+    } while( 0 )
+
+#define HOST_LOG_ARGS( ... )    ( stderr, __VA_ARGS__ )
+
+#if LIBRARY_LOG_LEVEL >= LOG_ERROR
+    #define LogError( message )    HOST_LOG( HOST_LOG_ARGS message )
+#else
+    #define LogError( message )
+#endif
+
+#if LIBRARY_LOG_LEVEL >= LOG_WARN
+    #define LogWarn( message )    HOST_LOG( HOST_LOG_ARGS message )
+#else
+    #define LogWarn( message )
+#endif
+
+#if LIBRARY_LOG_LEVEL >= LOG_INFO
+    #define LogInfo( message )    HOST_LOG( HOST_LOG_ARGS message )
+#else
+    #define LogInfo( message )
+#endif
+
+#if LIBRARY_LOG_LEVEL >= LOG_DEBUG
+    #define LogDebug( message )    HOST_LOG( HOST_LOG_ARGS message )
+#else
+    #define LogDebug( message )
+#endif
@@ -0,0 +1,13 @@
+/*
+ * rsa.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_MBEDTLS_RSA_H_
+#define OTA_HOST_BENCH_MBEDTLS_RSA_H_
+
+#define MBEDTLS_ERR_RSA_VERIFY_FAILED    -0x4380
+
+#endif /* OTA_HOST_BENCH_MBEDTLS_RSA_H_ */
@@ -0,0 +1,40 @@
+/*
+ * sha1.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_MBEDTLS_SHA1_H_
+#define OTA_HOST_BENCH_MBEDTLS_SHA1_H_
+
+/**
+ * @file sha1.h
+ * @brief The mbedTLS SHA-1 API, implemented in host_port.c so the bench
+ * needs nothing but libc. The digest is hashed a 64-byte block at a time
+ * in C, as mbedTLS does on the device.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct mbedtls_sha1_context
+{
+    uint32_t total[ 2 ];
+    uint32_t state[ 5 ];
+    unsigned char buffer[ 64 ];
+} mbedtls_sha1_context;
+
+void mbedtls_sha1_init( mbedtls_sha1_context * ctx );
+void mbedtls_sha1_free( mbedtls_sha1_context * ctx );
+int mbedtls_sha1_starts_ret( mbedtls_sha1_context * ctx );
+int mbedtls_sha1_update_ret( mbedtls_sha1_context * ctx,
+                             const unsigned char * input,
+                             size_t ilen );
+int mbedtls_sha1_finish_ret( mbedtls_sha1_context * ctx,
+                             unsigned char output[ 20 ] );
+int mbedtls_sha1_ret( const unsigned char * input,
+                      size_t ilen,
+                      unsigned char output[ 20 ] );
+
+#endif /* OTA_HOST_BENCH_MBEDTLS_SHA1_H_ */
@@ -0,0 +1,50 @@
+/*
+ * x509_crt.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_MBEDTLS_X509_CRT_H_
+#define OTA_HOST_BENCH_MBEDTLS_X509_CRT_H_
+
+/**
+ * @file x509_crt.h
+ * @brief Stand-ins for the certificate and signature calls of the PAL.
+ *
+ * The bench "signs" an image with its plain SHA-1, and
+ * mbedtls_pk_verify() compares the two, so the check at close accepts
+ * exactly the images whose digest matches without RSA keys on the host.
+ */
+
+#include <stddef.h>
+
+typedef enum
+{
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_SHA1 = 4
+} mbedtls_md_type_t;
+
+typedef struct mbedtls_pk_context
+{
+    int unused;
+} mbedtls_pk_context;
+
+typedef struct mbedtls_x509_crt
+{
+    mbedtls_pk_context pk;
+} mbedtls_x509_crt;
+
+void mbedtls_x509_crt_init( mbedtls_x509_crt * crt );
+void mbedtls_x509_crt_free( mbedtls_x509_crt * crt );
+int mbedtls_x509_crt_parse( mbedtls_x509_crt * chain,
+                            const unsigned char * buf,
+                            size_t buflen );
+int mbedtls_pk_verify( mbedtls_pk_context * ctx,
+                       mbedtls_md_type_t md_alg,
+                       const unsigned char * hash,
+                       size_t hash_len,
+                       const unsigned char * sig,
+                       size_t sig_len );
+
+#endif /* OTA_HOST_BENCH_MBEDTLS_X509_CRT_H_ */
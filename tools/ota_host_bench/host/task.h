@@ -0,0 +1,20 @@
+/*
+ * task.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_TASK_H_
+#define OTA_HOST_BENCH_TASK_H_
+
+#include "FreeRTOS.h"
+
+TickType_t xTaskGetTickCount( void );
+void vTaskDelay( TickType_t xTicksToDelay );
+
+/* The bench runs the PAL and the data path on one thread. */
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+#endif /* OTA_HOST_BENCH_TASK_H_ */
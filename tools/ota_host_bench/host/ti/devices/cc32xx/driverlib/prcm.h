@@ -0,0 +1,8 @@
+/*
+ * prcm.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+/* Empty on the host; the reset macros the PAL uses are in simplelink.h. */
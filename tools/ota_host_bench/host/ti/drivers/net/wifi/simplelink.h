@@ -0,0 +1,157 @@
+/*
+ * simplelink.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_SIMPLELINK_H_
+#define OTA_HOST_BENCH_SIMPLELINK_H_
+
+/**
+ * @file simplelink.h
+ * @brief The SimpleLink file system API the OTA PAL uses, implemented over
+ * host files by sl_fs_file.c.
+ *
+ * The names and semantics are the SDK's; the flag and error values are
+ * this emulation's own.
+ */
+
+#include <stdint.h>
+
+typedef uint8_t _u8;
+typedef uint16_t _u16;
+typedef uint32_t _u32;
+typedef int16_t _i16;
+typedef int32_t _i32;
+
+/* sl_FsOpen() modes and creation flags. The maximum size of a new file is in
+ * the low 16 bits, in units of 256 bytes. */
+#define SL_FS_CREATE_MAX_SIZE( ulMaxSize )    ( ( ( ( _u32 ) ( ulMaxSize ) + 255UL ) / 256UL ) & 0xFFFFUL )
+#define SL_FS_READ                            ( 0x00010000UL )
+#define SL_FS_WRITE                           ( 0x00020000UL )
+#define SL_FS_CREATE                          ( 0x00040000UL )
+#define SL_FS_OVERWRITE                       ( 0x00080000UL )
+#define SL_FS_CREATE_FAILSAFE                 ( 0x00100000UL )
+#define SL_FS_CREATE_SECURE                   ( 0x00200000UL )
+#define SL_FS_CREATE_NOSIGNATURE              ( 0x00400000UL )
+#define SL_FS_CREATE_VENDOR_TOKEN             ( 0x00800000UL )
+#define SL_FS_CREATE_PUBLIC_WRITE             ( 0x01000000UL )
+#define SL_FS_CREATE_PUBLIC_READ              ( 0x02000000UL )
+#define SL_FS_WRITE_BUNDLE_FILE               ( 0x04000000UL )
+
+/* SlFsFileInfo_t flags. */
+#define SL_FS_INFO_PENDING_BUNDLE_COMMIT      ( 0x0001U )
+#define SL_FS_INFO_NOT_VALID                  ( 0x0002U )
+#define SL_FS_INFO_SYS_FILE                   ( 0x0004U )
+#define SL_FS_INFO_SECURE                     ( 0x0008U )
+#define SL_FS_INFO_NOSIGNATURE                ( 0x0010U )
+#define SL_FS_INFO_PUBLIC_WRITE               ( 0x0020U )
+#define SL_FS_INFO_PUBLIC_READ                ( 0x0040U )
+
+/* Errors. */
+#define SL_ERROR_FS_FILE_NOT_EXISTS                              ( -10341L )
+#define SL_ERROR_FS_FILE_IS_ALREADY_OPENED                       ( -10290L )
+#define SL_ERROR_FS_FILE_IS_PENDING_COMMIT                       ( -10305L )
+#define SL_ERROR_FS_FILE_MAX_SIZE_EXCEEDED                       ( -10288L )
+#define SL_ERROR_FS_FAILED_TO_WRITE                              ( -10320L )
+#define SL_ERROR_FS_OFFSET_OUT_OF_RANGE                          ( -10287L )
+#define SL_ERROR_FS_INVALID_HANDLE                               ( -10286L )
+#define SL_ERROR_FS_NO_AVAILABLE_NV_INDEX                        ( -10285L )
+#define SL_ERROR_FS_WRONG_SIGNATURE_SECURITY_ALERT               ( -10284L )
+#define SL_ERROR_FS_WRONG_SIGNATURE_OR_CERTIFIC_NAME_LENGTH      ( -10283L )
+#define SL_ERROR_FS_CERT_IN_THE_CHAIN_REVOKED_SECURITY_ALERT     ( -10282L )
+#define SL_ERROR_FS_INIT_CERTIFICATE_STORE                       ( -10281L )
+#define SL_ERROR_FS_ROOT_CA_IS_UNKOWN                            ( -10280L )
+#define SL_ERROR_FS_CERT_CHAIN_ERROR_SECURITY_ALERT              ( -10279L )
+#define SL_ERROR_FS_ILLEGAL_SIGNATURE                            ( -10278L )
+#define SL_ERROR_FS_WRONG_CERTIFICATE_FILE_NAME                  ( -10277L )
+#define SL_ERROR_FS_NO_CERTIFICATE_STORE                         ( -10276L )
+
+typedef enum
+{
+    SL_FS_CTL_RESTORE = 0,
+    SL_FS_CTL_ROLLBACK,
+    SL_FS_CTL_COMMIT,
+    SL_FS_CTL_RENAME,
+    SL_FS_CTL_GET_STORAGE_INFO,
+    SL_FS_CTL_BUNDLE_ROLLBACK,
+    SL_FS_CTL_BUNDLE_COMMIT
+} SlFsCtl_e;
+
+typedef struct
+{
+    _u32 IncludeFilters;
+} SlFsControl_t;
+
+typedef struct
+{
+    _u16 Flags;
+    _u32 Len;
+    _u32 MaxSize;
+} SlFsFileInfo_t;
+
+_i32 sl_FsOpen( const _u8 * pFileName,
+                const _u32 AccessModeAndMaxSize,
+                _u32 * pToken );
+_i16 sl_FsClose( const _i32 FileHdl,
+                 const _u8 * pCeritificateFileName,
+                 const _u8 * pSignature,
+                 const _u32 SignatureLen );
+_i32 sl_FsRead( const _i32 FileHdl,
+                _u32 Offset,
+                _u8 * pData,
+                _u32 Len );
+_i32 sl_FsWrite( const _i32 FileHdl,
+                 _u32 Offset,
+                 _u8 * pData,
+                 _u32 Len );
+_i16 sl_FsGetInfo( const _u8 * pFileName,
+                   const _u32 Token,
+                   SlFsFileInfo_t * pFsFileInfo );
+_i16 sl_FsDel( const _u8 * pFileName,
+               const _u32 Token );
+_i32 sl_FsCtl( SlFsCtl_e Command,
+               _u32 Token,
+               _u8 * pFileName,
+               const _u8 * pData,
+               _u16 DataLen,
+               _u8 * pOutputData,
+               _u16 OutputDataLen,
+               _u32 * pNewToken );
+_i16 sl_Stop( const _u16 Timeout );
+
+/* The reset paths; the bench never takes them. */
+#define MAP_PRCMHibernateCycleTrigger()
+#define PRCMPeripheralReset( ulPeripheral )    ( ( void ) ( ulPeripheral ) )
+#define PRCM_WDT                               ( 0UL )
+
+/**
+ * @brief What the emulation did since the last call, for the report.
+ */
+typedef struct SlFsHostStats
+{
+    uint32_t ulWrites;     /**< @brief sl_FsWrite calls. */
+    uint32_t ulWriteBytes; /**< @brief Bytes they wrote. */
+    uint32_t ulReads;      /**< @brief sl_FsRead calls. */
+    uint32_t ulOpens;      /**< @brief sl_FsOpen calls. */
+} SlFsHostStats_t;
+
+/**
+ * @brief Keep the files under a directory of the host, which must exist.
+ */
+void SlFsHost_SetRoot( const char * pcDirectory );
+
+/**
+ * @brief Copy the statistics and start them over.
+ */
+void SlFsHost_TakeStats( SlFsHostStats_t * pxStats );
+
+/**
+ * @brief Reset the device: close every file, throw away the new copy of a
+ * failsafe file being written, and roll back a bundle not committed since the
+ * reset before.
+ */
+void SlFsHost_Reset( void );
+
+#endif /* OTA_HOST_BENCH_SIMPLELINK_H_ */
@@ -0,0 +1,38 @@
+/*
+ * transport_interface.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_TRANSPORT_INTERFACE_H_
+#define OTA_HOST_BENCH_TRANSPORT_INTERFACE_H_
+
+/**
+ * @file transport_interface.h
+ * @brief The coreMQTT/coreHTTP transport interface: recv returns 0 when no
+ * data came in time and a negative value once the connection is gone.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct NetworkContext;
+typedef struct NetworkContext NetworkContext_t;
+
+typedef int32_t ( * TransportRecv_t )( NetworkContext_t * pNetworkContext,
+                                       void * pBuffer,
+                                       size_t bytesToRecv );
+
+typedef int32_t ( * TransportSend_t )( NetworkContext_t * pNetworkContext,
+                                       const void * pBuffer,
+                                       size_t bytesToSend );
+
+typedef struct TransportInterface
+{
+    TransportRecv_t recv;
+    TransportSend_t send;
+    NetworkContext_t * pNetworkContext;
+} TransportInterface_t;
+
+#endif /* OTA_HOST_BENCH_TRANSPORT_INTERFACE_H_ */
@@ -0,0 +1,14 @@
+/*
+ * transport_secure_sockets.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef OTA_HOST_BENCH_TRANSPORT_SECURE_SOCKETS_H_
+#define OTA_HOST_BENCH_TRANSPORT_SECURE_SOCKETS_H_
+
+/* The bench connects over plain TCP itself; only the interface is needed. */
+#include "transport_interface.h"
+
+#endif /* OTA_HOST_BENCH_TRANSPORT_SECURE_SOCKETS_H_ */
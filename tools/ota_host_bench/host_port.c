@@ -0,0 +1,364 @@
+/*
+ * host_port.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file host_port.c
+ *
+ * @brief What the OTA code takes from the kernel and mbedTLS, on the host.
+ *
+ * pvPortMalloc() keeps the size of each allocation in front of it, so the
+ * bench can report the heap the OTA path peaks at and what it leaves behind.
+ * SHA-1 is a plain C implementation with the mbedTLS API, and the signature
+ * check compares the digest with the "signature" the bench made, which is
+ * the digest itself.
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/rsa.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Room in front of each allocation for its size, keeping alignment.
+ */
+#define hostHEAP_HEADER_SIZE    ( 16U )
+
+/*-----------------------------------------------------------*/
+
+static size_t xHeapInUse = 0U;
+static size_t xHeapPeak = 0U;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRotateLeft( uint32_t ulValue,
+                               uint32_t ulBits );
+
+static void prvSha1Process( mbedtls_sha1_context * ctx,
+                            const unsigned char pucBlock[ 64 ] );
+
+/*-----------------------------------------------------------*/
+
+void * pvPortMalloc( size_t xSize )
+{
+    uint8_t * pucBlock = malloc( xSize + hostHEAP_HEADER_SIZE );
+    void * pvReturn = NULL;
+
+    if( pucBlock != NULL )
+    {
+        ( void ) memcpy( pucBlock, &xSize, sizeof( xSize ) );
+        xHeapInUse += xSize;
+
+        if( xHeapInUse > xHeapPeak )
+        {
+            xHeapPeak = xHeapInUse;
+        }
+
+        pvReturn = &pucBlock[ hostHEAP_HEADER_SIZE ];
+    }
+
+    return pvReturn;
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortFree( void * pv )
+{
+    uint8_t * pucBlock;
+    size_t xSize;
+
+    if( pv != NULL )
+    {
+        pucBlock = ( uint8_t * ) pv - hostHEAP_HEADER_SIZE;
+        ( void ) memcpy( &xSize, pucBlock, sizeof( xSize ) );
+        xHeapInUse -= xSize;
+        free( pucBlock );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+size_t xHostHeapInUse( void )
+{
+    return xHeapInUse;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t xHostHeapResetPeak( void )
+{
+    size_t xPeak = xHeapPeak;
+
+    xHeapPeak = xHeapInUse;
+
+    return xPeak;
+}
+
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( TickType_t ) ( ( ( uint64_t ) xNow.tv_sec * 1000U ) + ( ( uint64_t ) xNow.tv_nsec / 1000000U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void vTaskDelay( TickType_t xTicksToDelay )
+{
+    struct timespec xDelay;
+
+    xDelay.tv_sec = ( time_t ) ( xTicksToDelay / 1000U );
+    xDelay.tv_nsec = ( long ) ( xTicksToDelay % 1000U ) * 1000000L;
+    ( void ) nanosleep( &xDelay, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRotateLeft( uint32_t ulValue,
+                               uint32_t ulBits )
+{
+    return ( ulValue << ulBits ) | ( ulValue >> ( 32U - ulBits ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSha1Process( mbedtls_sha1_context * ctx,
+                            const unsigned char pucBlock[ 64 ] )
+{
+    uint32_t W[ 80 ];
+    uint32_t A = ctx->state[ 0 ];
+    uint32_t B = ctx->state[ 1 ];
+    uint32_t C = ctx->state[ 2 ];
+    uint32_t D = ctx->state[ 3 ];
+    uint32_t E = ctx->state[ 4 ];
+    uint32_t F;
+    uint32_t K;
+    uint32_t T;
+    uint32_t i;
+
+    for( i = 0U; i < 16U; i++ )
+    {
+        W[ i ] = ( ( uint32_t ) pucBlock[ 4U * i ] << 24 ) | ( ( uint32_t ) pucBlock[ ( 4U * i ) + 1U ] << 16 ) |
+                 ( ( uint32_t ) pucBlock[ ( 4U * i ) + 2U ] << 8 ) | ( uint32_t ) pucBlock[ ( 4U * i ) + 3U ];
+    }
+
+    for( i = 16U; i < 80U; i++ )
+    {
+        W[ i ] = prvRotateLeft( W[ i - 3U ] ^ W[ i - 8U ] ^ W[ i - 14U ] ^ W[ i - 16U ], 1U );
+    }
+
+    for( i = 0U; i < 80U; i++ )
+    {
+        if( i < 20U )
+        {
+            F = ( B & C ) | ( ~B & D );
+            K = 0x5A827999UL;
+        }
+        else if( i < 40U )
+        {
+            F = B ^ C ^ D;
+            K = 0x6ED9EBA1UL;
+        }
+        else if( i < 60U )
+        {
+            F = ( B & C ) | ( B & D ) | ( C & D );
+            K = 0x8F1BBCDCUL;
+        }
+        else
+        {
+            F = B ^ C ^ D;
+            K = 0xCA62C1D6UL;
+        }
+
+        T = prvRotateLeft( A, 5U ) + F + E + K + W[ i ];
+        E = D;
+        D = C;
+        C = prvRotateLeft( B, 30U );
+        B = A;
+        A = T;
+    }
+
+    ctx->state[ 0 ] += A;
+    ctx->state[ 1 ] += B;
+    ctx->state[ 2 ] += C;
+    ctx->state[ 3 ] += D;
+    ctx->state[ 4 ] += E;
+}
+
+/*-----------------------------------------------------------*/
+
+void mbedtls_sha1_init( mbedtls_sha1_context * ctx )
+{
+    ( void ) memset( ctx, 0, sizeof( *ctx ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void mbedtls_sha1_free( mbedtls_sha1_context * ctx )
+{
+    if( ctx != NULL )
+    {
+        ( void ) memset( ctx, 0, sizeof( *ctx ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int mbedtls_sha1_starts_ret( mbedtls_sha1_context * ctx )
+{
+    ctx->total[ 0 ] = 0U;
+    ctx->total[ 1 ] = 0U;
+    ctx->state[ 0 ] = 0x67452301UL;
+    ctx->state[ 1 ] = 0xEFCDAB89UL;
+    ctx->state[ 2 ] = 0x98BADCFEUL;
+    ctx->state[ 3 ] = 0x10325476UL;
+    ctx->state[ 4 ] = 0xC3D2E1F0UL;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int mbedtls_sha1_update_ret( mbedtls_sha1_context * ctx,
+                             const unsigned char * input,
+                             size_t ilen )
+{
+    size_t xFill = ctx->total[ 0 ] & 0x3FU;
+    size_t xTake;
+
+    ctx->total[ 0 ] += ( uint32_t ) ilen;
+
+    if( ctx->total[ 0 ] < ( uint32_t ) ilen )
+    {
+        ctx->total[ 1 ]++;
+    }
+
+    while( ilen > 0U )
+    {
+        if( ( xFill == 0U ) && ( ilen >= 64U ) )
+        {
+            prvSha1Process( ctx, input );
+            xTake = 64U;
+        }
+        else
+        {
+            xTake = ( ilen < ( 64U - xFill ) ) ? ilen : ( 64U - xFill );
+            ( void ) memcpy( &ctx->buffer[ xFill ], input, xTake );
+            xFill += xTake;
+
+            if( xFill == 64U )
+            {
+                prvSha1Process( ctx, ctx->buffer );
+                xFill = 0U;
+            }
+        }
+
+        input += xTake;
+        ilen -= xTake;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int mbedtls_sha1_finish_ret( mbedtls_sha1_context * ctx,
+                             unsigned char output[ 20 ] )
+{
+    static const unsigned char ucPadding[ 64 ] = { 0x80 };
+    unsigned char ucLength[ 8 ];
+    uint32_t ulHigh = ( ctx->total[ 0 ] >> 29 ) | ( ctx->total[ 1 ] << 3 );
+    uint32_t ulLow = ctx->total[ 0 ] << 3;
+    uint32_t ulFill = ctx->total[ 0 ] & 0x3FU;
+    uint32_t i;
+
+    for( i = 0U; i < 4U; i++ )
+    {
+        ucLength[ i ] = ( unsigned char ) ( ulHigh >> ( 24U - ( 8U * i ) ) );
+        ucLength[ i + 4U ] = ( unsigned char ) ( ulLow >> ( 24U - ( 8U * i ) ) );
+    }
+
+    ( void ) mbedtls_sha1_update_ret( ctx, ucPadding, ( ulFill < 56U ) ? ( 56U - ulFill ) : ( 120U - ulFill ) );
+    ( void ) mbedtls_sha1_update_ret( ctx, ucLength, sizeof( ucLength ) );
+
+    for( i = 0U; i < 20U; i++ )
+    {
+        output[ i ] = ( unsigned char ) ( ctx->state[ i / 4U ] >> ( 24U - ( 8U * ( i % 4U ) ) ) );
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int mbedtls_sha1_ret( const unsigned char * input,
+                      size_t ilen,
+                      unsigned char output[ 20 ] )
+{
+    mbedtls_sha1_context xContext;
+
+    mbedtls_sha1_init( &xContext );
+    ( void ) mbedtls_sha1_starts_ret( &xContext );
+    ( void ) mbedtls_sha1_update_ret( &xContext, input, ilen );
+    ( void ) mbedtls_sha1_finish_ret( &xContext, output );
+    mbedtls_sha1_free( &xContext );
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+void mbedtls_x509_crt_init( mbedtls_x509_crt * crt )
+{
+    ( void ) memset( crt, 0, sizeof( *crt ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void mbedtls_x509_crt_free( mbedtls_x509_crt * crt )
+{
+    ( void ) crt;
+}
+
+/*-----------------------------------------------------------*/
+
+int mbedtls_x509_crt_parse( mbedtls_x509_crt * chain,
+                            const unsigned char * buf,
+                            size_t buflen )
+{
+    ( void ) chain;
+    ( void ) buf;
+    ( void ) buflen;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int mbedtls_pk_verify( mbedtls_pk_context * ctx,
+                       mbedtls_md_type_t md_alg,
+                       const unsigned char * hash,
+                       size_t hash_len,
+                       const unsigned char * sig,
+                       size_t sig_len )
+{
+    ( void ) ctx;
+    ( void ) md_alg;
+
+    return ( ( sig_len == hash_len ) && ( memcmp( hash, sig, hash_len ) == 0 ) ) ? 0 : MBEDTLS_ERR_RSA_VERIFY_FAILED;
+}
@@ -0,0 +1,1131 @@
+/*
+ * ota_host_bench.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file ota_host_bench.c
+ *
+ * @brief Download an OTA file through the PAL on the host and time it.
+ *
+ * The bench plays the part of the OTA agent: it creates the receive file,
+ * fetches the blocks from ota_stand_in.py and hands each to
+ * prvPAL_WriteBlock(), then closes the file and checks the image left in the
+ * emulated file system against the one expected. Over MQTT it asks for
+ * OtaWindow_GetBlocks() blocks at a time and asks again once they are in or
+ * after the request wait, as the agent does; over HTTP it uses ota_http.c.
+ *
+ * Each run reports the end-to-end throughput, the CPU time spent in
+ * prvPAL_WriteBlock() and prvPAL_CloseFile(), and the most heap the PAL held.
+ * The pool is shared with a network buffer held for the run, as the shadow
+ * task holds one on the device.
+ *
+ * With --reset-after, the download is cut by a reset after that many blocks:
+ * a child process downloads up to there and exits, losing what the PAL held
+ * in RAM, and the run goes on from what the emulated file system kept, as
+ * the agent does when it takes the job up again after the boot.
+ * See README.md.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "aws_iot_ota_agent.h"
+#include "aws_iot_ota_pal.h"
+#include "ota_http.h"
+#include "ota_http_config.h"
+#include "buffer_pool.h"
+#include "aws_bufferpool_config.h"
+#include "ota_window.h"
+#include "mbedtls/sha1.h"
+#include <ti/drivers/net/wifi/simplelink.h>
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Size of a block of the OTA file.
+ */
+#define benchBLOCK_SIZE              ( 1UL << otaconfigLOG2_FILE_BLOCK_SIZE )
+
+/**
+ * @brief Where the PAL looks for the running image, as on the device.
+ */
+#define benchRUNNING_IMAGE_ADDRESS   ( 0x01000000UL )
+
+/**
+ * @brief The OTA file as the job names it.
+ */
+#define benchIMAGE_PATH              "/sys/mcuflashimg.bin"
+
+/**
+ * @brief The signer certificate. Any content will do; see host_port.c.
+ */
+#define benchCERT_PATH               "/cert/ota_bench.pem"
+
+/**
+ * @brief Path asked for over HTTP; the stand-in serves one file whatever it is.
+ */
+#define benchHTTP_PATH               "/ota.bin"
+
+/**
+ * @brief Ranges handed to ota_http.c at a time.
+ */
+#define benchHTTP_RANGES             ( 16U )
+
+/**
+ * @brief Block number and length in front of each block sent over MQTT.
+ */
+#define benchFRAME_HEADER_SIZE       ( 8U )
+
+/**
+ * @brief Requests or connections in a row that may bring no block before a
+ * run is given up.
+ */
+#define benchMAX_IDLE_TRIES          ( 20U )
+
+/**
+ * @brief Time the rest of a block may take once it started coming.
+ */
+#define benchSOCKET_TIMEOUT_MS       ( 5000U )
+
+/**
+ * @brief Timeout of the HTTP transport's receive, which returns 0 after it.
+ */
+#define benchHTTP_RECV_TIMEOUT_MS    ( 100U )
+
+/* Without it, the address asked for is only a hint, which is checked. */
+#ifndef MAP_FIXED_NOREPLACE
+    #define MAP_FIXED_NOREPLACE    0
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The command line.
+ */
+typedef struct BenchConfig
+{
+    const char * pcHost;
+    const char * pcPort;
+    bool xHttp;
+    const char * pcFile;            /**< @brief The file the stand-in serves. */
+    const char * pcExpect;          /**< @brief The image the PAL should build from it. */
+    const char * pcRunning;         /**< @brief The running image a patch applies to. */
+    const char * pcFsDir;
+    uint32_t ulAttributes;
+    uint32_t ulRuns;
+    uint32_t ulRequestWaitMs;
+    uint32_t ulResetAfter;          /**< @brief 0 for no reset. */
+    uint32_t ulMinKbps;             /**< @brief 0 for no gate. */
+    uint32_t ulMaxHeap;             /**< @brief 0 for no gate. */
+} BenchConfig_t;
+
+/**
+ * @brief What one download measured.
+ */
+typedef struct BenchRun
+{
+    bool xPassed;
+    OTA_Err_t xCloseError;
+    uint32_t ulMs;
+    uint32_t ulBlocks;              /**< @brief Blocks written. */
+    uint32_t ulDuplicates;          /**< @brief Blocks received again. */
+    uint32_t ulRequests;            /**< @brief Stream requests or connections. */
+    uint64_t ullWriteNs;            /**< @brief CPU time in prvPAL_WriteBlock(). */
+    uint64_t ullWriteMaxNs;
+    uint64_t ullCloseNs;            /**< @brief CPU time in prvPAL_CloseFile(). */
+    uint64_t ullProcessNs;          /**< @brief CPU time of the whole download. */
+    size_t xPeakHeap;
+    size_t xHeapLeft;
+    uint32_t ulPoolLeft;            /**< @brief Pool buffers still borrowed after the run. */
+    SlFsHostStats_t xFs;
+} BenchRun_t;
+
+/**
+ * @brief The file and the run, for the HTTP sink.
+ */
+typedef struct BenchSink
+{
+    OTA_FileContext_t * C;
+    BenchRun_t * pxRun;
+} BenchSink_t;
+
+/**
+ * @brief The socket behind the transport interface.
+ */
+struct NetworkContext
+{
+    int lSocket;
+};
+
+/*-----------------------------------------------------------*/
+
+static uint32_t ulPacketsProcessed = 0UL;
+
+/**
+ * @brief Blocks the child process writes before it resets, and the pipe it
+ * reports its part of the run on; -1 outside the child.
+ */
+static uint32_t ulResetAfter = 0UL;
+static int lResetPipe = -1;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read a whole file into memory.
+ */
+static uint8_t * prvLoadFile( const char * pcPath,
+                              uint32_t * pulSize );
+
+/**
+ * @brief CPU time of the calling thread or the process, in ns.
+ */
+static uint64_t prvCpuNs( clockid_t xClock );
+
+/**
+ * @brief Connect to the stand-in.
+ */
+static int prvConnect( const BenchConfig_t * pxConfig,
+                       uint32_t ulTimeoutMs );
+
+/**
+ * @brief Receive for ota_http.c: 0 on timeout, negative once closed.
+ */
+static int32_t prvTransportRecv( NetworkContext_t * pxNetworkContext,
+                                 void * pBuffer,
+                                 size_t bytesToRecv );
+
+/**
+ * @brief Send for ota_http.c.
+ */
+static int32_t prvTransportSend( NetworkContext_t * pxNetworkContext,
+                                 const void * pBuffer,
+                                 size_t bytesToSend );
+
+/**
+ * @brief Write a block through the PAL, timed, and mark it received.
+ */
+static int16_t prvWriteBlock( OTA_FileContext_t * C,
+                              BenchRun_t * pxRun,
+                              uint32_t ulOffset,
+                              uint8_t * pucData,
+                              uint32_t ulSize );
+
+/**
+ * @brief Sink of ota_http.c.
+ */
+static int16_t prvHttpSink( void * pvContext,
+                            uint32_t ulOffset,
+                            uint8_t * pucData,
+                            uint32_t ulSize );
+
+/**
+ * @brief Fetch the missing blocks over HTTP, connecting again on errors.
+ */
+static bool prvDownloadHttp( const BenchConfig_t * pxConfig,
+                             OTA_FileContext_t * C,
+                             BenchRun_t * pxRun );
+
+/**
+ * @brief Ask for the next blocks of the stream.
+ */
+static bool prvRequestBlocks( int lSocket,
+                              const OTA_FileContext_t * C,
+                              uint32_t ulBlocks );
+
+/**
+ * @brief Fetch the missing blocks over MQTT.
+ */
+static bool prvDownloadMqtt( const BenchConfig_t * pxConfig,
+                             OTA_FileContext_t * C,
+                             BenchRun_t * pxRun );
+
+/**
+ * @brief Whether the image the PAL left matches the one expected.
+ */
+static bool prvImageMatches( const uint8_t * pucExpect,
+                             uint32_t ulExpectSize );
+
+/**
+ * @brief Download the first blocks in a child process that then resets, and
+ * add what it measured to the run. Returns false if the child failed.
+ */
+static bool prvRunToReset( const BenchConfig_t * pxConfig,
+                           OTA_FileContext_t * C,
+                           BenchRun_t * pxRun );
+
+/**
+ * @brief Download the file once.
+ */
+static void prvRun( const BenchConfig_t * pxConfig,
+                    uint32_t ulFileSize,
+                    const uint8_t * pucExpect,
+                    uint32_t ulExpectSize,
+                    uint32_t ulRun,
+                    BenchRun_t * pxRun );
+
+/**
+ * @brief Print the options.
+ */
+static void prvUsage( const char * pcName );
+
+/*-----------------------------------------------------------*/
+
+/* Counters of the OTA agent the window reads; the bench drops nothing. */
+
+uint32_t OTA_GetPacketsDropped( void )
+{
+    return 0UL;
+}
+
+uint32_t OTA_GetPacketsProcessed( void )
+{
+    return ulPacketsProcessed;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t * prvLoadFile( const char * pcPath,
+                              uint32_t * pulSize )
+{
+    FILE * pxFile = fopen( pcPath, "rb" );
+    uint8_t * pucData = NULL;
+    long lSize = -1;
+
+    if( pxFile != NULL )
+    {
+        if( fseek( pxFile, 0L, SEEK_END ) == 0 )
+        {
+            lSize = ftell( pxFile );
+        }
+
+        rewind( pxFile );
+
+        if( lSize >= 0 )
+        {
+            pucData = malloc( ( size_t ) lSize + 1U );
+        }
+
+        if( ( pucData != NULL ) && ( fread( pucData, 1U, ( size_t ) lSize, pxFile ) != ( size_t ) lSize ) )
+        {
+            free( pucData );
+            pucData = NULL;
+        }
+
+        ( void ) fclose( pxFile );
+    }
+
+    if( pucData == NULL )
+    {
+        fprintf( stderr, "Cannot read %s.\n", pcPath );
+    }
+    else
+    {
+        *pulSize = ( uint32_t ) lSize;
+    }
+
+    return pucData;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvCpuNs( clockid_t xClock )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( xClock, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000ULL ) + ( uint64_t ) xNow.tv_nsec;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvConnect( const BenchConfig_t * pxConfig,
+                       uint32_t ulTimeoutMs )
+{
+    struct addrinfo xHints;
+    struct addrinfo * pxAddresses = NULL;
+    struct timeval xTimeout;
+    int lSocket = -1;
+    int lOn = 1;
+
+    ( void ) memset( &xHints, 0, sizeof( xHints ) );
+    xHints.ai_family = AF_UNSPEC;
+    xHints.ai_socktype = SOCK_STREAM;
+
+    if( getaddrinfo( pxConfig->pcHost, pxConfig->pcPort, &xHints, &pxAddresses ) == 0 )
+    {
+        lSocket = socket( pxAddresses->ai_family, pxAddresses->ai_socktype, pxAddresses->ai_protocol );
+
+        if( ( lSocket >= 0 ) && ( connect( lSocket, pxAddresses->ai_addr, pxAddresses->ai_addrlen ) != 0 ) )
+        {
+            ( void ) close( lSocket );
+            lSocket = -1;
+        }
+
+        freeaddrinfo( pxAddresses );
+    }
+
+    if( lSocket >= 0 )
+    {
+        xTimeout.tv_sec = ( time_t ) ( ulTimeoutMs / 1000U );
+        xTimeout.tv_usec = ( suseconds_t ) ( ulTimeoutMs % 1000U ) * 1000;
+        ( void ) setsockopt( lSocket, SOL_SOCKET, SO_RCVTIMEO, &xTimeout, sizeof( xTimeout ) );
+        ( void ) setsockopt( lSocket, IPPROTO_TCP, TCP_NODELAY, &lOn, sizeof( lOn ) );
+    }
+    else
+    {
+        fprintf( stderr, "Cannot connect to %s:%s.\n", pxConfig->pcHost, pxConfig->pcPort );
+    }
+
+    return lSocket;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvTransportRecv( NetworkContext_t * pxNetworkContext,
+                                 void * pBuffer,
+                                 size_t bytesToRecv )
+{
+    ssize_t xReceived = recv( pxNetworkContext->lSocket, pBuffer, bytesToRecv, 0 );
+    int32_t lResult = ( int32_t ) xReceived;
+
+    if( xReceived < 0 )
+    {
+        lResult = ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) || ( errno == EINTR ) ) ? 0 : -1;
+    }
+    else if( xReceived == 0 )
+    {
+        lResult = -1;
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvTransportSend( NetworkContext_t * pxNetworkContext,
+                                 const void * pBuffer,
+                                 size_t bytesToSend )
+{
+    ssize_t xSent = send( pxNetworkContext->lSocket, pBuffer, bytesToSend, MSG_NOSIGNAL );
+
+    return ( xSent < 0 ) ? -1 : ( int32_t ) xSent;
+}
+
+/*-----------------------------------------------------------*/
+
+static int16_t prvWriteBlock( OTA_FileContext_t * C,
+                              BenchRun_t * pxRun,
+                              uint32_t ulOffset,
+                              uint8_t * pucData,
+                              uint32_t ulSize )
+{
+    uint32_t ulBlock = ulOffset >> otaconfigLOG2_FILE_BLOCK_SIZE;
+    uint8_t ucMask = ( uint8_t ) ( 1U << ( ulBlock % 8UL ) );
+    int16_t sResult = ( int16_t ) ulSize;
+    uint64_t ullStart;
+    uint64_t ullSpent;
+
+    ulPacketsProcessed++;
+
+    if( ( C->pucRxBlockBitmap[ ulBlock / 8UL ] & ucMask ) == 0U )
+    {
+        pxRun->ulDuplicates++;
+    }
+    else
+    {
+        ullStart = prvCpuNs( CLOCK_THREAD_CPUTIME_ID );
+        sResult = prvPAL_WriteBlock( C, ulOffset, pucData, ulSize );
+        ullSpent = prvCpuNs( CLOCK_THREAD_CPUTIME_ID ) - ullStart;
+
+        pxRun->ullWriteNs += ullSpent;
+
+        if( ullSpent > pxRun->ullWriteMaxNs )
+        {
+            pxRun->ullWriteMaxNs = ullSpent;
+        }
+
+        if( sResult == ( int16_t ) ulSize )
+        {
+            C->pucRxBlockBitmap[ ulBlock / 8UL ] &= ( uint8_t ) ~ucMask;
+            C->ulBlocksRemaining--;
+            pxRun->ulBlocks++;
+
+            /* The reset comes between two blocks, as a power cut may. */
+            if( ( lResetPipe >= 0 ) && ( pxRun->ulBlocks == ulResetAfter ) )
+            {
+                pxRun->xPeakHeap = xHostHeapResetPeak();
+                SlFsHost_TakeStats( &pxRun->xFs );
+                ( void ) write( lResetPipe, pxRun, sizeof( *pxRun ) );
+                _exit( 0 );
+            }
+        }
+        else
+        {
+            fprintf( stderr, "prvPAL_WriteBlock failed (%d) at %u.\n", ( int ) sResult, ( unsigned ) ulOffset );
+        }
+    }
+
+    return sResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static int16_t prvHttpSink( void * pvContext,
+                            uint32_t ulOffset,
+                            uint8_t * pucData,
+                            uint32_t ulSize )
+{
+    BenchSink_t * pxSink = ( BenchSink_t * ) pvContext;
+
+    return prvWriteBlock( pxSink->C, pxSink->pxRun, ulOffset, pucData, ulSize );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvDownloadHttp( const BenchConfig_t * pxConfig,
+                             OTA_FileContext_t * C,
+                             BenchRun_t * pxRun )
+{
+    struct NetworkContext xContext;
+    TransportInterface_t xTransport;
+    OtaHttpRange_t xRanges[ benchHTTP_RANGES ];
+    OtaHttpStatus_t xStatus = eOtaHttpSuccess;
+    BenchSink_t xSink = { C, pxRun };
+    uint32_t ulIdle = 0UL;
+    uint32_t ulBefore;
+    size_t xCount;
+
+    xTransport.recv = prvTransportRecv;
+    xTransport.send = prvTransportSend;
+    xTransport.pNetworkContext = &xContext;
+    xContext.lSocket = -1;
+
+    while( ( C->ulBlocksRemaining > 0UL ) && ( ulIdle < benchMAX_IDLE_TRIES ) )
+    {
+        if( xContext.lSocket < 0 )
+        {
+            xContext.lSocket = prvConnect( pxConfig, benchHTTP_RECV_TIMEOUT_MS );
+            pxRun->ulRequests++;
+        }
+
+        ulBefore = C->ulBlocksRemaining;
+
+        if( xContext.lSocket >= 0 )
+        {
+            xCount = OtaHttp_RangesFromBitmap( C, xRanges, benchHTTP_RANGES );
+            xStatus = OtaHttp_FetchRanges( &xTransport, pxConfig->pcHost, benchHTTP_PATH, xRanges, xCount,
+                                           otahttpconfigMAX_OUTSTANDING, prvHttpSink, &xSink, NULL );
+
+            if( ( xStatus == eOtaHttpSinkFailed ) || ( xStatus == eOtaHttpBadParameter ) || ( xStatus == eOtaHttpNoMemory ) )
+            {
+                break;
+            }
+            else if( xStatus != eOtaHttpSuccess )
+            {
+                /* As the agent would, start over on a new connection. */
+                ( void ) close( xContext.lSocket );
+                xContext.lSocket = -1;
+            }
+        }
+
+        ulIdle = ( C->ulBlocksRemaining < ulBefore ) ? 0UL : ulIdle + 1UL;
+    }
+
+    if( xContext.lSocket >= 0 )
+    {
+        ( void ) close( xContext.lSocket );
+    }
+
+    return C->ulBlocksRemaining == 0UL;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvRequestBlocks( int lSocket,
+                              const OTA_FileContext_t * C,
+                              uint32_t ulBlocks )
+{
+    static const char cHex[] = "0123456789abcdef";
+    uint32_t ulBitmapSize = ( ( ( C->ulFileSize + benchBLOCK_SIZE - 1UL ) / benchBLOCK_SIZE ) + 7UL ) / 8UL;
+    size_t xLength = 32U + ( 2U * ulBitmapSize );
+    char * pcRequest = malloc( xLength );
+    int lUsed;
+    uint32_t i;
+    bool xSent = false;
+
+    if( pcRequest != NULL )
+    {
+        /* Like the agent's stream request: how many blocks, and which are missing. */
+        lUsed = snprintf( pcRequest, xLength, "STREAM %u ", ( unsigned ) ulBlocks );
+
+        for( i = 0UL; i < ulBitmapSize; i++ )
+        {
+            pcRequest[ lUsed++ ] = cHex[ C->pucRxBlockBitmap[ i ] >> 4 ];
+            pcRequest[ lUsed++ ] = cHex[ C->pucRxBlockBitmap[ i ] & 0x0FU ];
+        }
+
+        pcRequest[ lUsed++ ] = '\n';
+        xSent = send( lSocket, pcRequest, ( size_t ) lUsed, MSG_NOSIGNAL ) == ( ssize_t ) lUsed;
+        free( pcRequest );
+    }
+
+    return xSent;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvDownloadMqtt( const BenchConfig_t * pxConfig,
+                             OTA_FileContext_t * C,
+                             BenchRun_t * pxRun )
+{
+    uint8_t ucBlock[ benchFRAME_HEADER_SIZE + benchBLOCK_SIZE ];
+    uint32_t ulBlockCount = ( C->ulFileSize + benchBLOCK_SIZE - 1UL ) / benchBLOCK_SIZE;
+    uint32_t ulAskedFor = 0UL;
+    uint32_t ulArrived = 0UL;
+    uint32_t ulIdle = 0UL;
+    uint32_t ulBlock;
+    uint32_t ulLength;
+    TickType_t xAskedAt = 0U;
+    TickType_t xWaited;
+    struct pollfd xPoll;
+    bool xFailed = false;
+    int lSocket = prvConnect( pxConfig, benchSOCKET_TIMEOUT_MS );
+
+    xPoll.fd = lSocket;
+    xPoll.events = POLLIN;
+    xFailed = ( lSocket < 0 );
+
+    while( ( xFailed == false ) && ( C->ulBlocksRemaining > 0UL ) )
+    {
+        if( ulArrived >= ulAskedFor )
+        {
+            ulAskedFor = OtaWindow_GetBlocks();
+            ulArrived = 0UL;
+            xAskedAt = xTaskGetTickCount();
+            pxRun->ulRequests++;
+            xFailed = !prvRequestBlocks( lSocket, C, ulAskedFor );
+            continue;
+        }
+
+        xWaited = xTaskGetTickCount() - xAskedAt;
+
+        if( ( xWaited >= pdMS_TO_TICKS( pxConfig->ulRequestWaitMs ) ) ||
+            ( poll( &xPoll, 1U, ( int ) ( pdMS_TO_TICKS( pxConfig->ulRequestWaitMs ) - xWaited ) ) == 0 ) )
+        {
+            /* Blocks were lost; the agent asks again when its request timer fires. */
+            ulAskedFor = 0UL;
+            ulIdle++;
+            xFailed = ( ulIdle >= benchMAX_IDLE_TRIES );
+        }
+        else if( recv( lSocket, ucBlock, benchFRAME_HEADER_SIZE, MSG_WAITALL ) != ( ssize_t ) benchFRAME_HEADER_SIZE )
+        {
+            fprintf( stderr, "The stand-in closed the stream.\n" );
+            xFailed = true;
+        }
+        else
+        {
+            ulBlock = ( uint32_t ) ucBlock[ 0 ] | ( ( uint32_t ) ucBlock[ 1 ] << 8 ) |
+                      ( ( uint32_t ) ucBlock[ 2 ] << 16 ) | ( ( uint32_t ) ucBlock[ 3 ] << 24 );
+            ulLength = ( uint32_t ) ucBlock[ 4 ] | ( ( uint32_t ) ucBlock[ 5 ] << 8 ) |
+                       ( ( uint32_t ) ucBlock[ 6 ] << 16 ) | ( ( uint32_t ) ucBlock[ 7 ] << 24 );
+
+            if( ( ulBlock >= ulBlockCount ) ||
+                ( ulLength != ( ( ulBlock == ( ulBlockCount - 1UL ) ) ? ( C->ulFileSize - ( ulBlock * benchBLOCK_SIZE ) ) : benchBLOCK_SIZE ) ) ||
+                ( recv( lSocket, &ucBlock[ benchFRAME_HEADER_SIZE ], ulLength, MSG_WAITALL ) != ( ssize_t ) ulLength ) )
+            {
+                fprintf( stderr, "Bad block %u of %u bytes from the stand-in.\n", ( unsigned ) ulBlock, ( unsigned ) ulLength );
+                xFailed = true;
+            }
+            else
+            {
+                ulArrived++;
+                ulIdle = 0UL;
+                xFailed = prvWriteBlock( C, pxRun, ulBlock * benchBLOCK_SIZE, &ucBlock[ benchFRAME_HEADER_SIZE ], ulLength ) != ( int16_t ) ulLength;
+            }
+        }
+    }
+
+    if( lSocket >= 0 )
+    {
+        ( void ) close( lSocket );
+    }
+
+    return !xFailed;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvImageMatches( const uint8_t * pucExpect,
+                             uint32_t ulExpectSize )
+{
+    uint8_t ucBuffer[ 4096 ];
+    uint32_t ulOffset = 0UL;
+    int32_t lRead = 1;
+    bool xMatches = false;
+    int32_t lFileHandle = sl_FsOpen( ( const _u8 * ) benchIMAGE_PATH, SL_FS_READ, NULL );
+
+    if( lFileHandle > 0 )
+    {
+        xMatches = true;
+
+        while( xMatches && ( lRead > 0 ) )
+        {
+            lRead = sl_FsRead( lFileHandle, ulOffset, ucBuffer, sizeof( ucBuffer ) );
+
+            if( lRead > 0 )
+            {
+                xMatches = ( ( ulOffset + ( uint32_t ) lRead ) <= ulExpectSize ) &&
+                           ( memcmp( ucBuffer, &pucExpect[ ulOffset ], ( size_t ) lRead ) == 0 );
+                ulOffset += ( uint32_t ) lRead;
+            }
+        }
+
+        ( void ) sl_FsClose( lFileHandle, NULL, NULL, 0UL );
+    }
+
+    return xMatches && ( ulOffset == ulExpectSize );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvRunToReset( const BenchConfig_t * pxConfig,
+                           OTA_FileContext_t * C,
+                           BenchRun_t * pxRun )
+{
+    BenchRun_t xChild;
+    int lPipe[ 2 ];
+    int lStatus = 1;
+    pid_t xChildId = -1;
+    bool xReset = false;
+
+    ( void ) fflush( stdout );
+    ( void ) fflush( stderr );
+
+    if( pipe( lPipe ) == 0 )
+    {
+        xChildId = fork();
+
+        if( xChildId == 0 )
+        {
+            /* Reports from prvWriteBlock() once it has written enough. */
+            ( void ) close( lPipe[ 0 ] );
+            lResetPipe = lPipe[ 1 ];
+            ulResetAfter = pxConfig->ulResetAfter;
+
+            if( prvPAL_CreateFileForRx( C ) == kOTA_Err_None )
+            {
+                ( void ) ( pxConfig->xHttp ? prvDownloadHttp( pxConfig, C, pxRun ) : prvDownloadMqtt( pxConfig, C, pxRun ) );
+            }
+
+            fprintf( stderr, "The download ended before %u blocks.\n", ( unsigned ) ulResetAfter );
+            _exit( 1 );
+        }
+
+        ( void ) close( lPipe[ 1 ] );
+
+        if( ( xChildId > 0 ) && ( read( lPipe[ 0 ], &xChild, sizeof( xChild ) ) == ( ssize_t ) sizeof( xChild ) ) )
+        {
+            xReset = true;
+        }
+
+        ( void ) close( lPipe[ 0 ] );
+    }
+
+    if( xChildId > 0 )
+    {
+        ( void ) waitpid( xChildId, &lStatus, 0 );
+    }
+
+    if( xReset && WIFEXITED( lStatus ) && ( WEXITSTATUS( lStatus ) == 0 ) )
+    {
+        pxRun->ulBlocks = xChild.ulBlocks;
+        pxRun->ulDuplicates = xChild.ulDuplicates;
+        pxRun->ulRequests = xChild.ulRequests;
+        pxRun->ullWriteNs = xChild.ullWriteNs;
+        pxRun->ullWriteMaxNs = xChild.ullWriteMaxNs;
+        pxRun->xPeakHeap = xChild.xPeakHeap;
+        pxRun->xFs = xChild.xFs;
+    }
+    else
+    {
+        xReset = false;
+    }
+
+    SlFsHost_Reset();
+
+    return xReset;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRun( const BenchConfig_t * pxConfig,
+                    uint32_t ulFileSize,
+                    const uint8_t * pucExpect,
+                    uint32_t ulExpectSize,
+                    uint32_t ulRun,
+                    BenchRun_t * pxRun )
+{
+    uint32_t ulBlockCount = ( ulFileSize + benchBLOCK_SIZE - 1UL ) / benchBLOCK_SIZE;
+    uint8_t * pucBitmap = calloc( ( ulBlockCount + 7UL ) / 8UL + 1UL, 1U );
+    char cJobName[ 32 ];
+    OTA_FileContext_t xFile;
+    Sig_t xSignature;
+    OTA_Err_t xError;
+    TickType_t xStart;
+    uint64_t ullProcessStart;
+    uint64_t ullCloseStart;
+    bool xReceived = false;
+    bool xReset = true;
+    void * pvNetworkBuffer;
+    SlFsHostStats_t xResetFs;
+    BufferPoolStats_t xPool[ bufferpoolNUM_CLASSES ];
+    size_t xPeakHeap;
+    uint32_t i;
+
+    ( void ) memset( pxRun, 0, sizeof( *pxRun ) );
+    ( void ) memset( &xFile, 0, sizeof( xFile ) );
+    ( void ) memset( &xSignature, 0, sizeof( xSignature ) );
+
+    /* host_port.c takes the digest of the image for its signature. */
+    xSignature.usSize = 20U;
+    ( void ) mbedtls_sha1_ret( pucExpect, ulExpectSize, xSignature.ucData );
+
+    for( i = 0UL; i < ulBlockCount; i++ )
+    {
+        pucBitmap[ i / 8UL ] |= ( uint8_t ) ( 1U << ( i % 8UL ) );
+    }
+
+    /* A job of its own for each run. */
+    ( void ) snprintf( cJobName, sizeof( cJobName ), "bench-%u", ( unsigned ) ulRun );
+    xFile.pucFilePath = ( uint8_t * ) benchIMAGE_PATH;
+    xFile.pucCertFilepath = ( uint8_t * ) benchCERT_PATH;
+    xFile.pucJobName = ( uint8_t * ) cJobName;
+    xFile.ulFileSize = ulFileSize;
+    xFile.ulFileAttributes = pxConfig->ulAttributes;
+    xFile.ulBlocksRemaining = ulBlockCount;
+    xFile.pucRxBlockBitmap = pucBitmap;
+    xFile.pxSignature = &xSignature;
+
+    /* Each run starts from a boot, as after the reset that activates an image,
+     * so what an earlier run left uncommitted is not built on. */
+    SlFsHost_Reset();
+    SlFsHost_TakeStats( &pxRun->xFs );
+    ( void ) xHostHeapResetPeak();
+    pvNetworkBuffer = BufferPool_Acquire( bufferpoolconfigLARGE_BUFFER_SIZE );
+    xStart = xTaskGetTickCount();
+    ullProcessStart = prvCpuNs( CLOCK_PROCESS_CPUTIME_ID );
+
+    if( pxConfig->ulResetAfter > 0UL )
+    {
+        xReset = prvRunToReset( pxConfig, &xFile, pxRun );
+    }
+
+    /* After a reset the bitmap is the one of the job again, all blocks
+     * missing; the PAL marks what it kept. */
+    xResetFs = pxRun->xFs;
+    xError = xReset ? prvPAL_CreateFileForRx( &xFile ) : kOTA_Err_RxFileCreateFailed;
+
+    if( xError != kOTA_Err_None )
+    {
+        fprintf( stderr, "prvPAL_CreateFileForRx failed (0x%08x).\n", ( unsigned ) xError );
+    }
+    else
+    {
+        xReceived = pxConfig->xHttp ? prvDownloadHttp( pxConfig, &xFile, pxRun ) : prvDownloadMqtt( pxConfig, &xFile, pxRun );
+
+        if( xReceived == false )
+        {
+            ( void ) prvPAL_Abort( &xFile );
+        }
+        else
+        {
+            ullCloseStart = prvCpuNs( CLOCK_THREAD_CPUTIME_ID );
+            pxRun->xCloseError = prvPAL_CloseFile( &xFile );
+            pxRun->ullCloseNs = prvCpuNs( CLOCK_THREAD_CPUTIME_ID ) - ullCloseStart;
+        }
+    }
+
+    pxRun->ulMs = ( uint32_t ) ( ( xTaskGetTickCount() - xStart ) * portTICK_PERIOD_MS );
+    pxRun->ullProcessNs = prvCpuNs( CLOCK_PROCESS_CPUTIME_ID ) - ullProcessStart;
+    xPeakHeap = xHostHeapResetPeak();
+    pxRun->xPeakHeap = ( xPeakHeap > pxRun->xPeakHeap ) ? xPeakHeap : pxRun->xPeakHeap;
+    pxRun->xHeapLeft = xHostHeapInUse();
+    SlFsHost_TakeStats( &pxRun->xFs );
+    pxRun->xFs.ulWrites += xResetFs.ulWrites;
+    pxRun->xFs.ulWriteBytes += xResetFs.ulWriteBytes;
+    pxRun->xFs.ulReads += xResetFs.ulReads;
+    pxRun->xFs.ulOpens += xResetFs.ulOpens;
+
+    BufferPool_Release( pvNetworkBuffer );
+    BufferPool_GetStats( xPool );
+    pxRun->ulPoolLeft = 0UL;
+
+    for( i = 0UL; i < bufferpoolNUM_CLASSES; i++ )
+    {
+        pxRun->ulPoolLeft += xPool[ i ].ulInUse;
+    }
+
+    pxRun->xPassed = ( xError == kOTA_Err_None ) && xReceived && ( pxRun->xCloseError == kOTA_Err_None ) &&
+                     prvImageMatches( pucExpect, ulExpectSize ) && ( pxRun->xHeapLeft == 0U ) &&
+                     ( pxRun->ulPoolLeft == 0UL );
+
+    free( pucBitmap );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char * pcName )
+{
+    fprintf( stderr,
+             "Usage: %s --file FILE [--expect IMAGE] [--running IMAGE] [--attributes N]\n"
+             "       [--protocol mqtt|http] [--host HOST] [--port PORT] [--runs N]\n"
+             "       [--fs-dir DIR] [--request-wait-ms MS] [--reset-after BLOCKS]\n"
+             "       [--min-kbps N] [--max-heap BYTES]\n"
+             "See README.md.\n",
+             pcName );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char * argv[] )
+{
+    static const struct option xOptions[] =
+    {
+        { "host",            required_argument, NULL, 'h' },
+        { "port",            required_argument, NULL, 'p' },
+        { "protocol",        required_argument, NULL, 'P' },
+        { "file",            required_argument, NULL, 'f' },
+        { "expect",          required_argument, NULL, 'e' },
+        { "running",         required_argument, NULL, 'r' },
+        { "attributes",      required_argument, NULL, 'a' },
+        { "runs",            required_argument, NULL, 'n' },
+        { "fs-dir",          required_argument, NULL, 'd' },
+        { "request-wait-ms", required_argument, NULL, 'w' },
+        { "reset-after",     required_argument, NULL, 'R' },
+        { "min-kbps",        required_argument, NULL, 'k' },
+        { "max-heap",        required_argument, NULL, 'm' },
+        { NULL,              0,                 NULL, 0   }
+    };
+    BenchConfig_t xConfig =
+    {
+        .pcHost          = "127.0.0.1",
+        .pcPort          = "8883",
+        .pcFsDir         = ".",
+        .ulRuns          = 1UL,
+        .ulRequestWaitMs = otaconfigFILE_REQUEST_WAIT_MS
+    };
+    BenchRun_t xRun;
+    uint8_t * pucFile = NULL;
+    uint8_t * pucExpect = NULL;
+    uint8_t * pucRunning = NULL;
+    uint32_t ulFileSize = 0UL;
+    uint32_t ulExpectSize = 0UL;
+    uint32_t ulRunningSize = 0UL;
+    uint32_t ulPassed = 0UL;
+    uint32_t ulKbps;
+    uint32_t ulMinKbps = UINT32_MAX;
+    uint64_t ullKbpsSum = 0ULL;
+    uint64_t ullWriteNs = 0ULL;
+    uint64_t ullWriteMaxNs = 0ULL;
+    uint64_t ullBlocks = 0ULL;
+    size_t xPeakHeap = 0U;
+    int32_t lFileHandle;
+    int lOption;
+    int lExit = 0;
+    uint32_t i;
+
+    while( ( lOption = getopt_long( argc, argv, "", xOptions, NULL ) ) != -1 )
+    {
+        switch( lOption )
+        {
+            case 'h':
+                xConfig.pcHost = optarg;
+                break;
+
+            case 'p':
+                xConfig.pcPort = optarg;
+                break;
+
+            case 'P':
+                xConfig.xHttp = ( strcmp( optarg, "http" ) == 0 );
+                break;
+
+            case 'f':
+                xConfig.pcFile = optarg;
+                break;
+
+            case 'e':
+                xConfig.pcExpect = optarg;
+                break;
+
+            case 'r':
+                xConfig.pcRunning = optarg;
+                break;
+
+            case 'a':
+                xConfig.ulAttributes = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'n':
+                xConfig.ulRuns = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'd':
+                xConfig.pcFsDir = optarg;
+                break;
+
+            case 'w':
+                xConfig.ulRequestWaitMs = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'R':
+                xConfig.ulResetAfter = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'k':
+                xConfig.ulMinKbps = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'm':
+                xConfig.ulMaxHeap = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            default:
+                prvUsage( argv[ 0 ] );
+                return 2;
+        }
+    }
+
+    if( xConfig.pcFile == NULL )
+    {
+        prvUsage( argv[ 0 ] );
+        return 2;
+    }
+
+    pucFile = prvLoadFile( xConfig.pcFile, &ulFileSize );
+    pucExpect = ( xConfig.pcExpect != NULL ) ? prvLoadFile( xConfig.pcExpect, &ulExpectSize ) : pucFile;
+    ulExpectSize = ( xConfig.pcExpect != NULL ) ? ulExpectSize : ulFileSize;
+
+    if( xConfig.pcRunning != NULL )
+    {
+        pucRunning = prvLoadFile( xConfig.pcRunning, &ulRunningSize );
+
+        /* The PAL reads the running image where the boot loader put it. */
+        if( ( pucRunning != NULL ) &&
+            ( mmap( ( void * ) benchRUNNING_IMAGE_ADDRESS, ( size_t ) ulRunningSize + 1U, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0 ) == ( void * ) benchRUNNING_IMAGE_ADDRESS ) )
+        {
+            ( void ) memcpy( ( void * ) benchRUNNING_IMAGE_ADDRESS, pucRunning, ulRunningSize );
+        }
+        else
+        {
+            fprintf( stderr, "Cannot map the running image at 0x%08lx.\n", benchRUNNING_IMAGE_ADDRESS );
+            return 2;
+        }
+    }
+
+    if( ( pucFile == NULL ) || ( pucExpect == NULL ) )
+    {
+        return 2;
+    }
+
+    SlFsHost_SetRoot( xConfig.pcFsDir );
+    lFileHandle = sl_FsOpen( ( const _u8 * ) benchCERT_PATH, SL_FS_CREATE | SL_FS_OVERWRITE | SL_FS_CREATE_MAX_SIZE( 1024U ), NULL );
+
+    if( lFileHandle > 0 )
+    {
+        ( void ) sl_FsWrite( lFileHandle, 0UL, ( _u8 * ) "bench", 5UL );
+        ( void ) sl_FsClose( lFileHandle, NULL, NULL, 0UL );
+    }
+
+    printf( "%s, %u bytes, %s over %s:%s\n", xConfig.pcFile, ( unsigned ) ulFileSize,
+            xConfig.xHttp ? "HTTP" : "MQTT", xConfig.pcHost, xConfig.pcPort );
+    printf( "run  result      ms    KB/s  blocks  dups  reqs  us/block  max us  close ms  cpu us/block  peak heap  flash writes  flash KB\n" );
+
+    for( i = 0UL; i < xConfig.ulRuns; i++ )
+    {
+        prvRun( &xConfig, ulFileSize, pucExpect, ulExpectSize, i, &xRun );
+        ulKbps = ( uint32_t ) ( ( ( uint64_t ) ulFileSize * 1000ULL ) / ( 1024ULL * ( ( xRun.ulMs > 0UL ) ? xRun.ulMs : 1UL ) ) );
+
+        printf( "%3u  %-6s  %6u  %6u  %6u  %4u  %4u  %8.1f  %6.1f  %8.2f  %12.1f  %9zu  %12u  %8u\n",
+                ( unsigned ) i,
+                xRun.xPassed ? "ok" : "FAILED",
+                ( unsigned ) xRun.ulMs,
+                ( unsigned ) ulKbps,
+                ( unsigned ) xRun.ulBlocks,
+                ( unsigned ) xRun.ulDuplicates,
+                ( unsigned ) xRun.ulRequests,
+                ( xRun.ulBlocks > 0UL ) ? ( ( double ) xRun.ullWriteNs / 1000.0 / ( double ) xRun.ulBlocks ) : 0.0,
+                ( double ) xRun.ullWriteMaxNs / 1000.0,
+                ( double ) xRun.ullCloseNs / 1000000.0,
+                ( xRun.ulBlocks > 0UL ) ? ( ( double ) xRun.ullProcessNs / 1000.0 / ( double ) xRun.ulBlocks ) : 0.0,
+                xRun.xPeakHeap,
+                ( unsigned ) xRun.xFs.ulWrites,
+                ( unsigned ) ( xRun.xFs.ulWriteBytes / 1024UL ) );
+
+        if( xRun.xPassed )
+        {
+            ulPassed++;
+            ullKbpsSum += ulKbps;
+            ulMinKbps = ( ulKbps < ulMinKbps ) ? ulKbps : ulMinKbps;
+            ullWriteNs += xRun.ullWriteNs;
+            ullBlocks += xRun.ulBlocks;
+        }
+        else if( xRun.xCloseError != kOTA_Err_None )
+        {
+            fprintf( stderr, "Run %u: prvPAL_CloseFile failed (0x%08x).\n", ( unsigned ) i, ( unsigned ) xRun.xCloseError );
+        }
+        else if( xRun.xHeapLeft > 0U )
+        {
+            fprintf( stderr, "Run %u: %zu bytes of heap left allocated.\n", ( unsigned ) i, xRun.xHeapLeft );
+        }
+        else if( xRun.ulPoolLeft > 0UL )
+        {
+            fprintf( stderr, "Run %u: %u pool buffers left borrowed.\n", ( unsigned ) i, ( unsigned ) xRun.ulPoolLeft );
+        }
+
+        ullWriteMaxNs = ( xRun.ullWriteMaxNs > ullWriteMaxNs ) ? xRun.ullWriteMaxNs : ullWriteMaxNs;
+        xPeakHeap = ( xRun.xPeakHeap > xPeakHeap ) ? xRun.xPeakHeap : xPeakHeap;
+    }
+
+    if( ulPassed == 0UL )
+    {
+        ulMinKbps = 0UL;
+    }
+
+    printf( "%u of %u runs passed; KB/s min %u mean %u; write %.1f us/block mean, %.1f us max; peak heap %zu bytes\n",
+            ( unsigned ) ulPassed, ( unsigned ) xConfig.ulRuns, ( unsigned ) ulMinKbps,
+            ( unsigned ) ( ( ulPassed > 0UL ) ? ( ullKbpsSum / ulPassed ) : 0ULL ),
+            ( ullBlocks > 0ULL ) ? ( ( double ) ullWriteNs / 1000.0 / ( double ) ullBlocks ) : 0.0,
+            ( double ) ullWriteMaxNs / 1000.0, xPeakHeap );
+
+    if( ( ulPassed != xConfig.ulRuns ) ||
+        ( ( xConfig.ulMinKbps > 0UL ) && ( ulMinKbps < xConfig.ulMinKbps ) ) ||
+        ( ( xConfig.ulMaxHeap > 0UL ) && ( xPeakHeap > xConfig.ulMaxHeap ) ) )
+    {
+        lExit = 1;
+    }
+
+    return lExit;
+}
@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+
+import argparse
+import random
+import re
+import socket
+import struct
+import threading
+import time
+
+# 1 << otaconfigLOG2_FILE_BLOCK_SIZE of config_files/aws_ota_agent_config.h.
+BLOCK_SIZE = 512
+
+
+class Link:
+    """
+    One direction of a connection: what is queued goes out in order, no
+    sooner than a round trip after it was asked for and no faster than the
+    bandwidth allows.
+    """
+
+    def __init__(self, conn, args, rng):
+        self.conn = conn
+        self.rtt = args.rtt_ms / 1000.0
+        self.rate = args.bandwidth_kbps * 1000 / 8.0
+        self.rto = args.rto_ms / 1000.0
+        self.loss = args.loss
+        self.rng = rng
+        self.queue = []
+        self.lock = threading.Condition()
+        self.closed = False
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+
+    def send(self, pieces):
+        """
+        Queue (data, lost, stall) pieces asked for now. A lost piece takes its
+        time on the link but is not sent; a stall holds the link before it.
+        """
+        with self.lock:
+            self.queue.append((time.monotonic() + self.rtt, pieces))
+            self.lock.notify()
+
+    def close(self):
+        with self.lock:
+            self.closed = True
+            self.lock.notify()
+        self.thread.join()
+
+    def run(self):
+        free_at = 0.0
+        while True:
+            with self.lock:
+                while not self.queue and not self.closed:
+                    self.lock.wait()
+                if not self.queue:
+                    return
+                ready, pieces = self.queue.pop(0)
+            delay = ready - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+            for data, lost, stall in pieces:
+                start = max(time.monotonic(), free_at) + stall
+                free_at = start + (len(data) / self.rate if self.rate > 0 else 0.0)
+                if not lost:
+                    try:
+                        self.conn.sendall(data)
+                    except OSError:
+                        return
+                delay = free_at - time.monotonic()
+                if delay > 0:
+                    time.sleep(delay)
+
+    def lost(self) -> bool:
+        return self.loss > 0 and self.rng.random() < self.loss
+
+
+def serve_mqtt(link, image, line):
+    """
+    Send the first blocks still set in the bitmap, as the stream service does.
+    Each block goes as its number and length, little-endian, then its data.
+    """
+    fields = line.split()
+    count = int(fields[1])
+    bitmap = bytes.fromhex(fields[2].decode())
+    blocks = (len(image) + BLOCK_SIZE - 1) // BLOCK_SIZE
+    pieces = []
+    for block in range(blocks):
+        if len(pieces) == count:
+            break
+        if bitmap[block // 8] & (1 << (block % 8)):
+            data = image[block * BLOCK_SIZE : (block + 1) * BLOCK_SIZE]
+            pieces.append((struct.pack("<II", block, len(data)) + data, link.lost(), 0.0))
+    link.send(pieces)
+
+
+def serve_http(link, image, line, reader):
+    """
+    Answer a range request. TCP loses nothing, but a lost block stalls the
+    connection for a retransmission timeout.
+    """
+    headers = {}
+    while True:
+        header = reader.readline()
+        if header in (b"\r\n", b"\n", b""):
+            break
+        name, _, value = header.decode().partition(":")
+        headers[name.strip().lower()] = value.strip()
+    match = re.match(r"bytes=(\d+)-(\d+)", headers.get("range", ""))
+    if match is None:
+        first, last = 0, len(image) - 1
+    else:
+        first, last = int(match.group(1)), min(int(match.group(2)), len(image) - 1)
+    body = image[first : last + 1]
+    head = (
+        "HTTP/1.1 206 Partial Content\r\n"
+        "Content-Type: application/octet-stream\r\n"
+        "Content-Range: bytes {}-{}/{}\r\n"
+        "Content-Length: {}\r\n"
+        "Connection: keep-alive\r\n\r\n".format(first, last, len(image), len(body))
+    ).encode()
+    pieces = [(head, False, 0.0)]
+    for offset in range(0, len(body), BLOCK_SIZE):
+        pieces.append((body[offset : offset + BLOCK_SIZE], False, link.rto if link.lost() else 0.0))
+    link.send(pieces)
+
+
+def handle(conn, image, args, rng):
+    reader = conn.makefile("rb")
+    link = Link(conn, args, rng)
+    try:
+        while True:
+            line = reader.readline()
+            if not line:
+                break
+            if line.startswith(b"STREAM"):
+                serve_mqtt(link, image, line)
+            elif line.startswith(b"GET"):
+                serve_http(link, image, line, reader)
+    except (OSError, ValueError, IndexError) as error:
+        print("Connection dropped: {}".format(error))
+    finally:
+        link.close()
+        conn.close()
+
+
+def main():
+    """
+    Serve an OTA file to ota_host_bench as MQTT stream blocks or HTTP ranges.
+    """
+    parser = argparse.ArgumentParser(description="OTA download stand-in. See README.md")
+    parser.add_argument("--image", action="store", required=True, dest="image", help="File to serve.")
+    parser.add_argument("--port", action="store", type=int, default=8883, dest="port", help="Port to listen on.")
+    parser.add_argument("--rtt-ms", action="store", type=float, default=0.0, dest="rtt_ms", help="Round trip time.")
+    parser.add_argument(
+        "--bandwidth-kbps", action="store", type=float, default=0.0, dest="bandwidth_kbps", help="Link rate, 0 for no limit."
+    )
+    parser.add_argument("--loss", action="store", type=float, default=0.0, dest="loss", help="Fraction of blocks lost.")
+    parser.add_argument(
+        "--rto-ms", action="store", type=float, default=200.0, dest="rto_ms", help="Stall of an HTTP connection per block lost."
+    )
+    parser.add_argument("--seed", action="store", type=int, default=1, dest="seed", help="Seed of the losses.")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    rng = random.Random(args.seed)
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(("127.0.0.1", args.port))
+    server.listen(4)
+    print("Serving {} ({} bytes) on port {}.".format(args.image, len(image), args.port))
+
+    while True:
+        conn, _ = server.accept()
+        conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        threading.Thread(target=handle, args=(conn, image, args, rng), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()
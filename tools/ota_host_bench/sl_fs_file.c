@@ -0,0 +1,673 @@
+/*
+ * sl_fs_file.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file sl_fs_file.c
+ *
+ * @brief The SimpleLink file system over files of the host.
+ *
+ * Each SimpleLink file is a file under the root directory, named after its
+ * path with '/' replaced by '_'. What the PAL relies on is kept: a file is
+ * open for writing once at a time and not for reading meanwhile, writes past
+ * the maximum size given at creation fail, and a file opened for writing is
+ * rewritten from empty.
+ *
+ * A failsafe file keeps its last committed copy until the new one is closed.
+ * The new copy is written to "<name>.new"; closing with the abort signature
+ * "A", or a reset while it is open, throws it away. A failsafe file written
+ * as part of a bundle stays pending when it is closed, with the committed
+ * copy kept in "<name>.old": a bundle commit drops that copy, a rollback
+ * restores it, and so does the second reset before a commit, as the first
+ * one boots the new copy for testing. Signatures are not emulated; the PAL
+ * checks the signature itself before the close.
+ */
+
+/* Standard includes. */
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ti/drivers/net/wifi/simplelink.h>
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Files open at once; the PAL has at most three.
+ */
+#define slfshostMAX_HANDLES      ( 8U )
+
+/**
+ * @brief Files whose attributes are remembered between opens; the PAL keeps
+ * up to 32 chunk files of a download beside the image and its own files.
+ */
+#define slfshostMAX_FILES        ( 64U )
+
+/**
+ * @brief Longest host path.
+ */
+#define slfshostPATH_LENGTH      ( 256U )
+
+/**
+ * @brief Suffixes of the copy being written and the committed copy kept
+ * while a bundle is pending.
+ */
+#define slfshostNEW_SUFFIX       ".new"
+#define slfshostOLD_SUFFIX       ".old"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The attributes and commit state of a file.
+ */
+typedef struct SlFsHostFile
+{
+    uint32_t ulMaxSize;  /**< @brief 0 for no limit. */
+    bool xFailsafe;
+    bool xPending;       /**< @brief Closed as part of a bundle and not committed. */
+    bool xHasOld;        /**< @brief The committed copy is kept while pending. */
+    uint32_t ulResets;   /**< @brief Resets since it went pending. */
+    char cPath[ slfshostPATH_LENGTH ];
+} SlFsHostFile_t;
+
+/**
+ * @brief An open file.
+ */
+typedef struct SlFsHostHandle
+{
+    bool xUsed;
+    bool xWrite;
+    bool xBundle;
+    int lDescriptor;
+    SlFsHostFile_t * pxFile;
+} SlFsHostHandle_t;
+
+/*-----------------------------------------------------------*/
+
+static const char * pcRoot = ".";
+static SlFsHostHandle_t xHandles[ slfshostMAX_HANDLES ];
+static SlFsHostFile_t xFiles[ slfshostMAX_FILES ];
+static SlFsHostStats_t xStats;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Host path of a SimpleLink file.
+ */
+static void prvHostPath( const _u8 * pucName,
+                         char * pcPath );
+
+/**
+ * @brief Host path of one of the copies of a file.
+ */
+static void prvCopyPath( const SlFsHostFile_t * pxFile,
+                         const char * pcSuffix,
+                         char * pcPath );
+
+/**
+ * @brief The open file behind a handle, or NULL.
+ */
+static SlFsHostHandle_t * prvGetHandle( _i32 lHandle );
+
+/**
+ * @brief Whether a file is open, for writing only if @p xWriteOnly.
+ */
+static bool prvIsOpen( const SlFsHostFile_t * pxFile,
+                       bool xWriteOnly );
+
+/**
+ * @brief The record of a file, added if there is none; NULL if the table is
+ * full.
+ */
+static SlFsHostFile_t * prvGetFile( const char * pcPath );
+
+/**
+ * @brief Drop the committed copy of a pending file.
+ */
+static void prvCommit( SlFsHostFile_t * pxFile );
+
+/**
+ * @brief Go back to the committed copy of a pending file.
+ */
+static void prvRollback( SlFsHostFile_t * pxFile );
+
+/*-----------------------------------------------------------*/
+
+static void prvHostPath( const _u8 * pucName,
+                         char * pcPath )
+{
+    size_t xLength;
+    size_t i;
+
+    ( void ) snprintf( pcPath, slfshostPATH_LENGTH, "%s/%s", pcRoot, ( const char * ) pucName );
+    xLength = strlen( pcRoot ) + 1U;
+
+    for( i = xLength; pcPath[ i ] != '\0'; i++ )
+    {
+        if( pcPath[ i ] == '/' )
+        {
+            pcPath[ i ] = '_';
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCopyPath( const SlFsHostFile_t * pxFile,
+                         const char * pcSuffix,
+                         char * pcPath )
+{
+    ( void ) snprintf( pcPath, slfshostPATH_LENGTH + 8U, "%s%s", pxFile->cPath, pcSuffix );
+}
+
+/*-----------------------------------------------------------*/
+
+static SlFsHostHandle_t * prvGetHandle( _i32 lHandle )
+{
+    SlFsHostHandle_t * pxHandle = NULL;
+
+    if( ( lHandle > 0 ) && ( lHandle <= ( _i32 ) slfshostMAX_HANDLES ) && xHandles[ lHandle - 1 ].xUsed )
+    {
+        pxHandle = &xHandles[ lHandle - 1 ];
+    }
+
+    return pxHandle;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvIsOpen( const SlFsHostFile_t * pxFile,
+                       bool xWriteOnly )
+{
+    bool xOpen = false;
+    size_t i;
+
+    for( i = 0U; i < slfshostMAX_HANDLES; i++ )
+    {
+        if( xHandles[ i ].xUsed && ( xHandles[ i ].xWrite || !xWriteOnly ) && ( xHandles[ i ].pxFile == pxFile ) )
+        {
+            xOpen = true;
+        }
+    }
+
+    return xOpen;
+}
+
+/*-----------------------------------------------------------*/
+
+static SlFsHostFile_t * prvGetFile( const char * pcPath )
+{
+    SlFsHostFile_t * pxFile = NULL;
+    size_t i;
+
+    for( i = 0U; i < slfshostMAX_FILES; i++ )
+    {
+        if( strcmp( xFiles[ i ].cPath, pcPath ) == 0 )
+        {
+            pxFile = &xFiles[ i ];
+            break;
+        }
+        else if( ( pxFile == NULL ) && ( xFiles[ i ].cPath[ 0 ] == '\0' ) )
+        {
+            pxFile = &xFiles[ i ];
+        }
+    }
+
+    if( ( pxFile != NULL ) && ( pxFile->cPath[ 0 ] == '\0' ) )
+    {
+        ( void ) memset( pxFile, 0, sizeof( *pxFile ) );
+        ( void ) strcpy( pxFile->cPath, pcPath );
+    }
+
+    return pxFile;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCommit( SlFsHostFile_t * pxFile )
+{
+    char cOld[ slfshostPATH_LENGTH + 8U ];
+
+    if( pxFile->xPending )
+    {
+        prvCopyPath( pxFile, slfshostOLD_SUFFIX, cOld );
+        ( void ) unlink( cOld );
+        pxFile->xPending = false;
+        pxFile->xHasOld = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRollback( SlFsHostFile_t * pxFile )
+{
+    char cOld[ slfshostPATH_LENGTH + 8U ];
+
+    if( pxFile->xPending )
+    {
+        if( pxFile->xHasOld )
+        {
+            prvCopyPath( pxFile, slfshostOLD_SUFFIX, cOld );
+            ( void ) rename( cOld, pxFile->cPath );
+        }
+        else
+        {
+            ( void ) unlink( pxFile->cPath );
+        }
+
+        pxFile->xPending = false;
+        pxFile->xHasOld = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void SlFsHost_SetRoot( const char * pcDirectory )
+{
+    pcRoot = pcDirectory;
+}
+
+/*-----------------------------------------------------------*/
+
+void SlFsHost_TakeStats( SlFsHostStats_t * pxStats )
+{
+    *pxStats = xStats;
+    ( void ) memset( &xStats, 0, sizeof( xStats ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void SlFsHost_Reset( void )
+{
+    char cNew[ slfshostPATH_LENGTH + 8U ];
+    size_t i;
+
+    for( i = 0U; i < slfshostMAX_HANDLES; i++ )
+    {
+        if( xHandles[ i ].xUsed )
+        {
+            ( void ) close( xHandles[ i ].lDescriptor );
+            xHandles[ i ].xUsed = false;
+
+            if( xHandles[ i ].xWrite && xHandles[ i ].pxFile->xFailsafe )
+            {
+                prvCopyPath( xHandles[ i ].pxFile, slfshostNEW_SUFFIX, cNew );
+                ( void ) unlink( cNew );
+            }
+        }
+    }
+
+    for( i = 0U; i < slfshostMAX_FILES; i++ )
+    {
+        if( xFiles[ i ].xPending )
+        {
+            xFiles[ i ].ulResets++;
+
+            if( xFiles[ i ].ulResets > 1UL )
+            {
+                prvRollback( &xFiles[ i ] );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+_i32 sl_FsOpen( const _u8 * pFileName,
+                const _u32 AccessModeAndMaxSize,
+                _u32 * pToken )
+{
+    char cPath[ slfshostPATH_LENGTH ];
+    char cNew[ slfshostPATH_LENGTH + 8U ];
+    bool xCreate = ( AccessModeAndMaxSize & SL_FS_CREATE ) != 0UL;
+    bool xWrite = xCreate || ( ( AccessModeAndMaxSize & SL_FS_WRITE ) != 0UL );
+    bool xExists;
+    SlFsHostFile_t * pxFile = NULL;
+    _i32 lResult = SL_ERROR_FS_NO_AVAILABLE_NV_INDEX;
+    size_t i;
+
+    ( void ) pToken;
+    xStats.ulOpens++;
+    prvHostPath( pFileName, cPath );
+    xExists = ( access( cPath, F_OK ) == 0 );
+    pxFile = prvGetFile( cPath );
+
+    if( pxFile == NULL )
+    {
+        lResult = SL_ERROR_FS_NO_AVAILABLE_NV_INDEX;
+    }
+    else if( prvIsOpen( pxFile, !xWrite ) )
+    {
+        lResult = SL_ERROR_FS_FILE_IS_ALREADY_OPENED;
+    }
+    else if( !xCreate && !xExists )
+    {
+        lResult = SL_ERROR_FS_FILE_NOT_EXISTS;
+    }
+    else
+    {
+        if( xCreate && ( !xExists || ( ( AccessModeAndMaxSize & SL_FS_OVERWRITE ) != 0UL ) ) )
+        {
+            pxFile->ulMaxSize = ( AccessModeAndMaxSize & 0xFFFFUL ) * 256UL;
+            pxFile->xFailsafe = ( AccessModeAndMaxSize & SL_FS_CREATE_FAILSAFE ) != 0UL;
+        }
+
+        for( i = 0U; i < slfshostMAX_HANDLES; i++ )
+        {
+            if( !xHandles[ i ].xUsed )
+            {
+                /* A file opened for writing starts empty. A failsafe one is
+                 * written beside the committed copy, which it replaces on
+                 * close. */
+                if( !xWrite )
+                {
+                    xHandles[ i ].lDescriptor = open( cPath, O_RDONLY );
+                }
+                else if( pxFile->xFailsafe )
+                {
+                    prvCopyPath( pxFile, slfshostNEW_SUFFIX, cNew );
+                    xHandles[ i ].lDescriptor = open( cNew, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+                }
+                else
+                {
+                    xHandles[ i ].lDescriptor = open( cPath, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+                }
+
+                if( xHandles[ i ].lDescriptor < 0 )
+                {
+                    lResult = SL_ERROR_FS_FILE_NOT_EXISTS;
+                }
+                else
+                {
+                    xHandles[ i ].xUsed = true;
+                    xHandles[ i ].xWrite = xWrite;
+                    xHandles[ i ].xBundle = ( AccessModeAndMaxSize & SL_FS_WRITE_BUNDLE_FILE ) != 0UL;
+                    xHandles[ i ].pxFile = pxFile;
+                    lResult = ( _i32 ) i + 1;
+                }
+
+                break;
+            }
+        }
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+_i16 sl_FsClose( const _i32 FileHdl,
+                 const _u8 * pCeritificateFileName,
+                 const _u8 * pSignature,
+                 const _u32 SignatureLen )
+{
+    SlFsHostHandle_t * pxHandle = prvGetHandle( FileHdl );
+    SlFsHostFile_t * pxFile = NULL;
+    char cNew[ slfshostPATH_LENGTH + 8U ];
+    char cOld[ slfshostPATH_LENGTH + 8U ];
+    bool xAbort = ( SignatureLen == 1UL ) && ( pSignature != NULL ) && ( pSignature[ 0 ] == ( _u8 ) 'A' );
+    _i16 sResult = ( _i16 ) SL_ERROR_FS_INVALID_HANDLE;
+
+    ( void ) pCeritificateFileName;
+
+    if( pxHandle != NULL )
+    {
+        ( void ) close( pxHandle->lDescriptor );
+        pxHandle->xUsed = false;
+        pxFile = pxHandle->pxFile;
+        prvCopyPath( pxFile, slfshostNEW_SUFFIX, cNew );
+        prvCopyPath( pxFile, slfshostOLD_SUFFIX, cOld );
+
+        if( !pxHandle->xWrite )
+        {
+            /* Nothing changed. */
+        }
+        else if( !pxFile->xFailsafe )
+        {
+            /* The abort signature throws the new content away; the old one
+             * went when the file was opened. */
+            if( xAbort )
+            {
+                ( void ) unlink( pxFile->cPath );
+            }
+        }
+        else if( xAbort )
+        {
+            /* The last committed copy stays. */
+            ( void ) unlink( cNew );
+        }
+        else if( pxHandle->xBundle )
+        {
+            /* The committed copy is kept until the bundle is committed or
+             * rolled back; a pending copy is simply replaced. */
+            if( !pxFile->xPending )
+            {
+                pxFile->xHasOld = ( rename( pxFile->cPath, cOld ) == 0 );
+                pxFile->xPending = true;
+                pxFile->ulResets = 0UL;
+            }
+
+            ( void ) rename( cNew, pxFile->cPath );
+        }
+        else
+        {
+            ( void ) rename( cNew, pxFile->cPath );
+        }
+
+        sResult = 0;
+    }
+
+    return sResult;
+}
+
+/*-----------------------------------------------------------*/
+
+_i32 sl_FsRead( const _i32 FileHdl,
+                _u32 Offset,
+                _u8 * pData,
+                _u32 Len )
+{
+    SlFsHostHandle_t * pxHandle = prvGetHandle( FileHdl );
+    struct stat xInfo;
+    ssize_t xRead;
+    _i32 lResult = SL_ERROR_FS_INVALID_HANDLE;
+
+    if( pxHandle != NULL )
+    {
+        xStats.ulReads++;
+
+        if( ( fstat( pxHandle->lDescriptor, &xInfo ) != 0 ) || ( ( off_t ) Offset >= xInfo.st_size ) )
+        {
+            lResult = SL_ERROR_FS_OFFSET_OUT_OF_RANGE;
+        }
+        else
+        {
+            xRead = pread( pxHandle->lDescriptor, pData, Len, ( off_t ) Offset );
+            lResult = ( xRead < 0 ) ? SL_ERROR_FS_OFFSET_OUT_OF_RANGE : ( _i32 ) xRead;
+        }
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+_i32 sl_FsWrite( const _i32 FileHdl,
+                 _u32 Offset,
+                 _u8 * pData,
+                 _u32 Len )
+{
+    SlFsHostHandle_t * pxHandle = prvGetHandle( FileHdl );
+    ssize_t xWritten;
+    _i32 lResult = SL_ERROR_FS_INVALID_HANDLE;
+
+    if( ( pxHandle != NULL ) && pxHandle->xWrite )
+    {
+        if( ( pxHandle->pxFile->ulMaxSize > 0UL ) && ( ( ( uint64_t ) Offset + Len ) > pxHandle->pxFile->ulMaxSize ) )
+        {
+            lResult = SL_ERROR_FS_FILE_MAX_SIZE_EXCEEDED;
+        }
+        else
+        {
+            xWritten = pwrite( pxHandle->lDescriptor, pData, Len, ( off_t ) Offset );
+            lResult = ( xWritten < 0 ) ? SL_ERROR_FS_FAILED_TO_WRITE : ( _i32 ) xWritten;
+            xStats.ulWrites++;
+            xStats.ulWriteBytes += ( xWritten > 0 ) ? ( uint32_t ) xWritten : 0UL;
+        }
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+_i16 sl_FsGetInfo( const _u8 * pFileName,
+                   const _u32 Token,
+                   SlFsFileInfo_t * pFsFileInfo )
+{
+    char cPath[ slfshostPATH_LENGTH ];
+    struct stat xInfo;
+    SlFsHostFile_t * pxFile = NULL;
+    _i16 sResult = ( _i16 ) SL_ERROR_FS_FILE_NOT_EXISTS;
+
+    ( void ) Token;
+    prvHostPath( pFileName, cPath );
+
+    if( stat( cPath, &xInfo ) == 0 )
+    {
+        pxFile = prvGetFile( cPath );
+        ( void ) memset( pFsFileInfo, 0, sizeof( *pFsFileInfo ) );
+        pFsFileInfo->Len = ( _u32 ) xInfo.st_size;
+
+        if( pxFile != NULL )
+        {
+            pFsFileInfo->MaxSize = pxFile->ulMaxSize;
+            pFsFileInfo->Flags = pxFile->xPending ? SL_FS_INFO_PENDING_BUNDLE_COMMIT : 0U;
+        }
+
+        sResult = 0;
+    }
+
+    return sResult;
+}
+
+/*-----------------------------------------------------------*/
+
+_i16 sl_FsDel( const _u8 * pFileName,
+               const _u32 Token )
+{
+    char cPath[ slfshostPATH_LENGTH ];
+    char cOld[ slfshostPATH_LENGTH + 8U ];
+    SlFsHostFile_t * pxFile = NULL;
+    _i16 sResult = ( _i16 ) SL_ERROR_FS_FILE_NOT_EXISTS;
+
+    ( void ) Token;
+    prvHostPath( pFileName, cPath );
+
+    /* Deleting a file that is not there leaves no record behind. */
+    if( access( cPath, F_OK ) == 0 )
+    {
+        pxFile = prvGetFile( cPath );
+    }
+
+    if( ( pxFile != NULL ) && prvIsOpen( pxFile, false ) )
+    {
+        sResult = ( _i16 ) SL_ERROR_FS_FILE_IS_ALREADY_OPENED;
+    }
+    else if( unlink( cPath ) == 0 )
+    {
+        if( pxFile != NULL )
+        {
+            prvCopyPath( pxFile, slfshostOLD_SUFFIX, cOld );
+            ( void ) unlink( cOld );
+            ( void ) memset( pxFile, 0, sizeof( *pxFile ) );
+        }
+
+        sResult = 0;
+    }
+
+    return sResult;
+}
+
+/*-----------------------------------------------------------*/
+
+_i32 sl_FsCtl( SlFsCtl_e Command,
+               _u32 Token,
+               _u8 * pFileName,
+               const _u8 * pData,
+               _u16 DataLen,
+               _u8 * pOutputData,
+               _u16 OutputDataLen,
+               _u32 * pNewToken )
+{
+    char cPath[ slfshostPATH_LENGTH ];
+    SlFsHostFile_t * pxFile = NULL;
+    size_t i;
+
+    ( void ) Token;
+    ( void ) pData;
+    ( void ) DataLen;
+    ( void ) pOutputData;
+    ( void ) OutputDataLen;
+    ( void ) pNewToken;
+
+    if( pFileName != NULL )
+    {
+        prvHostPath( pFileName, cPath );
+        pxFile = prvGetFile( cPath );
+    }
+
+    switch( Command )
+    {
+        case SL_FS_CTL_COMMIT:
+        case SL_FS_CTL_ROLLBACK:
+
+            if( ( pxFile != NULL ) && ( Command == SL_FS_CTL_COMMIT ) )
+            {
+                prvCommit( pxFile );
+            }
+            else if( pxFile != NULL )
+            {
+                prvRollback( pxFile );
+            }
+
+            break;
+
+        case SL_FS_CTL_BUNDLE_COMMIT:
+        case SL_FS_CTL_BUNDLE_ROLLBACK:
+
+            for( i = 0U; i < slfshostMAX_FILES; i++ )
+            {
+                if( Command == SL_FS_CTL_BUNDLE_COMMIT )
+                {
+                    prvCommit( &xFiles[ i ] );
+                }
+                else
+                {
+                    prvRollback( &xFiles[ i ] );
+                }
+            }
+
+            break;
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+_i16 sl_Stop( const _u16 Timeout )
+{
+    ( void ) Timeout;
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * core_mqtt.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef SHADOW_HOST_BENCH_CORE_MQTT_H_
+#define SHADOW_HOST_BENCH_CORE_MQTT_H_
+
+/**
+ * @file core_mqtt.h
+ * @brief The coreMQTT types the shadow client uses, on the host. The bench
+ * carries the publishes itself, so the context is opaque.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum MQTTQoS
+{
+    MQTTQoS0 = 0,
+    MQTTQoS1 = 1,
+    MQTTQoS2 = 2
+} MQTTQoS_t;
+
+typedef struct MQTTContext
+{
+    int lSocket;
+} MQTTContext_t;
+
+typedef struct MQTTPublishInfo
+{
+    MQTTQoS_t qos;
+    bool retain;
+    bool dup;
+    const char * pTopicName;
+    uint16_t topicNameLength;
+    const void * pPayload;
+    size_t payloadLength;
+} MQTTPublishInfo_t;
+
+typedef struct MQTTSubscribeInfo
+{
+    MQTTQoS_t qos;
+    const char * pTopicFilter;
+    uint16_t topicFilterLength;
+} MQTTSubscribeInfo_t;
+
+#endif /* SHADOW_HOST_BENCH_CORE_MQTT_H_ */
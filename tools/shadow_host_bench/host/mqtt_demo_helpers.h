@@ -0,0 +1,27 @@
+/*
+ * mqtt_demo_helpers.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef SHADOW_HOST_BENCH_MQTT_DEMO_HELPERS_H_
+#define SHADOW_HOST_BENCH_MQTT_DEMO_HELPERS_H_
+
+/**
+ * @file mqtt_demo_helpers.h
+ * @brief The MQTT helper the shadow client subscribes with, on the host.
+ * The stand-in answers on the topics of whatever it is sent, so the bench
+ * only checks the filters.
+ */
+
+#include <stddef.h>
+
+#include "FreeRTOS.h"
+#include "core_mqtt.h"
+
+BaseType_t SubscribeToTopics( MQTTContext_t * pxContext,
+                              const MQTTSubscribeInfo_t * pxSubscriptions,
+                              size_t xSubscriptionCount );
+
+#endif /* SHADOW_HOST_BENCH_MQTT_DEMO_HELPERS_H_ */
@@ -0,0 +1,30 @@
+/*
+ * shadow.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+#ifndef SHADOW_HOST_BENCH_SHADOW_H_
+#define SHADOW_HOST_BENCH_SHADOW_H_
+
+/**
+ * @file shadow.h
+ * @brief The message types of the AWS IoT Device Shadow library, on the
+ * host.
+ */
+
+typedef enum ShadowMessageType
+{
+    ShadowMessageTypeGetAccepted = 0,
+    ShadowMessageTypeGetRejected,
+    ShadowMessageTypeDeleteAccepted,
+    ShadowMessageTypeDeleteRejected,
+    ShadowMessageTypeUpdateAccepted,
+    ShadowMessageTypeUpdateRejected,
+    ShadowMessageTypeUpdateDocuments,
+    ShadowMessageTypeUpdateDelta,
+    ShadowMessageTypeMaxNum
+} ShadowMessageType_t;
+
+#endif /* SHADOW_HOST_BENCH_SHADOW_H_ */
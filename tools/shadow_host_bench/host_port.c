@@ -0,0 +1,83 @@
+/*
+ * host_port.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file host_port.c
+ *
+ * @brief What the shadow code takes from the kernel and the metrics, on the
+ * host.
+ *
+ * Ticks are milliseconds of CLOCK_MONOTONIC. A metrics timestamp keeps the
+ * microseconds in place of the cycle counter, so the round trip of a report
+ * is measured from when its slot was taken, as on the device.
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "mqtt_metrics.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Microseconds of CLOCK_MONOTONIC, wrapping as the cycle counter does.
+ */
+static uint32_t prvNowUs( void );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvNowUs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( uint32_t ) ( ( ( uint64_t ) xNow.tv_sec * 1000000U ) + ( ( uint64_t ) xNow.tv_nsec / 1000U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void * pvPortMalloc( size_t xSize )
+{
+    return malloc( xSize );
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( TickType_t ) ( ( ( uint64_t ) xNow.tv_sec * 1000U ) + ( ( uint64_t ) xNow.tv_nsec / 1000000U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void MQTTMetrics_Start( MQTTMetricsTimestamp_t * pxTimestamp )
+{
+    pxTimestamp->xTicks = xTaskGetTickCount();
+    pxTimestamp->ulCycles = prvNowUs();
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t MQTTMetrics_ElapsedUs( const MQTTMetricsTimestamp_t * pxStart )
+{
+    return prvNowUs() - pxStart->ulCycles;
+}
@@ -0,0 +1,846 @@
+/*
+ * shadow_host_bench.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Brandon
+ */
+
+/**
+ * @file shadow_host_bench.c
+ *
+ * @brief Sync state changes with a shadow on the host and time each update.
+ *
+ * The bench plays the part of the shadow task: it registers the shadow with
+ * shadow_client.c, fetches the document, then changes the state the number
+ * of times asked for, reporting each change alone through shadow_state.c
+ * and shadow_request.c as soon as the previous one is answered. Answers
+ * from shadow_stand_in.py are handed to ShadowClient_Dispatch() as the MQTT
+ * event callback does on the device, and a report that is rejected or goes
+ * unanswered is retried as the task retries it.
+ *
+ * Publishes are carried over TCP as a topic and a payload with their
+ * lengths in front; the stand-in answers on the response topics of what it
+ * is sent. The pool is shared with the network buffer, which the shadow
+ * task holds for its session, and answers are received into it.
+ * See README.md.
+ */
+
+/* Standard includes. */
+#include <getopt.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "shadow_demo_config.h"
+#include "shadow_client.h"
+#include "shadow_json.h"
+#include "shadow_request.h"
+#include "shadow_state.h"
+#include "buffer_pool.h"
+#include "mqtt_metrics.h"
+#include "mqtt_demo_helpers.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Topic length and payload length in front of each publish.
+ */
+#define benchFRAME_HEADER_SIZE             ( 6U )
+
+/**
+ * @brief Size of an update document, as the shadow task borrows it.
+ */
+#define benchREPORT_BUFFER_SIZE            ( 128U )
+
+/**
+ * @brief Time to wait for an answer, as the shadow task waits.
+ */
+#define benchRESPONSE_TIMEOUT_MS           ( 5000U )
+
+/**
+ * @brief Process loop timeout while a change waits, as on the device.
+ */
+#define benchDIRTY_PROCESS_LOOP_TIMEOUT_MS ( 100U )
+
+/**
+ * @brief Reports in a row that may fail before the run is given up.
+ */
+#define benchMAX_SYNC_ATTEMPTS             ( 3U )
+
+/**
+ * @brief Time the rest of a publish may take once it started coming.
+ */
+#define benchSOCKET_TIMEOUT_MS             ( 5000U )
+
+/**
+ * @brief Position of the property the bench toggles.
+ */
+#define benchPROPERTY_POWER_ON             ( 0U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The command line.
+ */
+typedef struct BenchConfig
+{
+    const char * pcHost;
+    const char * pcPort;
+    const char * pcThingName;
+    const char * pcShadowName;
+    uint32_t ulChanges;
+    uint32_t ulMaxP99Us; /**< @brief 0 for no gate. */
+} BenchConfig_t;
+
+/**
+ * @brief What the run measured.
+ */
+typedef struct BenchRun
+{
+    uint32_t ulAccepted;
+    uint32_t ulRejected;
+    uint32_t ulConflicts;    /**< @brief Rejections for a version conflict. */
+    uint32_t ulExpired;      /**< @brief Reports not answered in time. */
+    uint32_t ulGets;
+    uint32_t ulBytes;        /**< @brief Bytes of update documents and of their answers. */
+    uint32_t * pulLatencyUs; /**< @brief Round trip of each accepted update. */
+    uint32_t ulLatencySlots;
+} BenchRun_t;
+
+/*-----------------------------------------------------------*/
+
+static MQTTContext_t xMqttContext = { .lSocket = -1 };
+
+static uint8_t * pucNetworkBuffer = NULL;
+
+static ShadowStateProperty_t xShadowProperties[] =
+{
+    shadowstateINT( "powerOn" )
+};
+
+static ShadowStateModel_t xShadowState = shadowstateMODEL( xShadowProperties );
+
+static ShadowRequest_t xRequestSlots[ democonfigSHADOW_MAX_UPDATES_IN_FLIGHT ];
+static ShadowRequestTable_t xRequests = shadowrequestTABLE( xRequestSlots, benchRESPONSE_TIMEOUT_MS );
+
+static ShadowClientHandle_t xShadow = NULL;
+
+static BenchRun_t xRun;
+
+static uint32_t ulFailedReports = 0UL;
+
+static bool xFetchBeforeReport = false;
+
+static bool xGetAnswered = false;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Connect to the stand-in.
+ */
+static int prvConnect( const BenchConfig_t * pxConfig );
+
+/**
+ * @brief Send a publish to the stand-in.
+ */
+static BaseType_t prvPublish( const char * pcTopic,
+                              uint16_t usTopicLength,
+                              const char * pcPayload,
+                              size_t xPayloadLength );
+
+/**
+ * @brief Receive exactly @p xLength bytes.
+ */
+static bool prvRecvAll( uint8_t * pucBuffer,
+                        size_t xLength );
+
+/**
+ * @brief Wait up to @p ulTimeoutMs for a publish, then hand every publish
+ * already in to the shadow client.
+ */
+static BaseType_t prvProcessLoop( uint32_t ulTimeoutMs );
+
+/**
+ * @brief The shadow's callback: match answers to the reports in flight.
+ */
+static void prvShadowCallback( const ShadowClientEvent_t * pxEvent,
+                               void * pvContext );
+
+/**
+ * @brief Complete the report an update answer carries the token of.
+ */
+static bool prvTakeReportResponse( const ShadowClientEvent_t * pxEvent,
+                                   ShadowRequest_t * pxRequest );
+
+/**
+ * @brief Ask for the document and wait for the answer, for its version.
+ */
+static BaseType_t prvGetShadow( void );
+
+/**
+ * @brief Write the dirty properties into a pool buffer and publish them.
+ */
+static BaseType_t prvPublishReport( void );
+
+/**
+ * @brief Fail the reports not answered in time.
+ */
+static void prvExpireReports( void );
+
+/**
+ * @brief Percentile @p ulPermille of the sorted latencies.
+ */
+static uint32_t prvPercentile( const uint32_t * pulSorted,
+                               uint32_t ulCount,
+                               uint32_t ulPermille );
+
+/**
+ * @brief Order for qsort().
+ */
+static int prvCompareU32( const void * pvA,
+                          const void * pvB );
+
+/**
+ * @brief Print the options.
+ */
+static void prvUsage( const char * pcName );
+
+/*-----------------------------------------------------------*/
+
+/* The stand-in answers whatever it is sent on its response topics, so
+ * there is nothing to subscribe; the filters are only checked. */
+
+BaseType_t SubscribeToTopics( MQTTContext_t * pxContext,
+                              const MQTTSubscribeInfo_t * pxSubscriptions,
+                              size_t xSubscriptionCount )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    size_t x;
+
+    ( void ) pxContext;
+
+    for( x = 0U; x < xSubscriptionCount; x++ )
+    {
+        if( ( pxSubscriptions[ x ].pTopicFilter == NULL ) || ( pxSubscriptions[ x ].topicFilterLength == 0U ) )
+        {
+            xReturnStatus = pdFAIL;
+        }
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvConnect( const BenchConfig_t * pxConfig )
+{
+    struct addrinfo xHints = { 0 };
+    struct addrinfo * pxAddresses = NULL;
+    struct timeval xTimeout;
+    int lSocket = -1;
+    int lOne = 1;
+
+    xHints.ai_family = AF_UNSPEC;
+    xHints.ai_socktype = SOCK_STREAM;
+
+    if( getaddrinfo( pxConfig->pcHost, pxConfig->pcPort, &xHints, &pxAddresses ) == 0 )
+    {
+        lSocket = socket( pxAddresses->ai_family, pxAddresses->ai_socktype, pxAddresses->ai_protocol );
+
+        if( ( lSocket >= 0 ) && ( connect( lSocket, pxAddresses->ai_addr, pxAddresses->ai_addrlen ) != 0 ) )
+        {
+            ( void ) close( lSocket );
+            lSocket = -1;
+        }
+
+        freeaddrinfo( pxAddresses );
+    }
+
+    if( lSocket >= 0 )
+    {
+        xTimeout.tv_sec = benchSOCKET_TIMEOUT_MS / 1000U;
+        xTimeout.tv_usec = 0;
+        ( void ) setsockopt( lSocket, SOL_SOCKET, SO_RCVTIMEO, &xTimeout, sizeof( xTimeout ) );
+        ( void ) setsockopt( lSocket, IPPROTO_TCP, TCP_NODELAY, &lOne, sizeof( lOne ) );
+    }
+    else
+    {
+        fprintf( stderr, "Cannot connect to %s:%s.\n", pxConfig->pcHost, pxConfig->pcPort );
+    }
+
+    return lSocket;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvPublish( const char * pcTopic,
+                              uint16_t usTopicLength,
+                              const char * pcPayload,
+                              size_t xPayloadLength )
+{
+    uint8_t ucHeader[ benchFRAME_HEADER_SIZE ];
+    BaseType_t xReturnStatus = pdPASS;
+
+    ucHeader[ 0 ] = ( uint8_t ) usTopicLength;
+    ucHeader[ 1 ] = ( uint8_t ) ( usTopicLength >> 8 );
+    ucHeader[ 2 ] = ( uint8_t ) xPayloadLength;
+    ucHeader[ 3 ] = ( uint8_t ) ( xPayloadLength >> 8 );
+    ucHeader[ 4 ] = ( uint8_t ) ( xPayloadLength >> 16 );
+    ucHeader[ 5 ] = ( uint8_t ) ( xPayloadLength >> 24 );
+
+    if( ( send( xMqttContext.lSocket, ucHeader, sizeof( ucHeader ), MSG_NOSIGNAL ) != ( ssize_t ) sizeof( ucHeader ) ) ||
+        ( send( xMqttContext.lSocket, pcTopic, usTopicLength, MSG_NOSIGNAL ) != ( ssize_t ) usTopicLength ) ||
+        ( send( xMqttContext.lSocket, pcPayload, xPayloadLength, MSG_NOSIGNAL ) != ( ssize_t ) xPayloadLength ) )
+    {
+        fprintf( stderr, "Cannot send to the stand-in.\n" );
+        xReturnStatus = pdFAIL;
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvRecvAll( uint8_t * pucBuffer,
+                        size_t xLength )
+{
+    size_t xReceived = 0U;
+    ssize_t xResult = 1;
+
+    while( ( xReceived < xLength ) && ( xResult > 0 ) )
+    {
+        xResult = recv( xMqttContext.lSocket, &pucBuffer[ xReceived ], xLength - xReceived, 0 );
+
+        if( xResult > 0 )
+        {
+            xReceived += ( size_t ) xResult;
+        }
+    }
+
+    return xReceived == xLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvProcessLoop( uint32_t ulTimeoutMs )
+{
+    struct pollfd xPoll = { .fd = xMqttContext.lSocket, .events = POLLIN };
+    MQTTPublishInfo_t xPublishInfo = { 0 };
+    uint8_t ucHeader[ benchFRAME_HEADER_SIZE ];
+    BaseType_t xReturnStatus = pdPASS;
+    uint16_t usTopicLength;
+    uint32_t ulPayloadLength;
+    int lReady;
+
+    lReady = poll( &xPoll, 1, ( int ) ulTimeoutMs );
+
+    /* Every publish already in is handled, as the process loop does. */
+    while( ( lReady > 0 ) && ( xReturnStatus == pdPASS ) )
+    {
+        if( prvRecvAll( ucHeader, sizeof( ucHeader ) ) == false )
+        {
+            fprintf( stderr, "The stand-in closed the connection.\n" );
+            xReturnStatus = pdFAIL;
+        }
+        else
+        {
+            usTopicLength = ( uint16_t ) ( ucHeader[ 0 ] | ( ( uint16_t ) ucHeader[ 1 ] << 8 ) );
+            ulPayloadLength = ( uint32_t ) ucHeader[ 2 ] | ( ( uint32_t ) ucHeader[ 3 ] << 8 ) |
+                              ( ( uint32_t ) ucHeader[ 4 ] << 16 ) | ( ( uint32_t ) ucHeader[ 5 ] << 24 );
+
+            if( ( ( size_t ) usTopicLength + ulPayloadLength ) > democonfigNETWORK_BUFFER_SIZE )
+            {
+                fprintf( stderr, "A publish of %u bytes does not fit the network buffer.\n",
+                         ( unsigned ) ( usTopicLength + ulPayloadLength ) );
+                xReturnStatus = pdFAIL;
+            }
+            else if( prvRecvAll( pucNetworkBuffer, ( size_t ) usTopicLength + ulPayloadLength ) == false )
+            {
+                fprintf( stderr, "The stand-in closed the connection.\n" );
+                xReturnStatus = pdFAIL;
+            }
+            else
+            {
+                xPublishInfo.qos = MQTTQoS1;
+                xPublishInfo.pTopicName = ( const char * ) pucNetworkBuffer;
+                xPublishInfo.topicNameLength = usTopicLength;
+                xPublishInfo.pPayload = &pucNetworkBuffer[ usTopicLength ];
+                xPublishInfo.payloadLength = ulPayloadLength;
+
+                if( ShadowClient_Dispatch( &xPublishInfo ) == false )
+                {
+                    fprintf( stderr, "Publish on an unknown topic %.*s.\n", ( int ) usTopicLength, xPublishInfo.pTopicName );
+                }
+            }
+        }
+
+        lReady = poll( &xPoll, 1, 0 );
+    }
+
+    if( lReady < 0 )
+    {
+        xReturnStatus = pdFAIL;
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvTakeReportResponse( const ShadowClientEvent_t * pxEvent,
+                                   ShadowRequest_t * pxRequest )
+{
+    uint32_t ulReceivedToken = 0U;
+    bool xIsResponse = false;
+
+    if( ( pxEvent->xValid == true ) &&
+        ( pxEvent->xClientToken.eType == eShadowJsonString ) &&
+        ( ShadowJson_GetUInt32( pxEvent->pcPayload, &pxEvent->xClientToken, &ulReceivedToken ) == eShadowJsonSuccess ) &&
+        ( ShadowRequest_Complete( &xRequests, ulReceivedToken, pxRequest ) == true ) )
+    {
+        if( ( pxEvent->xMessageType == ShadowMessageTypeUpdateAccepted ) &&
+            ( xRun.ulAccepted < xRun.ulLatencySlots ) )
+        {
+            xRun.pulLatencyUs[ xRun.ulAccepted ] = MQTTMetrics_ElapsedUs( &pxRequest->xStartedAt );
+        }
+
+        xRun.ulBytes += ( uint32_t ) pxEvent->xPayloadLength;
+        BufferPool_Release( pxRequest->pcDocument );
+        xIsResponse = true;
+    }
+    else
+    {
+        /* An answer to a report that already timed out; it was failed then. */
+        fprintf( stderr, "An update answer matches no report in flight.\n" );
+    }
+
+    return xIsResponse;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvShadowCallback( const ShadowClientEvent_t * pxEvent,
+                               void * pvContext )
+{
+    ShadowRequest_t xRequest = { 0 };
+    uint32_t ulValue = 0U;
+
+    ( void ) pvContext;
+
+    switch( pxEvent->xMessageType )
+    {
+        case ShadowMessageTypeGetAccepted:
+
+            if( ShadowJson_GetUInt32( pxEvent->pcPayload, &pxEvent->xVersion, &ulValue ) == eShadowJsonSuccess )
+            {
+                ( void ) ShadowState_UpdateVersion( &xShadowState, ulValue );
+            }
+
+            xGetAnswered = true;
+            break;
+
+        case ShadowMessageTypeGetRejected:
+
+            /* No shadow yet; the first report creates it. */
+            xShadowState.ulVersion = 0UL;
+            xGetAnswered = true;
+            break;
+
+        case ShadowMessageTypeUpdateAccepted:
+
+            if( prvTakeReportResponse( pxEvent, &xRequest ) == true )
+            {
+                if( ShadowJson_GetUInt32( pxEvent->pcPayload, &pxEvent->xVersion, &ulValue ) == eShadowJsonSuccess )
+                {
+                    ( void ) ShadowState_UpdateVersion( &xShadowState, ulValue );
+                }
+
+                xRun.ulAccepted++;
+                ulFailedReports = 0UL;
+            }
+
+            break;
+
+        case ShadowMessageTypeUpdateRejected:
+
+            if( prvTakeReportResponse( pxEvent, &xRequest ) == true )
+            {
+                ( void ) ShadowJson_GetUInt32( pxEvent->pcPayload, &pxEvent->xCode, &ulValue );
+                ShadowState_OnReportFailed( &xShadowState, xRequest.ulMask );
+                xRun.ulRejected++;
+                ulFailedReports++;
+
+                /* The shadow moved on; fetch it before reporting again. */
+                if( ulValue == 409UL )
+                {
+                    xRun.ulConflicts++;
+                    xFetchBeforeReport = true;
+                }
+            }
+
+            break;
+
+        default:
+            /* Deltas and documents are not part of the measurement. */
+            break;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvGetShadow( void )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    const char * pcTopic = NULL;
+    uint16_t usTopicLength = 0U;
+    uint32_t ulWaitedMs = 0UL;
+
+    pcTopic = ShadowClient_GetTopic( xShadow, eShadowClientTopicGet, &usTopicLength );
+    xGetAnswered = false;
+    xReturnStatus = prvPublish( pcTopic, usTopicLength, "", 0U );
+    xRun.ulGets++;
+
+    while( ( xReturnStatus == pdPASS ) && ( xGetAnswered == false ) && ( ulWaitedMs < benchRESPONSE_TIMEOUT_MS ) )
+    {
+        xReturnStatus = prvProcessLoop( benchDIRTY_PROCESS_LOOP_TIMEOUT_MS );
+        ulWaitedMs += benchDIRTY_PROCESS_LOOP_TIMEOUT_MS;
+    }
+
+    if( ( xReturnStatus == pdPASS ) && ( xGetAnswered == false ) )
+    {
+        fprintf( stderr, "No answer to the get within %u ms.\n", benchRESPONSE_TIMEOUT_MS );
+        xReturnStatus = pdFAIL;
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvPublishReport( void )
+{
+    BaseType_t xReturnStatus = pdPASS;
+    ShadowRequest_t * pxRequest = NULL;
+    size_t xLength = 0U;
+    const char * pcTopic = NULL;
+    uint16_t usTopicLength = 0U;
+
+    /* As on the device: only a report sent alone is conditional. */
+    bool xConditional = ( ShadowRequest_InFlight( &xRequests ) == 0U );
+
+    pxRequest = ShadowRequest_Add( &xRequests );
+
+    if( pxRequest != NULL )
+    {
+        pxRequest->pcDocument = BufferPool_Acquire( benchREPORT_BUFFER_SIZE );
+
+        if( pxRequest->pcDocument == NULL )
+        {
+            fprintf( stderr, "No buffer available for the update document.\n" );
+            ( void ) ShadowRequest_Complete( &xRequests, pxRequest->ulClientToken, NULL );
+            xReturnStatus = pdFAIL;
+        }
+        else if( ShadowState_SerializeReported( &xShadowState,
+                                                pxRequest->pcDocument,
+                                                BufferPool_GetSize( pxRequest->pcDocument ),
+                                                pxRequest->ulClientToken,
+                                                xConditional,
+                                                &xLength,
+                                                &pxRequest->ulMask ) != eShadowStateSuccess )
+        {
+            fprintf( stderr, "Failed to write the update document.\n" );
+            BufferPool_Release( pxRequest->pcDocument );
+            ( void ) ShadowRequest_Complete( &xRequests, pxRequest->ulClientToken, NULL );
+            xReturnStatus = pdFAIL;
+        }
+        else
+        {
+            pcTopic = ShadowClient_GetTopic( xShadow, eShadowClientTopicUpdate, &usTopicLength );
+            xReturnStatus = prvPublish( pcTopic, usTopicLength, pxRequest->pcDocument, xLength );
+            xRun.ulBytes += ( uint32_t ) xLength;
+        }
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvExpireReports( void )
+{
+    ShadowRequest_t xRequest = { 0 };
+
+    while( ShadowRequest_TakeExpired( &xRequests, &xRequest ) == true )
+    {
+        BufferPool_Release( xRequest.pcDocument );
+        ShadowState_OnReportFailed( &xShadowState, xRequest.ulMask );
+        xRun.ulExpired++;
+        ulFailedReports++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvCompareU32( const void * pvA,
+                          const void * pvB )
+{
+    uint32_t ulA = *( const uint32_t * ) pvA;
+    uint32_t ulB = *( const uint32_t * ) pvB;
+
+    return ( ulA > ulB ) - ( ulA < ulB );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvPercentile( const uint32_t * pulSorted,
+                               uint32_t ulCount,
+                               uint32_t ulPermille )
+{
+    uint32_t ulRank;
+
+    if( ulCount == 0UL )
+    {
+        return 0UL;
+    }
+
+    /* Nearest rank. */
+    ulRank = ( uint32_t ) ( ( ( ( uint64_t ) ulCount * ulPermille ) + 999ULL ) / 1000ULL );
+
+    return pulSorted[ ( ulRank > 0UL ) ? ( ulRank - 1UL ) : 0UL ];
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char * pcName )
+{
+    fprintf( stderr,
+             "Usage: %s [--host HOST] [--port PORT] [--thing NAME] [--shadow NAME]\n"
+             "       [--changes N] [--max-p99-us US]\n"
+             "See README.md.\n",
+             pcName );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char * argv[] )
+{
+    static const struct option xOptions[] =
+    {
+        { "host",       required_argument, NULL, 'h' },
+        { "port",       required_argument, NULL, 'p' },
+        { "thing",      required_argument, NULL, 't' },
+        { "shadow",     required_argument, NULL, 's' },
+        { "changes",    required_argument, NULL, 'n' },
+        { "max-p99-us", required_argument, NULL, 'm' },
+        { NULL,         0,                 NULL, 0   }
+    };
+    BenchConfig_t xConfig =
+    {
+        .pcHost       = "127.0.0.1",
+        .pcPort       = "8883",
+        .pcThingName  = "bench",
+        .pcShadowName = "",
+        .ulChanges    = 100UL
+    };
+    BufferPoolStats_t xPoolBefore[ bufferpoolNUM_CLASSES ];
+    BufferPoolStats_t xPoolAfter[ bufferpoolNUM_CLASSES ];
+    BufferPoolStats_t xPoolEnd[ bufferpoolNUM_CLASSES ];
+    BaseType_t xReturnStatus = pdPASS;
+    ShadowRequest_t xRequest = { 0 };
+    uint32_t ulChange = 0UL;
+    uint32_t ulAcquired = 0UL;
+    uint32_t ulPoolLeft = 0UL;
+    uint32_t ulSamples = 0UL;
+    uint32_t ulP99 = 0UL;
+    uint32_t ulMs = 0UL;
+    TickType_t xStart;
+    int lOption;
+    int lExit = 0;
+    size_t x;
+
+    while( ( lOption = getopt_long( argc, argv, "", xOptions, NULL ) ) != -1 )
+    {
+        switch( lOption )
+        {
+            case 'h':
+                xConfig.pcHost = optarg;
+                break;
+
+            case 'p':
+                xConfig.pcPort = optarg;
+                break;
+
+            case 't':
+                xConfig.pcThingName = optarg;
+                break;
+
+            case 's':
+                xConfig.pcShadowName = optarg;
+                break;
+
+            case 'n':
+                xConfig.ulChanges = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'm':
+                xConfig.ulMaxP99Us = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            default:
+                prvUsage( argv[ 0 ] );
+                return 2;
+        }
+    }
+
+    xRun.ulLatencySlots = xConfig.ulChanges + 1UL;
+    xRun.pulLatencyUs = calloc( xRun.ulLatencySlots, sizeof( uint32_t ) );
+    xMqttContext.lSocket = prvConnect( &xConfig );
+
+    if( ( xRun.pulLatencyUs == NULL ) || ( xMqttContext.lSocket < 0 ) )
+    {
+        return 2;
+    }
+
+    /* The session's network buffer, as the shadow task borrows it. */
+    pucNetworkBuffer = BufferPool_Acquire( democonfigNETWORK_BUFFER_SIZE );
+
+    if( ( pucNetworkBuffer == NULL ) ||
+        ( ShadowState_Init( &xShadowState ) != eShadowStateSuccess ) ||
+        ( ShadowClient_Init( xConfig.pcThingName, ( uint16_t ) strlen( xConfig.pcThingName ) ) != pdPASS ) )
+    {
+        fprintf( stderr, "Cannot set up the shadow client.\n" );
+        return 2;
+    }
+
+    ShadowRequest_Init( &xRequests );
+    xShadow = ShadowClient_Register( xConfig.pcShadowName, prvShadowCallback, NULL );
+
+    if( ( xShadow == NULL ) || ( ShadowClient_Subscribe( &xMqttContext ) != pdPASS ) )
+    {
+        fprintf( stderr, "Cannot register shadow \"%s\".\n", xConfig.pcShadowName );
+        return 2;
+    }
+
+    /* The first report carries the whole state; it is not measured. */
+    xReturnStatus = prvGetShadow();
+
+    while( ( xReturnStatus == pdPASS ) && ( ShadowState_IsDirty( &xShadowState ) == true ) )
+    {
+        xReturnStatus = prvPublishReport();
+
+        while( ( xReturnStatus == pdPASS ) && ( ShadowRequest_InFlight( &xRequests ) > 0U ) )
+        {
+            xReturnStatus = prvProcessLoop( benchDIRTY_PROCESS_LOOP_TIMEOUT_MS );
+            prvExpireReports();
+        }
+    }
+
+    ( void ) memset( xRun.pulLatencyUs, 0, xRun.ulLatencySlots * sizeof( uint32_t ) );
+    xRun.ulAccepted = 0UL;
+    xRun.ulRejected = 0UL;
+    xRun.ulConflicts = 0UL;
+    xRun.ulExpired = 0UL;
+    xRun.ulGets = 0UL;
+    xRun.ulBytes = 0UL;
+    BufferPool_GetStats( xPoolBefore );
+    xStart = xTaskGetTickCount();
+
+    for( ulChange = 0UL; ( xReturnStatus == pdPASS ) && ( ulChange < xConfig.ulChanges ); ulChange++ )
+    {
+        ( void ) ShadowState_SetInt( &xShadowState,
+                                     benchPROPERTY_POWER_ON,
+                                     ( ShadowState_GetInt( &xShadowState, benchPROPERTY_POWER_ON ) == 0 ) ? 1 : 0 );
+
+        /* Every change is one update: there is no coalescing window. */
+        while( ( xReturnStatus == pdPASS ) &&
+               ( ( ShadowState_IsDirty( &xShadowState ) == true ) ||
+                 ( ShadowRequest_InFlight( &xRequests ) > 0U ) ) )
+        {
+            if( ( xFetchBeforeReport == true ) && ( ShadowRequest_InFlight( &xRequests ) == 0U ) )
+            {
+                xFetchBeforeReport = false;
+                xReturnStatus = prvGetShadow();
+            }
+
+            if( ( xReturnStatus == pdPASS ) && ( ShadowRequest_InFlight( &xRequests ) == 0U ) )
+            {
+                xReturnStatus = prvPublishReport();
+            }
+
+            if( xReturnStatus == pdPASS )
+            {
+                xReturnStatus = prvProcessLoop( benchDIRTY_PROCESS_LOOP_TIMEOUT_MS );
+            }
+
+            prvExpireReports();
+
+            if( ulFailedReports >= benchMAX_SYNC_ATTEMPTS )
+            {
+                fprintf( stderr, "%u reports in a row failed.\n", ( unsigned ) ulFailedReports );
+                xReturnStatus = pdFAIL;
+            }
+        }
+    }
+
+    ulMs = ( uint32_t ) ( xTaskGetTickCount() - xStart );
+    BufferPool_GetStats( xPoolAfter );
+
+    while( ShadowRequest_TakeAny( &xRequests, &xRequest ) == true )
+    {
+        BufferPool_Release( xRequest.pcDocument );
+    }
+
+    BufferPool_Release( pucNetworkBuffer );
+    BufferPool_GetStats( xPoolEnd );
+
+    for( x = 0U; x < bufferpoolNUM_CLASSES; x++ )
+    {
+        ulAcquired += xPoolAfter[ x ].ulAcquired - xPoolBefore[ x ].ulAcquired;
+        ulPoolLeft += xPoolEnd[ x ].ulInUse;
+    }
+
+    ulSamples = ( xRun.ulAccepted < xRun.ulLatencySlots ) ? xRun.ulAccepted : xRun.ulLatencySlots;
+    qsort( xRun.pulLatencyUs, ulSamples, sizeof( uint32_t ), prvCompareU32 );
+    ulP99 = prvPercentile( xRun.pulLatencyUs, ulSamples, 990UL );
+
+    printf( "%u changes to shadow \"%s\" of %s over %s:%s in %u ms\n",
+            ( unsigned ) ulChange, xConfig.pcShadowName, xConfig.pcThingName,
+            xConfig.pcHost, xConfig.pcPort, ( unsigned ) ulMs );
+    printf( "updates accepted %u, rejected %u (%u conflicts), unanswered %u, gets %u\n",
+            ( unsigned ) xRun.ulAccepted, ( unsigned ) xRun.ulRejected, ( unsigned ) xRun.ulConflicts,
+            ( unsigned ) xRun.ulExpired, ( unsigned ) xRun.ulGets );
+    printf( "round trip us: p50 %u  p99 %u  p99.9 %u  max %u\n",
+            ( unsigned ) prvPercentile( xRun.pulLatencyUs, ulSamples, 500UL ),
+            ( unsigned ) ulP99,
+            ( unsigned ) prvPercentile( xRun.pulLatencyUs, ulSamples, 999UL ),
+            ( unsigned ) ( ( ulSamples > 0UL ) ? xRun.pulLatencyUs[ ulSamples - 1UL ] : 0UL ) );
+    printf( "per update: %u bytes, %.2f pool buffers\n",
+            ( unsigned ) ( ( xRun.ulAccepted > 0UL ) ? ( xRun.ulBytes / xRun.ulAccepted ) : 0UL ),
+            ( xRun.ulAccepted > 0UL ) ? ( ( double ) ulAcquired / ( double ) xRun.ulAccepted ) : 0.0 );
+
+    if( ulPoolLeft > 0UL )
+    {
+        fprintf( stderr, "%u pool buffers left borrowed.\n", ( unsigned ) ulPoolLeft );
+    }
+
+    if( ( xReturnStatus != pdPASS ) || ( ulPoolLeft > 0UL ) || ( xRun.ulAccepted < ulChange ) ||
+        ( ( xConfig.ulMaxP99Us > 0UL ) && ( ulP99 > xConfig.ulMaxP99Us ) ) )
+    {
+        lExit = 1;
+    }
+
+    ( void ) close( xMqttContext.lSocket );
+    free( xRun.pulLatencyUs );
+
+    return lExit;
+}
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+
+import argparse
+import heapq
+import json
+import random
+import socket
+import struct
+import threading
+import time
+
+HEADER = struct.Struct("<HI")
+
+
+class Link:
+    """
+    Answers of one connection: each goes out a round trip after the publish
+    it answers came in, no faster than the bandwidth allows.
+    """
+
+    def __init__(self, conn, args):
+        self.conn = conn
+        self.rtt = args.rtt_ms / 1000.0
+        self.jitter = args.jitter_ms / 1000.0
+        self.rate = args.bandwidth_kbps * 1000 / 8.0
+        self.queue = []
+        self.sequence = 0
+        self.lock = threading.Condition()
+        self.closed = False
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+
+    def send(self, data, rng):
+        with self.lock:
+            ready = time.monotonic() + self.rtt + (rng.uniform(0.0, self.jitter) if self.jitter > 0 else 0.0)
+            heapq.heappush(self.queue, (ready, self.sequence, data))
+            self.sequence += 1
+            self.lock.notify()
+
+    def close(self):
+        with self.lock:
+            self.closed = True
+            self.lock.notify()
+        self.thread.join()
+
+    def run(self):
+        free_at = 0.0
+        while True:
+            with self.lock:
+                while not self.queue and not self.closed:
+                    self.lock.wait()
+                if not self.queue:
+                    return
+                ready, _, data = self.queue[0]
+                delay = ready - time.monotonic()
+                if delay > 0:
+                    self.lock.wait(delay)
+                    continue
+                heapq.heappop(self.queue)
+            start = max(time.monotonic(), free_at)
+            free_at = start + (len(data) / self.rate if self.rate > 0 else 0.0)
+            delay = free_at - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+            try:
+                self.conn.sendall(data)
+            except OSError:
+                return
+
+
+class Shadow:
+    """
+    The reported section and version of one shadow, as the service keeps
+    them.
+    """
+
+    def __init__(self, version):
+        self.version = version
+        self.reported = {}
+        self.metadata = {}
+
+
+def frame(topic, payload):
+    topic = topic.encode()
+    payload = json.dumps(payload, separators=(",", ":")).encode()
+    return HEADER.pack(len(topic), len(payload)) + topic + payload
+
+
+def answer_get(shadows, prefix, args):
+    shadow = shadows.setdefault(prefix, Shadow(args.version))
+    now = int(time.time())
+    if shadow.version == 0:
+        return frame(prefix + "/get/rejected", {"code": 404, "message": "No shadow exists", "timestamp": now})
+    return frame(
+        prefix + "/get/accepted",
+        {
+            "state": {"reported": shadow.reported},
+            "metadata": {"reported": shadow.metadata},
+            "version": shadow.version,
+            "timestamp": now,
+        },
+    )
+
+
+def answer_update(shadows, prefix, payload, args, rng):
+    """
+    Apply a report. A conditional one is rejected if the version moved on,
+    which another writer does to a fraction of the reports.
+    """
+    shadow = shadows.setdefault(prefix, Shadow(args.version))
+    now = int(time.time())
+    document = json.loads(payload)
+    token = document.get("clientToken")
+    if args.conflict > 0 and rng.random() < args.conflict:
+        shadow.version += 1
+    if "version" in document and document["version"] != shadow.version:
+        body = {"code": 409, "message": "Version conflict", "timestamp": now}
+        if token is not None:
+            body["clientToken"] = token
+        return frame(prefix + "/update/rejected", body)
+    reported = document.get("state", {}).get("reported", {})
+    shadow.reported.update(reported)
+    shadow.metadata.update({key: {"timestamp": now} for key in reported})
+    shadow.version += 1
+    body = {
+        "state": {"reported": reported},
+        "metadata": {"reported": {key: {"timestamp": now} for key in reported}},
+        "version": shadow.version,
+        "timestamp": now,
+    }
+    if token is not None:
+        body["clientToken"] = token
+    return frame(prefix + "/update/accepted", body)
+
+
+def receive(reader, length):
+    data = reader.read(length)
+    if len(data) != length:
+        raise EOFError("connection closed")
+    return data
+
+
+def handle(conn, shadows, lock, args, rng):
+    reader = conn.makefile("rb")
+    link = Link(conn, args)
+    try:
+        while True:
+            topic_length, payload_length = HEADER.unpack(receive(reader, HEADER.size))
+            topic = receive(reader, topic_length).decode()
+            payload = receive(reader, payload_length)
+            with lock:
+                if topic.endswith("/get"):
+                    answer = answer_get(shadows, topic[: -len("/get")], args)
+                elif topic.endswith("/update"):
+                    answer = answer_update(shadows, topic[: -len("/update")], payload, args, rng)
+                else:
+                    print("No answer on {}.".format(topic))
+                    continue
+                lost = args.loss > 0 and rng.random() < args.loss
+            if not lost:
+                link.send(answer, rng)
+    except EOFError:
+        pass
+    except (OSError, ValueError) as error:
+        print("Connection dropped: {}".format(error))
+    finally:
+        link.close()
+        conn.close()
+
+
+def main():
+    """
+    Answer the shadow requests of shadow_host_bench as the shadow service
+    does.
+    """
+    parser = argparse.ArgumentParser(description="Device shadow stand-in. See README.md")
+    parser.add_argument("--port", action="store", type=int, default=8883, dest="port", help="Port to listen on.")
+    parser.add_argument("--rtt-ms", action="store", type=float, default=0.0, dest="rtt_ms", help="Round trip time.")
+    parser.add_argument(
+        "--jitter-ms", action="store", type=float, default=0.0, dest="jitter_ms", help="Most the round trip varies by."
+    )
+    parser.add_argument(
+        "--bandwidth-kbps", action="store", type=float, default=0.0, dest="bandwidth_kbps", help="Link rate, 0 for no limit."
+    )
+    parser.add_argument("--loss", action="store", type=float, default=0.0, dest="loss", help="Fraction of answers lost.")
+    parser.add_argument(
+        "--conflict", action="store", type=float, default=0.0, dest="conflict", help="Fraction of reports another writer races."
+    )
+    parser.add_argument(
+        "--version", action="store", type=int, default=1, dest="version", help="Version of the shadows at start, 0 for none."
+    )
+    parser.add_argument("--seed", action="store", type=int, default=1, dest="seed", help="Seed of the losses.")
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    shadows = {}
+    lock = threading.Lock()
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(("127.0.0.1", args.port))
+    server.listen(4)
+    print("Answering shadow requests on port {}.".format(args.port))
+
+    while True:
+        conn, _ = server.accept()
+        conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        threading.Thread(target=handle, args=(conn, shadows, lock, args, rng), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()
@@ -36,6 +36,29 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <ti/devices/cc32xx/inc/hw_types.h>
 #include <ti/devices/cc32xx/driverlib/prcm.h>
 
+#include <stddef.h>
+#include <string.h>
+
+/* Adaptive block-request window, fed with every block written. */
+#include "ota_window.h"
+
+/* HTTP data path, offered the file when its job gives a URL. */
+#include "ota_http.h"
+
+/* Delta images, rebuilt against the running image when they are closed. */
+#include "ota_delta.h"
+
+/* Compressed images, decompressed as they come in. */
+#include "ota_lzss.h"
+
+/* The write, certificate and build buffers are borrowed from the shared pool. */
+#include "buffer_pool.h"
+
+/* mbedTLS includes, to check the signature over the image as it comes in. */
+#include "mbedtls/sha1.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/rsa.h"
+
 /* Specify the OTA signature algorithm we support on this platform. */
 const char cOTA_JSON_FileSignatureKey[ OTA_FILE_SIG_KEY_STR_MAX_LENGTH ] = "sig-sha1-rsa";
 
@@ -47,6 +70,23 @@ const char cOTA_JSON_FileSignatureKey[ OTA_FILE_SIG_KEY_STR_MAX_LENGTH ] = "sig-
 #define OTA_WDT_TIMEOUT             (16UL / 2UL)                    /* Use a 16 second watchdog timer. /2 for 2x factor from system clock. */
 #define CC3220_WDT_START_KEY        0xAE42DB15UL                    /* TI Simplelink watchdog timer start key. */
 #define CC3220_WDT_CLOCK_HZ         80000000UL                      /* The TI Simplelink watchdog clock source runs at 80MHz. */
+#define OTA_WRITE_BEHIND_SIZE       2048UL                          /* Two pool buffers; blocks are written in runs of up to this. */
+#define OTA_MAX_CERT_SIZE           2047UL                          /* Largest signer certificate read to check the signature; two pool buffers with the terminator. */
+#define OTA_CHUNK_SIZE              16384UL                         /* Bytes of the file received into each chunk file; a whole number of write-behind runs. */
+#define OTA_MAX_CHUNKS              ( OTA_MAX_MCU_IMAGE_SIZE / OTA_CHUNK_SIZE ) /* Chunks of the largest file; one bit each in the resume record. */
+#define OTA_OPEN_CHUNKS             2UL                             /* Chunk files written at once, for blocks out of order across a chunk boundary. */
+#define OTA_CHUNK_FILE_PREFIX       "ota_chunk_"                    /* A chunk file is named by this and the two digits of its number. */
+#define OTA_CHUNK_NAME_SIZE         ( sizeof( OTA_CHUNK_FILE_PREFIX ) + 2U ) /* The prefix, two digits and the terminator. */
+#define OTA_RESUME_FILE             "ota_resume"                    /* The file being received and the chunks of it committed. */
+#define OTA_RESUME_MAGIC            0x4F544152UL                    /* Marks a resume record of this layout. */
+#define OTA_RX_HANDLE               ( ( int32_t ) 0x7FFFFFFFL )     /* Held in the file context for the chunk files while the file is received. */
+#define OTA_BUILD_READ_SIZE         512UL                           /* Bytes of a delta or compressed file read per sl_FsRead; one medium pool buffer. */
+#define OTA_BUILD_ERROR             ( -1L )                         /* The image could not be built from the chunk files. */
+#define OTA_RUNNING_IMAGE_ADDRESS   0x01000000UL                    /* The MCU image is copied to the start of the on-chip flash at boot. */
+#define OTA_IMAGE_CREATE_FLAGS  ( SL_FS_CREATE | SL_FS_OVERWRITE | SL_FS_CREATE_FAILSAFE | \
+                                  SL_FS_CREATE_PUBLIC_WRITE | SL_FS_WRITE_BUNDLE_FILE | \
+                                  SL_FS_CREATE_SECURE | SL_FS_CREATE_VENDOR_TOKEN | \
+                                  SL_FS_CREATE_MAX_SIZE( OTA_MAX_MCU_IMAGE_SIZE ) )
 #define OTA_FW_FILE_CHECK_FLAGS ( ( uint32_t ) SL_FS_INFO_SYS_FILE | \
                                   ( uint32_t )  SL_FS_INFO_SECURE | \
                                   ( uint32_t )  SL_FS_INFO_NOSIGNATURE | \
@@ -67,10 +107,125 @@ typedef struct
   uint32_t ulStartWdtTime;
 } sBootInfo_t;
 
+/* Consecutive blocks collected for one sl_FsWrite. Blocks arrive mostly in
+ * order, so a run of them is written with one call instead of a block at a
+ * time. A run never crosses a chunk, since a chunk is a whole number of
+ * runs. */
+typedef struct
+{
+    uint8_t * pucBuffer;  /* OTA_WRITE_BEHIND_SIZE bytes from the pool; NULL to write through. */
+    int32_t lFileHandle;  /* The chunk file the run belongs to; 0 for none. */
+    uint32_t ulBase;      /* File offset of the start of that chunk. */
+    uint32_t ulOffset;    /* File offset of the first byte held. */
+    uint32_t ulLength;    /* Bytes held. */
+    bool xWanted;         /* A buffer is taken with the first block of the file. */
+} sWriteBehind_t;
+
+static sWriteBehind_t xWriteBehind = { NULL, 0L, 0UL, 0UL, 0UL, false };
+
+/* A chunk file being written. SimpleLink rewrites a file opened for write,
+ * so each chunk is written in one open and committed by the close once its
+ * last block is in. */
+typedef struct
+{
+    int32_t lFileHandle;  /* 0 for a free slot. */
+    uint32_t ulChunk;
+    uint32_t ulStart;     /* File offset it holds the file from: the start of the chunk, or the next byte to decompress if that was inside it. */
+    uint32_t ulBlocksLeft;
+} sChunk_t;
+
+static sChunk_t xChunks[ OTA_OPEN_CHUNKS ];
+
+/* The file being received and the chunks of it committed, kept in
+ * OTA_RESUME_FILE so a download cut short by a reset goes on from them. */
+typedef struct
+{
+    uint32_t ulMagic;
+    uint32_t ulFileSize;
+    uint32_t ulFileAttributes;
+    uint32_t ulServerFileID;
+    uint8_t ucJobDigest[ 20 ];  /* SHA-1 of the job name and the signature. */
+    uint32_t ulChunks;          /* Bit n is set once chunk n is committed; OTA_MAX_CHUNKS is 32. */
+} sResume_t;
+
+static sResume_t xResume;
+
+/* SHA-1 over the image as it is written to the bundle file, which is the
+ * digest the sig-sha1-rsa signature covers. */
+typedef struct
+{
+    mbedtls_sha1_context xContext;
+    uint32_t ulHashed;                              /* Bytes hashed, from the start of the image. */
+    uint32_t ulImageSize;                           /* Bytes the image has; the file size unless it is built from a patch. */
+    bool xValid;                                    /* False once a part could not be hashed in order. */
+} sDigest_t;
+
+static sDigest_t xDigest;
+
+/* The chunk file being read and the image file built from the chunks. */
+typedef struct
+{
+    int32_t lChunkHandle;   /* 0 while no chunk file is open. */
+    uint32_t ulChunk;
+    uint32_t ulFileSize;
+    int32_t lImageHandle;
+} sBuildFiles_t;
+
+/* A compressed image decompressed into the bundle file as its blocks come
+ * in order, so the image is written to flash once and the file is not.
+ * Blocks ahead of the next one to decompress go to chunk files as those of
+ * any file do, and are decompressed from there once the blocks before them
+ * are in. The write-behind buffer is taken over for the output, so chunk
+ * files are then written a block at a time. */
+typedef struct
+{
+    OtaLzssDecoder_t xDecoder;
+    sBuildFiles_t xFiles;   /* The chunk file read and the bundle file written. */
+    uint8_t * pucOutput;    /* The write-behind buffer. */
+    uint8_t * pucWindow;
+    uint32_t ulNext;        /* File offset of the next byte to decompress. */
+    uint32_t ulPartChunks;  /* Bit n is set once chunk n is committed holding only the part from its ulStart. */
+    bool xWanted;           /* The file is compressed and its header not seen yet. */
+    bool xActive;           /* The image is decompressed as the blocks come. */
+} sInflate_t;
+
+static sInflate_t xInflate;
+
 /* Private functions. */
 static void prvRollbackBundle( void );                              /* Call the TI CC3220SF bundle rollback API. */
 static void prvRollbackRxFile( OTA_FileContext_t *C );              /* Call the TI CC3220SF file rollback API. */
 static int32_t prvCreateBootInfoFile( void );                       /* Create the CC3220SF boot info file. */
+static int32_t prvWriteToFile( int32_t lFileHandle, uint32_t ulOffset, uint8_t * pucData, uint32_t ulSize ); /* sl_FsWrite with retries. */
+static int32_t prvFlushWriteBehind( void );                         /* Write out the blocks held, if any. */
+static void prvStartWriteBehind( void );                            /* Write the file just created through a buffer. */
+static void prvTakeWriteBehind( void );                             /* Take the buffer for the file being written. */
+static int32_t prvStopWriteBehind( void );                          /* Flush and give the buffer back. */
+static void prvChunkName( uint32_t ulChunk, _u8 * pucName );        /* Name of a chunk file. */
+static uint32_t prvChunkLength( const OTA_FileContext_t *C, uint32_t ulChunk ); /* Bytes of the file in a chunk. */
+static void prvMarkBlocks( OTA_FileContext_t *C, uint32_t ulOffset, uint32_t ulLength, bool xReceived ); /* Mark the blocks of a part of the file received, or missing again. */
+static sChunk_t * prvFindChunk( uint32_t ulChunk );                  /* The slot a chunk file is open in, if it is. */
+static sChunk_t * prvGetChunk( OTA_FileContext_t *C, uint32_t ulChunk ); /* The chunk file a block goes to, created if need be. */
+static void prvDropChunk( OTA_FileContext_t *C, sChunk_t *pxChunk ); /* Throw away a chunk not complete and ask for its blocks again. */
+static int32_t prvCommitChunk( sChunk_t *pxChunk );                 /* Close a complete chunk and record it. */
+static void prvLoadResume( OTA_FileContext_t *C );                  /* Go on from the chunks committed before a reset. */
+static void prvSaveResume( void );                                  /* Write the resume record. */
+static void prvDeleteChunks( void );                                /* Delete the chunk files and the resume record. */
+static int32_t prvCreateImageFile( OTA_FileContext_t *C );          /* Create the bundle file the image goes into. */
+static void prvStartDigest( uint32_t ulImageSize );                 /* Start hashing the image just created. */
+static void prvStopDigest( void );                                  /* Give the digest state back. */
+static void prvDigestBlock( uint32_t ulOffset, const uint8_t * pucData, uint32_t ulSize ); /* Hash the next part of the image. */
+static int32_t prvCheckDigest( const OTA_FileContext_t *C );        /* Check the signature against the digest. */
+static bool prvIsDelta( const OTA_FileContext_t *C );               /* Whether the file is a patch to the running image. */
+static bool prvIsCompressed( const OTA_FileContext_t *C );          /* Whether the file is a compressed image. */
+static int32_t prvBuildImage( OTA_FileContext_t *C );               /* Build the image from the chunk files received. */
+static int32_t prvChunkRead( void * pvContext, uint32_t ulOffset, uint8_t * pucBuffer, uint32_t ulLength );        /* Read the file received. */
+static int32_t prvImageWrite( void * pvContext, uint32_t ulOffset, const uint8_t * pucData, uint32_t ulLength ); /* Hash and write the image. */
+static int32_t prvStartInflate( OTA_FileContext_t *C, uint32_t ulOffset, const uint8_t * pucData ); /* Start decompressing a compressed image as it comes. */
+static void prvStopInflate( void );                                 /* Throw away the image being decompressed and give its buffers back. */
+static int32_t prvInflate( const uint8_t * pucData, uint32_t ulLength ); /* Decompress the next part of the file. */
+static int32_t prvInflateStaged( void );                            /* Decompress the committed chunks the next byte has reached. */
+static int32_t prvFinishInflate( OTA_FileContext_t *C );            /* Decompress the rest and check the image is whole. */
+static int32_t prvStageBlock( OTA_FileContext_t *C, uint32_t ulOffset, uint8_t * pcData, uint32_t ulBlockSize ); /* Write a block to its chunk file. */
 
 
 static void prvRollbackBundle( void )
@@ -135,15 +290,26 @@ OTA_Err_t prvPAL_Abort(OTA_FileContext_t *C)
     /* Use this signature to abort a file transfer on the TI CC3220SF platform. */
     static _u8 pcTI_AbortSig[] = "A";
 
-	int32_t lResult;
+	int32_t lResult = 0;
     /* Calling this function with a NULL file handle is not an error. */
 	OTA_Err_t xReturnCode = kOTA_Err_None;
 
     /* Check for null file handle since the agent may legitimately call this before a file is opened. */
 	if (C->lFileHandle != ( int32_t ) NULL)
 	{
-		lResult = sl_FsClose( C->lFileHandle, ( _u8* ) NULL, ( _u8* ) pcTI_AbortSig, CONST_STRLEN( pcTI_AbortSig ) );
+	    /* The file is thrown away with the chunks it was received into. */
+	    OtaHttp_WithdrawFile();
+	    xWriteBehind.ulLength = 0UL;
+	    ( void ) prvStopWriteBehind();
+	    prvStopInflate();
+	    prvStopDigest();
+	    if ( C->lFileHandle != OTA_RX_HANDLE )
+	    {
+	        /* The image file, open while the image is built on close. */
+	        lResult = sl_FsClose( C->lFileHandle, ( _u8* ) NULL, ( _u8* ) pcTI_AbortSig, CONST_STRLEN( pcTI_AbortSig ) );
+	    }
 		C->lFileHandle = ( int32_t ) NULL;
+		prvDeleteChunks();
 		if ( lResult != 0 )
 		{
 			xReturnCode = ( uint32_t ) kOTA_Err_FileAbort | ( ( ( uint32_t ) lResult ) & ( uint32_t ) kOTA_PAL_ErrMask);
@@ -168,9 +334,7 @@ OTA_Err_t prvPAL_CreateFileForRx(OTA_FileContext_t *C)
 {
     DEFINE_OTA_METHOD_NAME("prvPAL_CreateFileForRx");
 
-    _u32        ulToken = OTA_VENDOR_TOKEN;     /* TI platform requires file tokens. We use a vendor token. */
-    uint32_t    ulFlags;                        /* Flags used when opening the OTA FW image file. */
-    int32_t     lResult, lRetry;
+    int32_t     lResult;
     OTA_Err_t   xReturnCode = kOTA_Err_Uninitialized;
 
     C->lFileHandle = ( int32_t ) NULL;
@@ -180,46 +344,24 @@ OTA_Err_t prvPAL_CreateFileForRx(OTA_FileContext_t *C)
         /* prvCreateBootInfoFile returns the number of bytes written or negative error. 0 is not allowed. */
         if ( lResult > 0 )
         {
-            lRetry = 0;
-            do {
-                ulFlags = ( SL_FS_CREATE | SL_FS_OVERWRITE | SL_FS_CREATE_FAILSAFE | /*lint -e9027 -e9028 -e9029 We don't own the TI problematic macros. */
-                          SL_FS_CREATE_PUBLIC_WRITE | SL_FS_WRITE_BUNDLE_FILE |
-                          SL_FS_CREATE_SECURE | SL_FS_CREATE_VENDOR_TOKEN |
-                          SL_FS_CREATE_MAX_SIZE( OTA_MAX_MCU_IMAGE_SIZE ) );
-                /* The file remains open until the OTA agent calls prvPAL_CloseFile() after transfer or failure. */
-                lResult = sl_FsOpen( ( _u8* ) C->pucFilePath, ( _u32 ) ulFlags, ( _u32* ) &ulToken );
-                if ( lResult > 0 )
-                {
-                    OTA_LOG_L1("[%s] Receive file created. Token: %u\r\n", OTA_METHOD_NAME, ulToken);
-                    C->lFileHandle = lResult;
-                    xReturnCode = kOTA_Err_None;
-                }
-                else {
-                    OTA_LOG_L1("[%s] Error (%d) trying to create receive file.\r\n", OTA_METHOD_NAME, lResult);
-                    if ( lResult == SL_ERROR_FS_FILE_IS_ALREADY_OPENED )
-                    {
-                        #ifndef FREERTOS_ENABLE_UNIT_TESTS
-                        /* System is in an inconsistent state and must be rebooted. */
-                        if ( prvPAL_ResetDevice() != kOTA_Err_None )
-                        {
-                            OTA_LOG_L1("[%s] Failed to reset the device via software.\r\n", OTA_METHOD_NAME );
-                        }
-                        #endif
-                    }
-                    else if ( lResult == SL_ERROR_FS_FILE_IS_PENDING_COMMIT )
-                    {
-                        /* Attempt to roll back the receive file and try again. */
-                        prvRollbackRxFile( C );
-                    }
-                    else
-                    {
-                        /* Attempt to roll back the bundle and try again. */
-                        prvRollbackBundle( );
-                    }
-                    lRetry++;
-                    xReturnCode = ( uint32_t ) kOTA_Err_RxFileCreateFailed | ( ( ( uint32_t ) lResult ) & ( uint32_t ) kOTA_PAL_ErrMask);
-                }
-            } while ( ( xReturnCode != kOTA_Err_None ) && ( lRetry <= ( int32_t ) OTA_MAX_CREATE_RETRIES ) );
+            /* The file is received into chunk files, each committed once its
+             * blocks are in, and the image is built from them on close.
+             * SimpleLink rewrites a file opened for write and drops the
+             * uncommitted content of a failsafe file at a reset, so only
+             * committed chunks outlive one; a download cut short by a reset
+             * goes on from them. The chunk files stay open until the OTA
+             * agent calls prvPAL_CloseFile() after transfer or failure. */
+            prvStopInflate();
+            prvLoadResume( C );
+            C->lFileHandle = OTA_RX_HANDLE;
+            prvStartWriteBehind();
+            prvStopDigest();
+            xInflate.xWanted = prvIsCompressed( C );
+            xInflate.xFiles.ulFileSize = C->ulFileSize;
+            OtaWindow_Start();
+            OTA_LOG_L1("[%s] Receive file created; %u blocks to receive.\r\n", OTA_METHOD_NAME, C->ulBlocksRemaining);
+            xReturnCode = kOTA_Err_None;
+            OtaHttp_OfferFile( C );
         }
         else
         {
@@ -237,6 +379,54 @@ OTA_Err_t prvPAL_CreateFileForRx(OTA_FileContext_t *C)
 }
 
 
+/* Create the bundle file the image goes into. A file left open or pending
+ * by an earlier update is rolled back and the create tried again.
+ * Returns the file handle or a negative error code. */
+
+static int32_t prvCreateImageFile( OTA_FileContext_t *C )
+{
+    DEFINE_OTA_METHOD_NAME("prvCreateImageFile");
+
+    _u32        ulToken = OTA_VENDOR_TOKEN;     /* TI platform requires file tokens. We use a vendor token. */
+    int32_t     lResult = SL_ERROR_FS_FILE_NOT_EXISTS;
+    int32_t     lRetry;
+
+    for ( lRetry = 0; ( lResult <= 0 ) && ( lRetry <= ( int32_t ) OTA_MAX_CREATE_RETRIES ); lRetry++ )
+    {
+        lResult = sl_FsOpen( ( _u8* ) C->pucFilePath, ( _u32 ) OTA_IMAGE_CREATE_FLAGS, ( _u32* ) &ulToken ); /*lint -e9027 -e9028 -e9029 We don't own the TI problematic macros. */
+        if ( lResult > 0 )
+        {
+            OTA_LOG_L1("[%s] Image file created. Token: %u\r\n", OTA_METHOD_NAME, ulToken);
+        }
+        else
+        {
+            OTA_LOG_L1("[%s] Error (%d) trying to create image file.\r\n", OTA_METHOD_NAME, lResult);
+            if ( lResult == SL_ERROR_FS_FILE_IS_ALREADY_OPENED )
+            {
+                #ifndef FREERTOS_ENABLE_UNIT_TESTS
+                /* System is in an inconsistent state and must be rebooted. */
+                if ( prvPAL_ResetDevice() != kOTA_Err_None )
+                {
+                    OTA_LOG_L1("[%s] Failed to reset the device via software.\r\n", OTA_METHOD_NAME );
+                }
+                #endif
+            }
+            else if ( lResult == SL_ERROR_FS_FILE_IS_PENDING_COMMIT )
+            {
+                /* Attempt to roll back the receive file and try again. */
+                prvRollbackRxFile( C );
+            }
+            else
+            {
+                /* Attempt to roll back the bundle and try again. */
+                prvRollbackBundle( );
+            }
+        }
+    }
+    return lResult;
+}
+
+
 /* Create the required system mcubootinfo.bin file to configure the system watchdog timer. */
 
 static int32_t prvCreateBootInfoFile( void )
@@ -299,10 +489,43 @@ OTA_Err_t prvPAL_CloseFile( OTA_FileContext_t *C )
 
 	int32_t lResult;
     OTA_Err_t xReturnCode = kOTA_Err_Uninitialized;
+    TickType_t xStartTicks = xTaskGetTickCount();
+
+    OtaHttp_WithdrawFile();
 
-	/* Let SimpleLink API handle error checks so we get an error code for free. */
-	OTA_LOG_L1( "[%s] Authenticating and closing file.\r\n", OTA_METHOD_NAME );
-	lResult = ( int32_t ) sl_FsClose( ( _i32 ) ( C->lFileHandle ), C->pucCertFilepath, C->pxSignature->ucData, ( _u32 ) ( C->pxSignature->usSize ) );
+    /* Every chunk was committed with its last block, so nothing should be
+     * left in RAM. The image is built from the chunks into the bundle file,
+     * or a compressed one finished from what is left of them. */
+    lResult = prvStopWriteBehind();
+    if ( lResult == 0 )
+    {
+        lResult = ( xInflate.xActive == true ) ? prvFinishInflate( C ) : prvBuildImage( C );
+        prvStopInflate();
+    }
+    if ( lResult < 0 )
+    {
+        OTA_LOG_L1( "[%s] Error (%d) writing the image.\r\n", OTA_METHOD_NAME, lResult );
+        ( void ) prvPAL_Abort( C );
+    }
+    else if ( prvCheckDigest( C ) < 0 )
+    {
+        /* The image received does not match its signature, so the file is not
+         * read back by the network processor only to find out again. */
+        OTA_LOG_L1( "[%s] Signature does not match the image received.\r\n", OTA_METHOD_NAME );
+        ( void ) prvPAL_Abort( C );
+        lResult = SL_ERROR_FS_WRONG_SIGNATURE_SECURITY_ALERT;
+    }
+    else
+    {
+	    /* Let SimpleLink API handle error checks so we get an error code for free.
+	     * The network processor checks the signature even when it matched here. */
+	    OTA_LOG_L1( "[%s] Authenticating and closing file.\r\n", OTA_METHOD_NAME );
+	    lResult = ( int32_t ) sl_FsClose( ( _i32 ) ( C->lFileHandle ), C->pucCertFilepath, C->pxSignature->ucData, ( _u32 ) ( C->pxSignature->usSize ) );
+	    C->lFileHandle = ( int32_t ) NULL;
+	    prvDeleteChunks();
+    }
+    prvStopDigest();
+    OTA_LOG_L1( "[%s] Close took %u ms.\r\n", OTA_METHOD_NAME, ( uint32_t ) ( ( xTaskGetTickCount() - xStartTicks ) * portTICK_PERIOD_MS ) );
 
 	switch ( lResult )
 	{
@@ -494,50 +717,1177 @@ OTA_PAL_ImageState_t prvPAL_GetPlatformImageState ( void )
     return eState;
 }
 
-#ifdef FREERTOS_ENABLE_UNIT_TESTS
-#include "aws_ota_pal_test_access_define.h"
-#endif
 
-/* Write a block of data to the specified file.
- * Returns the most recent number of bytes written upon success or a negative error code.
- */
-int16_t prvPAL_WriteBlock( OTA_FileContext_t * const C, uint32_t ulOffset, uint8_t * const pcData, uint32_t ulBlockSize )
+/* Start hashing the image just created. */
+
+static void prvStartDigest( uint32_t ulImageSize )
 {
-    DEFINE_OTA_METHOD_NAME("prvPAL_WriteBlock");
+    prvStopDigest();
+    mbedtls_sha1_init( &xDigest.xContext );
+    xDigest.xValid = ( mbedtls_sha1_starts_ret( &xDigest.xContext ) == 0 );
+    xDigest.ulHashed = 0UL;
+    xDigest.ulImageSize = ulImageSize;
+}
 
-	int32_t lResult;
-	uint32_t ulWritten = 0;
-	uint32_t ulRetry;
-	int16_t lReturnVal = 0;
 
-	for ( ulRetry = 0UL; ulRetry <= OTA_MAX_PAL_WRITE_RETRIES; ulRetry++ )
-	{
-		lResult = sl_FsWrite( C->lFileHandle, ulOffset + ulWritten, &pcData[ ulWritten ], ulBlockSize );
-		if ( lResult >= 0 )
-		{
-		    if ( ulBlockSize == ( uint32_t) lResult )   /* If we wrote all of the bytes requested, we're done. */
-		    {
-		        break;
-		    }
-		    else
-		    {
-		        ulWritten += ( uint32_t) lResult;       /* Add to total bytes written counter. */
-                ulBlockSize -= ( uint32_t) lResult;     /* Reduce block size by amount just written. */
-		    }
-		}
-		else
-		{
-		    /* Nothing to do but retry. */
-		}
-	}
-    if ( ulRetry > OTA_MAX_PAL_WRITE_RETRIES )
+/* Give the digest state back. */
+
+static void prvStopDigest( void )
+{
+    if ( xDigest.xValid == true )
+    {
+        mbedtls_sha1_free( &xDigest.xContext );
+        xDigest.xValid = false;
+    }
+}
+
+
+/* Hash the next part of the image. The image is built in order; a part out
+ * of order ends the digest, and the signature is only checked when the file
+ * is closed. */
+
+static void prvDigestBlock( uint32_t ulOffset, const uint8_t * pucData, uint32_t ulSize )
+{
+    DEFINE_OTA_METHOD_NAME("prvDigestBlock");
+
+    if ( ( xDigest.xValid == true ) && ( ulOffset == xDigest.ulHashed ) )
+    {
+        xDigest.xValid = ( mbedtls_sha1_update_ret( &xDigest.xContext, pucData, ulSize ) == 0 );
+        xDigest.ulHashed += ulSize;
+    }
+    else if ( xDigest.xValid == true )
+    {
+        OTA_LOG_L1("[%s] Part at %u is out of order.\r\n", OTA_METHOD_NAME, ulOffset);
+        prvStopDigest();
+    }
+    else
+    {
+        /* No digest. */
+    }
+}
+
+
+/* Check the signature of the file against the digest of what was received.
+ * Returns 0 if it matches, 1 if it could not be checked here, and a negative
+ * mbedTLS error code if it does not match. */
+
+static int32_t prvCheckDigest( const OTA_FileContext_t *C )
+{
+    DEFINE_OTA_METHOD_NAME("prvCheckDigest");
+
+    uint8_t ucHash[ 20 ];
+    uint8_t *pucCert = NULL;
+    mbedtls_x509_crt xCert;
+    int32_t lFileHandle;
+    int32_t lLength = 0;
+    int32_t lResult = 1;
+
+    if ( ( xDigest.xValid == true ) && ( xDigest.ulHashed == xDigest.ulImageSize ) &&
+         ( mbedtls_sha1_finish_ret( &xDigest.xContext, ucHash ) == 0 ) )
+    {
+        /* The signer certificate is a plain file; one more byte terminates a PEM one. */
+        pucCert = ( uint8_t * ) BufferPool_Acquire( OTA_MAX_CERT_SIZE + 1UL );
+        lFileHandle = sl_FsOpen( C->pucCertFilepath, SL_FS_READ, NULL );
+        if ( ( pucCert != NULL ) && ( lFileHandle >= 0 ) )
+        {
+            lLength = sl_FsRead( lFileHandle, 0UL, pucCert, OTA_MAX_CERT_SIZE );
+        }
+        if ( lFileHandle >= 0 )
+        {
+            ( void ) sl_FsClose( lFileHandle, ( _u8* ) NULL, ( _u8* ) NULL, 0UL );
+        }
+
+        if ( lLength > 0 )
+        {
+            if ( pucCert[ 0 ] == ( uint8_t ) '-' )
+            {
+                pucCert[ lLength ] = 0U;
+                lLength++;
+            }
+            mbedtls_x509_crt_init( &xCert );
+            if ( mbedtls_x509_crt_parse( &xCert, pucCert, ( size_t ) lLength ) == 0 )
+            {
+                lResult = mbedtls_pk_verify( &xCert.pk, MBEDTLS_MD_SHA1, ucHash, sizeof( ucHash ),
+                                             C->pxSignature->ucData, ( size_t ) C->pxSignature->usSize );
+                /* Only a signature that does not verify rejects the image; any
+                 * other error leaves the check to the network processor. */
+                if ( ( lResult != 0 ) && ( lResult != MBEDTLS_ERR_RSA_VERIFY_FAILED ) )
+                {
+                    OTA_LOG_L1("[%s] Error (%d) checking the signature.\r\n", OTA_METHOD_NAME, lResult);
+                    lResult = 1;
+                }
+            }
+            mbedtls_x509_crt_free( &xCert );
+        }
+        else
+        {
+            OTA_LOG_L1("[%s] Error (%d) reading the signer certificate.\r\n", OTA_METHOD_NAME, lLength);
+        }
+        BufferPool_Release( pucCert );
+    }
+    return lResult;
+}
+
+/* Whether the file is a patch to the running image, which the job marks in
+ * the file attributes. */
+
+static bool prvIsDelta( const OTA_FileContext_t *C )
+{
+    return ( C->ulFileAttributes & otadeltaFILE_ATTRIBUTE ) != 0UL;
+}
+
+
+/* Whether the file is a compressed image, which the job marks in the file
+ * attributes. */
+
+static bool prvIsCompressed( const OTA_FileContext_t *C )
+{
+    return ( C->ulFileAttributes & otalzssFILE_ATTRIBUTE ) != 0UL;
+}
+
+
+/* Build the image from the chunk files received, into the bundle file. A
+ * plain image is copied; a patch is applied to the running image, read in
+ * place from flash, which must be the one the patch was made from; a
+ * compressed image that could not be decompressed as it came, for want of
+ * a buffer, is decompressed. Either way the image is hashed as it is
+ * written, so its signature is checked the same way for all three.
+ * Returns 0, with C->lFileHandle the bundle file, or a negative error code. */
+
+static int32_t prvBuildImage( OTA_FileContext_t *C )
+{
+    DEFINE_OTA_METHOD_NAME("prvBuildImage");
+
+    uint8_t ucHeader[ otadeltaHEADER_SIZE ];
+    uint8_t ucRunningDigest[ otadeltaDIGEST_SIZE ];
+    OtaDeltaHeader_t xDeltaHeader;
+    OtaDeltaParams_t xDeltaParams;
+    OtaLzssHeader_t xLzssHeader;
+    OtaLzssParams_t xLzssParams;
+    sBuildFiles_t xFiles = { 0L, 0UL, 0UL, 0L };
+    uint8_t *pucInput = NULL;
+    uint8_t *pucOutput;
+    uint8_t *pucWindow = NULL;
+    uint32_t ulChunks = ( C->ulFileSize + OTA_CHUNK_SIZE - 1UL ) / OTA_CHUNK_SIZE;
+    uint32_t ulAllChunks = ( ulChunks >= 32UL ) ? 0xFFFFFFFFUL : ( ( 1UL << ulChunks ) - 1UL );
+    uint32_t ulImageSize = C->ulFileSize;
+    uint32_t ulBuiltSize = 0UL;
+    uint32_t ulLength;
+    uint32_t ulSlot;
+    int32_t lStatus = 0;
+    int32_t lResult = 0;
+    TickType_t xStartTicks = xTaskGetTickCount();
+
+    xFiles.ulFileSize = C->ulFileSize;
+
+    /* A chunk still open lost blocks the agent counted as written. */
+    for ( ulSlot = 0UL; ulSlot < OTA_OPEN_CHUNKS; ulSlot++ )
+    {
+        if ( xChunks[ ulSlot ].lFileHandle != 0 )
+        {
+            lResult = OTA_BUILD_ERROR;
+        }
+    }
+    if ( ( lResult != 0 ) || ( ( xResume.ulChunks & ulAllChunks ) != ulAllChunks ) )
+    {
+        OTA_LOG_L1( "[%s] The file received is not complete.\r\n", OTA_METHOD_NAME );
+        lResult = OTA_BUILD_ERROR;
+    }
+    else if ( prvIsDelta( C ) == true )
+    {
+        /* Only as much of the header as the file has; the parser checks it is enough. */
+        lResult = prvChunkRead( &xFiles, 0UL, ucHeader, ( uint32_t ) sizeof( ucHeader ) );
+        if ( ( lResult < 0 ) ||
+             ( OtaDelta_ParseHeader( ucHeader, ( uint32_t ) lResult, &xDeltaHeader ) != eOtaDeltaSuccess ) ||
+             ( xDeltaHeader.ulOldSize > OTA_MAX_MCU_IMAGE_SIZE ) || ( xDeltaHeader.ulNewSize > OTA_MAX_MCU_IMAGE_SIZE ) )
+        {
+            OTA_LOG_L1( "[%s] The file is not a delta image.\r\n", OTA_METHOD_NAME );
+            lResult = OTA_BUILD_ERROR;
+        }
+        else if ( ( mbedtls_sha1_ret( ( const uint8_t * ) OTA_RUNNING_IMAGE_ADDRESS, xDeltaHeader.ulOldSize, ucRunningDigest ) != 0 ) ||
+                  ( memcmp( ucRunningDigest, xDeltaHeader.ucOldDigest, sizeof( ucRunningDigest ) ) != 0 ) )
+        {
+            OTA_LOG_L1( "[%s] The patch was not made for the running image.\r\n", OTA_METHOD_NAME );
+            lResult = OTA_BUILD_ERROR;
+        }
+        else
+        {
+            ulImageSize = xDeltaHeader.ulNewSize;
+            lResult = 0;
+        }
+    }
+    else if ( prvIsCompressed( C ) == true )
+    {
+        lResult = prvChunkRead( &xFiles, 0UL, ucHeader, ( uint32_t ) sizeof( ucHeader ) );
+        if ( ( lResult < 0 ) ||
+             ( OtaLzss_ParseHeader( ucHeader, ( uint32_t ) lResult, &xLzssHeader ) != eOtaLzssSuccess ) ||
+             ( xLzssHeader.ulImageSize > OTA_MAX_MCU_IMAGE_SIZE ) )
+        {
+            OTA_LOG_L1( "[%s] The file is not a compressed image.\r\n", OTA_METHOD_NAME );
+            lResult = OTA_BUILD_ERROR;
+        }
+        else
+        {
+            ulImageSize = xLzssHeader.ulImageSize;
+            lResult = 0;
+        }
+    }
+    else
+    {
+        /* A plain image is the file itself. */
+    }
+
+    if ( lResult == 0 )
+    {
+        lResult = prvCreateImageFile( C );
+        if ( lResult > 0 )
+        {
+            C->lFileHandle = lResult;
+            xFiles.lImageHandle = lResult;
+            prvStartDigest( ulImageSize );
+
+            /* Whole runs out, as the write-behind buffer writes them. */
+            pucOutput = ( uint8_t * ) BufferPool_Acquire( OTA_WRITE_BEHIND_SIZE );
+
+            if ( prvIsDelta( C ) == true )
+            {
+                pucInput = ( uint8_t * ) BufferPool_Acquire( OTA_BUILD_READ_SIZE );
+                memset( &xDeltaParams, ( int ) 0, sizeof( xDeltaParams ) );
+                xDeltaParams.pucOld = ( const uint8_t * ) OTA_RUNNING_IMAGE_ADDRESS;
+                xDeltaParams.ulOldSize = xDeltaHeader.ulOldSize;
+                xDeltaParams.ulPatchSize = C->ulFileSize;
+                xDeltaParams.xRead = prvChunkRead;
+                xDeltaParams.xWrite = prvImageWrite;
+                xDeltaParams.pvContext = &xFiles;
+                xDeltaParams.pucInput = pucInput;
+                xDeltaParams.ulInputSize = OTA_BUILD_READ_SIZE;
+                xDeltaParams.pucOutput = pucOutput;
+                xDeltaParams.ulOutputSize = OTA_WRITE_BEHIND_SIZE;
+                lStatus = ( int32_t ) OtaDelta_Apply( &xDeltaParams, &ulBuiltSize );
+            }
+            else if ( prvIsCompressed( C ) == true )
+            {
+                /* The window is only as large as the stream asks for. */
+                pucInput = ( uint8_t * ) BufferPool_Acquire( OTA_BUILD_READ_SIZE );
+                pucWindow = ( uint8_t * ) pvPortMalloc( 1UL << xLzssHeader.ucWindowBits );
+                memset( &xLzssParams, ( int ) 0, sizeof( xLzssParams ) );
+                xLzssParams.ulPackedSize = C->ulFileSize;
+                xLzssParams.xRead = prvChunkRead;
+                xLzssParams.xWrite = prvImageWrite;
+                xLzssParams.pvContext = &xFiles;
+                xLzssParams.pucInput = pucInput;
+                xLzssParams.ulInputSize = OTA_BUILD_READ_SIZE;
+                xLzssParams.pucOutput = pucOutput;
+                xLzssParams.ulOutputSize = OTA_WRITE_BEHIND_SIZE;
+                xLzssParams.pucWindow = pucWindow;
+                xLzssParams.ulWindowSize = ( pucWindow != NULL ) ? ( 1UL << xLzssHeader.ucWindowBits ) : 0UL;
+                lStatus = ( int32_t ) OtaLzss_Decompress( &xLzssParams, &ulBuiltSize );
+                vPortFree( pucWindow );
+            }
+            else
+            {
+                lStatus = ( pucOutput != NULL ) ? 0 : OTA_BUILD_ERROR;
+                while ( ( lStatus == 0 ) && ( ulBuiltSize < ulImageSize ) )
+                {
+                    ulLength = ( ( ulImageSize - ulBuiltSize ) < OTA_WRITE_BEHIND_SIZE ) ? ( ulImageSize - ulBuiltSize ) : OTA_WRITE_BEHIND_SIZE;
+                    if ( ( prvChunkRead( &xFiles, ulBuiltSize, pucOutput, ulLength ) != ( int32_t ) ulLength ) ||
+                         ( prvImageWrite( &xFiles, ulBuiltSize, pucOutput, ulLength ) != ( int32_t ) ulLength ) )
+                    {
+                        lStatus = OTA_BUILD_ERROR;
+                    }
+                    else
+                    {
+                        ulBuiltSize += ulLength;
+                    }
+                }
+            }
+            BufferPool_Release( pucInput );
+            BufferPool_Release( pucOutput );
+
+            /* All report success as 0. */
+            if ( ( lStatus != 0 ) || ( ulBuiltSize != ulImageSize ) )
+            {
+                OTA_LOG_L1( "[%s] Error (%d) building the image at %u bytes.\r\n", OTA_METHOD_NAME, lStatus, ulBuiltSize );
+                lResult = OTA_BUILD_ERROR;
+            }
+            else
+            {
+                OTA_LOG_L1( "[%s] Built a %u byte image from a %u byte file in %u ms.\r\n", OTA_METHOD_NAME,
+                            ulBuiltSize, C->ulFileSize, ( uint32_t ) ( ( xTaskGetTickCount() - xStartTicks ) * portTICK_PERIOD_MS ) );
+                lResult = 0;
+            }
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] Error (%d) creating the image file.\r\n", OTA_METHOD_NAME, lResult );
+        }
+    }
+    if ( xFiles.lChunkHandle > 0 )
+    {
+        ( void ) sl_FsClose( xFiles.lChunkHandle, ( _u8* ) NULL, ( _u8* ) NULL, 0UL );
+    }
+    return lResult;
+}
+
+
+/* Read the file received from its chunk files, one open at a time.
+ * Returns the bytes read, fewer only at the end of the file, or a negative
+ * error code. */
+
+static int32_t prvChunkRead( void * pvContext, uint32_t ulOffset, uint8_t * pucBuffer, uint32_t ulLength )
+{
+    sBuildFiles_t * pxFiles = ( sBuildFiles_t * ) pvContext;
+    _u8 ucName[ OTA_CHUNK_NAME_SIZE ];
+    uint32_t ulRead = 0UL;
+    uint32_t ulChunk;
+    uint32_t ulPart;
+    int32_t lResult = 0;
+
+    if ( ulOffset >= pxFiles->ulFileSize )
+    {
+        ulLength = 0UL;
+    }
+    else if ( ulLength > ( pxFiles->ulFileSize - ulOffset ) )
+    {
+        ulLength = pxFiles->ulFileSize - ulOffset;
+    }
+    else
+    {
+        /* All of it is in the file. */
+    }
+
+    while ( ( lResult >= 0 ) && ( ulRead < ulLength ) )
+    {
+        ulChunk = ( ulOffset + ulRead ) / OTA_CHUNK_SIZE;
+        if ( ( pxFiles->lChunkHandle <= 0 ) || ( pxFiles->ulChunk != ulChunk ) )
+        {
+            if ( pxFiles->lChunkHandle > 0 )
+            {
+                ( void ) sl_FsClose( pxFiles->lChunkHandle, ( _u8* ) NULL, ( _u8* ) NULL, 0UL );
+            }
+            prvChunkName( ulChunk, ucName );
+            pxFiles->lChunkHandle = sl_FsOpen( ucName, SL_FS_READ, NULL );
+            pxFiles->ulChunk = ulChunk;
+            lResult = pxFiles->lChunkHandle;
+        }
+        if ( lResult >= 0 )
+        {
+            ulPart = OTA_CHUNK_SIZE - ( ( ulOffset + ulRead ) % OTA_CHUNK_SIZE );
+            ulPart = ( ulPart < ( ulLength - ulRead ) ) ? ulPart : ( ulLength - ulRead );
+            lResult = sl_FsRead( pxFiles->lChunkHandle, ( ulOffset + ulRead ) % OTA_CHUNK_SIZE, &pucBuffer[ ulRead ], ulPart );
+            if ( lResult == ( int32_t ) ulPart )
+            {
+                ulRead += ulPart;
+            }
+            else if ( lResult >= 0 )
+            {
+                /* A committed chunk is whole, so it was cut short. */
+                lResult = OTA_BUILD_ERROR;
+            }
+            else
+            {
+                /* The read error is returned. */
+            }
+        }
+    }
+    return ( lResult < 0 ) ? lResult : ( int32_t ) ulRead;
+}
+
+
+/* Hash and write a part of the image built from the chunk files. */
+
+static int32_t prvImageWrite( void * pvContext, uint32_t ulOffset, const uint8_t * pucData, uint32_t ulLength )
+{
+    const sBuildFiles_t * pxFiles = ( const sBuildFiles_t * ) pvContext;
+
+    prvDigestBlock( ulOffset, pucData, ulLength );
+    return prvWriteToFile( pxFiles->lImageHandle, ulOffset, ( uint8_t * ) pucData, ulLength );
+}
+
+
+/* Start decompressing a compressed image as it comes, once its header is
+ * here: in the first block, or in the first chunk if that was committed
+ * before a reset. Without the buffers, or the bundle file, the file is
+ * received like any other and decompressed on close.
+ * Returns 0, or a negative error code if the blocks held for a chunk file
+ * could not be written out. */
+
+static int32_t prvStartInflate( OTA_FileContext_t *C, uint32_t ulOffset, const uint8_t * pucData )
+{
+    DEFINE_OTA_METHOD_NAME("prvStartInflate");
+
+    uint8_t ucHeader[ otalzssHEADER_SIZE ];
+    const uint8_t *pucHeader = NULL;
+    OtaLzssHeader_t xHeader;
+    OtaLzssParams_t xParams;
+    int32_t lImageHandle = 0;
+    int32_t lResult = 0;
+
+    if ( ulOffset == 0UL )
+    {
+        pucHeader = pucData;
+    }
+    else if ( ( xResume.ulChunks & 1UL ) != 0UL )
     {
-		OTA_LOG_L1("[%s] Aborted after %u retries.\r\n", OTA_METHOD_NAME, OTA_MAX_PAL_WRITE_RETRIES);
-		lReturnVal = ( int16_t ) SL_ERROR_FS_FAILED_TO_WRITE;
+        if ( prvChunkRead( &xInflate.xFiles, 0UL, ucHeader, ( uint32_t ) sizeof( ucHeader ) ) == ( int32_t ) sizeof( ucHeader ) )
+        {
+            pucHeader = ucHeader;
+        }
+        if ( xInflate.xFiles.lChunkHandle > 0 )
+        {
+            ( void ) sl_FsClose( xInflate.xFiles.lChunkHandle, ( _u8* ) NULL, ( _u8* ) NULL, 0UL );
+            xInflate.xFiles.lChunkHandle = 0;
+        }
     }
     else
     {
-        lReturnVal = ( int16_t ) lResult;
-    	}
-    return lReturnVal;
+        /* The header is still to come. */
+    }
+
+    if ( pucHeader != NULL )
+    {
+        /* A file that is not a compressed image fails to build on close. */
+        xInflate.xWanted = false;
+        if ( ( OtaLzss_ParseHeader( pucHeader, otalzssHEADER_SIZE, &xHeader ) == eOtaLzssSuccess ) &&
+             ( xHeader.ulImageSize <= OTA_MAX_MCU_IMAGE_SIZE ) )
+        {
+            lResult = prvFlushWriteBehind();
+            if ( ( lResult == 0 ) && ( xWriteBehind.pucBuffer != NULL ) )
+            {
+                xInflate.pucWindow = ( uint8_t * ) pvPortMalloc( 1UL << xHeader.ucWindowBits );
+            }
+            if ( xInflate.pucWindow != NULL )
+            {
+                lImageHandle = prvCreateImageFile( C );
+            }
+
+            if ( lResult != 0 )
+            {
+                /* The error is reported on this block. */
+            }
+            else if ( xInflate.pucWindow == NULL )
+            {
+                OTA_LOG_L1("[%s] No buffers to decompress the image as it comes; it is decompressed on close.\r\n", OTA_METHOD_NAME);
+            }
+            else if ( lImageHandle <= 0 )
+            {
+                vPortFree( xInflate.pucWindow );
+                xInflate.pucWindow = NULL;
+            }
+            else
+            {
+                /* Chunk files are written through from here on. */
+                xInflate.pucOutput = xWriteBehind.pucBuffer;
+                xWriteBehind.pucBuffer = NULL;
+                xWriteBehind.lFileHandle = 0;
+                xInflate.xFiles.lImageHandle = lImageHandle;
+                prvStartDigest( xHeader.ulImageSize );
+
+                memset( &xParams, ( int ) 0, sizeof( xParams ) );
+                xParams.ulPackedSize = C->ulFileSize;
+                xParams.xWrite = prvImageWrite;
+                xParams.pvContext = &xInflate.xFiles;
+                xParams.pucOutput = xInflate.pucOutput;
+                xParams.ulOutputSize = OTA_WRITE_BEHIND_SIZE;
+                xParams.pucWindow = xInflate.pucWindow;
+                xParams.ulWindowSize = 1UL << xHeader.ucWindowBits;
+                ( void ) OtaLzss_Start( &xInflate.xDecoder, &xParams );
+                xInflate.xActive = true;
+                OTA_LOG_L1("[%s] Decompressing a %u byte image as it comes.\r\n", OTA_METHOD_NAME, xHeader.ulImageSize);
+            }
+        }
+    }
+    return lResult;
+}
+
+
+/* Stop decompressing. The bundle file, if still open here, is thrown away,
+ * and the buffers are given back. */
+
+static void prvStopInflate( void )
+{
+    static _u8 pcTI_AbortSig[] = "A";
+
+    if ( xInflate.xFiles.lChunkHandle > 0 )
+    {
+        ( void ) sl_FsClose( xInflate.xFiles.lChunkHandle, ( _u8* ) NULL, ( _u8* ) NULL, 0UL );
+    }
+    if ( xInflate.xFiles.lImageHandle > 0 )
+    {
+        ( void ) sl_FsClose( xInflate.xFiles.lImageHandle, ( _u8* ) NULL, ( _u8* ) pcTI_AbortSig, CONST_STRLEN( pcTI_AbortSig ) );
+    }
+    vPortFree( xInflate.pucWindow );
+    BufferPool_Release( xInflate.pucOutput );
+    memset( &xInflate, ( int ) 0, sizeof( xInflate ) );
+}
+
+
+/* Decompress the next part of the file into the bundle file.
+ * Returns 0 or a negative error code. */
+
+static int32_t prvInflate( const uint8_t * pucData, uint32_t ulLength )
+{
+    DEFINE_OTA_METHOD_NAME("prvInflate");
+
+    OtaLzssStatus_t xStatus;
+    int32_t lResult = 0;
+
+    xStatus = OtaLzss_Feed( &xInflate.xDecoder, pucData, ulLength );
+    if ( xStatus != eOtaLzssSuccess )
+    {
+        OTA_LOG_L1("[%s] Error (%d) decompressing the file at %u.\r\n", OTA_METHOD_NAME, xStatus, xInflate.ulNext);
+        lResult = OTA_BUILD_ERROR;
+    }
+    xInflate.ulNext += ulLength;
+    return lResult;
+}
+
+
+/* Decompress the committed chunks the next byte to decompress has reached.
+ * They are read through a pool buffer; without one, they are left for the
+ * close. Returns 0 or a negative error code. */
+
+static int32_t prvInflateStaged( void )
+{
+    uint8_t *pucInput = NULL;
+    uint32_t ulLength;
+    int32_t lResult = 0;
+
+    while ( ( lResult == 0 ) && ( xInflate.ulNext < xInflate.xFiles.ulFileSize ) &&
+            ( ( ( xResume.ulChunks | xInflate.ulPartChunks ) & ( 1UL << ( xInflate.ulNext / OTA_CHUNK_SIZE ) ) ) != 0UL ) )
+    {
+        if ( pucInput == NULL )
+        {
+            pucInput = ( uint8_t * ) BufferPool_Acquire( OTA_BUILD_READ_SIZE );
+            if ( pucInput == NULL )
+            {
+                break;
+            }
+        }
+        ulLength = OTA_CHUNK_SIZE - ( xInflate.ulNext % OTA_CHUNK_SIZE );
+        ulLength = ( ulLength < OTA_BUILD_READ_SIZE ) ? ulLength : OTA_BUILD_READ_SIZE;
+        ulLength = ( ulLength < ( xInflate.xFiles.ulFileSize - xInflate.ulNext ) ) ? ulLength : ( xInflate.xFiles.ulFileSize - xInflate.ulNext );
+        if ( prvChunkRead( &xInflate.xFiles, xInflate.ulNext, pucInput, ulLength ) != ( int32_t ) ulLength )
+        {
+            lResult = OTA_BUILD_ERROR;
+        }
+        else
+        {
+            lResult = prvInflate( pucInput, ulLength );
+        }
+    }
+    BufferPool_Release( pucInput );
+    if ( xInflate.xFiles.lChunkHandle > 0 )
+    {
+        ( void ) sl_FsClose( xInflate.xFiles.lChunkHandle, ( _u8* ) NULL, ( _u8* ) NULL, 0UL );
+        xInflate.xFiles.lChunkHandle = 0;
+    }
+    return lResult;
+}
+
+
+/* Decompress what is left of a compressed image in the chunk files and
+ * check the image is whole. Returns 0, with C->lFileHandle the bundle file,
+ * or a negative error code. */
+
+static int32_t prvFinishInflate( OTA_FileContext_t *C )
+{
+    DEFINE_OTA_METHOD_NAME("prvFinishInflate");
+
+    OtaLzssStatus_t xStatus;
+    uint32_t ulBuiltSize = 0UL;
+    int32_t lResult = 0;
+    uint32_t ulSlot;
+
+    /* A chunk still open lost blocks the agent counted as written. */
+    for ( ulSlot = 0UL; ulSlot < OTA_OPEN_CHUNKS; ulSlot++ )
+    {
+        if ( xChunks[ ulSlot ].lFileHandle != 0 )
+        {
+            lResult = OTA_BUILD_ERROR;
+        }
+    }
+    if ( lResult == 0 )
+    {
+        lResult = prvInflateStaged();
+    }
+    if ( ( lResult != 0 ) || ( xInflate.ulNext != C->ulFileSize ) )
+    {
+        OTA_LOG_L1( "[%s] The file received is not complete; %u of %u bytes decompressed.\r\n", OTA_METHOD_NAME, xInflate.ulNext, C->ulFileSize );
+        lResult = OTA_BUILD_ERROR;
+    }
+    else if ( ( xStatus = OtaLzss_Finish( &xInflate.xDecoder, &ulBuiltSize ) ) != eOtaLzssSuccess )
+    {
+        OTA_LOG_L1( "[%s] Error (%d) decompressing the image at %u bytes.\r\n", OTA_METHOD_NAME, xStatus, ulBuiltSize );
+        lResult = OTA_BUILD_ERROR;
+    }
+    else
+    {
+        OTA_LOG_L1( "[%s] Decompressed a %u byte image from a %u byte file as it came.\r\n", OTA_METHOD_NAME, ulBuiltSize, C->ulFileSize );
+        C->lFileHandle = xInflate.xFiles.lImageHandle;
+        xInflate.xFiles.lImageHandle = 0;
+    }
+    return lResult;
+}
+
+
+/* Name of a chunk file: the prefix and two digits of the chunk number. */
+
+static void prvChunkName( uint32_t ulChunk, _u8 * pucName )
+{
+    size_t xPrefix = sizeof( OTA_CHUNK_FILE_PREFIX ) - 1U;
+
+    memcpy( pucName, OTA_CHUNK_FILE_PREFIX, xPrefix );
+    pucName[ xPrefix ] = ( _u8 ) ( ( uint32_t ) '0' + ( ( ulChunk / 10UL ) % 10UL ) );
+    pucName[ xPrefix + 1U ] = ( _u8 ) ( ( uint32_t ) '0' + ( ulChunk % 10UL ) );
+    pucName[ xPrefix + 2U ] = 0U;
+}
+
+
+/* Bytes of the file in a chunk; all but the last are whole. */
+
+static uint32_t prvChunkLength( const OTA_FileContext_t *C, uint32_t ulChunk )
+{
+    uint32_t ulBase = ulChunk * OTA_CHUNK_SIZE;
+    uint32_t ulLength = 0UL;
+
+    if ( ulBase < C->ulFileSize )
+    {
+        ulLength = ( ( C->ulFileSize - ulBase ) < OTA_CHUNK_SIZE ) ? ( C->ulFileSize - ulBase ) : OTA_CHUNK_SIZE;
+    }
+    return ulLength;
+}
+
+
+/* Mark the blocks of a part of the file received in the agent's bitmap, or
+ * missing again, and keep its count of the blocks remaining in step. The
+ * part starts on a block. */
+
+static void prvMarkBlocks( OTA_FileContext_t *C, uint32_t ulOffset, uint32_t ulLength, bool xReceived )
+{
+    uint32_t ulBlock = ulOffset >> otaconfigLOG2_FILE_BLOCK_SIZE;
+    uint32_t ulEnd = ulBlock + ( ( ulLength + ( 1UL << otaconfigLOG2_FILE_BLOCK_SIZE ) - 1UL ) >> otaconfigLOG2_FILE_BLOCK_SIZE );
+    uint8_t ucMask;
+
+    for ( ; ulBlock < ulEnd; ulBlock++ )
+    {
+        /* A set bit is a block still to come. */
+        ucMask = ( uint8_t ) ( 1U << ( ulBlock % 8UL ) );
+        if ( ( xReceived == true ) && ( ( C->pucRxBlockBitmap[ ulBlock / 8UL ] & ucMask ) != 0U ) )
+        {
+            C->pucRxBlockBitmap[ ulBlock / 8UL ] &= ( uint8_t ) ~ucMask;
+            C->ulBlocksRemaining--;
+        }
+        else if ( ( xReceived == false ) && ( ( C->pucRxBlockBitmap[ ulBlock / 8UL ] & ucMask ) == 0U ) )
+        {
+            C->pucRxBlockBitmap[ ulBlock / 8UL ] |= ucMask;
+            C->ulBlocksRemaining++;
+        }
+        else
+        {
+            /* Already so. */
+        }
+    }
+}
+
+
+/* The slot a chunk file is open in, or NULL if it is not open. */
+
+static sChunk_t * prvFindChunk( uint32_t ulChunk )
+{
+    sChunk_t *pxChunk = NULL;
+    uint32_t ulSlot;
+
+    for ( ulSlot = 0UL; ulSlot < OTA_OPEN_CHUNKS; ulSlot++ )
+    {
+        if ( ( xChunks[ ulSlot ].lFileHandle != 0 ) && ( xChunks[ ulSlot ].ulChunk == ulChunk ) )
+        {
+            pxChunk = &xChunks[ ulSlot ];
+        }
+    }
+    return pxChunk;
+}
+
+
+/* The slot of the chunk file a block goes to. A chunk not open yet is
+ * created in a free slot, or in place of the open chunk with the most
+ * blocks still to come, which is thrown away. Returns NULL if the chunk file
+ * cannot be created. */
+
+static sChunk_t * prvGetChunk( OTA_FileContext_t *C, uint32_t ulChunk )
+{
+    DEFINE_OTA_METHOD_NAME("prvGetChunk");
+
+    _u8 ucName[ OTA_CHUNK_NAME_SIZE ];
+    sChunk_t *pxChunk = NULL;
+    sChunk_t *pxSlot = NULL;
+    uint32_t ulSlot;
+    int32_t lResult;
+
+    for ( ulSlot = 0UL; ulSlot < OTA_OPEN_CHUNKS; ulSlot++ )
+    {
+        if ( ( xChunks[ ulSlot ].lFileHandle != 0 ) && ( xChunks[ ulSlot ].ulChunk == ulChunk ) )
+        {
+            pxChunk = &xChunks[ ulSlot ];
+        }
+        else if ( ( pxSlot == NULL ) || ( xChunks[ ulSlot ].lFileHandle == 0 ) ||
+                  ( ( pxSlot->lFileHandle != 0 ) && ( xChunks[ ulSlot ].ulBlocksLeft > pxSlot->ulBlocksLeft ) ) )
+        {
+            pxSlot = &xChunks[ ulSlot ];
+        }
+        else
+        {
+            /* A better slot was found. */
+        }
+    }
+
+    if ( pxChunk == NULL )
+    {
+        if ( pxSlot->lFileHandle != 0 )
+        {
+            OTA_LOG_L1("[%s] Chunk %u dropped with %u blocks missing.\r\n", OTA_METHOD_NAME, pxSlot->ulChunk, pxSlot->ulBlocksLeft);
+            prvDropChunk( C, pxSlot );
+        }
+        prvChunkName( ulChunk, ucName );
+        lResult = sl_FsOpen( ucName, ( _u32 ) ( SL_FS_CREATE | SL_FS_OVERWRITE | SL_FS_CREATE_NOSIGNATURE |
+                                                SL_FS_CREATE_MAX_SIZE( OTA_CHUNK_SIZE ) ), NULL );
+        if ( lResult > 0 )
+        {
+            /* The part of a compressed image decompressed already is not
+             * written to the chunk. */
+            pxSlot->lFileHandle = lResult;
+            pxSlot->ulChunk = ulChunk;
+            pxSlot->ulStart = ulChunk * OTA_CHUNK_SIZE;
+            if ( ( xInflate.xActive == true ) && ( xInflate.ulNext > pxSlot->ulStart ) )
+            {
+                pxSlot->ulStart = xInflate.ulNext;
+            }
+            pxSlot->ulBlocksLeft = ( ( ulChunk * OTA_CHUNK_SIZE ) + prvChunkLength( C, ulChunk ) - pxSlot->ulStart +
+                                     ( 1UL << otaconfigLOG2_FILE_BLOCK_SIZE ) - 1UL ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+            pxChunk = pxSlot;
+        }
+        else
+        {
+            OTA_LOG_L1("[%s] Error (%d) creating chunk file %u.\r\n", OTA_METHOD_NAME, lResult, ulChunk);
+        }
+    }
+    return pxChunk;
+}
+
+
+/* Throw away a chunk file that is not complete, with the run held for it,
+ * and mark its blocks missing so the agent asks for them again. */
+
+static void prvDropChunk( OTA_FileContext_t *C, sChunk_t *pxChunk )
+{
+    static _u8 pcTI_AbortSig[] = "A";
+
+    if ( xWriteBehind.lFileHandle == pxChunk->lFileHandle )
+    {
+        xWriteBehind.lFileHandle = 0;
+        xWriteBehind.ulLength = 0UL;
+    }
+    ( void ) sl_FsClose( pxChunk->lFileHandle, ( _u8* ) NULL, ( _u8* ) pcTI_AbortSig, CONST_STRLEN( pcTI_AbortSig ) );
+    pxChunk->lFileHandle = 0;
+    if ( C != NULL )
+    {
+        prvMarkBlocks( C, pxChunk->ulStart, ( pxChunk->ulChunk * OTA_CHUNK_SIZE ) + prvChunkLength( C, pxChunk->ulChunk ) - pxChunk->ulStart, false );
+    }
+}
+
+
+/* Close a chunk file whose blocks are all written, which commits it, and
+ * record it for a resume if it holds the whole chunk. Returns 0 or a
+ * negative error code. */
+
+static int32_t prvCommitChunk( sChunk_t *pxChunk )
+{
+    int32_t lResult = 0;
+
+    if ( xWriteBehind.lFileHandle == pxChunk->lFileHandle )
+    {
+        lResult = prvFlushWriteBehind();
+        xWriteBehind.lFileHandle = 0;
+    }
+    if ( lResult == 0 )
+    {
+        lResult = ( int32_t ) sl_FsClose( pxChunk->lFileHandle, ( _u8* ) NULL, ( _u8* ) NULL, 0UL );
+        pxChunk->lFileHandle = 0;
+    }
+    if ( lResult == 0 )
+    {
+        if ( pxChunk->ulStart == ( pxChunk->ulChunk * OTA_CHUNK_SIZE ) )
+        {
+            xResume.ulChunks |= ( 1UL << pxChunk->ulChunk );
+            prvSaveResume();
+        }
+        else
+        {
+            /* The image decompressed from the rest is lost at a reset. */
+            xInflate.ulPartChunks |= ( 1UL << pxChunk->ulChunk );
+        }
+    }
+    return lResult;
+}
+
+
+/* Take over the chunks committed before a reset if the resume record is for
+ * this file: their blocks are marked received, so the agent asks only for
+ * the rest. Chunk files not taken over are deleted and the record is
+ * written for this file. The last chunk is always received again, so the
+ * agent has a block to ask for and closes the file as after any download. */
+
+static void prvLoadResume( OTA_FileContext_t *C )
+{
+    DEFINE_OTA_METHOD_NAME("prvLoadResume");
+
+    sResume_t xSaved;
+    SlFsFileInfo_t xInfo;
+    mbedtls_sha1_context xContext;
+    _u8 ucName[ OTA_CHUNK_NAME_SIZE ];
+    uint32_t ulLastChunk = ( C->ulFileSize > 0UL ) ? ( ( C->ulFileSize - 1UL ) / OTA_CHUNK_SIZE ) : 0UL;
+    uint32_t ulChunk;
+    int32_t lFileHandle;
+    int32_t lResult = SL_ERROR_FS_FILE_NOT_EXISTS;
+
+    /* Chunks still open belong to a file the agent created before, e.g. one
+     * it takes up again after it was resumed; what they hold is received
+     * again. */
+    for ( ulChunk = 0UL; ulChunk < OTA_OPEN_CHUNKS; ulChunk++ )
+    {
+        if ( xChunks[ ulChunk ].lFileHandle != 0 )
+        {
+            prvDropChunk( NULL, &xChunks[ ulChunk ] );
+        }
+    }
+
+    memset( &xResume, ( int ) 0, sizeof( xResume ) );
+    xResume.ulMagic = OTA_RESUME_MAGIC;
+    xResume.ulFileSize = C->ulFileSize;
+    xResume.ulFileAttributes = C->ulFileAttributes;
+    xResume.ulServerFileID = C->ulServerFileID;
+
+    /* The job and the signature tell this file from another of the same size. */
+    mbedtls_sha1_init( &xContext );
+    if ( ( mbedtls_sha1_starts_ret( &xContext ) != 0 ) ||
+         ( ( C->pucJobName != NULL ) &&
+           ( mbedtls_sha1_update_ret( &xContext, C->pucJobName, strlen( ( const char * ) C->pucJobName ) ) != 0 ) ) ||
+         ( ( C->pxSignature != NULL ) &&
+           ( mbedtls_sha1_update_ret( &xContext, C->pxSignature->ucData, C->pxSignature->usSize ) != 0 ) ) ||
+         ( mbedtls_sha1_finish_ret( &xContext, xResume.ucJobDigest ) != 0 ) )
+    {
+        /* No record matches, so the file is received whole. */
+        xResume.ulMagic = 0UL;
+    }
+    mbedtls_sha1_free( &xContext );
+
+    lFileHandle = sl_FsOpen( ( const _u8* ) OTA_RESUME_FILE, SL_FS_READ, NULL );
+    if ( lFileHandle > 0 )
+    {
+        lResult = sl_FsRead( lFileHandle, 0UL, ( _u8* ) &xSaved, ( _u32 ) sizeof( xSaved ) );
+        ( void ) sl_FsClose( lFileHandle, ( _u8* ) NULL, ( _u8* ) NULL, 0UL );
+    }
+    if ( ( lResult != ( int32_t ) sizeof( xSaved ) ) || ( xResume.ulMagic != OTA_RESUME_MAGIC ) || ( C->pucRxBlockBitmap == NULL ) ||
+         ( memcmp( &xSaved, &xResume, offsetof( sResume_t, ulChunks ) ) != 0 ) )
+    {
+        xSaved.ulChunks = 0UL;
+    }
+
+    for ( ulChunk = 0UL; ulChunk < OTA_MAX_CHUNKS; ulChunk++ )
+    {
+        prvChunkName( ulChunk, ucName );
+        if ( ( ( xSaved.ulChunks & ( 1UL << ulChunk ) ) != 0UL ) && ( ulChunk < ulLastChunk ) &&
+             ( sl_FsGetInfo( ucName, 0UL, &xInfo ) == 0 ) && ( xInfo.Len == OTA_CHUNK_SIZE ) )
+        {
+            prvMarkBlocks( C, ulChunk * OTA_CHUNK_SIZE, OTA_CHUNK_SIZE, true );
+            xResume.ulChunks |= ( 1UL << ulChunk );
+        }
+        else
+        {
+            ( void ) sl_FsDel( ucName, 0UL );
+        }
+    }
+    if ( xResume.ulChunks != 0UL )
+    {
+        OTA_LOG_L1("[%s] Resuming the file of job %s.\r\n", OTA_METHOD_NAME, ( C->pucJobName != NULL ) ? ( const char * ) C->pucJobName : "");
+    }
+    prvSaveResume();
+}
+
+
+/* Write the resume record. It is a failsafe file, so a reset while it is
+ * written leaves the last one. A record not written only costs the chunks
+ * since the last one if the download is cut short. */
+
+static void prvSaveResume( void )
+{
+    DEFINE_OTA_METHOD_NAME("prvSaveResume");
+
+    int32_t lFileHandle;
+    int32_t lResult;
+
+    lFileHandle = sl_FsOpen( ( const _u8* ) OTA_RESUME_FILE,
+                             ( _u32 ) ( SL_FS_CREATE | SL_FS_OVERWRITE | SL_FS_CREATE_FAILSAFE | SL_FS_CREATE_NOSIGNATURE |
+                                        SL_FS_CREATE_MAX_SIZE( sizeof( sResume_t ) ) ), NULL );
+    lResult = lFileHandle;
+    if ( lFileHandle > 0 )
+    {
+        lResult = sl_FsWrite( lFileHandle, 0UL, ( _u8* ) &xResume, ( _u32 ) sizeof( xResume ) );
+        ( void ) sl_FsClose( lFileHandle, ( _u8* ) NULL, ( _u8* ) NULL, 0UL );
+    }
+    if ( lResult < 0 )
+    {
+        OTA_LOG_L1("[%s] Error (%d) writing the resume record.\r\n", OTA_METHOD_NAME, lResult);
+    }
+}
+
+
+/* Delete the chunk files and the resume record, once the image is built or
+ * the file thrown away. */
+
+static void prvDeleteChunks( void )
+{
+    _u8 ucName[ OTA_CHUNK_NAME_SIZE ];
+    uint32_t ulChunk;
+
+    for ( ulChunk = 0UL; ulChunk < OTA_OPEN_CHUNKS; ulChunk++ )
+    {
+        if ( xChunks[ ulChunk ].lFileHandle != 0 )
+        {
+            prvDropChunk( NULL, &xChunks[ ulChunk ] );
+        }
+    }
+    for ( ulChunk = 0UL; ulChunk < OTA_MAX_CHUNKS; ulChunk++ )
+    {
+        prvChunkName( ulChunk, ucName );
+        ( void ) sl_FsDel( ucName, 0UL );
+    }
+    ( void ) sl_FsDel( ( const _u8* ) OTA_RESUME_FILE, 0UL );
+    memset( &xResume, ( int ) 0, sizeof( xResume ) );
+}
+
+#ifdef FREERTOS_ENABLE_UNIT_TESTS
+#include "aws_ota_pal_test_access_define.h"
+#endif
+
+/* Write to a file, retrying partial and failed writes.
+ * Returns the number of bytes written or a negative error code.
+ */
+static int32_t prvWriteToFile( int32_t lFileHandle, uint32_t ulOffset, uint8_t * pucData, uint32_t ulSize )
+{
+    DEFINE_OTA_METHOD_NAME("prvWriteToFile");
+
+    int32_t lResult = 0;
+    uint32_t ulWritten = 0UL;
+    uint32_t ulRemaining = ulSize;
+    uint32_t ulRetry;
+
+    for ( ulRetry = 0UL; ulRetry <= OTA_MAX_PAL_WRITE_RETRIES; ulRetry++ )
+    {
+        lResult = sl_FsWrite( lFileHandle, ulOffset + ulWritten, &pucData[ ulWritten ], ulRemaining );
+        if ( lResult >= 0 )
+        {
+            if ( ulRemaining == ( uint32_t ) lResult )   /* If we wrote all of the bytes requested, we're done. */
+            {
+                break;
+            }
+            else
+            {
+                ulWritten += ( uint32_t ) lResult;       /* Add to total bytes written counter. */
+                ulRemaining -= ( uint32_t ) lResult;     /* Reduce the size by amount just written. */
+            }
+        }
+        else
+        {
+            /* Nothing to do but retry. */
+        }
+    }
+    if ( ulRetry > OTA_MAX_PAL_WRITE_RETRIES )
+    {
+        OTA_LOG_L1("[%s] Aborted after %u retries.\r\n", OTA_METHOD_NAME, OTA_MAX_PAL_WRITE_RETRIES);
+        lResult = SL_ERROR_FS_FAILED_TO_WRITE;
+    }
+    else
+    {
+        lResult = ( int32_t ) ulSize;
+    }
+    return lResult;
+}
+
+
+/* Write out the blocks held, if any, into their chunk file.
+ * Returns 0 or a negative error code; the blocks are dropped either way.
+ */
+static int32_t prvFlushWriteBehind( void )
+{
+    int32_t lResult = 0;
+
+    if ( xWriteBehind.ulLength > 0UL )
+    {
+        lResult = prvWriteToFile( xWriteBehind.lFileHandle, xWriteBehind.ulOffset - xWriteBehind.ulBase,
+                                  xWriteBehind.pucBuffer, xWriteBehind.ulLength );
+        xWriteBehind.ulOffset += xWriteBehind.ulLength;
+        xWriteBehind.ulLength = 0UL;
+        if ( lResult > 0 )
+        {
+            lResult = 0;
+        }
+    }
+    return lResult;
+}
+
+
+/* Write the file just created through a buffer. The buffer is taken from the
+ * pool with the first block, after the data path has taken its own; without
+ * one, blocks are written as they come. */
+
+static void prvStartWriteBehind( void )
+{
+    ( void ) prvStopWriteBehind();
+    xWriteBehind.lFileHandle = 0;
+    xWriteBehind.ulBase = 0UL;
+    xWriteBehind.ulOffset = 0UL;
+    xWriteBehind.ulLength = 0UL;
+    xWriteBehind.xWanted = true;
+}
+
+
+/* Take the buffer for the file being written, once. */
+
+static void prvTakeWriteBehind( void )
+{
+    DEFINE_OTA_METHOD_NAME("prvTakeWriteBehind");
+
+    xWriteBehind.xWanted = false;
+    xWriteBehind.pucBuffer = ( uint8_t * ) BufferPool_Acquire( OTA_WRITE_BEHIND_SIZE );
+    if ( xWriteBehind.pucBuffer == NULL )
+    {
+        OTA_LOG_L1("[%s] No pool buffer for the write buffer; writing each block.\r\n", OTA_METHOD_NAME);
+    }
+}
+
+
+/* Flush and give the buffer back.
+ * Returns 0 or a negative error code from the flush.
+ */
+static int32_t prvStopWriteBehind( void )
+{
+    int32_t lResult = 0;
+
+    xWriteBehind.xWanted = false;
+    if ( xWriteBehind.pucBuffer != NULL )
+    {
+        lResult = prvFlushWriteBehind();
+        BufferPool_Release( xWriteBehind.pucBuffer );
+        xWriteBehind.pucBuffer = NULL;
+    }
+    return lResult;
+}
+
+/* Write a block to the chunk file it belongs to, committing the chunk with
+ * its last block. Returns 0 or a negative error code.
+ */
+static int32_t prvStageBlock( OTA_FileContext_t *C, uint32_t ulOffset, uint8_t * pcData, uint32_t ulBlockSize )
+{
+    int32_t lResult = 0;
+    uint32_t ulCopied = 0UL;
+    uint32_t ulChunk;
+    uint32_t ulRoom;
+    sChunk_t * pxChunk;
+
+    /* A chunk is a whole number of blocks, so a block is in one chunk. */
+    pxChunk = prvGetChunk( C, ulOffset / OTA_CHUNK_SIZE );
+
+    if ( pxChunk == NULL )
+    {
+        lResult = SL_ERROR_FS_FAILED_TO_WRITE;
+    }
+    else if ( xWriteBehind.pucBuffer == NULL )
+    {
+        lResult = prvWriteToFile( pxChunk->lFileHandle, ulOffset % OTA_CHUNK_SIZE, pcData, ulBlockSize );
+    }
+    else
+    {
+        /* Only a block that continues the run in the same chunk can join
+         * it; otherwise the run is written out and a new one starts here. */
+        if ( ( ulOffset != ( xWriteBehind.ulOffset + xWriteBehind.ulLength ) ) ||
+             ( xWriteBehind.lFileHandle != pxChunk->lFileHandle ) )
+        {
+            lResult = prvFlushWriteBehind();
+            xWriteBehind.lFileHandle = pxChunk->lFileHandle;
+            xWriteBehind.ulBase = ulOffset - ( ulOffset % OTA_CHUNK_SIZE );
+            xWriteBehind.ulOffset = ulOffset;
+        }
+
+        while ( ( lResult >= 0 ) && ( ulCopied < ulBlockSize ) )
+        {
+            /* A run ends on a multiple of its size, so every write but the
+             * first and the last is a whole run. */
+            ulRoom = OTA_WRITE_BEHIND_SIZE - ( ( xWriteBehind.ulOffset % OTA_WRITE_BEHIND_SIZE ) + xWriteBehind.ulLength );
+            ulChunk = ( ( ulBlockSize - ulCopied ) < ulRoom ) ? ( ulBlockSize - ulCopied ) : ulRoom;
+            memcpy( &xWriteBehind.pucBuffer[ xWriteBehind.ulLength ], &pcData[ ulCopied ], ulChunk );
+            xWriteBehind.ulLength += ulChunk;
+            ulCopied += ulChunk;
+
+            if ( ulChunk == ulRoom )
+            {
+                lResult = prvFlushWriteBehind();
+            }
+        }
+    }
+
+    /* The chunk is committed with its last block. A failed write or commit
+     * is reported on the block that triggered it, and the agent gives up on
+     * the file. */
+    if ( lResult >= 0 )
+    {
+        pxChunk->ulBlocksLeft--;
+        lResult = ( pxChunk->ulBlocksLeft == 0UL ) ? prvCommitChunk( pxChunk ) : 0;
+    }
+    return ( lResult < 0 ) ? lResult : 0;
+}
+
+/* Write a block of data to the specified file.
+ * Returns the most recent number of bytes written upon success or a negative error code.
+ */
+int16_t prvPAL_WriteBlock( OTA_FileContext_t * const C, uint32_t ulOffset, uint8_t * const pcData, uint32_t ulBlockSize )
+{
+    int32_t lResult = 0;
+
+    OtaWindow_BlockReceived( ulBlockSize );
+
+    if ( xWriteBehind.xWanted == true )
+    {
+        prvTakeWriteBehind();
+    }
+    if ( xInflate.xWanted == true )
+    {
+        lResult = prvStartInflate( C, ulOffset, pcData );
+    }
+
+    /* The next block of a compressed image goes straight into the image,
+     * unless its chunk was opened for blocks after it. Then it goes there
+     * too, to be decompressed with them once the chunk is committed. */
+    if ( lResult != 0 )
+    {
+        /* The blocks held for a chunk file were lost. */
+    }
+    else if ( ( xInflate.xActive == true ) && ( ulOffset == xInflate.ulNext ) &&
+              ( prvFindChunk( ulOffset / OTA_CHUNK_SIZE ) == NULL ) )
+    {
+        lResult = prvInflate( pcData, ulBlockSize );
+    }
+    else
+    {
+        lResult = prvStageBlock( C, ulOffset, pcData, ulBlockSize );
+    }
+    if ( ( lResult == 0 ) && ( xInflate.xActive == true ) )
+    {
+        lResult = prvInflateStaged();
+    }
+    if ( lResult >= 0 )
+    {
+        lResult = ( int32_t ) ulBlockSize;
+    }
+    return ( int16_t ) lResult;
 }
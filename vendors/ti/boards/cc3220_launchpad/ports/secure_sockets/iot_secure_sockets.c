@@ -30,6 +30,7 @@
 /* Standard includes. */
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
@@ -96,6 +97,14 @@
 #define securesocketsTLS_HANDSHAKE_SUCCESS    0             /**< TLS handshake successful. */
 #define securesocketsTLS_HANDSHAKE_FAILED     1             /**< TLS handshake failed. */
 #define securesocketsTLS_HANDSHAKE_INVALID    2             /**< TLS handshake invalid result. */
+
+/**
+ * @brief Called by SOCKETS_Connect once the TCP connection is up and before
+ * the TLS handshake starts, so the two can be timed separately.
+ */
+#ifndef securesocketsTCP_CONNECTED_HOOK
+    #define securesocketsTCP_CONNECTED_HOOK()
+#endif
 /* @} */
 
 /*-----------------------------------------------------------*/
@@ -131,6 +140,11 @@ static SemaphoreHandle_t xUcInUse = NULL;
  */
 static SemaphoreHandle_t xGetHostByName = NULL;
 
+/**
+ * @brief Bytes of a certificate file read at a time to compare it.
+ */
+#define securesocketsCERTIFICATE_COMPARE_CHUNK    ( 64U )
+
 /**
  * @brief Maximum time in ticks to wait for obtaining a semaphore.
  */
@@ -224,6 +238,22 @@ static int32_t prvWriteCertificate( const char * pcDeviceFileName,
                                     const char * pcCertificate,
                                     uint32_t ulCertificateSize );
 
+/**
+ * @brief Check whether a certificate file already holds the given certificate.
+ *
+ * Every connection sets the same certificate, so comparing it with the file
+ * saves rewriting the flash each time.
+ *
+ * @param[in] pcDeviceFileName The certificate file.
+ * @param[in] pcCertificate The certificate to compare with.
+ * @param[in] ulCertificateSize The size of the above certificate.
+ *
+ * @return pdTRUE if the file holds exactly the certificate, pdFALSE otherwise.
+ */
+static BaseType_t prvCertificateMatches( const char * pcDeviceFileName,
+                                         const char * pcCertificate,
+                                         uint32_t ulCertificateSize );
+
 /*-----------------------------------------------------------*/
 
 static uint32_t prvGetFreeSocket( void )
@@ -538,6 +568,54 @@ static int32_t prvWriteCertificate( const char * pcDeviceFileName,
 }
 /*-----------------------------------------------------------*/
 
+static BaseType_t prvCertificateMatches( const char * pcDeviceFileName,
+                                         const char * pcCertificate,
+                                         uint32_t ulCertificateSize )
+{
+    SlFsFileInfo_t xFileInfo = { 0 };
+    _i32 lFileHandle, lTIRetCode;
+    uint8_t ucChunk[ securesocketsCERTIFICATE_COMPARE_CHUNK ];
+    uint32_t ulOffset = 0;
+    uint32_t ulLength;
+    BaseType_t xMatches = pdFALSE;
+
+    if( ( sl_FsGetInfo( ( const unsigned char * ) pcDeviceFileName, 0, &xFileInfo ) == 0 ) &&
+        ( xFileInfo.Len == ulCertificateSize ) )
+    {
+        lFileHandle = sl_FsOpen( ( const unsigned char * ) pcDeviceFileName, SL_FS_READ, NULL );
+
+        if( lFileHandle >= 0 )
+        {
+            xMatches = pdTRUE;
+
+            while( ( xMatches == pdTRUE ) && ( ulOffset < ulCertificateSize ) )
+            {
+                ulLength = ulCertificateSize - ulOffset;
+
+                if( ulLength > sizeof( ucChunk ) )
+                {
+                    ulLength = sizeof( ucChunk );
+                }
+
+                lTIRetCode = sl_FsRead( lFileHandle, ulOffset, ucChunk, ulLength );
+
+                if( ( lTIRetCode != ( _i32 ) ulLength ) ||
+                    ( memcmp( ucChunk, &pcCertificate[ ulOffset ], ulLength ) != 0 ) )
+                {
+                    xMatches = pdFALSE;
+                }
+
+                ulOffset += ulLength;
+            }
+
+            ( void ) sl_FsClose( lFileHandle, NULL, NULL, 0 );
+        }
+    }
+
+    return xMatches;
+}
+/*-----------------------------------------------------------*/
+
 BaseType_t SOCKETS_Init( void )
 {
     BaseType_t xResult = pdFAIL;
@@ -720,6 +798,7 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
             if( sTIRetCode == 0 )
             {
                 pxSocketContext->ulFlags |= securesocketsSOCKET_IS_CONNECTED;
+                securesocketsTCP_CONNECTED_HOOK();
             }
             else
             {
@@ -1078,10 +1157,32 @@ int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
 
                 if( ( pxSocketContext->ulFlags & securesocketsSOCKET_IS_CONNECTED ) == 0 )
                 {
-                    /* Write the certificate to the file system. */
-                    lRetCode = prvWriteCertificate( socketsconfigSECURE_FILE_NAME_CUSTOMROOTCA,
-                                                    pvOptionValue,
-                                                    xOptionLength - 1U );
+                    /* Write the certificate to the file system, unless it
+                     * is already there. The socketInUse mutex keeps tasks
+                     * connecting at the same time from writing the file
+                     * while another compares it. */
+                    if( xSemaphoreTake( xUcInUse, xMaxSemaphoreBlockTime ) == pdTRUE )
+                    {
+                        if( prvCertificateMatches( socketsconfigSECURE_FILE_NAME_CUSTOMROOTCA,
+                                                   pvOptionValue,
+                                                   xOptionLength - 1U ) == pdTRUE )
+                        {
+                            lRetCode = SOCKETS_ERROR_NONE;
+                        }
+                        else
+                        {
+                            lRetCode = prvWriteCertificate( socketsconfigSECURE_FILE_NAME_CUSTOMROOTCA,
+                                                            pvOptionValue,
+                                                            xOptionLength - 1U );
+                        }
+
+                        ( void ) xSemaphoreGive( xUcInUse );
+                    }
+                    else
+                    {
+                        lRetCode = SOCKETS_SOCKET_ERROR;
+                        SOCKETS_PRINT( ( "ERROR: Timed out waiting to write the root certificate.\r\n" ) );
+                    }
 
                     /* If the certificate was successfully written to the
                      * file system, use it for the socket. */
@@ -1270,10 +1270,30 @@ WIFIReturnCode_t WIFI_SetPMMode( WIFIPMMode_t xPMModeType,
                 break;
 
             case eWiFiPMLowPower:
-                sRetCode = sl_WlanPolicySet( SL_WLAN_POLICY_PM,
-                                             SL_WLAN_LOW_POWER_POLICY,
-                                             NULL,
-                                             0 );
+
+                /* pvOptionValue points to a uint16_t maximum sleep time in
+                 * milliseconds. A non-zero value selects the long sleep
+                 * interval policy, so the device wakes on a fixed period that
+                 * callers can align their traffic to. */
+                if( *( ( const uint16_t * ) pvOptionValue ) != 0U )
+                {
+                    SlWlanPmPolicyParams_t xPmPolicyParams;
+
+                    memset( &xPmPolicyParams, 0, sizeof( xPmPolicyParams ) );
+                    xPmPolicyParams.MaxSleepTimeMs = *( ( const uint16_t * ) pvOptionValue );
+                    sRetCode = sl_WlanPolicySet( SL_WLAN_POLICY_PM,
+                                                 SL_WLAN_LONG_SLEEP_INTERVAL_POLICY,
+                                                 ( _u8 * ) &xPmPolicyParams,
+                                                 sizeof( xPmPolicyParams ) );
+                }
+                else
+                {
+                    sRetCode = sl_WlanPolicySet( SL_WLAN_POLICY_PM,
+                                                 SL_WLAN_LOW_POWER_POLICY,
+                                                 NULL,
+                                                 0 );
+                }
+
                 break;
 
             case eWiFiPMAlwaysOn:
@@ -1344,6 +1364,12 @@ WIFIReturnCode_t WIFI_GetPMMode( WIFIPMMode_t * pxPMModeType,
 
                 case SL_WLAN_LOW_POWER_POLICY:
                     *pxPMModeType = eWiFiPMLowPower;
+                    *( ( uint16_t * ) pvOptionValue ) = 0U;
+                    break;
+
+                case SL_WLAN_LONG_SLEEP_INTERVAL_POLICY:
+                    *pxPMModeType = eWiFiPMLowPower;
+                    *( ( uint16_t * ) pvOptionValue ) = xPmPolicyParams.MaxSleepTimeMs;
                     break;
 
                 case SL_WLAN_ALWAYS_ON_POLICY: